@@ -37,6 +37,7 @@
 
 S32 LLJoint::sNumUpdates = 0;
 S32 LLJoint::sNumTouches = 0;
+U32 LLJoint::sHierarchyChanges = 0;
 
 template <class T> 
 bool attachment_map_iter_compare_key(const T& a, const T& b)
@@ -195,7 +196,8 @@ void LLJoint::setSupport(const std::string& support_name)
 
 //-----------------------------------------------------------------------------
 // touch()
-// Sets all dirty flags for all children, recursively.
+// Sets all dirty flags for all children, recursively, and
+// CHILDREN_DIRTY for the parents.
 //-----------------------------------------------------------------------------
 void LLJoint::touch(U32 flags)
 {
@@ -203,6 +205,10 @@ void LLJoint::touch(U32 flags)
     {
         sNumTouches++;
         mDirtyFlags |= flags;
+        for (LLJoint* parent = mParent; parent && !(parent->mDirtyFlags & CHILDREN_DIRTY); parent = parent->mParent)
+        {
+            parent->mDirtyFlags |= CHILDREN_DIRTY;
+        }
         U32 child_flags = flags;
         if (flags & ROTATION_DIRTY)
         {
@@ -278,6 +284,7 @@ void LLJoint::addChild(LLJoint* joint)
     joint->mXform.setParent(&mXform);
     joint->mParent = this;  
     joint->touch();
+    ++sHierarchyChanges;
 }
 
 
@@ -294,6 +301,7 @@ void LLJoint::removeChild(LLJoint* joint)
         joint->mXform.setParent(NULL);
         joint->mParent = NULL;
         joint->touch();
+        ++sHierarchyChanges;
     }
 }
 
@@ -313,6 +321,10 @@ void LLJoint::removeAllChildren()
             //delete joint;
         }
     }
+    if (!mChildren.empty())
+    {
+        ++sHierarchyChanges;
+    }
     mChildren.clear();
 }
 
@@ -1011,7 +1023,8 @@ void LLJoint::updateWorldMatrix()
         sNumUpdates++;
         mXform.updateMatrix(FALSE);
         mWorldMatrix.loadu(mXform.getWorldMatrix());
-        mDirtyFlags = 0x0;
+        // the children may still be dirty
+        mDirtyFlags &= CHILDREN_DIRTY;
     }
 }
 
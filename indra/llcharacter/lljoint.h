@@ -108,7 +108,10 @@ public:
         MATRIX_DIRTY = 0x1 << 0,
         ROTATION_DIRTY = 0x1 << 1,
         POSITION_DIRTY = 0x1 << 2,
-        ALL_DIRTY = 0x7
+        ALL_DIRTY = 0x7,
+        // some joint below this one was touched since the last update of
+        // the whole subtree, see LLJointHierarchy
+        CHILDREN_DIRTY = 0x1 << 3
     };
 public:
     enum SupportCategory
@@ -151,6 +154,9 @@ public:
     // debug statics
     static S32      sNumTouches;
     static S32      sNumUpdates;
+    // bumped whenever a joint gets or loses a parent, so that flattened
+    // copies of the tree know to rebuild
+    static U32      sHierarchyChanges;
     typedef std::set<std::string> debug_joint_name_t;
     static debug_joint_name_t s_debugJointNames;
     static void setDebugJointNames(const debug_joint_name_t& names);
@@ -272,6 +278,9 @@ public:
 
     void updateWorldMatrix();
 
+    // writes mWorldMatrix and mXform without recursing
+    friend class LLJointHierarchy;
+
     // get/set skin offset
     const LLVector3 &getSkinOffset();
     void setSkinOffset( const LLVector3 &offset);
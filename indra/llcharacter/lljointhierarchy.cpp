@@ -0,0 +1,285 @@
+/**
+ * @file lljointhierarchy.cpp
+ * @brief Flattened joint tree, updated without recursion and in parallel
+ *        across characters.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lljointhierarchy.h"
+
+#include <atomic>
+
+#include "lljoint.h"
+#include "workqueue.h"
+
+// Characters updated per thread, at the least
+const S32 MIN_HIERARCHIES_PER_HELPER = 4;
+const S32 MAX_JOINT_HELPERS = 3;
+
+namespace
+{
+    LLVector4Logical make_w_mask()
+    {
+        LLVector4Logical mask;
+        mask.clear();
+        mask.setElement<3>();
+        return mask;
+    }
+
+    const LLVector4Logical W_MASK = make_w_mask();
+    const LLVector4a NEGATE_XYZ(-1.f, -1.f, -1.f, 1.f);
+    const LLVector4a ONE(1.f, 1.f, 1.f, 1.f);
+    const LLVector4a AXIS_X(1.f, 0.f, 0.f, 0.f);
+    const LLVector4a AXIS_Y(0.f, 1.f, 0.f, 0.f);
+    const LLVector4a AXIS_Z(0.f, 0.f, 1.f, 0.f);
+
+    // a * b, in the order LLQuaternion's operator* composes them: the
+    // rotation a, followed by b
+    inline void quat_mul(LLQuaternion2& res, const LLQuaternion2& a, const LLQuaternion2& b)
+    {
+        const LLVector4a& av = a.getVector4a();
+        const LLVector4a& bv = b.getVector4a();
+        LLVector4a aw; aw.splat<3>(av);
+        LLVector4a bw; bw.splat<3>(bv);
+
+        // imaginary part: bw * a + aw * b + b x a
+        LLVector4a imag; imag.setMul(bw, av);
+        LLVector4a temp; temp.setMul(aw, bv);
+        imag.add(temp);
+        temp.setCross3(bv, av);
+        imag.add(temp);
+
+        // real part: bw * aw - b . a
+        temp.setMul(bv, NEGATE_XYZ);
+        LLVector4a real; real.setAllDot4(temp, av);
+
+        res.getVector4aRw().setSelectWithMask(W_MASK, real, imag);
+    }
+
+    // What LLMatrix4::initAll(scale, rot, pos) gives: the axes rotated and
+    // scaled, then the translation
+    inline void init_all(LLMatrix4a& mat, const LLVector4a& scale, const LLQuaternion2& rot, const LLVector4a& pos)
+    {
+        LLVector4a axis_scale;
+        mat.mMatrix[0].setRotated(rot, AXIS_X);
+        axis_scale.splat<0>(scale);
+        mat.mMatrix[0].mul(axis_scale);
+        mat.mMatrix[1].setRotated(rot, AXIS_Y);
+        axis_scale.splat<1>(scale);
+        mat.mMatrix[1].mul(axis_scale);
+        mat.mMatrix[2].setRotated(rot, AXIS_Z);
+        axis_scale.splat<2>(scale);
+        mat.mMatrix[2].mul(axis_scale);
+        mat.mMatrix[3].setSelectWithMask(W_MASK, ONE, pos);
+    }
+}
+
+LLJointHierarchy::LLJointHierarchy()
+:   mBuiltChanges(0),
+    mVisitAll(true)
+{
+}
+
+void LLJointHierarchy::clear()
+{
+    mJoints.clear();
+    mParents.clear();
+    mSubtreeEnds.clear();
+    mWorldPositions.clear();
+    mWorldRotations.clear();
+    mScales.clear();
+    mBuiltChanges = LLJoint::sHierarchyChanges;
+    mVisitAll = true;
+}
+
+void LLJointHierarchy::build(LLJoint* root)
+{
+    clear();
+    if (!root)
+    {
+        return;
+    }
+
+    // depth first, children in the order updateWorldMatrixChildren() takes
+    // them, so that every subtree is a run of the array
+    std::vector<std::pair<LLJoint*, S32> > stack;
+    stack.push_back(std::make_pair(root, -1));
+    while (!stack.empty())
+    {
+        LLJoint* joint = stack.back().first;
+        S32 parent = stack.back().second;
+        stack.pop_back();
+
+        S32 index = (S32)mJoints.size();
+        mJoints.push_back(joint);
+        mParents.push_back(parent);
+        for (LLJoint::joints_t::reverse_iterator iter = joint->mChildren.rbegin();
+             iter != joint->mChildren.rend(); ++iter)
+        {
+            stack.push_back(std::make_pair(*iter, index));
+        }
+    }
+
+    const S32 count = (S32)mJoints.size();
+    mSubtreeEnds.resize(count);
+    for (S32 i = count - 1; i >= 0; --i)
+    {
+        // the children, after i, are done already
+        mSubtreeEnds[i] = llmax(mSubtreeEnds[i], i + 1);
+        if (mParents[i] >= 0)
+        {
+            mSubtreeEnds[mParents[i]] = llmax(mSubtreeEnds[mParents[i]], mSubtreeEnds[i]);
+        }
+    }
+
+    mWorldPositions.resize(count);
+    mWorldRotations.resize(count);
+    mScales.resize(count);
+}
+
+bool LLJointHierarchy::isStale() const
+{
+    return mBuiltChanges != LLJoint::sHierarchyChanges;
+}
+
+S32 LLJointHierarchy::updateWorldMatrices()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    llassert(!isStale());
+
+    S32 updated = 0;
+    const S32 count = (S32)mJoints.size();
+    for (S32 i = 0; i < count; )
+    {
+        LLJoint* joint = mJoints[i];
+        U32 dirty = joint->mDirtyFlags;
+
+        if (!joint->mUpdateXform)
+        {
+            // updateWorldMatrixChildren() stops here as well. Whatever is
+            // dirty below stays so, and the parents must keep saying it.
+            bool subtree_dirty = dirty & (LLJoint::MATRIX_DIRTY | LLJoint::CHILDREN_DIRTY);
+            for (S32 j = i + 1; mVisitAll && !subtree_dirty && j < mSubtreeEnds[i]; ++j)
+            {
+                // new joints have not told their parents yet
+                subtree_dirty = mJoints[j]->mDirtyFlags & LLJoint::MATRIX_DIRTY;
+            }
+            for (S32 parent = mParents[i];
+                 subtree_dirty && parent >= 0 && !(mJoints[parent]->mDirtyFlags & LLJoint::CHILDREN_DIRTY);
+                 parent = mParents[parent])
+            {
+                mJoints[parent]->mDirtyFlags |= LLJoint::CHILDREN_DIRTY;
+            }
+            i = mSubtreeEnds[i];
+            continue;
+        }
+
+        if (!mVisitAll && !(dirty & (LLJoint::MATRIX_DIRTY | LLJoint::CHILDREN_DIRTY)))
+        {
+            // nothing touched under here since the last update
+            i = mSubtreeEnds[i];
+            continue;
+        }
+
+        LLXformMatrix* xform = joint->getXform();
+        LLVector4a& world_pos = mWorldPositions[i];
+        LLQuaternion2& world_rot = mWorldRotations[i];
+        LLVector4a& scale = mScales[i];
+        scale.load3(xform->getScale().mV);
+
+        if (!(dirty & LLJoint::MATRIX_DIRTY))
+        {
+            // up to date, only needed by the children
+            world_pos.load3(xform->getWorldPosition().mV);
+            world_rot = xform->getWorldRotation();
+            joint->mDirtyFlags &= ~LLJoint::CHILDREN_DIRTY;
+            ++i;
+            continue;
+        }
+
+        // LLXformMatrix::update()
+        LLVector4a pos;
+        pos.load3(xform->getPosition().mV);
+        LLQuaternion2 rot(xform->getRotation());
+        S32 parent = mParents[i];
+        LLXform* parent_xform = xform->getParent();
+        if (parent_xform)
+        {
+            LLVector4a parent_pos;
+            LLQuaternion2 parent_rot;
+            LLVector4a parent_scale;
+            if (parent >= 0)
+            {
+                parent_pos = mWorldPositions[parent];
+                parent_rot = mWorldRotations[parent];
+                parent_scale = mScales[parent];
+            }
+            else
+            {
+                // the root hangs off something else, e.g. a seat
+                parent_pos.load3(parent_xform->getWorldPosition().mV);
+                parent_rot = parent_xform->getWorldRotation();
+                parent_scale.load3(parent_xform->getScale().mV);
+            }
+
+            if (parent_xform->getScaleChildOffset())
+            {
+                pos.mul(parent_scale);
+            }
+            world_pos.setRotated(parent_rot, pos);
+            world_pos.add(parent_pos);
+            quat_mul(world_rot, rot, parent_rot);
+        }
+        else
+        {
+            world_pos = pos;
+            world_rot = rot;
+        }
+
+        init_all(joint->mWorldMatrix, scale, world_rot, world_pos);
+
+        LLQuaternion rotation;
+        memcpy(rotation.mQ, world_rot.getVector4a().getF32ptr(), sizeof(rotation.mQ));
+        xform->setWorldTransform(LLVector3(world_pos.getF32ptr()), rotation, LLMatrix4(joint->mWorldMatrix.getF32ptr()));
+        // the whole subtree follows
+        joint->mDirtyFlags = 0x0;
+        ++updated;
+        ++i;
+    }
+
+    mVisitAll = false;
+    return updated;
+}
+
+//static
+void LLJointHierarchy::updateAll(const std::vector<LLJointHierarchy*>& hierarchies)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    const S32 count = (S32)hierarchies.size();
+    std::atomic<S32> updated(0);
+    LL::parallelFor(count, llmin(count / MIN_HIERARCHIES_PER_HELPER - 1, MAX_JOINT_HELPERS),
+        [&hierarchies, &updated](S32 i) { updated += hierarchies[i]->updateWorldMatrices(); });
+    LLJoint::sNumUpdates += updated;
+}
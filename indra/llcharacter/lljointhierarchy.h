@@ -0,0 +1,94 @@
+/**
+ * @file lljointhierarchy.h
+ * @brief Flattened joint tree, updated without recursion and in parallel
+ *        across characters.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLJOINTHIERARCHY_H
+#define LL_LLJOINTHIERARCHY_H
+
+#include <vector>
+
+#include "llmath.h"
+#include "llsimdmath.h"
+
+class LLJoint;
+
+/**
+ * The joints under a root in one array, every joint after its parent, so
+ * that updating the world matrices is a single pass over the array instead
+ * of a recursion through mChildren. The world positions and rotations are
+ * kept beside it, one array each, for the children to compose with.
+ *
+ * The result is what getRoot()->updateWorldMatrixChildren() gives, written
+ * back to the joints, so nothing reading them needs to change. A subtree
+ * without dirty joints (see LLJoint::CHILDREN_DIRTY) is skipped.
+ *
+ * The array is built again when joints were added or removed anywhere
+ * since, which only happens when skeletons are (re)built.
+ */
+class LLJointHierarchy
+{
+public:
+    LLJointHierarchy();
+
+    // Flattens the joints under root, which may be NULL
+    void build(LLJoint* root);
+    void clear();
+
+    LLJoint* getRoot() const        { return mJoints.empty() ? NULL : mJoints[0]; }
+    S32 getJointCount() const       { return (S32)mJoints.size(); }
+    // true when joints were added or removed since build()
+    bool isStale() const;
+
+    // Does not touch anything but these joints and their transforms, so
+    // hierarchies not sharing joints can be updated at the same time.
+    // Returns how many world matrices were recomputed.
+    S32 updateWorldMatrices();
+
+    // Updates each of the hierarchies, some of them on the "General" work
+    // queue if there are enough. The caller is blocked until all are done
+    // and must not be changing any of the joints from another thread.
+    static void updateAll(const std::vector<LLJointHierarchy*>& hierarchies);
+
+private:
+    std::vector<LLJoint*> mJoints;
+    // index of the parent of each joint, -1 for the root
+    std::vector<S32> mParents;
+    // index after the last joint under each joint
+    std::vector<S32> mSubtreeEnds;
+
+    // world transform of each joint, as of the last update
+    std::vector<LLVector4a> mWorldPositions;
+    std::vector<LLQuaternion2> mWorldRotations;
+    // local scale of each joint, which its children's offsets are scaled by
+    std::vector<LLVector4a> mScales;
+
+    // LLJoint::sHierarchyChanges when built
+    U32 mBuiltChanges;
+    // everything is visited once after a build, dirty or not
+    bool mVisitAll;
+};
+
+#endif // LL_LLJOINTHIERARCHY_H
@@ -42,6 +42,7 @@
 #include "m3math.h"
 #include "message.h"
 #include "llfilesystem.h"
+#include "llrecordcachefile.h"
 
 //-----------------------------------------------------------------------------
 // Static Definitions
@@ -61,6 +62,192 @@ static F32 MIN_ACCELERATION_SQUARED = 0.0005f * 0.0005f;
 
 static F32 MAX_CONSTRAINTS = 10;
 
+//-----------------------------------------------------------------------------
+// sort_keys()
+//-----------------------------------------------------------------------------
+// Sort curve keys by time, keeping only the last of several keys at one time
+template <typename KEY>
+static void sort_keys(std::vector<KEY>& keys)
+{
+    std::stable_sort(keys.begin(), keys.end(),
+                     [](const KEY& a, const KEY& b) { return a.mTime < b.mTime; });
+    size_t count = 0;
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        if (i + 1 < keys.size() && keys[i + 1].mTime == keys[i].mTime)
+        {
+            continue;
+        }
+        keys[count++] = keys[i];
+    }
+    keys.resize(count);
+}
+
+//-----------------------------------------------------------------------------
+// Keyframe data cache file
+//-----------------------------------------------------------------------------
+// "LLKF" - the start of the file
+static const U32 KEYFRAME_CACHE_MAGIC = 0x464b4c4c;
+// Bump when the layout of the records below changes. Records hold collision
+// volume IDs and joint hierarchy lookups, so bump it for skeleton changes too.
+static const U32 KEYFRAME_CACHE_FORMAT_VERSION = 1;
+// Past this size the file is rewritten with only the animations in use
+static const size_t MAX_KEYFRAME_CACHE_BYTES = 64 * 1024 * 1024;
+static const U32 KEYFRAME_CACHE_RECORD = 1;
+
+static LLRecordCacheFile sKeyframeCacheFile(KEYFRAME_CACHE_MAGIC, KEYFRAME_CACHE_FORMAT_VERSION, MAX_KEYFRAME_CACHE_BYTES);
+
+namespace
+{
+    // followed by the emote name, then each joint motion
+    struct joint_motion_list_record_t
+    {
+        F32 mDuration;
+        S32 mLoop;
+        F32 mLoopInPoint;
+        F32 mLoopOutPoint;
+        F32 mEaseInDuration;
+        F32 mEaseOutDuration;
+        S32 mBasePriority;
+        S32 mMaxPriority;
+        U32 mHandPose;
+        F32 mPelvisMin[3];
+        F32 mPelvisMax[3];
+        U32 mJointCount;
+        U32 mConstraintCount;
+    };
+
+    // followed by the joint name, then the scale, rotation and position curves
+    struct joint_motion_record_t
+    {
+        U32 mUsage;
+        S32 mPriority;
+    };
+
+    // followed by the key times, then each component of the keys
+    struct curve_record_t
+    {
+        S32 mInterpolationType;
+        S32 mNumKeys;
+        U32 mKeyCount;
+    };
+
+    // followed by mChainLength + 1 joint state indices
+    struct constraint_record_t
+    {
+        S32 mSourceConstraintVolume;
+        F32 mSourceConstraintOffset[3];
+        S32 mTargetConstraintVolume;
+        F32 mTargetConstraintOffset[3];
+        F32 mTargetConstraintDir[3];
+        S32 mChainLength;
+        F32 mEaseInStartTime;
+        F32 mEaseInStopTime;
+        F32 mEaseOutStartTime;
+        F32 mEaseOutStopTime;
+        S32 mUseTargetOffset;
+        S32 mConstraintType;
+        S32 mConstraintTargetType;
+    };
+
+    template <typename T>
+    void append_value(std::vector<U8>& buffer, const T& value)
+    {
+        const U8* bytes = reinterpret_cast<const U8*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    void append_floats(std::vector<U8>& buffer, const std::vector<F32>& values)
+    {
+        const U8* bytes = reinterpret_cast<const U8*>(values.data());
+        buffer.insert(buffer.end(), bytes, bytes + values.size() * sizeof(F32));
+    }
+
+    void append_string(std::vector<U8>& buffer, const std::string& str)
+    {
+        append_value(buffer, (U32)str.size());
+        buffer.insert(buffer.end(), str.begin(), str.end());
+    }
+
+    bool read_bytes(const U8*& data, const U8* end, void* dest, size_t size)
+    {
+        if ((size_t)(end - data) < size)
+        {
+            return false;
+        }
+        memcpy(dest, data, size);
+        data += size;
+        return true;
+    }
+
+    template <typename T>
+    bool read_value(const U8*& data, const U8* end, T& value)
+    {
+        return read_bytes(data, end, &value, sizeof(T));
+    }
+
+    bool read_floats(const U8*& data, const U8* end, U32 count, std::vector<F32>& values)
+    {
+        if ((size_t)(end - data) / sizeof(F32) < count)
+        {
+            return false;
+        }
+        values.resize(count);
+        return read_bytes(data, end, values.data(), count * sizeof(F32));
+    }
+
+    bool read_string(const U8*& data, const U8* end, std::string& str)
+    {
+        U32 length;
+        if (!read_value(data, end, length) || (size_t)(end - data) < length)
+        {
+            return false;
+        }
+        str.assign((const char*)data, length);
+        data += length;
+        return true;
+    }
+
+    template <typename CURVE>
+    void pack_curve(std::vector<U8>& buffer, const CURVE& curve)
+    {
+        curve_record_t record;
+        record.mInterpolationType = curve.mInterpolationType;
+        record.mNumKeys = curve.mNumKeys;
+        record.mKeyCount = (U32)curve.getKeyCount();
+        append_value(buffer, record);
+        append_floats(buffer, curve.mTimes);
+        for (const std::vector<F32>& values : curve.mValues)
+        {
+            append_floats(buffer, values);
+        }
+    }
+
+    template <typename CURVE>
+    bool unpack_curve(const U8*& data, const U8* end, CURVE& curve)
+    {
+        curve_record_t record;
+        if (!read_value(data, end, record)
+            || record.mInterpolationType < LLKeyframeMotion::IT_STEP
+            || record.mInterpolationType > LLKeyframeMotion::IT_SPLINE
+            || record.mNumKeys < 0
+            || !read_floats(data, end, record.mKeyCount, curve.mTimes))
+        {
+            return false;
+        }
+        for (std::vector<F32>& values : curve.mValues)
+        {
+            if (!read_floats(data, end, record.mKeyCount, values))
+            {
+                return false;
+            }
+        }
+        curve.mInterpolationType = (LLKeyframeMotion::InterpolationType)record.mInterpolationType;
+        curve.mNumKeys = record.mNumKeys;
+        return true;
+    }
+}
+
 //-----------------------------------------------------------------------------
 // JointMotionList
 //-----------------------------------------------------------------------------
@@ -121,6 +308,155 @@ U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo()
     return total_size;
 }
 
+//-----------------------------------------------------------------------------
+// JointMotionList::pack()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::JointMotionList::pack(std::vector<U8>& buffer) const
+{
+    joint_motion_list_record_t record;
+    memset(&record, 0, sizeof(record));
+    record.mDuration = mDuration;
+    record.mLoop = mLoop;
+    record.mLoopInPoint = mLoopInPoint;
+    record.mLoopOutPoint = mLoopOutPoint;
+    record.mEaseInDuration = mEaseInDuration;
+    record.mEaseOutDuration = mEaseOutDuration;
+    record.mBasePriority = mBasePriority;
+    record.mMaxPriority = mMaxPriority;
+    record.mHandPose = mHandPose;
+    memcpy(record.mPelvisMin, mPelvisBBox.getMin().mV, sizeof(record.mPelvisMin));
+    memcpy(record.mPelvisMax, mPelvisBBox.getMax().mV, sizeof(record.mPelvisMax));
+    record.mJointCount = getNumJointMotions();
+    record.mConstraintCount = (U32)mConstraints.size();
+    append_value(buffer, record);
+    append_string(buffer, mEmoteName);
+
+    for (const JointMotion* joint_motion : mJointMotionArray)
+    {
+        joint_motion_record_t joint_record;
+        joint_record.mUsage = joint_motion->mUsage;
+        joint_record.mPriority = joint_motion->mPriority;
+        append_value(buffer, joint_record);
+        append_string(buffer, joint_motion->mJointName);
+        pack_curve(buffer, joint_motion->mScaleCurve);
+        pack_curve(buffer, joint_motion->mRotationCurve);
+        pack_curve(buffer, joint_motion->mPositionCurve);
+    }
+
+    for (const JointConstraintSharedData* constraint : mConstraints)
+    {
+        constraint_record_t constraint_record;
+        memset(&constraint_record, 0, sizeof(constraint_record));
+        constraint_record.mSourceConstraintVolume = constraint->mSourceConstraintVolume;
+        memcpy(constraint_record.mSourceConstraintOffset, constraint->mSourceConstraintOffset.mV, sizeof(constraint_record.mSourceConstraintOffset));
+        constraint_record.mTargetConstraintVolume = constraint->mTargetConstraintVolume;
+        memcpy(constraint_record.mTargetConstraintOffset, constraint->mTargetConstraintOffset.mV, sizeof(constraint_record.mTargetConstraintOffset));
+        memcpy(constraint_record.mTargetConstraintDir, constraint->mTargetConstraintDir.mV, sizeof(constraint_record.mTargetConstraintDir));
+        constraint_record.mChainLength = constraint->mChainLength;
+        constraint_record.mEaseInStartTime = constraint->mEaseInStartTime;
+        constraint_record.mEaseInStopTime = constraint->mEaseInStopTime;
+        constraint_record.mEaseOutStartTime = constraint->mEaseOutStartTime;
+        constraint_record.mEaseOutStopTime = constraint->mEaseOutStopTime;
+        constraint_record.mUseTargetOffset = constraint->mUseTargetOffset;
+        constraint_record.mConstraintType = constraint->mConstraintType;
+        constraint_record.mConstraintTargetType = constraint->mConstraintTargetType;
+        append_value(buffer, constraint_record);
+        const U8* indices = reinterpret_cast<const U8*>(constraint->mJointStateIndices);
+        buffer.insert(buffer.end(), indices, indices + (constraint->mChainLength + 1) * sizeof(S32));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// JointMotionList::unpack()
+//-----------------------------------------------------------------------------
+bool LLKeyframeMotion::JointMotionList::unpack(const U8* data, U32 size)
+{
+    const U8* end = data + size;
+    joint_motion_list_record_t record;
+    if (!read_value(data, end, record)
+        || record.mJointCount == 0
+        || record.mJointCount > LL_CHARACTER_MAX_ANIMATED_JOINTS
+        || record.mConstraintCount > MAX_CONSTRAINTS
+        || record.mHandPose > LLHandMotion::NUM_HAND_POSES
+        || !read_string(data, end, mEmoteName))
+    {
+        return false;
+    }
+    mDuration = record.mDuration;
+    mLoop = record.mLoop;
+    mLoopInPoint = record.mLoopInPoint;
+    mLoopOutPoint = record.mLoopOutPoint;
+    mEaseInDuration = record.mEaseInDuration;
+    mEaseOutDuration = record.mEaseOutDuration;
+    mBasePriority = (LLJoint::JointPriority)record.mBasePriority;
+    mMaxPriority = (LLJoint::JointPriority)record.mMaxPriority;
+    mHandPose = (LLHandMotion::eHandPose)record.mHandPose;
+    mPelvisBBox.setMin(LLVector3(record.mPelvisMin));
+    mPelvisBBox.setMax(LLVector3(record.mPelvisMax));
+
+    mJointMotionArray.reserve(record.mJointCount);
+    for (U32 i = 0; i < record.mJointCount; ++i)
+    {
+        JointMotion* joint_motion = new JointMotion;
+        mJointMotionArray.push_back(joint_motion);
+
+        joint_motion_record_t joint_record;
+        if (!read_value(data, end, joint_record)
+            || !read_string(data, end, joint_motion->mJointName)
+            || !unpack_curve(data, end, joint_motion->mScaleCurve)
+            || !unpack_curve(data, end, joint_motion->mRotationCurve)
+            || !unpack_curve(data, end, joint_motion->mPositionCurve))
+        {
+            return false;
+        }
+        joint_motion->mUsage = joint_record.mUsage;
+        joint_motion->mPriority = (LLJoint::JointPriority)joint_record.mPriority;
+    }
+
+    for (U32 i = 0; i < record.mConstraintCount; ++i)
+    {
+        constraint_record_t constraint_record;
+        if (!read_value(data, end, constraint_record)
+            || constraint_record.mChainLength < 0
+            || (U32)constraint_record.mChainLength > record.mJointCount
+            || constraint_record.mConstraintType < 0
+            || constraint_record.mConstraintType >= NUM_CONSTRAINT_TYPES)
+        {
+            return false;
+        }
+
+        JointConstraintSharedData* constraint = new JointConstraintSharedData;
+        mConstraints.push_back(constraint);
+        constraint->mSourceConstraintVolume = constraint_record.mSourceConstraintVolume;
+        constraint->mSourceConstraintOffset.set(constraint_record.mSourceConstraintOffset);
+        constraint->mTargetConstraintVolume = constraint_record.mTargetConstraintVolume;
+        constraint->mTargetConstraintOffset.set(constraint_record.mTargetConstraintOffset);
+        constraint->mTargetConstraintDir.set(constraint_record.mTargetConstraintDir);
+        constraint->mChainLength = constraint_record.mChainLength;
+        constraint->mEaseInStartTime = constraint_record.mEaseInStartTime;
+        constraint->mEaseInStopTime = constraint_record.mEaseInStopTime;
+        constraint->mEaseOutStartTime = constraint_record.mEaseOutStartTime;
+        constraint->mEaseOutStopTime = constraint_record.mEaseOutStopTime;
+        constraint->mUseTargetOffset = constraint_record.mUseTargetOffset;
+        constraint->mConstraintType = (EConstraintType)constraint_record.mConstraintType;
+        constraint->mConstraintTargetType = (EConstraintTargetType)constraint_record.mConstraintTargetType;
+
+        constraint->mJointStateIndices = new S32[constraint->mChainLength + 1];
+        if (!read_bytes(data, end, constraint->mJointStateIndices, (constraint->mChainLength + 1) * sizeof(S32)))
+        {
+            return false;
+        }
+        for (S32 j = 0; j < constraint->mChainLength + 1; ++j)
+        {
+            if (constraint->mJointStateIndices[j] < 0 || (U32)constraint->mJointStateIndices[j] >= record.mJointCount)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 // ****Curve classes
@@ -142,7 +478,6 @@ LLKeyframeMotion::ScaleCurve::ScaleCurve()
 //-----------------------------------------------------------------------------
 LLKeyframeMotion::ScaleCurve::~ScaleCurve() 
 {
-    mKeys.clear();
     mNumKeys = 0;
 }
 
@@ -153,40 +488,28 @@ LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration)
 {
     LLVector3 value;
 
-    if (mKeys.empty())
+    if (mTimes.empty())
     {
         value.clearVec();
         return value;
     }
     
-    key_map_t::iterator right = mKeys.lower_bound(time);
-    if (right == mKeys.end())
+    S32 right = (S32)(std::lower_bound(mTimes.begin(), mTimes.end(), time) - mTimes.begin());
+    if (right == getKeyCount())
     {
         // Past last key
-        --right;
-        value = right->second.mScale;
+        value = getKey(right - 1).mScale;
     }
-    else if (right == mKeys.begin() || right->first == time)
+    else if (right == 0 || mTimes[right] == time)
     {
         // Before first key or exactly on a key
-        value = right->second.mScale;
+        value = getKey(right).mScale;
     }
     else
     {
         // Between two keys
-        key_map_t::iterator left = right; --left;
-        F32 index_before = left->first;
-        F32 index_after = right->first;
-        ScaleKey& scale_before = left->second;
-        ScaleKey& scale_after = right->second;
-        if (right == mKeys.end())
-        {
-            scale_after = mLoopInKey;
-            index_after = duration;
-        }
-
-        F32 u = (time - index_before) / (index_after - index_before);
-        value = interp(u, scale_before, scale_after);
+        F32 u = (time - mTimes[right - 1]) / (mTimes[right] - mTimes[right - 1]);
+        value = interp(u, getKey(right - 1), getKey(right));
     }
     return value;
 }
@@ -194,7 +517,7 @@ LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration)
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::ScaleCurve::interp(F32 u, ScaleKey& before, ScaleKey& after)
+LLVector3 LLKeyframeMotion::ScaleCurve::interp(F32 u, const ScaleKey& before, const ScaleKey& after)
 {
     switch (mInterpolationType)
     {
@@ -208,6 +531,34 @@ LLVector3 LLKeyframeMotion::ScaleCurve::interp(F32 u, ScaleKey& before, ScaleKey
     }
 }
 
+//-----------------------------------------------------------------------------
+// setKeys()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::ScaleCurve::setKeys(std::vector<ScaleKey>& keys)
+{
+    sort_keys(keys);
+    mTimes.resize(keys.size());
+    for (std::vector<F32>& values : mValues)
+    {
+        values.resize(keys.size());
+    }
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        mTimes[i] = keys[i].mTime;
+        mValues[VX][i] = keys[i].mScale.mV[VX];
+        mValues[VY][i] = keys[i].mScale.mV[VY];
+        mValues[VZ][i] = keys[i].mScale.mV[VZ];
+    }
+}
+
+//-----------------------------------------------------------------------------
+// getKey()
+//-----------------------------------------------------------------------------
+LLKeyframeMotion::ScaleKey LLKeyframeMotion::ScaleCurve::getKey(S32 index) const
+{
+    return ScaleKey(mTimes[index], LLVector3(mValues[VX][index], mValues[VY][index], mValues[VZ][index]));
+}
+
 //-----------------------------------------------------------------------------
 // RotationCurve::RotationCurve()
 //-----------------------------------------------------------------------------
@@ -222,7 +573,6 @@ LLKeyframeMotion::RotationCurve::RotationCurve()
 //-----------------------------------------------------------------------------
 LLKeyframeMotion::RotationCurve::~RotationCurve()
 {
-    mKeys.clear();
     mNumKeys = 0;
 }
 
@@ -233,40 +583,28 @@ LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration)
 {
     LLQuaternion value;
 
-    if (mKeys.empty())
+    if (mTimes.empty())
     {
         value = LLQuaternion::DEFAULT;
         return value;
     }
     
-    key_map_t::iterator right = mKeys.lower_bound(time);
-    if (right == mKeys.end())
+    S32 right = (S32)(std::lower_bound(mTimes.begin(), mTimes.end(), time) - mTimes.begin());
+    if (right == getKeyCount())
     {
         // Past last key
-        --right;
-        value = right->second.mRotation;
+        value = getKey(right - 1).mRotation;
     }
-    else if (right == mKeys.begin() || right->first == time)
+    else if (right == 0 || mTimes[right] == time)
     {
         // Before first key or exactly on a key
-        value = right->second.mRotation;
+        value = getKey(right).mRotation;
     }
     else
     {
         // Between two keys
-        key_map_t::iterator left = right; --left;
-        F32 index_before = left->first;
-        F32 index_after = right->first;
-        RotationKey& rot_before = left->second;
-        RotationKey& rot_after = right->second;
-        if (right == mKeys.end())
-        {
-            rot_after = mLoopInKey;
-            index_after = duration;
-        }
-
-        F32 u = (time - index_before) / (index_after - index_before);
-        value = interp(u, rot_before, rot_after);
+        F32 u = (time - mTimes[right - 1]) / (mTimes[right] - mTimes[right - 1]);
+        value = interp(u, getKey(right - 1), getKey(right));
     }
     return value;
 }
@@ -274,7 +612,7 @@ LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration)
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
-LLQuaternion LLKeyframeMotion::RotationCurve::interp(F32 u, RotationKey& before, RotationKey& after)
+LLQuaternion LLKeyframeMotion::RotationCurve::interp(F32 u, const RotationKey& before, const RotationKey& after)
 {
     switch (mInterpolationType)
     {
@@ -288,6 +626,35 @@ LLQuaternion LLKeyframeMotion::RotationCurve::interp(F32 u, RotationKey& before,
     }
 }
 
+//-----------------------------------------------------------------------------
+// setKeys()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::RotationCurve::setKeys(std::vector<RotationKey>& keys)
+{
+    sort_keys(keys);
+    mTimes.resize(keys.size());
+    for (std::vector<F32>& values : mValues)
+    {
+        values.resize(keys.size());
+    }
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        mTimes[i] = keys[i].mTime;
+        mValues[VX][i] = keys[i].mRotation.mQ[VX];
+        mValues[VY][i] = keys[i].mRotation.mQ[VY];
+        mValues[VZ][i] = keys[i].mRotation.mQ[VZ];
+        mValues[VS][i] = keys[i].mRotation.mQ[VS];
+    }
+}
+
+//-----------------------------------------------------------------------------
+// getKey()
+//-----------------------------------------------------------------------------
+LLKeyframeMotion::RotationKey LLKeyframeMotion::RotationCurve::getKey(S32 index) const
+{
+    return RotationKey(mTimes[index], LLQuaternion(mValues[VX][index], mValues[VY][index], mValues[VZ][index], mValues[VS][index]));
+}
+
 
 //-----------------------------------------------------------------------------
 // PositionCurve::PositionCurve()
@@ -303,7 +670,6 @@ LLKeyframeMotion::PositionCurve::PositionCurve()
 //-----------------------------------------------------------------------------
 LLKeyframeMotion::PositionCurve::~PositionCurve()
 {
-    mKeys.clear();
     mNumKeys = 0;
 }
 
@@ -314,40 +680,28 @@ LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
 {
     LLVector3 value;
 
-    if (mKeys.empty())
+    if (mTimes.empty())
     {
         value.clearVec();
         return value;
     }
     
-    key_map_t::iterator right = mKeys.lower_bound(time);
-    if (right == mKeys.end())
+    S32 right = (S32)(std::lower_bound(mTimes.begin(), mTimes.end(), time) - mTimes.begin());
+    if (right == getKeyCount())
     {
         // Past last key
-        --right;
-        value = right->second.mPosition;
+        value = getKey(right - 1).mPosition;
     }
-    else if (right == mKeys.begin() || right->first == time)
+    else if (right == 0 || mTimes[right] == time)
     {
         // Before first key or exactly on a key
-        value = right->second.mPosition;
+        value = getKey(right).mPosition;
     }
     else
     {
         // Between two keys
-        key_map_t::iterator left = right; --left;
-        F32 index_before = left->first;
-        F32 index_after = right->first;
-        PositionKey& pos_before = left->second;
-        PositionKey& pos_after = right->second;
-        if (right == mKeys.end())
-        {
-            pos_after = mLoopInKey;
-            index_after = duration;
-        }
-
-        F32 u = (time - index_before) / (index_after - index_before);
-        value = interp(u, pos_before, pos_after);
+        F32 u = (time - mTimes[right - 1]) / (mTimes[right] - mTimes[right - 1]);
+        value = interp(u, getKey(right - 1), getKey(right));
     }
 
     llassert(value.isFinite());
@@ -358,7 +712,7 @@ LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, PositionKey& before, PositionKey& after)
+LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, const PositionKey& before, const PositionKey& after)
 {
     switch (mInterpolationType)
     {
@@ -371,6 +725,34 @@ LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, PositionKey& before, Po
     }
 }
 
+//-----------------------------------------------------------------------------
+// setKeys()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::PositionCurve::setKeys(std::vector<PositionKey>& keys)
+{
+    sort_keys(keys);
+    mTimes.resize(keys.size());
+    for (std::vector<F32>& values : mValues)
+    {
+        values.resize(keys.size());
+    }
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        mTimes[i] = keys[i].mTime;
+        mValues[VX][i] = keys[i].mPosition.mV[VX];
+        mValues[VY][i] = keys[i].mPosition.mV[VY];
+        mValues[VZ][i] = keys[i].mPosition.mV[VZ];
+    }
+}
+
+//-----------------------------------------------------------------------------
+// getKey()
+//-----------------------------------------------------------------------------
+LLKeyframeMotion::PositionKey LLKeyframeMotion::PositionCurve::getKey(S32 index) const
+{
+    return PositionKey(mTimes[index], LLVector3(mValues[VX][index], mValues[VY][index], mValues[VZ][index]));
+}
+
 
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
@@ -607,6 +989,8 @@ LLMotion::LLMotionInitStatus LLKeyframeMotion::onInitialize(LLCharacter *charact
 
     delete []anim_data;
 
+    LLKeyframeDataCache::storeKeyframeData(getID(), mJointMotionList);
+
     mAssetStatus = ASSET_LOADED;
     return STATUS_SUCCESS;
 }
@@ -1555,6 +1939,7 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
         // scan rotation curve keys
         //---------------------------------------------------------------------
         RotationCurve *rCurve = &joint_motion->mRotationCurve;
+        std::vector<RotationKey> rot_keys;
 
         for (S32 k = 0; k < joint_motion->mRotationCurve.mNumKeys; k++)
         {
@@ -1636,8 +2021,9 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
                 return FALSE;
             }
 
-            rCurve->mKeys[time] = rot_key;
+            rot_keys.push_back(rot_key);
         }
+        rCurve->setKeys(rot_keys);
 
         //---------------------------------------------------------------------
         // scan position curve header
@@ -1661,6 +2047,7 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
         //---------------------------------------------------------------------
         PositionCurve *pCurve = &joint_motion->mPositionCurve;
         BOOL is_pelvis = joint_motion->mJointName == "mPelvis";
+        std::vector<PositionKey> pos_keys;
         for (S32 k = 0; k < joint_motion->mPositionCurve.mNumKeys; k++)
         {
             U16 time_short;
@@ -1730,13 +2117,14 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
                 return FALSE;
             }
             
-            pCurve->mKeys[pos_key.mTime] = pos_key;
+            pos_keys.push_back(pos_key);
 
             if (is_pelvis)
             {
                 mJointMotionList->mPelvisBBox.addPoint(pos_key.mPosition);
             }
         }
+        pCurve->setKeys(pos_keys);
 
         joint_motion->mUsage = joint_state->getUsage();
     }
@@ -2065,10 +2453,9 @@ BOOL LLKeyframeMotion::serialize(LLDataPacker& dp) const
         success &= dp.packS32(joint_motionp->mRotationCurve.mNumKeys, "num_rot_keys");
 
         LL_DEBUGS("BVH") << "Joint " << joint_motionp->mJointName << LL_ENDL;
-        for (RotationCurve::key_map_t::iterator iter = joint_motionp->mRotationCurve.mKeys.begin();
-             iter != joint_motionp->mRotationCurve.mKeys.end(); ++iter)
+        for (S32 k = 0; k < joint_motionp->mRotationCurve.getKeyCount(); ++k)
         {
-            RotationKey& rot_key = iter->second;
+            RotationKey rot_key = joint_motionp->mRotationCurve.getKey(k);
             U16 time_short = F32_to_U16(rot_key.mTime, 0.f, mJointMotionList->mDuration);
             success &= dp.packU16(time_short, "time");
 
@@ -2087,10 +2474,9 @@ BOOL LLKeyframeMotion::serialize(LLDataPacker& dp) const
         }
 
         success &= dp.packS32(joint_motionp->mPositionCurve.mNumKeys, "num_pos_keys");
-        for (PositionCurve::key_map_t::iterator iter = joint_motionp->mPositionCurve.mKeys.begin();
-             iter != joint_motionp->mPositionCurve.mKeys.end(); ++iter)
+        for (S32 k = 0; k < joint_motionp->mPositionCurve.getKeyCount(); ++k)
         {
-            PositionKey& pos_key = iter->second;
+            PositionKey pos_key = joint_motionp->mPositionCurve.getKey(k);
             U16 time_short = F32_to_U16(pos_key.mTime, 0.f, mJointMotionList->mDuration);
             success &= dp.packU16(time_short, "time");
 
@@ -2428,6 +2814,7 @@ void LLKeyframeMotion::onLoadComplete(const LLUUID& asset_uuid,
             if (motionp->deserialize(dp, asset_uuid))
             {
                 motionp->mAssetStatus = ASSET_LOADED;
+                LLKeyframeDataCache::storeKeyframeData(asset_uuid, motionp->mJointMotionList);
             }
             else
             {
@@ -2513,11 +2900,58 @@ void LLKeyframeDataCache::removeKeyframeData(const LLUUID& id)
 LLKeyframeMotion::JointMotionList* LLKeyframeDataCache::getKeyframeData(const LLUUID& id)
 {
     keyframe_data_map_t::iterator found_data = sKeyframeDataMap.find(id);
-    if (found_data == sKeyframeDataMap.end())
+    if (found_data != sKeyframeDataMap.end())
+    {
+        return found_data->second;
+    }
+
+    // decoded in an earlier session?
+    if (!sKeyframeCacheFile.has(id, KEYFRAME_CACHE_RECORD))
     {
         return NULL;
     }
-    return found_data->second;
+    LLKeyframeMotion::JointMotionList* joint_motion_listp = new LLKeyframeMotion::JointMotionList;
+    if (!sKeyframeCacheFile.read(id, KEYFRAME_CACHE_RECORD, [joint_motion_listp](const U8* data, U32 size)
+            {
+                return joint_motion_listp->unpack(data, size);
+            }))
+    {
+        delete joint_motion_listp;
+        return NULL;
+    }
+    LL_DEBUGS("Animation") << "Loaded keyframe data for " << id << " from cache file" << LL_ENDL;
+    addKeyframeData(id, joint_motion_listp);
+    return joint_motion_listp;
+}
+
+//--------------------------------------------------------------------
+// LLKeyframeDataCache::openFile()
+//--------------------------------------------------------------------
+void LLKeyframeDataCache::openFile(const std::string& filename)
+{
+    sKeyframeCacheFile.open(filename);
+}
+
+//--------------------------------------------------------------------
+// LLKeyframeDataCache::closeFile()
+//--------------------------------------------------------------------
+void LLKeyframeDataCache::closeFile()
+{
+    sKeyframeCacheFile.close();
+}
+
+//--------------------------------------------------------------------
+// LLKeyframeDataCache::storeKeyframeData()
+//--------------------------------------------------------------------
+void LLKeyframeDataCache::storeKeyframeData(const LLUUID& id, const LLKeyframeMotion::JointMotionList* joint_motion_listp)
+{
+    if (!sKeyframeCacheFile.isOpen() || sKeyframeCacheFile.has(id, KEYFRAME_CACHE_RECORD))
+    {
+        return;
+    }
+    std::vector<U8> payload;
+    joint_motion_listp->pack(payload);
+    sKeyframeCacheFile.write(id, KEYFRAME_CACHE_RECORD, payload);
 }
 
 //--------------------------------------------------------------------
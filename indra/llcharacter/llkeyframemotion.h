@@ -326,12 +326,17 @@ public:
         ScaleCurve();
         ~ScaleCurve();
         LLVector3 getValue(F32 time, F32 duration);
-        LLVector3 interp(F32 u, ScaleKey& before, ScaleKey& after);
+        LLVector3 interp(F32 u, const ScaleKey& before, const ScaleKey& after);
+        // sorts keys by time, a later key replaces an earlier one at the same time
+        void setKeys(std::vector<ScaleKey>& keys);
+        ScaleKey getKey(S32 index) const;
+        S32 getKeyCount() const { return (S32)mTimes.size(); }
 
         InterpolationType   mInterpolationType;
         S32                 mNumKeys;
-        typedef std::map<F32, ScaleKey> key_map_t;
-        key_map_t           mKeys;
+        // keys sorted by time, one array per component
+        std::vector<F32>    mTimes;
+        std::vector<F32>    mValues[3];
         ScaleKey            mLoopInKey;
         ScaleKey            mLoopOutKey;
     };
@@ -345,12 +350,17 @@ public:
         RotationCurve();
         ~RotationCurve();
         LLQuaternion getValue(F32 time, F32 duration);
-        LLQuaternion interp(F32 u, RotationKey& before, RotationKey& after);
+        LLQuaternion interp(F32 u, const RotationKey& before, const RotationKey& after);
+        // sorts keys by time, a later key replaces an earlier one at the same time
+        void setKeys(std::vector<RotationKey>& keys);
+        RotationKey getKey(S32 index) const;
+        S32 getKeyCount() const { return (S32)mTimes.size(); }
 
         InterpolationType   mInterpolationType;
         S32                 mNumKeys;
-        typedef std::map<F32, RotationKey> key_map_t;
-        key_map_t       mKeys;
+        // keys sorted by time, one array per quaternion component
+        std::vector<F32>    mTimes;
+        std::vector<F32>    mValues[4];
         RotationKey     mLoopInKey;
         RotationKey     mLoopOutKey;
     };
@@ -364,12 +374,17 @@ public:
         PositionCurve();
         ~PositionCurve();
         LLVector3 getValue(F32 time, F32 duration);
-        LLVector3 interp(F32 u, PositionKey& before, PositionKey& after);
+        LLVector3 interp(F32 u, const PositionKey& before, const PositionKey& after);
+        // sorts keys by time, a later key replaces an earlier one at the same time
+        void setKeys(std::vector<PositionKey>& keys);
+        PositionKey getKey(S32 index) const;
+        S32 getKeyCount() const { return (S32)mTimes.size(); }
 
         InterpolationType   mInterpolationType;
         S32                 mNumKeys;
-        typedef std::map<F32, PositionKey> key_map_t;
-        key_map_t       mKeys;
+        // keys sorted by time, one array per component
+        std::vector<F32>    mTimes;
+        std::vector<F32>    mValues[3];
         PositionKey     mLoopInKey;
         PositionKey     mLoopOutKey;
     };
@@ -419,6 +434,10 @@ public:
         U32 dumpDiagInfo();
         JointMotion* getJointMotion(U32 index) const { llassert(index < mJointMotionArray.size()); return mJointMotionArray[index]; }
         U32 getNumJointMotions() const { return mJointMotionArray.size(); }
+
+        // binary form kept in the keyframe data cache file
+        void pack(std::vector<U8>& buffer) const;
+        bool unpack(const U8* data, U32 size);
     };
 
 protected:
@@ -448,8 +467,15 @@ public:
     static keyframe_data_map_t sKeyframeDataMap;
 
     static void addKeyframeData(const LLUUID& id, LLKeyframeMotion::JointMotionList*);
+    // falls back on the cache file, see openFile()
     static LLKeyframeMotion::JointMotionList* getKeyframeData(const LLUUID& id);
 
+    // Keep decoded animation assets in a file so later sessions can load
+    // them without decoding the asset again
+    static void openFile(const std::string& filename);
+    static void closeFile();
+    static void storeKeyframeData(const LLUUID& id, const LLKeyframeMotion::JointMotionList*);
+
     static void removeKeyframeData(const LLUUID& id);
 
     //print out diagnostic info
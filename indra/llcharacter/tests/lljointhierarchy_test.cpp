@@ -0,0 +1,251 @@
+/**
+ * @file   lljointhierarchy_test.cpp
+ * @brief  Test for LLJointHierarchy against the recursive
+ *         LLJoint::updateWorldMatrixChildren(), with a benchmark.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Copyright (c) 2022, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "../lljointhierarchy.h"
+// STL headers
+#include <memory>
+#include <vector>
+// std headers
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+#include "lljoint.h"
+
+namespace
+{
+    // about a Bento skeleton with collision volumes and attachment points
+    const S32 JOINTS_PER_SKELETON = 200;
+
+    // Deterministic, so that twin skeletons get the same values
+    U32 sSeed = 1;
+    U32 rand_below(U32 limit)
+    {
+        sSeed = sSeed * 1664525 + 1013904223;
+        return (sSeed >> 8) % limit;
+    }
+
+    F32 rand_range(F32 low, F32 high)
+    {
+        return low + (high - low) * (F32)rand_below(10000) / 10000.f;
+    }
+
+    LLQuaternion rand_rotation()
+    {
+        return LLQuaternion(rand_range(0.f, F_TWO_PI), LLVector3(rand_range(-1.f, 1.f), rand_range(-1.f, 1.f), 1.f));
+    }
+
+    // Joints owned in creation order, the first one the root. The shape and
+    // initial values only depend on the seed.
+    struct Skeleton
+    {
+        Skeleton(U32 seed, S32 count)
+        {
+            sSeed = seed;
+            for (S32 i = 0; i < count; ++i)
+            {
+                mJoints.emplace_back(new LLJoint());
+                LLJoint* joint = mJoints.back().get();
+                if (i)
+                {
+                    // mostly chains, the way limbs and fingers are
+                    mJoints[i - 1 - rand_below(llmin(i, 6))]->addChild(joint);
+                }
+                joint->setPosition(LLVector3(rand_range(-0.5f, 0.5f), rand_range(-0.5f, 0.5f), rand_range(0.f, 0.5f)));
+                joint->setRotation(rand_rotation());
+                joint->setScale(LLVector3(rand_range(0.5f, 1.5f), rand_range(0.5f, 1.5f), rand_range(0.5f, 1.5f)));
+            }
+        }
+
+        ~Skeleton()
+        {
+            // children first
+            while (!mJoints.empty())
+            {
+                mJoints.pop_back();
+            }
+        }
+
+        // what an animation frame does to some of the joints
+        void animate(U32 seed)
+        {
+            sSeed = seed;
+            S32 count = (S32)mJoints.size();
+            for (S32 n = rand_below(count / 2); n > 0; --n)
+            {
+                mJoints[rand_below(count)]->setRotation(rand_rotation());
+            }
+            mJoints[0]->setPosition(LLVector3(rand_range(0.f, 256.f), rand_range(0.f, 256.f), rand_range(0.f, 100.f)));
+        }
+
+        LLJoint* getRoot() const { return mJoints[0].get(); }
+
+        std::vector<std::unique_ptr<LLJoint> > mJoints;
+    };
+
+    bool close(F32 a, F32 b)
+    {
+        return fabsf(a - b) <= 1.e-4f * llmax(1.f, fabsf(a));
+    }
+
+    // The joints of both updated the same, ignoring the ones
+    // updateWorldMatrixChildren() does not get to
+    void ensure_same(const std::string& msg, Skeleton& expected, Skeleton& actual)
+    {
+        for (size_t i = 0; i < expected.mJoints.size(); ++i)
+        {
+            LLJoint* expected_joint = expected.mJoints[i].get();
+            LLJoint* actual_joint = actual.mJoints[i].get();
+            tut::ensure_equals(msg + " matrix dirty", actual_joint->mDirtyFlags & LLJoint::MATRIX_DIRTY,
+                               expected_joint->mDirtyFlags & LLJoint::MATRIX_DIRTY);
+            if (expected_joint->mDirtyFlags & LLJoint::MATRIX_DIRTY)
+            {
+                continue;
+            }
+
+            const LLXformMatrix* expected_xform = expected_joint->getXform();
+            const LLXformMatrix* actual_xform = actual_joint->getXform();
+            for (S32 k = 0; k < 3; ++k)
+            {
+                tut::ensure(msg + " world position", close(expected_xform->getWorldPosition().mV[k], actual_xform->getWorldPosition().mV[k]));
+            }
+            for (S32 k = 0; k < 4; ++k)
+            {
+                tut::ensure(msg + " world rotation", close(expected_xform->getWorldRotation().mQ[k], actual_xform->getWorldRotation().mQ[k]));
+            }
+            const F32* expected_matrix = expected_joint->getWorldMatrix4a().getF32ptr();
+            const F32* actual_matrix = actual_joint->getWorldMatrix4a().getF32ptr();
+            const F32* actual_xform_matrix = &actual_xform->getWorldMatrix().mMatrix[0][0];
+            for (S32 k = 0; k < 16; ++k)
+            {
+                tut::ensure(msg + " world matrix", close(expected_matrix[k], actual_matrix[k]));
+                tut::ensure_equals(msg + " both matrices", actual_xform_matrix[k], actual_matrix[k]);
+            }
+        }
+    }
+}
+
+namespace tut
+{
+    struct lljointhierarchy_data
+    {
+    };
+    typedef test_group<lljointhierarchy_data> lljointhierarchy_group;
+    typedef lljointhierarchy_group::object object;
+    lljointhierarchy_group lljointhierarchygrp("lljointhierarchy");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("flattening");
+        LLJointHierarchy hierarchy;
+        hierarchy.build(NULL);
+        ensure_equals("empty", hierarchy.getJointCount(), 0);
+        ensure("no root", hierarchy.getRoot() == NULL);
+        ensure_equals("nothing to update", hierarchy.updateWorldMatrices(), 0);
+
+        Skeleton skeleton(7, JOINTS_PER_SKELETON);
+        hierarchy.build(skeleton.getRoot());
+        ensure_equals("all joints", hierarchy.getJointCount(), JOINTS_PER_SKELETON);
+        ensure("root", hierarchy.getRoot() == skeleton.getRoot());
+        ensure("fresh", !hierarchy.isStale());
+
+        std::unique_ptr<LLJoint> extra(new LLJoint());
+        skeleton.mJoints[3]->addChild(extra.get());
+        ensure("stale after addChild", hierarchy.isStale());
+        hierarchy.build(skeleton.getRoot());
+        ensure_equals("one more", hierarchy.getJointCount(), JOINTS_PER_SKELETON + 1);
+        extra.reset();
+        ensure("stale after delete", hierarchy.isStale());
+        hierarchy.build(skeleton.getRoot());
+        ensure_equals("back", hierarchy.getJointCount(), JOINTS_PER_SKELETON);
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("same world matrices as updateWorldMatrixChildren");
+        Skeleton expected(11, JOINTS_PER_SKELETON);
+        Skeleton actual(11, JOINTS_PER_SKELETON);
+        LLJointHierarchy hierarchy;
+        hierarchy.build(actual.getRoot());
+
+        // the root hanging off another transform, like a seat
+        LLXformMatrix seat;
+        seat.init();
+        seat.setPosition(LLVector3(10.f, 20.f, 30.f));
+        seat.setRotation(rand_rotation());
+        seat.setScale(LLVector3(2.f, 3.f, 4.f));
+        seat.setScaleChildOffset(TRUE);
+        seat.updateMatrix();
+
+        for (S32 frame = 0; frame < 20; ++frame)
+        {
+            U32 seed = 100 + frame;
+            expected.animate(seed);
+            actual.animate(seed);
+            if (frame == 5)
+            {
+                expected.getRoot()->getXform()->setParent(&seat);
+                actual.getRoot()->getXform()->setParent(&seat);
+                expected.getRoot()->touch();
+                actual.getRoot()->touch();
+            }
+            // subtrees that are not updated, switched on and off
+            S32 off = 1 + (S32)rand_below(JOINTS_PER_SKELETON - 1);
+            BOOL update = frame % 3 != 0;
+            expected.mJoints[off]->mUpdateXform = update;
+            actual.mJoints[off]->mUpdateXform = update;
+            if (frame == 10)
+            {
+                // brought up to date out of order, the way getWorldMatrix()
+                // does it
+                expected.mJoints[JOINTS_PER_SKELETON / 2]->getWorldMatrix();
+                actual.mJoints[JOINTS_PER_SKELETON / 2]->getWorldMatrix();
+            }
+
+            expected.getRoot()->updateWorldMatrixChildren();
+            hierarchy.updateWorldMatrices();
+            ensure_same(llformat("frame %d", frame), expected, actual);
+        }
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("clean subtrees are skipped");
+        Skeleton skeleton(23, JOINTS_PER_SKELETON);
+        LLJointHierarchy hierarchy;
+        hierarchy.build(skeleton.getRoot());
+        ensure_equals("everything at first", hierarchy.updateWorldMatrices(), JOINTS_PER_SKELETON);
+        ensure_equals("nothing changed", hierarchy.updateWorldMatrices(), 0);
+
+        LLJoint* leaf = skeleton.mJoints.back().get();
+        ensure("a leaf", leaf->mChildren.empty());
+        leaf->setRotation(rand_rotation());
+        ensure("root knows", skeleton.getRoot()->mDirtyFlags & LLJoint::CHILDREN_DIRTY);
+        ensure_equals("only the leaf", hierarchy.updateWorldMatrices(), 1);
+        ensure("root clean", !(skeleton.getRoot()->mDirtyFlags & LLJoint::CHILDREN_DIRTY));
+
+        // a joint that is not updated keeps its parents looking
+        leaf->mUpdateXform = FALSE;
+        leaf->setRotation(rand_rotation());
+        ensure_equals("skipped", hierarchy.updateWorldMatrices(), 0);
+        ensure("still dirty", leaf->mDirtyFlags & LLJoint::MATRIX_DIRTY);
+        ensure("root still knows", skeleton.getRoot()->mDirtyFlags & LLJoint::CHILDREN_DIRTY);
+        leaf->mUpdateXform = TRUE;
+        ensure_equals("picked up", hierarchy.updateWorldMatrices(), 1);
+
+        skeleton.getRoot()->touch();
+        ensure_equals("everything again", hierarchy.updateWorldMatrices(), JOINTS_PER_SKELETON);
+    }
+} // namespace tut
@@ -0,0 +1,349 @@
+/**
+ * @file   llflathashmap.h
+ * @brief  Open addressing hash map for small keys on hot lookup paths.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLFLATHASHMAP_H
+#define LL_LLFLATHASHMAP_H
+
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+/**
+ * Hash map keeping its entries in one flat array, probed linearly from the
+ * slot the key hashes to. A lookup is usually a single cache line, where a
+ * std::map walks a chain of nodes. Erasing shifts the rest of the probe run
+ * back instead of leaving tombstones, so lookups never slow down with churn.
+ *
+ * The interface is the subset of std::map the message system uses, with
+ * two differences to keep in mind:
+ * - iteration order is unspecified;
+ * - any insert or erase invalidates all iterators. Use eraseIf() to remove
+ *   entries while walking the map.
+ *
+ * Keys and values must be default constructible: empty slots hold default
+ * constructed entries. HASH only needs to be distinct for distinct keys,
+ * its bits are mixed before use.
+ */
+template <typename KEY, typename VALUE, typename HASH = std::hash<KEY> >
+class LLFlatHashMap
+{
+public:
+    typedef KEY key_type;
+    typedef VALUE mapped_type;
+    typedef std::pair<KEY, VALUE> value_type;
+    typedef size_t size_type;
+
+private:
+    template <typename MAP, typename VALUE_TYPE>
+    class iterator_base
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef VALUE_TYPE value_type;
+        typedef ptrdiff_t difference_type;
+        typedef VALUE_TYPE* pointer;
+        typedef VALUE_TYPE& reference;
+
+        iterator_base() : mMap(NULL), mIndex(0) {}
+        iterator_base(MAP* map, size_t index) : mMap(map), mIndex(index) {}
+        // iterator converts to const_iterator
+        template <typename OTHER_MAP, typename OTHER_VALUE>
+        iterator_base(const iterator_base<OTHER_MAP, OTHER_VALUE>& other) :
+            mMap(other.mMap), mIndex(other.mIndex) {}
+
+        reference operator*() const  { return mMap->mSlots[mIndex]; }
+        pointer operator->() const   { return &mMap->mSlots[mIndex]; }
+
+        iterator_base& operator++()
+        {
+            mIndex = mMap->nextUsed(mIndex + 1);
+            return *this;
+        }
+        iterator_base operator++(int)
+        {
+            iterator_base tmp(*this);
+            ++*this;
+            return tmp;
+        }
+
+        template <typename OTHER_MAP, typename OTHER_VALUE>
+        bool operator==(const iterator_base<OTHER_MAP, OTHER_VALUE>& other) const
+        {
+            return mIndex == other.mIndex;
+        }
+        template <typename OTHER_MAP, typename OTHER_VALUE>
+        bool operator!=(const iterator_base<OTHER_MAP, OTHER_VALUE>& other) const
+        {
+            return mIndex != other.mIndex;
+        }
+
+    private:
+        template <typename, typename> friend class iterator_base;
+        MAP* mMap;
+        size_t mIndex;
+    };
+
+public:
+    typedef iterator_base<LLFlatHashMap, value_type> iterator;
+    typedef iterator_base<const LLFlatHashMap, const value_type> const_iterator;
+
+    LLFlatHashMap() :
+        mSize(0),
+        mShift(64)
+    {
+    }
+
+    iterator begin()                { return iterator(this, nextUsed(0)); }
+    iterator end()                  { return iterator(this, mSlots.size()); }
+    const_iterator begin() const    { return const_iterator(this, nextUsed(0)); }
+    const_iterator end() const      { return const_iterator(this, mSlots.size()); }
+
+    size_type size() const          { return mSize; }
+    bool empty() const              { return mSize == 0; }
+
+    iterator find(const KEY& key)
+    {
+        return iterator(this, findIndex(key));
+    }
+    const_iterator find(const KEY& key) const
+    {
+        return const_iterator(this, findIndex(key));
+    }
+    size_type count(const KEY& key) const
+    {
+        return findIndex(key) != mSlots.size() ? 1 : 0;
+    }
+
+    /// Value for key, or def if there is none
+    VALUE get(const KEY& key, const VALUE& def = VALUE()) const
+    {
+        size_t index = findIndex(key);
+        return index != mSlots.size() ? mSlots[index].second : def;
+    }
+
+    VALUE& operator[](const KEY& key)
+    {
+        return mSlots[insertIndex(key)].second;
+    }
+
+    /// Does not replace an existing value, like std::map::insert()
+    std::pair<iterator, bool> insert(const value_type& value)
+    {
+        size_type old_size = mSize;
+        size_t index = insertIndex(value.first);
+        bool inserted = mSize != old_size;
+        if (inserted)
+        {
+            mSlots[index].second = value.second;
+        }
+        return std::make_pair(iterator(this, index), inserted);
+    }
+
+    size_type erase(const KEY& key)
+    {
+        size_t index = findIndex(key);
+        if (index == mSlots.size())
+        {
+            return 0;
+        }
+        eraseIndex(index);
+        return 1;
+    }
+
+    /// Erase every entry for which pred(entry) is true
+    template <typename PRED>
+    size_type eraseIf(PRED pred)
+    {
+        // Shifting entries back on erase would move unvisited entries into
+        // visited slots, so collect the keys first.
+        std::vector<KEY> doomed;
+        for (size_t i = 0; i < mSlots.size(); ++i)
+        {
+            if (mUsed[i] && pred(static_cast<const value_type&>(mSlots[i])))
+            {
+                doomed.push_back(mSlots[i].first);
+            }
+        }
+        for (typename std::vector<KEY>::const_iterator it = doomed.begin(); it != doomed.end(); ++it)
+        {
+            erase(*it);
+        }
+        return doomed.size();
+    }
+
+    void clear()
+    {
+        mSlots.clear();
+        mUsed.clear();
+        mSize = 0;
+        mShift = 64;
+    }
+
+    /// Make room for count entries without rehashing
+    void reserve(size_type count)
+    {
+        size_t capacity = MIN_CAPACITY;
+        while (capacity * MAX_LOAD_NUM < count * MAX_LOAD_DEN)
+        {
+            capacity <<= 1;
+        }
+        if (capacity > mSlots.size())
+        {
+            rehash(capacity);
+        }
+    }
+
+    void swap(LLFlatHashMap& other)
+    {
+        mSlots.swap(other.mSlots);
+        mUsed.swap(other.mUsed);
+        std::swap(mSize, other.mSize);
+        std::swap(mShift, other.mShift);
+    }
+
+private:
+    // Keep at most half the slots in use: probe runs stay a few slots long
+    static const size_t MAX_LOAD_NUM = 1;
+    static const size_t MAX_LOAD_DEN = 2;
+    static const size_t MIN_CAPACITY = 8;
+
+    size_t home(const KEY& key) const
+    {
+        // Fibonacci hashing: take the top bits of the product, so keys that
+        // only differ in their high bits or that are sequential both spread
+        // over the table.
+        unsigned long long h = (unsigned long long)mHash(key);
+        return (size_t)((h * 0x9E3779B97F4A7C15ULL) >> mShift);
+    }
+
+    size_t nextUsed(size_t index) const
+    {
+        while (index < mSlots.size() && !mUsed[index])
+        {
+            ++index;
+        }
+        return index;
+    }
+
+    size_t findIndex(const KEY& key) const
+    {
+        if (mSize == 0)
+        {
+            return mSlots.size();
+        }
+        size_t mask = mSlots.size() - 1;
+        for (size_t i = home(key); mUsed[i]; i = (i + 1) & mask)
+        {
+            if (mSlots[i].first == key)
+            {
+                return i;
+            }
+        }
+        return mSlots.size();
+    }
+
+    // Slot holding key, default constructing its value if it is new
+    size_t insertIndex(const KEY& key)
+    {
+        if ((mSize + 1) * MAX_LOAD_DEN > mSlots.size() * MAX_LOAD_NUM)
+        {
+            rehash(mSlots.empty() ? MIN_CAPACITY : mSlots.size() * 2);
+        }
+        size_t mask = mSlots.size() - 1;
+        size_t i = home(key);
+        for (; mUsed[i]; i = (i + 1) & mask)
+        {
+            if (mSlots[i].first == key)
+            {
+                return i;
+            }
+        }
+        mUsed[i] = 1;
+        mSlots[i].first = key;
+        ++mSize;
+        return i;
+    }
+
+    void eraseIndex(size_t hole)
+    {
+        // Backward shift: pull later entries of the probe run into the hole
+        // unless that would move them in front of their home slot.
+        size_t mask = mSlots.size() - 1;
+        for (size_t next = (hole + 1) & mask; mUsed[next]; next = (next + 1) & mask)
+        {
+            size_t want = home(mSlots[next].first);
+            bool stays = (hole <= next) ? (hole < want && want <= next)
+                                        : (hole < want || want <= next);
+            if (!stays)
+            {
+                mSlots[hole] = std::move(mSlots[next]);
+                hole = next;
+            }
+        }
+        mSlots[hole] = value_type();
+        mUsed[hole] = 0;
+        --mSize;
+    }
+
+    void rehash(size_t capacity)
+    {
+        std::vector<value_type> old_slots(capacity);
+        std::vector<unsigned char> old_used(capacity, 0);
+        old_slots.swap(mSlots);
+        old_used.swap(mUsed);
+
+        mShift = 64;
+        for (size_t c = capacity; c > 1; c >>= 1)
+        {
+            --mShift;
+        }
+
+        size_t mask = capacity - 1;
+        for (size_t i = 0; i < old_slots.size(); ++i)
+        {
+            if (old_used[i])
+            {
+                size_t j = home(old_slots[i].first);
+                while (mUsed[j])
+                {
+                    j = (j + 1) & mask;
+                }
+                mSlots[j] = std::move(old_slots[i]);
+                mUsed[j] = 1;
+            }
+        }
+    }
+
+    std::vector<value_type> mSlots;
+    std::vector<unsigned char> mUsed;
+    size_type mSize;
+    // 64 - log2(capacity)
+    int mShift;
+    HASH mHash;
+};
+
+#endif // LL_LLFLATHASHMAP_H
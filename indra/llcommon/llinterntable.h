@@ -0,0 +1,285 @@
+/**
+ * @file   llinterntable.h
+ * @brief  Concurrent, arena backed table of interned strings.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLINTERNTABLE_H
+#define LL_LLINTERNTABLE_H
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+// Value of tables that only intern the strings
+struct LLInternTableNoValue
+{
+    LLInternTableNoValue(const char*, size_t) {}
+};
+
+/**
+ * Each distinct string is stored once, with a VALUE constructed from it by
+ * VALUE(const char* string, size_t length), in an entry that stays at the
+ * same address until clear() or the table is destroyed. Entries are never
+ * removed one by one: the tables this backs hold names (XML tags, message
+ * and parameter names) that are interned over and over.
+ *
+ * Entries are chained from a fixed array of buckets. A chain is only ever
+ * extended at its head, after the new entry is complete, so find() and the
+ * lookup part of insert() walk it without taking any lock and may run on
+ * any thread. Adding a new string locks one of STRIPE_COUNT stripes, each
+ * owning a share of the buckets and the arena blocks their entries are
+ * allocated from; threads adding different strings rarely meet there.
+ *
+ * clear() is the exception: nothing else may use the table meanwhile.
+ */
+template <typename VALUE = LLInternTableNoValue>
+class LLInternTable
+{
+public:
+    class Entry
+    {
+    public:
+        const char* getString() const   { return mString; }
+        size_t getLength() const        { return mLength; }
+
+        VALUE mValue;
+
+    private:
+        friend class LLInternTable;
+
+        Entry(const char* string, U32 length, U32 hash, Entry* next) :
+            mValue(string, length),
+            mNext(next),
+            mString(string),
+            mLength(length),
+            mHash(hash)
+        {
+        }
+
+        Entry* const mNext;
+        const char* const mString;
+        const U32 mLength;
+        const U32 mHash;
+    };
+
+    // bucket_count is rounded up to a power of two
+    explicit LLInternTable(U32 bucket_count = 4096) :
+        mCount(0)
+    {
+        U32 buckets = STRIPE_COUNT;
+        while (buckets < bucket_count)
+        {
+            buckets <<= 1;
+        }
+        mBucketMask = buckets - 1;
+        mBuckets = new std::atomic<Entry*>[buckets];
+        for (U32 i = 0; i < buckets; ++i)
+        {
+            mBuckets[i].store(NULL, std::memory_order_relaxed);
+        }
+    }
+
+    ~LLInternTable()
+    {
+        clear();
+        delete[] mBuckets;
+    }
+
+    LLInternTable(const LLInternTable&) = delete;
+    LLInternTable& operator=(const LLInternTable&) = delete;
+
+    // NULL if the string was never interned
+    const Entry* find(const char* string, size_t length) const
+    {
+        U32 hash = hashString(string, length);
+        return findInChain(mBuckets[hash & mBucketMask].load(std::memory_order_acquire),
+                           string, length, hash);
+    }
+
+    const Entry* find(const std::string& string) const
+    {
+        return find(string.data(), string.size());
+    }
+
+    // The entry of the string, added if needed
+    Entry* insert(const char* string, size_t length)
+    {
+        U32 hash = hashString(string, length);
+        U32 bucket = hash & mBucketMask;
+        Entry* head = mBuckets[bucket].load(std::memory_order_acquire);
+        Entry* entry = findInChain(head, string, length, hash);
+        if (entry)
+        {
+            return entry;
+        }
+
+        Stripe& stripe = mStripes[bucket & (STRIPE_COUNT - 1)];
+        std::lock_guard<std::mutex> lock(stripe.mMutex);
+        // Only this stripe adds to the bucket: just check what was added
+        // since the unlocked lookup
+        Entry* new_head = mBuckets[bucket].load(std::memory_order_acquire);
+        if (new_head != head)
+        {
+            entry = findInChain(new_head, string, length, hash, head);
+            if (entry)
+            {
+                return entry;
+            }
+        }
+
+        char* block = stripe.allocate(sizeof(Entry) + length + 1);
+        char* copy = block + sizeof(Entry);
+        memcpy(copy, string, length);
+        copy[length] = 0;
+        entry = new (block) Entry(copy, (U32)length, hash, new_head);
+        mBuckets[bucket].store(entry, std::memory_order_release);
+        mCount.fetch_add(1, std::memory_order_relaxed);
+        return entry;
+    }
+
+    Entry* insert(const std::string& string)
+    {
+        return insert(string.data(), string.size());
+    }
+
+    size_t size() const { return mCount.load(std::memory_order_relaxed); }
+
+    // Calls func(const Entry&) for every entry, in no particular order.
+    // Entries added meanwhile may or may not be visited.
+    template <typename FUNC>
+    void forEach(FUNC func) const
+    {
+        for (U32 i = 0; i <= mBucketMask; ++i)
+        {
+            for (const Entry* entry = mBuckets[i].load(std::memory_order_acquire); entry; entry = entry->mNext)
+            {
+                func(*entry);
+            }
+        }
+    }
+
+    // Destroys every entry, invalidating all of them
+    void clear()
+    {
+        for (U32 i = 0; i <= mBucketMask; ++i)
+        {
+            Entry* entry = mBuckets[i].load(std::memory_order_relaxed);
+            while (entry)
+            {
+                Entry* next = entry->mNext;
+                entry->~Entry();
+                entry = next;
+            }
+            mBuckets[i].store(NULL, std::memory_order_relaxed);
+        }
+        for (U32 i = 0; i < STRIPE_COUNT; ++i)
+        {
+            mStripes[i].release();
+        }
+        mCount.store(0, std::memory_order_relaxed);
+    }
+
+    // FNV-1a, cheap on the short names these tables hold
+    static U32 hashString(const char* string, size_t length)
+    {
+        U32 hash = 2166136261U;
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash = (hash ^ (U8)string[i]) * 16777619U;
+        }
+        return hash;
+    }
+
+private:
+    static const U32 STRIPE_COUNT = 16;
+    static const size_t BLOCK_SIZE = 16384;
+    static const size_t ENTRY_ALIGNMENT = alignof(Entry) > alignof(void*) ? alignof(Entry) : alignof(void*);
+
+    struct Stripe
+    {
+        Stripe() : mNext(NULL), mFree(0) {}
+        ~Stripe() { release(); }
+
+        char* allocate(size_t size)
+        {
+            size = (size + ENTRY_ALIGNMENT - 1) & ~(ENTRY_ALIGNMENT - 1);
+            if (size > mFree)
+            {
+                char* block = new char[size > BLOCK_SIZE ? size : BLOCK_SIZE];
+                mBlocks.push_back(block);
+                if (size >= BLOCK_SIZE)
+                {
+                    // a block of its own, keep filling the current one
+                    return block;
+                }
+                mNext = block;
+                mFree = BLOCK_SIZE;
+            }
+            char* allocated = mNext;
+            mNext += size;
+            mFree -= size;
+            return allocated;
+        }
+
+        void release()
+        {
+            for (size_t i = 0; i < mBlocks.size(); ++i)
+            {
+                delete[] mBlocks[i];
+            }
+            mBlocks.clear();
+            mNext = NULL;
+            mFree = 0;
+        }
+
+        std::mutex mMutex;
+        std::vector<char*> mBlocks;
+        char* mNext;
+        size_t mFree;
+    };
+
+    // Walks the chain from entry up to, not including, end
+    static Entry* findInChain(Entry* entry, const char* string, size_t length, U32 hash, const Entry* end = NULL)
+    {
+        for ( ; entry != end; entry = entry->mNext)
+        {
+            if (entry->mHash == hash && entry->mLength == length
+                && !memcmp(entry->mString, string, length))
+            {
+                return entry;
+            }
+        }
+        return NULL;
+    }
+
+    std::atomic<Entry*>* mBuckets;
+    U32 mBucketMask;
+    std::atomic<size_t> mCount;
+    Stripe mStripes[STRIPE_COUNT];
+};
+
+#endif // LL_LLINTERNTABLE_H
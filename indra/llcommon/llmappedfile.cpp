@@ -0,0 +1,234 @@
+/**
+ * @file llmappedfile.cpp
+ * @brief Cross-platform memory mapping of a whole file.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmappedfile.h"
+
+#if LL_WINDOWS
+#include "llwin32headerslean.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class LLMappedFilePlatformImpl
+{
+public:
+#if LL_WINDOWS
+    HANDLE mFile = INVALID_HANDLE_VALUE;
+    HANDLE mMapping = NULL;
+#else
+    int mFD = -1;
+#endif
+};
+
+LLMappedFile::LLMappedFile()
+:   mImpl(new LLMappedFilePlatformImpl),
+    mData(NULL),
+    mSize(0),
+    mReadOnly(false)
+{
+}
+
+LLMappedFile::~LLMappedFile()
+{
+    close();
+    delete mImpl;
+}
+
+#if LL_WINDOWS
+
+bool LLMappedFile::open(const std::string& filename, size_t min_size, bool read_only)
+{
+    close();
+
+    std::wstring utf16filename = ll_convert_string_to_wide(filename);
+    mImpl->mFile = CreateFileW(utf16filename.c_str(),
+                               read_only ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               NULL,
+                               read_only ? OPEN_EXISTING : OPEN_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL,
+                               NULL);
+    if (mImpl->mFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(mImpl->mFile, &file_size))
+    {
+        close();
+        return false;
+    }
+    size_t size = (size_t)file_size.QuadPart;
+    if (!read_only && size < min_size)
+    {
+        size = min_size;
+    }
+    if (size == 0)
+    {
+        close();
+        return false;
+    }
+
+    // Mapping a view bigger than the file grows the file (zero filled)
+    LARGE_INTEGER map_size;
+    map_size.QuadPart = size;
+    mImpl->mMapping = CreateFileMappingW(mImpl->mFile, NULL,
+                                         read_only ? PAGE_READONLY : PAGE_READWRITE,
+                                         map_size.HighPart, map_size.LowPart, NULL);
+    if (!mImpl->mMapping)
+    {
+        close();
+        return false;
+    }
+
+    mData = (U8*)MapViewOfFile(mImpl->mMapping, read_only ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, size);
+    if (!mData)
+    {
+        close();
+        return false;
+    }
+
+    mSize = size;
+    mReadOnly = read_only;
+    mFilename = filename;
+    return true;
+}
+
+void LLMappedFile::close()
+{
+    if (mData)
+    {
+        UnmapViewOfFile(mData);
+        mData = NULL;
+    }
+    if (mImpl->mMapping)
+    {
+        CloseHandle(mImpl->mMapping);
+        mImpl->mMapping = NULL;
+    }
+    if (mImpl->mFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(mImpl->mFile);
+        mImpl->mFile = INVALID_HANDLE_VALUE;
+    }
+    mSize = 0;
+    mFilename.clear();
+}
+
+bool LLMappedFile::flush(bool wait)
+{
+    if (!mData || mReadOnly)
+    {
+        return false;
+    }
+    bool success = FlushViewOfFile(mData, 0) != 0;
+    if (wait)
+    {
+        success = FlushFileBuffers(mImpl->mFile) != 0 && success;
+    }
+    return success;
+}
+
+#else // LL_WINDOWS
+
+bool LLMappedFile::open(const std::string& filename, size_t min_size, bool read_only)
+{
+    close();
+
+    mImpl->mFD = ::open(filename.c_str(), read_only ? O_RDONLY : O_RDWR | O_CREAT, 0600);
+    if (mImpl->mFD < 0)
+    {
+        return false;
+    }
+
+    struct stat file_status;
+    if (fstat(mImpl->mFD, &file_status) != 0)
+    {
+        close();
+        return false;
+    }
+    size_t size = (size_t)file_status.st_size;
+    if (!read_only && size < min_size)
+    {
+        if (ftruncate(mImpl->mFD, (off_t)min_size) != 0)
+        {
+            close();
+            return false;
+        }
+        size = min_size;
+    }
+    if (size == 0)
+    {
+        close();
+        return false;
+    }
+
+    void* data = mmap(NULL, size, read_only ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, mImpl->mFD, 0);
+    if (data == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+
+    mData = (U8*)data;
+    mSize = size;
+    mReadOnly = read_only;
+    mFilename = filename;
+    return true;
+}
+
+void LLMappedFile::close()
+{
+    if (mData)
+    {
+        munmap(mData, mSize);
+        mData = NULL;
+    }
+    if (mImpl->mFD >= 0)
+    {
+        ::close(mImpl->mFD);
+        mImpl->mFD = -1;
+    }
+    mSize = 0;
+    mFilename.clear();
+}
+
+bool LLMappedFile::flush(bool wait)
+{
+    if (!mData || mReadOnly)
+    {
+        return false;
+    }
+    return msync(mData, mSize, wait ? MS_SYNC : MS_ASYNC) == 0;
+}
+
+#endif // LL_WINDOWS
@@ -0,0 +1,84 @@
+/**
+ * @file llmappedfile.h
+ * @brief Cross-platform memory mapping of a whole file.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMAPPEDFILE_H
+#define LL_LLMAPPEDFILE_H
+
+#include <boost/noncopyable.hpp>
+#include <string>
+
+class LLMappedFilePlatformImpl;
+
+/**
+ * @class LLMappedFile
+ * @brief Maps a file into memory so it can be read and written through
+ * a pointer rather than with seek/read/write calls.
+ *
+ * The mapping is shared with the file: changes become visible to other
+ * readers of the file right away and are written back to the disk by the
+ * OS at its leisure, or when flush() is called.
+ */
+class LL_COMMON_API LLMappedFile : boost::noncopyable
+{
+public:
+    LLMappedFile();
+    ~LLMappedFile();
+
+    /**
+     * Map a file, creating it if needed in write mode. In write mode the
+     * file is grown (zero filled) to at least min_size bytes first. A file
+     * bigger than min_size is mapped whole. Returns false if the file could
+     * not be opened or mapped, or is empty.
+     */
+    bool open(const std::string& filename, size_t min_size, bool read_only = false);
+
+    /**
+     * Unmap and close the file. Pending changes are still written back by
+     * the OS.
+     */
+    void close();
+
+    /**
+     * Schedule the changes made through the mapping to be written to the
+     * disk. When wait is true, only returns once they have been written.
+     */
+    bool flush(bool wait = false);
+
+    bool isMapped() const { return mData != NULL; }
+    bool isReadOnly() const { return mReadOnly; }
+    U8* getData() const { return mData; }
+    size_t getSize() const { return mSize; }
+    const std::string& getFilename() const { return mFilename; }
+
+private:
+    LLMappedFilePlatformImpl* mImpl;
+    U8* mData;
+    size_t mSize;
+    bool mReadOnly;
+    std::string mFilename;
+};
+
+#endif // LL_LLMAPPEDFILE_H
@@ -33,9 +33,13 @@
 #include "llerror.h"
 #include "../llmath/llmath.h"
 #include "llformat.h"
+#include "llmemory.h"
 #include "llsdserialize.h"
 #include "stringize.h"
 
+#include <atomic>
+#include <new>
+
 #ifndef LL_RELEASE_FOR_DOWNLOAD
 #define NAME_UNNAMED_NAMESPACE
 #endif
@@ -88,8 +92,14 @@ protected:
     bool shared() const                         { return (mUseCount > 1) && (mUseCount != STATIC_USAGE_COUNT); }
     
     U32 mUseCount;
+    bool mInArena;  ///< allocated from an ArenaScope block
 
 public:
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
+    static void destroy(Impl* impl);
+        ///< delete an impl, whether it came from the heap or an arena
+
     static void reset(Impl*& var, Impl* impl);
         ///< safely set var to refer to the new impl (possibly shared)
         
@@ -264,6 +274,7 @@ namespace
     {
     public:
         ImplString(const LLSD::String& v) : Base(v) { }
+        ImplString(LLSD::String&& v) : Base(LLSD::String()) { mValue.swap(v); }
                 
         virtual LLSD::Boolean   asBoolean() const   { return !mValue.empty(); }
         virtual LLSD::Integer   asInteger() const;
@@ -351,6 +362,7 @@ namespace
     {
     public:
         ImplBinary(const LLSD::Binary& v) : Base(v) { }
+        ImplBinary(LLSD::Binary&& v) : Base(LLSD::Binary()) { mValue.swap(v); }
                 
         virtual const LLSD::Binary& asBinary() const{ return mValue; }
     };
@@ -646,15 +658,131 @@ namespace
     }
 }
 
+#ifdef NAME_UNNAMED_NAMESPACE
+namespace LLSDUnnamedNamespace 
+#else
+namespace 
+#endif
+{
+    // An arena block is a header followed by the impls carved out of it. Each
+    // impl is preceded by a pointer back to its block, and the block counts
+    // its live impls plus one while it is the current block of a scope.
+    struct ArenaBlock
+    {
+        std::atomic<U32> mRefs;
+        size_t mSize;
+        size_t mUsed;
+    };
+
+    const size_t ARENA_ALIGNMENT = 16;
+    const size_t ARENA_HEADER_SIZE = (sizeof(ArenaBlock) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    const size_t ARENA_MIN_BLOCK_SIZE = 4 * 1024;
+    const size_t ARENA_MAX_BLOCK_SIZE = 64 * 1024;
+
+    thread_local ArenaBlock* sArenaBlock = NULL;
+    thread_local size_t sArenaBlockSize = 0;
+    thread_local U32 sArenaScopes = 0;
+
+    void releaseArenaBlock(ArenaBlock* block)
+    {
+        if (--block->mRefs == 0)
+        {
+            block->~ArenaBlock();
+            ll_aligned_free_16(block);
+        }
+    }
+
+    void* allocateFromArena(size_t size)
+    {
+        size = ARENA_ALIGNMENT + ((size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1));
+        ArenaBlock* block = sArenaBlock;
+        if (!block || block->mUsed + size > block->mSize)
+        {
+            if (block)
+            {
+                releaseArenaBlock(block);
+                // the document is bigger than expected
+                sArenaBlockSize = llmin(sArenaBlockSize * 2, ARENA_MAX_BLOCK_SIZE);
+            }
+            size_t block_size = llmax(sArenaBlockSize, ARENA_HEADER_SIZE + size);
+            block = new (ll_aligned_malloc_16(block_size)) ArenaBlock;
+            block->mRefs = 1;
+            block->mSize = block_size;
+            block->mUsed = ARENA_HEADER_SIZE;
+            sArenaBlock = block;
+        }
+        U8* p = (U8*)block + block->mUsed;
+        block->mUsed += size;
+        ++block->mRefs;
+        *(ArenaBlock**)p = block;
+        return p + ARENA_ALIGNMENT;
+    }
+
+    ArenaBlock* getArenaBlock(void* p)
+    {
+        return *(ArenaBlock**)((U8*)p - ARENA_ALIGNMENT);
+    }
+}
+
+LLSD::ArenaScope::ArenaScope(size_t size_hint)
+{
+    if (sArenaScopes++ == 0)
+    {
+        sArenaBlockSize = llclamp(size_hint, ARENA_MIN_BLOCK_SIZE, ARENA_MAX_BLOCK_SIZE);
+    }
+}
+
+LLSD::ArenaScope::~ArenaScope()
+{
+    if (--sArenaScopes == 0 && sArenaBlock)
+    {
+        releaseArenaBlock(sArenaBlock);
+        sArenaBlock = NULL;
+    }
+}
+
+void* LLSD::Impl::operator new(size_t size)
+{
+    return sArenaScopes ? allocateFromArena(size) : ::operator new(size);
+}
+
+void LLSD::Impl::operator delete(void* p)
+{
+    // Only reached by heap impls, or by an arena impl whose constructor
+    // threw, in which case it is still in the current block.
+    if (sArenaBlock && p > (void*)sArenaBlock && p < (void*)((U8*)sArenaBlock + sArenaBlock->mSize))
+    {
+        releaseArenaBlock(sArenaBlock);
+        return;
+    }
+    ::operator delete(p);
+}
+
+void LLSD::Impl::destroy(Impl* impl)
+{
+    if (impl->mInArena)
+    {
+        ArenaBlock* block = getArenaBlock(impl);
+        impl->~Impl();
+        releaseArenaBlock(block);
+    }
+    else
+    {
+        delete impl;
+    }
+}
+
 LLSD::Impl::Impl()
-    : mUseCount(0)
+    : mUseCount(0),
+      mInArena(sArenaScopes != 0)
 {
     ++sAllocationCount;
     ++sOutstandingCount;
 }
 
 LLSD::Impl::Impl(StaticAllocationMarker)
-    : mUseCount(0)
+    : mUseCount(0),
+      mInArena(false)
 {
 }
 
@@ -671,7 +799,7 @@ void LLSD::Impl::reset(Impl*& var, Impl* impl)
     }
     if (var  &&  var->mUseCount != STATIC_USAGE_COUNT && --var->mUseCount == 0)
     {
-        delete var;
+        destroy(var);
     }
     var = impl;
 }
@@ -853,6 +981,8 @@ void LLSD::assign(const UUID& v)        { safe(impl).assign(impl, v); }
 void LLSD::assign(const Date& v)        { safe(impl).assign(impl, v); }
 void LLSD::assign(const URI& v)         { safe(impl).assign(impl, v); }
 void LLSD::assign(const Binary& v)      { safe(impl).assign(impl, v); }
+void LLSD::assign(String&& v)           { Impl::reset(impl, new ImplString(std::move(v))); }
+void LLSD::assign(Binary&& v)           { Impl::reset(impl, new ImplBinary(std::move(v))); }
 
 // Scalar Accessors
 LLSD::Boolean   LLSD::asBoolean() const { return safe(impl).asBoolean(); }
@@ -214,6 +214,12 @@ public:
         LLSD& operator=(const Date& v)      { assign(v); return *this; }
         LLSD& operator=(const URI& v)       { assign(v); return *this; }
         LLSD& operator=(const Binary& v)    { assign(v); return *this; }
+
+        // Take over the contents of a string or binary rather than copy them
+        void assign(String&&);
+        void assign(Binary&&);
+        LLSD& operator=(String&& v)         { assign(std::move(v)); return *this; }
+        LLSD& operator=(Binary&& v)         { assign(std::move(v)); return *this; }
     //@}
 
     /**
@@ -378,6 +384,28 @@ public:
         bool isArray() const        { return type() == TypeArray; }
     //@}
 
+    /** @name Allocation Arena
+        While an ArenaScope is alive, the values created on its thread are
+        carved out of a few large blocks rather than allocated one at a time.
+        This is meant for building a whole document in one go, as the parsers
+        do. The values may outlive the scope and be handed to other threads
+        like any other LLSD: a block is freed once the scope is gone and the
+        last value it holds is released. Nested scopes share the outermost one.
+     */
+    //@{
+        class LL_COMMON_API ArenaScope
+        {
+        public:
+            /// size_hint is the expected size of the document in bytes
+            ArenaScope(size_t size_hint = 0);
+            ~ArenaScope();
+
+        private:
+            ArenaScope(const ArenaScope&);
+            ArenaScope& operator=(const ArenaScope&);
+        };
+    //@}
+
     /** @name Automatic Cast Protection
         These are not implemented on purpose.  Without them, C++ can perform
         some conversions that are clearly not what the programmer intended.
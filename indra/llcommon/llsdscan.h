@@ -0,0 +1,194 @@
+/**
+ * @file llsdscan.h
+ * @brief Vectorized byte scanning used by the LLSD text parsers.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSDSCAN_H
+#define LL_LLSDSCAN_H
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LL_SD_SCAN_SSE2 1
+#include <emmintrin.h>
+#if LL_WINDOWS
+#include <intrin.h>
+#endif
+#else
+#define LL_SD_SCAN_SSE2 0
+#endif
+
+/**
+ * The LLSD XML and notation parsers spend most of their time looking for
+ * the next byte that ends a run of plain text. These helpers test 16 bytes
+ * at a time and fall back to a plain loop for the tail of the buffer and
+ * on targets without SSE2.
+ */
+namespace llsd
+{
+namespace scan
+{
+
+#if LL_SD_SCAN_SSE2
+// Index of the lowest set bit of a non zero mask
+inline U32 first_set_bit(U32 mask)
+{
+#if LL_WINDOWS
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (U32)index;
+#else
+    return (U32)__builtin_ctz(mask);
+#endif
+}
+#endif
+
+// Same set as isspace() in the "C" locale, used by the notation parser
+inline bool is_space(char c)
+{
+    return (c == ' ') || ((U8)(c - '\t') <= (U8)('\r' - '\t'));
+}
+
+/**
+ * Returns the first byte in [begin, end) that is either a or b, or end.
+ */
+inline const char* find_either(const char* begin, const char* end, char a, char b)
+{
+    const char* p = begin;
+#if LL_SD_SCAN_SSE2
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    while (end - p >= 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb));
+        U32 mask = (U32)_mm_movemask_epi8(hits);
+        if (mask)
+        {
+            return p + first_set_bit(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && *p != a && *p != b)
+    {
+        ++p;
+    }
+    return p;
+}
+
+/**
+ * Returns the first byte in [begin, end) that is not whitespace in the
+ * sense of is_space(), or end.
+ */
+inline const char* skip_space(const char* begin, const char* end)
+{
+    const char* p = begin;
+#if LL_SD_SCAN_SSE2
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i ctrl_span = _mm_set1_epi8('\r' - '\t');
+    while (end - p >= 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+        // '\t' to '\r' are contiguous, so one unsigned range test covers them
+        __m128i offset = _mm_sub_epi8(chunk, tab);
+        __m128i is_ctrl = _mm_cmpeq_epi8(_mm_min_epu8(offset, ctrl_span), offset);
+        __m128i is_ws = _mm_or_si128(is_ctrl, _mm_cmpeq_epi8(chunk, space));
+        U32 mask = (U32)_mm_movemask_epi8(is_ws) ^ 0xffff;
+        if (mask)
+        {
+            return p + first_set_bit(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && is_space(*p))
+    {
+        ++p;
+    }
+    return p;
+}
+
+// Bytes of XML character data that can be copied through untouched
+inline bool is_plain_xml_text(char c)
+{
+    U8 u = (U8)c;
+    if (u >= 0x80)
+    {
+        return false;
+    }
+    if (u < 0x20)
+    {
+        return (c == '\t') || (c == '\n');
+    }
+    return (c != '<') && (c != '&') && (c != ']');
+}
+
+/**
+ * Returns the first byte in [begin, end) of XML character data that needs
+ * attention, or end: markup and references ('<', '&'), a possible "]]>",
+ * a carriage return to normalize, any other control character and the
+ * lead or continuation bytes of multibyte UTF-8 sequences.
+ */
+inline const char* find_xml_special(const char* begin, const char* end)
+{
+    const char* p = begin;
+#if LL_SD_SCAN_SSE2
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i bracket = _mm_set1_epi8(']');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i last_ctrl = _mm_set1_epi8(0x1f);
+    while (end - p >= 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, lt),
+                                                 _mm_cmpeq_epi8(chunk, amp)),
+                                    _mm_cmpeq_epi8(chunk, bracket));
+        // control characters other than tab and newline
+        __m128i ctrl = _mm_cmpeq_epi8(_mm_min_epu8(chunk, last_ctrl), chunk);
+        ctrl = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, tab),
+                                             _mm_cmpeq_epi8(chunk, newline)),
+                                ctrl);
+        hits = _mm_or_si128(hits, ctrl);
+        // the sign bit is set on every byte of a multibyte sequence
+        U32 mask = (U32)(_mm_movemask_epi8(hits) | _mm_movemask_epi8(chunk));
+        if (mask)
+        {
+            return p + first_set_bit(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && is_plain_xml_text(*p))
+    {
+        ++p;
+    }
+    return p;
+}
+
+} // namespace scan
+} // namespace llsd
+
+#endif // LL_LLSDSCAN_H
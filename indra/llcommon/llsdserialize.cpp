@@ -31,6 +31,8 @@
 #include "llpointer.h"
 #include "llstreamtools.h" // for fullread
 
+#include <cerrno>
+#include <clocale>
 #include <iostream>
 #include "apr_base64.h"
 
@@ -45,7 +47,9 @@
 #endif
 
 #include "lldate.h"
+#include "llmemorystream.h"
 #include "llsd.h"
+#include "llsdscan.h"
 #include "llstring.h"
 #include "lluri.h"
 
@@ -845,7 +849,8 @@ bool LLSDNotationParser::parseBinary(std::istream& istr, LLSD& data) const
         U8* write;
         std::vector<U8> value;
         c = get(istr);
-        while(c != '"')
+        // a truncated stream fails the parse rather than looping forever
+        while((c != '"') && istr.good())
         {
             putback(istr, c);
             read = buf;
@@ -856,56 +861,1022 @@ bool LLSDNotationParser::parseBinary(std::istream& istr, LLSD& data) const
             {
                 byte = hex_as_nybble(*read++);
                 byte = byte << 4;
-                byte |= hex_as_nybble(*read++);
+                // don't read past the terminator of an odd number of digits
+                if(*read != '\0')
+                {
+                    byte |= hex_as_nybble(*read++);
+                }
                 *write++ = byte;
             }
             // copy the data out of the byte buffer
             value.insert(value.end(), byte_buffer, write);
         }
-        data = value;
+        data = value;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * LLSDNotationParser buffer parsing
+ *
+ * These mirror the istream methods above, quirks included, for the
+ * input they accept. Whatever they are not sure about makes them return
+ * PARSE_FAILURE and parseBuffer() starts over with the istream parser,
+ * which also takes care of logging the errors.
+ */
+struct LLSDNotationParser::Cursor
+{
+    const char* mPos;
+    const char* mEnd;
+
+    size_t left() const { return mEnd - mPos; }
+};
+
+/**
+ * @brief The buffer counterpart of deserialize_string_delim().
+ *
+ * @param pos [in,out] Just after the opening delimiter, moved past the
+ * closing one on success.
+ * @param value [out] The string which was found.
+ * @return Returns false if the buffer ends before the closing delimiter.
+ */
+static bool scan_string_delim(const char*& pos, const char* end, std::string& value, char delim)
+{
+    value.clear();
+    while (true)
+    {
+        const char* run_end = llsd::scan::find_either(pos, end, delim, '\\');
+        value.append(pos, run_end);
+        pos = run_end;
+        if (pos == end)
+        {
+            return false;
+        }
+        // the escape test comes first, a backslash never ends the string
+        if (*pos++ != '\\')
+        {
+            return true;
+        }
+        if (pos == end)
+        {
+            return false;
+        }
+        char next_char = *pos++;
+        switch (next_char)
+        {
+        case 'x':
+        {
+            if (end - pos < 2)
+            {
+                return false;
+            }
+            U8 byte = hex_as_nybble(*pos++) << 4;
+            byte |= hex_as_nybble(*pos++);
+            value += (char)byte;
+            break;
+        }
+        case 'a': value += '\a'; break;
+        case 'b': value += '\b'; break;
+        case 'f': value += '\f'; break;
+        case 'n': value += '\n'; break;
+        case 'r': value += '\r'; break;
+        case 't': value += '\t'; break;
+        case 'v': value += '\v'; break;
+        default: value += next_char; break;
+        }
+    }
+}
+
+/**
+ * @brief Copy a short token into buf as a C string for strtol() and
+ * strtod(). Returns false if it does not fit.
+ */
+template<size_t SIZE>
+static bool copy_token(const char* begin, const char* end, char (&buf)[SIZE])
+{
+    size_t len = end - begin;
+    if (len >= SIZE)
+    {
+        return false;
+    }
+    memcpy(buf, begin, len);
+    buf[len] = '\0';
+    return true;
+}
+
+// The digits of an integer as read by istr >> S32
+static bool scan_integer(const char*& pos, const char* end, S32& value)
+{
+    pos = llsd::scan::skip_space(pos, end);
+    bool negative = false;
+    if (pos < end && (*pos == '-' || *pos == '+'))
+    {
+        negative = (*pos++ == '-');
+    }
+    const char* digits = pos;
+    U64 magnitude = 0;
+    while (pos < end && isdigit((U8)*pos))
+    {
+        magnitude = magnitude * 10 + (*pos++ - '0');
+        if (magnitude > (U64)S32_MAX + 1)
+        {
+            // the stream flags out of range values as a failure
+            return false;
+        }
+    }
+    if (pos == digits || (!negative && magnitude > (U64)S32_MAX))
+    {
+        return false;
+    }
+    value = negative ? (S32)(0 - magnitude) : (S32)magnitude;
+    return true;
+}
+
+// The digits of a real as read by istr >> F64
+static bool scan_real(const char*& pos, const char* end, F64& value)
+{
+    pos = llsd::scan::skip_space(pos, end);
+    const char* begin = pos;
+    if (pos < end && (*pos == '-' || *pos == '+'))
+    {
+        ++pos;
+    }
+    S32 mantissa_digits = 0;
+    bool decimal_point = false;
+    while (pos < end && isdigit((U8)*pos))
+    {
+        ++pos;
+        ++mantissa_digits;
+    }
+    if (pos < end && *pos == '.')
+    {
+        decimal_point = true;
+        ++pos;
+        while (pos < end && isdigit((U8)*pos))
+        {
+            ++pos;
+            ++mantissa_digits;
+        }
+    }
+    if (!mantissa_digits)
+    {
+        return false;
+    }
+    if (pos < end && (*pos == 'e' || *pos == 'E'))
+    {
+        // the stream takes the exponent marker even when no digits follow
+        ++pos;
+        if (pos < end && (*pos == '-' || *pos == '+'))
+        {
+            ++pos;
+        }
+        const char* exponent = pos;
+        while (pos < end && isdigit((U8)*pos))
+        {
+            ++pos;
+        }
+        if (pos == exponent)
+        {
+            return false;
+        }
+    }
+    // strtod() follows LC_NUMERIC while the stream always reads a '.'
+    if (decimal_point && strcmp(localeconv()->decimal_point, ".") != 0)
+    {
+        return false;
+    }
+    char buf[64];
+    if (!copy_token(begin, pos, buf))
+    {
+        return false;
+    }
+    errno = 0;
+    value = strtod(buf, NULL);
+    return (errno != ERANGE);
+}
+
+S32 LLSDNotationParser::parseBuffer(const char* buffer, size_t length, LLSD& data, S32 max_depth)
+{
+    {
+        LLSD::ArenaScope arena(length);
+        Cursor cursor = { buffer, buffer + length };
+        S32 parse_count = doParse(cursor, data, max_depth);
+        if (parse_count != PARSE_FAILURE)
+        {
+            return parse_count;
+        }
+    }
+    LLMemoryStream istr((const U8*)buffer, (S32)llmin(length, (size_t)S32_MAX));
+    return parse(istr, data, LLSDSerialize::SIZE_UNLIMITED, max_depth);
+}
+
+S32 LLSDNotationParser::doParse(Cursor& cursor, LLSD& data, S32 max_depth) const
+{
+    if (max_depth == 0)
+    {
+        return PARSE_FAILURE;
+    }
+    cursor.mPos = llsd::scan::skip_space(cursor.mPos, cursor.mEnd);
+    if (!cursor.left())
+    {
+        // the stream parser returns 0 without touching data
+        return PARSE_FAILURE;
+    }
+    S32 parse_count = 1;
+    char c = *cursor.mPos;
+    switch (c)
+    {
+    case '{':
+    {
+        S32 child_count = parseMap(cursor, data, max_depth - 1);
+        if (child_count == PARSE_FAILURE)
+        {
+            return PARSE_FAILURE;
+        }
+        parse_count += child_count;
+        break;
+    }
+
+    case '[':
+    {
+        S32 child_count = parseArray(cursor, data, max_depth - 1);
+        if (child_count == PARSE_FAILURE)
+        {
+            return PARSE_FAILURE;
+        }
+        parse_count += child_count;
+        break;
+    }
+
+    case '!':
+        ++cursor.mPos;
+        data.clear();
+        break;
+
+    case '0':
+    case '1':
+        ++cursor.mPos;
+        data = (c == '1');
+        break;
+
+    case 'F':
+    case 'f':
+    case 'T':
+    case 't':
+    {
+        ++cursor.mPos;
+        bool value = (c == 'T' || c == 't');
+        if (cursor.left() && isalpha((U8)*cursor.mPos))
+        {
+            // same as deserialize_boolean()
+            const std::string& compare = value ? NOTATION_TRUE_SERIAL : NOTATION_FALSE_SERIAL;
+            for (std::string::size_type ii = 1; ii < compare.size(); ++ii)
+            {
+                if (!cursor.left() || tolower((U8)*cursor.mPos) != (int)compare[ii])
+                {
+                    return PARSE_FAILURE;
+                }
+                ++cursor.mPos;
+            }
+        }
+        data = value;
+        break;
+    }
+
+    case 'i':
+    {
+        ++cursor.mPos;
+        S32 integer = 0;
+        if (!scan_integer(cursor.mPos, cursor.mEnd, integer))
+        {
+            return PARSE_FAILURE;
+        }
+        data = integer;
+        break;
+    }
+
+    case 'r':
+    {
+        ++cursor.mPos;
+        F64 real = 0.0;
+        if (!scan_real(cursor.mPos, cursor.mEnd, real))
+        {
+            return PARSE_FAILURE;
+        }
+        data = real;
+        break;
+    }
+
+    case 'u':
+    {
+        ++cursor.mPos;
+        // istr >> LLUUID reads 36 characters skipping any whitespace
+        // between them, only take them in one piece here.
+        const size_t UUID_CHARS = UUID_STR_LENGTH - 1;
+        if (cursor.left() < UUID_CHARS)
+        {
+            return PARSE_FAILURE;
+        }
+        for (size_t i = 0; i < UUID_CHARS; ++i)
+        {
+            if (llsd::scan::is_space(cursor.mPos[i]))
+            {
+                return PARSE_FAILURE;
+            }
+        }
+        LLUUID id;
+        id.set(std::string(cursor.mPos, UUID_CHARS));
+        cursor.mPos += UUID_CHARS;
+        data = id;
+        break;
+    }
+
+    case '\"':
+    case '\'':
+    case 's':
+    {
+        std::string value;
+        if (!parseString(cursor, value))
+        {
+            return PARSE_FAILURE;
+        }
+        data = std::move(value);
+        break;
+    }
+
+    case 'l':
+    case 'd':
+    {
+        if (cursor.left() < 2)
+        {
+            return PARSE_FAILURE;
+        }
+        // pop the type, then anything goes as the delimiter
+        char delim = cursor.mPos[1];
+        cursor.mPos += 2;
+        std::string str;
+        if (!scan_string_delim(cursor.mPos, cursor.mEnd, str, delim))
+        {
+            return PARSE_FAILURE;
+        }
+        if (c == 'l')
+        {
+            data = LLURI(str);
+        }
+        else
+        {
+            data = LLDate(str);
+        }
+        break;
+    }
+
+    case 'b':
+        if (!parseBinary(cursor, data))
+        {
+            return PARSE_FAILURE;
+        }
+        break;
+
+    default:
+        return PARSE_FAILURE;
+    }
+    return parse_count;
+}
+
+S32 LLSDNotationParser::parseMap(Cursor& cursor, LLSD& map, S32 max_depth) const
+{
+    // map: { string:object, string:object }
+    map = LLSD::emptyMap();
+    S32 parse_count = 0;
+    ++cursor.mPos; // pop the '{'
+    bool found_name = false;
+    std::string name;
+    if (!cursor.left())
+    {
+        return PARSE_FAILURE;
+    }
+    char c = *cursor.mPos++;
+    while (c != '}')
+    {
+        if (!found_name)
+        {
+            // anything before a name is skipped, not just commas
+            if ((c == '\"') || (c == '\'') || (c == 's'))
+            {
+                --cursor.mPos;
+                found_name = true;
+                if (!parseString(cursor, name))
+                {
+                    return PARSE_FAILURE;
+                }
+            }
+        }
+        else if (!llsd::scan::is_space(c) && (c != ':'))
+        {
+            --cursor.mPos;
+            LLSD child;
+            S32 count = doParse(cursor, child, max_depth);
+            if (count <= 0)
+            {
+                return PARSE_FAILURE;
+            }
+            parse_count += count;
+            map.insert(name, child);
+            found_name = false;
+        }
+        if (!cursor.left())
+        {
+            return PARSE_FAILURE;
+        }
+        c = *cursor.mPos++;
+    }
+    return parse_count;
+}
+
+S32 LLSDNotationParser::parseArray(Cursor& cursor, LLSD& array, S32 max_depth) const
+{
+    // array: [ object, object, object ]
+    array = LLSD::emptyArray();
+    S32 parse_count = 0;
+    ++cursor.mPos; // pop the '['
+    while (true)
+    {
+        cursor.mPos = llsd::scan::skip_space(cursor.mPos, cursor.mEnd);
+        if (!cursor.left())
+        {
+            return PARSE_FAILURE;
+        }
+        char c = *cursor.mPos;
+        if (c == ']')
+        {
+            ++cursor.mPos;
+            break;
+        }
+        if (c == ',')
+        {
+            ++cursor.mPos;
+            continue;
+        }
+        LLSD child;
+        S32 count = doParse(cursor, child, max_depth);
+        if (PARSE_FAILURE == count)
+        {
+            return PARSE_FAILURE;
+        }
+        parse_count += count;
+        array.append(child);
+    }
+    return parse_count;
+}
+
+bool LLSDNotationParser::parseString(Cursor& cursor, std::string& value) const
+{
+    if (!cursor.left())
+    {
+        return false;
+    }
+    char c = *cursor.mPos++;
+    if ((c == '\"') || (c == '\''))
+    {
+        return scan_string_delim(cursor.mPos, cursor.mEnd, value, c);
+    }
+    if (c != 's')
+    {
+        return false;
+    }
+
+    // s(len)"raw", read the way deserialize_string_raw() does
+    const size_t SIZE_CHARS = 18;
+    size_t n = 0;
+    while (n < SIZE_CHARS && n < cursor.left() && cursor.mPos[n] != ')')
+    {
+        ++n;
+    }
+    char buf[SIZE_CHARS + 1];
+    if (!n || cursor.left() < n + 2 || !copy_token(cursor.mPos, cursor.mPos + n, buf))
+    {
+        return false;
+    }
+    cursor.mPos += n + 1; // the ')' or whatever is in its place
+    c = *cursor.mPos++;
+    if (((c != '"') && (c != '\'')) || (buf[0] != '('))
+    {
+        return false;
+    }
+    S32 len = strtol(buf + 1, NULL, 0);
+    if (len < 0 || cursor.left() < (size_t)len + 1)
+    {
+        return false;
+    }
+    if (len)
+    {
+        // an empty raw string leaves value as it was
+        value.assign(cursor.mPos, len);
+        cursor.mPos += len;
+    }
+    c = *cursor.mPos++;
+    return (c == '"') || (c == '\'');
+}
+
+bool LLSDNotationParser::parseBinary(Cursor& cursor, LLSD& data) const
+{
+    // binary: b##"ff3120ab1"
+    // or: b(len)"..."
+
+    // the encoding runs up to the first quote, as read by the 255 byte
+    // buffer of the istream version
+    const size_t ENCODING_CHARS = 255;
+    const char* quote = llsd::scan::find_either(cursor.mPos,
+        cursor.mPos + llmin(cursor.left(), ENCODING_CHARS), '"', '"');
+    if (quote == cursor.mEnd || *quote != '"')
+    {
+        return false;
+    }
+    char buf[ENCODING_CHARS + 1];
+    copy_token(cursor.mPos, quote, buf);
+    cursor.mPos = quote + 1;
+
+    if (0 == strncmp("b(", buf, 2))
+    {
+        S32 len = strtol(buf + 2, NULL, 0);
+        if (len < 0 || cursor.left() < (size_t)len + 1)
+        {
+            return false;
+        }
+        std::vector<U8> value(cursor.mPos, cursor.mPos + len);
+        // strip off the trailing double-quote, whatever it is
+        cursor.mPos += len + 1;
+        data = std::move(value);
+    }
+    else if (0 == strncmp("b64", buf, 3))
+    {
+        const char* coded_end = llsd::scan::find_either(cursor.mPos, cursor.mEnd, '"', '"');
+        // the istream version fails on an empty string
+        if (coded_end == cursor.mPos || coded_end == cursor.mEnd)
+        {
+            return false;
+        }
+        std::string encoded(cursor.mPos, coded_end);
+        cursor.mPos = coded_end + 1;
+        S32 len = apr_base64_decode_len(encoded.c_str());
+        std::vector<U8> value;
+        if (len)
+        {
+            value.resize(len);
+            len = apr_base64_decode_binary(&value[0], encoded.c_str());
+            value.resize(len);
+        }
+        data = std::move(value);
+    }
+    else if (0 == strncmp("b16", buf, 3))
+    {
+        const char* coded_end = llsd::scan::find_either(cursor.mPos, cursor.mEnd, '"', '\0');
+        if (coded_end == cursor.mEnd || *coded_end != '"' || ((coded_end - cursor.mPos) & 1))
+        {
+            return false;
+        }
+        std::vector<U8> value((coded_end - cursor.mPos) / 2);
+        for (size_t i = 0; i < value.size(); ++i)
+        {
+            U8 byte = hex_as_nybble(*cursor.mPos++) << 4;
+            byte |= hex_as_nybble(*cursor.mPos++);
+            value[i] = byte;
+        }
+        ++cursor.mPos;
+        data = std::move(value);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * LLSDBinaryParser
+ */
+LLSDBinaryParser::LLSDBinaryParser()
+{
+}
+
+// virtual
+LLSDBinaryParser::~LLSDBinaryParser()
+{
+}
+
+// virtual
+S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) const
+{
+/**
+ * Undefined: '!'<br>
+ * Boolean: '1' for true '0' for false<br>
+ * Integer: 'i' + 4 bytes network byte order<br>
+ * Real: 'r' + 8 bytes IEEE double<br>
+ * UUID: 'u' + 16 byte unsigned integer<br>
+ * String: 's' + 4 byte integer size + string<br>
+ *  strings also secretly support the notation format
+ * Date: 'd' + 8 byte IEEE double for seconds since epoch<br>
+ * URI: 'l' + 4 byte integer size + string uri<br>
+ * Binary: 'b' + 4 byte integer size + binary data<br>
+ * Array: '[' + 4 byte integer size  + all values + ']'<br>
+ * Map: '{' + 4 byte integer size  every(key + value) + '}'<br>
+ *  map keys are serialized as s + 4 byte integer size + string or in the
+ *  notation format.
+ */
+    char c;
+    c = get(istr);
+    if(!istr.good())
+    {
+        return 0;
+    }
+    if (max_depth == 0)
+    {
+        return PARSE_FAILURE;
+    }
+    S32 parse_count = 1;
+    switch(c)
+    {
+    case '{':
+    {
+        S32 child_count = parseMap(istr, data, max_depth - 1);
+        if((child_count == PARSE_FAILURE) || data.isUndefined())
+        {
+            parse_count = PARSE_FAILURE;
+        }
+        else
+        {
+            parse_count += child_count;
+        }
+        if(istr.fail())
+        {
+            LL_INFOS() << "STREAM FAILURE reading binary map." << LL_ENDL;
+            parse_count = PARSE_FAILURE;
+        }
+        break;
+    }
+
+    case '[':
+    {
+        S32 child_count = parseArray(istr, data, max_depth - 1);
+        if((child_count == PARSE_FAILURE) || data.isUndefined())
+        {
+            parse_count = PARSE_FAILURE;
+        }
+        else
+        {
+            parse_count += child_count;
+        }
+        if(istr.fail())
+        {
+            LL_INFOS() << "STREAM FAILURE reading binary array." << LL_ENDL;
+            parse_count = PARSE_FAILURE;
+        }
+        break;
+    }
+
+    case '!':
+        data.clear();
+        break;
+
+    case '0':
+        data = false;
+        break;
+
+    case '1':
+        data = true;
+        break;
+
+    case 'i':
+    {
+        U32 value_nbo = 0;
+        read(istr, (char*)&value_nbo, sizeof(U32));  /*Flawfinder: ignore*/
+        data = (S32)ntohl(value_nbo);
+        if(istr.fail())
+        {
+            LL_INFOS() << "STREAM FAILURE reading binary integer." << LL_ENDL;
+        }
+        break;
+    }
+
+    case 'r':
+    {
+        F64 real_nbo = 0.0;
+        read(istr, (char*)&real_nbo, sizeof(F64));   /*Flawfinder: ignore*/
+        data = ll_ntohd(real_nbo);
+        if(istr.fail())
+        {
+            LL_INFOS() << "STREAM FAILURE reading binary real." << LL_ENDL;
+        }
+        break;
+    }
+
+    case 'u':
+    {
+        LLUUID id;
+        read(istr, (char*)(&id.mData), UUID_BYTES);  /*Flawfinder: ignore*/
+        data = id;
+        if(istr.fail())
+        {
+            LL_INFOS() << "STREAM FAILURE reading binary uuid." << LL_ENDL;
+        }
+        break;
+    }
+
+    case '\'':
+    case '"':
+    {
+        std::string value;
+        int cnt = deserialize_string_delim(istr, value, c);
+        if(PARSE_FAILURE == cnt)
+        {
+            parse_count = PARSE_FAILURE;
+        }
+        else
+        {
+            data = value;
+            account(cnt);
+        }
+        if(istr.fail())
+        {
+            LL_INFOS() << "STREAM FAILURE reading binary (notation-style) string."
+                << LL_ENDL;
+            parse_count = PARSE_FAILURE;
+        }
+        break;
+    }
+
+    case 's':
+    {
+        std::string value;
+        if(parseString(istr, value))
+        {
+            data = value;
+        }
+        else
+        {
+            parse_count = PARSE_FAILURE;
+        }
+        if(istr.fail())
+        {
+            LL_INFOS() << "STREAM FAILURE reading binary string." << LL_ENDL;
+            parse_count = PARSE_FAILURE;
+        }
+        break;
+    }
+
+    case 'l':
+    {
+        std::string value;
+        if(parseString(istr, value))
+        {
+            data = LLURI(value);
+        }
+        else
+        {
+            parse_count = PARSE_FAILURE;
+        }
+        if(istr.fail())
+        {
+            LL_INFOS() << "STREAM FAILURE reading binary link." << LL_ENDL;
+            parse_count = PARSE_FAILURE;
+        }
+        break;
+    }
+
+    case 'd':
+    {
+        F64 real = 0.0;
+        read(istr, (char*)&real, sizeof(F64));   /*Flawfinder: ignore*/
+        data = LLDate(real);
+        if(istr.fail())
+        {
+            LL_INFOS() << "STREAM FAILURE reading binary date." << LL_ENDL;
+            parse_count = PARSE_FAILURE;
+        }
+        break;
+    }
+
+    case 'b':
+    {
+        // We probably have a valid raw binary stream. determine
+        // the size, and read it.
+        U32 size_nbo = 0;
+        read(istr, (char*)&size_nbo, sizeof(U32));  /*Flawfinder: ignore*/
+        S32 size = (S32)ntohl(size_nbo);
+        if(mCheckLimits && (size > mMaxBytesLeft))
+        {
+            parse_count = PARSE_FAILURE;
+        }
+        else
+        {
+            std::vector<U8> value;
+            if(size > 0)
+            {
+                value.resize(size);
+                account((int)fullread(istr, (char*)&value[0], size));
+            }
+            data = value;
+        }
+        if(istr.fail())
+        {
+            LL_INFOS() << "STREAM FAILURE reading binary." << LL_ENDL;
+            parse_count = PARSE_FAILURE;
+        }
+        break;
+    }
+
+    default:
+        parse_count = PARSE_FAILURE;
+        LL_INFOS() << "Unrecognized character while parsing: int(" << (int)c
+            << ")" << LL_ENDL;
+        break;
+    }
+    if(PARSE_FAILURE == parse_count)
+    {
+        data.clear();
+    }
+    return parse_count;
+}
+
+S32 LLSDBinaryParser::parseMap(std::istream& istr, LLSD& map, S32 max_depth) const
+{
+    map = LLSD::emptyMap();
+    U32 value_nbo = 0;
+    read(istr, (char*)&value_nbo, sizeof(U32));      /*Flawfinder: ignore*/
+    S32 size = (S32)ntohl(value_nbo);
+    S32 parse_count = 0;
+    S32 count = 0;
+    char c = get(istr);
+    while(c != '}' && (count < size) && istr.good())
+    {
+        std::string name;
+        switch(c)
+        {
+        case 'k':
+            if(!parseString(istr, name))
+            {
+                return PARSE_FAILURE;
+            }
+            break;
+        case '\'':
+        case '"':
+        {
+            int cnt = deserialize_string_delim(istr, name, c);
+            if(PARSE_FAILURE == cnt) return PARSE_FAILURE;
+            account(cnt);
+            break;
+        }
+        }
+        LLSD child;
+        S32 child_count = doParse(istr, child, max_depth);
+        if(child_count > 0)
+        {
+            // There must be a value for every key, thus child_count
+            // must be greater than 0.
+            parse_count += child_count;
+            map.insert(name, child);
+        }
+        else
+        {
+            return PARSE_FAILURE;
+        }
+        ++count;
+        c = get(istr);
+    }
+    if((c != '}') || (count < size))
+    {
+        // Make sure it is correctly terminated and we parsed as many
+        // as were said to be there.
+        return PARSE_FAILURE;
+    }
+    return parse_count;
+}
+
+S32 LLSDBinaryParser::parseArray(std::istream& istr, LLSD& array, S32 max_depth) const
+{
+    array = LLSD::emptyArray();
+    U32 value_nbo = 0;
+    read(istr, (char*)&value_nbo, sizeof(U32));      /*Flawfinder: ignore*/
+    S32 size = (S32)ntohl(value_nbo);
+
+    // *FIX: This would be a good place to reserve some space in the
+    // array...
+
+    S32 parse_count = 0;
+    S32 count = 0;
+    char c = istr.peek();
+    while((c != ']') && (count < size) && istr.good())
+    {
+        LLSD child;
+        S32 child_count = doParse(istr, child, max_depth);
+        if(PARSE_FAILURE == child_count)
+        {
+            return PARSE_FAILURE;
+        }
+        if(child_count)
+        {
+            parse_count += child_count;
+            array.append(child);
+        }
+        ++count;
+        c = istr.peek();
     }
-    else
+    c = get(istr);
+    if((c != ']') || (count < size))
     {
-        return false;
+        // Make sure it is correctly terminated and we parsed as many
+        // as were said to be there.
+        return PARSE_FAILURE;
+    }
+    return parse_count;
+}
+
+bool LLSDBinaryParser::parseString(
+    std::istream& istr,
+    std::string& value) const
+{
+    // *FIX: This is memory inefficient.
+    U32 value_nbo = 0;
+    read(istr, (char*)&value_nbo, sizeof(U32));      /*Flawfinder: ignore*/
+    S32 size = (S32)ntohl(value_nbo);
+    if(mCheckLimits && (size > mMaxBytesLeft)) return false;
+    if(size < 0) return false;
+    std::vector<char> buf;
+    if(size)
+    {
+        buf.resize(size);
+        account((int)fullread(istr, &buf[0], size));
+        value.assign(buf.begin(), buf.end());
     }
     return true;
 }
 
 
 /**
- * LLSDBinaryParser
+ * LLSDBinaryParser buffer parsing
  */
-LLSDBinaryParser::LLSDBinaryParser()
+struct LLSDBinaryParser::Cursor
 {
-}
+    const U8* mPos;
+    const U8* mEnd;
 
-// virtual
-LLSDBinaryParser::~LLSDBinaryParser()
+    size_t left() const { return mEnd - mPos; }
+
+    bool read(void* dest, size_t bytes)
+    {
+        if (bytes > left())
+        {
+            mPos = mEnd;
+            return false;
+        }
+        memcpy(dest, mPos, bytes);
+        mPos += bytes;
+        return true;
+    }
+
+    bool readSize(S32& size)
+    {
+        U32 size_nbo = 0;
+        if (!read(&size_nbo, sizeof(U32)))
+        {
+            return false;
+        }
+        size = (S32)ntohl(size_nbo);
+        // a size can never be bigger than what is left to read
+        return size >= 0 && (size_t)size <= left();
+    }
+
+    // Strings also secretly support the notation format
+    bool readDelimitedString(std::string& value, char delim)
+    {
+        const char* pos = (const char*)mPos;
+        if (!scan_string_delim(pos, (const char*)mEnd, value, delim))
+        {
+            mPos = mEnd;
+            return false;
+        }
+        mPos = (const U8*)pos;
+        return true;
+    }
+};
+
+S32 LLSDBinaryParser::parseBuffer(const U8* buffer, size_t length, LLSD& data, S32 max_depth) const
 {
+    // The values take about twice the size of their binary form
+    LLSD::ArenaScope arena(length * 2);
+    Cursor cursor = { buffer, buffer + length };
+    return doParse(cursor, data, max_depth);
 }
 
-// virtual
-S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) const
+S32 LLSDBinaryParser::doParse(Cursor& cursor, LLSD& data, S32 max_depth) const
 {
-/**
- * Undefined: '!'<br>
- * Boolean: '1' for true '0' for false<br>
- * Integer: 'i' + 4 bytes network byte order<br>
- * Real: 'r' + 8 bytes IEEE double<br>
- * UUID: 'u' + 16 byte unsigned integer<br>
- * String: 's' + 4 byte integer size + string<br>
- *  strings also secretly support the notation format
- * Date: 'd' + 8 byte IEEE double for seconds since epoch<br>
- * URI: 'l' + 4 byte integer size + string uri<br>
- * Binary: 'b' + 4 byte integer size + binary data<br>
- * Array: '[' + 4 byte integer size  + all values + ']'<br>
- * Map: '{' + 4 byte integer size  every(key + value) + '}'<br>
- *  map keys are serialized as s + 4 byte integer size + string or in the
- *  notation format.
- */
-    char c;
-    c = get(istr);
-    if(!istr.good())
+    if (!cursor.left())
     {
         return 0;
     }
@@ -913,12 +1884,13 @@ S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) con
     {
         return PARSE_FAILURE;
     }
+    char c = (char)*cursor.mPos++;
     S32 parse_count = 1;
     switch(c)
     {
     case '{':
     {
-        S32 child_count = parseMap(istr, data, max_depth - 1);
+        S32 child_count = parseMap(cursor, data, max_depth - 1);
         if((child_count == PARSE_FAILURE) || data.isUndefined())
         {
             parse_count = PARSE_FAILURE;
@@ -927,17 +1899,12 @@ S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) con
         {
             parse_count += child_count;
         }
-        if(istr.fail())
-        {
-            LL_INFOS() << "STREAM FAILURE reading binary map." << LL_ENDL;
-            parse_count = PARSE_FAILURE;
-        }
         break;
     }
 
     case '[':
     {
-        S32 child_count = parseArray(istr, data, max_depth - 1);
+        S32 child_count = parseArray(cursor, data, max_depth - 1);
         if((child_count == PARSE_FAILURE) || data.isUndefined())
         {
             parse_count = PARSE_FAILURE;
@@ -946,11 +1913,6 @@ S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) con
         {
             parse_count += child_count;
         }
-        if(istr.fail())
-        {
-            LL_INFOS() << "STREAM FAILURE reading binary array." << LL_ENDL;
-            parse_count = PARSE_FAILURE;
-        }
         break;
     }
 
@@ -969,11 +1931,13 @@ S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) con
     case 'i':
     {
         U32 value_nbo = 0;
-        read(istr, (char*)&value_nbo, sizeof(U32));  /*Flawfinder: ignore*/
-        data = (S32)ntohl(value_nbo);
-        if(istr.fail())
+        if (cursor.read(&value_nbo, sizeof(U32)))
         {
-            LL_INFOS() << "STREAM FAILURE reading binary integer." << LL_ENDL;
+            data = (S32)ntohl(value_nbo);
+        }
+        else
+        {
+            parse_count = PARSE_FAILURE;
         }
         break;
     }
@@ -981,11 +1945,13 @@ S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) con
     case 'r':
     {
         F64 real_nbo = 0.0;
-        read(istr, (char*)&real_nbo, sizeof(F64));   /*Flawfinder: ignore*/
-        data = ll_ntohd(real_nbo);
-        if(istr.fail())
+        if (cursor.read(&real_nbo, sizeof(F64)))
         {
-            LL_INFOS() << "STREAM FAILURE reading binary real." << LL_ENDL;
+            data = ll_ntohd(real_nbo);
+        }
+        else
+        {
+            parse_count = PARSE_FAILURE;
         }
         break;
     }
@@ -993,11 +1959,13 @@ S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) con
     case 'u':
     {
         LLUUID id;
-        read(istr, (char*)(&id.mData), UUID_BYTES);  /*Flawfinder: ignore*/
-        data = id;
-        if(istr.fail())
+        if (cursor.read(id.mData, UUID_BYTES))
         {
-            LL_INFOS() << "STREAM FAILURE reading binary uuid." << LL_ENDL;
+            data = id;
+        }
+        else
+        {
+            parse_count = PARSE_FAILURE;
         }
         break;
     }
@@ -1006,20 +1974,12 @@ S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) con
     case '"':
     {
         std::string value;
-        int cnt = deserialize_string_delim(istr, value, c);
-        if(PARSE_FAILURE == cnt)
+        if (cursor.readDelimitedString(value, c))
         {
-            parse_count = PARSE_FAILURE;
+            data = std::move(value);
         }
         else
         {
-            data = value;
-            account(cnt);
-        }
-        if(istr.fail())
-        {
-            LL_INFOS() << "STREAM FAILURE reading binary (notation-style) string."
-                << LL_ENDL;
             parse_count = PARSE_FAILURE;
         }
         break;
@@ -1028,26 +1988,21 @@ S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) con
     case 's':
     {
         std::string value;
-        if(parseString(istr, value))
+        if (parseString(cursor, value))
         {
-            data = value;
+            data = std::move(value);
         }
         else
         {
             parse_count = PARSE_FAILURE;
         }
-        if(istr.fail())
-        {
-            LL_INFOS() << "STREAM FAILURE reading binary string." << LL_ENDL;
-            parse_count = PARSE_FAILURE;
-        }
         break;
     }
 
     case 'l':
     {
         std::string value;
-        if(parseString(istr, value))
+        if (parseString(cursor, value))
         {
             data = LLURI(value);
         }
@@ -1055,22 +2010,18 @@ S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) con
         {
             parse_count = PARSE_FAILURE;
         }
-        if(istr.fail())
-        {
-            LL_INFOS() << "STREAM FAILURE reading binary link." << LL_ENDL;
-            parse_count = PARSE_FAILURE;
-        }
         break;
     }
 
     case 'd':
     {
         F64 real = 0.0;
-        read(istr, (char*)&real, sizeof(F64));   /*Flawfinder: ignore*/
-        data = LLDate(real);
-        if(istr.fail())
+        if (cursor.read(&real, sizeof(F64)))
+        {
+            data = LLDate(real);
+        }
+        else
         {
-            LL_INFOS() << "STREAM FAILURE reading binary date." << LL_ENDL;
             parse_count = PARSE_FAILURE;
         }
         break;
@@ -1078,28 +2029,15 @@ S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) con
 
     case 'b':
     {
-        // We probably have a valid raw binary stream. determine
-        // the size, and read it.
-        U32 size_nbo = 0;
-        read(istr, (char*)&size_nbo, sizeof(U32));  /*Flawfinder: ignore*/
-        S32 size = (S32)ntohl(size_nbo);
-        if(mCheckLimits && (size > mMaxBytesLeft))
+        S32 size = 0;
+        if (cursor.readSize(size))
         {
-            parse_count = PARSE_FAILURE;
+            LLSD::Binary value(cursor.mPos, cursor.mPos + size);
+            cursor.mPos += size;
+            data = std::move(value);
         }
         else
         {
-            std::vector<U8> value;
-            if(size > 0)
-            {
-                value.resize(size);
-                account((int)fullread(istr, (char*)&value[0], size));
-            }
-            data = value;
-        }
-        if(istr.fail())
-        {
-            LL_INFOS() << "STREAM FAILURE reading binary." << LL_ENDL;
             parse_count = PARSE_FAILURE;
         }
         break;
@@ -1118,37 +2056,38 @@ S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) con
     return parse_count;
 }
 
-S32 LLSDBinaryParser::parseMap(std::istream& istr, LLSD& map, S32 max_depth) const
+S32 LLSDBinaryParser::parseMap(Cursor& cursor, LLSD& map, S32 max_depth) const
 {
     map = LLSD::emptyMap();
-    U32 value_nbo = 0;
-    read(istr, (char*)&value_nbo, sizeof(U32));      /*Flawfinder: ignore*/
-    S32 size = (S32)ntohl(value_nbo);
+    S32 size = 0;
+    if (!cursor.readSize(size))
+    {
+        return PARSE_FAILURE;
+    }
     S32 parse_count = 0;
     S32 count = 0;
-    char c = get(istr);
-    while(c != '}' && (count < size) && istr.good())
+    char c = cursor.left() ? (char)*cursor.mPos++ : 0;
+    while(c != '}' && (count < size) && cursor.left())
     {
         std::string name;
         switch(c)
         {
         case 'k':
-            if(!parseString(istr, name))
+            if(!parseString(cursor, name))
             {
                 return PARSE_FAILURE;
             }
             break;
         case '\'':
         case '"':
-        {
-            int cnt = deserialize_string_delim(istr, name, c);
-            if(PARSE_FAILURE == cnt) return PARSE_FAILURE;
-            account(cnt);
+            if (!cursor.readDelimitedString(name, c))
+            {
+                return PARSE_FAILURE;
+            }
             break;
         }
-        }
         LLSD child;
-        S32 child_count = doParse(istr, child, max_depth);
+        S32 child_count = doParse(cursor, child, max_depth);
         if(child_count > 0)
         {
             // There must be a value for every key, thus child_count
@@ -1161,7 +2100,7 @@ S32 LLSDBinaryParser::parseMap(std::istream& istr, LLSD& map, S32 max_depth) con
             return PARSE_FAILURE;
         }
         ++count;
-        c = get(istr);
+        c = cursor.left() ? (char)*cursor.mPos++ : 0;
     }
     if((c != '}') || (count < size))
     {
@@ -1172,37 +2111,34 @@ S32 LLSDBinaryParser::parseMap(std::istream& istr, LLSD& map, S32 max_depth) con
     return parse_count;
 }
 
-S32 LLSDBinaryParser::parseArray(std::istream& istr, LLSD& array, S32 max_depth) const
+S32 LLSDBinaryParser::parseArray(Cursor& cursor, LLSD& array, S32 max_depth) const
 {
     array = LLSD::emptyArray();
-    U32 value_nbo = 0;
-    read(istr, (char*)&value_nbo, sizeof(U32));      /*Flawfinder: ignore*/
-    S32 size = (S32)ntohl(value_nbo);
-
-    // *FIX: This would be a good place to reserve some space in the
-    // array...
+    S32 size = 0;
+    if (!cursor.readSize(size))
+    {
+        return PARSE_FAILURE;
+    }
+    if (size > 0)
+    {
+        // Every element takes at least a byte so readSize() made sure
+        // size is sane
+        array[size - 1] = LLSD();
+    }
 
     S32 parse_count = 0;
     S32 count = 0;
-    char c = istr.peek();
-    while((c != ']') && (count < size) && istr.good())
+    while(cursor.left() && (*cursor.mPos != ']') && (count < size))
     {
-        LLSD child;
-        S32 child_count = doParse(istr, child, max_depth);
-        if(PARSE_FAILURE == child_count)
+        S32 child_count = doParse(cursor, array[count], max_depth);
+        if(child_count <= 0)
         {
             return PARSE_FAILURE;
         }
-        if(child_count)
-        {
-            parse_count += child_count;
-            array.append(child);
-        }
+        parse_count += child_count;
         ++count;
-        c = istr.peek();
     }
-    c = get(istr);
-    if((c != ']') || (count < size))
+    if(!cursor.left() || (*cursor.mPos++ != ']') || (count < size))
     {
         // Make sure it is correctly terminated and we parsed as many
         // as were said to be there.
@@ -1211,27 +2147,18 @@ S32 LLSDBinaryParser::parseArray(std::istream& istr, LLSD& array, S32 max_depth)
     return parse_count;
 }
 
-bool LLSDBinaryParser::parseString(
-    std::istream& istr,
-    std::string& value) const
+bool LLSDBinaryParser::parseString(Cursor& cursor, std::string& value) const
 {
-    // *FIX: This is memory inefficient.
-    U32 value_nbo = 0;
-    read(istr, (char*)&value_nbo, sizeof(U32));      /*Flawfinder: ignore*/
-    S32 size = (S32)ntohl(value_nbo);
-    if(mCheckLimits && (size > mMaxBytesLeft)) return false;
-    if(size < 0) return false;
-    std::vector<char> buf;
-    if(size)
+    S32 size = 0;
+    if (!cursor.readSize(size))
     {
-        buf.resize(size);
-        account((int)fullread(istr, &buf[0], size));
-        value.assign(buf.begin(), buf.end());
+        return false;
     }
+    value.assign((const char*)cursor.mPos, size);
+    cursor.mPos += size;
     return true;
 }
 
-
 /**
  * LLSDFormatter
  */
@@ -2251,41 +3178,33 @@ LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, std::istream& is,
 
     //result now points to the decompressed LLSD block
     {
-        std::istringstream istr;
+        // parse it in place rather than copy it into a stream
+        const U8* llsd_start = result;
+        size_t llsd_size = cur_size;
+
+        static const std::string deprecated_header("<? LLSD/Binary ?>");
+        if (llsd_size > deprecated_header.size()
+            && !memcmp(result, deprecated_header.data(), deprecated_header.size()))
+        {
+            llsd_start += deprecated_header.size() + 1;
+            llsd_size -= deprecated_header.size() + 1;
+        }
+
         // Since we are using this for meshes, data we are dealing with tend to be large.
-        // So string can potentially fail to allocate, make sure this won't cause problems
+        // So binaries can potentially fail to allocate, make sure this won't cause problems
         try
         {
-            std::string res_str((char*)result, cur_size);
-
-            std::string deprecated_header("<? LLSD/Binary ?>");
-
-            if (res_str.substr(0, deprecated_header.size()) == deprecated_header)
+            if (!LLSDSerialize::fromBinary(data, llsd_start, llsd_size, UNZIP_LLSD_MAX_DEPTH))
             {
-                res_str = res_str.substr(deprecated_header.size() + 1, cur_size);
+                free(result);
+                return ZR_PARSE_ERROR;
             }
-            cur_size = res_str.size();
-
-            istr.str(res_str);
         }
-#ifdef LL_WINDOWS
-        catch (std::length_error)
-        {
-            free(result);
-            return ZR_SIZE_ERROR;
-        }
-#endif
         catch (std::bad_alloc&)
         {
             free(result);
             return ZR_MEM_ERROR;
         }
-
-        if (!LLSDSerialize::fromBinary(data, istr, cur_size, UNZIP_LLSD_MAX_DEPTH))
-        {
-            free(result);
-            return ZR_PARSE_ERROR;
-        }
     }
 
     free(result);
@@ -231,6 +231,26 @@ public:
      */
     LLSDNotationParser();
 
+    /** 
+     * @brief Call this method to parse a contiguous buffer for LLSD.
+     *
+     * Unlike parse(), this scans the text straight from memory, looking
+     * for string delimiters, escapes and whitespace many bytes at a
+     * time, and the parsed values are allocated from an
+     * LLSD::ArenaScope. Anything the buffer scanner does not handle
+     * itself, including every malformed document, is handed to the
+     * istream parser so the result is always the same as parse() with
+     * an unlimited byte count.
+     * @param buffer The notation formatted data.
+     * @param length The size of the buffer in bytes.
+     * @param data[out] The newly parse structured data. Undefined on failure.
+     * @param max_depth Max depth parser will check before exiting
+     *  with parse error, -1 - unlimited.
+     * @return Returns the number of LLSD objects parsed into
+     * data. Returns PARSE_FAILURE (-1) on parse failure.
+     */
+    S32 parseBuffer(const char* buffer, size_t length, LLSD& data, S32 max_depth = -1);
+
 protected:
     /** 
      * @brief Call this method to parse a stream for LLSD.
@@ -288,6 +308,22 @@ private:
      * @return Retuns true if a complete blob was parsed.
      */
     bool parseBinary(std::istream& istr, LLSD& data) const;
+
+    /**
+     * @brief Read position in the buffer given to parseBuffer()
+     */
+    struct Cursor;
+
+    /**
+     * @brief The parseBuffer() counterparts of the istream methods
+     * above. They return PARSE_FAILURE, or false, on anything they
+     * leave to the istream parser.
+     */
+    S32 doParse(Cursor& cursor, LLSD& data, S32 max_depth) const;
+    S32 parseMap(Cursor& cursor, LLSD& map, S32 max_depth) const;
+    S32 parseArray(Cursor& cursor, LLSD& array, S32 max_depth) const;
+    bool parseString(Cursor& cursor, std::string& value) const;
+    bool parseBinary(Cursor& cursor, LLSD& data) const;
 };
 
 /** 
@@ -308,6 +344,24 @@ public:
      */
     LLSDXMLParser(bool emit_errors=true);
 
+    /** 
+     * @brief Call this method to parse a complete XML document held in
+     * memory.
+     *
+     * The buffer is tokenized without expat, scanning the character data
+     * for markup, references and line breaks many bytes at a time, and
+     * the parsed values are allocated from an LLSD::ArenaScope. Documents
+     * using more of XML than LLSD needs, such as a DTD, and documents that
+     * are not well formed are handed to expat as a whole, so the result
+     * is always the same as parse() gives. The parser is reset first.
+     * @param buffer The XML document.
+     * @param length The size of the buffer in bytes.
+     * @param data[out] The newly parse structured data.
+     * @return Returns the number of LLSD objects parsed into
+     * data. Returns PARSE_FAILURE (-1) on parse failure.
+     */
+    S32 parseBuffer(const char* buffer, size_t length, LLSD& data) const;
+
 protected:
     /** 
      * @brief Call this method to parse a stream for LLSD.
@@ -358,6 +412,24 @@ public:
      */
     LLSDBinaryParser();
 
+    /** 
+     * @brief Call this method to parse a contiguous buffer for LLSD.
+     *
+     * Unlike parse(), this reads straight from memory, such as the
+     * contents of a BufferArray or a mapped file, without an istream in
+     * between. Strings and binaries are built once from the bytes in
+     * place and the parsed values are allocated from an
+     * LLSD::ArenaScope. The end of the buffer is the only byte limit.
+     * @param buffer The binary formatted data, without a header.
+     * @param length The size of the buffer in bytes.
+     * @param data[out] The newly parse structured data. Undefined on failure.
+     * @param max_depth Max depth parser will check before exiting
+     *  with parse error, -1 - unlimited.
+     * @return Returns the number of LLSD objects parsed into
+     * data. Returns PARSE_FAILURE (-1) on parse failure.
+     */
+    S32 parseBuffer(const U8* buffer, size_t length, LLSD& data, S32 max_depth = -1) const;
+
 protected:
     /** 
      * @brief Call this method to parse a stream for LLSD.
@@ -406,6 +478,19 @@ private:
      * @return Retuns true if a complete string was parsed.
      */
     bool parseString(std::istream& istr, std::string& value) const;
+
+    /**
+     * @brief Read position in the buffer given to parseBuffer()
+     */
+    struct Cursor;
+
+    /**
+     * @brief The parseBuffer() counterparts of the istream methods above.
+     */
+    S32 doParse(Cursor& cursor, LLSD& data, S32 max_depth) const;
+    S32 parseMap(Cursor& cursor, LLSD& map, S32 max_depth) const;
+    S32 parseArray(Cursor& cursor, LLSD& array, S32 max_depth) const;
+    bool parseString(Cursor& cursor, std::string& value) const;
 };
 
 
@@ -790,6 +875,12 @@ public:
         (void)p->parse(str, sd, max_bytes);
         return sd;
     }
+    // Faster than the istream versions when the whole document is in memory
+    static S32 fromNotation(LLSD& sd, const char* buffer, size_t length, S32 max_depth = -1)
+    {
+        LLPointer<LLSDNotationParser> p = new LLSDNotationParser;
+        return p->parseBuffer(buffer, length, sd, max_depth);
+    }
     
     /*
      * XML Methods
@@ -825,6 +916,12 @@ public:
         return fromXMLEmbedded(sd, str, emit_errors);
 //      return fromXMLDocument(sd, str, emit_errors);
     }
+    // Faster than the istream versions when the whole document is in memory
+    static S32 fromXML(LLSD& sd, const char* buffer, size_t length, bool emit_errors=true)
+    {
+        LLPointer<LLSDXMLParser> p = new LLSDXMLParser(emit_errors);
+        return p->parseBuffer(buffer, length, sd);
+    }
 
     /*
      * Binary Methods
@@ -846,6 +943,12 @@ public:
         (void)p->parse(str, sd, max_bytes, max_depth);
         return sd;
     }
+    // Faster than the istream versions when the whole document is in memory
+    static S32 fromBinary(LLSD& sd, const U8* buffer, size_t length, S32 max_depth = -1)
+    {
+        LLPointer<LLSDBinaryParser> p = new LLSDBinaryParser;
+        return p->parseBuffer(buffer, length, sd, max_depth);
+    }
 };
 
 class LL_COMMON_API LLUZipHelper : public LLRefCount
@@ -27,10 +27,13 @@
 #include "linden_common.h"
 #include "llsdserialize_xml.h"
 
+#include <algorithm>
 #include <iostream>
 #include <deque>
 
 #include "apr_base64.h"
+#include "llsdscan.h"
+#include "llstring.h"
 #include <boost/regex.hpp>
 
 extern "C"
@@ -259,6 +262,7 @@ public:
     
     S32 parse(std::istream& input, LLSD& data);
     S32 parseLines(std::istream& input, LLSD& data);
+    S32 parseBuffer(const char* buffer, size_t length, LLSD& data);
 
     void parsePart(const char *buf, int len);
     
@@ -277,6 +281,11 @@ private:
         void* userData, const XML_Char* data, int length);
 
     void startSkipping();
+
+    // The buffer tokenizer, false if it leaves the buffer to expat
+    bool scanBuffer(const char* pos, const char* end);
+    bool scanCharacterData(const char*& pos, const char* end);
+    bool scanCDATA(const char*& pos, const char* end);
     
     enum Element {
         ELEMENT_LLSD,
@@ -901,6 +910,704 @@ LLSDXMLParser::Impl::Element LLSDXMLParser::Impl::readElement(const XML_Char* na
 
 
 
+/**
+ * LLSDXMLParser::Impl buffer scanning
+ *
+ * scanBuffer() tokenizes the well formed UTF-8 XML without a DTD that
+ * LLSD documents are made of. It calls the element and character data
+ * handlers above with the same arguments as expat would, so it builds the
+ * same result. On anything else, including input that is not well
+ * formed, it gives up and parseBuffer() hands the whole buffer to expat.
+ */
+static inline bool is_xml_space(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+// ASCII names only, anything fancier is left to expat
+static inline bool is_xml_name_start(char c)
+{
+    return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || (c == '_') || (c == ':');
+}
+
+static inline bool is_xml_name_char(char c)
+{
+    return is_xml_name_start(c) || ((c >= '0') && (c <= '9')) || (c == '-') || (c == '.');
+}
+
+static inline bool starts_with(const char* pos, const char* end, const char* prefix)
+{
+    size_t len = strlen(prefix);
+    return ((size_t)(end - pos) >= len) && (0 == memcmp(pos, prefix, len));
+}
+
+static inline const char* skip_xml_space(const char* pos, const char* end)
+{
+    while ((pos < end) && is_xml_space(*pos))
+    {
+        ++pos;
+    }
+    return pos;
+}
+
+static bool is_xml_char(U32 code)
+{
+    return (code == 0x9) || (code == 0xA) || (code == 0xD)
+        || ((code >= 0x20) && (code <= 0xD7FF))
+        || ((code >= 0xE000) && (code <= 0xFFFD))
+        || ((code >= 0x10000) && (code <= 0x10FFFF));
+}
+
+// Length of the UTF-8 sequence of a non ASCII XML character, 0 if it is
+// malformed or not an XML character.
+static size_t xml_utf8_length(const char* pos, const char* end)
+{
+    const U8* p = (const U8*)pos;
+    U8 lead = p[0];
+    U8 lo = 0x80;
+    U8 hi = 0xBF;
+    size_t len;
+    if (lead < 0xC2)
+    {
+        return 0;
+    }
+    else if (lead < 0xE0)
+    {
+        len = 2;
+    }
+    else if (lead < 0xF0)
+    {
+        len = 3;
+        if (lead == 0xE0) lo = 0xA0;        // overlong
+        else if (lead == 0xED) hi = 0x9F;   // surrogates
+    }
+    else if (lead < 0xF5)
+    {
+        len = 4;
+        if (lead == 0xF0) lo = 0x90;        // overlong
+        else if (lead == 0xF4) hi = 0x8F;   // above U+10FFFF
+    }
+    else
+    {
+        return 0;
+    }
+    if (((size_t)(end - pos) < len) || (p[1] < lo) || (p[1] > hi))
+    {
+        return 0;
+    }
+    for (size_t i = 2; i < len; ++i)
+    {
+        if ((p[i] & 0xC0) != 0x80)
+        {
+            return 0;
+        }
+    }
+    // U+FFFE and U+FFFF
+    if ((lead == 0xEF) && (p[1] == 0xBF) && (p[2] >= 0xBE))
+    {
+        return 0;
+    }
+    return len;
+}
+
+// Whether [pos, end) only holds XML characters
+static bool is_xml_text(const char* pos, const char* end)
+{
+    while (pos < end)
+    {
+        U8 c = (U8)*pos;
+        if (c >= 0x80)
+        {
+            size_t len = xml_utf8_length(pos, end);
+            if (!len)
+            {
+                return false;
+            }
+            pos += len;
+        }
+        else if ((c < 0x20) && !is_xml_space((char)c))
+        {
+            return false;
+        }
+        else
+        {
+            ++pos;
+        }
+    }
+    return true;
+}
+
+/**
+ * Decode the predefined entity or character reference starting at the
+ * '&' under pos into out, which must have room for 4 bytes, and return
+ * the number of bytes written or 0 if it is not one of those.
+ */
+static size_t decode_xml_reference(const char*& pos, const char* end, char* out)
+{
+    const size_t MAX_REFERENCE = 12;
+    const char* semicolon = (const char*)memchr(pos, ';', llmin((size_t)(end - pos), MAX_REFERENCE));
+    if (!semicolon)
+    {
+        return 0;
+    }
+    const char* name = pos + 1;
+    size_t name_len = semicolon - name;
+    size_t len = 1;
+    if ((name_len == 2) && !strncmp(name, "lt", 2)) out[0] = '<';
+    else if ((name_len == 2) && !strncmp(name, "gt", 2)) out[0] = '>';
+    else if ((name_len == 3) && !strncmp(name, "amp", 3)) out[0] = '&';
+    else if ((name_len == 4) && !strncmp(name, "quot", 4)) out[0] = '"';
+    else if ((name_len == 4) && !strncmp(name, "apos", 4)) out[0] = '\'';
+    else if ((name_len >= 2) && (name[0] == '#'))
+    {
+        bool hex = (name[1] == 'x');
+        const char* digit = name + (hex ? 2 : 1);
+        if (digit == semicolon)
+        {
+            return 0;
+        }
+        U32 code = 0;
+        for (; digit < semicolon; ++digit)
+        {
+            char c = *digit;
+            U32 value;
+            if ((c >= '0') && (c <= '9')) value = c - '0';
+            else if (hex && (c >= 'a') && (c <= 'f')) value = 10 + c - 'a';
+            else if (hex && (c >= 'A') && (c <= 'F')) value = 10 + c - 'A';
+            else return 0;
+            code = code * (hex ? 16 : 10) + value;
+            if (code > 0x10FFFF)
+            {
+                return 0;
+            }
+        }
+        if (!is_xml_char(code))
+        {
+            return 0;
+        }
+        if (code < 0x80)
+        {
+            out[0] = (char)code;
+        }
+        else if (code < 0x800)
+        {
+            out[0] = (char)(0xC0 | (code >> 6));
+            out[1] = (char)(0x80 | (code & 0x3F));
+            len = 2;
+        }
+        else if (code < 0x10000)
+        {
+            out[0] = (char)(0xE0 | (code >> 12));
+            out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+            out[2] = (char)(0x80 | (code & 0x3F));
+            len = 3;
+        }
+        else
+        {
+            out[0] = (char)(0xF0 | (code >> 18));
+            out[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+            out[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+            out[3] = (char)(0x80 | (code & 0x3F));
+            len = 4;
+        }
+    }
+    else
+    {
+        return 0;
+    }
+    pos = semicolon + 1;
+    return len;
+}
+
+// An attribute value up to the closing quote, normalized as expat does
+// for attributes without a declared type.
+static bool scan_xml_attribute_value(const char*& pos, const char* end, char quote, std::string& value)
+{
+    while (pos < end)
+    {
+        char c = *pos;
+        if (c == quote)
+        {
+            ++pos;
+            return true;
+        }
+        if (c == '&')
+        {
+            char decoded[4];
+            size_t len = decode_xml_reference(pos, end, decoded);
+            if (!len)
+            {
+                return false;
+            }
+            value.append(decoded, len);
+        }
+        else if (c == '\r')
+        {
+            value += ' ';
+            ++pos;
+            if ((pos < end) && (*pos == '\n'))
+            {
+                ++pos;
+            }
+        }
+        else if ((c == '\t') || (c == '\n'))
+        {
+            value += ' ';
+            ++pos;
+        }
+        else if ((U8)c >= 0x80)
+        {
+            size_t len = xml_utf8_length(pos, end);
+            if (!len)
+            {
+                return false;
+            }
+            value.append(pos, len);
+            pos += len;
+        }
+        else if ((c == '<') || ((U8)c < 0x20))
+        {
+            return false;
+        }
+        else
+        {
+            value += c;
+            ++pos;
+        }
+    }
+    return false;
+}
+
+// The XML declaration, accepted when it makes no difference to a parser
+// created for UTF-8: <?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+static bool skip_xml_declaration(const char*& pos, const char* end)
+{
+    static const char* const NAMES[] = { "version", "encoding", "standalone" };
+    const size_t NAME_COUNT = LL_ARRAY_SIZE(NAMES);
+    pos += 5; // "<?xml"
+    size_t next_name = 0;
+    while (true)
+    {
+        const char* space = pos;
+        pos = skip_xml_space(pos, end);
+        if (starts_with(pos, end, "?>"))
+        {
+            pos += 2;
+            // version is required
+            return (next_name > 0);
+        }
+        if (pos == space)
+        {
+            return false;
+        }
+        const char* name = pos;
+        while ((pos < end) && (*pos >= 'a') && (*pos <= 'z'))
+        {
+            ++pos;
+        }
+        std::string attribute(name, pos);
+        while ((next_name < NAME_COUNT) && (attribute != NAMES[next_name]))
+        {
+            if (next_name == 0)
+            {
+                return false;
+            }
+            ++next_name;
+        }
+        if (next_name == NAME_COUNT)
+        {
+            return false;
+        }
+        pos = skip_xml_space(pos, end);
+        if ((pos == end) || (*pos != '='))
+        {
+            return false;
+        }
+        pos = skip_xml_space(pos + 1, end);
+        if ((pos == end) || ((*pos != '"') && (*pos != '\'')))
+        {
+            return false;
+        }
+        char quote = *pos++;
+        const char* value_end = (const char*)memchr(pos, quote, end - pos);
+        if (!value_end)
+        {
+            return false;
+        }
+        std::string value(pos, value_end);
+        pos = value_end + 1;
+        bool valid = false;
+        switch (next_name)
+        {
+        case 0:
+            valid = (value == "1.0");
+            break;
+        case 1:
+            valid = (LLStringUtil::compareInsensitive(value, "utf-8") == 0);
+            break;
+        case 2:
+            valid = (value == "yes") || (value == "no");
+            break;
+        }
+        if (!valid)
+        {
+            return false;
+        }
+        ++next_name;
+    }
+}
+
+static bool skip_xml_comment(const char*& pos, const char* end)
+{
+    pos += 4; // "<!--"
+    const char* body = pos;
+    while (true)
+    {
+        const char* dash = (const char*)memchr(pos, '-', end - pos);
+        if (!dash || (end - dash < 3))
+        {
+            return false;
+        }
+        if (dash[1] == '-')
+        {
+            // "--" may only close the comment
+            if ((dash[2] != '>') || !is_xml_text(body, dash))
+            {
+                return false;
+            }
+            pos = dash + 3;
+            return true;
+        }
+        pos = dash + 1;
+    }
+}
+
+S32 LLSDXMLParser::Impl::parseBuffer(const char* buffer, size_t length, LLSD& data)
+{
+    reset();
+    {
+        LLSD::ArenaScope arena(length);
+        if (scanBuffer(buffer, buffer + length))
+        {
+            data = mResult;
+            return mParseCount;
+        }
+    }
+
+    reset();
+    XML_Status status = XML_Parse(mParser, buffer, (int)llmin(length, (size_t)S32_MAX), true);
+    // Like parse(), which always feeds expat the end of stream marker,
+    // only a document ended by </llsd> is a success.
+    if (!mGracefullStop)
+    {
+        if (mEmitErrors)
+        {
+            LL_INFOS() << "LLSDXMLParser::Impl::parseBuffer: "
+                << (status == XML_STATUS_ERROR ? XML_ErrorString(XML_GetErrorCode(mParser)) : "no </llsd>")
+                << " at line " << XML_GetCurrentLineNumber(mParser) << LL_ENDL;
+        }
+        data = LLSD();
+        return LLSDParser::PARSE_FAILURE;
+    }
+    data = mResult;
+    return mParseCount;
+}
+
+bool LLSDXMLParser::Impl::scanBuffer(const char* pos, const char* end)
+{
+    // the open elements, which the end tags must match
+    std::vector<std::pair<const char*, size_t> > open_elements;
+    std::string name;
+    std::vector<std::string> attribute_strings;
+    std::vector<const XML_Char*> attributes;
+
+    if (starts_with(pos, end, "<?xml") && (end - pos > 5) && is_xml_space(pos[5])
+        && !skip_xml_declaration(pos, end))
+    {
+        return false;
+    }
+
+    while (pos < end)
+    {
+        if (*pos != '<')
+        {
+            if (!open_elements.empty())
+            {
+                if (!scanCharacterData(pos, end))
+                {
+                    return false;
+                }
+            }
+            else if (is_xml_space(*pos))
+            {
+                ++pos;
+            }
+            else
+            {
+                // text outside of the root element
+                return false;
+            }
+            continue;
+        }
+
+        if (end - pos < 2)
+        {
+            return false;
+        }
+        if (pos[1] == '/')
+        {
+            pos += 2;
+            const char* name_begin = pos;
+            while ((pos < end) && is_xml_name_char(*pos))
+            {
+                ++pos;
+            }
+            size_t name_len = pos - name_begin;
+            pos = skip_xml_space(pos, end);
+            if ((pos == end) || (*pos != '>') || open_elements.empty()
+                || (open_elements.back().second != name_len)
+                || memcmp(open_elements.back().first, name_begin, name_len))
+            {
+                return false;
+            }
+            ++pos;
+            open_elements.pop_back();
+            name.assign(name_begin, name_len);
+            endElementHandler(name.c_str());
+            if (mGracefullStop)
+            {
+                return true;
+            }
+            if (open_elements.empty())
+            {
+                // the root element was not llsd
+                return false;
+            }
+        }
+        else if (pos[1] == '!')
+        {
+            if (starts_with(pos, end, "<!--"))
+            {
+                if (!skip_xml_comment(pos, end))
+                {
+                    return false;
+                }
+            }
+            else if (open_elements.empty() || !starts_with(pos, end, "<![CDATA[")
+                     || !scanCDATA(pos, end))
+            {
+                // document type declarations and misplaced sections
+                return false;
+            }
+        }
+        else
+        {
+            // a start tag, unless it is a processing instruction
+            ++pos;
+            const char* name_begin = pos;
+            if (!is_xml_name_start(*pos))
+            {
+                return false;
+            }
+            while ((pos < end) && is_xml_name_char(*pos))
+            {
+                ++pos;
+            }
+            size_t name_len = pos - name_begin;
+            attribute_strings.clear();
+            bool empty_element = false;
+            while (true)
+            {
+                const char* space = pos;
+                pos = skip_xml_space(pos, end);
+                if (pos == end)
+                {
+                    return false;
+                }
+                if (*pos == '>')
+                {
+                    ++pos;
+                    break;
+                }
+                if (*pos == '/')
+                {
+                    if ((end - pos < 2) || (pos[1] != '>'))
+                    {
+                        return false;
+                    }
+                    pos += 2;
+                    empty_element = true;
+                    break;
+                }
+                if ((pos == space) || !is_xml_name_start(*pos))
+                {
+                    return false;
+                }
+                const char* attribute_begin = pos;
+                while ((pos < end) && is_xml_name_char(*pos))
+                {
+                    ++pos;
+                }
+                std::string attribute(attribute_begin, pos);
+                for (size_t i = 0; i < attribute_strings.size(); i += 2)
+                {
+                    if (attribute_strings[i] == attribute)
+                    {
+                        return false;
+                    }
+                }
+                pos = skip_xml_space(pos, end);
+                if ((pos == end) || (*pos != '='))
+                {
+                    return false;
+                }
+                pos = skip_xml_space(pos + 1, end);
+                if ((pos == end) || ((*pos != '"') && (*pos != '\'')))
+                {
+                    return false;
+                }
+                char quote = *pos++;
+                std::string value;
+                if (!scan_xml_attribute_value(pos, end, quote, value))
+                {
+                    return false;
+                }
+                attribute_strings.push_back(attribute);
+                attribute_strings.push_back(value);
+            }
+
+            attributes.clear();
+            for (size_t i = 0; i < attribute_strings.size(); ++i)
+            {
+                attributes.push_back(attribute_strings[i].c_str());
+            }
+            attributes.push_back(NULL);
+            name.assign(name_begin, name_len);
+            startElementHandler(name.c_str(), &attributes[0]);
+            if (!empty_element)
+            {
+                open_elements.push_back(std::make_pair(name_begin, name_len));
+                continue;
+            }
+            endElementHandler(name.c_str());
+            if (mGracefullStop)
+            {
+                return true;
+            }
+            if (open_elements.empty())
+            {
+                return false;
+            }
+        }
+    }
+    // the buffer ended before </llsd>
+    return false;
+}
+
+bool LLSDXMLParser::Impl::scanCharacterData(const char*& pos, const char* end)
+{
+    while ((pos < end) && (*pos != '<'))
+    {
+        // plain text, multibyte characters included, goes out in one piece
+        const char* run = pos;
+        while (true)
+        {
+            pos = llsd::scan::find_xml_special(pos, end);
+            if (pos == end)
+            {
+                break;
+            }
+            if ((U8)*pos >= 0x80)
+            {
+                size_t len = xml_utf8_length(pos, end);
+                if (!len)
+                {
+                    return false;
+                }
+                pos += len;
+            }
+            else if (*pos == ']')
+            {
+                if (starts_with(pos, end, "]]>"))
+                {
+                    return false;
+                }
+                ++pos;
+            }
+            else
+            {
+                break;
+            }
+        }
+        if (pos != run)
+        {
+            characterDataHandler(run, (int)(pos - run));
+        }
+        if ((pos == end) || (*pos == '<'))
+        {
+            break;
+        }
+
+        if (*pos == '&')
+        {
+            char decoded[4];
+            size_t len = decode_xml_reference(pos, end, decoded);
+            if (!len)
+            {
+                return false;
+            }
+            characterDataHandler(decoded, (int)len);
+        }
+        else if (*pos == '\r')
+        {
+            // line breaks come out as a single newline
+            characterDataHandler("\n", 1);
+            ++pos;
+            if ((pos < end) && (*pos == '\n'))
+            {
+                ++pos;
+            }
+        }
+        else
+        {
+            // any other control character
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LLSDXMLParser::Impl::scanCDATA(const char*& pos, const char* end)
+{
+    pos += 9; // "<![CDATA["
+    static const char CDATA_END[] = "]]>";
+    const char* close = std::search(pos, end, CDATA_END, CDATA_END + 3);
+    if ((close == end) || !is_xml_text(pos, close))
+    {
+        return false;
+    }
+    while (pos < close)
+    {
+        const char* cr = (const char*)memchr(pos, '\r', close - pos);
+        if (!cr)
+        {
+            characterDataHandler(pos, (int)(close - pos));
+            break;
+        }
+        if (cr != pos)
+        {
+            characterDataHandler(pos, (int)(cr - pos));
+        }
+        characterDataHandler("\n", 1);
+        pos = cr + 1;
+        if ((pos < close) && (*pos == '\n'))
+        {
+            ++pos;
+        }
+    }
+    pos = close + 3;
+    return true;
+}
 
 
 /**
@@ -920,6 +1627,11 @@ void LLSDXMLParser::parsePart(const char *buf, int len)
     impl.parsePart(buf, len);
 }
 
+S32 LLSDXMLParser::parseBuffer(const char* buffer, size_t length, LLSD& data) const
+{
+    return impl.parseBuffer(buffer, length, data);
+}
+
 // virtual
 S32 LLSDXMLParser::doParse(std::istream& input, LLSD& data, S32 max_depth) const
 {
@@ -28,104 +28,41 @@
 #include "linden_common.h"
 
 #include "llstringtable.h"
-#include "llstl.h"
 
 LLStringTable gStringTable(32768);
 
-LLStringTableEntry::LLStringTableEntry(const char *str)
-: mString(NULL), mCount(1)
+namespace
 {
-    // Copy string
-    U32 length = (U32)strlen(str) + 1;   /*Flawfinder: ignore*/
-    length = llmin(length, MAX_STRINGS_LENGTH);
-    mString = new char[length];
-    strncpy(mString, str, length);   /*Flawfinder: ignore*/
-    mString[length - 1] = 0;
+    // Strings were always cut to MAX_STRINGS_LENGTH, terminator included
+    size_t table_length(const char* str)
+    {
+        return strnlen(str, MAX_STRINGS_LENGTH - 1);   /*Flawfinder: ignore*/
+    }
 }
 
-LLStringTableEntry::~LLStringTableEntry()
+LLStringTableEntry::LLStringTableEntry(const char *str, size_t length)
+: mString(const_cast<char*>(str)), mCount(0)
 {
-    delete [] mString;
-    mCount = 0;
 }
 
-LLStringTable::LLStringTable(int tablesize)
-: mUniqueEntries(0)
+bool LLStringTableEntry::decCount()
 {
-    S32 i;
-    if (!tablesize)
-        tablesize = 4096; // some arbitrary default
-    // Make sure tablesize is power of 2
-    for (i = 31; i>0; i--)
+    S32 count = mCount.load();
+    while (count > 0 && !mCount.compare_exchange_weak(count, count - 1))
     {
-        if (tablesize & (1<<i))
-        {
-            if (tablesize >= (3<<(i-1)))
-                tablesize = (1<<(i+1));
-            else
-                tablesize = (1<<i);
-            break;
-        }
     }
-    mMaxEntries = tablesize;
-
-#if !STRING_TABLE_HASH_MAP
-    // ALlocate strings
-    mStringList = new string_list_ptr_t[mMaxEntries];
-    // Clear strings
-    for (i = 0; i < mMaxEntries; i++)
-    {
-        mStringList[i] = NULL;
-    }
-#endif
+    return count == 1;
 }
 
-LLStringTable::~LLStringTable()
+LLStringTable::LLStringTable(int tablesize)
+:   mMaxEntries(tablesize ? tablesize : 4096), // some arbitrary default
+    mUniqueEntries(0),
+    mTable(tablesize ? tablesize : 4096)
 {
-#if !STRING_TABLE_HASH_MAP
-    if (mStringList)
-    {
-        for (S32 i = 0; i < mMaxEntries; i++)
-        {
-            if (mStringList[i])
-            {
-                string_list_t::iterator iter;
-                for (iter = mStringList[i]->begin(); iter != mStringList[i]->end(); iter++)
-                    delete *iter; // *iter = (LLStringTableEntry*)
-            }
-            delete mStringList[i];
-        }
-        delete [] mStringList;
-        mStringList = NULL;
-    }
-#else
-    // Need to clean up the string hash
-    for_each(mStringHash.begin(), mStringHash.end(), DeletePairedPointer());
-    mStringHash.clear();
-#endif
 }
 
-
-static U32 hash_my_string(const char *str, int max_entries)
+LLStringTable::~LLStringTable()
 {
-    U32 retval = 0;
-#if 0
-    while (*str)
-    {
-        retval <<= 1;
-        retval += *str++;
-    }
-#else
-    while (*str)
-    {
-        retval = (retval<<4) + *str;
-        U32 x = (retval & 0xf0000000);
-        if (x) retval = retval ^ (x>>24);
-        retval = retval & (~x);
-        str++;
-    }
-#endif
-    return (retval & (max_entries-1)); // max_entries is gauranteed to be power of 2
 }
 
 char* LLStringTable::checkString(const std::string& str)
@@ -155,43 +92,11 @@ LLStringTableEntry* LLStringTable::checkStringEntry(const char *str)
 {
     if (str)
     {
-        char *ret_val;
-        LLStringTableEntry  *entry;
-        U32                 hash_value = hash_my_string(str, mMaxEntries);
-#if STRING_TABLE_HASH_MAP
-#if 1 // Microsoft
-        string_hash_t::iterator lower = mStringHash.lower_bound(hash_value);
-        string_hash_t::iterator upper = mStringHash.upper_bound(hash_value);
-#else // stlport
-        std::pair<string_hash_t::iterator, string_hash_t::iterator> P = mStringHash.equal_range(hash_value);
-        string_hash_t::iterator lower = P.first;
-        string_hash_t::iterator upper = P.second;
-#endif
-        for (string_hash_t::iterator iter = lower; iter != upper; iter++)
-        {
-            entry = iter->second;
-            ret_val = entry->mString;
-            if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
-            {
-                return entry;
-            }
-        }
-#else
-        string_list_t       *strlist = mStringList[hash_value];
-        if (strlist)
+        LLStringTableEntry* entry = findEntry(str, table_length(str));
+        if (entry && entry->mCount > 0)
         {
-            string_list_t::iterator iter;
-            for (iter = strlist->begin(); iter != strlist->end(); iter++)
-            {
-                entry = *iter;
-                ret_val = entry->mString;
-                if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
-                {
-                    return entry;
-                }
-            }
+            return entry;
         }
-#endif
     }
     return NULL;
 }
@@ -225,63 +130,13 @@ LLStringTableEntry* LLStringTable::addStringEntry(const char *str)
 {
     if (str)
     {
-        char *ret_val = NULL;
-        LLStringTableEntry  *entry;
-        U32                 hash_value = hash_my_string(str, mMaxEntries);
-#if STRING_TABLE_HASH_MAP
-#if 1 // Microsoft
-        string_hash_t::iterator lower = mStringHash.lower_bound(hash_value);
-        string_hash_t::iterator upper = mStringHash.upper_bound(hash_value);
-#else // stlport
-        std::pair<string_hash_t::iterator, string_hash_t::iterator> P = mStringHash.equal_range(hash_value);
-        string_hash_t::iterator lower = P.first;
-        string_hash_t::iterator upper = P.second;
-#endif
-        for (string_hash_t::iterator iter = lower; iter != upper; iter++)
-        {
-            entry = iter->second;
-            ret_val = entry->mString;
-            if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
-            {
-                entry->incCount();
-                return entry;
-            }
-        }
-
-        // not found, so add!
-        LLStringTableEntry* newentry = new LLStringTableEntry(str);
-        ret_val = newentry->mString;
-        mStringHash.insert(string_hash_t::value_type(hash_value, newentry));
-#else
-        string_list_t       *strlist = mStringList[hash_value];
-
-        if (strlist)
+        LLStringTableEntry* entry = &mTable.insert(str, table_length(str))->mValue;
+        if (entry->mCount++ == 0)
         {
-            string_list_t::iterator iter;
-            for (iter = strlist->begin(); iter != strlist->end(); iter++)
-            {
-                entry = *iter;
-                ret_val = entry->mString;
-                if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
-                {
-                    entry->incCount();
-                    return entry;
-                }
-            }
+            // new, or back after its last removal
+            mUniqueEntries++;
         }
-        else
-        {
-            mStringList[hash_value] = new string_list_t;
-            strlist = mStringList[hash_value];
-        }
-
-        // not found, so add!
-        LLStringTableEntry *newentry = new LLStringTableEntry(str);
-        //ret_val = newentry->mString;
-        strlist->push_front(newentry);
-#endif
-        mUniqueEntries++;
-        return newentry;
+        return entry;
     }
     else
     {
@@ -293,66 +148,16 @@ void LLStringTable::removeString(const char *str)
 {
     if (str)
     {
-        char *ret_val;
-        LLStringTableEntry  *entry;
-        U32                 hash_value = hash_my_string(str, mMaxEntries);
-#if STRING_TABLE_HASH_MAP
-        {
-#if 1 // Microsoft
-            string_hash_t::iterator lower = mStringHash.lower_bound(hash_value);
-            string_hash_t::iterator upper = mStringHash.upper_bound(hash_value);
-#else // stlport
-            std::pair<string_hash_t::iterator, string_hash_t::iterator> P = mStringHash.equal_range(hash_value);
-            string_hash_t::iterator lower = P.first;
-            string_hash_t::iterator upper = P.second;
-#endif
-            for (string_hash_t::iterator iter = lower; iter != upper; iter++)
-            {
-                entry = iter->second;
-                ret_val = entry->mString;
-                if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
-                {
-                    if (!entry->decCount())
-                    {
-                        mUniqueEntries--;
-                        if (mUniqueEntries < 0)
-                        {
-                            LL_ERRS() << "LLStringTable:removeString trying to remove too many strings!" << LL_ENDL;
-                        }
-                        delete iter->second;
-                        mStringHash.erase(iter);
-                    }
-                    return;
-                }
-            }
-        }
-#else
-        string_list_t       *strlist = mStringList[hash_value];
-
-        if (strlist)
+        LLStringTableEntry* entry = findEntry(str, table_length(str));
+        if (entry && entry->decCount())
         {
-            string_list_t::iterator iter;
-            for (iter = strlist->begin(); iter != strlist->end(); iter++)
-            {
-                entry = *iter;
-                ret_val = entry->mString;
-                if (!strncmp(ret_val, str, MAX_STRINGS_LENGTH))
-                {
-                    if (!entry->decCount())
-                    {
-                        mUniqueEntries--;
-                        if (mUniqueEntries < 0)
-                        {
-                            LL_ERRS() << "LLStringTable:removeString trying to remove too many strings!" << LL_ENDL;
-                        }
-                        strlist->remove(entry);
-                        delete entry;
-                    }
-                    return;
-                }
-            }
+            mUniqueEntries--;
         }
-#endif
     }
 }
 
+LLStringTableEntry* LLStringTable::findEntry(const char* str, size_t length)
+{
+    const LLInternTable<LLStringTableEntry>::Entry* entry = mTable.find(str, length);
+    return entry ? const_cast<LLStringTableEntry*>(&entry->mValue) : NULL;
+}
@@ -30,33 +30,34 @@
 
 #include "lldefs.h"
 #include "llformat.h"
+#include "llinterntable.h"
 #include "llstl.h"
+#include <atomic>
 #include <list>
 #include <set>
 
-#if LL_WINDOWS
-# if (_MSC_VER >= 1300 && _MSC_VER < 1400)
-#  define STRING_TABLE_HASH_MAP 1
-# endif
-#else
-//# define STRING_TABLE_HASH_MAP 1
-#endif
-
 const U32 MAX_STRINGS_LENGTH = 256;
 
+// Lives in the LLStringTable it came from; mString is interned there.
 class LL_COMMON_API LLStringTableEntry
 {
 public:
-    LLStringTableEntry(const char *str);
-    ~LLStringTableEntry();
+    LLStringTableEntry(const char *str, size_t length);
 
     void incCount()     { mCount++; }
-    BOOL decCount()     { return --mCount; }
+    // Drops a reference, if there is any left. Returns true if it was the
+    // last one.
+    bool decCount();
 
     char *mString;
-    S32  mCount;
+    std::atomic<S32> mCount;
 };
 
+// Strings may be added, looked up and removed from any thread. Removing
+// the last reference only marks the entry unused: checkString() ignores
+// it until it is added again, at the same address. Removing a string more
+// often than it was added does nothing. mUniqueEntries may lag behind
+// while the same string is being added and removed at once.
 class LL_COMMON_API LLStringTable
 {
 public:
@@ -75,20 +76,12 @@ public:
     void  removeString(const char *str);
 
     S32 mMaxEntries;
-    S32 mUniqueEntries;
-    
-#if STRING_TABLE_HASH_MAP
-#if LL_WINDOWS
-    typedef std::hash_multimap<U32, LLStringTableEntry *> string_hash_t;
-#else
-    typedef __gnu_cxx::hash_multimap<U32, LLStringTableEntry *> string_hash_t;
-#endif
-    string_hash_t mStringHash;
-#else
-    typedef std::list<LLStringTableEntry *> string_list_t;
-    typedef string_list_t * string_list_ptr_t;
-    string_list_ptr_t   *mStringList;
-#endif  
+    std::atomic<S32> mUniqueEntries;
+
+private:
+    LLStringTableEntry* findEntry(const char* str, size_t length);
+
+    LLInternTable<LLStringTableEntry> mTable;
 };
 
 extern LL_COMMON_API LLStringTable gStringTable;
@@ -105,67 +98,29 @@ class LL_COMMON_API LLStdStringTable
 {
 public:
     LLStdStringTable(S32 tablesize = 0)
+    :   mTable(tablesize ? tablesize : 256) // default
     {
-        if (tablesize == 0)
-        {
-            tablesize = 256; // default
-        }
-        // Make sure tablesize is power of 2
-        for (S32 i = 31; i>0; i--)
-        {
-            if (tablesize & (1<<i))
-            {
-                if (tablesize >= (3<<(i-1)))
-                    tablesize = (1<<(i+1));
-                else
-                    tablesize = (1<<i);
-                break;
-            }
-        }
-        mTableSize = tablesize;
-        mStringList = new string_set_t[tablesize];
-    }
-    ~LLStdStringTable()
-    {
-        cleanup();
-        delete[] mStringList;
     }
     void cleanup()
     {
         // remove strings
-        for (S32 i = 0; i<mTableSize; i++)
-        {
-            string_set_t& stringset = mStringList[i];
-            for (string_set_t::iterator iter = stringset.begin(); iter != stringset.end(); iter++)
-            {
-                delete *iter;
-            }
-            stringset.clear();
-        }
+        mTable.clear();
     }
 
-    LLStdStringHandle lookup(const std::string& s)
+    LLStdStringHandle lookup(const std::string& s) const
     {
-        U32 hashval = makehash(s);
-        return lookup(hashval, s);
+        const string_table_t::Entry* entry = mTable.find(s);
+        return entry ? &entry->mValue : NULL;
     }
     
-    LLStdStringHandle checkString(const std::string& s)
+    LLStdStringHandle checkString(const std::string& s) const
     {
-        U32 hashval = makehash(s);
-        return lookup(hashval, s);
+        return lookup(s);
     }
 
     LLStdStringHandle insert(const std::string& s)
     {
-        U32 hashval = makehash(s);
-        LLStdStringHandle result = lookup(hashval, s);
-        if (result == NULL)
-        {
-            result = new std::string(s);
-            mStringList[hashval].insert(result);
-        }
-        return result;
+        return &mTable.insert(s)->mValue;
     }
     LLStdStringHandle addString(const std::string& s)
     {
@@ -173,36 +128,8 @@ public:
     }
     
 private:
-    U32 makehash(const std::string& s)
-    {
-        S32 len = (S32)s.size();
-        const char* c = s.c_str();
-        U32 hashval = 0;
-        for (S32 i=0; i<len; i++)
-        {
-            hashval = ((hashval<<5) + hashval) + *c++;
-        }
-        return hashval & (mTableSize-1);
-    }
-    LLStdStringHandle lookup(U32 hashval, const std::string& s)
-    {
-        string_set_t& stringset = mStringList[hashval];
-        LLStdStringHandle handle = &s;
-        string_set_t::iterator iter = stringset.find(handle); // compares actual strings
-        if (iter != stringset.end())
-        {
-            return *iter;
-        }
-        else
-        {
-            return NULL;
-        }
-    }
-    
-private:
-    S32 mTableSize;
-    typedef std::set<LLStdStringHandle, compare_pointer_contents<std::string> > string_set_t;
-    string_set_t* mStringList; // [mTableSize]
+    typedef LLInternTable<std::string> string_table_t;
+    string_table_t mTable;
 };
 
 
@@ -0,0 +1,175 @@
+/**
+ * @file   lockfreequeue.h
+ * @brief  Bounded multi-producer, multi-consumer queue that takes no locks.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Copyright (c) 2022, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+#if ! defined(LL_LOCKFREEQUEUE_H)
+#define LL_LOCKFREEQUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace LL
+{
+    /**
+     * LockFreeQueue is a fixed size ring buffer of slots, each tagged with a
+     * sequence number telling whether it is ready to be written or read on
+     * the current lap (Dmitry Vyukov's bounded MPMC queue). Producers and
+     * consumers each claim a slot with one compare-and-swap on their end of
+     * the ring, so a producer never waits on a consumer or the other way
+     * around, except for an item in the middle of being moved in or out.
+     *
+     * There is no blocking API: tryPush() fails when the ring is full and
+     * tryPop() when it is empty. Items are popped in the order their slots
+     * were claimed.
+     */
+    template <typename T>
+    class LockFreeQueue
+    {
+    public:
+        typedef T value_type;
+
+        /// capacity is rounded up to a power of 2
+        LockFreeQueue(size_t capacity=1024):
+            mMask(roundCapacity(capacity) - 1),
+            mCells(new Cell[mMask + 1]),
+            mEnqueuePos(0),
+            mDequeuePos(0)
+        {
+            for (size_t i = 0; i <= mMask; ++i)
+            {
+                mCells[i].mSequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        ~LockFreeQueue()
+        {
+            T item;
+            while (tryPop(item))
+            {
+            }
+        }
+
+        LockFreeQueue(const LockFreeQueue&) = delete;
+        LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+        /// Returns false, leaving item untouched, if the queue is full
+        template <typename U>
+        bool tryPush(U&& item)
+        {
+            Cell* cell;
+            size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                cell = &mCells[pos & mMask];
+                size_t seq = cell->mSequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                if (diff == 0)
+                {
+                    // slot free on this lap: try to claim it
+                    if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                {
+                    // slot still holds the item from the previous lap: full
+                    return false;
+                }
+                else
+                {
+                    // another producer claimed it, catch up
+                    pos = mEnqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            new (&cell->mStorage) T(std::forward<U>(item));
+            cell->mSequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// Returns false if the queue is empty
+        bool tryPop(T& item)
+        {
+            Cell* cell;
+            size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                cell = &mCells[pos & mMask];
+                size_t seq = cell->mSequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+                if (diff == 0)
+                {
+                    if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                {
+                    // nothing written to this slot on this lap: empty
+                    return false;
+                }
+                else
+                {
+                    pos = mDequeuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            T* stored = reinterpret_cast<T*>(&cell->mStorage);
+            item = std::move(*stored);
+            stored->~T();
+            // free the slot for the producer on the next lap
+            cell->mSequence.store(pos + mMask + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Only a snapshot: other threads may push or pop before the caller
+         * gets to look at it.
+         */
+        size_t size() const
+        {
+            size_t dequeued = mDequeuePos.load(std::memory_order_acquire);
+            size_t enqueued = mEnqueuePos.load(std::memory_order_acquire);
+            return (enqueued > dequeued)? enqueued - dequeued : 0;
+        }
+
+        bool empty() const { return size() == 0; }
+
+        size_t capacity() const { return mMask + 1; }
+
+    private:
+        static size_t roundCapacity(size_t capacity)
+        {
+            size_t rounded = 2;
+            while (rounded < capacity)
+            {
+                rounded <<= 1;
+            }
+            return rounded;
+        }
+
+        struct Cell
+        {
+            std::atomic<size_t> mSequence;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type mStorage;
+        };
+
+        // keep the two ends of the ring on their own cache lines
+        static const size_t CACHE_LINE_SIZE = 64;
+
+        const size_t mMask;
+        std::unique_ptr<Cell[]> mCells;
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> mEnqueuePos;
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> mDequeuePos;
+    };
+
+} // namespace LL
+
+#endif /* ! defined(LL_LOCKFREEQUEUE_H) */
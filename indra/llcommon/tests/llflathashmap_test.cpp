@@ -0,0 +1,145 @@
+/**
+ * @file   llflathashmap_test.cpp
+ * @brief  Test for LLFlatHashMap against std::map.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Copyright (c) 2022, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "llflathashmap.h"
+// STL headers
+#include <map>
+#include <string>
+// std headers
+#include <cstdlib>
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+
+namespace
+{
+    typedef LLFlatHashMap<U32, U32> map_t;
+    typedef std::map<U32, U32> ref_map_t;
+
+    // Every entry of one map is in the other with the same value
+    bool same(const map_t& map, const ref_map_t& ref)
+    {
+        if (map.size() != ref.size())
+        {
+            return false;
+        }
+        size_t visited = 0;
+        for (map_t::const_iterator it = map.begin(); it != map.end(); ++it, ++visited)
+        {
+            ref_map_t::const_iterator found = ref.find(it->first);
+            if (found == ref.end() || found->second != it->second)
+            {
+                return false;
+            }
+        }
+        return visited == ref.size();
+    }
+}
+
+namespace tut
+{
+    struct llflathashmap_data
+    {
+    };
+    typedef test_group<llflathashmap_data> llflathashmap_group;
+    typedef llflathashmap_group::object object;
+    llflathashmap_group llflathashmapgrp("llflathashmap");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("basic operations");
+        map_t map;
+        ensure("starts empty", map.empty());
+        ensure("find in empty", map.find(7) == map.end());
+        ensure_equals("get default", map.get(7, 42), 42U);
+
+        map[7] = 70;
+        ensure("insert new", map.insert(map_t::value_type(8, 80)).second);
+        ensure("insert existing", !map.insert(map_t::value_type(8, 81)).second);
+        ensure_equals("size", map.size(), 2U);
+        ensure_equals("operator[]", map[7], 70U);
+        ensure_equals("insert keeps value", map.get(8), 80U);
+        ensure_equals("count", map.count(8), 1U);
+        ensure_equals("erase", map.erase(7), 1U);
+        ensure_equals("erase missing", map.erase(7), 0U);
+        ensure("erased", map.find(7) == map.end());
+        ensure("other stays", map.find(8) != map.end());
+
+        map.clear();
+        ensure("cleared", map.empty() && map.begin() == map.end());
+
+        LLFlatHashMap<std::string, std::string> strings;
+        strings["hello"] = "world";
+        ensure_equals("string key", strings.get("hello"), std::string("world"));
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("random inserts and erases match std::map");
+        map_t map;
+        ref_map_t ref;
+        srand(1234);
+        for (S32 i = 0; i < 20000; ++i)
+        {
+            // small key range so runs collide and erases shift entries back
+            U32 key = rand() % 512;
+            if (rand() % 3)
+            {
+                map[key] = i;
+                ref[key] = i;
+            }
+            else
+            {
+                ensure_equals("erase result", map.erase(key), ref.erase(key));
+            }
+            if (i % 1000 == 0)
+            {
+                ensure("maps agree", same(map, ref));
+            }
+        }
+        for (ref_map_t::iterator it = ref.begin(); it != ref.end(); ++it)
+        {
+            ensure("find", map.find(it->first) != map.end());
+        }
+        ensure("maps agree", same(map, ref));
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("eraseIf");
+        map_t map;
+        ref_map_t ref;
+        for (U32 i = 0; i < 1000; ++i)
+        {
+            // sequential ids, like packet ids
+            map[100000 + i] = i;
+            ref[100000 + i] = i;
+        }
+        size_t erased = map.eraseIf([](const map_t::value_type& entry) { return entry.second % 3 == 0; });
+        for (ref_map_t::iterator it = ref.begin(); it != ref.end(); )
+        {
+            if (it->second % 3 == 0)
+            {
+                ref.erase(it++);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        ensure_equals("erased count", erased, 334U);
+        ensure("maps agree", same(map, ref));
+    }
+} // namespace tut
@@ -0,0 +1,368 @@
+/**
+ * @file   llinterntable_test.cpp
+ * @brief  Test for LLInternTable and the string tables built on it, with a
+ *         benchmark against the bucket lists and sets they replace.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Copyright (c) 2022, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "llinterntable.h"
+// STL headers
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+// std headers
+#include <chrono>
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+#include "llstl.h"
+#include "llstringtable.h"
+#include "stringize.h"
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // Distinct names per benchmark, about what the UI XML interns
+    const U32 BENCH_NAMES = 4000;
+    // Lookups of existing names per benchmark run
+    const U32 BENCH_LOOKUPS = 1000000;
+    const U32 BENCH_THREADS = 4;
+
+    std::vector<std::string> make_names(U32 count, const std::string& prefix)
+    {
+        std::vector<std::string> names;
+        for (U32 i = 0; i < count; ++i)
+        {
+            names.push_back(stringize(prefix, "_", i % 7 ? "attribute" : "node", "_", i));
+        }
+        return names;
+    }
+
+    // LLStringTable as it was: an array of lists of separately allocated
+    // copies
+    class OldStringTable
+    {
+    public:
+        OldStringTable(U32 size) : mLists(size) {}
+        ~OldStringTable()
+        {
+            for (auto& list : mLists)
+            {
+                for (char* str : list)
+                {
+                    delete[] str;
+                }
+            }
+        }
+
+        char* addString(const char* str)
+        {
+            std::list<char*>& list = mLists[hash(str)];
+            for (char* entry : list)
+            {
+                if (!strncmp(entry, str, MAX_STRINGS_LENGTH))
+                {
+                    return entry;
+                }
+            }
+            size_t length = llmin(strlen(str) + 1, (size_t)MAX_STRINGS_LENGTH);
+            char* copy = new char[length];
+            strncpy(copy, str, length);
+            copy[length - 1] = 0;
+            list.push_front(copy);
+            return copy;
+        }
+
+    private:
+        U32 hash(const char* str) const
+        {
+            U32 retval = 0;
+            while (*str)
+            {
+                retval = (retval<<4) + *str;
+                U32 x = (retval & 0xf0000000);
+                if (x) retval = retval ^ (x>>24);
+                retval = retval & (~x);
+                str++;
+            }
+            return retval & ((U32)mLists.size() - 1);
+        }
+
+        std::vector<std::list<char*> > mLists;
+    };
+
+    // LLStdStringTable as it was: an array of sets of std::string pointers
+    class OldStdStringTable
+    {
+    public:
+        typedef std::set<LLStdStringHandle, compare_pointer_contents<std::string> > string_set_t;
+
+        OldStdStringTable(U32 size) : mSets(size) {}
+        ~OldStdStringTable()
+        {
+            for (auto& set : mSets)
+            {
+                for (LLStdStringHandle str : set)
+                {
+                    delete str;
+                }
+            }
+        }
+
+        LLStdStringHandle insert(const std::string& s)
+        {
+            string_set_t& set = mSets[hash(s)];
+            string_set_t::iterator it = set.find(&s);
+            if (it != set.end())
+            {
+                return *it;
+            }
+            LLStdStringHandle result = new std::string(s);
+            set.insert(result);
+            return result;
+        }
+
+    private:
+        U32 hash(const std::string& s) const
+        {
+            U32 hashval = 0;
+            for (char c : s)
+            {
+                hashval = ((hashval<<5) + hashval) + c;
+            }
+            return hashval & ((U32)mSets.size() - 1);
+        }
+
+        std::vector<string_set_t> mSets;
+    };
+
+    // Seconds to look up BENCH_LOOKUPS names, split over threads, each
+    // through intern(name)
+    template <typename FUNC>
+    F64 bench(const std::vector<std::string>& names, U32 threads, FUNC intern)
+    {
+        Clock::time_point start = Clock::now();
+        std::vector<std::thread> workers;
+        for (U32 t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&names, &intern, threads, t]()
+                {
+                    for (U32 i = t; i < BENCH_LOOKUPS; i += threads)
+                    {
+                        intern(names[(i * 7919) % names.size()]);
+                    }
+                });
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        return std::chrono::duration<F64>(Clock::now() - start).count();
+    }
+}
+
+namespace tut
+{
+    struct llinterntable_data
+    {
+    };
+    typedef test_group<llinterntable_data> llinterntable_group;
+    typedef llinterntable_group::object object;
+    llinterntable_group llinterntablegrp("llinterntable");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("intern and find");
+        LLInternTable<> table(4);
+        ensure("empty find", table.find("abc") == NULL);
+        ensure_equals("empty size", table.size(), 0);
+
+        const LLInternTable<>::Entry* abc = table.insert("abc");
+        ensure_equals("string", std::string(abc->getString()), "abc");
+        ensure_equals("length", abc->getLength(), 3);
+        ensure("same entry", table.insert(std::string("abc")) == abc);
+        ensure("found", table.find("abc") == abc);
+        ensure("prefix", table.find("ab") == NULL);
+        ensure("longer", table.find("abcd") == NULL);
+
+        const LLInternTable<>::Entry* empty = table.insert("");
+        ensure("empty string", empty != abc && empty->getLength() == 0 && !*empty->getString());
+        ensure("embedded nul", table.insert(std::string("ab\0c", 4)) != table.insert("ab"));
+
+        // longer than an arena block
+        std::string big(40000, 'x');
+        const LLInternTable<>::Entry* big_entry = table.insert(big);
+        ensure_equals("big string", std::string(big_entry->getString()), big);
+
+        // more entries than buckets, and the first ones do not move
+        std::vector<std::string> names = make_names(2000, "test");
+        std::vector<const LLInternTable<>::Entry*> entries;
+        for (const std::string& name : names)
+        {
+            entries.push_back(table.insert(name));
+        }
+        ensure("stable", table.find("abc") == abc && table.find(big) == big_entry);
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            ensure("many", table.find(names[i]) == entries[i]);
+        }
+        ensure_equals("size", table.size(), names.size() + 5);
+
+        size_t visited = 0;
+        table.forEach([&visited](const LLInternTable<>::Entry&) { ++visited; });
+        ensure_equals("forEach", visited, table.size());
+
+        table.clear();
+        ensure_equals("cleared size", table.size(), 0);
+        ensure("cleared find", table.find("abc") == NULL);
+        ensure_equals("reinsert", std::string(table.insert("abc")->getString()), "abc");
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("LLStringTable reference counts");
+        LLStringTable table(16);
+        ensure("not added", table.checkString("name") == NULL);
+
+        char* name = table.addString("name");
+        ensure_equals("added", std::string(name), "name");
+        ensure("same string", table.addString(std::string("name")) == name);
+        ensure("checked", table.checkString("name") == name);
+        ensure_equals("unique", table.mUniqueEntries.load(), 1);
+
+        table.removeString("name");
+        ensure("still referenced", table.checkString("name") == name);
+        table.removeString("name");
+        ensure("removed", table.checkString("name") == NULL);
+        ensure_equals("none left", table.mUniqueEntries.load(), 0);
+        table.removeString("name");
+        ensure_equals("removed twice", table.mUniqueEntries.load(), 0);
+
+        ensure("added back", table.addString("name") == name);
+        ensure_equals("unique again", table.mUniqueEntries.load(), 1);
+
+        // long strings are cut, and found again
+        std::string long_name(300, 'y');
+        char* cut = table.addString(long_name);
+        ensure_equals("cut", strlen(cut), MAX_STRINGS_LENGTH - 1);
+        ensure("long found", table.checkString(long_name) == cut);
+        ensure("NULL", table.addString((const char*)NULL) == NULL && table.checkString((const char*)NULL) == NULL);
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("LLStdStringTable");
+        LLStdStringTable table;
+        ensure("not inserted", table.lookup("name") == NULL);
+        LLStdStringHandle name = table.insert("name");
+        ensure_equals("inserted", *name, "name");
+        ensure("same handle", table.addString("name") == name);
+        ensure("lookup", table.checkString("name") == name);
+        table.cleanup();
+        ensure("cleaned up", table.lookup("name") == NULL);
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        set_test_name("concurrent interning");
+        LLInternTable<std::string> table(64);
+        std::vector<std::string> names = make_names(5000, "shared");
+        std::vector<std::vector<LLStdStringHandle> > handles(BENCH_THREADS);
+        std::vector<std::thread> threads;
+        for (U32 t = 0; t < BENCH_THREADS; ++t)
+        {
+            threads.emplace_back([&table, &names, &handles, t]()
+                {
+                    std::vector<LLStdStringHandle>& mine = handles[t];
+                    mine.resize(names.size());
+                    // every thread in its own order, all adding the same
+                    // names: steps prime to the name count visit them all
+                    const size_t steps[] = { 1, 3, 7, 11 };
+                    for (size_t n = 0; n < names.size(); ++n)
+                    {
+                        size_t i = (n * steps[t % 4] + t * 977) % names.size();
+                        mine[i] = &table.insert(names[i])->mValue;
+                    }
+                });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        ensure_equals("each name once", table.size(), names.size());
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            ensure_equals("value", *handles[0][i], names[i]);
+            for (U32 t = 1; t < BENCH_THREADS; ++t)
+            {
+                ensure("same handle on every thread", handles[t][i] == handles[0][i]);
+            }
+        }
+    }
+
+    template<> template<>
+    void object::test<5>()
+    {
+        set_test_name("benchmark against the previous tables");
+        std::vector<std::string> names = make_names(BENCH_NAMES, "bench");
+
+        OldStringTable old_table(32768);
+        LLStringTable table(32768);
+        OldStdStringTable old_std_table(1024);
+        LLStdStringTable std_table(1024);
+        for (const std::string& name : names)
+        {
+            old_table.addString(name.c_str());
+            table.addString(name);
+            old_std_table.insert(name);
+            std_table.insert(name);
+        }
+
+        // Run each twice, keep the best, to smooth over scheduling noise
+        auto best = [&names](U32 threads, auto intern)
+        {
+            return std::min(bench(names, threads, intern), bench(names, threads, intern));
+        };
+        F64 old_time = best(1, [&old_table](const std::string& name) { old_table.addString(name.c_str()); });
+        F64 new_time = best(1, [&table](const std::string& name) { table.checkString(name); });
+        F64 old_std_time = best(1, [&old_std_table](const std::string& name) { old_std_table.insert(name); });
+        F64 new_std_time = best(1, [&std_table](const std::string& name) { std_table.insert(name); });
+
+        // The old tables could only be shared behind a lock
+        std::mutex mutex;
+        F64 old_shared_time = best(BENCH_THREADS, [&old_table, &mutex](const std::string& name)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                old_table.addString(name.c_str());
+            });
+        LLInternTable<> shared_table(32768);
+        F64 new_shared_time = best(BENCH_THREADS, [&shared_table](const std::string& name)
+            {
+                shared_table.insert(name);
+            });
+
+        LL_INFOS("LLInternTable") << BENCH_LOOKUPS << " lookups of " << BENCH_NAMES << " names: "
+                                  << "LLStringTable lists " << old_time << "s, interned " << new_time << "s; "
+                                  << "LLStdStringTable sets " << old_std_time << "s, interned " << new_std_time << "s" << LL_ENDL;
+        LL_INFOS("LLInternTable") << BENCH_THREADS << " threads: locked lists " << old_shared_time
+                                  << "s, lock free " << new_shared_time << "s" << LL_ENDL;
+
+        // Timings depend on the machine, only check that the runs completed
+        ensure("no time measured", old_time > 0.0 && new_time > 0.0 && old_shared_time > 0.0 && new_shared_time > 0.0);
+    }
+} // namespace tut
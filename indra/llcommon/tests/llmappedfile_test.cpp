@@ -0,0 +1,106 @@
+/**
+ * @file   llmappedfile_test.cpp
+ * @brief  Test for llmappedfile.
+ * 
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Copyright (c) 2022, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "llmappedfile.h"
+// STL headers
+// std headers
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+#include "llfile.h"
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct llmappedfile_data
+    {
+        std::string mFilename;
+
+        llmappedfile_data():
+            mFilename(std::string(LLFile::tmpdir()) + "llmappedfile_test.dat")
+        {
+            LLFile::remove(mFilename);
+        }
+
+        ~llmappedfile_data()
+        {
+            LLFile::remove(mFilename);
+        }
+
+        S64 fileSize()
+        {
+            llstat file_status;
+            return LLFile::stat(mFilename, &file_status) == 0 ? file_status.st_size : -1;
+        }
+    };
+    typedef test_group<llmappedfile_data> llmappedfile_group;
+    typedef llmappedfile_group::object object;
+    llmappedfile_group llmappedfilegrp("llmappedfile");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("create and write through");
+        LLMappedFile file;
+        ensure("mapped", file.open(mFilename, 4096));
+        ensure_equals("size", file.getSize(), 4096);
+        ensure_equals("file grown", fileSize(), 4096);
+        ensure_equals("zero filled", file.getData()[4095], 0);
+
+        memcpy(file.getData() + 100, "mapped", 6);
+        ensure("flush", file.flush(true));
+        file.close();
+        ensure("closed", !file.isMapped());
+
+        char buffer[6];
+        LLFILE* fp = LLFile::fopen(mFilename, "rb");
+        ensure("reopened", fp != NULL);
+        fseek(fp, 100, SEEK_SET);
+        ensure_equals("read", fread(buffer, 1, 6, fp), 6);
+        fclose(fp);
+        ensure("written through", memcmp(buffer, "mapped", 6) == 0);
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("existing file is kept whole");
+        LLMappedFile file;
+        ensure("mapped", file.open(mFilename, 8192));
+        file.getData()[8191] = 42;
+        file.close();
+
+        // a smaller minimum neither truncates nor hides the end of the file
+        ensure("remapped", file.open(mFilename, 100));
+        ensure_equals("whole file", file.getSize(), 8192);
+        ensure_equals("kept", file.getData()[8191], 42);
+        file.close();
+
+        ensure("read only", file.open(mFilename, 0, true));
+        ensure("is read only", file.isReadOnly());
+        ensure_equals("read only size", file.getSize(), 8192);
+        ensure_equals("read only data", file.getData()[8191], 42);
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("failures");
+        LLMappedFile file;
+        ensure("missing read only file", !file.open(mFilename, 100, true));
+        ensure("empty file", !file.open(mFilename, 0));
+        ensure("not mapped", !file.isMapped());
+        ensure("flush unmapped", !file.flush());
+    }
+}
@@ -56,6 +56,7 @@ using namespace boost::phoenix;
 #include "../llsdserialize.h"
 #include "llsdutil.h"
 #include "../llformat.h"
+#include "lltimer.h"
 
 #include "../test/lltut.h"
 #include "../test/namedtempfile.h"
@@ -512,6 +513,114 @@ namespace tut
     }
 
 
+    // Deterministic so that a failing document can be reproduced
+    U32 next_random(U32& seed)
+    {
+        seed = seed * 1664525 + 1013904223;
+        return seed >> 8;
+    }
+
+    // Strings full of what the text formats have to escape or normalize
+    std::string random_string(U32& seed, bool xml)
+    {
+        static const char* const PIECES[] = {
+            "abc", "XYZ", " ", "019", "'", "\"", "\\", "<", ">", "&", "]]>", ";",
+            "\r", "\n", "\r\n", "\t", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80",
+            "\x01", "\x7f", "s(3)", "&amp;", "&#65;", "b64" };
+        std::string value;
+        S32 pieces = next_random(seed) % 12;
+        for (S32 i = 0; i < pieces; ++i)
+        {
+            const char* piece = PIECES[next_random(seed) % LL_ARRAY_SIZE(PIECES)];
+            if (xml && (piece[0] == '\x01'))
+            {
+                // XML can't carry most control characters
+                continue;
+            }
+            value += piece;
+        }
+        return value;
+    }
+
+    LLSD random_llsd(U32& seed, S32 depth, bool xml)
+    {
+        U32 type = next_random(seed) % (depth > 0 ? 12 : 10);
+        switch (type)
+        {
+        case 0: return LLSD();
+        case 1: return LLSD((bool)(next_random(seed) & 1));
+        case 2: return LLSD((S32)(next_random(seed) - (1 << 23)));
+        case 3:
+        {
+            static const F64 REALS[] = { 0.0, -0.0, 1.5, -2.25, 1e300, -1e-300, 0.1, 123456789.125 };
+            if (next_random(seed) & 1)
+            {
+                return LLSD(REALS[next_random(seed) % LL_ARRAY_SIZE(REALS)]);
+            }
+            return LLSD((F64)(S32)next_random(seed) / 7.0);
+        }
+        case 4:
+        {
+            LLUUID id;
+            id.generate(llformat("%u", next_random(seed)));
+            return LLSD(id);
+        }
+        case 5:
+        case 6: return LLSD(random_string(seed, xml));
+        case 7: return LLSD(LLDate((F64)(next_random(seed) % 2000000000)));
+        case 8: return LLSD(LLURI("http://example.com/" + LLURI::escape(random_string(seed, xml))));
+        case 9:
+        {
+            LLSD::Binary binary(next_random(seed) % 40);
+            for (size_t i = 0; i < binary.size(); ++i)
+            {
+                binary[i] = (U8)next_random(seed);
+            }
+            return LLSD(binary);
+        }
+        case 10:
+        {
+            LLSD map = LLSD::emptyMap();
+            S32 count = next_random(seed) % 6;
+            for (S32 i = 0; i < count; ++i)
+            {
+                map[random_string(seed, xml)] = random_llsd(seed, depth - 1, xml);
+            }
+            return map;
+        }
+        default:
+        {
+            LLSD array = LLSD::emptyArray();
+            S32 count = next_random(seed) % 6;
+            for (S32 i = 0; i < count; ++i)
+            {
+                array.append(random_llsd(seed, depth - 1, xml));
+            }
+            return array;
+        }
+        }
+    }
+
+    // Cut short or with a byte overwritten by something the parsers react to
+    std::string mutate(U32& seed, const std::string& text, const char* replacements)
+    {
+        if (text.empty())
+        {
+            return text;
+        }
+        std::string mutated(text);
+        size_t pos = next_random(seed) % mutated.size();
+        if (next_random(seed) & 1)
+        {
+            mutated.resize(pos);
+        }
+        else
+        {
+            mutated[pos] = replacements[next_random(seed) % strlen(replacements)];
+        }
+        return mutated;
+    }
+
     /**
      * @class TestLLSDParsing
      * @brief Base class for of a parse tester.
@@ -560,6 +669,23 @@ namespace tut
     {
     public:
         TestLLSDXMLParsing() {}
+
+        // Every XML parse is checked against the buffer parser as well
+        void ensureParse(
+            const std::string& msg,
+            const std::string& in,
+            const LLSD& expected_value,
+            S32 expected_count,
+            S32 depth_limit = -1)
+        {
+            TestLLSDParsing<LLSDXMLParser>::ensureParse(
+                msg, in, expected_value, expected_count, depth_limit);
+
+            LLSD parsed_result;
+            S32 parsed_count = mParser->parseBuffer(in.data(), in.size(), parsed_result);
+            ensure_equals((msg + " (buffer)").c_str(), parsed_result, expected_value);
+            ensure_equals(msg + " (buffer count)", parsed_count, expected_count);
+        }
     };
     
     typedef tut::test_group<TestLLSDXMLParsing> TestLLSDXMLParsingGroup;
@@ -767,6 +893,182 @@ namespace tut
             8);
     }
 
+    template<> template<>
+    void TestLLSDXMLParsingObject::test<6>()
+    {
+        set_test_name("buffer parse matches stream parse");
+        // byte substitutions that make for broken or unusual XML
+        const char* replacements = "<>/&;!?-[]\"' \r\nx\xc3\x01";
+        U32 seed = 1;
+        for (S32 i = 0; i < 300; ++i)
+        {
+            LLSD doc = random_llsd(seed, 4, true);
+            std::ostringstream ostr;
+            if (i & 1)
+            {
+                LLSDSerialize::toPrettyXML(doc, ostr);
+            }
+            else
+            {
+                LLSDSerialize::toXML(doc, ostr);
+            }
+            std::string text = ostr.str();
+            for (S32 j = 0; j < 4; ++j)
+            {
+                std::istringstream istr(text);
+                LLSD stream_result;
+                mParser->reset();
+                S32 stream_count = mParser->parse(istr, stream_result, LLSDSerialize::SIZE_UNLIMITED);
+                LLSD buffer_result;
+                S32 buffer_count = mParser->parseBuffer(text.data(), text.size(), buffer_result);
+
+                std::string msg = llformat("document %d variant %d: ", i, j) + text;
+                ensure_equals(msg + " (count)", buffer_count, stream_count);
+                ensure_equals(msg.c_str(), buffer_result, stream_result);
+                if (j == 0)
+                {
+                    ensure_equals(msg + " (round trip)", buffer_count == LLSDParser::PARSE_FAILURE, false);
+                }
+                text = mutate(seed, ostr.str(), replacements);
+            }
+        }
+    }
+
+    template<> template<>
+    void TestLLSDXMLParsingObject::test<7>()
+    {
+        set_test_name("buffer parse of XML beyond the formatter output");
+        LLSD expected;
+        expected["name"] = "a\nb<c>\xc3\xa9" "A";
+        expected["list"][0] = 12;
+        expected["list"][1] = LLSD::Binary(3, 'x');
+        expected["spaced"] = "l1\nl2  l3";
+        expected["ignored"] = LLSD();
+
+        // declaration, comments, line breaks to normalize, references,
+        // CDATA, attributes and an empty element
+        ensureParse(
+            "XML features",
+            "<?xml version=\"1.0\" encoding='utf-8'?>\r\n"
+            "<!-- leading comment -->\r\n"
+            "<llsd version=\"1.0\" >\r\n"
+            "<map>\r\n"
+            "  <key>name</key><string>a\r\nb&lt;<![CDATA[c>]]>&#xe9;&#65;</string>\r\n"
+            "  <!-- a comment -->"
+            "  <key>list</key><array><integer>12</integer><binary encoding=\"base64\">\r\neHh4\r\n</binary></array>\r\n"
+            "  <key>spaced</key><string>l1\rl2  l3</string>\r\n"
+            "  <key>ignored</key><undef/>\r\n"
+            "</map>\r\n"
+            "</llsd >\r\n",
+            expected,
+            7);
+
+        // the tokenizer hands these to expat, which must have the same say
+        ensureParse(
+            "doctype",
+            "<!DOCTYPE llsd><llsd><integer>1</integer></llsd>",
+            LLSD(1),
+            1);
+        ensureParse(
+            "processing instruction",
+            "<llsd><?pi x?><integer>1</integer></llsd>",
+            LLSD(1),
+            1);
+        ensureParse(
+            "mismatched end tag",
+            "<llsd><integer>1</real></llsd>",
+            LLSD(),
+            LLSDParser::PARSE_FAILURE);
+        ensureParse(
+            "undefined entity",
+            "<llsd><string>&nbsp;</string></llsd>",
+            LLSD(),
+            LLSDParser::PARSE_FAILURE);
+        ensureParse(
+            "invalid UTF-8",
+            "<llsd><string>\xc0\xaf</string></llsd>",
+            LLSD(),
+            LLSDParser::PARSE_FAILURE);
+        ensureParse(
+            "junk after the document",
+            "<map><key>a</key><integer>1</integer></map><map/>",
+            LLSD(),
+            LLSDParser::PARSE_FAILURE);
+        ensureParse(
+            "stops at the end of llsd",
+            "<llsd><integer>1</integer></llsd><junk",
+            LLSD(1),
+            1);
+    }
+
+    template<> template<>
+    void TestLLSDXMLParsingObject::test<8>()
+    {
+        set_test_name("buffer parse vs stream parse benchmark");
+
+        LLSD items = LLSD::emptyArray();
+        for (S32 i = 0; i < 5000; ++i)
+        {
+            LLSD item;
+            item["item_id"] = LLUUID::generateNewID();
+            item["name"] = llformat("Inventory item number %d & co", i);
+            item["desc"] = "";
+            item["type"] = i % 20;
+            item["sale_price"] = 10.5 * i;
+            item["created_at"] = LLDate((F64)i);
+            items.append(item);
+        }
+
+        std::ostringstream xml_stream;
+        LLSDSerialize::toPrettyXML(items, xml_stream);
+        const std::string xml = xml_stream.str();
+        std::ostringstream notation_stream;
+        LLSDSerialize::toNotation(items, notation_stream);
+        const std::string notation = notation_stream.str();
+
+        const S32 ITERATIONS = 5;
+        LLTimer timer;
+        for (S32 i = 0; i < ITERATIONS; ++i)
+        {
+            std::istringstream istr(xml);
+            LLSD parsed;
+            LLSDSerialize::fromXML(parsed, istr);
+            ensure_equals("stream XML parse", parsed.size(), items.size());
+        }
+        F64 xml_stream_time = timer.getElapsedTimeF64();
+        timer.reset();
+        for (S32 i = 0; i < ITERATIONS; ++i)
+        {
+            LLSD parsed;
+            LLSDSerialize::fromXML(parsed, xml.data(), xml.size());
+            ensure_equals("buffer XML parse", parsed, items);
+        }
+        F64 xml_buffer_time = timer.getElapsedTimeF64();
+
+        timer.reset();
+        for (S32 i = 0; i < ITERATIONS; ++i)
+        {
+            std::istringstream istr(notation);
+            LLSD parsed;
+            LLSDSerialize::fromNotation(parsed, istr, notation.size());
+            ensure_equals("stream notation parse", parsed.size(), items.size());
+        }
+        F64 notation_stream_time = timer.getElapsedTimeF64();
+        timer.reset();
+        for (S32 i = 0; i < ITERATIONS; ++i)
+        {
+            LLSD parsed;
+            LLSDSerialize::fromNotation(parsed, notation.data(), notation.size());
+            ensure_equals("buffer notation parse", parsed, items);
+        }
+        F64 notation_buffer_time = timer.getElapsedTimeF64();
+
+        LL_INFOS() << "Parsing " << ITERATIONS << " times " << xml.size() << " bytes of XML: stream "
+                   << xml_stream_time << "s, buffer " << xml_buffer_time << "s; "
+                   << notation.size() << " bytes of notation: stream "
+                   << notation_stream_time << "s, buffer " << notation_buffer_time << "s" << LL_ENDL;
+    }
+
 
     /*
     TODO:
@@ -785,6 +1087,24 @@ namespace tut
     {
     public:
         TestLLSDNotationParsing() {}
+
+        // Every notation parse is checked against the buffer parser as well
+        void ensureParse(
+            const std::string& msg,
+            const std::string& in,
+            const LLSD& expected_value,
+            S32 expected_count,
+            S32 depth_limit = -1)
+        {
+            TestLLSDParsing<LLSDNotationParser>::ensureParse(
+                msg, in, expected_value, expected_count, depth_limit);
+
+            LLSD parsed_result;
+            mParser->reset();
+            S32 parsed_count = mParser->parseBuffer(in.data(), in.size(), parsed_result, depth_limit);
+            ensure_equals((msg + " (buffer)").c_str(), parsed_result, expected_value);
+            ensure_equals(msg + " (buffer count)", parsed_count, expected_count);
+        }
     };
 
     typedef tut::test_group<TestLLSDNotationParsing> TestLLSDNotationParsingGroup;
@@ -1169,6 +1489,45 @@ namespace tut
             9);
     }
 
+    template<> template<>
+    void TestLLSDNotationParsingObject::test<22>()
+    {
+        set_test_name("buffer parse matches stream parse");
+        // byte substitutions that make for broken or unusual notation
+        const char* replacements = "{}[]:,'\"\\!ifrtusldb x\t\xff";
+        U32 seed = 1;
+        for (S32 i = 0; i < 300; ++i)
+        {
+            LLSD doc = random_llsd(seed, 4, false);
+            std::ostringstream ostr;
+            switch (i % 3)
+            {
+            case 0: LLSDSerialize::toNotation(doc, ostr); break;
+            case 1: LLSDSerialize::toPrettyNotation(doc, ostr); break;
+            default: LLSDSerialize::toPrettyBinaryNotation(doc, ostr); break;
+            }
+            std::string text = ostr.str();
+            for (S32 j = 0; j < 4; ++j)
+            {
+                std::istringstream istr(text);
+                LLSD stream_result;
+                mParser->reset();
+                S32 stream_count = mParser->parse(istr, stream_result, LLSDSerialize::SIZE_UNLIMITED);
+                LLSD buffer_result;
+                S32 buffer_count = mParser->parseBuffer(text.data(), text.size(), buffer_result);
+
+                std::string msg = llformat("document %d variant %d: ", i, j) + text;
+                ensure_equals(msg + " (count)", buffer_count, stream_count);
+                ensure_equals(msg.c_str(), buffer_result, stream_result);
+                if (j == 0)
+                {
+                    ensure_equals(msg + " (round trip)", buffer_count == LLSDParser::PARSE_FAILURE, false);
+                }
+                text = mutate(seed, ostr.str(), replacements);
+            }
+        }
+    }
+
     /**
      * @class TestLLSDBinaryParsing
      * @brief Concrete instance of a parse tester.
@@ -1177,6 +1536,24 @@ namespace tut
     {
     public:
         TestLLSDBinaryParsing() {}
+
+        // Every binary parse is checked against the buffer parser as well
+        void ensureParse(
+            const std::string& msg,
+            const std::string& in,
+            const LLSD& expected_value,
+            S32 expected_count,
+            S32 depth_limit = -1)
+        {
+            TestLLSDParsing<LLSDBinaryParser>::ensureParse(
+                msg, in, expected_value, expected_count, depth_limit);
+
+            LLSD parsed_result;
+            S32 parsed_count = mParser->parseBuffer(
+                (const U8*)in.data(), in.size(), parsed_result, depth_limit);
+            ensure_equals((msg + " (buffer)").c_str(), parsed_result, expected_value);
+            ensure_equals(msg + " (buffer count)", parsed_count, expected_count);
+        }
     };
 
     typedef tut::test_group<TestLLSDBinaryParsing> TestLLSDBinaryParsingGroup;
@@ -1494,12 +1871,59 @@ namespace tut
             1);
     }
 
-/*
     template<> template<> 
     void TestLLSDBinaryParsingObject::test<11>()
     {
+        set_test_name("buffer parse vs stream parse benchmark");
+
+        // Something shaped like a large inventory fetch response
+        LLSD items = LLSD::emptyArray();
+        for (S32 i = 0; i < 5000; ++i)
+        {
+            LLSD item;
+            item["item_id"] = LLUUID::generateNewID();
+            item["parent_id"] = LLUUID::generateNewID();
+            item["name"] = llformat("Inventory item number %d", i);
+            item["desc"] = "";
+            item["type"] = i % 20;
+            item["flags"] = i;
+            item["created_at"] = LLDate((F64)i);
+            item["sale_price"] = 10.5 * i;
+            item["data"] = LLSD::Binary(64, (U8)i);
+            items.append(item);
+        }
+        LLSD doc;
+        doc["items"] = items;
+
+        std::ostringstream ostr;
+        LLSDSerialize::toBinary(doc, ostr);
+        const std::string buffer = ostr.str();
+
+        const S32 ITERATIONS = 10;
+        LLTimer timer;
+        for (S32 i = 0; i < ITERATIONS; ++i)
+        {
+            std::istringstream istr(buffer);
+            LLSD parsed;
+            mParser->reset();
+            mParser->parse(istr, parsed, buffer.size());
+            ensure_equals("stream parse", parsed.size(), doc.size());
+        }
+        F64 stream_time = timer.getElapsedTimeF64();
+
+        timer.reset();
+        LLSD parsed;
+        for (S32 i = 0; i < ITERATIONS; ++i)
+        {
+            parsed = LLSD();
+            LLSDSerialize::fromBinary(parsed, (const U8*)buffer.data(), buffer.size());
+        }
+        F64 buffer_time = timer.getElapsedTimeF64();
+
+        ensure_equals("buffer parse", parsed, doc);
+        LL_INFOS() << "Parsing " << buffer.size() << " bytes of binary LLSD " << ITERATIONS
+                   << " times: stream " << stream_time << "s, buffer " << buffer_time << "s" << LL_ENDL;
     }
-*/
 
    /**
      * @class TestLLSDCrossCompatible
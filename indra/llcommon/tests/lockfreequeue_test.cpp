@@ -0,0 +1,335 @@
+/**
+ * @file   lockfreequeue_test.cpp
+ * @brief  Test for LockFreeQueue and the lockfree modes of WorkQueue and
+ *         ThreadPool, with throughput and latency benchmarks against the
+ *         mutex based WorkQueue.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Copyright (c) 2022, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "lockfreequeue.h"
+// STL headers
+#include <algorithm>
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+// std headers
+#include <chrono>
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+#include "stringize.h"
+#include "threadpool.h"
+#include "workqueue.h"
+
+using namespace LL;
+using namespace std::literals::chrono_literals; // ms suffix
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // Number of items per benchmark run: enough to show contention while
+    // keeping the test quick
+    const U32 BENCH_ITEMS = 100000;
+    const U32 BENCH_PRODUCERS = 4;
+    const U32 BENCH_WORKERS = 4;
+
+    // ThreadPool listens on "LLApp" under its own name, which must be unique
+    std::string pool_name(const std::string& what, bool lockfree)
+    {
+        static U32 count = 0;
+        return stringize(what, (lockfree? "-lockfree-" : "-mutex-"), ++count);
+    }
+
+    // Post BENCH_ITEMS no-op items from BENCH_PRODUCERS threads to a pool
+    // and return the seconds it takes to run them all
+    F64 bench_throughput(bool lockfree)
+    {
+        ThreadPool pool(pool_name("throughput", lockfree), BENCH_WORKERS, 1024 * 1024, lockfree);
+        pool.start();
+
+        std::atomic<U32> ran{ 0 };
+        Clock::time_point start = Clock::now();
+        std::vector<std::thread> producers;
+        for (U32 p = 0; p < BENCH_PRODUCERS; ++p)
+        {
+            producers.emplace_back([&pool, &ran]()
+                {
+                    for (U32 i = 0; i < BENCH_ITEMS / BENCH_PRODUCERS; ++i)
+                    {
+                        pool.getQueue().post([&ran](){ ++ran; });
+                    }
+                });
+        }
+        for (auto& producer : producers)
+        {
+            producer.join();
+        }
+        while (ran < BENCH_ITEMS)
+        {
+            std::this_thread::yield();
+        }
+        F64 seconds = std::chrono::duration<F64>(Clock::now() - start).count();
+        pool.close();
+        return seconds;
+    }
+
+    // Post items one at a time from a single thread, waiting for each to
+    // run, and return the mean post to run latency in microseconds
+    F64 bench_latency(bool lockfree)
+    {
+        ThreadPool pool(pool_name("latency", lockfree), BENCH_WORKERS, 1024, lockfree);
+        pool.start();
+
+        const U32 ROUNDS = 200;
+        std::atomic<S64> ran_at{ 0 };
+        F64 total = 0.0;
+        for (U32 i = 0; i < ROUNDS; ++i)
+        {
+            ran_at = 0;
+            Clock::time_point posted = Clock::now();
+            pool.getQueue().post([&ran_at]()
+                {
+                    ran_at = Clock::now().time_since_epoch().count();
+                });
+            while (! ran_at)
+            {
+                std::this_thread::yield();
+            }
+            Clock::time_point ran(Clock::duration(ran_at.load()));
+            total += std::chrono::duration<F64, std::micro>(ran - posted).count();
+        }
+        pool.close();
+        return total / ROUNDS;
+    }
+} // anonymous namespace
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct lockfreequeue_data
+    {
+    };
+    typedef test_group<lockfreequeue_data> lockfreequeue_group;
+    typedef lockfreequeue_group::object object;
+    lockfreequeue_group lockfreequeuegrp("lockfreequeue");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("push and pop");
+        LockFreeQueue<std::string> queue(3);
+        ensure_equals("capacity not rounded", queue.capacity(), 4);
+        ensure("new queue not empty", queue.empty());
+
+        std::string item;
+        ensure("popped from empty queue", ! queue.tryPop(item));
+        for (int i = 0; i < 4; ++i)
+        {
+            ensure("push failed", queue.tryPush(std::to_string(i)));
+        }
+        std::string extra("extra");
+        ensure("pushed to full queue", ! queue.tryPush(extra));
+        ensure_equals("failed push consumed item", extra, "extra");
+        ensure_equals("wrong size", queue.size(), 4);
+
+        // wrap around the ring a few times
+        for (int i = 4; i < 20; ++i)
+        {
+            ensure("pop failed", queue.tryPop(item));
+            ensure_equals("out of order", item, std::to_string(i - 4));
+            ensure("push failed after pop", queue.tryPush(std::to_string(i)));
+        }
+        for (int i = 16; i < 20; ++i)
+        {
+            ensure("final pop failed", queue.tryPop(item));
+            ensure_equals("out of order at end", item, std::to_string(i));
+        }
+        ensure("drained queue not empty", queue.empty());
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("many producers and consumers");
+        const U32 PRODUCERS = 4;
+        const U32 CONSUMERS = 4;
+        const U32 PER_PRODUCER = 50000;
+        LockFreeQueue<U32> queue(256);
+
+        std::atomic<U32> popped{ 0 };
+        std::atomic<U64> sum{ 0 };
+        std::vector<std::thread> threads;
+        for (U32 p = 0; p < PRODUCERS; ++p)
+        {
+            threads.emplace_back([&queue, p]()
+                {
+                    for (U32 i = 0; i < PER_PRODUCER; ++i)
+                    {
+                        while (! queue.tryPush(p * PER_PRODUCER + i))
+                        {
+                            std::this_thread::yield();
+                        }
+                    }
+                });
+        }
+        for (U32 c = 0; c < CONSUMERS; ++c)
+        {
+            threads.emplace_back([&queue, &popped, &sum]()
+                {
+                    U32 value;
+                    while (popped < PRODUCERS * PER_PRODUCER)
+                    {
+                        if (queue.tryPop(value))
+                        {
+                            sum += value;
+                            ++popped;
+                        }
+                        else
+                        {
+                            std::this_thread::yield();
+                        }
+                    }
+                });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        const U64 total = PRODUCERS * PER_PRODUCER;
+        ensure_equals("lost items", popped.load(), total);
+        ensure_equals("wrong items", sum.load(), total * (total - 1) / 2);
+        ensure("items left over", queue.empty());
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("lockfree WorkQueue");
+        WorkQueue queue("lockfree", 1024, true);
+        ensure("not lockfree", queue.isLockFree());
+
+        std::vector<int> order;
+        queue.post([&order](){ order.push_back(1); });
+        // scheduled work still waits for its time
+        queue.post(WorkQueue::TimePoint::clock::now() + 50ms, [&order](){ order.push_back(3); });
+        queue.post([&order](){ order.push_back(2); });
+        queue.runPending();
+        ensure_equals("ready work didn't run", order.size(), 2);
+        ensure_equals("ready work out of order", order[0], 1);
+        ensure_equals("ready work out of order", order[1], 2);
+
+        queue.close();
+        ensure("post after close succeeded", ! queue.postIfOpen([](){}));
+        ensure("done with scheduled work pending", ! queue.done());
+        queue.runUntilClose();
+        ensure_equals("scheduled work didn't run", order.size(), 3);
+        ensure("not done after draining", queue.done());
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        set_test_name("ThreadPool work stealing");
+        const U32 TASKS = 64;
+        const U32 SUBTASKS = 64;
+        ThreadPool pool("stealing", 4, 1024, true);
+        pool.start();
+
+        // Each task posts its subtasks from a worker thread, landing them in
+        // that worker's own deque: other workers only get them by stealing.
+        std::atomic<U32> ran{ 0 };
+        std::mutex threads_mutex;
+        std::set<std::thread::id> threads;
+        WorkQueue& queue = pool.getQueue();
+        for (U32 i = 0; i < TASKS; ++i)
+        {
+            queue.post([&]()
+                {
+                    for (U32 j = 0; j < SUBTASKS; ++j)
+                    {
+                        queue.post([&]()
+                            {
+                                std::this_thread::sleep_for(std::chrono::microseconds(20));
+                                {
+                                    std::lock_guard<std::mutex> lock(threads_mutex);
+                                    threads.insert(std::this_thread::get_id());
+                                }
+                                ++ran;
+                            });
+                    }
+                });
+        }
+
+        Clock::time_point give_up = Clock::now() + 10s;
+        while (ran < TASKS * SUBTASKS && Clock::now() < give_up)
+        {
+            std::this_thread::sleep_for(1ms);
+        }
+        pool.close();
+        ensure_equals("subtasks lost", ran.load(), TASKS * SUBTASKS);
+        ensure("subtasks all ran on one thread", threads.size() > 1);
+    }
+
+    template<> template<>
+    void object::test<5>()
+    {
+        set_test_name("benchmark against mutex WorkQueue");
+        // Run each twice, keep the best, to smooth over scheduling noise
+        F64 mutex_time = std::min(bench_throughput(false), bench_throughput(false));
+        F64 lockfree_time = std::min(bench_throughput(true), bench_throughput(true));
+        F64 mutex_latency = std::min(bench_latency(false), bench_latency(false));
+        F64 lockfree_latency = std::min(bench_latency(true), bench_latency(true));
+
+        LL_INFOS("LockFreeQueue") << BENCH_ITEMS << " items, " << BENCH_PRODUCERS << " producers, "
+                                  << BENCH_WORKERS << " workers: mutex " << mutex_time << "s ("
+                                  << (U32)(BENCH_ITEMS / mutex_time) << "/s), lockfree " << lockfree_time << "s ("
+                                  << (U32)(BENCH_ITEMS / lockfree_time) << "/s)" << LL_ENDL;
+        LL_INFOS("LockFreeQueue") << "post to run latency: mutex " << mutex_latency << "us, lockfree "
+                                  << lockfree_latency << "us" << LL_ENDL;
+
+        // Timings depend on the machine, only check that the runs completed
+        ensure("no throughput measured", mutex_time > 0.0 && lockfree_time > 0.0);
+    }
+
+    template<> template<>
+    void object::test<6>()
+    {
+        set_test_name("sleeping workers wake for scheduled work");
+        ThreadPool pool("sleepers", 2, 1024, true);
+        pool.start();
+        // let both workers go to sleep
+        std::this_thread::sleep_for(20ms);
+
+        std::atomic<S64> ran_at{ 0 };
+        WorkQueue::TimePoint due = WorkQueue::TimePoint::clock::now() + 30ms;
+        pool.getQueue().post(due, [&ran_at]()
+            {
+                ran_at = WorkQueue::TimePoint::clock::now().time_since_epoch().count();
+            });
+        // and ready work meanwhile doesn't make them forget it
+        std::atomic<bool> ready_ran{ false };
+        pool.getQueue().post([&ready_ran](){ ready_ran = true; });
+
+        Clock::time_point give_up = Clock::now() + 10s;
+        while (! ran_at && Clock::now() < give_up)
+        {
+            std::this_thread::sleep_for(1ms);
+        }
+        pool.close();
+        ensure("ready work didn't run", ready_ran.load());
+        ensure("scheduled work didn't run", ran_at.load() != 0);
+        ensure("scheduled work ran early",
+               WorkQueue::TimePoint(WorkQueue::TimePoint::duration(ran_at.load())) >= due);
+    }
+} // namespace tut
@@ -15,8 +15,11 @@
 #include "workqueue.h"
 // STL headers
 // std headers
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <deque>
+#include <vector>
 // external library headers
 // other Linden headers
 #include "../test/lltut.h"
@@ -26,6 +29,7 @@
 #include "lleventcoro.h"
 #include "llstring.h"
 #include "stringize.h"
+#include "threadpool.h"
 
 using namespace LL;
 using namespace std::literals::chrono_literals; // ms suffix
@@ -232,4 +236,34 @@ namespace tut
         ensure_equals("didn't run coroutine", stored, "ran");
         ensure("void waitForResult() didn't return", done);
     }
+
+    template<> template<>
+    void object::test<7>()
+    {
+        set_test_name("parallelFor");
+        // Nobody serves 'queue' yet: the caller has to do everything itself.
+        std::vector<int> hits(100, 0);
+        parallelFor(100, 3, [&hits](S32 i){ ++hits[i]; }, "queue");
+        ensure_equals("helpers posted", queue.size(), 3);
+        ensure("missed or repeated an index",
+               std::count(hits.begin(), hits.end(), 1) == 100);
+        // the late helpers find nothing left, and leave hits alone
+        queue.runPending();
+        ensure("late helper ran an index",
+               std::count(hits.begin(), hits.end(), 1) == 100);
+
+        // now with threads to share the work
+        ThreadPool pool("parallelFor", 2);
+        pool.start();
+        std::vector<std::atomic<int>> counts(1000);
+        for (S32 round = 0; round < 10; ++round)
+        {
+            parallelFor(1000, 2, [&counts](S32 i){ ++counts[i]; }, "parallelFor");
+        }
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            ensure_equals(STRINGIZE("index " << i), counts[i].load(), 10);
+        }
+        pool.close();
+    }
 } // namespace tut
@@ -21,22 +21,25 @@
 #include "llevents.h"
 #include "stringize.h"
 
-LL::ThreadPool::ThreadPool(const std::string& name, size_t threads, size_t capacity):
+LL::ThreadPool::ThreadPool(const std::string& name, size_t threads, size_t capacity,
+                           bool lockfree):
     super(name),
-    mQueue(name, capacity),
+    mQueue(name, capacity, lockfree),
     mName("ThreadPool:" + name),
     mThreadCount(threads)
 {}
 
 void LL::ThreadPool::start()
 {
+    // per-thread deques must exist before any thread runs
+    mQueue.setWorkers(mThreadCount);
     for (size_t i = 0; i < mThreadCount; ++i)
     {
         std::string tname{ stringize(mName, ':', (i+1), '/', mThreadCount) };
-        mThreads.emplace_back(tname, [this, tname]()
+        mThreads.emplace_back(tname, [this, i, tname]()
             {
                 LL_PROFILER_SET_THREAD_NAME(tname.c_str());
-                run(tname);
+                run(i, tname);
             });
     }
     // Listen on "LLApp", and when the app is shutting down, close the queue
@@ -76,9 +79,10 @@ void LL::ThreadPool::close()
     }
 }
 
-void LL::ThreadPool::run(const std::string& name)
+void LL::ThreadPool::run(size_t index, const std::string& name)
 {
     LL_DEBUGS("ThreadPool") << name << " starting" << LL_ENDL;
+    mQueue.bindWorker(index);
     run();
     LL_DEBUGS("ThreadPool") << name << " stopping" << LL_ENDL;
 }
@@ -30,8 +30,13 @@ namespace LL
         /**
          * Pass ThreadPool a string name. This can be used to look up the
          * relevant WorkQueue.
+         *
+         * With lockfree=true the WorkQueue takes ready work without locking
+         * (see WorkQueue) and each thread keeps the work it posts to its own
+         * pool in a local deque, from which idle threads steal.
          */
-        ThreadPool(const std::string& name, size_t threads=1, size_t capacity=1024);
+        ThreadPool(const std::string& name, size_t threads=1, size_t capacity=1024,
+                   bool lockfree=false);
         virtual ~ThreadPool();
 
         /**
@@ -60,7 +65,7 @@ namespace LL
         virtual void run();
 
     private:
-        void run(const std::string& name);
+        void run(size_t index, const std::string& name);
 
         WorkQueue mQueue;
         std::string mName;
@@ -371,6 +371,16 @@ namespace LL
             return true;
         }
 
+        /// timestamp of the head item, the next to come due; false if empty
+        bool nextTime(TimePoint& time)
+        {
+            lock_t lock(super::mLock);
+            if (super::mStorage.empty())
+                return false;
+            time = std::get<0>(super::mStorage.front());
+            return true;
+        }
+
         /*------------------------------ etc. ------------------------------*/
         // We can't hide items that aren't yet ready because we can't traverse
         // the underlying priority_queue: it has no iterators, only top(). So
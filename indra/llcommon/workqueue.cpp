@@ -15,33 +15,106 @@
 #include "workqueue.h"
 // STL headers
 // std headers
+#include <thread>
 // external library headers
 // other Linden headers
+#include "llapp.h"
 #include "llcoros.h"
 #include LLCOROS_MUTEX_HEADER
 #include "llerror.h"
 #include "llexception.h"
 #include "stringize.h"
 
+#include <boost/fiber/operations.hpp>
+
 using Mutex = LLCoros::Mutex;
 using Lock  = LLCoros::LockType;
 
-LL::WorkQueue::WorkQueue(const std::string& name, size_t capacity):
+namespace
+{
+    // Slots in the lock-free ring of a lockfree WorkQueue. Anything past
+    // that spills over into the schedule, so this need not match capacity.
+    const size_t MAX_READY_SLOTS = 16384;
+
+    // How long an idle worker of a lockfree WorkQueue sleeps at most before
+    // looking for work again, whether or not anyone woke it
+    const std::chrono::milliseconds MAX_WORKER_SLEEP(50);
+
+    // The WorkQueue served by this thread, if it is a ThreadPool worker of a
+    // lockfree WorkQueue, and its index among that queue's workers.
+    thread_local LL::WorkQueue* sWorkerQueue = nullptr;
+    thread_local size_t sWorkerIndex = 0;
+
+    // State of one parallelFor(), shared with its helpers. A helper that
+    // only starts once the caller has returned claims nothing, and so never
+    // touches the caller's func.
+    struct ParallelFor
+    {
+        ParallelFor(S32 count, const std::function<void(S32)>& func):
+            mCount(count),
+            mFunc(&func)
+        {}
+
+        void run()
+        {
+            for (S32 i = mNext++; i < mCount; i = mNext++)
+            {
+                try
+                {
+                    (*mFunc)(i);
+                }
+                catch (...)
+                {
+                    ++mDone;
+                    throw;
+                }
+                ++mDone;
+            }
+        }
+
+        const S32 mCount;
+        const std::function<void(S32)>* mFunc;
+        std::atomic<S32> mNext{ 0 };
+        std::atomic<S32> mDone{ 0 };
+    };
+} // anonymous namespace
+
+LL::WorkQueue::WorkQueue(const std::string& name, size_t capacity, bool lockfree):
     super(makeName(name)),
     mQueue(capacity)
 {
     // TODO: register for "LLApp" events so we can implicitly close() on
     // viewer shutdown.
+    if (lockfree)
+    {
+        mReady.reset(new LockFreeQueue<Work>(std::min(capacity, MAX_READY_SLOTS)));
+    }
 }
 
 void LL::WorkQueue::close()
 {
+    mClosed = true;
     mQueue.close();
+    if (mReady)
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        ++mWakeups;
+        mSleepCond.notify_all();
+    }
 }
 
 size_t LL::WorkQueue::size()
 {
-    return mQueue.size();
+    size_t size = mQueue.size();
+    if (mReady)
+    {
+        size += mReady->size();
+        for (const auto& worker : mWorkers)
+        {
+            size += worker->mSize;
+        }
+    }
+    return size;
 }
 
 bool LL::WorkQueue::isClosed()
@@ -51,11 +124,46 @@ bool LL::WorkQueue::isClosed()
 
 bool LL::WorkQueue::done()
 {
+    if (mReady && ! readyDrained())
+    {
+        return false;
+    }
     return mQueue.done();
 }
 
+void LL::WorkQueue::setWorkers(size_t count)
+{
+    if (! mReady)
+        return;
+
+    mWorkers.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        mWorkers.emplace_back(new WorkerDeque);
+    }
+}
+
+void LL::WorkQueue::bindWorker(size_t index)
+{
+    if (index < mWorkers.size())
+    {
+        sWorkerQueue = this;
+        sWorkerIndex = index;
+    }
+}
+
 void LL::WorkQueue::runUntilClose()
 {
+    if (mReady)
+    {
+        LL_PROFILE_ZONE_SCOPED_CATEGORY_THREAD;
+        for (Work work; popReady(work); )
+        {
+            callWork(work);
+        }
+        return;
+    }
+
     try
     {
         for (;;)
@@ -72,6 +180,15 @@ void LL::WorkQueue::runUntilClose()
 bool LL::WorkQueue::runPending()
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_THREAD;
+    if (mReady)
+    {
+        for (Work work; tryPopReady(work); )
+        {
+            callWork(work);
+        }
+        return ! done();
+    }
+
     for (Work work; mQueue.tryPop(work); )
     {
         callWork(work);
@@ -82,6 +199,15 @@ bool LL::WorkQueue::runPending()
 bool LL::WorkQueue::runOne()
 {
     Work work;
+    if (mReady)
+    {
+        if (tryPopReady(work))
+        {
+            callWork(work);
+        }
+        return ! done();
+    }
+
     if (mQueue.tryPop(work))
     {
         callWork(work);
@@ -95,6 +221,15 @@ bool LL::WorkQueue::runUntil(const TimePoint& until)
     // Should we subtract some slop to allow for typical Work execution time?
     // How much slop?
     // runUntil() is simply a time-bounded runPending().
+    if (mReady)
+    {
+        for (Work work; TimePoint::clock::now() < until && tryPopReady(work); )
+        {
+            callWork(work);
+        }
+        return ! done();
+    }
+
     for (Work work; TimePoint::clock::now() < until && mQueue.tryPop(work); )
     {
         callWork(work);
@@ -102,6 +237,186 @@ bool LL::WorkQueue::runUntil(const TimePoint& until)
     return ! mQueue.done();
 }
 
+bool LL::WorkQueue::postReady(Work&& work)
+{
+    // Count ourselves in before checking mClosed: a consumer that sees the
+    // queue closed and nobody posting knows nothing more is coming.
+    ++mPosting;
+    if (mClosed)
+    {
+        --mPosting;
+        return false;
+    }
+
+    bool posted = true;
+    WorkerDeque* worker = getWorkerDeque();
+    if (worker)
+    {
+        std::lock_guard<std::mutex> lock(worker->mMutex);
+        worker->mWork.push_back(std::move(work));
+        ++worker->mSize;
+    }
+    else if (! mReady->tryPush(std::move(work)))
+    {
+        // ring is full: fall back on the schedule, which blocks at capacity
+        posted = mQueue.pushIfOpen(TimedWork(TimePoint::clock::now(), std::move(work)));
+    }
+    --mPosting;
+
+    if (posted)
+    {
+        wakeSleeper();
+    }
+    return posted;
+}
+
+void LL::WorkQueue::wakeSleeper()
+{
+    // Pairs with the fence in popReady(): either the sleeper sees our work
+    // on its last look, or we see it counted in mSleepers.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mSleepers > 0)
+    {
+        {
+            // so that the wake can't fall between a sleeper checking
+            // mWakeups and starting to wait
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+            ++mWakeups;
+        }
+        mSleepCond.notify_one();
+    }
+}
+
+bool LL::WorkQueue::tryPopReady(Work& work)
+{
+    WorkerDeque* worker = getWorkerDeque();
+    if (worker && worker->mSize > 0)
+    {
+        std::lock_guard<std::mutex> lock(worker->mMutex);
+        if (! worker->mWork.empty())
+        {
+            // newest first, it is the most likely to still be in cache
+            work = std::move(worker->mWork.back());
+            worker->mWork.pop_back();
+            --worker->mSize;
+            return true;
+        }
+    }
+
+    if (mReady->tryPop(work))
+    {
+        return true;
+    }
+
+    // due scheduled work, or overflow
+    if (mQueue.tryPop(work))
+    {
+        return true;
+    }
+
+    return stealWork(work, worker? sWorkerIndex : mWorkers.size());
+}
+
+bool LL::WorkQueue::popReady(Work& work)
+{
+    for (;;)
+    {
+        if (tryPopReady(work))
+        {
+            return true;
+        }
+
+        // Announce we are about to sleep, then look once more: either we
+        // see work posted meanwhile or its poster sees us and wakes us.
+        U32 wakeups = mWakeups;
+        ++mSleepers;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (tryPopReady(work))
+        {
+            --mSleepers;
+            return true;
+        }
+
+        // Sleep until woken by a post or close(), or until the next
+        // scheduled item comes due
+        TimePoint until = TimePoint::clock::now() + MAX_WORKER_SLEEP;
+        TimePoint next;
+        if (mQueue.nextTime(next) && next < until)
+        {
+            until = next;
+        }
+        {
+            std::unique_lock<std::mutex> lock(mSleepMutex);
+            mSleepCond.wait_until(lock, until,
+                                  [this, wakeups](){ return mWakeups != wakeups; });
+        }
+        --mSleepers;
+
+        if (mQueue.isClosed())
+        {
+            if (readyDrained() && mQueue.done())
+            {
+                return false;
+            }
+            // closed, but posts in progress or work left elsewhere
+            boost::this_fiber::yield();
+        }
+    }
+}
+
+bool LL::WorkQueue::stealWork(Work& work, size_t skip)
+{
+    const size_t count = mWorkers.size();
+    if (! count)
+        return false;
+
+    for (size_t i = 1; i <= count; ++i)
+    {
+        // start with the next worker over so thieves spread out
+        size_t index = (skip + i) % count;
+        if (index == skip)
+            continue;
+
+        WorkerDeque* victim = mWorkers[index].get();
+        if (victim->mSize == 0)
+            continue;
+
+        std::lock_guard<std::mutex> lock(victim->mMutex);
+        if (! victim->mWork.empty())
+        {
+            // oldest first, leaving the owner its most recent work
+            work = std::move(victim->mWork.front());
+            victim->mWork.pop_front();
+            --victim->mSize;
+            return true;
+        }
+    }
+    return false;
+}
+
+LL::WorkQueue::WorkerDeque* LL::WorkQueue::getWorkerDeque()
+{
+    if (sWorkerQueue != this)
+        return nullptr;
+    return mWorkers[sWorkerIndex].get();
+}
+
+bool LL::WorkQueue::readyDrained()
+{
+    if (! mClosed || mPosting > 0 || ! mReady->empty())
+    {
+        return false;
+    }
+    for (const auto& worker : mWorkers)
+    {
+        if (worker->mSize > 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 std::string LL::WorkQueue::makeName(const std::string& name)
 {
     if (! name.empty())
@@ -156,3 +471,57 @@ void LL::WorkQueue::checkCoroutine(const std::string& method)
         LLTHROW(Error("Do not call " + method + " from a thread's default coroutine"));
     }
 }
+
+void LL::parallelFor(S32 count, S32 helpers, const std::function<void(S32)>& func,
+                     const std::string& queue)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_THREAD;
+    helpers = llmin(helpers, count - 1);
+    if (helpers <= 0 || LLApp::isExiting())
+    {
+        for (S32 i = 0; i < count; ++i)
+        {
+            func(i);
+        }
+        return;
+    }
+
+    auto state = std::make_shared<ParallelFor>(count, func);
+    WorkQueue::ptr_t work_queue = WorkQueue::getInstance(queue);
+    for (S32 i = 0; work_queue && i < helpers; ++i)
+    {
+        try
+        {
+            if (! work_queue->tryPost([state](){ state->run(); }))
+            {
+                break;
+            }
+        }
+        catch (const WorkQueue::Closed&)
+        {
+            break;
+        }
+    }
+
+    try
+    {
+        state->run();
+    }
+    catch (...)
+    {
+        // Nobody gets to start on what is left, but what the helpers have
+        // claimed uses func, which must outlive them.
+        S32 claimed = state->mNext.exchange(count);
+        state->mDone += count - llmin(claimed, count);
+        while (state->mDone < count)
+        {
+            std::this_thread::yield();
+        }
+        throw;
+    }
+    // at most the item each helper is still on
+    while (state->mDone < count)
+    {
+        std::this_thread::yield();
+    }
+}
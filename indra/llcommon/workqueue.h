@@ -15,11 +15,18 @@
 #include "llcoros.h"
 #include "llexception.h"
 #include "llinstancetracker.h"
+#include "lockfreequeue.h"
 #include "threadsafeschedule.h"
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <exception>                // std::current_exception
 #include <functional>               // std::function
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace LL
 {
@@ -53,8 +60,18 @@ namespace LL
         /**
          * You may omit the WorkQueue name, in which case a unique name is
          * synthesized; for practical purposes that makes it anonymous.
+         *
+         * Pass lockfree=true to hand work that is ready to run through a
+         * LockFreeQueue instead of the mutex protected schedule, which then
+         * only holds work posted for a future time and any overflow. Work
+         * posted by one of the threads serving the queue (see setWorkers())
+         * goes to that thread's own deque, where idle workers can steal it.
+         * The order in which ready work runs is then only approximately the
+         * order it was posted, so keep the default for a queue whose single
+         * consumer depends on strict FIFO order.
          */
-        WorkQueue(const std::string& name = std::string(), size_t capacity=1024);
+        WorkQueue(const std::string& name = std::string(), size_t capacity=1024,
+                  bool lockfree=false);
 
         /**
          * Since the point of WorkQueue is to pass work to some other worker
@@ -84,6 +101,17 @@ namespace LL
         /// consumer end: are we done, is the queue entirely drained?
         bool done();
 
+        bool isLockFree() const { return bool(mReady); }
+
+        /**
+         * A lockfree WorkQueue keeps a deque per worker thread. Call
+         * setWorkers() with the number of threads before they start, then
+         * bindWorker() with its index on each thread before it serves the
+         * queue. No effect on a WorkQueue that isn't lockfree.
+         */
+        void setWorkers(size_t count);
+        void bindWorker(size_t index);
+
         /*---------------------- fire and forget API -----------------------*/
 
         /// fire-and-forget, but at a particular (future?) time
@@ -94,7 +122,20 @@ namespace LL
             // postIfOpen(). All other methods should accept CALLABLEs of
             // arbitrary type to avoid multiple levels of std::function
             // indirection.
+            if (mReady && time <= TimePoint::clock::now())
+            {
+                if (! postReady(Work(std::move(callable))))
+                {
+                    LLTHROW(Closed());
+                }
+                return;
+            }
             mQueue.push(TimedWork(time, std::move(callable)));
+            if (mReady)
+            {
+                // sleeping workers may mean to wait past its time
+                wakeSleeper();
+            }
         }
 
         /// fire-and-forget
@@ -118,7 +159,16 @@ namespace LL
             // Defer reifying an arbitrary CALLABLE until we hit this or
             // post(). All other methods should accept CALLABLEs of arbitrary
             // type to avoid multiple levels of std::function indirection.
-            return mQueue.pushIfOpen(TimedWork(time, std::move(callable)));
+            if (mReady && time <= TimePoint::clock::now())
+            {
+                return postReady(Work(std::move(callable)));
+            }
+            bool pushed = mQueue.pushIfOpen(TimedWork(time, std::move(callable)));
+            if (pushed && mReady)
+            {
+                wakeSleeper();
+            }
+            return pushed;
         }
 
         /**
@@ -164,6 +214,10 @@ namespace LL
         template <typename CALLABLE>
         bool tryPost(CALLABLE&& callable)
         {
+            if (mReady)
+            {
+                return postReady(Work(std::move(callable)));
+            }
             return mQueue.tryPush(TimedWork(TimePoint::clock::now(), std::move(callable)));
         }
 
@@ -293,6 +347,43 @@ namespace LL
         void callWork(const Queue::DataTuple& work);
         void callWork(const Work& work);
         Queue mQueue;
+
+        /*------------------------- lockfree mode --------------------------*/
+        // Work posted by a worker thread to its own queue. The owner pushes
+        // and pops at the back, thieves take from the front. The lock is
+        // almost never contended.
+        struct WorkerDeque
+        {
+            std::mutex mMutex;
+            std::deque<Work> mWork;
+            std::atomic<size_t> mSize{ 0 };
+        };
+
+        /// push ready work without taking the schedule's lock if we can;
+        /// false if the queue is closed
+        bool postReady(Work&& work);
+        /// pop ready work from wherever it is, without blocking
+        bool tryPopReady(Work& work);
+        /// pop ready work, blocking until there is some; false once done()
+        bool popReady(Work& work);
+        bool stealWork(Work& work, size_t skip);
+        /// wake a worker sleeping in popReady(), if any
+        void wakeSleeper();
+        WorkerDeque* getWorkerDeque();
+        bool readyDrained();
+
+        std::unique_ptr<LockFreeQueue<Work>> mReady;
+        std::vector<std::unique_ptr<WorkerDeque>> mWorkers;
+        std::atomic<bool> mClosed{ false };
+        // posts in progress, so that close() doesn't lose them
+        std::atomic<U32> mPosting{ 0 };
+        // Idle workers wait on mSleepCond rather than on mQueue, so that
+        // waking them does not contend with the schedule's lock. Each wake
+        // bumps mWakeups, which is what a sleeper actually waits for.
+        std::atomic<U32> mSleepers{ 0 };
+        std::atomic<U32> mWakeups{ 0 };
+        std::mutex mSleepMutex;
+        std::condition_variable mSleepCond;
     };
 
     /**
@@ -569,6 +660,20 @@ namespace LL
             (this, time, std::forward<CALLABLE>(callable));
     }
 
+    /**
+     * Calls func(i) for each i in [0, count) on the calling thread and on up
+     * to helpers threads serving the named WorkQueue, returning once every
+     * call has returned. Indices are claimed one at a time, so func is
+     * called concurrently for different indices, in no particular order.
+     *
+     * The caller takes its share of the work instead of waiting for the
+     * helpers. These are only offered with tryPost(): whatever a busy,
+     * closed or missing queue leaves undone, the caller does itself. With
+     * helpers <= 0 this is a plain loop.
+     */
+    void parallelFor(S32 count, S32 helpers, const std::function<void(S32)>& func,
+                     const std::string& queue = "General");
+
 } // namespace LL
 
 #endif /* ! defined(LL_WORKQUEUE_H) */
@@ -153,6 +153,16 @@ const int HTTP_CONNECTION_LIMIT_MAX = 256;
 const long HTTP_PIPELINING_DEFAULT = 0L;
 const long HTTP_PIPELINING_MAX = 20L;
 
+// HTTP/2 multiplexing limits.  Maximum matches the usual
+// server-side SETTINGS_MAX_CONCURRENT_STREAMS.
+const long HTTP_HTTP2_STREAMS_DEFAULT = 0L;
+const long HTTP_HTTP2_STREAMS_MAX = 100L;
+const long HTTP_HTTP2_PRIORITY_MAX_DEFAULT = 0L;
+
+// Largest Content-Length received into a caller's allocation
+// (HttpOptions::setBodyAllocator()), larger bodies use blocks
+const size_t HTTP_BODY_ADOPT_MAX = 64 * 1024 * 1024;
+
 // Miscellaneous defaults
 const bool HTTP_USE_RETRY_AFTER_DEFAULT = true;
 const long HTTP_THROTTLE_RATE_DEFAULT = 0L;
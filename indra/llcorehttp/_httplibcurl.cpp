@@ -399,6 +399,22 @@ bool HttpLibcurl::completeRequest(CURLM * multi_handle, CURL * handle, CURLcode
         }
     }
 
+    HttpPolicy & policy(mService->getPolicy());
+#if LIBCURL_VERSION_NUM >= 0x073200
+    if (handle && policy.getClassOptions(op->mReqPolicy).isMultiplexed())
+    {
+        // A multiplexing class only opens up to its streams while
+        // the server answers over HTTP/2.  No version means there
+        // was no response to tell.
+        long version(0L);
+        ccode = curl_easy_getinfo(handle, CURLINFO_HTTP_VERSION, &version);
+        if (ccode == CURLE_OK && version != 0L)
+        {
+            policy.setHttp2Negotiated(op->mReqPolicy, version == CURL_HTTP_VERSION_2_0);
+        }
+    }
+#endif
+
     if (multi_handle && handle)
     {
         // Detach from multi and recycle handle
@@ -423,7 +439,6 @@ bool HttpLibcurl::completeRequest(CURLM * multi_handle, CURL * handle, CURLcode
     }
 
     // Dispatch to next stage
-    HttpPolicy & policy(mService->getPolicy());
     bool still_active(policy.stageAfterCompletion(op));
 
     return still_active;
@@ -476,7 +491,28 @@ void HttpLibcurl::policyUpdated(int policy_class)
         policy.stallPolicy(policy_class, false);
         mDirtyPolicy[policy_class] = false;
 
-        if (options.mPipelining > 1)
+        if (options.isMultiplexed())
+        {
+            // HTTP/2 streams on a few connections.  Requests wait for
+            // a connection to multiplex on rather than open new ones
+            // (CURLOPT_PIPEWAIT) so the host limit is what keeps the
+            // connection count down.
+            check_curl_multi_setopt(multi_handle,
+                                     CURLMOPT_PIPELINING,
+                                     long(CURLPIPE_MULTIPLEX));
+#if LIBCURL_VERSION_NUM >= 0x074300
+            check_curl_multi_setopt(multi_handle,
+                                     CURLMOPT_MAX_CONCURRENT_STREAMS,
+                                     long(options.mHttp2Streams));
+#endif
+            check_curl_multi_setopt(multi_handle,
+                                     CURLMOPT_MAX_HOST_CONNECTIONS,
+                                     long(options.mPerHostConnectionLimit));
+            check_curl_multi_setopt(multi_handle,
+                                     CURLMOPT_MAX_TOTAL_CONNECTIONS,
+                                     long(options.mConnectionLimit));
+        }
+        else if (options.mPipelining > 1)
         {
             // We'll try to do pipelining on this multihandle
             check_curl_multi_setopt(multi_handle,
@@ -745,6 +745,19 @@ HttpStatus HttpOpRequest::prepareRequest(HttpService * service)
 /******************************/
         check_curl_easy_setopt(mCurlHandle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2_0);
     }
+    if (cpolicy.isMultiplexed())
+    {
+        // HTTP/2 where the server offers it over TLS, waiting for an
+        // existing connection to take the stream rather than opening
+        // another.  Streams don't queue behind one another the way
+        // pipelined requests do so the timeouts are left alone.
+        check_curl_easy_setopt(mCurlHandle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        check_curl_easy_setopt(mCurlHandle, CURLOPT_PIPEWAIT, 1L);
+
+        // Higher priorities get a larger share of the connection,
+        // equal ones share equally.
+        check_curl_easy_setopt(mCurlHandle, CURLOPT_STREAM_WEIGHT, cpolicy.getStreamWeight(mReqPriority));
+    }
     // *DEBUG:  Enable following override for timeout handling and "[curl:bugs] #1420" tests
     //if (cpolicy.mPipelining)
     //{
@@ -783,6 +796,7 @@ size_t HttpOpRequest::writeCallback(void * data, size_t size, size_t nmemb, void
     if (! op->mReplyBody)
     {
         op->mReplyBody = new BufferArray();
+        op->adoptReplyBuffer();
     }
     const size_t req_size(size * nmemb);
     const size_t write_size(op->mReplyBody->append(static_cast<char *>(data), req_size));
@@ -790,6 +804,31 @@ size_t HttpOpRequest::writeCallback(void * data, size_t size, size_t nmemb, void
     return write_size;
 }
 
+
+void HttpOpRequest::adoptReplyBuffer()
+{
+    // First write of the body so the headers are in.  Only worth
+    // doing for a successful response that says how big it is.
+    if (! mReqOptions || ! mReqOptions->getBodyAlloc() || ! mReqOptions->getBodyFree())
+    {
+        return;
+    }
+    long code(0);
+    curl_off_t length(-1);
+    if (CURLE_OK != curl_easy_getinfo(mCurlHandle, CURLINFO_RESPONSE_CODE, &code)
+        || code < 200 || code >= 300
+        || CURLE_OK != curl_easy_getinfo(mCurlHandle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length)
+        || length <= 0 || length > curl_off_t(HTTP_BODY_ADOPT_MAX))
+    {
+        return;
+    }
+    void * mem(mReqOptions->getBodyAlloc()(size_t(length)));
+    if (mem)
+    {
+        mReplyBody->adoptBuffer(mem, size_t(length), mReqOptions->getBodyFree());
+    }
+}
+
         
 size_t HttpOpRequest::readCallback(void * data, size_t size, size_t nmemb, void * userdata)
 {
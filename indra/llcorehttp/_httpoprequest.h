@@ -178,6 +178,13 @@ protected:
                      const HttpOptions::ptr_t & options,
                      const HttpHeaders::ptr_t & headers);
 
+    // Gives a new, empty reply body the caller's buffer to fill
+    // when the options ask for it and the size is known.
+    //
+    // Threading:  called by worker thread
+    //
+    void adoptReplyBuffer();
+
     // libcurl operational callbacks
     //
     // Threading:  called by worker thread
@@ -60,7 +60,8 @@ public:
         : mThrottleEnd(0),
           mThrottleLeft(0L),
           mRequestCount(0L),
-          mStallStaging(false)
+          mStallStaging(false),
+          mHttp2Negotiated(false)
         {}
     
     HttpReadyQueue      mReadyQueue;
@@ -71,6 +72,7 @@ public:
     long                mThrottleLeft;
     long                mRequestCount;
     bool                mStallStaging;
+    bool                mHttp2Negotiated;   // Last completion was over HTTP/2
 };
 
 
@@ -248,10 +250,7 @@ HttpService::ELoopSpeed HttpPolicy::processReadyQueue()
         }
 
         int active(transport.getActiveCountInClass(policy_class));
-        int active_limit(state.mOptions.mPipelining > 1L
-                         ? (state.mOptions.mPerHostConnectionLimit
-                            * state.mOptions.mPipelining)
-                         : state.mOptions.mConnectionLimit);
+        int active_limit(state.mOptions.getActiveLimit(state.mHttp2Negotiated));
         int needed(active_limit - active);      // Expect negatives here
 
         if (needed > 0)
@@ -470,6 +469,20 @@ int HttpPolicy::getReadyCount(HttpRequest::policy_t policy_class) const
 }
 
 
+void HttpPolicy::setHttp2Negotiated(HttpRequest::policy_t policy_class, bool negotiated)
+{
+    if (policy_class < mClasses.size()
+        && mClasses[policy_class]->mHttp2Negotiated != negotiated)
+    {
+        LL_DEBUGS(LOG_CORE) << "Policy class " << policy_class
+                            << (negotiated ? " now multiplexing over HTTP/2."
+                                : " back on HTTP/1.x.")
+                            << LL_ENDL;
+        mClasses[policy_class]->mHttp2Negotiated = negotiated;
+    }
+}
+
+
 bool HttpPolicy::stallPolicy(HttpRequest::policy_t policy_class, bool stall)
 {
     bool ret(false);
@@ -160,6 +160,14 @@ public:
     /// Threading:  called by worker thread
     int getReadyCount(HttpRequest::policy_t policy_class) const;
     
+    /// Record the HTTP version a multiplexing policy class's last
+    /// request completed with.  Its active limit only grows to
+    /// allow for HTTP/2 streams while the server is negotiating
+    /// HTTP/2.
+    ///
+    /// Threading:  called by worker thread
+    void setHttp2Negotiated(HttpRequest::policy_t policy_class, bool negotiated);
+
     /// Stall (or unstall) a policy class preventing requests from
     /// transitioning to an active state.  Used to allow an HTTP
     /// request policy to empty prior to changing settings or state
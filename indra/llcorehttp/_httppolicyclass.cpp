@@ -37,7 +37,9 @@ HttpPolicyClass::HttpPolicyClass()
     : mConnectionLimit(HTTP_CONNECTION_LIMIT_DEFAULT),
       mPerHostConnectionLimit(HTTP_CONNECTION_LIMIT_DEFAULT),
       mPipelining(HTTP_PIPELINING_DEFAULT),
-      mThrottleRate(HTTP_THROTTLE_RATE_DEFAULT)
+      mThrottleRate(HTTP_THROTTLE_RATE_DEFAULT),
+      mHttp2Streams(HTTP_HTTP2_STREAMS_DEFAULT),
+      mHttp2PriorityMax(HTTP_HTTP2_PRIORITY_MAX_DEFAULT)
 {}
 
 
@@ -53,6 +55,8 @@ HttpPolicyClass & HttpPolicyClass::operator=(const HttpPolicyClass & other)
         mPerHostConnectionLimit = other.mPerHostConnectionLimit;
         mPipelining = other.mPipelining;
         mThrottleRate = other.mThrottleRate;
+        mHttp2Streams = other.mHttp2Streams;
+        mHttp2PriorityMax = other.mHttp2PriorityMax;
     }
     return *this;
 }
@@ -62,7 +66,9 @@ HttpPolicyClass::HttpPolicyClass(const HttpPolicyClass & other)
     : mConnectionLimit(other.mConnectionLimit),
       mPerHostConnectionLimit(other.mPerHostConnectionLimit),
       mPipelining(other.mPipelining),
-      mThrottleRate(other.mThrottleRate)
+      mThrottleRate(other.mThrottleRate),
+      mHttp2Streams(other.mHttp2Streams),
+      mHttp2PriorityMax(other.mHttp2PriorityMax)
 {}
 
 
@@ -86,6 +92,14 @@ HttpStatus HttpPolicyClass::set(HttpRequest::EPolicyOption opt, long value)
         mThrottleRate = llclamp(value, 0L, 1000000L);
         break;
 
+    case HttpRequest::PO_HTTP2_STREAMS:
+        mHttp2Streams = llclamp(value, 0L, HTTP_HTTP2_STREAMS_MAX);
+        break;
+
+    case HttpRequest::PO_HTTP2_PRIORITY_MAX:
+        mHttp2PriorityMax = llmax(value, 0L);
+        break;
+
     default:
         return HttpStatus(HttpStatus::LLCORE, HE_INVALID_ARG);
     }
@@ -114,6 +128,14 @@ HttpStatus HttpPolicyClass::get(HttpRequest::EPolicyOption opt, long * value) co
         *value = mThrottleRate;
         break;
 
+    case HttpRequest::PO_HTTP2_STREAMS:
+        *value = mHttp2Streams;
+        break;
+
+    case HttpRequest::PO_HTTP2_PRIORITY_MAX:
+        *value = mHttp2PriorityMax;
+        break;
+
     default:
         return HttpStatus(HttpStatus::LLCORE, HE_INVALID_ARG);
     }
@@ -122,4 +144,27 @@ HttpStatus HttpPolicyClass::get(HttpRequest::EPolicyOption opt, long * value) co
 }
 
 
+long HttpPolicyClass::getActiveLimit(bool http2_negotiated) const
+{
+    if (http2_negotiated && isMultiplexed())
+    {
+        return mPerHostConnectionLimit * mHttp2Streams;
+    }
+    if (mPipelining > 1L)
+    {
+        return mPerHostConnectionLimit * mPipelining;
+    }
+    return mConnectionLimit;
+}
+
+
+long HttpPolicyClass::getStreamWeight(HttpRequest::priority_t priority) const
+{
+    const U64 priority_max(mHttp2PriorityMax > 0L
+                           ? U64(mHttp2PriorityMax)
+                           : U64(HttpRequest::priority_t(~0U)));
+    return long(1 + llmin(U64(priority), priority_max) * 255 / priority_max);
+}
+
+
 }  // end namespace LLCore
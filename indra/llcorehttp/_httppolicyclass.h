@@ -58,12 +58,33 @@ public:
 public:
     HttpStatus set(HttpRequest::EPolicyOption opt, long value);
     HttpStatus get(HttpRequest::EPolicyOption opt, long * value) const;
+
+    /// True if requests are multiplexed over HTTP/2 connections
+    bool isMultiplexed() const
+        {
+            return mHttp2Streams > 1L;
+        }
+
+    /// Number of requests the class may have handed to libcurl
+    /// at once.  Without pipelining or multiplexing, that is one
+    /// per connection.  With either, libcurl manages connections
+    /// and each of them may carry several requests.  The streams
+    /// of a multiplexed class only count once the server has
+    /// actually answered over HTTP/2 (http2_negotiated), until
+    /// then the class is limited as if it weren't multiplexed.
+    long getActiveLimit(bool http2_negotiated) const;
+
+    /// HTTP/2 stream weight, 1 to 256, for a request of the
+    /// given priority, in proportion to mHttp2PriorityMax.
+    long getStreamWeight(HttpRequest::priority_t priority) const;
     
 public:
     long                        mConnectionLimit;
     long                        mPerHostConnectionLimit;
     long                        mPipelining;
     long                        mThrottleRate;
+    long                        mHttp2Streams;
+    long                        mHttp2PriorityMax;
 };  // end class HttpPolicyClass
 
 }  // end namespace LLCore
@@ -59,6 +59,7 @@ public:
 
 protected:
     Block(size_t len);
+    Block(void * mem, size_t len, free_func_t free_func);
 
     Block(const Block &);                       // Not defined
     void operator=(const Block &);              // Not defined
@@ -68,17 +69,24 @@ protected:
     void * operator new(size_t len, size_t addl_len);
     
 public:
-    // Only public entry to get a block.
+    // Only public entries to get a block.
     static Block * alloc(size_t len);
+    static Block * adopt(void * mem, size_t len, free_func_t free_func);
 
 public:
     size_t mUsed;
     size_t mAlloced;
 
+    // Either mStorage or memory adopted from the caller
+    char * mData;
+
+    // How to free adopted memory, NULL for mStorage
+    free_func_t mFree;
+
     // *NOTE:  Must be last member of the object.  We'll
     // overallocate as requested via operator new and index
     // into the array at will.
-    char mData[1];      
+    char mStorage[1];
 };
 
 
@@ -282,6 +290,35 @@ size_t BufferArray::write(size_t pos, const void * src, size_t len)
 }
         
 
+void BufferArray::adoptBuffer(void * mem, size_t capacity, free_func_t free_func)
+{
+    if (mBlocks.size() >= mBlocks.capacity())
+    {
+        mBlocks.reserve(mBlocks.size() + 5);
+    }
+    mBlocks.push_back(Block::adopt(mem, capacity, free_func));
+}
+
+
+void * BufferArray::detachBuffer(size_t * len)
+{
+    if (mBlocks.size() != 1 || ! mBlocks[0]->mFree)
+    {
+        return NULL;
+    }
+
+    Block * block(mBlocks[0]);
+    void * mem(block->mData);
+    *len = block->mUsed;
+
+    block->mData = NULL;                        // No longer ours to free
+    delete block;
+    mBlocks.clear();
+    mLen = 0;
+    return mem;
+}
+
+
 int BufferArray::findBlock(size_t pos, size_t * ret_offset)
 {
     *ret_offset = 0;
@@ -325,14 +362,29 @@ bool BufferArray::getBlockStartEnd(int block, const char ** start, const char **
 
 BufferArray::Block::Block(size_t len)
     : mUsed(0),
-      mAlloced(len)
+      mAlloced(len),
+      mData(mStorage),
+      mFree(NULL)
 {
     memset(mData, 0, len);
 }
+
+
+BufferArray::Block::Block(void * mem, size_t len, free_func_t free_func)
+    : mUsed(0),
+      mAlloced(len),
+      mData(static_cast<char *>(mem)),
+      mFree(free_func)
+{}
             
 
 BufferArray::Block::~Block()
 {
+    if (mFree && mData)
+    {
+        mFree(mData);
+    }
+    mData = NULL;
     mUsed = 0;
     mAlloced = 0;
 }
@@ -363,6 +415,13 @@ BufferArray::Block * BufferArray::Block::alloc(size_t len)
     Block * block = new (len) Block(len);
     return block;
 }
+
+
+BufferArray::Block * BufferArray::Block::adopt(void * mem, size_t len, free_func_t free_func)
+{
+    Block * block = new (0) Block(mem, len, free_func);
+    return block;
+}
     
 
 }  // end namespace LLCore
@@ -59,6 +59,10 @@ class BufferArrayStreamBuf;
 /// write and append operations and beyond which the current position
 /// cannot be set.
 ///
+/// A caller that knows how much data is coming can give the object
+/// a buffer of its own to fill (adoptBuffer()) and, when all the data
+/// ended up there, take it back without a copy (detachBuffer()).
+///
 /// Threading:  not thread-safe
 ///
 /// Allocation:  Refcounted, heap only.  Caller of the constructor
@@ -86,6 +90,9 @@ private:
 public:
     // Internal magic number, may be used by unit tests.
     static const size_t BLOCK_ALLOC_SIZE = 65540;
+
+    /// Frees memory given to adoptBuffer()
+    typedef void (* free_func_t)(void * mem);
     
     /// Appends the indicated data to the BufferArray
     /// modifying current position and total size.  New
@@ -120,6 +127,21 @@ public:
     /// append data when current position is equal to the
     /// size of the instance or do a mix of both.
     size_t write(size_t pos, const void * src, size_t len);
+
+    /// Adds the caller's allocation of 'capacity' bytes as a new,
+    /// empty block at the end of the instance.  Following appends
+    /// fill it before any library block is allocated.  The
+    /// instance owns the memory from here on and releases it with
+    /// 'free_func' unless it is taken back with detachBuffer().
+    void adoptBuffer(void * mem, size_t capacity, free_func_t free_func);
+
+    /// If all of the data lies in a single adopted buffer, hands
+    /// that buffer to the caller, who must then free it with the
+    /// function given to adoptBuffer().  The instance is left
+    /// empty.  Otherwise returns NULL and changes nothing.
+    ///
+    /// @param len      Receives the count of bytes in the buffer
+    void * detachBuffer(size_t * len);
     
 protected:
     int findBlock(size_t pos, size_t * ret_offset);
@@ -47,7 +47,9 @@ HttpOptions::HttpOptions() :
     mVerifyPeer(sDefaultVerifyPeer),
     mVerifyHost(false),
     mDNSCacheTimeout(-1L),
-    mNoBody(false)
+    mNoBody(false),
+    mBodyAlloc(NULL),
+    mBodyFree(NULL)
 {}
 
 
@@ -129,6 +131,12 @@ void HttpOptions::setHeadersOnly(bool nobody)
     }
 }
 
+void HttpOptions::setBodyAllocator(body_alloc_t alloc_func, BufferArray::free_func_t free_func)
+{
+    mBodyAlloc = alloc_func;
+    mBodyFree = free_func;
+}
+
 void HttpOptions::setDefaultSSLVerifyPeer(bool verify)
 {
     sDefaultVerifyPeer = verify;
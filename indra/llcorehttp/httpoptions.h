@@ -29,6 +29,7 @@
 
 
 #include "httpcommon.h"
+#include "bufferarray.h"
 #include "_refcounted.h"
 
 
@@ -178,6 +179,25 @@ public:
         return mNoBody;
     }
 
+    /// Allocator for response bodies.  When set and a successful
+    /// response declares its Content-Length, the body is received
+    /// straight into a single allocation of that size.  Consumers
+    /// take it over with BufferArray::detachBuffer() and release
+    /// it with 'free_func' instead of copying it out of the body.
+    /// Allocation failures and bodies larger than declared fall
+    /// back to the usual blocks.
+    /// Default: NULL, bodies are collected in library blocks
+    typedef void * (* body_alloc_t)(size_t len);
+    void                setBodyAllocator(body_alloc_t alloc_func, BufferArray::free_func_t free_func);
+    body_alloc_t        getBodyAlloc() const
+    {
+        return mBodyAlloc;
+    }
+    BufferArray::free_func_t getBodyFree() const
+    {
+        return mBodyFree;
+    }
+
     /// Sets default behavior for verifying that the name in the 
     /// security certificate matches the name of the host contacted.
     /// Defaults false if not set, but should be set according to
@@ -199,6 +219,8 @@ protected:
     bool                mVerifyHost;
     int                 mDNSCacheTimeout;
     bool                mNoBody;
+    body_alloc_t        mBodyAlloc;
+    BufferArray::free_func_t mBodyFree;
 
     static bool         sDefaultVerifyPeer;
 }; // end class HttpOptions
@@ -233,6 +233,34 @@ public:
         /// Global only
         PO_SSL_VERIFY_CALLBACK,
 
+        /// If greater than 1, requests in the class ask for HTTP/2
+        /// on https: URLs and are multiplexed as streams over shared
+        /// connections.  Value gives the maximum number of concurrent
+        /// streams on a connection.  Servers that don't negotiate
+        /// HTTP/2 are spoken to in HTTP/1.1 as usual.
+        ///
+        /// When multiplexing, libcurl performs connection management
+        /// as with pipelining and PO_PER_HOST_CONNECTION_LIMIT should
+        /// be small:  a handful of connections each carrying many
+        /// requests.  Takes precedence over PO_PIPELINING_DEPTH.
+        /// Request priorities become HTTP/2 stream weights, higher
+        /// priorities getting a larger share of the connection (see
+        /// PO_HTTP2_PRIORITY_MAX).  Until a server has answered over
+        /// HTTP/2, the class is limited to the requests it would have
+        /// in flight without multiplexing.
+        ///
+        /// Per-class only
+        PO_HTTP2_STREAMS,
+
+        /// Highest request priority the class uses.  When multiplexing,
+        /// HTTP/2 stream weights are spread evenly from priority 0 up
+        /// to this value, so classes that only use the low bits of
+        /// priority_t still see the full range of weights.  Zero, the
+        /// default, stands for the whole range of priority_t.
+        ///
+        /// Per-class only
+        PO_HTTP2_PRIORITY_MAX,
+
         PO_LAST  // Always at end
     };
 
@@ -33,6 +33,19 @@
 
 using namespace LLCore;
 
+namespace
+{
+
+// Counts frees of adopted buffers
+int adopted_frees(0);
+
+void adopted_free(void * mem)
+{
+    ++adopted_frees;
+    free(mem);
+}
+
+}
 
 
 namespace tut
@@ -374,6 +387,77 @@ void BufferArrayTestObjectType::test<8>()
     ba->release();
 }
 
+template <> template <>
+void BufferArrayTestObjectType::test<9>()
+{
+    set_test_name("BufferArray adopted buffer filled and detached");
+
+    BufferArray * ba = new BufferArray();
+    adopted_frees = 0;
+
+    char str1[] = "abcdefghij";
+    size_t str1_len(strlen(str1));
+
+    // Room for exactly two copies, as for a known Content-Length
+    char * mem = static_cast<char *>(malloc(2 * str1_len));
+    ba->adoptBuffer(mem, 2 * str1_len, adopted_free);
+    ensure("Adopted buffer adds no data", 0 == ba->size());
+
+    ba->append(str1, str1_len);
+    ba->append(str1, str1_len);
+    ensure("Data landed in the adopted buffer", 0 == strncmp(mem + str1_len, str1, str1_len));
+
+    char buffer[64];
+    size_t len(ba->read(0, buffer, sizeof(buffer)));
+    ensure("Read of adopted buffer correct", 2 * str1_len == len && 0 == strncmp(buffer, str1, str1_len));
+
+    size_t detached_len(0);
+    void * detached(ba->detachBuffer(&detached_len));
+    ensure("Detached buffer is the adopted one", detached == mem);
+    ensure("Detached length correct", 2 * str1_len == detached_len);
+    ensure("BufferArray empty after detach", 0 == ba->size());
+    ensure("Detach a second time fails", NULL == ba->detachBuffer(&detached_len));
+
+    ba->release();
+    ensure("Detached buffer not freed by BufferArray", 0 == adopted_frees);
+    adopted_free(detached);
+}
+
+template <> template <>
+void BufferArrayTestObjectType::test<10>()
+{
+    set_test_name("BufferArray adopted buffer overflowing into blocks");
+
+    BufferArray * ba = new BufferArray();
+    adopted_frees = 0;
+
+    char str1[] = "abcdefghij";
+    size_t str1_len(strlen(str1));
+    char str2[] = "ABCDEFGHIJKLMNOPQRST";
+    size_t str2_len(strlen(str2));
+
+    // Declared size smaller than what arrives, as with a
+    // decompressed body
+    ba->adoptBuffer(malloc(str1_len + 5), str1_len + 5, adopted_free);
+    ba->append(str1, str1_len);
+    ba->append(str2, str2_len);
+    ensure("All data kept", str1_len + str2_len == ba->size());
+
+    char buffer[64];
+    memset(buffer, 'X', sizeof(buffer));
+    size_t len(ba->read(0, buffer, sizeof(buffer)));
+    ensure("Read length correct", str1_len + str2_len == len);
+    ensure("Read content correct.1", 0 == strncmp(buffer, str1, str1_len));
+    ensure("Read content correct.2", 0 == strncmp(buffer + str1_len, str2, str2_len));
+
+    size_t detached_len(0);
+    ensure("No detach when data spans blocks", NULL == ba->detachBuffer(&detached_len));
+    ensure("Data unchanged by failed detach", str1_len + str2_len == ba->size());
+
+    ba->release();
+    ensure("Adopted buffer freed with the BufferArray", 1 == adopted_frees);
+}
+
 }  // end namespace tut
 
 
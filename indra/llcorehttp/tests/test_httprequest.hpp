@@ -3056,6 +3056,134 @@ void HttpRequestTestObjectType::test<23>()
 }
 
 
+template <> template <>
+void HttpRequestTestObjectType::test<24>()
+{
+    ScopedCurlInit ready;
+
+    set_test_name("HttpRequest GETs in an HTTP/2 multiplexing class");
+
+    // The test peer only speaks HTTP/1.1 so this checks that the
+    // option is accepted and that a multiplexing class falls back
+    // cleanly with more requests in flight than connections.
+    // Stream negotiation itself needs an HTTP/2 server over TLS.
+    
+    // Handler can be stack-allocated *if* there are no dangling
+    // references to it after completion of this method.
+    // Create before memory record as the string copy will bump numbers.
+    TestHandler2 handler(this, "handler");
+    LLCore::HttpHandler::ptr_t handlerp(&handler, NoOpDeletor);
+    std::string url_base(get_base_url());
+    mHandlerCalls = 0;
+
+    HttpRequest * req = NULL;
+    
+    try
+    {
+        // Get singletons created
+        HttpRequest::createService();
+
+        HttpRequest::policy_t policy_id(HttpRequest::createPolicyClass());
+        ensure("Policy class created", policy_id != HttpRequest::INVALID_POLICY_ID);
+
+        long value(0L);
+        HttpStatus status(HttpRequest::setStaticPolicyOption(HttpRequest::PO_HTTP2_STREAMS,
+                                                             policy_id, 1000L, &value));
+        ensure("HTTP/2 streams option accepted", bool(status));
+        ensure_equals("Stream count clamped", value, 100L);
+        status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_HTTP2_STREAMS,
+                                                    policy_id, 4L, &value);
+        ensure_equals("Stream count set", value, 4L);
+        status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_PER_HOST_CONNECTION_LIMIT,
+                                                    policy_id, 2L, NULL);
+        ensure("Per-host limit accepted", bool(status));
+        status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_HTTP2_STREAMS,
+                                                    HttpRequest::GLOBAL_POLICY_ID, 4L, NULL);
+        ensure("HTTP/2 streams is not a global option", ! status);
+        status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_HTTP2_PRIORITY_MAX,
+                                                    policy_id, 0x0FFFFFFFL, &value);
+        ensure("Priority range accepted", bool(status));
+        ensure_equals("Priority range set", value, 0x0FFFFFFFL);
+        
+        // Start threading early so that thread memory is invariant
+        // over the test.
+        HttpRequest::startThread();
+
+        // create a new ref counted object with an implicit reference
+        req = new HttpRequest();
+
+        // Issue GETs with a spread of priorities, more of them
+        // than there are connections
+        mStatus = HttpStatus(200);
+        int url_limit(12);
+        for (int i(0); i < url_limit; ++i)
+        {
+            HttpHandle handle = req->requestGet(policy_id,
+                                                HttpRequest::priority_t(i) << 28,
+                                                url_base,
+                                                HttpOptions::ptr_t(),
+                                                HttpHeaders::ptr_t(),
+                                                handlerp);
+
+            std::ostringstream testtag;
+            testtag << "Valid handle returned for request #" << i;
+            ensure(testtag.str(), handle != LLCORE_HTTP_HANDLE_INVALID);
+        }
+
+        // Run the notification pump.
+        int count(0);
+        int limit(LOOP_COUNT_LONG);
+        while (count++ < limit && mHandlerCalls < url_limit)
+        {
+            req->update(0);
+            usleep(LOOP_SLEEP_INTERVAL);
+        }
+        ensure("Requests executed in reasonable time", count < limit);
+        ensure("One handler invocation for each request", mHandlerCalls == url_limit);
+
+        // Okay, request a shutdown of the servicing thread
+        mStatus = HttpStatus();
+        mHandlerCalls = 0;
+        HttpHandle handle = req->requestStopThread(handlerp);
+        ensure("Valid handle returned for stop request", handle != LLCORE_HTTP_HANDLE_INVALID);
+    
+        // Run the notification pump again
+        count = 0;
+        limit = LOOP_COUNT_LONG;
+        while (count++ < limit && mHandlerCalls < 1)
+        {
+            req->update(1000000);
+            usleep(LOOP_SLEEP_INTERVAL);
+        }
+        ensure("Stop request executed in reasonable time", count < limit);
+        ensure("Stop handler invocation", mHandlerCalls == 1);
+
+        // See that we actually shutdown the thread
+        count = 0;
+        limit = LOOP_COUNT_SHORT;
+        while (count++ < limit && ! HttpService::isStopped())
+        {
+            usleep(LOOP_SLEEP_INTERVAL);
+        }
+        ensure("Thread actually stopped running", HttpService::isStopped());
+
+        // release the request object
+        delete req;
+        req = NULL;
+
+        // Shut down service
+        HttpRequest::destroyService();
+    }
+    catch (...)
+    {
+        stop_thread(req);
+        delete req;
+        HttpRequest::destroyService();
+        throw;
+    }
+}
+
+
 }  // end namespace tut
 
 namespace
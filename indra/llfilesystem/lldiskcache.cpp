@@ -39,21 +39,25 @@
 #include <chrono>
 
 #include "lldiskcache.h"
+#include "llpackedassetstore.h"
 
 LLDiskCache::LLDiskCache(const std::string cache_dir,
                          const uintmax_t max_size_bytes,
                          const bool enable_cache_debug_info) :
     mCacheDir(cache_dir),
     mMaxSizeBytes(max_size_bytes),
-    mEnableCacheDebugInfo(enable_cache_debug_info)
+    mEnableCacheDebugInfo(enable_cache_debug_info),
+    mIndexSizeBytes(0),
+    mIndexValid(false)
 {
     mCacheFilenamePrefix = "sl_cache";
+    mIndexFilename = cache_dir + gDirUtilp->getDirDelimiter() + "cache_index.dat";
 
     LLFile::mkdir(cache_dir);
 }
 
 // WARNING: purge() is called by LLPurgeDiskCacheThread. As such it must
-// NOT touch any LLDiskCache data without introducing and locking a mutex!
+// NOT touch any LLDiskCache data without locking mIndexMutex!
 
 // Interaction through the filesystem itself should be safe. Let’s say thread
 // A is accessing the cache file for reading/writing and thread B is trimming
@@ -87,73 +91,60 @@ void LLDiskCache::purge()
         LL_INFOS() << "Total dir size before purge is " << dirFileSize(mCacheDir) << LL_ENDL;
     }
 
-    boost::system::error_code ec;
     auto start_time = std::chrono::high_resolution_clock::now();
 
-    typedef std::pair<std::time_t, std::pair<uintmax_t, std::string>> file_info_t;
-    std::vector<file_info_t> file_info;
-
-#if LL_WINDOWS
-    std::wstring cache_path(utf8str_to_utf16str(mCacheDir));
-#else
-    std::string cache_path(mCacheDir);
-#endif
-    if (boost::filesystem::is_directory(cache_path, ec) && !ec.failed())
+    // The victims are taken out of the index while holding the lock but the
+    // files themselves are deleted after releasing it so readers and writers
+    // are never blocked behind filesystem operations.
+    typedef std::pair<std::string, cache_entry_t> victim_t;
+    std::vector<victim_t> victims;
+    size_t file_count = 0;
+    uintmax_t size_after = 0;
     {
-        for (auto& entry : boost::make_iterator_range(boost::filesystem::directory_iterator(cache_path, ec), {}))
-        {
-            if (boost::filesystem::is_regular_file(entry, ec) && !ec.failed())
-            {
-                if (entry.path().string().find(mCacheFilenamePrefix) != std::string::npos)
-                {
-                    uintmax_t file_size = boost::filesystem::file_size(entry, ec);
-                    if (ec.failed())
-                    {
-                        continue;
-                    }
-                    const std::string file_path = entry.path().string();
-                    const std::time_t file_time = boost::filesystem::last_write_time(entry, ec);
-                    if (ec.failed())
-                    {
-                        continue;
-                    }
+        LLMutexLock lock(&mIndexMutex);
+        ensureIndex();
 
-                    file_info.push_back(file_info_t(file_time, { file_size, file_path }));
-                }
-            }
+        file_count = mIndex.size();
+        while (mIndexSizeBytes > mMaxSizeBytes && !mLRU.empty())
+        {
+            cache_index_t::iterator iter = mIndex.find(*mLRU.begin()->second);
+            victims.push_back(victim_t(iter->first, iter->second));
+            eraseEntry(iter);
         }
+        size_after = mIndexSizeBytes;
     }
 
-    std::sort(file_info.begin(), file_info.end(), [](file_info_t& x, file_info_t& y)
-    {
-        return x.first > y.first;
-    });
-
     LL_INFOS() << "Purging cache to a maximum of " << mMaxSizeBytes << " bytes" << LL_ENDL;
 
+    boost::system::error_code ec;
     std::vector<bool> file_removed;
     if (mEnableCacheDebugInfo)
     {
-        file_removed.reserve(file_info.size());
+        file_removed.reserve(victims.size());
     }
-    uintmax_t file_size_total = 0;
-    for (file_info_t& entry : file_info)
+    for (const victim_t& victim : victims)
     {
-        file_size_total += entry.second.first;
-
-        bool should_remove = file_size_total > mMaxSizeBytes;
-        if (mEnableCacheDebugInfo)
-        {
-            file_removed.push_back(should_remove);
-        }
-        if (should_remove)
+        const std::string file_path = mCacheDir + gDirUtilp->getDirDelimiter() + victim.first;
+#if LL_WINDOWS
+        boost::filesystem::remove(utf8str_to_utf16str(file_path), ec);
+#else
+        boost::filesystem::remove(file_path, ec);
+#endif
+        if (ec.failed())
         {
-            boost::filesystem::remove(entry.second.second, ec);
-            if (ec.failed())
+            LL_WARNS() << "Failed to delete cache file " << file_path << ": " << ec.message() << LL_ENDL;
+
+            // Still there so keep tracking it - it will be retried on the next purge
+            LLMutexLock lock(&mIndexMutex);
+            if (mIndex.find(victim.first) == mIndex.end())
             {
-                LL_WARNS() << "Failed to delete cache file " << entry.second.second << ": " << ec.message() << LL_ENDL;
+                setEntry(victim.first, victim.second.mSize, victim.second.mLastAccess, victim.second.mAssetType);
             }
         }
+        if (mEnableCacheDebugInfo)
+        {
+            file_removed.push_back(!ec.failed());
+        }
     }
 
     if (mEnableCacheDebugInfo)
@@ -163,25 +154,274 @@ void LLDiskCache::purge()
 
         // Log afterward so it doesn't affect the time measurement
         // Logging thousands of file results can take hundreds of milliseconds
-        for (size_t i = 0; i < file_info.size(); ++i)
+        for (size_t i = 0; i < victims.size(); ++i)
         {
-            const file_info_t& entry = file_info[i];
-            const bool removed = file_removed[i];
-            const std::string action = removed ? "DELETE:" : "KEEP:";
+            const victim_t& entry = victims[i];
+            const std::string action = file_removed[i] ? "DELETE:" : "FAILED:";
 
             // have to do this because of LL_INFO/LL_END weirdness
             std::ostringstream line;
 
             line << action << "  ";
-            line << entry.first << "  ";
-            line << entry.second.first << "  ";
-            line << entry.second.second;
-            line << " (" << file_size_total << "/" << mMaxSizeBytes << ")";
+            line << entry.second.mLastAccess << "  ";
+            line << entry.second.mSize << "  ";
+            line << entry.first;
+            line << " (" << size_after << "/" << mMaxSizeBytes << ")";
             LL_INFOS() << line.str() << LL_ENDL;
         }
 
         LL_INFOS() << "Total dir size after purge is " << dirFileSize(mCacheDir) << LL_ENDL;
-        LL_INFOS() << "Cache purge took " << execute_time << " ms to execute for " << file_info.size() << " files" << LL_ENDL;
+        LL_INFOS() << "Cache purge took " << execute_time << " ms to execute for " << file_count << " files" << LL_ENDL;
+    }
+}
+
+void LLDiskCache::cleanupSingleton()
+{
+    LLMutexLock lock(&mIndexMutex);
+    if (mIndexValid)
+    {
+        saveIndex();
+    }
+}
+
+std::string LLDiskCache::filepathToIndexName(const std::string& file_path) const
+{
+    const std::string& delim = gDirUtilp->getDirDelimiter();
+    if (file_path.size() > mCacheDir.size() + delim.size() &&
+        file_path.compare(0, mCacheDir.size(), mCacheDir) == 0 &&
+        file_path.compare(mCacheDir.size(), delim.size(), delim) == 0)
+    {
+        return file_path.substr(mCacheDir.size() + delim.size());
+    }
+    return std::string();
+}
+
+void LLDiskCache::setEntry(const std::string& name, uintmax_t size, std::time_t last_access,
+                           LLAssetType::EType at)
+{
+    std::pair<cache_index_t::iterator, bool> result = mIndex.insert(cache_index_t::value_type(name, cache_entry_t()));
+    cache_entry_t& entry = result.first->second;
+    const std::string* key = &result.first->first;
+    if (!result.second)
+    {
+        mLRU.erase(lru_key_t(entry.mLastAccess, key));
+        mIndexSizeBytes -= entry.mSize;
+    }
+
+    entry.mSize = size;
+    entry.mLastAccess = last_access;
+    // Keep the type we already know about if the caller does not know it
+    if (result.second || at != LLAssetType::AT_UNKNOWN)
+    {
+        entry.mAssetType = at;
+    }
+
+    mLRU.insert(lru_key_t(last_access, key));
+    mIndexSizeBytes += size;
+}
+
+void LLDiskCache::eraseEntry(cache_index_t::iterator iter)
+{
+    mLRU.erase(lru_key_t(iter->second.mLastAccess, &iter->first));
+    mIndexSizeBytes -= iter->second.mSize;
+    mIndex.erase(iter);
+}
+
+void LLDiskCache::ensureIndex()
+{
+    if (mIndexValid)
+    {
+        return;
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    bool loaded = loadIndex();
+    if (!loaded)
+    {
+        rebuildIndex();
+    }
+    mIndexValid = true;
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    LL_INFOS() << (loaded ? "Loaded" : "Rebuilt") << " cache index of " << mIndex.size()
+               << " files (" << mIndexSizeBytes << " bytes) in "
+               << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count()
+               << " ms" << LL_ENDL;
+}
+
+namespace
+{
+    // "LLDC" - the first bytes of the index file
+    const U32 CACHE_INDEX_MAGIC = 0x43444c4c;
+    // Bump this when the layout of the index file changes
+    const U32 CACHE_INDEX_VERSION = 1;
+    // Sanity limit for a cache file name in the index file
+    const U32 CACHE_INDEX_MAX_NAME_LENGTH = 255;
+
+    template <typename T>
+    bool read_value(llifstream& file, T& value)
+    {
+        file.read((char*)&value, sizeof(T));
+        return file.gcount() == sizeof(T);
+    }
+
+    template <typename T>
+    void write_value(llofstream& file, const T& value)
+    {
+        file.write((const char*)&value, sizeof(T));
+    }
+}
+
+// The index file layout is:
+//   U32 magic, U32 version, U64 entry count, U64 total size in bytes
+// followed for each entry by:
+//   U64 size, S64 last access time, S32 asset type, U32 name length, name
+// The total size doubles as a checksum of the entries.
+bool LLDiskCache::loadIndex()
+{
+    llifstream file(mIndexFilename, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    cache_index_t index;
+    uintmax_t total_size = 0;
+    bool valid = false;
+
+    U32 magic = 0;
+    U32 version = 0;
+    U64 count = 0;
+    U64 expected_size = 0;
+    if (read_value(file, magic) && magic == CACHE_INDEX_MAGIC &&
+        read_value(file, version) && version == CACHE_INDEX_VERSION &&
+        read_value(file, count) && read_value(file, expected_size))
+    {
+        valid = true;
+        std::string name;
+        for (U64 i = 0; i < count && valid; ++i)
+        {
+            U64 size = 0;
+            S64 last_access = 0;
+            S32 at = 0;
+            U32 name_length = 0;
+            valid = read_value(file, size) && read_value(file, last_access) &&
+                    read_value(file, at) && read_value(file, name_length) &&
+                    name_length > 0 && name_length <= CACHE_INDEX_MAX_NAME_LENGTH;
+            if (valid)
+            {
+                name.resize(name_length);
+                file.read(&name[0], name_length);
+                valid = file.gcount() == (std::streamsize)name_length &&
+                        name.compare(0, mCacheFilenamePrefix.size(), mCacheFilenamePrefix) == 0 &&
+                        ((at >= LLAssetType::AT_NONE && at < LLAssetType::AT_COUNT) ||
+                         at == LLAssetType::AT_UNKNOWN);
+            }
+            if (valid)
+            {
+                cache_entry_t& entry = index[name];
+                entry.mSize = size;
+                entry.mLastAccess = (std::time_t)last_access;
+                entry.mAssetType = (LLAssetType::EType)at;
+                total_size += size;
+            }
+        }
+        // Every entry accounted for and nothing trailing after them
+        valid = valid && total_size == expected_size && index.size() == count &&
+                file.peek() == std::char_traits<char>::eof();
+    }
+    file.close();
+
+    // Whatever happens, the file is stale from now on: it will be written
+    // again at shutdown and a crash before then means a rescan next time
+    LLFile::remove(mIndexFilename, ENOENT);
+
+    if (!valid)
+    {
+        LL_WARNS() << "Cache index " << mIndexFilename << " is corrupt, rescanning cache directory" << LL_ENDL;
+        return false;
+    }
+
+    // Merge with what was recorded in memory before the index was loaded
+    for (cache_index_t::value_type& item : index)
+    {
+        if (mIndex.find(item.first) == mIndex.end())
+        {
+            setEntry(item.first, item.second.mSize, item.second.mLastAccess, item.second.mAssetType);
+        }
+    }
+    return true;
+}
+
+void LLDiskCache::saveIndex()
+{
+    const std::string temp_filename = mIndexFilename + ".tmp";
+    llofstream file(temp_filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        LL_WARNS() << "Unable to write cache index " << temp_filename << LL_ENDL;
+        return;
+    }
+
+    write_value(file, CACHE_INDEX_MAGIC);
+    write_value(file, CACHE_INDEX_VERSION);
+    write_value(file, (U64)mIndex.size());
+    write_value(file, (U64)mIndexSizeBytes);
+    for (const cache_index_t::value_type& item : mIndex)
+    {
+        write_value(file, (U64)item.second.mSize);
+        write_value(file, (S64)item.second.mLastAccess);
+        write_value(file, (S32)item.second.mAssetType);
+        write_value(file, (U32)item.first.size());
+        file.write(item.first.data(), item.first.size());
+    }
+    file.close();
+
+    if (file.fail() || LLFile::rename(temp_filename, mIndexFilename) != 0)
+    {
+        LL_WARNS() << "Unable to write cache index " << mIndexFilename << LL_ENDL;
+        LLFile::remove(temp_filename, ENOENT);
+    }
+}
+
+void LLDiskCache::rebuildIndex()
+{
+    boost::system::error_code ec;
+#if LL_WINDOWS
+    std::wstring cache_path(utf8str_to_utf16str(mCacheDir));
+#else
+    std::string cache_path(mCacheDir);
+#endif
+    if (boost::filesystem::is_directory(cache_path, ec) && !ec.failed())
+    {
+        for (auto& entry : boost::make_iterator_range(boost::filesystem::directory_iterator(cache_path, ec), {}))
+        {
+            if (boost::filesystem::is_regular_file(entry, ec) && !ec.failed())
+            {
+                const std::string name = entry.path().filename().string();
+                if (name.compare(0, mCacheFilenamePrefix.size(), mCacheFilenamePrefix) != 0)
+                {
+                    continue;
+                }
+                if (mIndex.find(name) != mIndex.end())
+                {
+                    continue;
+                }
+
+                uintmax_t file_size = boost::filesystem::file_size(entry, ec);
+                if (ec.failed())
+                {
+                    continue;
+                }
+                const std::time_t file_time = boost::filesystem::last_write_time(entry, ec);
+                if (ec.failed())
+                {
+                    continue;
+                }
+
+                setEntry(name, file_size, file_time, LLAssetType::AT_UNKNOWN);
+            }
+        }
     }
 }
 
@@ -258,62 +498,83 @@ const std::string LLDiskCache::metaDataToFilepath(const std::string id,
 
 void LLDiskCache::updateFileAccessTime(const std::string file_path)
 {
-    /**
-     * Threshold in time_t units that is used to decide if the last access time
-     * time of the file is updated or not. Added as a precaution for the concern
-     * outlined in SL-14582  about frequent writes on older SSDs reducing their
-     * lifespan. I think this is the right place for the threshold value - rather
-     * than it being a pref - do comment on that Jira if you disagree...
-     *
-     * Let's start with 1 hour in time_t units and see how that unfolds
-     */
-    const std::time_t time_threshold = 1 * 60 * 60;
-
-    // current time
-    const std::time_t cur_time = std::time(nullptr);
-
-    boost::system::error_code ec;
-#if LL_WINDOWS
-    // file last write time
-    const std::time_t last_write_time = boost::filesystem::last_write_time(utf8str_to_utf16str(file_path), ec);
-    if (ec.failed())
+    const std::string name = filepathToIndexName(file_path);
+    if (name.empty())
     {
-        LL_WARNS() << "Failed to read last write time for cache file " << file_path << ": " << ec.message() << LL_ENDL;
         return;
     }
 
-    // delta between cur time and last time the file was written
-    const std::time_t delta_time = cur_time - last_write_time;
+    // Only the in-memory index is touched here: the access times are
+    // written out in one go when the index is saved rather than with a
+    // syscall for each file read (see SL-14582 for the concerns about
+    // frequent writes on older SSDs)
+    LLMutexLock lock(&mIndexMutex);
+    cache_index_t::iterator iter = mIndex.find(name);
+    if (iter != mIndex.end())
+    {
+        setEntry(name, iter->second.mSize, std::time(nullptr), iter->second.mAssetType);
+    }
+}
 
-    // we only write the new value if the time in time_threshold has elapsed
-    // before the last one
-    if (delta_time > time_threshold)
+void LLDiskCache::updateFileEntry(const std::string file_path, LLAssetType::EType at)
+{
+    const std::string name = filepathToIndexName(file_path);
+    if (name.empty())
     {
-        boost::filesystem::last_write_time(utf8str_to_utf16str(file_path), cur_time, ec);
+        return;
     }
+
+    boost::system::error_code ec;
+#if LL_WINDOWS
+    uintmax_t file_size = boost::filesystem::file_size(utf8str_to_utf16str(file_path), ec);
 #else
-    // file last write time
-    const std::time_t last_write_time = boost::filesystem::last_write_time(file_path, ec);
+    uintmax_t file_size = boost::filesystem::file_size(file_path, ec);
+#endif
+
+    LLMutexLock lock(&mIndexMutex);
     if (ec.failed())
     {
-        LL_WARNS() << "Failed to read last write time for cache file " << file_path << ": " << ec.message() << LL_ENDL;
+        cache_index_t::iterator iter = mIndex.find(name);
+        if (iter != mIndex.end())
+        {
+            eraseEntry(iter);
+        }
         return;
     }
+    setEntry(name, file_size, std::time(nullptr), at);
+}
 
-    // delta between cur time and last time the file was written
-    const std::time_t delta_time = cur_time - last_write_time;
+void LLDiskCache::removeFileEntry(const std::string file_path)
+{
+    const std::string name = filepathToIndexName(file_path);
 
-    // we only write the new value if the time in time_threshold has elapsed
-    // before the last one
-    if (delta_time > time_threshold)
+    LLMutexLock lock(&mIndexMutex);
+    cache_index_t::iterator iter = mIndex.find(name);
+    if (iter != mIndex.end())
     {
-        boost::filesystem::last_write_time(file_path, cur_time, ec);
+        eraseEntry(iter);
     }
-#endif
+}
 
-    if (ec.failed())
+void LLDiskCache::renameFileEntry(const std::string old_file_path,
+                                  const std::string new_file_path,
+                                  LLAssetType::EType new_at)
+{
+    const std::string old_name = filepathToIndexName(old_file_path);
+    const std::string new_name = filepathToIndexName(new_file_path);
+
+    LLMutexLock lock(&mIndexMutex);
+    cache_index_t::iterator iter = mIndex.find(old_name);
+    if (iter == mIndex.end())
+    {
+        return;
+    }
+
+    cache_entry_t entry = iter->second;
+    eraseEntry(iter);
+    if (!new_name.empty())
     {
-        LL_WARNS() << "Failed to update last write time for cache file " << file_path << ": " << ec.message() << LL_ENDL;
+        setEntry(new_name, entry.mSize, std::time(nullptr), new_at);
     }
 }
 
@@ -321,8 +582,14 @@ const std::string LLDiskCache::getCacheInfo()
 {
     std::ostringstream cache_info;
 
+    uintmax_t used_bytes = 0;
+    {
+        LLMutexLock lock(&mIndexMutex);
+        used_bytes = mIndexValid ? mIndexSizeBytes : dirFileSize(mCacheDir);
+    }
+
     F32 max_in_mb = (F32)mMaxSizeBytes / (1024.0 * 1024.0);
-    F32 percent_used = ((F32)dirFileSize(mCacheDir) / (F32)mMaxSizeBytes) * 100.0;
+    F32 percent_used = ((F32)used_bytes / (F32)mMaxSizeBytes) * 100.0;
 
     cache_info << std::fixed;
     cache_info << std::setprecision(1);
@@ -340,6 +607,20 @@ void LLDiskCache::clearCache()
      * the component files but it's called infrequently so it's
      * likely just fine
      */
+    LLMutexLock lock(&mIndexMutex);
+    mIndex.clear();
+    mLRU.clear();
+    mIndexSizeBytes = 0;
+    // The directory is about to be empty so there is nothing to rescan
+    mIndexValid = true;
+    LLFile::remove(mIndexFilename, ENOENT);
+
+    // small assets may be packed rather than stored as files of their own
+    if (LLPackedAssetStore::instanceExists())
+    {
+        LLPackedAssetStore::getInstance()->clear();
+    }
+
     boost::system::error_code ec;
 #if LL_WINDOWS
     std::wstring cache_path(utf8str_to_utf16str(mCacheDir));
@@ -449,5 +730,10 @@ void LLPurgeDiskCacheThread::run()
     while (LLApp::instance()->sleep(CHECK_INTERVAL))
     {
         LLDiskCache::instance().purge();
+
+        if (LLPackedAssetStore::instanceExists())
+        {
+            LLPackedAssetStore::instance().compact();
+        }
     }
 }
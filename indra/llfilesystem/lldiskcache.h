@@ -22,12 +22,17 @@
                     that identifies the type of asset being stored.
         .asset      A file extension of .asset is used to help
                     identify this as a Viewer asset file
- * 2/ The time of last access for a file can be updated instantly
- *    for file reads and automatically as part of the file writes.
- * 3/ The purge algorithm collects a list of all files in the
- *    directory, sorts them by date of last access (write) and then
- *    deletes any files based on age until the total size of all
- *    the files is less than the maximum size specified.
+ * 2/ The size, asset type and time of last access of every file are
+ *    kept in an in-memory index. Reads only touch the index (no
+ *    syscalls) and writes update it with the new file size.
+ * 3/ The index is ordered by time of last access so the purge
+ *    algorithm simply evicts the oldest entries until the total size
+ *    of all the files is less than the maximum size specified. Each
+ *    eviction is O(log n) - no directory walk or sort is needed.
+ *    The index is saved to disk on shutdown and reloaded on startup.
+ *    If it is missing or does not pass validation (for example after
+ *    a crash), it is rebuilt from a full scan of the cache directory
+ *    using the file modification times as the last access times.
  * 4/ An LLSingleton idiom is used since there will only ever be
  *    a single cache and we want to access it from numerous places.
  * 5/ Performance on my modest system seems very acceptable. For
@@ -63,6 +68,10 @@
 #define _LLDISKCACHE
 
 #include "llsingleton.h"
+#include "llmutex.h"
+
+#include <set>
+#include <unordered_map>
 
 class LLDiskCache :
     public LLParamSingleton<LLDiskCache>
@@ -96,6 +105,12 @@ class LLDiskCache :
 
         virtual ~LLDiskCache() = default;
 
+        /**
+         * Write the in-memory index back to disk so the next session
+         * does not have to rebuild it with a full directory scan
+         */
+        void cleanupSingleton() override;
+
     public:
         /**
          * Construct a filename and path to it based on the file meta data
@@ -109,22 +124,43 @@ class LLDiskCache :
                                              const std::string extra_info);
 
         /**
-         * Update the "last write time" of a file to "now". This must be called whenever a
+         * Update the "last access time" of a file to "now". This must be called whenever a
          * file in the cache is read (not written) so that the last time the file was
          * accessed is up to date (This is used in the mechanism for purging the cache)
+         * Only the in-memory index is updated - the new time reaches the disk when the
+         * index is saved so reading a cached asset costs no extra syscalls.
          */
         void updateFileAccessTime(const std::string file_path);
 
+        /**
+         * Record that a file in the cache was just written. The size of the file
+         * is refreshed from the filesystem and its last access time set to "now".
+         */
+        void updateFileEntry(const std::string file_path, LLAssetType::EType at);
+
+        /**
+         * Forget about a file that was removed from the cache
+         */
+        void removeFileEntry(const std::string file_path);
+
+        /**
+         * Move the index entry of a file that was renamed within the cache
+         */
+        void renameFileEntry(const std::string old_file_path,
+                             const std::string new_file_path,
+                             LLAssetType::EType new_at);
+
         /**
          * Purge the oldest items in the cache so that the combined size of all files
          * is no bigger than mMaxSizeBytes.
          *
          * WARNING: purge() is called by LLPurgeDiskCacheThread. As such it must
-         * NOT touch any LLDiskCache data without introducing and locking a mutex!
+         * NOT touch any LLDiskCache data without locking mIndexMutex!
          *
-         * Purging the disk cache involves nontrivial work on the viewer's
-         * filesystem. If called on the main thread, this causes a noticeable
-         * freeze.
+         * Purging the disk cache only removes files when the index says the
+         * cache is too big but the first purge of a session has to rebuild the
+         * index with a full directory scan when no valid saved index exists.
+         * If called on the main thread, this causes a noticeable freeze.
          */
         void purge();
 
@@ -143,6 +179,70 @@ class LLDiskCache :
         void removeOldVFSFiles();
 
     private:
+        /**
+         * Index entry for a single cache file. The file name (without the
+         * cache directory) is the key of the index map.
+         */
+        struct cache_entry_t
+        {
+            uintmax_t mSize;
+            std::time_t mLastAccess;
+            LLAssetType::EType mAssetType;
+        };
+        typedef std::unordered_map<std::string, cache_entry_t> cache_index_t;
+
+        /**
+         * The index entries ordered by last access time, oldest first. The
+         * name pointer refers to the key of the entry in mIndex which is
+         * stable for as long as the entry exists.
+         */
+        typedef std::pair<std::time_t, const std::string*> lru_key_t;
+        typedef std::set<lru_key_t> lru_set_t;
+
+        /**
+         * Strip the cache directory from a full path to get the index key. Returns
+         * an empty string if the path is not inside the cache directory.
+         */
+        std::string filepathToIndexName(const std::string& file_path) const;
+
+        /**
+         * Insert or update an entry in the index. mIndexMutex must be held.
+         */
+        void setEntry(const std::string& name, uintmax_t size, std::time_t last_access,
+                      LLAssetType::EType at);
+
+        /**
+         * Remove an entry from the index. mIndexMutex must be held.
+         */
+        void eraseEntry(cache_index_t::iterator iter);
+
+        /**
+         * Make sure the index reflects the cache directory, loading it from
+         * the saved index file or rebuilding it from a directory scan if
+         * needed. mIndexMutex must be held.
+         */
+        void ensureIndex();
+
+        /**
+         * Load the index from the saved index file. Returns false if the file
+         * is missing or fails validation, leaving the in-memory index untouched.
+         * The file is deleted once read so that a crash later in the session
+         * forces a rescan instead of trusting stale data.
+         */
+        bool loadIndex();
+
+        /**
+         * Save the index to the index file. mIndexMutex must be held.
+         */
+        void saveIndex();
+
+        /**
+         * Rebuild the index with a full scan of the cache directory. Entries
+         * already known in memory are kept as they are more recent than the
+         * modification times found on disk. mIndexMutex must be held.
+         */
+        void rebuildIndex();
+
         /**
          * Utility function to gather the total size the files in a given
          * directory. Primarily used here to determine the directory size
@@ -182,6 +282,25 @@ class LLDiskCache :
          */
         std::string mCacheFilenamePrefix;
 
+        /**
+         * Full path of the file the index is persisted to between sessions.
+         * It deliberately does not start with mCacheFilenamePrefix so that
+         * it is never mistaken for a cache file.
+         */
+        std::string mIndexFilename;
+
+        /**
+         * The in-memory index of the cache files, the same entries ordered
+         * by last access time and the total size of all the indexed files.
+         * All three are protected by mIndexMutex since they are used from
+         * the main thread, worker threads and LLPurgeDiskCacheThread.
+         */
+        cache_index_t mIndex;
+        lru_set_t mLRU;
+        uintmax_t mIndexSizeBytes;
+        bool mIndexValid;
+        LLMutex mIndexMutex;
+
         /**
          * When enabled, displays additional debugging information in
          * various parts of the code
@@ -33,6 +33,7 @@
 #include "llfilesystem.h"
 #include "llfasttimer.h"
 #include "lldiskcache.h"
+#include "llpackedassetstore.h"
 
 const S32 LLFileSystem::READ        = 0x00000001;
 const S32 LLFileSystem::WRITE       = 0x00000002;
@@ -64,11 +65,8 @@ LLFileSystem::LLFileSystem(const LLUUID& file_id, const LLAssetType::EType file_
         // even though we are reading and not writing because this is the
         // way the cache works - it relies on a valid "last accessed time" for
         // each file so it knows how to remove the oldest, unused files
-        bool exists = gDirUtilp->fileExists(filename);
-        if (exists)
-        {
-            LLDiskCache::getInstance()->updateFileAccessTime(filename);
-        }
+        // (files that don't exist are simply not in the cache index)
+        LLDiskCache::getInstance()->updateFileAccessTime(filename);
     }
 }
 
@@ -76,9 +74,59 @@ LLFileSystem::~LLFileSystem()
 {
 }
 
+// static
+LLPackedAssetStore* LLFileSystem::getPackedStore(const LLAssetType::EType file_type)
+{
+    if (LLPackedAssetStore::isPackableType(file_type) && LLPackedAssetStore::instanceExists())
+    {
+        return LLPackedAssetStore::getInstance();
+    }
+    return nullptr;
+}
+
+// static
+void LLFileSystem::unpackFile(const LLUUID& file_id, const std::string& filename)
+{
+    LLPackedAssetStore* store = LLPackedAssetStore::getInstance();
+    S32 size = store->getSize(file_id);
+    if (size < 0)
+    {
+        return;
+    }
+
+    std::vector<U8> data(size);
+    if (size > 0 && store->read(file_id, 0, data.data(), size) != size)
+    {
+        LL_WARNS() << "Failed to read packed asset " << file_id << LL_ENDL;
+        store->remove(file_id);
+        return;
+    }
+
+    {
+        llofstream ofs(filename, std::ios::binary);
+        if (!ofs)
+        {
+            LL_WARNS() << "Failed to unpack asset " << file_id << " to " << filename << LL_ENDL;
+            return;
+        }
+        ofs.write((const char*)data.data(), size);
+    }
+    store->remove(file_id);
+    LLDiskCache::getInstance()->updateFileEntry(filename, LLAssetType::AT_UNKNOWN);
+}
+
 // static
 bool LLFileSystem::getExists(const LLUUID& file_id, const LLAssetType::EType file_type)
 {
+    if (LLPackedAssetStore* store = getPackedStore(file_type))
+    {
+        S32 packed_size = store->getSize(file_id);
+        if (packed_size >= 0)
+        {
+            return packed_size > 0;
+        }
+    }
+
     std::string id_str;
     file_id.toString(id_str);
     const std::string extra_info = "";
@@ -101,7 +149,13 @@ bool LLFileSystem::removeFile(const LLUUID& file_id, const LLAssetType::EType fi
     const std::string extra_info = "";
     const std::string filename =  LLDiskCache::getInstance()->metaDataToFilepath(id_str, file_type, extra_info);
 
+    if (LLPackedAssetStore* store = getPackedStore(file_type))
+    {
+        store->remove(file_id);
+    }
+
     LLFile::remove(filename.c_str(), suppress_error);
+    LLDiskCache::getInstance()->removeFileEntry(filename);
 
     return true;
 }
@@ -122,6 +176,22 @@ bool LLFileSystem::renameFile(const LLUUID& old_file_id, const LLAssetType::ETyp
     // Rename needs the new file to not exist.
     LLFileSystem::removeFile(new_file_id, new_file_type, ENOENT);
 
+    if (LLPackedAssetStore* store = getPackedStore(old_file_type))
+    {
+        if (getPackedStore(new_file_type))
+        {
+            if (store->rename(old_file_id, new_file_id, new_file_type))
+            {
+                return TRUE;
+            }
+        }
+        else
+        {
+            // The new type is never packed, move the data to a loose file
+            unpackFile(old_file_id, old_filename);
+        }
+    }
+
     if (LLFile::rename(old_filename, new_filename) != 0)
     {
         // We would like to return FALSE here indicating the operation
@@ -130,6 +200,10 @@ bool LLFileSystem::renameFile(const LLUUID& old_file_id, const LLAssetType::ETyp
         //return FALSE;
         LL_WARNS() << "Failed to rename " << old_file_id << " to " << new_id_str << " reason: "  << strerror(errno) << LL_ENDL;
     }
+    else
+    {
+        LLDiskCache::getInstance()->renameFileEntry(old_filename, new_filename, new_file_type);
+    }
 
     return TRUE;
 }
@@ -142,6 +216,15 @@ S32 LLFileSystem::getFileSize(const LLUUID& file_id, const LLAssetType::EType fi
     const std::string extra_info = "";
     const std::string filename =  LLDiskCache::getInstance()->metaDataToFilepath(id_str, file_type, extra_info);
 
+    if (LLPackedAssetStore* store = getPackedStore(file_type))
+    {
+        S32 packed_size = store->getSize(file_id);
+        if (packed_size >= 0)
+        {
+            return packed_size;
+        }
+    }
+
     S32 file_size = 0;
     llifstream file(filename, std::ios::binary);
     if (file.is_open())
@@ -157,6 +240,17 @@ BOOL LLFileSystem::read(U8* buffer, S32 bytes)
 {
     BOOL success = FALSE;
 
+    if (LLPackedAssetStore* store = getPackedStore(mFileType))
+    {
+        S32 bytes_read = store->read(mFileID, mPosition, buffer, bytes);
+        if (bytes_read >= 0)
+        {
+            mBytesRead = bytes_read;
+            mPosition += mBytesRead;
+            return mBytesRead ? TRUE : FALSE;
+        }
+    }
+
     std::string id;
     mFileID.toString(id);
     const std::string extra_info = "";
@@ -209,6 +303,39 @@ BOOL LLFileSystem::write(const U8* buffer, S32 bytes)
 
     BOOL success = FALSE;
 
+    // Small assets go to the packed store if it is enabled. Anything that
+    // outgrows it or needs in-place writes is moved out to a loose file.
+    if (LLPackedAssetStore* store = getPackedStore(mFileType))
+    {
+        const bool packed = store->getSize(mFileID) >= 0;
+        if (mMode == APPEND)
+        {
+            if ((packed || !gDirUtilp->fileExists(filename)) &&
+                store->append(mFileID, mFileType, buffer, bytes))
+            {
+                mPosition = store->getSize(mFileID);
+                return TRUE;
+            }
+            unpackFile(mFileID, filename);
+        }
+        else if (mMode == READ_WRITE)
+        {
+            unpackFile(mFileID, filename);
+        }
+        else if (store->write(mFileID, mFileType, buffer, bytes))
+        {
+            // Drop any stale loose copy so the two can't disagree
+            LLFile::remove(filename, ENOENT);
+            LLDiskCache::getInstance()->removeFileEntry(filename);
+            mPosition += bytes;
+            return TRUE;
+        }
+        else if (packed)
+        {
+            store->remove(mFileID);
+        }
+    }
+
     if (mMode == APPEND)
     {
         llofstream ofs(filename, std::ios::app | std::ios::binary);
@@ -259,6 +386,12 @@ BOOL LLFileSystem::write(const U8* buffer, S32 bytes)
         }
     }
 
+    if (success)
+    {
+        // keep the cache index up to date with the new size of the file
+        LLDiskCache::getInstance()->updateFileEntry(filename, mFileType);
+    }
+
     return success;
 }
 
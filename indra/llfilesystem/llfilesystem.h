@@ -34,6 +34,8 @@
 #include "llassettype.h"
 #include "lldiskcache.h"
 
+class LLPackedAssetStore;
+
 class LLFileSystem
 {
     public:
@@ -65,6 +67,18 @@ class LLFileSystem
         static const S32 READ_WRITE;
         static const S32 APPEND;
 
+    protected:
+        /**
+         * The packed asset store if it is enabled and may hold assets of
+         * the given type, null otherwise
+         */
+        static LLPackedAssetStore* getPackedStore(const LLAssetType::EType file_type);
+
+        /**
+         * Move a packed asset out to a loose cache file
+         */
+        static void unpackFile(const LLUUID& file_id, const std::string& filename);
+
     protected:
         LLAssetType::EType mFileType;
         LLUUID  mFileID;
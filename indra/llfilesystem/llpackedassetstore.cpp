@@ -0,0 +1,580 @@
+/**
+ * @file llpackedassetstore.cpp
+ * @brief Packed storage for small cached assets.
+ *
+ * Note: as with lldiskcache.cpp, the description of how this works and
+ * the comments about each function live in the header.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llfile.h"
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <iomanip>
+
+#include "llpackedassetstore.h"
+
+const S32 LLPackedAssetStore::MAX_PACKED_ASSET_SIZE = 64 * 1024;
+
+namespace
+{
+    // "LLP2" - the start of every record header. Segments written before
+    // records carried their access stamp ("LLPK") are dropped on startup.
+    const U32 RECORD_MAGIC = 0x32504c4c;
+    const U32 RECORD_FLAG_TOMBSTONE = 0x1;
+
+    // Fixed size header in front of every record payload
+    struct record_header_t
+    {
+        U32 mMagic;
+        U32 mFlags;
+        U8 mID[UUID_BYTES];
+        S32 mAssetType;
+        S32 mSize;
+        // mAccessCounter as of the last write or compaction
+        U64 mLastAccess;
+    };
+    static_assert(sizeof(record_header_t) == 40, "record header layout changed");
+
+    // Don't bother rewriting a shard for less than this much garbage
+    const S64 MIN_COMPACT_BYTES = 256 * 1024;
+
+    bool seek_file(LLFILE* file, S64 offset)
+    {
+#if LL_WINDOWS
+        return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+        return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+    }
+
+    S64 file_length(LLFILE* file)
+    {
+#if LL_WINDOWS
+        _fseeki64(file, 0, SEEK_END);
+        return _ftelli64(file);
+#else
+        fseeko(file, 0, SEEK_END);
+        return ftello(file);
+#endif
+    }
+}
+
+LLPackedAssetStore::LLPackedAssetStore(const std::string store_dir,
+                                       const uintmax_t max_size_bytes) :
+    mStoreDir(store_dir),
+    mMaxSizeBytes(max_size_bytes),
+    mAccessCounter(0)
+{
+    LLFile::mkdir(store_dir);
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    size_t asset_count = 0;
+    for (U32 i = 0; i < SHARD_COUNT; ++i)
+    {
+        std::ostringstream filename;
+#if LL_WINDOWS
+        filename << mStoreDir << "\\packed_"
+#else
+        filename << mStoreDir << "/packed_"
+#endif
+                  << std::setw(2) << std::setfill('0') << i << ".dat";
+        mShards[i].mFilename = filename.str();
+        openShard(mShards[i]);
+        asset_count += mShards[i].mRecords.size();
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    LL_INFOS() << "Packed asset store indexed " << asset_count << " assets in "
+               << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count()
+               << " ms" << LL_ENDL;
+}
+
+LLPackedAssetStore::~LLPackedAssetStore()
+{
+    for (U32 i = 0; i < SHARD_COUNT; ++i)
+    {
+        if (mShards[i].mFile)
+        {
+            LLFile::close(mShards[i].mFile);
+            mShards[i].mFile = nullptr;
+        }
+    }
+}
+
+// static
+bool LLPackedAssetStore::isPackableType(LLAssetType::EType at)
+{
+    // Textures have their own cache and meshes are written at arbitrary
+    // offsets in several passes (header first, then LODs as they arrive)
+    return at != LLAssetType::AT_TEXTURE && at != LLAssetType::AT_MESH;
+}
+
+LLPackedAssetStore::shard_t& LLPackedAssetStore::getShard(const LLUUID& id)
+{
+    // asset IDs are random enough that the first byte spreads them evenly
+    return mShards[id.mData[0] % SHARD_COUNT];
+}
+
+void LLPackedAssetStore::openShard(shard_t& shard)
+{
+    shard.mRecords.clear();
+    shard.mEndOffset = 0;
+    shard.mLiveBytes = 0;
+
+    shard.mFile = LLFile::fopen(shard.mFilename, "r+b");
+    if (!shard.mFile)
+    {
+        shard.mFile = LLFile::fopen(shard.mFilename, "w+b");
+        if (!shard.mFile)
+        {
+            LL_WARNS() << "Unable to open packed asset segment " << shard.mFilename << LL_ENDL;
+        }
+        return;
+    }
+
+    const S64 file_size = file_length(shard.mFile);
+
+    // Walk the headers, skipping over the payloads
+    record_header_t header;
+    S64 offset = 0;
+    while (offset + (S64)sizeof(header) <= file_size)
+    {
+        if (!seek_file(shard.mFile, offset) ||
+            fread(&header, sizeof(header), 1, shard.mFile) != 1 ||
+            header.mMagic != RECORD_MAGIC ||
+            header.mSize < 0 || header.mSize > MAX_PACKED_ASSET_SIZE ||
+            offset + (S64)sizeof(header) + header.mSize > file_size)
+        {
+            break;
+        }
+
+        LLUUID id;
+        memcpy(id.mData, header.mID, UUID_BYTES);
+
+        record_map_t::iterator iter = shard.mRecords.find(id);
+        if (iter != shard.mRecords.end())
+        {
+            shard.mLiveBytes -= iter->second.mSize;
+            shard.mRecords.erase(iter);
+        }
+        if (!(header.mFlags & RECORD_FLAG_TOMBSTONE))
+        {
+            record_t& record = shard.mRecords[id];
+            record.mOffset = offset + sizeof(header);
+            record.mSize = header.mSize;
+            record.mAssetType = (LLAssetType::EType)header.mAssetType;
+            record.mLastAccess = header.mLastAccess;
+            shard.mLiveBytes += header.mSize;
+        }
+        if (header.mLastAccess > mAccessCounter)
+        {
+            // only ever raised here while the constructor runs alone
+            mAccessCounter = header.mLastAccess;
+        }
+
+        offset += sizeof(header) + header.mSize;
+    }
+    shard.mEndOffset = offset;
+
+    if (offset != file_size)
+    {
+        // Most likely a record cut short by a crash - drop it so that the
+        // next record is not appended after garbage
+        LL_WARNS() << "Truncating packed asset segment " << shard.mFilename << " from "
+                   << file_size << " to " << offset << " bytes" << LL_ENDL;
+        LLFile::close(shard.mFile);
+        boost::system::error_code ec;
+#if LL_WINDOWS
+        boost::filesystem::resize_file(utf8str_to_utf16str(shard.mFilename), offset, ec);
+#else
+        boost::filesystem::resize_file(shard.mFilename, offset, ec);
+#endif
+        shard.mFile = LLFile::fopen(shard.mFilename, "r+b");
+        if (ec.failed() || !shard.mFile)
+        {
+            LL_WARNS() << "Unable to truncate packed asset segment " << shard.mFilename << ", discarding it" << LL_ENDL;
+            if (shard.mFile)
+            {
+                LLFile::close(shard.mFile);
+            }
+            shard.mRecords.clear();
+            shard.mEndOffset = 0;
+            shard.mLiveBytes = 0;
+            shard.mFile = LLFile::fopen(shard.mFilename, "w+b");
+        }
+    }
+}
+
+bool LLPackedAssetStore::appendRecord(shard_t& shard, const LLUUID& id, LLAssetType::EType at,
+                                      const U8* buffer, S32 bytes, bool tombstone)
+{
+    if (!shard.mFile)
+    {
+        return false;
+    }
+
+    record_header_t header;
+    header.mMagic = RECORD_MAGIC;
+    header.mFlags = tombstone ? RECORD_FLAG_TOMBSTONE : 0;
+    memcpy(header.mID, id.mData, UUID_BYTES);
+    header.mAssetType = at;
+    header.mSize = tombstone ? 0 : bytes;
+    header.mLastAccess = ++mAccessCounter;
+
+    if (!seek_file(shard.mFile, shard.mEndOffset) ||
+        fwrite(&header, sizeof(header), 1, shard.mFile) != 1 ||
+        (header.mSize && fwrite(buffer, header.mSize, 1, shard.mFile) != 1) ||
+        fflush(shard.mFile) != 0)
+    {
+        LL_WARNS() << "Failed to write packed asset " << id << " to " << shard.mFilename << LL_ENDL;
+        // Whatever made it to the disk is past mEndOffset and gets overwritten
+        // by the next record or truncated away on the next startup
+        return false;
+    }
+
+    record_map_t::iterator iter = shard.mRecords.find(id);
+    if (iter != shard.mRecords.end())
+    {
+        shard.mLiveBytes -= iter->second.mSize;
+        shard.mRecords.erase(iter);
+    }
+    if (!tombstone)
+    {
+        record_t& record = shard.mRecords[id];
+        record.mOffset = shard.mEndOffset + sizeof(header);
+        record.mSize = bytes;
+        record.mAssetType = at;
+        record.mLastAccess = header.mLastAccess;
+        shard.mLiveBytes += bytes;
+    }
+    shard.mEndOffset += sizeof(header) + header.mSize;
+
+    return true;
+}
+
+bool LLPackedAssetStore::readPayload(shard_t& shard, const record_t& record, U8* buffer)
+{
+    return shard.mFile && seek_file(shard.mFile, record.mOffset) &&
+           (record.mSize == 0 || fread(buffer, record.mSize, 1, shard.mFile) == 1);
+}
+
+S32 LLPackedAssetStore::getSize(const LLUUID& id)
+{
+    shard_t& shard = getShard(id);
+    LLMutexLock lock(&shard.mMutex);
+
+    record_map_t::const_iterator iter = shard.mRecords.find(id);
+    return iter != shard.mRecords.end() ? iter->second.mSize : -1;
+}
+
+S32 LLPackedAssetStore::read(const LLUUID& id, S32 offset, U8* buffer, S32 bytes)
+{
+    shard_t& shard = getShard(id);
+    LLMutexLock lock(&shard.mMutex);
+
+    record_map_t::iterator iter = shard.mRecords.find(id);
+    if (iter == shard.mRecords.end())
+    {
+        return -1;
+    }
+
+    record_t& record = iter->second;
+    record.mLastAccess = ++mAccessCounter;
+
+    S32 to_read = llclamp(record.mSize - offset, 0, bytes);
+    if (to_read == 0)
+    {
+        return 0;
+    }
+    if (!seek_file(shard.mFile, record.mOffset + offset))
+    {
+        return 0;
+    }
+    return (S32)fread(buffer, 1, to_read, shard.mFile);
+}
+
+bool LLPackedAssetStore::write(const LLUUID& id, LLAssetType::EType at, const U8* buffer, S32 bytes)
+{
+    if (bytes < 0 || bytes > MAX_PACKED_ASSET_SIZE)
+    {
+        return false;
+    }
+
+    shard_t& shard = getShard(id);
+    LLMutexLock lock(&shard.mMutex);
+    return appendRecord(shard, id, at, buffer, bytes);
+}
+
+bool LLPackedAssetStore::append(const LLUUID& id, LLAssetType::EType at, const U8* buffer, S32 bytes)
+{
+    shard_t& shard = getShard(id);
+    LLMutexLock lock(&shard.mMutex);
+
+    record_map_t::const_iterator iter = shard.mRecords.find(id);
+    if (iter == shard.mRecords.end())
+    {
+        return bytes >= 0 && bytes <= MAX_PACKED_ASSET_SIZE && appendRecord(shard, id, at, buffer, bytes);
+    }
+
+    const record_t record = iter->second;
+    if (bytes < 0 || record.mSize + bytes > MAX_PACKED_ASSET_SIZE)
+    {
+        return false;
+    }
+
+    // Records are immutable so an append writes the combined data as a new one
+    std::vector<U8> data(record.mSize + bytes);
+    if (!readPayload(shard, record, data.data()))
+    {
+        return false;
+    }
+    if (bytes)
+    {
+        memcpy(data.data() + record.mSize, buffer, bytes);
+    }
+    return appendRecord(shard, id, at, data.data(), (S32)data.size());
+}
+
+bool LLPackedAssetStore::remove(const LLUUID& id)
+{
+    shard_t& shard = getShard(id);
+    LLMutexLock lock(&shard.mMutex);
+
+    if (shard.mRecords.find(id) == shard.mRecords.end())
+    {
+        return false;
+    }
+    return appendRecord(shard, id, LLAssetType::AT_NONE, nullptr, 0, true);
+}
+
+bool LLPackedAssetStore::rename(const LLUUID& old_id, const LLUUID& new_id, LLAssetType::EType new_type)
+{
+    std::vector<U8> data;
+    {
+        shard_t& shard = getShard(old_id);
+        LLMutexLock lock(&shard.mMutex);
+
+        record_map_t::const_iterator iter = shard.mRecords.find(old_id);
+        if (iter == shard.mRecords.end())
+        {
+            return false;
+        }
+        data.resize(iter->second.mSize);
+        if (!readPayload(shard, iter->second, data.data()))
+        {
+            return false;
+        }
+    }
+
+    // The IDs usually live in different shards so the data is copied over
+    // rather than the record relinked
+    {
+        shard_t& shard = getShard(new_id);
+        LLMutexLock lock(&shard.mMutex);
+        if (!appendRecord(shard, new_id, new_type, data.data(), (S32)data.size()))
+        {
+            return false;
+        }
+    }
+
+    remove(old_id);
+    return true;
+}
+
+void LLPackedAssetStore::compactShard(shard_t& shard, U64 evict_before)
+{
+    const std::string temp_filename = shard.mFilename + ".compact";
+    LLFILE* temp = LLFile::fopen(temp_filename, "w+b");
+    if (!temp)
+    {
+        LL_WARNS() << "Unable to compact packed asset segment " << shard.mFilename << LL_ENDL;
+        return;
+    }
+
+    record_map_t records;
+    S64 live_bytes = 0;
+    S64 offset = 0;
+    bool success = true;
+    std::vector<U8> data;
+    for (const record_map_t::value_type& item : shard.mRecords)
+    {
+        const record_t& record = item.second;
+        if (record.mLastAccess < evict_before)
+        {
+            continue;
+        }
+
+        data.resize(record.mSize);
+        if (!readPayload(shard, record, data.data()))
+        {
+            // unreadable - drop it, it will be fetched again if needed
+            continue;
+        }
+
+        record_header_t header;
+        header.mMagic = RECORD_MAGIC;
+        header.mFlags = 0;
+        memcpy(header.mID, item.first.mData, UUID_BYTES);
+        header.mAssetType = record.mAssetType;
+        header.mSize = record.mSize;
+        // keeps the reads since the record was written
+        header.mLastAccess = record.mLastAccess;
+        if (fwrite(&header, sizeof(header), 1, temp) != 1 ||
+            (record.mSize && fwrite(data.data(), record.mSize, 1, temp) != 1))
+        {
+            success = false;
+            break;
+        }
+
+        record_t& new_record = records[item.first];
+        new_record = record;
+        new_record.mOffset = offset + sizeof(header);
+        offset += sizeof(header) + record.mSize;
+        live_bytes += record.mSize;
+    }
+    success = fflush(temp) == 0 && success;
+    LLFile::close(temp);
+
+    if (!success)
+    {
+        LL_WARNS() << "Failed to compact packed asset segment " << shard.mFilename << LL_ENDL;
+        LLFile::remove(temp_filename);
+        return;
+    }
+
+    LLFile::close(shard.mFile);
+#if LL_WINDOWS
+    // rename() does not replace an existing file on Windows
+    LLFile::remove(shard.mFilename);
+#endif
+    if (LLFile::rename(temp_filename, shard.mFilename) != 0)
+    {
+        // Keep going with the old segment
+        LLFile::remove(temp_filename);
+        shard.mFile = LLFile::fopen(shard.mFilename, "r+b");
+        if (!shard.mFile)
+        {
+            openShard(shard);
+        }
+        return;
+    }
+
+    shard.mFile = LLFile::fopen(shard.mFilename, "r+b");
+    if (!shard.mFile)
+    {
+        openShard(shard);
+        return;
+    }
+    shard.mRecords.swap(records);
+    shard.mEndOffset = offset;
+    shard.mLiveBytes = live_bytes;
+}
+
+void LLPackedAssetStore::compact()
+{
+    // Work out the access counter below which records have to go for the
+    // store to fit in its budget again
+    U64 evict_before = 0;
+    typedef std::pair<U64, S32> access_t;
+    std::vector<access_t> accesses;
+    uintmax_t total_bytes = 0;
+    for (U32 i = 0; i < SHARD_COUNT; ++i)
+    {
+        LLMutexLock lock(&mShards[i].mMutex);
+        for (const record_map_t::value_type& item : mShards[i].mRecords)
+        {
+            accesses.push_back(access_t(item.second.mLastAccess, item.second.mSize));
+        }
+        total_bytes += mShards[i].mLiveBytes;
+    }
+    if (total_bytes > mMaxSizeBytes)
+    {
+        std::sort(accesses.begin(), accesses.end());
+        for (const access_t& access : accesses)
+        {
+            if (total_bytes <= mMaxSizeBytes)
+            {
+                break;
+            }
+            total_bytes -= access.second;
+            evict_before = access.first + 1;
+        }
+        LL_INFOS() << "Evicting packed assets to a maximum of " << mMaxSizeBytes << " bytes" << LL_ENDL;
+    }
+
+    for (U32 i = 0; i < SHARD_COUNT; ++i)
+    {
+        shard_t& shard = mShards[i];
+        LLMutexLock lock(&shard.mMutex);
+
+        bool must_evict = false;
+        if (evict_before)
+        {
+            for (const record_map_t::value_type& item : shard.mRecords)
+            {
+                if (item.second.mLastAccess < evict_before)
+                {
+                    must_evict = true;
+                    break;
+                }
+            }
+        }
+
+        const S64 garbage = shard.mEndOffset - shard.mLiveBytes - (S64)(shard.mRecords.size() * sizeof(record_header_t));
+        if (must_evict || (garbage > MIN_COMPACT_BYTES && garbage > shard.mLiveBytes / 2))
+        {
+            compactShard(shard, evict_before);
+        }
+    }
+}
+
+void LLPackedAssetStore::clear()
+{
+    for (U32 i = 0; i < SHARD_COUNT; ++i)
+    {
+        shard_t& shard = mShards[i];
+        LLMutexLock lock(&shard.mMutex);
+
+        if (shard.mFile)
+        {
+            LLFile::close(shard.mFile);
+        }
+        shard.mFile = LLFile::fopen(shard.mFilename, "w+b");
+        shard.mRecords.clear();
+        shard.mEndOffset = 0;
+        shard.mLiveBytes = 0;
+    }
+}
+
+uintmax_t LLPackedAssetStore::getSizeBytes()
+{
+    uintmax_t total_bytes = 0;
+    for (U32 i = 0; i < SHARD_COUNT; ++i)
+    {
+        LLMutexLock lock(&mShards[i].mMutex);
+        total_bytes += mShards[i].mLiveBytes;
+    }
+    return total_bytes;
+}
@@ -0,0 +1,215 @@
+/**
+ * @file llpackedassetstore.h
+ * @brief Packed storage for small cached assets.
+ *
+ * @Description:
+ * Sounds, animations, notecards, gestures and the like are often only a
+ * few KB in size so storing each of them as an individual file in the
+ * disk cache costs more in inodes and open/close calls than the data
+ * itself. This store packs them into a handful of append-only segment
+ * files instead:
+ * 1/ Assets are spread over a fixed number of shards by asset ID. Each
+ *    shard is a single segment file that stays open for the session and
+ *    has its own mutex so unrelated reads and writes don't contend.
+ * 2/ A segment is a sequence of records, each a fixed size header (ID,
+ *    asset type, payload size, access stamp) followed by the payload. Writing an asset
+ *    appends a new record, removing one appends a tombstone. The newest
+ *    record for an ID wins.
+ * 3/ The offset index is rebuilt on startup by walking the record headers
+ *    of each segment - payloads are skipped so this is cheap. A record cut
+ *    short by a crash is truncated away.
+ * 4/ Superseded records and tombstones are reclaimed by compact() which
+ *    rewrites a shard with only its live records. If the store is over its
+ *    size budget, compaction also drops the least recently used records.
+ *    compact() is called from LLPurgeDiskCacheThread.
+ * 5/ Reading a packed asset is one seek and one read on an already open
+ *    file - no open, stat or close.
+ * LLFileSystem decides what goes into the store so its callers are unaware
+ * of whether a given asset is packed or stored as a loose file.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKEDASSETSTORE_H
+#define LL_LLPACKEDASSETSTORE_H
+
+#include "llsingleton.h"
+#include "llmutex.h"
+#include "lluuid.h"
+#include "llassettype.h"
+
+#include <atomic>
+#include <unordered_map>
+
+class LLPackedAssetStore :
+    public LLParamSingleton<LLPackedAssetStore>
+{
+        LLSINGLETON(LLPackedAssetStore,
+                    /**
+                     * The folder that holds the segment files - a child
+                     * of the disk cache folder
+                     */
+                    const std::string store_dir,
+                    /**
+                     * The maximum combined size of the live assets in bytes.
+                     * compact() evicts the least recently used ones above it.
+                     */
+                    const uintmax_t max_size_bytes);
+
+        ~LLPackedAssetStore();
+
+    public:
+        /**
+         * Assets bigger than this are never packed - they stay loose
+         * files managed by LLDiskCache
+         */
+        static const S32 MAX_PACKED_ASSET_SIZE;
+
+        /**
+         * Whether an asset of the given type may be packed at all. Meshes
+         * are excluded as they are written piecemeal at arbitrary offsets.
+         */
+        static bool isPackableType(LLAssetType::EType at);
+
+        /**
+         * Size of the packed asset or -1 if the asset is not in the store
+         */
+        S32 getSize(const LLUUID& id);
+
+        /**
+         * Copy up to bytes of the asset starting at offset into buffer and
+         * return the number of bytes copied, or -1 if the asset is not in
+         * the store. Also marks the asset as recently used.
+         */
+        S32 read(const LLUUID& id, S32 offset, U8* buffer, S32 bytes);
+
+        /**
+         * Replace the asset with the given data. Returns false if the data
+         * is too big to be packed or the segment could not be written.
+         */
+        bool write(const LLUUID& id, LLAssetType::EType at, const U8* buffer, S32 bytes);
+
+        /**
+         * Append data to a packed asset, or store it as a new asset if it is
+         * not packed yet. Returns false, leaving the store unchanged, if the
+         * result would be too big to be packed.
+         */
+        bool append(const LLUUID& id, LLAssetType::EType at, const U8* buffer, S32 bytes);
+
+        /**
+         * Remove the asset. Returns false if it was not in the store.
+         */
+        bool remove(const LLUUID& id);
+
+        /**
+         * Move a packed asset to a new ID, replacing any asset packed under
+         * that ID. Returns false if the old asset was not in the store.
+         */
+        bool rename(const LLUUID& old_id, const LLUUID& new_id, LLAssetType::EType new_type);
+
+        /**
+         * Reclaim the space used by superseded records and tombstones and
+         * evict the least recently used assets if the store is over budget.
+         * Shards are compacted one at a time so only readers of the shard
+         * being rewritten ever wait.
+         */
+        void compact();
+
+        /**
+         * Remove every asset and truncate all the segment files
+         */
+        void clear();
+
+        /**
+         * Combined size of the live assets in bytes
+         */
+        uintmax_t getSizeBytes();
+
+    private:
+        /**
+         * Where the payload of a live asset sits in its segment file
+         */
+        struct record_t
+        {
+            S64 mOffset;
+            S32 mSize;
+            LLAssetType::EType mAssetType;
+            U64 mLastAccess;
+        };
+        typedef std::unordered_map<LLUUID, record_t> record_map_t;
+
+        struct shard_t
+        {
+            LLMutex mMutex;
+            std::string mFilename;
+            LLFILE* mFile = nullptr;
+            record_map_t mRecords;
+            // end of the last valid record, where the next one is appended
+            S64 mEndOffset = 0;
+            // payload bytes of the live records
+            S64 mLiveBytes = 0;
+        };
+
+        static const U32 SHARD_COUNT = 16;
+
+        shard_t& getShard(const LLUUID& id);
+
+        /**
+         * Open or create the segment file of a shard and rebuild its
+         * index from the record headers
+         */
+        void openShard(shard_t& shard);
+
+        /**
+         * Append a record to a shard and update its index. A tombstone
+         * record has no payload and removes the asset from the index.
+         * shard.mMutex must be held.
+         */
+        bool appendRecord(shard_t& shard, const LLUUID& id, LLAssetType::EType at,
+                          const U8* buffer, S32 bytes, bool tombstone = false);
+
+        /**
+         * Read the whole payload of a record. shard.mMutex must be held.
+         */
+        bool readPayload(shard_t& shard, const record_t& record, U8* buffer);
+
+        /**
+         * Rewrite a shard keeping only its live records, minus the ones that
+         * are older than evict_before. shard.mMutex must be held.
+         */
+        void compactShard(shard_t& shard, U64 evict_before);
+
+    private:
+        std::string mStoreDir;
+        uintmax_t mMaxSizeBytes;
+        shard_t mShards[SHARD_COUNT];
+
+        /**
+         * Monotonic counter used to order the records by last access. Every
+         * record header carries its value so that the order survives a
+         * restart; reads only make it to the disk when the shard is next
+         * compacted. Continues from the highest value found on startup.
+         */
+        std::atomic<U64> mAccessCounter;
+};
+
+#endif // LL_LLPACKEDASSETSTORE_H
@@ -0,0 +1,307 @@
+/**
+ * @file llrecordcachefile.cpp
+ * @brief Memory mapped file of binary records keyed by asset ID.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llrecordcachefile.h"
+
+#include "llfile.h"
+
+namespace
+{
+    // Records start on 4 byte boundaries
+    const U32 RECORD_ALIGNMENT = 4;
+
+    U32 align_size(U32 size)
+    {
+        return (size + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+    }
+}
+
+struct LLRecordCacheFile::file_header_t
+{
+    U32 mMagic;
+    U32 mFormatVersion;
+};
+
+struct LLRecordCacheFile::record_header_t
+{
+    LLUUID mID;
+    U32 mType;
+    // payload bytes, not counting the padding after them
+    U32 mSize;
+};
+
+LLRecordCacheFile::LLRecordCacheFile(U32 magic, U32 format_version, size_t max_bytes) :
+    mMagic(magic),
+    mFormatVersion(format_version),
+    mMaxBytes(max_bytes),
+    mDamaged(false)
+{
+}
+
+LLRecordCacheFile::~LLRecordCacheFile()
+{
+    mFile.close();
+}
+
+void LLRecordCacheFile::open(const std::string& filename)
+{
+    LLMutexLock lock(&mMutex);
+
+    mFile.close();
+    mEntries.clear();
+    mDamaged = false;
+    mFilename = filename;
+    if (mFile.open(filename, 0, true))
+    {
+        indexFile();
+    }
+}
+
+bool LLRecordCacheFile::isOpen()
+{
+    LLMutexLock lock(&mMutex);
+    return !mFilename.empty();
+}
+
+void LLRecordCacheFile::indexFile()
+{
+    const U8* data = mFile.getData();
+    const U8* end = data + mFile.getSize();
+
+    file_header_t header;
+    if (mFile.getSize() >= sizeof(file_header_t))
+    {
+        memcpy(&header, data, sizeof(header));
+    }
+    if (mFile.getSize() < sizeof(file_header_t)
+        || header.mMagic != mMagic
+        || header.mFormatVersion != mFormatVersion)
+    {
+        LL_INFOS() << "Discarding outdated cache file " << mFilename << LL_ENDL;
+        mFile.close();
+        LLFile::remove(mFilename, ENOENT);
+        return;
+    }
+
+    data += sizeof(file_header_t);
+    while ((size_t)(end - data) >= sizeof(record_header_t))
+    {
+        record_header_t record;
+        memcpy(&record, data, sizeof(record));
+        const U8* payload = data + sizeof(record_header_t);
+        if ((size_t)(end - payload) < record.mSize)
+        {
+            // cut short
+            break;
+        }
+
+        entry_t& entry = mEntries[key_t{ record.mID, record.mType }];
+        entry.mData = payload;
+        entry.mSize = record.mSize;
+
+        if ((size_t)(end - payload) < align_size(record.mSize))
+        {
+            break;
+        }
+        data = payload + align_size(record.mSize);
+    }
+
+    if (data != end)
+    {
+        // appending after the partial record would leave the new ones
+        // unreachable, close() rewrites the file without it
+        LL_INFOS() << "Cache file " << mFilename << " was cut short" << LL_ENDL;
+        mDamaged = true;
+    }
+
+    LL_DEBUGS() << mFilename << " holds " << mEntries.size() << " records" << LL_ENDL;
+}
+
+void LLRecordCacheFile::close()
+{
+    LLMutexLock lock(&mMutex);
+
+    if (mFilename.empty())
+    {
+        return;
+    }
+
+    std::vector<U8> records;
+    size_t new_bytes = 0;
+    for (const auto& pair : mEntries)
+    {
+        if (!pair.second.mData)
+        {
+            new_bytes += sizeof(record_header_t) + align_size((U32)pair.second.mNewData.size());
+        }
+    }
+
+    bool over_limit = !mFile.isMapped() || mFile.getSize() + new_bytes > mMaxBytes;
+    // damaged records are only left out by a rewrite, which then need not
+    // lose the records unused this session
+    bool rewrite = over_limit || mDamaged;
+    for (const auto& pair : mEntries)
+    {
+        const entry_t& entry = pair.second;
+        if (!entry.mData)
+        {
+            packRecord(records, pair.first, entry.mNewData.data(), (U32)entry.mNewData.size());
+        }
+        else if (rewrite && (entry.mUsed || !over_limit))
+        {
+            // copy it out before the file goes away
+            packRecord(records, pair.first, entry.mData, entry.mSize);
+        }
+    }
+
+    mEntries.clear();
+    mDamaged = false;
+    mFile.close();
+    if (!records.empty())
+    {
+        writeFile(records, !rewrite);
+    }
+    else if (rewrite)
+    {
+        LLFile::remove(mFilename, ENOENT);
+    }
+    mFilename.clear();
+}
+
+bool LLRecordCacheFile::writeFile(const std::vector<U8>& records, bool append)
+{
+    if (append)
+    {
+        LLFILE* file = LLFile::fopen(mFilename, "ab");
+        if (!file)
+        {
+            LL_WARNS() << "Unable to open " << mFilename << LL_ENDL;
+            return false;
+        }
+        bool success = fwrite(records.data(), 1, records.size(), file) == records.size();
+        success = (LLFile::close(file) == 0) && success;
+        if (!success)
+        {
+            LL_WARNS() << "Unable to append to cache file " << mFilename << LL_ENDL;
+        }
+        return success;
+    }
+
+    std::string temp_filename = mFilename + ".tmp";
+    LLFILE* file = LLFile::fopen(temp_filename, "wb");
+    if (!file)
+    {
+        LL_WARNS() << "Unable to open " << temp_filename << LL_ENDL;
+        return false;
+    }
+
+    file_header_t header;
+    header.mMagic = mMagic;
+    header.mFormatVersion = mFormatVersion;
+    bool success = fwrite(&header, 1, sizeof(header), file) == sizeof(header)
+        && fwrite(records.data(), 1, records.size(), file) == records.size();
+    success = (LLFile::close(file) == 0) && success;
+    if (success)
+    {
+        LLFile::remove(mFilename, ENOENT);
+        success = (LLFile::rename(temp_filename, mFilename) == 0);
+    }
+    if (!success)
+    {
+        LL_WARNS() << "Unable to write cache file " << mFilename << LL_ENDL;
+        LLFile::remove(temp_filename, ENOENT);
+    }
+    return success;
+}
+
+//static
+void LLRecordCacheFile::packRecord(std::vector<U8>& buffer, const key_t& key, const U8* payload, U32 size)
+{
+    record_header_t record;
+    record.mID = key.mID;
+    record.mType = key.mType;
+    record.mSize = size;
+    const U8* header = reinterpret_cast<const U8*>(&record);
+    buffer.insert(buffer.end(), header, header + sizeof(record));
+    buffer.insert(buffer.end(), payload, payload + size);
+    buffer.resize(buffer.size() + align_size(size) - size, 0);
+}
+
+bool LLRecordCacheFile::read(const LLUUID& id, U32 type, const reader_t& reader)
+{
+    LLMutexLock lock(&mMutex);
+
+    entry_map_t::iterator it = mEntries.find(key_t{ id, type });
+    if (it == mEntries.end())
+    {
+        return false;
+    }
+
+    entry_t& entry = it->second;
+    bool success = entry.mData ? reader(entry.mData, entry.mSize)
+                               : reader(entry.mNewData.data(), (U32)entry.mNewData.size());
+    if (!success)
+    {
+        LL_WARNS() << "Dropping damaged record for " << id << " from " << mFilename << LL_ENDL;
+        mDamaged = mDamaged || entry.mData != NULL;
+        mEntries.erase(it);
+        return false;
+    }
+    entry.mUsed = true;
+    return true;
+}
+
+bool LLRecordCacheFile::has(const LLUUID& id, U32 type)
+{
+    LLMutexLock lock(&mMutex);
+    return mEntries.find(key_t{ id, type }) != mEntries.end();
+}
+
+void LLRecordCacheFile::write(const LLUUID& id, U32 type, std::vector<U8>& payload)
+{
+    LLMutexLock lock(&mMutex);
+
+    if (mFilename.empty())
+    {
+        return;
+    }
+    entry_t& entry = mEntries[key_t{ id, type }];
+    if (entry.mData || !entry.mNewData.empty())
+    {
+        entry.mUsed = true;
+        return;
+    }
+    entry.mNewData.swap(payload);
+    entry.mUsed = true;
+}
+
+size_t LLRecordCacheFile::getRecordCount()
+{
+    LLMutexLock lock(&mMutex);
+    return mEntries.size();
+}
@@ -0,0 +1,165 @@
+/**
+ * @file llrecordcachefile.h
+ * @brief Memory mapped file of binary records keyed by asset ID.
+ *
+ * @Description:
+ * Caches of data decoded out of assets (mesh headers, skin info,
+ * animations) need the same thing: a blob per asset ID that survives
+ * the session and can be read back without parsing anything.
+ * 1/ The file is a small header (magic, format version) followed by
+ *    records, each a fixed size header (ID, record type, payload size)
+ *    and the payload, padded to 4 bytes.
+ * 2/ open() maps the file read only and indexes the record headers.
+ *    Reads hand out pointers into the mapping so loading a record is
+ *    whatever its reader copies out.
+ * 3/ Records written during the session are kept in memory and appended
+ *    by close(). A file cut short by a crash keeps its complete records,
+ *    and close() rewrites it without the partial one.
+ * 4/ When the file would grow past its size limit, close() rewrites it
+ *    with only the records read or written this session.
+ * 5/ A record its reader rejects is dropped, and close() rewrites the
+ *    file without it, keeping all the others if under the limit.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLRECORDCACHEFILE_H
+#define LL_LLRECORDCACHEFILE_H
+
+#include "llmappedfile.h"
+#include "llmutex.h"
+#include "lluuid.h"
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * All methods are thread safe.
+ */
+class LLRecordCacheFile
+{
+public:
+    /**
+     * Called with the payload of a record. Returns false if the payload
+     * is damaged, which drops the record.
+     */
+    typedef std::function<bool(const U8* data, U32 size)> reader_t;
+
+    /**
+     * magic and format_version must match for an existing file to be
+     * used. Bump the version whenever a payload layout changes.
+     */
+    LLRecordCacheFile(U32 magic, U32 format_version, size_t max_bytes);
+    ~LLRecordCacheFile();
+
+    /**
+     * Map and index the file. A missing, damaged or outdated file is
+     * discarded and the cache starts out empty.
+     */
+    void open(const std::string& filename);
+
+    /**
+     * Write out the records added since open() and unmap the file. Reads
+     * and writes are ignored until the next open().
+     */
+    void close();
+
+    bool isOpen();
+
+    /**
+     * Pass the payload of a record to reader. Returns false if there is
+     * no such record or reader rejected it, in which case the record is
+     * gone, from the file as well once it is closed.
+     */
+    bool read(const LLUUID& id, U32 type, const reader_t& reader);
+
+    bool has(const LLUUID& id, U32 type);
+
+    /**
+     * Store a record, taking over the payload. Does nothing if the record
+     * is already stored: the records of an asset never change.
+     */
+    void write(const LLUUID& id, U32 type, std::vector<U8>& payload);
+
+    /**
+     * Number of records, mapped and new
+     */
+    size_t getRecordCount();
+
+private:
+    struct file_header_t;
+    struct record_header_t;
+
+    struct key_t
+    {
+        LLUUID mID;
+        U32 mType;
+
+        bool operator==(const key_t& other) const
+        {
+            return mID == other.mID && mType == other.mType;
+        }
+    };
+
+    struct key_hash_t
+    {
+        size_t operator()(const key_t& key) const
+        {
+            size_t seed = boost::hash<LLUUID>()(key.mID);
+            boost::hash_combine(seed, key.mType);
+            return seed;
+        }
+    };
+
+    struct entry_t
+    {
+        // payload inside the mapped file, or NULL for a new record
+        const U8* mData = nullptr;
+        U32 mSize = 0;
+        // payload of a record added this session
+        std::vector<U8> mNewData;
+        bool mUsed = false;
+    };
+    typedef std::unordered_map<key_t, entry_t, key_hash_t> entry_map_t;
+
+    void indexFile();
+
+    static void packRecord(std::vector<U8>& buffer, const key_t& key, const U8* payload, U32 size);
+
+    bool writeFile(const std::vector<U8>& records, bool append);
+
+private:
+    const U32 mMagic;
+    const U32 mFormatVersion;
+    const size_t mMaxBytes;
+
+    LLMutex mMutex;
+    std::string mFilename;
+    LLMappedFile mFile;
+    entry_map_t mEntries;
+    // a mapped record was rejected, or the file ends in a partial one: it
+    // must be rewritten without it
+    bool mDamaged;
+};
+
+#endif // LL_LLRECORDCACHEFILE_H
@@ -0,0 +1,184 @@
+/**
+ * @file llpackedassetstore_test.cpp
+ * @brief LLPackedAssetStore test cases.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../llpackedassetstore.h"
+
+#include "llfile.h"
+#include "../test/lltut.h"
+
+#include <vector>
+
+namespace tut
+{
+    // Small enough that a few maximum sized assets go over budget
+    const uintmax_t TEST_STORE_SIZE = 150 * 1024;
+
+    struct LLPackedAssetStoreFixture
+    {
+        LLPackedAssetStoreFixture()
+        {
+            // An LLParamSingleton can only be initialized once per process so
+            // all the tests share one store, each using its own asset IDs
+            if (!LLPackedAssetStore::instanceExists())
+            {
+                std::string dir = std::string(LLFile::tmpdir()) + "llpackedassetstore_test";
+                LLPackedAssetStore::initParamSingleton(dir, TEST_STORE_SIZE);
+                LLPackedAssetStore::getInstance()->clear();
+            }
+        }
+
+        LLPackedAssetStore* store() { return LLPackedAssetStore::getInstance(); }
+
+        std::vector<U8> makeData(S32 size, U8 seed)
+        {
+            std::vector<U8> data(size);
+            for (S32 i = 0; i < size; ++i)
+            {
+                data[i] = (U8)(seed + i);
+            }
+            return data;
+        }
+
+        std::vector<U8> readAll(const LLUUID& id)
+        {
+            S32 size = store()->getSize(id);
+            std::vector<U8> data(llmax(size, 0));
+            if (size > 0)
+            {
+                store()->read(id, 0, data.data(), size);
+            }
+            return data;
+        }
+    };
+    typedef test_group<LLPackedAssetStoreFixture> LLPackedAssetStore_factory;
+    typedef LLPackedAssetStore_factory::object LLPackedAssetStore_t;
+    LLPackedAssetStore_factory tf("LLPackedAssetStore");
+
+    template<> template<>
+    void LLPackedAssetStore_t::test<1>()
+    {
+        set_test_name("write and read back");
+        LLUUID id;
+        id.generate();
+        ensure_equals("missing asset", store()->getSize(id), -1);
+
+        std::vector<U8> data = makeData(1000, 1);
+        ensure("write", store()->write(id, LLAssetType::AT_SOUND, data.data(), (S32)data.size()));
+        ensure_equals("size", store()->getSize(id), 1000);
+        ensure("contents", readAll(id) == data);
+
+        // partial read from an offset, clamped at the end of the asset
+        U8 buffer[100];
+        ensure_equals("tail read", store()->read(id, 950, buffer, 100), 50);
+        ensure_equals("tail byte", buffer[49], data[999]);
+        ensure_equals("read past end", store()->read(id, 1000, buffer, 100), 0);
+
+        // writing again replaces the asset
+        std::vector<U8> other = makeData(10, 7);
+        ensure("rewrite", store()->write(id, LLAssetType::AT_SOUND, other.data(), (S32)other.size()));
+        ensure("rewritten contents", readAll(id) == other);
+    }
+
+    template<> template<>
+    void LLPackedAssetStore_t::test<2>()
+    {
+        set_test_name("append");
+        LLUUID id;
+        id.generate();
+        std::vector<U8> first = makeData(100, 3);
+        std::vector<U8> second = makeData(200, 5);
+        ensure("first append", store()->append(id, LLAssetType::AT_NOTECARD, first.data(), (S32)first.size()));
+        ensure("second append", store()->append(id, LLAssetType::AT_NOTECARD, second.data(), (S32)second.size()));
+
+        std::vector<U8> expected(first);
+        expected.insert(expected.end(), second.begin(), second.end());
+        ensure("appended contents", readAll(id) == expected);
+
+        // too big to stay packed - the store is left unchanged
+        std::vector<U8> big = makeData(LLPackedAssetStore::MAX_PACKED_ASSET_SIZE, 9);
+        ensure("oversized append", !store()->append(id, LLAssetType::AT_NOTECARD, big.data(), (S32)big.size()));
+        ensure("unchanged contents", readAll(id) == expected);
+        ensure("oversized write", !store()->write(id, LLAssetType::AT_NOTECARD, big.data(), (S32)big.size() + 1));
+    }
+
+    template<> template<>
+    void LLPackedAssetStore_t::test<3>()
+    {
+        set_test_name("remove and rename");
+        LLUUID old_id;
+        old_id.generate();
+        LLUUID new_id;
+        new_id.generate();
+        std::vector<U8> data = makeData(500, 11);
+        ensure("write", store()->write(old_id, LLAssetType::AT_ANIMATION, data.data(), (S32)data.size()));
+
+        ensure("rename", store()->rename(old_id, new_id, LLAssetType::AT_ANIMATION));
+        ensure_equals("old gone", store()->getSize(old_id), -1);
+        ensure("renamed contents", readAll(new_id) == data);
+        ensure("rename missing", !store()->rename(old_id, new_id, LLAssetType::AT_ANIMATION));
+
+        ensure("remove", store()->remove(new_id));
+        ensure_equals("removed", store()->getSize(new_id), -1);
+        ensure("remove missing", !store()->remove(new_id));
+
+        // empty assets are assets too
+        ensure("empty write", store()->write(old_id, LLAssetType::AT_ANIMATION, data.data(), 0));
+        ensure_equals("empty size", store()->getSize(old_id), 0);
+        ensure("empty rename", store()->rename(old_id, new_id, LLAssetType::AT_ANIMATION));
+        ensure_equals("empty renamed", store()->getSize(new_id), 0);
+    }
+
+    template<> template<>
+    void LLPackedAssetStore_t::test<4>()
+    {
+        set_test_name("compaction evicts least recently used");
+        store()->clear();
+
+        const S32 size = LLPackedAssetStore::MAX_PACKED_ASSET_SIZE;
+        std::vector<LLUUID> ids(4);
+        for (size_t i = 0; i < ids.size(); ++i)
+        {
+            ids[i].generate();
+            std::vector<U8> data = makeData(size, (U8)i);
+            ensure("write", store()->write(ids[i], LLAssetType::AT_GESTURE, data.data(), size));
+        }
+        // superseded records are garbage that compaction reclaims
+        std::vector<U8> data = makeData(size, 0);
+        ensure("rewrite", store()->write(ids[0], LLAssetType::AT_GESTURE, data.data(), size));
+
+        // ids[1] is now the most recently used
+        U8 byte;
+        ensure_equals("touch", store()->read(ids[1], 0, &byte, 1), 1);
+
+        store()->compact();
+        ensure("within budget", store()->getSizeBytes() <= TEST_STORE_SIZE);
+        ensure_equals("recently used kept", store()->getSize(ids[1]), size);
+        ensure("recently used intact", readAll(ids[1]) == makeData(size, 1));
+        ensure_equals("oldest evicted", store()->getSize(ids[2]), -1);
+        ensure_equals("rewritten kept, the budget allows it", store()->getSize(ids[0]), size);
+    }
+}
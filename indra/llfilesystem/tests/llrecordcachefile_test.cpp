@@ -0,0 +1,264 @@
+/**
+ * @file llrecordcachefile_test.cpp
+ * @brief LLRecordCacheFile test cases.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../llrecordcachefile.h"
+
+#include "llfile.h"
+#include "../test/lltut.h"
+
+#include <vector>
+
+namespace tut
+{
+    const U32 TEST_MAGIC = 0x54534554;
+    const U32 TEST_VERSION = 3;
+
+    struct LLRecordCacheFileFixture
+    {
+        std::string mFilename;
+
+        LLRecordCacheFileFixture()
+        {
+            mFilename = std::string(LLFile::tmpdir()) + "llrecordcachefile_test.bin";
+            LLFile::remove(mFilename, ENOENT);
+        }
+
+        ~LLRecordCacheFileFixture()
+        {
+            LLFile::remove(mFilename, ENOENT);
+        }
+
+        std::vector<U8> makeData(U32 size, U8 seed)
+        {
+            std::vector<U8> data(size);
+            for (U32 i = 0; i < size; ++i)
+            {
+                data[i] = (U8)(seed + i);
+            }
+            return data;
+        }
+
+        // Read a record into a vector, empty if it is missing
+        std::vector<U8> readAll(LLRecordCacheFile& file, const LLUUID& id, U32 type)
+        {
+            std::vector<U8> data;
+            file.read(id, type, [&data](const U8* payload, U32 size)
+                {
+                    data.assign(payload, payload + size);
+                    return true;
+                });
+            return data;
+        }
+    };
+    typedef test_group<LLRecordCacheFileFixture> LLRecordCacheFile_factory;
+    typedef LLRecordCacheFile_factory::object LLRecordCacheFile_t;
+    LLRecordCacheFile_factory tf("LLRecordCacheFile");
+
+    template<> template<>
+    void LLRecordCacheFile_t::test<1>()
+    {
+        set_test_name("records survive close and open");
+        LLUUID id;
+        id.generate();
+        std::vector<U8> first = makeData(13, 1);
+        std::vector<U8> second = makeData(400, 2);
+        {
+            LLRecordCacheFile file(TEST_MAGIC, TEST_VERSION, 1024 * 1024);
+            file.open(mFilename);
+            std::vector<U8> payload(first);
+            file.write(id, 1, payload);
+            payload = second;
+            file.write(id, 2, payload);
+            ensure("new record readable", readAll(file, id, 1) == first);
+            // records of an asset never change: the first write sticks
+            payload = makeData(5, 9);
+            file.write(id, 1, payload);
+            ensure("record replaced", readAll(file, id, 1) == first);
+            file.close();
+            ensure("readable after close", !file.has(id, 1));
+        }
+
+        LLRecordCacheFile file(TEST_MAGIC, TEST_VERSION, 1024 * 1024);
+        file.open(mFilename);
+        ensure_equals("record count", file.getRecordCount(), 2);
+        ensure("first record", readAll(file, id, 1) == first);
+        ensure("second record", readAll(file, id, 2) == second);
+        ensure("missing type", !file.has(id, 3));
+
+        // a reader rejecting a record drops it
+        ensure("rejected", !file.read(id, 2, [](const U8*, U32) { return false; }));
+        ensure("dropped", !file.has(id, 2));
+        file.close();
+    }
+
+    template<> template<>
+    void LLRecordCacheFile_t::test<2>()
+    {
+        set_test_name("outdated and truncated files");
+        LLUUID id;
+        id.generate();
+        LLUUID other_id;
+        other_id.generate();
+        {
+            LLRecordCacheFile file(TEST_MAGIC, TEST_VERSION, 1024 * 1024);
+            file.open(mFilename);
+            std::vector<U8> payload = makeData(100, 3);
+            file.write(id, 1, payload);
+            payload = makeData(100, 4);
+            file.write(other_id, 1, payload);
+            file.close();
+        }
+
+        // cut the last record short, as a crash while appending would
+        llstat file_status;
+        ensure("stat", LLFile::stat(mFilename, &file_status) == 0);
+        std::vector<U8> contents(file_status.st_size);
+        LLFILE* fp = LLFile::fopen(mFilename, "rb");
+        ensure("read back", fp && fread(contents.data(), 1, contents.size(), fp) == contents.size());
+        LLFile::close(fp);
+        fp = LLFile::fopen(mFilename, "wb");
+        fwrite(contents.data(), 1, contents.size() - 10, fp);
+        LLFile::close(fp);
+        {
+            LLRecordCacheFile file(TEST_MAGIC, TEST_VERSION, 1024 * 1024);
+            file.open(mFilename);
+            ensure_equals("complete record kept", file.getRecordCount(), 1);
+            file.close();
+        }
+
+        // another format version starts over
+        LLRecordCacheFile file(TEST_MAGIC, TEST_VERSION + 1, 1024 * 1024);
+        file.open(mFilename);
+        ensure_equals("outdated file used", file.getRecordCount(), 0);
+        file.close();
+    }
+
+    template<> template<>
+    void LLRecordCacheFile_t::test<3>()
+    {
+        set_test_name("rewrite keeps records in use");
+        const size_t max_bytes = 3000;
+        std::vector<LLUUID> ids(4);
+        {
+            LLRecordCacheFile file(TEST_MAGIC, TEST_VERSION, max_bytes);
+            file.open(mFilename);
+            for (size_t i = 0; i < ids.size(); ++i)
+            {
+                ids[i].generate();
+                std::vector<U8> payload = makeData(600, (U8)i);
+                file.write(ids[i], 1, payload);
+            }
+            file.close();
+        }
+
+        LLRecordCacheFile file(TEST_MAGIC, TEST_VERSION, max_bytes);
+        file.open(mFilename);
+        ensure_equals("all records", file.getRecordCount(), ids.size());
+        ensure("used record", readAll(file, ids[1], 1) == makeData(600, 1));
+        // pushes the file over its limit
+        LLUUID new_id;
+        new_id.generate();
+        std::vector<U8> payload = makeData(600, 7);
+        file.write(new_id, 1, payload);
+        file.close();
+
+        file.open(mFilename);
+        ensure_equals("only records in use", file.getRecordCount(), 2);
+        ensure("used record kept", readAll(file, ids[1], 1) == makeData(600, 1));
+        ensure("new record kept", readAll(file, new_id, 1) == makeData(600, 7));
+        file.close();
+    }
+
+    template<> template<>
+    void LLRecordCacheFile_t::test<4>()
+    {
+        set_test_name("rejected records leave the file");
+        std::vector<LLUUID> ids(3);
+        {
+            LLRecordCacheFile file(TEST_MAGIC, TEST_VERSION, 100000);
+            file.open(mFilename);
+            for (size_t i = 0; i < ids.size(); ++i)
+            {
+                ids[i].generate();
+                std::vector<U8> payload = makeData(100, (U8)i);
+                file.write(ids[i], 1, payload);
+            }
+            file.close();
+        }
+
+        LLRecordCacheFile file(TEST_MAGIC, TEST_VERSION, 100000);
+        file.open(mFilename);
+        ensure("rejected", !file.read(ids[0], 1, [](const U8*, U32) { return false; }));
+        ensure("dropped", !file.has(ids[0], 1));
+        file.close();
+
+        file.open(mFilename);
+        ensure_equals("others kept", file.getRecordCount(), 2);
+        ensure("rejected record gone", !file.has(ids[0], 1));
+        ensure("unused record kept", readAll(file, ids[2], 1) == makeData(100, 2));
+        file.close();
+    }
+
+    template<> template<>
+    void LLRecordCacheFile_t::test<5>()
+    {
+        set_test_name("records written after a cut short one");
+        LLUUID id;
+        id.generate();
+        {
+            LLRecordCacheFile file(TEST_MAGIC, TEST_VERSION, 1024 * 1024);
+            file.open(mFilename);
+            std::vector<U8> payload = makeData(100, 3);
+            file.write(id, 1, payload);
+            file.close();
+        }
+
+        // a partial record after the complete one
+        LLFILE* fp = LLFile::fopen(mFilename, "ab");
+        std::vector<U8> garbage = makeData(30, 5);
+        ensure("append", fp && fwrite(garbage.data(), 1, garbage.size(), fp) == garbage.size());
+        LLFile::close(fp);
+
+        LLUUID new_id;
+        new_id.generate();
+        {
+            LLRecordCacheFile file(TEST_MAGIC, TEST_VERSION, 1024 * 1024);
+            file.open(mFilename);
+            ensure_equals("complete record kept", file.getRecordCount(), 1);
+            std::vector<U8> payload = makeData(50, 6);
+            file.write(new_id, 1, payload);
+            file.close();
+        }
+
+        LLRecordCacheFile file(TEST_MAGIC, TEST_VERSION, 1024 * 1024);
+        file.open(mFilename);
+        ensure_equals("both records", file.getRecordCount(), 2);
+        ensure("old record", readAll(file, id, 1) == makeData(100, 3));
+        ensure("new record", readAll(file, new_id, 1) == makeData(50, 6));
+        file.close();
+    }
+}
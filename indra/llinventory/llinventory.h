@@ -46,6 +46,8 @@ class LLMessageSystem;
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 class LLInventoryObject : public LLRefCount
 {
+    // packs and unpacks the members directly, see llinventorycache.h
+    friend class LLInventoryCacheFile;
 public:
     typedef std::list<LLPointer<LLInventoryObject> > object_list_t;
     typedef std::list<LLConstPointer<LLInventoryObject> > const_object_list_t;
@@ -120,6 +122,7 @@ protected:
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 class LLInventoryItem : public LLInventoryObject
 {
+    friend class LLInventoryCacheFile;
 public:
     typedef std::vector<LLPointer<LLInventoryItem> > item_array_t;
 
@@ -230,6 +233,7 @@ protected:
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 class LLInventoryCategory : public LLInventoryObject
 {
+    friend class LLInventoryCacheFile;
 public:
     typedef std::vector<LLPointer<LLInventoryCategory> > cat_array_t;
 
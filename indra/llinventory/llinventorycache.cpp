@@ -0,0 +1,548 @@
+/**
+ * @file llinventorycache.cpp
+ * @brief Binary on-disk cache of inventory folders and items.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llinventorycache.h"
+
+#include "llfile.h"
+#include "llinventory.h"
+
+#include <algorithm>
+
+namespace
+{
+    // "LLIC" - the start of the file
+    const U32 CACHE_MAGIC = 0x43494c4c;
+    // Bump when the layout of the records below changes
+    const U32 CACHE_FORMAT_VERSION = 1;
+
+    // Blocks and the folder table start on 8 byte boundaries
+    const U64 CACHE_ALIGNMENT = 8;
+
+    // Don't bother rewriting the file for less than this much garbage
+    const U64 MIN_COMPACT_BYTES = 256 * 1024;
+
+    U64 align_offset(U64 offset)
+    {
+        return (offset + CACHE_ALIGNMENT - 1) & ~(CACHE_ALIGNMENT - 1);
+    }
+
+    bool seek_file(LLFILE* file, S64 offset)
+    {
+#if LL_WINDOWS
+        return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+        return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+    }
+
+    bool write_bytes(LLFILE* file, const void* data, size_t size)
+    {
+        return !size || fwrite(data, 1, size, file) == size;
+    }
+
+    // Copy a string into the pool at the end of a block and return where
+    // it went, relative to the start of the pool
+    void pool_string(std::vector<U8>& block, size_t pool_start, const std::string& str,
+                     U32& offset, U32& length)
+    {
+        offset = (U32)(block.size() - pool_start);
+        length = (U32)str.size();
+        block.insert(block.end(), str.begin(), str.end());
+    }
+}
+
+struct LLInventoryCacheFile::header_t
+{
+    U32 mMagic;
+    U32 mFormatVersion;
+    U32 mContentVersion;
+    U32 mFolderCount;
+    U64 mTableOffset;
+    // combined size of the blocks the table points at
+    U64 mLiveBytes;
+};
+
+struct LLInventoryCacheFile::folder_entry_t
+{
+    LLUUID mFolderID;
+    U64 mOffset;
+    U32 mSize;
+    U32 mItemCount;
+    S32 mVersion;
+    U32 mPad;
+};
+
+struct LLInventoryCacheFile::category_record_t
+{
+    LLUUID mID;
+    LLUUID mParentID;
+    LLUUID mOwnerID;
+    S32 mVersion;
+    S8 mType;
+    S8 mPreferredType;
+    U8 mPad[2];
+    U32 mNameOffset;
+    U32 mNameLength;
+};
+
+struct LLInventoryCacheFile::item_record_t
+{
+    LLUUID mID;
+    LLUUID mParentID;
+    LLUUID mAssetID;
+    LLUUID mCreatorID;
+    LLUUID mOwnerID;
+    LLUUID mLastOwnerID;
+    LLUUID mGroupID;
+    U32 mMaskBase;
+    U32 mMaskOwner;
+    U32 mMaskGroup;
+    U32 mMaskEveryone;
+    U32 mMaskNext;
+    U32 mFlags;
+    S32 mSalePrice;
+    S8 mType;
+    S8 mInventoryType;
+    U8 mSaleType;
+    U8 mPad;
+    S64 mCreationDate;
+    U32 mNameOffset;
+    U32 mNameLength;
+    U32 mDescOffset;
+    U32 mDescLength;
+};
+
+LLInventoryCacheFile::LLInventoryCacheFile() :
+    mTable(NULL),
+    mFolderCount(-1)
+{
+    static_assert(sizeof(header_t) == 32, "cache header layout changed");
+    static_assert(sizeof(folder_entry_t) == 40, "folder entry layout changed");
+    static_assert(sizeof(category_record_t) == 64, "category record layout changed");
+    static_assert(sizeof(item_record_t) == 168, "item record layout changed");
+}
+
+LLInventoryCacheFile::~LLInventoryCacheFile()
+{
+    close();
+}
+
+bool LLInventoryCacheFile::open(const std::string& filename, U32 content_version)
+{
+    close();
+    if (!mFile.open(filename, 0, true))
+    {
+        return false;
+    }
+
+    const U8* data = mFile.getData();
+    const U64 size = mFile.getSize();
+    header_t header;
+    if (size < sizeof(header_t))
+    {
+        LL_WARNS("Inventory") << "Inventory cache " << filename << " is truncated" << LL_ENDL;
+        close();
+        return false;
+    }
+    memcpy(&header, data, sizeof(header_t));
+    if (header.mMagic != CACHE_MAGIC
+        || header.mFormatVersion != CACHE_FORMAT_VERSION
+        || header.mContentVersion != content_version)
+    {
+        LL_INFOS("Inventory") << "Inventory cache " << filename << " is out of date" << LL_ENDL;
+        close();
+        return false;
+    }
+
+    const U64 table_size = (U64)header.mFolderCount * sizeof(folder_entry_t);
+    if (header.mFolderCount > (U32)S32_MAX
+        || header.mTableOffset % CACHE_ALIGNMENT
+        || header.mTableOffset < sizeof(header_t)
+        || header.mTableOffset > size
+        || table_size > size - header.mTableOffset)
+    {
+        LL_WARNS("Inventory") << "Inventory cache " << filename << " has a damaged folder table" << LL_ENDL;
+        close();
+        return false;
+    }
+
+    // Check every block is in bounds and can hold its records up front so
+    // the accessors only have to check the strings
+    const folder_entry_t* table = (const folder_entry_t*)(data + header.mTableOffset);
+    for (U32 i = 0; i < header.mFolderCount; ++i)
+    {
+        const folder_entry_t& entry = table[i];
+        const U64 records_size = sizeof(category_record_t) + (U64)entry.mItemCount * sizeof(item_record_t);
+        if (entry.mOffset % CACHE_ALIGNMENT
+            || entry.mOffset < sizeof(header_t)
+            || entry.mOffset > size
+            || entry.mSize > size - entry.mOffset
+            || records_size > entry.mSize
+            || entry.mItemCount > (U32)S32_MAX
+            || (i > 0 && !(table[i - 1].mFolderID < entry.mFolderID)))
+        {
+            LL_WARNS("Inventory") << "Inventory cache " << filename << " has a damaged folder entry" << LL_ENDL;
+            close();
+            return false;
+        }
+    }
+
+    mTable = table;
+    mFolderCount = (S32)header.mFolderCount;
+    return true;
+}
+
+void LLInventoryCacheFile::close()
+{
+    mFile.close();
+    mTable = NULL;
+    mFolderCount = -1;
+}
+
+S32 LLInventoryCacheFile::findFolder(const LLUUID& folder_id) const
+{
+    if (mFolderCount <= 0)
+    {
+        return -1;
+    }
+    const folder_entry_t* end = mTable + mFolderCount;
+    const folder_entry_t* it = std::lower_bound(mTable, end, folder_id,
+        [](const folder_entry_t& entry, const LLUUID& id) { return entry.mFolderID < id; });
+    if (it == end || it->mFolderID != folder_id)
+    {
+        return -1;
+    }
+    return (S32)(it - mTable);
+}
+
+const LLInventoryCacheFile::folder_entry_t* LLInventoryCacheFile::getEntry(S32 index) const
+{
+    llassert(index >= 0 && index < mFolderCount);
+    return mTable + index;
+}
+
+const U8* LLInventoryCacheFile::getBlock(S32 index) const
+{
+    return mFile.getData() + getEntry(index)->mOffset;
+}
+
+const LLUUID& LLInventoryCacheFile::getFolderID(S32 index) const
+{
+    return getEntry(index)->mFolderID;
+}
+
+S32 LLInventoryCacheFile::getFolderVersion(S32 index) const
+{
+    return getEntry(index)->mVersion;
+}
+
+S32 LLInventoryCacheFile::getItemCount(S32 index) const
+{
+    return (S32)getEntry(index)->mItemCount;
+}
+
+bool LLInventoryCacheFile::unpackFolder(S32 index, LLInventoryCategory* cat, LLUUID& owner_id, S32& version) const
+{
+    const folder_entry_t* entry = getEntry(index);
+    const U8* block = getBlock(index);
+    const size_t pool_start = sizeof(category_record_t) + entry->mItemCount * sizeof(item_record_t);
+    const size_t pool_size = entry->mSize - pool_start;
+    const U8* pool = block + pool_start;
+
+    category_record_t record;
+    memcpy(&record, block, sizeof(category_record_t));
+    if (record.mNameOffset > pool_size || record.mNameLength > pool_size - record.mNameOffset)
+    {
+        return false;
+    }
+
+    cat->mUUID = record.mID;
+    cat->mParentUUID = record.mParentID;
+    cat->mType = (LLAssetType::EType)record.mType;
+    cat->mPreferredType = (LLFolderType::EType)record.mPreferredType;
+    cat->mName.assign((const char*)pool + record.mNameOffset, record.mNameLength);
+    owner_id = record.mOwnerID;
+    version = record.mVersion;
+    return true;
+}
+
+bool LLInventoryCacheFile::unpackItem(S32 index, S32 item_index, LLInventoryItem* item) const
+{
+    const folder_entry_t* entry = getEntry(index);
+    llassert(item_index >= 0 && (U32)item_index < entry->mItemCount);
+    const U8* block = getBlock(index);
+    const size_t pool_start = sizeof(category_record_t) + entry->mItemCount * sizeof(item_record_t);
+    const size_t pool_size = entry->mSize - pool_start;
+    const U8* pool = block + pool_start;
+
+    item_record_t record;
+    memcpy(&record, block + sizeof(category_record_t) + item_index * sizeof(item_record_t),
+           sizeof(item_record_t));
+    if (record.mNameOffset > pool_size || record.mNameLength > pool_size - record.mNameOffset
+        || record.mDescOffset > pool_size || record.mDescLength > pool_size - record.mDescOffset)
+    {
+        return false;
+    }
+
+    item->mUUID = record.mID;
+    item->mParentUUID = record.mParentID;
+    item->mType = (LLAssetType::EType)record.mType;
+    item->mName.assign((const char*)pool + record.mNameOffset, record.mNameLength);
+    item->mCreationDate = (time_t)record.mCreationDate;
+    item->mAssetUUID = record.mAssetID;
+    item->mDescription.assign((const char*)pool + record.mDescOffset, record.mDescLength);
+    item->mInventoryType = (LLInventoryType::EType)record.mInventoryType;
+    item->mFlags = record.mFlags;
+    item->mSaleInfo = LLSaleInfo((LLSaleInfo::EForSale)record.mSaleType, record.mSalePrice);
+
+    // Same sequence as ll_permissions_from_sd() then fromLLSD()
+    LLPermissions& perm = item->mPermissions;
+    perm.init(record.mCreatorID, record.mOwnerID, record.mLastOwnerID, record.mGroupID);
+    perm.setMaskBase(record.mMaskBase);
+    perm.setMaskOwner(record.mMaskOwner);
+    perm.setMaskEveryone(record.mMaskEveryone);
+    perm.setMaskGroup(record.mMaskGroup);
+    perm.setMaskNext(record.mMaskNext);
+    perm.fix();
+    perm.initMasks(item->mInventoryType);
+    return true;
+}
+
+// static
+void LLInventoryCacheFile::packFolder(const folder_contents_t& folder, std::vector<U8>& block)
+{
+    const LLInventoryCategory* cat = folder.mCategory;
+    const size_t pool_start = sizeof(category_record_t) + folder.mItems.size() * sizeof(item_record_t);
+    block.clear();
+    block.resize(pool_start);
+
+    // Records are zeroed first so that identical folders always encode to
+    // identical bytes, padding included
+    category_record_t cat_record;
+    memset(&cat_record, 0, sizeof(category_record_t));
+    cat_record.mID = cat->mUUID;
+    cat_record.mParentID = cat->mParentUUID;
+    cat_record.mOwnerID = folder.mOwnerID;
+    cat_record.mVersion = folder.mVersion;
+    cat_record.mType = (S8)cat->mType;
+    cat_record.mPreferredType = (S8)cat->mPreferredType;
+    pool_string(block, pool_start, cat->mName, cat_record.mNameOffset, cat_record.mNameLength);
+    memcpy(&block[0], &cat_record, sizeof(category_record_t));
+
+    for (size_t i = 0; i < folder.mItems.size(); ++i)
+    {
+        const LLInventoryItem* item = folder.mItems[i];
+        const LLPermissions& perm = item->mPermissions;
+        item_record_t record;
+        memset(&record, 0, sizeof(item_record_t));
+        record.mID = item->mUUID;
+        record.mParentID = item->mParentUUID;
+        record.mAssetID = item->mAssetUUID;
+        record.mCreatorID = perm.getCreator();
+        record.mOwnerID = perm.getOwner();
+        record.mLastOwnerID = perm.getLastOwner();
+        record.mGroupID = perm.getGroup();
+        record.mMaskBase = perm.getMaskBase();
+        record.mMaskOwner = perm.getMaskOwner();
+        record.mMaskGroup = perm.getMaskGroup();
+        record.mMaskEveryone = perm.getMaskEveryone();
+        record.mMaskNext = perm.getMaskNextOwner();
+        record.mFlags = item->mFlags;
+        record.mSalePrice = item->mSaleInfo.getSalePrice();
+        record.mType = (S8)item->mType;
+        record.mInventoryType = (S8)item->mInventoryType;
+        record.mSaleType = (U8)item->mSaleInfo.getSaleType();
+        record.mCreationDate = (S64)item->mCreationDate;
+        pool_string(block, pool_start, item->mName, record.mNameOffset, record.mNameLength);
+        pool_string(block, pool_start, item->mDescription, record.mDescOffset, record.mDescLength);
+        memcpy(&block[sizeof(category_record_t) + i * sizeof(item_record_t)], &record, sizeof(item_record_t));
+    }
+
+    block.resize(align_offset(block.size()), 0);
+}
+
+// static
+bool LLInventoryCacheFile::save(const std::string& filename, U32 content_version,
+                                const folder_contents_vec_t& folders)
+{
+    std::vector<const folder_contents_t*> sorted;
+    sorted.reserve(folders.size());
+    for (const folder_contents_t& folder : folders)
+    {
+        if (folder.mCategory)
+        {
+            sorted.push_back(&folder);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(),
+        [](const folder_contents_t* a, const folder_contents_t* b)
+        { return a->mCategory->getUUID() < b->mCategory->getUUID(); });
+    sorted.erase(std::unique(sorted.begin(), sorted.end(),
+        [](const folder_contents_t* a, const folder_contents_t* b)
+        { return a->mCategory->getUUID() == b->mCategory->getUUID(); }),
+        sorted.end());
+
+    // Whatever the file holds now is only reused if it is current
+    LLInventoryCacheFile current;
+    const bool incremental = current.open(filename, content_version);
+    const U64 data_end = incremental ? align_offset(current.mFile.getSize()) : sizeof(header_t);
+
+    std::vector<folder_entry_t> table(sorted.size());
+    std::vector<U8> appended;
+    std::vector<U8> block;
+    U64 live_bytes = 0;
+    S32 reused = 0;
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        const folder_contents_t& folder = *sorted[i];
+        packFolder(folder, block);
+
+        folder_entry_t& entry = table[i];
+        memset(&entry, 0, sizeof(folder_entry_t));
+        entry.mFolderID = folder.mCategory->getUUID();
+        entry.mSize = (U32)block.size();
+        entry.mItemCount = (U32)folder.mItems.size();
+        entry.mVersion = folder.mVersion;
+        live_bytes += block.size();
+
+        S32 index = incremental ? current.findFolder(entry.mFolderID) : -1;
+        if (index >= 0
+            && current.getEntry(index)->mSize == entry.mSize
+            && !memcmp(current.getBlock(index), &block[0], block.size()))
+        {
+            entry.mOffset = current.getEntry(index)->mOffset;
+            ++reused;
+        }
+        else
+        {
+            entry.mOffset = data_end + appended.size();
+            appended.insert(appended.end(), block.begin(), block.end());
+        }
+    }
+
+    header_t header;
+    memset(&header, 0, sizeof(header_t));
+    header.mMagic = CACHE_MAGIC;
+    header.mFormatVersion = CACHE_FORMAT_VERSION;
+    header.mContentVersion = content_version;
+    header.mFolderCount = (U32)table.size();
+    header.mLiveBytes = live_bytes;
+
+    const U64 table_bytes = table.size() * sizeof(folder_entry_t);
+    const U64 garbage = data_end + appended.size() - sizeof(header_t) - live_bytes;
+    if (incremental && (garbage < MIN_COMPACT_BYTES || garbage < live_bytes + table_bytes))
+    {
+        current.close();
+        LL_DEBUGS("Inventory") << "Updating inventory cache: " << reused << " of " << table.size()
+                               << " folders unchanged, appending " << appended.size() << " bytes" << LL_ENDL;
+        return appendToFile(filename, header, data_end, appended, table);
+    }
+
+    if (!incremental)
+    {
+        // every block was appended right after the header already
+        return writeFile(filename, header, appended, table);
+    }
+
+    // The file is mostly stale blocks: lay out the live ones again, back
+    // to back
+    std::vector<U8> blocks;
+    blocks.reserve(live_bytes);
+    U64 offset = sizeof(header_t);
+    for (folder_entry_t& entry : table)
+    {
+        const U8* src = entry.mOffset < data_end
+            ? current.mFile.getData() + entry.mOffset
+            : &appended[entry.mOffset - data_end];
+        blocks.insert(blocks.end(), src, src + entry.mSize);
+        entry.mOffset = offset;
+        offset += entry.mSize;
+    }
+    current.close();
+    LL_DEBUGS("Inventory") << "Rewriting inventory cache: " << table.size() << " folders, "
+                           << blocks.size() << " bytes" << LL_ENDL;
+    return writeFile(filename, header, blocks, table);
+}
+
+// static
+bool LLInventoryCacheFile::writeFile(const std::string& filename, header_t& header,
+                                     const std::vector<U8>& blocks, const std::vector<folder_entry_t>& table)
+{
+    const std::string temp_filename = filename + ".tmp";
+    LLFILE* file = LLFile::fopen(temp_filename, "wb");
+    if (!file)
+    {
+        LL_WARNS("Inventory") << "Unable to create " << temp_filename << LL_ENDL;
+        return false;
+    }
+
+    header.mTableOffset = sizeof(header_t) + blocks.size();
+    bool success = write_bytes(file, &header, sizeof(header_t))
+        && write_bytes(file, blocks.data(), blocks.size())
+        && write_bytes(file, table.data(), table.size() * sizeof(folder_entry_t));
+    success = (fclose(file) == 0) && success;
+    if (success)
+    {
+        // Windows won't rename over an existing file
+        LLFile::remove(filename, ENOENT);
+        success = (LLFile::rename(temp_filename, filename) == 0);
+    }
+    if (!success)
+    {
+        LL_WARNS("Inventory") << "Unable to write inventory cache " << filename << LL_ENDL;
+        LLFile::remove(temp_filename, ENOENT);
+    }
+    return success;
+}
+
+// static
+bool LLInventoryCacheFile::appendToFile(const std::string& filename, header_t& header, U64 data_end,
+                                        const std::vector<U8>& blocks, const std::vector<folder_entry_t>& table)
+{
+    LLFILE* file = LLFile::fopen(filename, "r+b");
+    if (!file)
+    {
+        LL_WARNS("Inventory") << "Unable to open " << filename << LL_ENDL;
+        return false;
+    }
+
+    // The old header keeps pointing at the old table, which is left intact,
+    // until the new blocks and table are safely written
+    header.mTableOffset = data_end + blocks.size();
+    bool success = seek_file(file, (S64)data_end)
+        && write_bytes(file, blocks.data(), blocks.size())
+        && write_bytes(file, table.data(), table.size() * sizeof(folder_entry_t))
+        && fflush(file) == 0
+        && seek_file(file, 0)
+        && write_bytes(file, &header, sizeof(header_t));
+    success = (fclose(file) == 0) && success;
+    if (!success)
+    {
+        LL_WARNS("Inventory") << "Unable to update inventory cache " << filename << LL_ENDL;
+    }
+    return success;
+}
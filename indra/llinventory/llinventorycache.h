@@ -0,0 +1,148 @@
+/**
+ * @file llinventorycache.h
+ * @brief Binary on-disk cache of inventory folders and items.
+ *
+ * @Description:
+ * The inventory cache used to be a gzipped file of one notation LLSD map
+ * per folder or item which had to be decompressed to a temporary file and
+ * parsed in full at every login. This is a binary replacement:
+ * 1/ The file is a small header, a table of folders sorted by folder ID
+ *    and one block per folder. A block holds a fixed width record for the
+ *    folder, one fixed width record per item directly in that folder and
+ *    a pool with the names and descriptions of all of them.
+ * 2/ Reading maps the file and validates the header and folder table only.
+ *    Folders and items are unpacked on request, one folder at a time, so
+ *    a caller can skip the contents of folders it is going to refetch
+ *    anyway.
+ * 3/ Saving encodes each folder to a block and compares it with the block
+ *    the file already holds for that folder. Unchanged blocks are kept
+ *    where they are, changed ones are appended, followed by a new folder
+ *    table. The header is rewritten last so a save cut short leaves the
+ *    previous contents readable. Once the file holds more stale blocks
+ *    than live ones it is rewritten from scratch.
+ * The file is in native byte order: it is a local cache and is simply
+ * discarded if it does not validate.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLINVENTORYCACHE_H
+#define LL_LLINVENTORYCACHE_H
+
+#include "llmappedfile.h"
+#include "lluuid.h"
+
+#include <vector>
+
+class LLInventoryCategory;
+class LLInventoryItem;
+
+class LLInventoryCacheFile
+{
+public:
+    /**
+     * What gets saved for one folder. The owner and version live in the
+     * viewer side category class so they are passed alongside it.
+     */
+    struct folder_contents_t
+    {
+        const LLInventoryCategory* mCategory = nullptr;
+        LLUUID mOwnerID;
+        S32 mVersion = 0;
+        std::vector<const LLInventoryItem*> mItems;
+    };
+    typedef std::vector<folder_contents_t> folder_contents_vec_t;
+
+    LLInventoryCacheFile();
+    ~LLInventoryCacheFile();
+
+    /**
+     * Map the cache file and validate its header and folder table. Fails
+     * if the file is missing, damaged or was written with another
+     * content_version.
+     */
+    bool open(const std::string& filename, U32 content_version);
+    void close();
+    bool isOpen() const { return mFolderCount >= 0; }
+
+    S32 getFolderCount() const { return llmax(mFolderCount, 0); }
+
+    /**
+     * Index of the folder with the given ID or -1 if it is not cached
+     */
+    S32 findFolder(const LLUUID& folder_id) const;
+
+    const LLUUID& getFolderID(S32 index) const;
+    S32 getFolderVersion(S32 index) const;
+    S32 getItemCount(S32 index) const;
+
+    /**
+     * Fill in a category from the folder record at index. Returns false
+     * if the record is damaged.
+     */
+    bool unpackFolder(S32 index, LLInventoryCategory* cat, LLUUID& owner_id, S32& version) const;
+
+    /**
+     * Fill in an item from the item_index'th item record of the folder at
+     * index. Returns false if the record is damaged.
+     */
+    bool unpackItem(S32 index, S32 item_index, LLInventoryItem* item) const;
+
+    /**
+     * Write the given folders to the cache file, replacing whatever it
+     * held. Blocks of folders that did not change since the file was last
+     * written are left untouched. The file must not be open for reading.
+     */
+    static bool save(const std::string& filename, U32 content_version,
+                     const folder_contents_vec_t& folders);
+
+private:
+    struct header_t;
+    struct folder_entry_t;
+    struct category_record_t;
+    struct item_record_t;
+
+    const folder_entry_t* getEntry(S32 index) const;
+    const U8* getBlock(S32 index) const;
+
+    static void packFolder(const folder_contents_t& folder, std::vector<U8>& block);
+
+    /**
+     * Write a whole new file through a temporary one
+     */
+    static bool writeFile(const std::string& filename, header_t& header,
+                          const std::vector<U8>& blocks, const std::vector<folder_entry_t>& table);
+
+    /**
+     * Append new blocks and a new folder table at data_end then point the
+     * header at them
+     */
+    static bool appendToFile(const std::string& filename, header_t& header, U64 data_end,
+                             const std::vector<U8>& blocks, const std::vector<folder_entry_t>& table);
+
+private:
+    LLMappedFile mFile;
+    const folder_entry_t* mTable;
+    S32 mFolderCount;
+};
+
+#endif // LL_LLINVENTORYCACHE_H
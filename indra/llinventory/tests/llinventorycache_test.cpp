@@ -0,0 +1,367 @@
+/**
+ * @file llinventorycache_test.cpp
+ * @brief LLInventoryCacheFile test cases.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../llinventorycache.h"
+
+#include "llfile.h"
+#include "llinventory.h"
+#include "llsdserialize.h"
+#include "llsdutil.h"
+#include "llsys.h"
+#include "lltimer.h"
+#include "../test/lltut.h"
+
+#include <fstream>
+
+namespace tut
+{
+    const U32 TEST_CONTENT_VERSION = 2;
+
+    struct LLInventoryCacheFixture
+    {
+        typedef std::vector<LLPointer<LLInventoryCategory> > cat_vec_t;
+        typedef std::vector<std::vector<LLPointer<LLInventoryItem> > > item_vec_t;
+
+        std::string mFilename;
+        cat_vec_t mCategories;
+        item_vec_t mItems;
+
+        LLInventoryCacheFixture()
+        {
+            mFilename = std::string(LLFile::tmpdir()) + "llinventorycache_test.inv.cache";
+            LLFile::remove(mFilename, ENOENT);
+        }
+
+        ~LLInventoryCacheFixture()
+        {
+            LLFile::remove(mFilename, ENOENT);
+        }
+
+        LLPointer<LLInventoryItem> makeItem(const LLUUID& parent_id, S32 n)
+        {
+            LLUUID item_id;
+            item_id.generate();
+            LLUUID creator_id;
+            creator_id.generate();
+            LLUUID owner_id;
+            owner_id.generate();
+            LLUUID asset_id;
+            asset_id.generate();
+            LLPermissions perm;
+            perm.init(creator_id, owner_id, LLUUID::null, LLUUID::null);
+            perm.initMasks(PERM_ALL, PERM_ALL, PERM_NONE, PERM_NONE,
+                           (n % 2) ? PERM_ALL : PERM_MOVE | PERM_TRANSFER);
+            LLSaleInfo sale_info((n % 3) ? LLSaleInfo::FS_NOT : LLSaleInfo::FS_COPY, n);
+            return new LLInventoryItem(item_id, parent_id, perm, asset_id,
+                                       (n % 5) ? LLAssetType::AT_OBJECT : LLAssetType::AT_NOTECARD,
+                                       (n % 5) ? LLInventoryType::IT_OBJECT : LLInventoryType::IT_NOTECARD,
+                                       llformat("Item %d", n),
+                                       (n % 4) ? llformat("Description of item %d", n) : std::string(),
+                                       sale_info, n * 3, 1600000000 + n);
+        }
+
+        // A root folder and folder_count children each holding items_per_folder items
+        void makeInventory(S32 folder_count, S32 items_per_folder)
+        {
+            mCategories.clear();
+            mItems.clear();
+            LLUUID root_id;
+            root_id.generate();
+            S32 n = 0;
+            for (S32 i = 0; i <= folder_count; ++i)
+            {
+                LLUUID folder_id;
+                if (i == 0)
+                {
+                    folder_id = root_id;
+                }
+                else
+                {
+                    folder_id.generate();
+                }
+                mCategories.push_back(new LLInventoryCategory(folder_id, i ? root_id : LLUUID::null,
+                                                              i ? LLFolderType::FT_NONE : LLFolderType::FT_ROOT_INVENTORY,
+                                                              llformat("Folder %d", i)));
+                mItems.push_back(std::vector<LLPointer<LLInventoryItem> >());
+                for (S32 j = 0; i && j < items_per_folder; ++j)
+                {
+                    mItems.back().push_back(makeItem(folder_id, n++));
+                }
+            }
+        }
+
+        LLInventoryCacheFile::folder_contents_vec_t getContents(S32 version = 7)
+        {
+            LLInventoryCacheFile::folder_contents_vec_t folders(mCategories.size());
+            for (size_t i = 0; i < mCategories.size(); ++i)
+            {
+                folders[i].mCategory = mCategories[i];
+                folders[i].mOwnerID = mCategories[0]->getUUID();
+                folders[i].mVersion = version + (S32)i;
+                for (size_t j = 0; j < mItems[i].size(); ++j)
+                {
+                    folders[i].mItems.push_back(mItems[i][j]);
+                }
+            }
+            return folders;
+        }
+
+        // Unpack every folder of an open cache and compare with the originals
+        void checkContents(LLInventoryCacheFile& cache, S32 version = 7)
+        {
+            ensure_equals("folder count", cache.getFolderCount(), (S32)mCategories.size());
+            for (size_t i = 0; i < mCategories.size(); ++i)
+            {
+                S32 index = cache.findFolder(mCategories[i]->getUUID());
+                ensure("folder found", index >= 0);
+                ensure_equals("item count", cache.getItemCount(index), (S32)mItems[i].size());
+                ensure_equals("indexed version", cache.getFolderVersion(index), version + (S32)i);
+
+                LLPointer<LLInventoryCategory> cat = new LLInventoryCategory();
+                LLUUID owner_id;
+                S32 cat_version = 0;
+                ensure("unpack folder", cache.unpackFolder(index, cat, owner_id, cat_version));
+                ensure_equals("folder", cat->exportLLSD(), mCategories[i]->exportLLSD());
+                ensure_equals("owner", owner_id, mCategories[0]->getUUID());
+                ensure_equals("version", cat_version, version + (S32)i);
+
+                for (size_t j = 0; j < mItems[i].size(); ++j)
+                {
+                    LLPointer<LLInventoryItem> item = new LLInventoryItem();
+                    ensure("unpack item", cache.unpackItem(index, (S32)j, item));
+                    ensure_equals("item", item->asLLSD(), mItems[i][j]->asLLSD());
+                }
+            }
+        }
+
+        S64 fileSize()
+        {
+            llstat st;
+            LLFile::stat(mFilename, &st);
+            return st.st_size;
+        }
+    };
+    typedef test_group<LLInventoryCacheFixture> LLInventoryCache_factory;
+    typedef LLInventoryCache_factory::object LLInventoryCache_t;
+    LLInventoryCache_factory tf("LLInventoryCacheFile");
+
+    template<> template<>
+    void LLInventoryCache_t::test<1>()
+    {
+        set_test_name("save and load");
+        LLInventoryCacheFile cache;
+        ensure("missing file", !cache.open(mFilename, TEST_CONTENT_VERSION));
+
+        makeInventory(20, 10);
+        ensure("save", LLInventoryCacheFile::save(mFilename, TEST_CONTENT_VERSION, getContents()));
+        ensure("open", cache.open(mFilename, TEST_CONTENT_VERSION));
+        checkContents(cache);
+
+        LLUUID unknown_id;
+        unknown_id.generate();
+        ensure_equals("unknown folder", cache.findFolder(unknown_id), -1);
+        cache.close();
+
+        ensure("other content version", !cache.open(mFilename, TEST_CONTENT_VERSION + 1));
+    }
+
+    template<> template<>
+    void LLInventoryCache_t::test<2>()
+    {
+        set_test_name("incremental save");
+        makeInventory(200, 20);
+        ensure("first save", LLInventoryCacheFile::save(mFilename, TEST_CONTENT_VERSION, getContents()));
+        S64 full_size = fileSize();
+
+        // Unchanged folders are not written again, only the folder table is
+        ensure("unchanged save", LLInventoryCacheFile::save(mFilename, TEST_CONTENT_VERSION, getContents()));
+        S64 unchanged_size = fileSize();
+        ensure("only the table appended", unchanged_size - full_size < full_size / 10);
+
+        // One renamed item and one new folder
+        mItems[5][3]->rename("Renamed item");
+        LLUUID new_id;
+        new_id.generate();
+        mCategories.push_back(new LLInventoryCategory(new_id, mCategories[0]->getUUID(),
+                                                      LLFolderType::FT_NONE, "New folder"));
+        mItems.push_back(std::vector<LLPointer<LLInventoryItem> >(1, makeItem(new_id, 9999)));
+        ensure("changed save", LLInventoryCacheFile::save(mFilename, TEST_CONTENT_VERSION, getContents()));
+        ensure("two blocks appended", fileSize() - unchanged_size < full_size / 10);
+
+        LLInventoryCacheFile cache;
+        ensure("open", cache.open(mFilename, TEST_CONTENT_VERSION));
+        checkContents(cache);
+        cache.close();
+
+        // Removing most folders leaves mostly garbage so the file gets rewritten
+        mCategories.resize(10);
+        mItems.resize(10);
+        ensure("shrinking save", LLInventoryCacheFile::save(mFilename, TEST_CONTENT_VERSION, getContents(20)));
+        ensure("compacted", fileSize() < full_size / 10);
+        ensure("open compacted", cache.open(mFilename, TEST_CONTENT_VERSION));
+        checkContents(cache, 20);
+    }
+
+    template<> template<>
+    void LLInventoryCache_t::test<3>()
+    {
+        set_test_name("damaged file");
+        makeInventory(10, 10);
+        ensure("save", LLInventoryCacheFile::save(mFilename, TEST_CONTENT_VERSION, getContents()));
+        S64 size = fileSize();
+
+        std::vector<char> data(size);
+        {
+            std::ifstream in(mFilename.c_str(), std::ios::binary);
+            in.read(&data[0], size);
+        }
+        LLInventoryCacheFile cache;
+        // Cut short: the table at the end is gone
+        {
+            std::ofstream out(mFilename.c_str(), std::ios::binary | std::ios::trunc);
+            out.write(&data[0], size - 100);
+        }
+        ensure("truncated", !cache.open(mFilename, TEST_CONTENT_VERSION));
+        // Not a cache file at all
+        {
+            std::ofstream out(mFilename.c_str(), std::ios::binary | std::ios::trunc);
+            out << "<? LLSD/XML ?>\n";
+        }
+        ensure("garbage", !cache.open(mFilename, TEST_CONTENT_VERSION));
+
+        // A damaged cache is simply replaced by the next save
+        ensure("save over damaged", LLInventoryCacheFile::save(mFilename, TEST_CONTENT_VERSION, getContents()));
+        ensure("open", cache.open(mFilename, TEST_CONTENT_VERSION));
+        checkContents(cache);
+    }
+
+    template<> template<>
+    void LLInventoryCache_t::test<4>()
+    {
+        set_test_name("benchmark against the LLSD cache");
+        makeInventory(1000, 100);
+        const std::string llsd_filename = std::string(LLFile::tmpdir()) + "llinventorycache_test.inv.llsd";
+        const std::string gzip_filename = llsd_filename + ".gz";
+
+        // What LLInventoryModel::saveToFile() and cache() used to do
+        LLTimer timer;
+        {
+            llofstream out(llsd_filename.c_str());
+            LLSD cache_ver;
+            cache_ver["inv_cache_version"] = (S32)TEST_CONTENT_VERSION;
+            out << LLSDOStreamer<LLSDNotationFormatter>(cache_ver) << std::endl;
+            for (size_t i = 0; i < mCategories.size(); ++i)
+            {
+                out << LLSDOStreamer<LLSDNotationFormatter>(mCategories[i]->exportLLSD()) << std::endl;
+            }
+            for (size_t i = 0; i < mItems.size(); ++i)
+            {
+                for (size_t j = 0; j < mItems[i].size(); ++j)
+                {
+                    out << LLSDOStreamer<LLSDNotationFormatter>(mItems[i][j]->asLLSD()) << std::endl;
+                }
+            }
+        }
+        ensure("gzip", gzip_file(llsd_filename, gzip_filename));
+        LLFile::remove(llsd_filename);
+        F64 llsd_save_time = timer.getElapsedTimeF64();
+
+        // and what loadSkeleton() and loadFromFile() used to do
+        timer.reset();
+        S32 llsd_items = 0;
+        {
+            ensure("gunzip", gunzip_file(gzip_filename, llsd_filename));
+            llifstream in(llsd_filename.c_str());
+            std::string line;
+            LLPointer<LLSDParser> parser = new LLSDNotationParser();
+            while (std::getline(in, line))
+            {
+                LLSD s_item;
+                std::istringstream iss(line);
+                parser->parse(iss, s_item, line.length());
+                if (s_item.has("cat_id"))
+                {
+                    LLPointer<LLInventoryCategory> cat = new LLInventoryCategory();
+                    cat->importLLSD(s_item);
+                }
+                else if (s_item.has("item_id"))
+                {
+                    LLPointer<LLInventoryItem> item = new LLInventoryItem();
+                    item->fromLLSD(s_item);
+                    ++llsd_items;
+                }
+            }
+        }
+        LLFile::remove(llsd_filename);
+        F64 llsd_load_time = timer.getElapsedTimeF64();
+        llstat st;
+        LLFile::stat(gzip_filename, &st);
+        S64 llsd_size = st.st_size;
+        LLFile::remove(gzip_filename);
+
+        timer.reset();
+        ensure("save", LLInventoryCacheFile::save(mFilename, TEST_CONTENT_VERSION, getContents()));
+        F64 binary_save_time = timer.getElapsedTimeF64();
+
+        // An incremental save after a handful of changes
+        for (S32 i = 1; i <= 10; ++i)
+        {
+            mItems[i * 50][0]->rename("Renamed item");
+        }
+        timer.reset();
+        ensure("incremental save", LLInventoryCacheFile::save(mFilename, TEST_CONTENT_VERSION, getContents()));
+        F64 binary_update_time = timer.getElapsedTimeF64();
+
+        timer.reset();
+        S32 binary_items = 0;
+        {
+            LLInventoryCacheFile cache;
+            ensure("open", cache.open(mFilename, TEST_CONTENT_VERSION));
+            for (S32 i = 0; i < cache.getFolderCount(); ++i)
+            {
+                LLPointer<LLInventoryCategory> cat = new LLInventoryCategory();
+                LLUUID owner_id;
+                S32 version;
+                cache.unpackFolder(i, cat, owner_id, version);
+                for (S32 j = 0; j < cache.getItemCount(i); ++j)
+                {
+                    LLPointer<LLInventoryItem> item = new LLInventoryItem();
+                    cache.unpackItem(i, j, item);
+                    ++binary_items;
+                }
+            }
+        }
+        F64 binary_load_time = timer.getElapsedTimeF64();
+        ensure_equals("same item count", binary_items, llsd_items);
+
+        LL_INFOS() << binary_items << " items in " << mCategories.size() << " folders: "
+                   << "gzipped LLSD " << llsd_size << " bytes, saved in " << llsd_save_time
+                   << "s, loaded in " << llsd_load_time << "s; binary " << fileSize()
+                   << " bytes, saved in " << binary_save_time << "s (incremental "
+                   << binary_update_time << "s), loaded in " << binary_load_time << "s" << LL_ENDL;
+    }
+}
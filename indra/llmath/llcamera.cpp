@@ -296,6 +296,121 @@ S32 LLCamera::AABBInRegionFrustumNoFarClip(const LLVector4a& center, const LLVec
     return AABBInFrustumNoFarClip(center, radius, mRegionPlanes);
 }
 
+void LLCamera::getFrustumPlanes4(LLFrustumPlanes4& planes4, bool no_far_clip, const LLPlane* planes) const
+{
+    if(!planes)
+    {
+        //use agent space
+        planes = mAgentPlanes;
+    }
+
+    planes4.mCount = 0;
+    U32 max_planes = llmin(mPlaneCount, (U32) AGENT_PLANE_USER_CLIP_NUM);       // mAgentPlanes[] size is 7
+    for (U32 i = 0; i < max_planes; i++)
+    {
+        U8 mask = mPlaneMask[i];
+        if (mask < PLANE_MASK_NUM && (!no_far_clip || i != 5))
+        {
+            const LLPlane& p(planes[i]);
+            U32 j = planes4.mCount++;
+            for (U32 axis = 0; axis < 3; axis++)
+            {
+                planes4.mNormal[j][axis].splat(p[axis]);
+                planes4.mScaler[j][axis].splat(sFrustumScaler[mask], axis);
+            }
+            planes4.mDist[j].splat(-p[3]);
+        }
+    }
+}
+
+void LLFrustumPlanes4::AABBInFrustum(const LLVector4a* const* bounds, S32 count, S32* results, U32* crossed, U32 plane_mask) const
+{
+    llassert(count > 0 && count <= 4);
+
+    // Missing boxes repeat the first one, their lanes are ignored
+    LLQuad c[4], r[4];
+    for (S32 i = 0; i < 4; i++)
+    {
+        const LLVector4a* box = bounds[i < count ? i : 0];
+        c[i] = box[0];
+        r[i] = box[1];
+    }
+    AABBInFrustum(c, r, count, results, crossed, plane_mask);
+}
+
+void LLFrustumPlanes4::AABBInFrustum(const LLVector4a* centers, const LLVector4a* radii, S32 count, S32* results, U32* crossed, U32 plane_mask) const
+{
+    llassert(count > 0 && count <= 4);
+
+    LLQuad c[4], r[4];
+    for (S32 i = 0; i < 4; i++)
+    {
+        S32 box = i < count ? i : 0;
+        c[i] = centers[box];
+        r[i] = radii[box];
+    }
+    AABBInFrustum(c, r, count, results, crossed, plane_mask);
+}
+
+void LLFrustumPlanes4::AABBInFrustum(LLQuad* c, LLQuad* r, S32 count, S32* results, U32* crossed, U32 plane_mask) const
+{
+    // Transpose the boxes so that each vector holds one axis of all of them
+    _MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+    _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+    const LLVector4a center[3] = { LLVector4a(c[0]), LLVector4a(c[1]), LLVector4a(c[2]) };
+    const LLVector4a radius[3] = { LLVector4a(r[0]), LLVector4a(r[1]), LLVector4a(r[2]) };
+
+    // Same operations in the same order as LLCamera::AABBInFrustum(), lane
+    // by lane, so that boxes right on a plane get the same answer
+    const U32 lanes = (1 << count) - 1;
+    U32 outside = 0;
+    // lanes partly outside of each plane
+    U32 partial[LLCamera::AGENT_PLANE_USER_CLIP_NUM] = { 0 };
+    LLVector4a rscale, minp, maxp, mind, maxd;
+    for (U32 i = 0; i < mCount && (outside & lanes) != lanes; i++)
+    {
+        if (!(plane_mask & (1 << i)))
+        {
+            continue;
+        }
+
+        for (U32 axis = 0; axis < 3; axis++)
+        {
+            rscale.setMul(radius[axis], mScaler[i][axis]);
+            minp.setSub(center[axis], rscale);
+            maxp.setAdd(center[axis], rscale);
+            if (axis)
+            {
+                minp.mul(mNormal[i][axis]);
+                maxp.mul(mNormal[i][axis]);
+                mind.add(minp);
+                maxd.add(maxp);
+            }
+            else
+            {
+                mind.setMul(minp, mNormal[i][axis]);
+                maxd.setMul(maxp, mNormal[i][axis]);
+            }
+        }
+        outside |= mind.greaterThan(mDist[i]).getGatheredBits();
+        partial[i] = maxd.greaterThan(mDist[i]).getGatheredBits();
+    }
+
+    for (S32 j = 0; j < count; j++)
+    {
+        U32 lane_crossed = 0;
+        for (U32 i = 0; i < mCount; i++)
+        {
+            lane_crossed |= ((partial[i] >> j) & 1) << i;
+        }
+        results[j] = (outside & (1 << j)) ? 0 : (lane_crossed ? 1 : 2);
+        if (crossed)
+        {
+            crossed[j] = lane_crossed;
+        }
+    }
+}
+
 int LLCamera::sphereInFrustumQuick(const LLVector3 &sphere_center, const F32 radius) 
 {
     LLVector3 dist = sphere_center-mFrustCenter;
@@ -60,6 +60,8 @@ static const F32 MAX_FIELD_OF_VIEW = 175.f * DEG_TO_RAD;
 // roll(), pitch(), yaw()
 // etc...
 
+class LLFrustumPlanes4;
+
 LL_ALIGN_PREFIX(16)
 class LLCamera
 :   public LLCoordFrame
@@ -209,6 +211,10 @@ public:
     S32 AABBInFrustumNoFarClip(const LLVector4a& center, const LLVector4a& radius, const LLPlane* planes = NULL);
     S32 AABBInRegionFrustumNoFarClip(const LLVector4a& center, const LLVector4a& radius);
 
+    // Lay out the planes AABBInFrustum() (or AABBInFrustumNoFarClip()) would
+    // test against for LLFrustumPlanes4::AABBInFrustum()
+    void getFrustumPlanes4(LLFrustumPlanes4& planes4, bool no_far_clip, const LLPlane* planes = NULL) const;
+
     //does a quick 'n dirty sphere-sphere check
     S32 sphereInFrustumQuick(const LLVector3 &sphere_center, const F32 radius); 
 
@@ -230,6 +236,47 @@ protected:
     void calculateWorldFrustumPlanes();
 } LL_ALIGN_POSTFIX(16);
 
+// The frustum planes of a camera with each component splatted across a
+// vector, to test 4 boxes at once, one per SIMD lane. Filled in by
+// LLCamera::getFrustumPlanes4(), stays valid until the camera planes change
+// and may be shared by threads culling against the same camera.
+LL_ALIGN_PREFIX(16)
+class LLFrustumPlanes4
+{
+public:
+    LLFrustumPlanes4() : mCount(0) {}
+
+    enum
+    {
+        ALL_PLANES = 0xff
+    };
+
+    // Test up to 4 boxes. bounds[i] points to the center and radius of box
+    // i, results[i] receives what LLCamera::AABBInFrustum() would return for
+    // it: 0 outside, 1 partly in, 2 fully in.
+    // Only the planes in plane_mask are tested, the boxes being known to be
+    // inside the others. If crossed is not NULL, crossed[i] receives the
+    // mask of the planes box i is partly outside of: when a parent box is
+    // tested, the planes its children still have to be tested against.
+    void AABBInFrustum(const LLVector4a* const* bounds, S32 count, S32* results,
+                       U32* crossed = NULL, U32 plane_mask = ALL_PLANES) const;
+    // Same, for boxes laid out in arrays of centers and radii
+    void AABBInFrustum(const LLVector4a* centers, const LLVector4a* radii, S32 count, S32* results,
+                       U32* crossed = NULL, U32 plane_mask = ALL_PLANES) const;
+
+private:
+    friend class LLCamera;
+
+    // c and r hold the centers and radii of the boxes, one per element
+    void AABBInFrustum(LLQuad* c, LLQuad* r, S32 count, S32* results, U32* crossed, U32 plane_mask) const;
+
+    LL_ALIGN_16(LLVector4a mNormal[LLCamera::AGENT_PLANE_USER_CLIP_NUM][3]);
+    // per axis, -1 or 1 to pick the box corner nearest the plane
+    LL_ALIGN_16(LLVector4a mScaler[LLCamera::AGENT_PLANE_USER_CLIP_NUM][3]);
+    LL_ALIGN_16(LLVector4a mDist[LLCamera::AGENT_PLANE_USER_CLIP_NUM]);
+    U32 mCount;
+} LL_ALIGN_POSTFIX(16);
+
 
 #endif
 
@@ -0,0 +1,641 @@
+/**
+ * @file   llcamera_test.cpp
+ * @brief  Test for the batched frustum tests of llcamera.cpp, with a
+ *         benchmark culling a synthetic octree per region, laid out as the
+ *         viewer octree is and as breadth first arrays.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Copyright (c) 2022, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "../llcamera.h"
+// STL headers
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+// std headers
+#include <chrono>
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+#include "threadpool.h"
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // A 4x4 grid of regions, each an octree 4 levels deep, about what is
+    // in draw distance over mainland
+    const S32 BENCH_REGIONS_PER_SIDE = 4;
+    const S32 BENCH_DEPTH = 4;
+    const F32 BENCH_REGION_WIDTH = 256.f;
+    const S32 BENCH_FRAMES = 60;
+    const U32 BENCH_HELPERS = 3;
+
+    // Deterministic, so that every run culls the same boxes
+    U32 sSeed = 1;
+    F32 rand_unit()
+    {
+        sSeed = sSeed * 1664525 + 1013904223;
+        return (F32)(sSeed >> 8) / (F32)(1 << 24);
+    }
+
+    // Point the camera at target, with the frustum corners worked out the
+    // way LLViewerCamera does
+    void set_frustum(LLCamera& camera, const LLVector3& origin, const LLVector3& target)
+    {
+        camera.lookAt(origin, target);
+        const F32 tan_half = tanf(camera.getView() * 0.5f);
+        LLVector3 frust[LLCamera::AGENT_FRUSTRUM_NUM];
+        const F32 dists[] = { camera.getNear(), camera.getFar() };
+        // bottom left, bottom right, top right, top left; near then far
+        const F32 xs[] = { -1.f, 1.f, 1.f, -1.f };
+        const F32 ys[] = { -1.f, -1.f, 1.f, 1.f };
+        for (S32 i = 0; i < LLCamera::AGENT_FRUSTRUM_NUM; ++i)
+        {
+            F32 dist = dists[i / 4];
+            F32 half_height = tan_half * dist;
+            frust[i] = origin + camera.getAtAxis() * dist
+                - camera.getLeftAxis() * (xs[i % 4] * half_height * camera.getAspect())
+                + camera.getUpAxis() * (ys[i % 4] * half_height);
+        }
+        camera.calcAgentFrustumPlanes(frust);
+    }
+
+    // Octree node with the bounds of everything below it, as
+    // LLViewerOctreeGroup keeps them: center and half size
+    struct BenchNode
+    {
+        LLVector4a mBounds[2];
+        S32 mFirstChild;
+        S32 mChildCount;
+    };
+    typedef std::vector<BenchNode> bench_tree_t;
+
+    // Fills in the node at index for the cell at center with half size, and
+    // the ones below it. Leaves are shrunk at random and some cells are
+    // left empty, like a partially built region.
+    void build_node(bench_tree_t& tree, S32 index, const LLVector4a& center, F32 half, S32 depth)
+    {
+        tree[index].mFirstChild = 0;
+        tree[index].mChildCount = 0;
+        if (!depth)
+        {
+            tree[index].mBounds[0] = center;
+            tree[index].mBounds[1].set(half * (0.2f + 0.8f * rand_unit()), half * (0.2f + 0.8f * rand_unit()), half * (0.2f + 0.8f * rand_unit()));
+            return;
+        }
+
+        std::vector<LLVector4a> centers;
+        for (S32 i = 0; i < 8; ++i)
+        {
+            if (rand_unit() < 0.85f)
+            {
+                LLVector4a offset, child;
+                offset.set(i & 1 ? half * 0.5f : -half * 0.5f, i & 2 ? half * 0.5f : -half * 0.5f, i & 4 ? half * 0.5f : -half * 0.5f);
+                child.setAdd(center, offset);
+                centers.push_back(child);
+            }
+        }
+
+        // the children of a node are next to each other
+        const S32 first = (S32)tree.size();
+        const S32 count = (S32)centers.size();
+        tree.resize(first + count);
+        tree[index].mFirstChild = first;
+        tree[index].mChildCount = count;
+        for (S32 i = 0; i < count; ++i)
+        {
+            build_node(tree, first + i, centers[i], half * 0.5f, depth - 1);
+        }
+
+        // union of the children, the cell itself when there are none
+        LLVector4a min, max;
+        if (!count)
+        {
+            LLVector4a size;
+            size.splat(half);
+            min.setSub(center, size);
+            max.setAdd(center, size);
+        }
+        for (S32 i = 0; i < count; ++i)
+        {
+            const BenchNode& child = tree[first + i];
+            LLVector4a child_min, child_max;
+            child_min.setSub(child.mBounds[0], child.mBounds[1]);
+            child_max.setAdd(child.mBounds[0], child.mBounds[1]);
+            if (i)
+            {
+                min.setMin(min, child_min);
+                max.setMax(max, child_max);
+            }
+            else
+            {
+                min = child_min;
+                max = child_max;
+            }
+        }
+        tree[index].mBounds[0].setAdd(min, max);
+        tree[index].mBounds[0].mul(0.5f);
+        tree[index].mBounds[1].setSub(max, min);
+        tree[index].mBounds[1].mul(0.5f);
+    }
+
+    struct BenchWorld
+    {
+        bench_tree_t mTree;
+        std::vector<S32> mRoots;
+
+        BenchWorld()
+        {
+            sSeed = 1;
+            for (S32 x = 0; x < BENCH_REGIONS_PER_SIDE; ++x)
+            {
+                for (S32 y = 0; y < BENCH_REGIONS_PER_SIDE; ++y)
+                {
+                    LLVector4a center;
+                    center.set((x + 0.5f) * BENCH_REGION_WIDTH, (y + 0.5f) * BENCH_REGION_WIDTH, BENCH_REGION_WIDTH * 0.5f);
+                    mRoots.push_back((S32)mTree.size());
+                    mTree.resize(mTree.size() + 1);
+                    build_node(mTree, mRoots.back(), center, BENCH_REGION_WIDTH * 0.5f, BENCH_DEPTH);
+                }
+            }
+        }
+    };
+
+    // The LLViewerOctreeCull way: one box at a time, the whole subtree taken
+    // without tests once a node is fully in
+    void cull_serial(const bench_tree_t& tree, S32 index, LLCamera& camera, S32 res, std::vector<S32>& visible)
+    {
+        const BenchNode& node = tree[index];
+        if (res != 2)
+        {
+            res = camera.AABBInFrustumNoFarClip(node.mBounds[0], node.mBounds[1]);
+            if (!res)
+            {
+                return;
+            }
+        }
+        visible.push_back(index);
+        for (S32 i = 0; i < node.mChildCount; ++i)
+        {
+            cull_serial(tree, node.mFirstChild + i, camera, res, visible);
+        }
+    }
+
+    // The children of a node tested 4 at a time, against the planes the
+    // node crosses: it is fully inside the others, and so are they.
+    void cull_batched(const bench_tree_t& tree, S32 index, const LLFrustumPlanes4& planes, U32 crossed, std::vector<S32>& visible)
+    {
+        visible.push_back(index);
+        const BenchNode& node = tree[index];
+        for (S32 first = 0; first < node.mChildCount; first += 4)
+        {
+            S32 count = llmin(node.mChildCount - first, 4);
+            S32 results[4] = { 2, 2, 2, 2 };
+            U32 child_crossed[4] = { 0, 0, 0, 0 };
+            if (crossed)
+            {
+                const LLVector4a* bounds[4];
+                for (S32 i = 0; i < count; ++i)
+                {
+                    bounds[i] = tree[node.mFirstChild + first + i].mBounds;
+                }
+                planes.AABBInFrustum(bounds, count, results, child_crossed, crossed);
+            }
+            for (S32 i = 0; i < count; ++i)
+            {
+                if (results[i])
+                {
+                    cull_batched(tree, node.mFirstChild + first + i, planes, child_crossed[i], visible);
+                }
+            }
+        }
+    }
+
+    void cull_batched_root(const bench_tree_t& tree, S32 root, const LLFrustumPlanes4& planes, std::vector<S32>& visible)
+    {
+        const LLVector4a* bounds = tree[root].mBounds;
+        S32 res;
+        U32 crossed;
+        planes.AABBInFrustum(&bounds, 1, &res, &crossed);
+        if (res)
+        {
+            cull_batched(tree, root, planes, crossed, visible);
+        }
+    }
+
+    // The same octrees as LLOctreeNode and LLViewerOctreeGroup lay them out:
+    // a heap block per node, about the size of an LLSpatialGroup, with the
+    // bounds somewhere in it and the children found through pointers
+    const S32 HEAP_NODE_SIZE = 1024;
+
+    struct HeapNode
+    {
+        char mHeader[HEAP_NODE_SIZE / 2];
+        LLVector4a mBounds[2];
+        S32 mIndex;
+        std::vector<HeapNode*> mChildren;
+        char mTrailer[HEAP_NODE_SIZE / 2];
+    };
+
+    struct HeapWorld
+    {
+        std::vector<HeapNode*> mNodes;  // by index in the BenchWorld tree
+        std::vector<HeapNode*> mRoots;
+
+        HeapWorld(const BenchWorld& world)
+        {
+            // allocated in random order, as groups come and go with objects
+            const S32 count = (S32)world.mTree.size();
+            mNodes.resize(count);
+            std::vector<S32> order(count);
+            for (S32 i = 0; i < count; ++i)
+            {
+                order[i] = i;
+            }
+            sSeed = 3;
+            for (S32 i = count - 1; i > 0; --i)
+            {
+                std::swap(order[i], order[(S32)(rand_unit() * (i + 1))]);
+            }
+            for (S32 i : order)
+            {
+                mNodes[i] = new HeapNode;
+                mNodes[i]->mIndex = i;
+                mNodes[i]->mBounds[0] = world.mTree[i].mBounds[0];
+                mNodes[i]->mBounds[1] = world.mTree[i].mBounds[1];
+            }
+            for (S32 i = 0; i < count; ++i)
+            {
+                const BenchNode& node = world.mTree[i];
+                for (S32 j = 0; j < node.mChildCount; ++j)
+                {
+                    mNodes[i]->mChildren.push_back(mNodes[node.mFirstChild + j]);
+                }
+            }
+            for (S32 root : world.mRoots)
+            {
+                mRoots.push_back(mNodes[root]);
+            }
+        }
+
+        ~HeapWorld()
+        {
+            for (HeapNode* node : mNodes)
+            {
+                delete node;
+            }
+        }
+    };
+
+    void cull_heap(const HeapNode* node, LLCamera& camera, S32 res, std::vector<S32>& visible)
+    {
+        if (res != 2)
+        {
+            res = camera.AABBInFrustumNoFarClip(node->mBounds[0], node->mBounds[1]);
+            if (!res)
+            {
+                return;
+            }
+        }
+        visible.push_back(node->mIndex);
+        for (const HeapNode* child : node->mChildren)
+        {
+            cull_heap(child, camera, res, visible);
+        }
+    }
+
+    // The same octrees as LLViewerOctreeBoundsArrays lays them out: arrays
+    // of centers, radii and child indexes, each region breadth first
+    struct ArrayWorld
+    {
+        std::vector<LLVector4a> mCenters;
+        std::vector<LLVector4a> mRadii;
+        std::vector<S32> mFirstChild;
+        std::vector<S32> mChildCount;
+        std::vector<S32> mIndex;    // in the BenchWorld tree
+        std::vector<S32> mRoots;    // and one past the last region
+
+        ArrayWorld(const BenchWorld& world)
+        {
+            for (S32 root : world.mRoots)
+            {
+                mRoots.push_back((S32)mIndex.size());
+                mIndex.push_back(root);
+                for (size_t i = mRoots.back(); i < mIndex.size(); ++i)
+                {
+                    const BenchNode& node = world.mTree[mIndex[i]];
+                    mCenters.push_back(node.mBounds[0]);
+                    mRadii.push_back(node.mBounds[1]);
+                    mFirstChild.push_back((S32)mIndex.size());
+                    mChildCount.push_back(node.mChildCount);
+                    for (S32 j = 0; j < node.mChildCount; ++j)
+                    {
+                        mIndex.push_back(node.mFirstChild + j);
+                    }
+                }
+            }
+            mRoots.push_back((S32)mIndex.size());
+        }
+    };
+
+    // Region r level by level, as LLViewerOctreePrecull::run() does: res and
+    // crossed hold the result of each node, filled in by its parent, and the
+    // nodes found visible are the queue of the walk
+    void cull_arrays(const ArrayWorld& world, S32 r, const LLFrustumPlanes4& planes,
+                     std::vector<S32>& res, std::vector<U32>& crossed, std::vector<S32>& queue,
+                     std::vector<S32>& visible)
+    {
+        const S32 root = world.mRoots[r];
+        queue.clear();
+        planes.AABBInFrustum(&world.mCenters[root], &world.mRadii[root], 1, &res[root], &crossed[root]);
+        if (res[root])
+        {
+            queue.push_back(root);
+        }
+        for (size_t q = 0; q < queue.size(); ++q)
+        {
+            const S32 i = queue[q];
+            visible.push_back(world.mIndex[i]);
+            const S32 first = world.mFirstChild[i];
+            const S32 last = first + world.mChildCount[i];
+            for (S32 batch = first; batch < last; batch += 4)
+            {
+                const S32 count = llmin(last - batch, 4);
+                planes.AABBInFrustum(&world.mCenters[batch], &world.mRadii[batch], count,
+                                     &res[batch], &crossed[batch], crossed[i]);
+                for (S32 j = batch; j < batch + count; ++j)
+                {
+                    if (res[j])
+                    {
+                        queue.push_back(j);
+                    }
+                }
+            }
+        }
+    }
+
+    // Camera for frame n: turning around in the middle of the grid
+    void frame_camera(LLCamera& camera, S32 frame)
+    {
+        const F32 mid = BENCH_REGIONS_PER_SIDE * BENCH_REGION_WIDTH * 0.5f;
+        LLVector3 origin(mid, mid, 40.f);
+        F32 angle = F_TWO_PI * frame / BENCH_FRAMES;
+        set_frustum(camera, origin, origin + LLVector3(cosf(angle), sinf(angle), -0.1f));
+    }
+
+    // Milliseconds per frame of culling every region with cull(frame
+    // camera, region root, visible list of the region)
+    template <typename CULL>
+    F64 bench(const BenchWorld& world, CULL cull)
+    {
+        LLCamera camera(1.f, 1.6f, 1024, 0.1f, 512.f);
+        std::vector<std::vector<S32> > visible(world.mRoots.size());
+        Clock::time_point start = Clock::now();
+        for (S32 frame = 0; frame < BENCH_FRAMES; ++frame)
+        {
+            frame_camera(camera, frame);
+            for (auto& region : visible)
+            {
+                region.clear();
+            }
+            cull(camera, visible);
+        }
+        return std::chrono::duration<F64, std::milli>(Clock::now() - start).count() / BENCH_FRAMES;
+    }
+}
+
+namespace tut
+{
+    struct llcamera_data
+    {
+    };
+    typedef test_group<llcamera_data> llcamera_group;
+    typedef llcamera_group::object object;
+    llcamera_group llcameragrp("LLCamera");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("LLFrustumPlanes4 matches AABBInFrustum");
+        LLCamera camera(1.f, 1.6f, 1024, 0.5f, 100.f);
+        set_frustum(camera, LLVector3(10.f, 20.f, 30.f), LLVector3(60.f, 40.f, 25.f));
+
+        // the obvious cases
+        LLVector4a ahead[2], behind[2];
+        ahead[0].set(40.f, 32.f, 27.f);
+        ahead[1].set(1.f, 1.f, 1.f);
+        behind[0].set(-40.f, 0.f, 30.f);
+        behind[1].set(1.f, 1.f, 1.f);
+        ensure_equals("ahead", camera.AABBInFrustum(ahead[0], ahead[1]), 2);
+        ensure_equals("behind", camera.AABBInFrustum(behind[0], behind[1]), 0);
+
+        sSeed = 7;
+        LLPlane clip(LLVector3(30.f, 30.f, 30.f), LLVector3(0.f, 0.f, 1.f));
+        for (S32 pass = 0; pass < 2; ++pass)
+        {
+            if (pass)
+            {
+                camera.setUserClipPlane(clip);
+            }
+            LLFrustumPlanes4 planes, planes_no_far_clip;
+            camera.getFrustumPlanes4(planes, false);
+            camera.getFrustumPlanes4(planes_no_far_clip, true);
+            for (S32 i = 0; i < 2000; ++i)
+            {
+                LLVector4a boxes[4][2];
+                const LLVector4a* bounds[4];
+                for (S32 j = 0; j < 4; ++j)
+                {
+                    boxes[j][0].set(rand_unit() * 160.f - 40.f, rand_unit() * 160.f - 40.f, rand_unit() * 160.f - 40.f);
+                    boxes[j][1].set(rand_unit() * 20.f, rand_unit() * 20.f, rand_unit() * 20.f);
+                    bounds[j] = boxes[j];
+                }
+                // and boxes right on a plane, where rounding would show
+                if (i % 10 == 0)
+                {
+                    boxes[0][0].set(30.f, 30.f, 30.f + boxes[0][1][2]);
+                }
+
+                S32 count = i % 4 + 1;
+                S32 results[4];
+                planes.AABBInFrustum(bounds, count, results);
+                for (S32 j = 0; j < count; ++j)
+                {
+                    ensure_equals("far clip", results[j], camera.AABBInFrustum(boxes[j][0], boxes[j][1]));
+                }
+                planes_no_far_clip.AABBInFrustum(bounds, count, results);
+                for (S32 j = 0; j < count; ++j)
+                {
+                    ensure_equals("no far clip", results[j], camera.AABBInFrustumNoFarClip(boxes[j][0], boxes[j][1]));
+                }
+
+                LLVector4a centers[4], radii[4];
+                for (S32 j = 0; j < 4; ++j)
+                {
+                    centers[j] = boxes[j][0];
+                    radii[j] = boxes[j][1];
+                }
+                planes.AABBInFrustum(centers, radii, count, results);
+                for (S32 j = 0; j < count; ++j)
+                {
+                    ensure_equals("arrays", results[j], camera.AABBInFrustum(boxes[j][0], boxes[j][1]));
+                }
+            }
+        }
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("batched octree cull finds the same nodes");
+        BenchWorld world;
+        HeapWorld heap_world(world);
+        ArrayWorld array_world(world);
+        std::vector<S32> res(array_world.mIndex.size());
+        std::vector<U32> crossed(array_world.mIndex.size());
+        std::vector<S32> queue;
+        LLCamera camera(1.f, 1.6f, 1024, 0.1f, 512.f);
+        for (S32 frame = 0; frame < BENCH_FRAMES; frame += 7)
+        {
+            frame_camera(camera, frame);
+            LLFrustumPlanes4 planes;
+            camera.getFrustumPlanes4(planes, true);
+            std::vector<S32> serial, batched, heap, arrays;
+            for (S32 root : world.mRoots)
+            {
+                cull_serial(world.mTree, root, camera, 0, serial);
+                cull_batched_root(world.mTree, root, planes, batched);
+            }
+            for (HeapNode* root : heap_world.mRoots)
+            {
+                cull_heap(root, camera, 0, heap);
+            }
+            for (S32 r = 0; r < (S32)world.mRoots.size(); ++r)
+            {
+                cull_arrays(array_world, r, planes, res, crossed, queue, arrays);
+            }
+            ensure("something visible", !serial.empty());
+            ensure("same nodes, same order", serial == batched);
+            ensure("heap nodes", serial == heap);
+            // breadth first, in another order
+            std::sort(serial.begin(), serial.end());
+            std::sort(arrays.begin(), arrays.end());
+            ensure("breadth first nodes", serial == arrays);
+        }
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("benchmark culling a synthetic octree");
+        BenchWorld world;
+        typedef std::vector<std::vector<S32> > visible_t;
+
+        auto serial = [&world](LLCamera& camera, visible_t& visible)
+        {
+            for (size_t i = 0; i < world.mRoots.size(); ++i)
+            {
+                cull_serial(world.mTree, world.mRoots[i], camera, 0, visible[i]);
+            }
+        };
+        auto batched = [&world](LLCamera& camera, visible_t& visible)
+        {
+            LLFrustumPlanes4 planes;
+            camera.getFrustumPlanes4(planes, true);
+            for (size_t i = 0; i < world.mRoots.size(); ++i)
+            {
+                cull_batched_root(world.mTree, world.mRoots[i], planes, visible[i]);
+            }
+        };
+
+        // Regions claimed one at a time by the main thread and pool helpers,
+        // each into its own list. A helper starting after the main thread
+        // is done finds nothing left to claim.
+        struct Frame
+        {
+            Frame() : mNext(0), mDone(0) {}
+
+            void run()
+            {
+                S32 count = (S32)mWorld->mRoots.size();
+                for (S32 i = mNext++; i < count; i = mNext++)
+                {
+                    cull_batched_root(mWorld->mTree, mWorld->mRoots[i], mPlanes, (*mVisible)[i]);
+                    ++mDone;
+                }
+            }
+
+            LLFrustumPlanes4 mPlanes;
+            const BenchWorld* mWorld;
+            visible_t* mVisible;
+            std::atomic<S32> mNext;
+            std::atomic<S32> mDone;
+        };
+        LL::ThreadPool pool("llcamera_test", BENCH_HELPERS, 1024);
+        pool.start();
+        auto threaded = [&world, &pool](LLCamera& camera, visible_t& visible)
+        {
+            std::shared_ptr<Frame> frame = std::make_shared<Frame>();
+            camera.getFrustumPlanes4(frame->mPlanes, true);
+            frame->mWorld = &world;
+            frame->mVisible = &visible;
+            for (U32 i = 0; i < BENCH_HELPERS; ++i)
+            {
+                pool.getQueue().tryPost([frame]() { frame->run(); });
+            }
+            frame->run();
+            while (frame->mDone < (S32)world.mRoots.size())
+            {
+                std::this_thread::yield();
+            }
+        };
+
+        HeapWorld heap_world(world);
+        auto heap = [&heap_world](LLCamera& camera, visible_t& visible)
+        {
+            for (size_t i = 0; i < heap_world.mRoots.size(); ++i)
+            {
+                cull_heap(heap_world.mRoots[i], camera, 0, visible[i]);
+            }
+        };
+        ArrayWorld array_world(world);
+        std::vector<S32> res(array_world.mIndex.size());
+        std::vector<U32> crossed(array_world.mIndex.size());
+        std::vector<S32> queue;
+        auto arrays = [&array_world, &res, &crossed, &queue](LLCamera& camera, visible_t& visible)
+        {
+            LLFrustumPlanes4 planes;
+            camera.getFrustumPlanes4(planes, true);
+            for (S32 r = 0; r < (S32)visible.size(); ++r)
+            {
+                cull_arrays(array_world, r, planes, res, crossed, queue, visible[r]);
+            }
+        };
+
+        // Run each twice, keep the best, to smooth over scheduling noise
+        F64 serial_time = std::min(bench(world, serial), bench(world, serial));
+        F64 batched_time = std::min(bench(world, batched), bench(world, batched));
+        F64 threaded_time = std::min(bench(world, threaded), bench(world, threaded));
+        pool.close();
+        F64 heap_time = std::min(bench(world, heap), bench(world, heap));
+        F64 arrays_time = std::min(bench(world, arrays), bench(world, arrays));
+
+        LL_INFOS("LLCamera") << world.mTree.size() << " octree nodes in " << world.mRoots.size() << " regions, ms per frame: "
+                             << "one box at a time " << serial_time << ", 4 at a time " << batched_time
+                             << ", 4 at a time on " << BENCH_HELPERS + 1 << " threads " << threaded_time << LL_ENDL;
+        LL_INFOS("LLCamera") << "ms per frame: heap nodes one box at a time " << heap_time
+                             << ", breadth first arrays 4 at a time " << arrays_time << LL_ENDL;
+
+        // Timings depend on the machine, only check that the runs completed
+        ensure("no time measured", serial_time > 0.0 && batched_time > 0.0 && threaded_time > 0.0
+               && heap_time > 0.0 && arrays_time > 0.0);
+    }
+} // namespace tut
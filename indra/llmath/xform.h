@@ -138,6 +138,13 @@ public:
 
     const LLMatrix4&    getWorldMatrix() const      { return mWorldMatrix; }
     void setWorldMatrix (const LLMatrix4& mat)   { mWorldMatrix = mat; }
+    // What updateMatrix(FALSE) would set, for callers composing it themselves
+    void setWorldTransform(const LLVector3& pos, const LLQuaternion& rot, const LLMatrix4& mat)
+    {
+        mWorldPosition = pos;
+        mWorldRotation = rot;
+        mWorldMatrix = mat;
+    }
 
     void init()
     {
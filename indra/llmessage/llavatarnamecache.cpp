@@ -55,6 +55,8 @@
 const F64 TEMP_CACHE_ENTRY_LIFETIME = 60.0;
 // Maximum time an unrefreshed cache entry is allowed.
 const F64 MAX_UNREFRESHED_TIME = 20.0 * 60.0;
+// Bounds the work of one idle() call when many names expire together.
+const S32 MAX_EXPIRY_CHECKS_PER_IDLE = 200;
 
 // Send bulk lookup requests a few times a second at most.
 // Only need per-frame timing resolution.
@@ -283,7 +285,7 @@ void LLAvatarNameCache::handleAvNameCacheSuccess(const LLSD &data, const LLSD &h
 // Provide some fallback for agents that return errors
 void LLAvatarNameCache::handleAgentError(const LLUUID& agent_id)
 {
-    std::map<LLUUID,LLAvatarName>::iterator existing = mCache.find(agent_id);
+    cache_t::iterator existing = findName(agent_id);
     if (existing == mCache.end())
     {
         // <FS:Ansariel> Don't re-request names for agents with null uuid.
@@ -315,6 +317,7 @@ void LLAvatarNameCache::handleAgentError(const LLUUID& agent_id)
 
          // Reset expiry time so we don't constantly rerequest.
         av_name.setExpires(TEMP_CACHE_ENTRY_LIFETIME);
+        scheduleExpiry(agent_id, av_name.mExpires);
     }
 }
 
@@ -327,7 +330,7 @@ void LLAvatarNameCache::processName(const LLUUID& agent_id, const LLAvatarName&
 
     bool updated_account = true; // assume obsolete value for new arrivals by default
 
-    std::map<LLUUID, LLAvatarName>::iterator it = mCache.find(agent_id);
+    cache_t::iterator it = findName(agent_id);
     if (it != mCache.end()
         && (*it).second.getAccountName() == av_name.getAccountName())
     {
@@ -336,6 +339,7 @@ void LLAvatarNameCache::processName(const LLUUID& agent_id, const LLAvatarName&
 
     // Add to the cache
     mCache[agent_id] = av_name;
+    scheduleExpiry(agent_id, av_name.mExpires);
 
     // Suppress request from the queue
     mPendingQueue.erase(agent_id);
@@ -362,7 +366,7 @@ void LLAvatarNameCache::processName(const LLUUID& agent_id, const LLAvatarName&
 
 }
 
-void LLAvatarNameCache::requestNamesViaCapability()
+void LLAvatarNameCache::requestNamesViaCapability(bool send_partial)
 {
     F64 now = LLFrameTimer::getTotalSeconds();
 
@@ -372,55 +376,61 @@ void LLAvatarNameCache::requestNamesViaCapability()
     // Apache can handle URLs of 4096 chars, but let's be conservative
     static const U32 NAME_URL_MAX = 4096;
     static const U32 NAME_URL_SEND_THRESHOLD = 3500;
+    // "&ids=" and the UUID
+    static const U32 NAME_URL_ID_LENGTH = 5 + UUID_STR_LENGTH - 1;
+    // Requests started by one call, the rest wait for the next frame
+    static const S32 MAX_REQUESTS_PER_CALL = 4;
 
-    std::string url;
-    url.reserve(NAME_URL_MAX);
+    // Every request but the last is as large as the URL allows
+    const size_t base_length = mNameLookupURL.size() + NAME_URL_ID_LENGTH;
+    const size_t ids_per_request = 1 + (base_length < NAME_URL_SEND_THRESHOLD
+                                        ? (NAME_URL_SEND_THRESHOLD - base_length) / NAME_URL_ID_LENGTH : 0);
 
-    std::vector<LLUUID> agent_ids;
-    agent_ids.reserve(128);
-    
-    U32 ids = 0;
-    ask_queue_t::const_iterator it;
-    while(!mAskQueue.empty())
+    for (S32 requests = 0; requests < MAX_REQUESTS_PER_CALL && !mAskQueue.empty(); ++requests)
     {
-        it = mAskQueue.begin();
-        LLUUID agent_id = *it;
-        mAskQueue.erase(it);
-
-        if (url.empty())
+        if (!send_partial && mAskQueue.size() < ids_per_request)
         {
-            // ...starting new request
-            url += mNameLookupURL;
-            url += "?ids=";
-            ids = 1;
-        }
-        else
-        {
-            // ...continuing existing request
-            url += "&ids=";
-            ids++;
+            // more names may join this batch before the request timer expires
+            break;
         }
-        url += agent_id.asString();
-        agent_ids.push_back(agent_id);
 
-        // mark request as pending
-        mPendingQueue[agent_id] = now;
+        std::string url;
+        url.reserve(NAME_URL_MAX);
+
+        std::vector<LLUUID> agent_ids;
+        agent_ids.reserve(llmin(ids_per_request, mAskQueue.size()));
 
-        if (url.size() > NAME_URL_SEND_THRESHOLD)
+        ask_queue_t::const_iterator it;
+        while (!mAskQueue.empty() && agent_ids.size() < ids_per_request)
         {
-            break;
+            it = mAskQueue.begin();
+            LLUUID agent_id = *it;
+            mAskQueue.erase(it);
+
+            if (url.empty())
+            {
+                // ...starting new request
+                url += mNameLookupURL;
+                url += "?ids=";
+            }
+            else
+            {
+                // ...continuing existing request
+                url += "&ids=";
+            }
+            url += agent_id.asString();
+            agent_ids.push_back(agent_id);
+
+            // mark request as pending
+            mPendingQueue[agent_id] = now;
         }
-    }
 
-    if (!url.empty())
-    {
-        LL_DEBUGS("AvNameCache") << "requested " << ids << " ids" << LL_ENDL;
+        LL_DEBUGS("AvNameCache") << "requested " << agent_ids.size() << " ids" << LL_ENDL;
 
         std::string coroname = 
             LLCoros::instance().launch("LLAvatarNameCache::requestAvatarNameCache_",
             boost::bind(&LLAvatarNameCache::requestAvatarNameCache_, url, agent_ids));
         LL_DEBUGS("AvNameCache") << coroname << " with  url '" << url << "', agent_ids.size()=" << agent_ids.size() << LL_ENDL;
-
     }
 }
 
@@ -434,9 +444,14 @@ void LLAvatarNameCache::legacyNameCallback(const LLUUID& agent_id,
     // Retrieve the name and set it to never (or almost never...) expire: when we are using the legacy
     // protocol, we do not get an expiration date for each name and there's no reason to ask the 
     // data again and again so we set the expiration time to the largest value admissible.
-    std::map<LLUUID,LLAvatarName>::iterator av_record = LLAvatarNameCache::getInstance()->mCache.find(agent_id);
-    LLAvatarName& av_name = av_record->second;
-    av_name.setExpires(MAX_UNREFRESHED_TIME);
+    LLAvatarNameCache* cache = LLAvatarNameCache::getInstance();
+    cache_t::iterator av_record = cache->mCache.find(agent_id);
+    if (av_record != cache->mCache.end())
+    {
+        LLAvatarName& av_name = av_record->second;
+        av_name.setExpires(MAX_UNREFRESHED_TIME);
+        cache->scheduleExpiry(agent_id, av_name.mExpires);
+    }
 }
 
 void LLAvatarNameCache::legacyNameFetch(const LLUUID& agent_id,
@@ -500,6 +515,7 @@ bool LLAvatarNameCache::importFile(std::istream& istr)
         agent_id.set(it->first);
         av_name.fromLLSD( it->second );
         mCache[agent_id] = av_name;
+        scheduleExpiry(agent_id, av_name.mExpires);
     }
     LL_INFOS("AvNameCache") << "LLAvatarNameCache loaded " << mCache.size() << LL_ENDL;
     // Some entries may have expired since the cache was stored,
@@ -509,27 +525,57 @@ bool LLAvatarNameCache::importFile(std::istream& istr)
     return true;
 }
 
-void LLAvatarNameCache::exportFile(std::ostream& ostr)
+bool LLAvatarNameCache::loadCacheFile(const std::string& filename)
+{
+    mErasedFromFile.clear();
+    if (!mCacheFile.open(filename))
+    {
+        return false;
+    }
+    LL_INFOS("AvNameCache") << "LLAvatarNameCache mapped " << mCacheFile.getRecordCount() << " names" << LL_ENDL;
+    return true;
+}
+
+bool LLAvatarNameCache::saveCacheFile(const std::string& filename)
 {
-    LLSD agents;
     F64 max_unrefreshed = LLFrameTimer::getTotalSeconds() - MAX_UNREFRESHED_TIME;
     LL_INFOS("AvNameCache") << "LLAvatarNameCache at exit cache has " << mCache.size() << LL_ENDL;
-    cache_t::const_iterator it = mCache.begin();
-    for ( ; it != mCache.end(); ++it)
+
+    LLAvatarNameCacheFile::names_vec_t names;
+    names.reserve(mCache.size() + mCacheFile.getRecordCount());
+    for (cache_t::const_iterator it = mCache.begin(); it != mCache.end(); ++it)
     {
-        const LLUUID& agent_id = it->first;
-        const LLAvatarName& av_name = it->second;
         // Do not write temporary or expired entries to the stored cache
-        if (av_name.isValidName(max_unrefreshed))
+        if (it->second.isValidName(max_unrefreshed))
         {
-            // key must be a string
-            agents[agent_id.asString()] = av_name.asLLSD();
+            names.push_back(std::make_pair(it->first, &it->second));
         }
     }
-    LL_INFOS("AvNameCache") << "LLAvatarNameCache returning " << agents.size() << LL_ENDL;
-    LLSD data;
-    data["agents"] = agents;
-    LLSDSerialize::toPrettyXML(data, ostr);
+
+    // Names of the last session nobody asked for are kept while valid.
+    // Reserved up front, names points into it.
+    std::vector<LLAvatarName> unread_names;
+    unread_names.reserve(mCacheFile.getRecordCount());
+    for (S32 i = 0; i < mCacheFile.getRecordCount(); ++i)
+    {
+        LLUUID agent_id;
+        LLAvatarName av_name;
+        if (mCacheFile.unpack(i, agent_id, av_name)
+            && av_name.isValidName(max_unrefreshed)
+            && !mCache.count(agent_id)
+            && !mErasedFromFile.count(agent_id))
+        {
+            unread_names.push_back(av_name);
+            names.push_back(std::make_pair(agent_id, &unread_names.back()));
+        }
+    }
+    LL_INFOS("AvNameCache") << "LLAvatarNameCache returning " << names.size() << LL_ENDL;
+
+    // Cannot replace the file while it is mapped
+    mCacheFile.close();
+    bool success = LLAvatarNameCacheFile::save(filename, names);
+    loadCacheFile(filename);
+    return success;
 }
 
 void LLAvatarNameCache::setNameLookupURL(const std::string& name_lookup_url)
@@ -561,25 +607,24 @@ void LLAvatarNameCache::idle()
     // 100 ms is the threshold for "user speed" operations, so we can
     // stall for about that long to batch up requests.
     const F32 SECS_BETWEEN_REQUESTS = 0.1f;
-    if (!sRequestTimer.hasExpired())
-    {
-        return;
-    }
+    bool timer_expired = sRequestTimer.hasExpired();
 
     if (!mAskQueue.empty())
     {
         if (usePeopleAPI())
         {
-            requestNamesViaCapability();
+            // Full requests need not wait, the timer only holds back
+            // the last partial one so that more names can join it.
+            requestNamesViaCapability(timer_expired);
         }
-        else
+        else if (timer_expired)
         {
             LL_WARNS_ONCE("AvNameCache") << "LLAvatarNameCache still using legacy api" << LL_ENDL;
             requestNamesViaLegacy();
         }
     }
 
-    if (mAskQueue.empty())
+    if (timer_expired && mAskQueue.empty())
     {
         // cleared the list, reset the request timer.
         sRequestTimer.resetWithExpiry(SECS_BETWEEN_REQUESTS);
@@ -604,35 +649,66 @@ bool LLAvatarNameCache::isRequestPending(const LLUUID& agent_id)
     return isPending;
 }
 
+void LLAvatarNameCache::scheduleExpiry(const LLUUID& agent_id, F64 expires)
+{
+    // Names that never expire would only grow the queue
+    if (expires < F64_MAX)
+    {
+        mExpiryQueue.push(std::make_pair(expires, agent_id));
+    }
+}
+
 void LLAvatarNameCache::eraseUnrefreshed()
 {
     F64 now = LLFrameTimer::getTotalSeconds();
     F64 max_unrefreshed = now - MAX_UNREFRESHED_TIME;
 
-    if (!mLastExpireCheck || mLastExpireCheck < max_unrefreshed)
+    S32 expired = 0;
+    for (S32 checks = 0; checks < MAX_EXPIRY_CHECKS_PER_IDLE && !mExpiryQueue.empty(); ++checks)
     {
-        mLastExpireCheck = now;
-        S32 expired = 0;
-        for (cache_t::iterator it = mCache.begin(); it != mCache.end();)
+        if (mExpiryQueue.top().first >= max_unrefreshed)
         {
-            const LLAvatarName& av_name = it->second;
-            if (av_name.mExpires < max_unrefreshed)
-            {
-                LL_DEBUGS("AvNameCacheExpired") << "LLAvatarNameCache " << it->first 
-                                         << " user '" << av_name.getAccountName() << "' "
-                                         << "expired " << now - av_name.mExpires << " secs ago"
-                                         << LL_ENDL;
-                mCache.erase(it++);
-                expired++;
-            }
-            else
-            {
-                ++it;
-            }
+            break;
+        }
+        LLUUID agent_id = mExpiryQueue.top().second;
+        mExpiryQueue.pop();
+
+        cache_t::iterator it = mCache.find(agent_id);
+        if (it == mCache.end() || it->second.mExpires >= max_unrefreshed)
+        {
+            // erased or refreshed since
+            continue;
+        }
+        const LLAvatarName& av_name = it->second;
+        LL_DEBUGS("AvNameCacheExpired") << "LLAvatarNameCache " << it->first 
+                                 << " user '" << av_name.getAccountName() << "' "
+                                 << "expired " << now - av_name.mExpires << " secs ago"
+                                 << LL_ENDL;
+        mCache.erase(it);
+        expired++;
+    }
+    if (expired)
+    {
+        LL_DEBUGS("AvNameCache") << "LLAvatarNameCache expired " << expired << " cached avatar names, "
+                                 << mCache.size() << " remaining" << LL_ENDL;
+    }
+}
+
+LLAvatarNameCache::cache_t::iterator LLAvatarNameCache::findName(const LLUUID& agent_id)
+{
+    cache_t::iterator it = mCache.find(agent_id);
+    if (it == mCache.end() && mCacheFile.isOpen() && !mErasedFromFile.count(agent_id))
+    {
+        // Expired names are left in the file, they are dropped when it is saved
+        LLAvatarName av_name;
+        if (mCacheFile.find(agent_id, av_name)
+            && av_name.isValidName(LLFrameTimer::getTotalSeconds() - MAX_UNREFRESHED_TIME))
+        {
+            it = mCache.insert(std::make_pair(agent_id, av_name)).first;
+            scheduleExpiry(agent_id, av_name.mExpires);
         }
-        LL_INFOS("AvNameCache") << "LLAvatarNameCache expired " << expired << " cached avatar names, "
-                                << mCache.size() << " remaining" << LL_ENDL;
     }
+    return it;
 }
 
 //static, wrapper
@@ -654,7 +730,7 @@ bool LLAvatarNameCache::getName(const LLUUID& agent_id, LLAvatarName *av_name)
     if (mRunning)
     {
         // ...only do immediate lookups when cache is running
-        std::map<LLUUID,LLAvatarName>::iterator it = mCache.find(agent_id);
+        cache_t::iterator it = findName(agent_id);
         if (it != mCache.end())
         {
             *av_name = it->second;
@@ -718,7 +794,7 @@ LLAvatarNameCache::callback_connection_t LLAvatarNameCache::getNameCallback(cons
     if (mRunning)
     {
         // ...only do immediate lookups when cache is running
-        std::map<LLUUID,LLAvatarName>::iterator it = mCache.find(agent_id);
+        cache_t::iterator it = findName(agent_id);
         if (it != mCache.end())
         {
             LLAvatarName& av_name = it->second;
@@ -794,6 +870,10 @@ void LLAvatarNameCache::setUseUsernames(bool use)
 void LLAvatarNameCache::erase(const LLUUID& agent_id)
 {
     mCache.erase(agent_id);
+    if (mCacheFile.isOpen())
+    {
+        mErasedFromFile.insert(agent_id);
+    }
 }
 
 void LLAvatarNameCache::fetch(const LLUUID& agent_id) // FS:TM used in LGGContactSets
@@ -806,12 +886,13 @@ void LLAvatarNameCache::insert(const LLUUID& agent_id, const LLAvatarName& av_na
 {
     // *TODO: update timestamp if zero?
     mCache[agent_id] = av_name;
+    scheduleExpiry(agent_id, av_name.mExpires);
 }
 
 LLUUID LLAvatarNameCache::findIdByName(const std::string& name)
 {
-    std::map<LLUUID, LLAvatarName>::iterator it;
-    std::map<LLUUID, LLAvatarName>::iterator end = mCache.end();
+    cache_t::iterator it;
+    cache_t::iterator end = mCache.end();
     for (it = mCache.begin(); it != end; ++it)
     {
         if (it->second.getUserName() == name)
@@ -820,6 +901,22 @@ LLUUID LLAvatarNameCache::findIdByName(const std::string& name)
         }
     }
 
+    // Names of the last session not asked for yet
+    F64 max_unrefreshed = LLFrameTimer::getTotalSeconds() - MAX_UNREFRESHED_TIME;
+    for (S32 i = 0; i < mCacheFile.getRecordCount(); ++i)
+    {
+        LLUUID agent_id;
+        LLAvatarName av_name;
+        if (mCacheFile.unpack(i, agent_id, av_name)
+            && av_name.isValidName(max_unrefreshed)
+            && !mCache.count(agent_id)
+            && !mErasedFromFile.count(agent_id)
+            && av_name.getUserName() == name)
+        {
+            return agent_id;
+        }
+    }
+
     // Legacy method
     LLUUID id;
     if (gCacheName && gCacheName->getUUID(name, id))
@@ -29,8 +29,13 @@
 #define LLAVATARNAMECACHE_H
 
 #include "llavatarname.h"   // for convenience
+#include "llavatarnamecachefile.h"
+#include "llflathashmap.h"
 #include "llsingleton.h"
 #include <boost/signals2.hpp>
+#include <boost/unordered_map.hpp>
+#include <functional>
+#include <queue>
 #include <set>
 
 class LLSD;
@@ -52,9 +57,14 @@ public:
     }
     // </FS:Ansariel>
 
-    // Import/export the name cache to file.
+    // Import names from the old LLSD XML cache file.
     bool importFile(std::istream& istr);
-    void exportFile(std::ostream& ostr);
+
+    // Map the binary cache file. Names are read from it as they are
+    // asked for rather than all at once.
+    bool loadCacheFile(const std::string& filename);
+    // Write every valid name, read from the file or not, to a new file.
+    bool saveCacheFile(const std::string& filename);
 
     // On the viewer, usually a simulator capabilities.
     // If empty, name cache will fall back to using legacy name lookup system.
@@ -123,7 +133,9 @@ private:
     void processName(const LLUUID& agent_id,
         const LLAvatarName& av_name);
 
-    void requestNamesViaCapability();
+    // Sends every full batch of queued IDs, the last partial batch too
+    // if send_partial is set.
+    void requestNamesViaCapability(bool send_partial);
 
     // Legacy name system callbacks
     static void legacyNameCallback(const LLUUID& agent_id,
@@ -143,6 +155,14 @@ private:
     // Is a request in-flight over the network?
     bool isRequestPending(const LLUUID& agent_id);
 
+    // The cache entry of agent_id, loading it from the cache file if
+    // it has not been asked for yet. mCache.end() if unknown.
+    typedef boost::unordered_map<LLUUID, LLAvatarName> cache_t;
+    cache_t::iterator findName(const LLUUID& agent_id);
+
+    // Remember when a cache entry should be checked for expiry
+    void scheduleExpiry(const LLUUID& agent_id, F64 expires);
+
     // Erase expired names from cache
     void eraseUnrefreshed();
 
@@ -178,7 +198,7 @@ private:
 
     // Agent IDs that have been requested, but with no reply.
     // Maps agent ID to frame time request was made.
-    typedef std::map<LLUUID, F64> pending_queue_t;
+    typedef LLFlatHashMap<LLUUID, F64> pending_queue_t;
     pending_queue_t mPendingQueue;
 
     // Callbacks to fire when we received a name.
@@ -189,11 +209,18 @@ private:
     signal_map_t mSignalMap;
 
     // The cache at last, i.e. avatar names we know about.
-    typedef std::map<LLUUID, LLAvatarName> cache_t;
     cache_t mCache;
 
-    // Time when unrefreshed cached names were checked last.
-    F64 mLastExpireCheck;
+    // Names saved by the last session, not in mCache until asked for.
+    LLAvatarNameCacheFile mCacheFile;
+    // Agents erased from mCache that must not be read back from mCacheFile
+    uuid_set_t mErasedFromFile;
+
+    // Expiry times of the cache entries, soonest first. An entry whose
+    // expiry has changed since it was queued is just skipped.
+    typedef std::pair<F64, LLUUID> expiry_t;
+    typedef std::priority_queue<expiry_t, std::vector<expiry_t>, std::greater<expiry_t> > expiry_queue_t;
+    expiry_queue_t mExpiryQueue;
 
     // <FS:Ansariel> Contact sets
     custom_name_check_callback_t mCustomNameCheckCallback;
@@ -0,0 +1,333 @@
+/**
+ * @file llavatarnamecachefile.cpp
+ * @brief Binary on-disk store of the avatar name cache.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llavatarnamecachefile.h"
+
+#include "llavatarname.h"
+#include "llfile.h"
+
+namespace
+{
+    // "LLAN" - the start of the file
+    const U32 CACHE_MAGIC = 0x4e414c4c;
+    // Bump when the layout of the records below changes
+    const U32 CACHE_FORMAT_VERSION = 1;
+
+    // The records start on an 8 byte boundary
+    const U64 CACHE_ALIGNMENT = 8;
+
+    // The hash table is kept at most half full so probes stay short
+    const U32 MIN_SLOT_COUNT = 16;
+
+    U64 align_offset(U64 offset)
+    {
+        return (offset + CACHE_ALIGNMENT - 1) & ~(CACHE_ALIGNMENT - 1);
+    }
+
+    bool write_bytes(LLFILE* file, const void* data, size_t size)
+    {
+        return !size || fwrite(data, 1, size, file) == size;
+    }
+
+    void pool_string(std::vector<char>& pool, const std::string& str, U32& offset, U32& length)
+    {
+        offset = (U32)pool.size();
+        length = (U32)str.size();
+        pool.insert(pool.end(), str.begin(), str.end());
+    }
+}
+
+struct LLAvatarNameCacheFile::header_t
+{
+    U32 mMagic;
+    U32 mFormatVersion;
+    U32 mRecordCount;
+    U32 mSlotCount;
+    U64 mRecordsOffset;
+    U64 mPoolOffset;
+    U64 mPoolSize;
+};
+
+struct LLAvatarNameCacheFile::slot_t
+{
+    LLUUID mAgentID;
+    // record index + 1, 0 for an empty slot
+    U32 mRecord;
+};
+
+struct LLAvatarNameCacheFile::name_record_t
+{
+    LLUUID mAgentID;
+    F64 mExpires;
+    F64 mNextUpdate;
+    U32 mUsernameOffset;
+    U32 mUsernameLength;
+    U32 mDisplayNameOffset;
+    U32 mDisplayNameLength;
+    U32 mFirstNameOffset;
+    U32 mFirstNameLength;
+    U32 mLastNameOffset;
+    U32 mLastNameLength;
+    U8 mIsDisplayNameDefault;
+    U8 mPad[7];
+};
+
+LLAvatarNameCacheFile::LLAvatarNameCacheFile() :
+    mSlots(NULL),
+    mRecords(NULL),
+    mPool(NULL),
+    mPoolSize(0),
+    mSlotCount(0),
+    mRecordCount(-1)
+{
+    static_assert(sizeof(header_t) == 40, "cache header layout changed");
+    static_assert(sizeof(slot_t) == 20, "hash slot layout changed");
+    static_assert(sizeof(name_record_t) == 72, "name record layout changed");
+}
+
+LLAvatarNameCacheFile::~LLAvatarNameCacheFile()
+{
+    close();
+}
+
+bool LLAvatarNameCacheFile::open(const std::string& filename)
+{
+    close();
+    if (!mFile.open(filename, 0, true))
+    {
+        return false;
+    }
+
+    const U8* data = mFile.getData();
+    const U64 size = mFile.getSize();
+    header_t header;
+    if (size < sizeof(header_t))
+    {
+        LL_WARNS("AvNameCache") << "Avatar name cache " << filename << " is truncated" << LL_ENDL;
+        close();
+        return false;
+    }
+    memcpy(&header, data, sizeof(header_t));
+    if (header.mMagic != CACHE_MAGIC || header.mFormatVersion != CACHE_FORMAT_VERSION)
+    {
+        LL_INFOS("AvNameCache") << "Avatar name cache " << filename << " is out of date" << LL_ENDL;
+        close();
+        return false;
+    }
+
+    // Everything is checked against the file size here so lookups only
+    // have to check the indexes and string ranges they read
+    const U64 slots_end = sizeof(header_t) + (U64)header.mSlotCount * sizeof(slot_t);
+    const U64 records_size = (U64)header.mRecordCount * sizeof(name_record_t);
+    if (header.mRecordCount > (U32)S32_MAX
+        || header.mSlotCount < header.mRecordCount
+        || (header.mSlotCount & (header.mSlotCount - 1))
+        || header.mRecordsOffset % CACHE_ALIGNMENT
+        || header.mRecordsOffset < slots_end
+        || header.mRecordsOffset > size
+        || records_size > size - header.mRecordsOffset
+        || header.mPoolOffset < header.mRecordsOffset + records_size
+        || header.mPoolOffset > size
+        || header.mPoolSize > size - header.mPoolOffset)
+    {
+        LL_WARNS("AvNameCache") << "Avatar name cache " << filename << " is damaged" << LL_ENDL;
+        close();
+        return false;
+    }
+
+    mSlots = (const slot_t*)(data + sizeof(header_t));
+    mRecords = (const name_record_t*)(data + header.mRecordsOffset);
+    mPool = (const char*)(data + header.mPoolOffset);
+    mPoolSize = header.mPoolSize;
+    mSlotCount = header.mSlotCount;
+    mRecordCount = (S32)header.mRecordCount;
+    return true;
+}
+
+void LLAvatarNameCacheFile::close()
+{
+    mFile.close();
+    mSlots = NULL;
+    mRecords = NULL;
+    mPool = NULL;
+    mPoolSize = 0;
+    mSlotCount = 0;
+    mRecordCount = -1;
+}
+
+bool LLAvatarNameCacheFile::find(const LLUUID& agent_id, LLAvatarName& av_name) const
+{
+    if (mRecordCount <= 0)
+    {
+        return false;
+    }
+
+    const U32 mask = mSlotCount - 1;
+    U32 slot = slotFor(agent_id, mSlotCount);
+    for (U32 probes = 0; probes < mSlotCount; ++probes, slot = (slot + 1) & mask)
+    {
+        const slot_t& entry = mSlots[slot];
+        if (!entry.mRecord)
+        {
+            return false;
+        }
+        if (entry.mAgentID == agent_id)
+        {
+            U32 index = entry.mRecord - 1;
+            return index < (U32)mRecordCount
+                && mRecords[index].mAgentID == agent_id
+                && unpackRecord(index, av_name);
+        }
+    }
+    return false;
+}
+
+bool LLAvatarNameCacheFile::unpack(S32 index, LLUUID& agent_id, LLAvatarName& av_name) const
+{
+    llassert(index >= 0 && index < mRecordCount);
+    agent_id = mRecords[index].mAgentID;
+    return unpackRecord((U32)index, av_name);
+}
+
+bool LLAvatarNameCacheFile::unpackRecord(U32 index, LLAvatarName& av_name) const
+{
+    const name_record_t& record = mRecords[index];
+    const U32 offsets[] = { record.mUsernameOffset, record.mDisplayNameOffset,
+                            record.mFirstNameOffset, record.mLastNameOffset };
+    const U32 lengths[] = { record.mUsernameLength, record.mDisplayNameLength,
+                            record.mFirstNameLength, record.mLastNameLength };
+    std::string* strings[] = { &av_name.mUsername, &av_name.mDisplayName,
+                               &av_name.mLegacyFirstName, &av_name.mLegacyLastName };
+    for (S32 i = 0; i < 4; ++i)
+    {
+        if (offsets[i] > mPoolSize || lengths[i] > mPoolSize - offsets[i])
+        {
+            return false;
+        }
+        strings[i]->assign(mPool + offsets[i], lengths[i]);
+    }
+    av_name.mExpires = record.mExpires;
+    av_name.mNextUpdate = record.mNextUpdate;
+    av_name.mIsDisplayNameDefault = record.mIsDisplayNameDefault != 0;
+    av_name.mIsTemporaryName = false;
+    return true;
+}
+
+// static
+U32 LLAvatarNameCacheFile::slotFor(const LLUUID& agent_id, U32 slot_count)
+{
+    // Must not change between runs, so no std::hash here
+    U32 hash = agent_id.getCRC32() * 0x9e3779b1;
+    return (hash ^ (hash >> 16)) & (slot_count - 1);
+}
+
+// static
+bool LLAvatarNameCacheFile::save(const std::string& filename, const names_vec_t& names)
+{
+    U32 slot_count = MIN_SLOT_COUNT;
+    while (slot_count < names.size() * 2)
+    {
+        slot_count *= 2;
+    }
+
+    std::vector<slot_t> slots(slot_count);
+    memset(&slots[0], 0, slot_count * sizeof(slot_t));
+    std::vector<name_record_t> records;
+    records.reserve(names.size());
+    std::vector<char> pool;
+
+    const U32 mask = slot_count - 1;
+    for (names_vec_t::const_iterator it = names.begin(); it != names.end(); ++it)
+    {
+        const LLUUID& agent_id = it->first;
+        U32 slot = slotFor(agent_id, slot_count);
+        while (slots[slot].mRecord && slots[slot].mAgentID != agent_id)
+        {
+            slot = (slot + 1) & mask;
+        }
+        if (slots[slot].mRecord)
+        {
+            // first one wins
+            continue;
+        }
+
+        const LLAvatarName& av_name = *it->second;
+        name_record_t record;
+        memset(&record, 0, sizeof(name_record_t));
+        record.mAgentID = agent_id;
+        record.mExpires = av_name.mExpires;
+        record.mNextUpdate = av_name.mNextUpdate;
+        pool_string(pool, av_name.mUsername, record.mUsernameOffset, record.mUsernameLength);
+        pool_string(pool, av_name.mDisplayName, record.mDisplayNameOffset, record.mDisplayNameLength);
+        pool_string(pool, av_name.mLegacyFirstName, record.mFirstNameOffset, record.mFirstNameLength);
+        pool_string(pool, av_name.mLegacyLastName, record.mLastNameOffset, record.mLastNameLength);
+        record.mIsDisplayNameDefault = av_name.mIsDisplayNameDefault ? 1 : 0;
+        records.push_back(record);
+
+        slots[slot].mAgentID = agent_id;
+        slots[slot].mRecord = (U32)records.size();
+    }
+
+    header_t header;
+    memset(&header, 0, sizeof(header_t));
+    header.mMagic = CACHE_MAGIC;
+    header.mFormatVersion = CACHE_FORMAT_VERSION;
+    header.mRecordCount = (U32)records.size();
+    header.mSlotCount = slot_count;
+    const U64 slots_end = sizeof(header_t) + (U64)slot_count * sizeof(slot_t);
+    header.mRecordsOffset = align_offset(slots_end);
+    header.mPoolOffset = header.mRecordsOffset + records.size() * sizeof(name_record_t);
+    header.mPoolSize = pool.size();
+    const U8 padding[CACHE_ALIGNMENT] = { 0 };
+
+    const std::string temp_filename = filename + ".tmp";
+    LLFILE* file = LLFile::fopen(temp_filename, "wb");
+    if (!file)
+    {
+        LL_WARNS("AvNameCache") << "Unable to create " << temp_filename << LL_ENDL;
+        return false;
+    }
+
+    bool success = write_bytes(file, &header, sizeof(header_t))
+        && write_bytes(file, slots.data(), slots.size() * sizeof(slot_t))
+        && write_bytes(file, padding, header.mRecordsOffset - slots_end)
+        && write_bytes(file, records.data(), records.size() * sizeof(name_record_t))
+        && write_bytes(file, pool.data(), pool.size());
+    success = (fclose(file) == 0) && success;
+    if (success)
+    {
+        // Windows won't rename over an existing file
+        LLFile::remove(filename, ENOENT);
+        success = (LLFile::rename(temp_filename, filename) == 0);
+    }
+    if (!success)
+    {
+        LL_WARNS("AvNameCache") << "Unable to write avatar name cache " << filename << LL_ENDL;
+        LLFile::remove(temp_filename, ENOENT);
+    }
+    return success;
+}
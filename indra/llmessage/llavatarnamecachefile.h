@@ -0,0 +1,106 @@
+/**
+ * @file llavatarnamecachefile.h
+ * @brief Binary on-disk store of the avatar name cache.
+ *
+ * @Description:
+ * The avatar name cache used to be saved as one LLSD XML document which
+ * was parsed in full at startup, thousands of names before the first one
+ * was needed. This is a binary replacement:
+ * 1/ The file is a small header, an open addressing hash table of agent
+ *    IDs, one fixed width record per name and a pool with the strings.
+ * 2/ Reading maps the file and validates the header only. A lookup probes
+ *    the table in the mapping and unpacks that one record, so names are
+ *    loaded as they are asked for.
+ * 3/ Saving writes a whole new file through a temporary one.
+ * The file is in native byte order: it is a local cache and is simply
+ * discarded if it does not validate.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLAVATARNAMECACHEFILE_H
+#define LL_LLAVATARNAMECACHEFILE_H
+
+#include "llmappedfile.h"
+#include "lluuid.h"
+
+#include <utility>
+#include <vector>
+
+class LLAvatarName;
+
+class LLAvatarNameCacheFile
+{
+public:
+    typedef std::vector<std::pair<LLUUID, const LLAvatarName*> > names_vec_t;
+
+    LLAvatarNameCacheFile();
+    ~LLAvatarNameCacheFile();
+
+    /**
+     * Map the cache file and validate its header. Fails if the file is
+     * missing, damaged or was written in another format.
+     */
+    bool open(const std::string& filename);
+    void close();
+    bool isOpen() const { return mRecordCount >= 0; }
+
+    S32 getRecordCount() const { return llmax(mRecordCount, 0); }
+
+    /**
+     * Fill in av_name from the record of agent_id. Returns false if the
+     * agent is not cached or the record is damaged.
+     */
+    bool find(const LLUUID& agent_id, LLAvatarName& av_name) const;
+
+    /**
+     * Agent ID and name of the index'th record, in file order. Returns
+     * false if the record is damaged.
+     */
+    bool unpack(S32 index, LLUUID& agent_id, LLAvatarName& av_name) const;
+
+    /**
+     * Write the given names to the cache file, replacing whatever it
+     * held. The file must not be open for reading.
+     */
+    static bool save(const std::string& filename, const names_vec_t& names);
+
+private:
+    struct header_t;
+    struct slot_t;
+    struct name_record_t;
+
+    bool unpackRecord(U32 index, LLAvatarName& av_name) const;
+
+    static U32 slotFor(const LLUUID& agent_id, U32 slot_count);
+
+private:
+    LLMappedFile mFile;
+    const slot_t* mSlots;
+    const name_record_t* mRecords;
+    const char* mPool;
+    U64 mPoolSize;
+    U32 mSlotCount;
+    S32 mRecordCount;
+};
+
+#endif // LL_LLAVATARNAMECACHEFILE_H
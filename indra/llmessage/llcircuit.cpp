@@ -441,7 +441,7 @@ LLCircuit::~LLCircuit()
                   mCircuitData.end(),
                   llcompose1(
                       DeletePointerFunctor<LLCircuitData>(),
-                      llselect2nd<circuit_data_map::value_type>()));
+                      llselect2nd<circuit_hash_map::value_type>()));
 }
 
 LLCircuitData *LLCircuit::addCircuitData(const LLHost &host, TPACKETID in_id)
@@ -449,7 +449,7 @@ LLCircuitData *LLCircuit::addCircuitData(const LLHost &host, TPACKETID in_id)
     // This should really validate if one already exists
     LL_INFOS() << "LLCircuit::addCircuitData for " << host << LL_ENDL;
     LLCircuitData *tempp = new LLCircuitData(host, in_id, mHeartbeatInterval, mHeartbeatTimeout);
-    mCircuitData.insert(circuit_data_map::value_type(host, tempp));
+    mCircuitData.insert(circuit_hash_map::value_type(host, tempp));
     mPingSet.insert(tempp);
 
     mLastCircuit = tempp;
@@ -460,11 +460,11 @@ void LLCircuit::removeCircuitData(const LLHost &host)
 {
     LL_INFOS() << "LLCircuit::removeCircuitData for " << host << LL_ENDL;
     mLastCircuit = NULL;
-    circuit_data_map::iterator it = mCircuitData.find(host);
+    circuit_hash_map::iterator it = mCircuitData.find(host);
     if(it != mCircuitData.end())
     {
         LLCircuitData *cdp = it->second;
-        mCircuitData.erase(it);
+        mCircuitData.erase(host);
 
         LLCircuit::ping_set_t::iterator psit = mPingSet.find(cdp);
         if (psit != mPingSet.end())
@@ -609,8 +609,8 @@ BOOL LLCircuitData::isDuplicateResend(TPACKETID packetnum)
 
 void LLCircuit::dumpResends()
 {
-    circuit_data_map::iterator end = mCircuitData.end();
-    for(circuit_data_map::iterator it = mCircuitData.begin(); it != end; ++it)
+    circuit_hash_map::iterator end = mCircuitData.end();
+    for(circuit_hash_map::iterator it = mCircuitData.begin(); it != end; ++it)
     {
         (*it).second->dumpResendCountAndReset();
     }
@@ -624,13 +624,12 @@ LLCircuitData* LLCircuit::findCircuit(const LLHost& host) const
         return mLastCircuit;
     }
 
-    circuit_data_map::const_iterator it = mCircuitData.find(host);
-    if(it == mCircuitData.end())
+    LLCircuitData* cdp = mCircuitData.get(host);
+    if (cdp)
     {
-        return NULL;
+        mLastCircuit = cdp;
     }
-    mLastCircuit = it->second;
-    return mLastCircuit;
+    return cdp;
 }
 
 
@@ -964,32 +963,29 @@ BOOL LLCircuitData::updateWatchDogTimers(LLMessageSystem *msgsys)
     // Check to see if anything on our lost list is old enough to
     // be considered lost
 
-    LLCircuitData::packet_time_map::iterator it;
     U64Microseconds timeout = llmin(LL_MAX_LOST_TIMEOUT, F32Seconds(getPingDelayAveraged()) * LL_LOST_TIMEOUT_FACTOR);
 
     U64Microseconds mt_usec = LLMessageSystem::getMessageTimeUsecs();
-    for (it = mPotentialLostPackets.begin(); it != mPotentialLostPackets.end(); )
-    {
-        U64Microseconds delta_t_usec = mt_usec - (*it).second;
-        if (delta_t_usec > timeout)
+    S32 lost = (S32)mPotentialLostPackets.eraseIf(
+        [this, mt_usec, timeout](const packet_time_map::value_type& entry)
         {
+            U64Microseconds delta_t_usec = mt_usec - entry.second;
+            if (delta_t_usec <= timeout)
+            {
+                return false;
+            }
             // let's call this one a loss!
-            mPacketsLost++;
-            gMessageSystem->mDroppedPackets++;
             if(gMessageSystem->mVerboseLog)
             {
                 std::ostringstream str;
                 str << "MSG: <- " << mHost << "\tLOST PACKET:\t"
-                    << (*it).first;
+                    << entry.first;
                 LL_INFOS() << str.str() << LL_ENDL;
             }
-            mPotentialLostPackets.erase(it++);
-        }
-        else
-        {
-            ++it;
-        }
-    }
+            return true;
+        });
+    mPacketsLost += lost;
+    gMessageSystem->mDroppedPackets += lost;
 
     return TRUE;
 }
@@ -1003,43 +999,42 @@ void LLCircuitData::clearDuplicateList(TPACKETID oldest_id)
 
     //LL_INFOS() << mHost << ": clearing before oldest " << oldest_id << LL_ENDL;
     //LL_INFOS() << "Recent list before: " << mRecentlyReceivedReliablePackets.size() << LL_ENDL;
-    if (oldest_id < mHighestPacketID)
-    {
-        // Clean up everything with a packet ID less than oldest_id.
-        packet_time_map::iterator pit_start;
-        packet_time_map::iterator pit_end;
-        pit_start = mRecentlyReceivedReliablePackets.begin();
-        pit_end = mRecentlyReceivedReliablePackets.lower_bound(oldest_id);
-        mRecentlyReceivedReliablePackets.erase(pit_start, pit_end);
-    }
-
-    // Do timeout checks on everything with an ID > mHighestPacketID.
-    // This should be empty except for wrapping IDs.  Thus, this should be
-    // highly rare.
+    // The list is hashed, so both purges below are done in one pass.
+    bool purge_old = oldest_id < mHighestPacketID;
+    TPACKETID highest_id = mHighestPacketID;
     U64Microseconds mt_usec = LLMessageSystem::getMessageTimeUsecs();
 
-    packet_time_map::iterator pit;
-    for(pit = mRecentlyReceivedReliablePackets.upper_bound(mHighestPacketID);
-        pit != mRecentlyReceivedReliablePackets.end(); )
-    {
-        // Validate that the packet ID seems far enough away
-        if ((pit->first - mHighestPacketID) < 100)
+    mRecentlyReceivedReliablePackets.eraseIf(
+        [purge_old, oldest_id, highest_id, mt_usec](const packet_time_map::value_type& entry)
         {
-            LL_WARNS() << "Probably incorrectly timing out non-wrapped packets!" << LL_ENDL;
-        }
-        U64Microseconds delta_t_usec = mt_usec - (*pit).second;
-        F64Seconds delta_t_sec = delta_t_usec;
-        if (delta_t_sec > LL_DUPLICATE_SUPPRESSION_TIMEOUT)
-        {
-            // enough time has elapsed we're not likely to get a duplicate on this one
-            LL_INFOS() << "Clearing " << pit->first << " from recent list" << LL_ENDL;
-            mRecentlyReceivedReliablePackets.erase(pit++);
-        }
-        else
-        {
-            ++pit;
-        }
-    }
+            // Clean up everything with a packet ID less than oldest_id.
+            if (purge_old && entry.first < oldest_id)
+            {
+                return true;
+            }
+
+            // Do timeout checks on everything with an ID > mHighestPacketID.
+            // This should be empty except for wrapping IDs.  Thus, this should be
+            // highly rare.
+            if (entry.first <= highest_id)
+            {
+                return false;
+            }
+            // Validate that the packet ID seems far enough away
+            if ((entry.first - highest_id) < 100)
+            {
+                LL_WARNS() << "Probably incorrectly timing out non-wrapped packets!" << LL_ENDL;
+            }
+            U64Microseconds delta_t_usec = mt_usec - entry.second;
+            F64Seconds delta_t_sec = delta_t_usec;
+            if (delta_t_sec > LL_DUPLICATE_SUPPRESSION_TIMEOUT)
+            {
+                // enough time has elapsed we're not likely to get a duplicate on this one
+                LL_INFOS() << "Clearing " << entry.first << " from recent list" << LL_ENDL;
+                return true;
+            }
+            return false;
+        });
     //LL_INFOS() << "Recent list after: " << mRecentlyReceivedReliablePackets.size() << LL_ENDL;
 }
 
@@ -1207,8 +1202,8 @@ void LLCircuitData::dumpResendCountAndReset()
 std::ostream& operator<<(std::ostream& s, LLCircuit &circuit)
 {
     s << "Circuit Info:" << std::endl;
-    LLCircuit::circuit_data_map::iterator end = circuit.mCircuitData.end();
-    LLCircuit::circuit_data_map::iterator it;
+    LLCircuit::circuit_hash_map::iterator end = circuit.mCircuitData.end();
+    LLCircuit::circuit_hash_map::iterator it;
     for(it = circuit.mCircuitData.begin(); it != end; ++it)
     {
         s << *((*it).second) << std::endl;
@@ -1218,8 +1213,8 @@ std::ostream& operator<<(std::ostream& s, LLCircuit &circuit)
 
 void LLCircuit::getInfo(LLSD& info) const
 {
-    LLCircuit::circuit_data_map::const_iterator end = mCircuitData.end();
-    LLCircuit::circuit_data_map::const_iterator it;
+    LLCircuit::circuit_hash_map::const_iterator end = mCircuitData.end();
+    LLCircuit::circuit_hash_map::const_iterator it;
     LLSD circuit_info;
     for(it = mCircuitData.begin(); it != end; ++it)
     {
@@ -1228,15 +1223,6 @@ void LLCircuit::getInfo(LLSD& info) const
     }
 }
 
-void LLCircuit::getCircuitRange(
-    const LLHost& key,
-    LLCircuit::circuit_data_map::iterator& first,
-    LLCircuit::circuit_data_map::iterator& end)
-{
-    end = mCircuitData.end();
-    first = mCircuitData.upper_bound(key);
-}
-
 TPACKETID LLCircuitData::nextPacketOutID()
 {
     mPacketsOut++;
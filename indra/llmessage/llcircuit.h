@@ -32,6 +32,7 @@
 #include <vector>
 
 #include "llerror.h"
+#include "llflathashmap.h"
 
 #include "lltimer.h"
 #include "net.h"
@@ -233,13 +234,15 @@ protected:
     U32Milliseconds     mPingDelay;             // raw ping delay
     F32Milliseconds     mPingDelayAveraged;     // averaged ping delay (fast attack/slow decay)
 
-    typedef std::map<TPACKETID, U64Microseconds> packet_time_map;
+    // Looked up for every packet received: hashed, not ordered
+    typedef LLFlatHashMap<TPACKETID, U64Microseconds> packet_time_map;
 
     packet_time_map                         mPotentialLostPackets;
     packet_time_map                         mRecentlyReceivedReliablePackets;
     std::vector<TPACKETID> mAcks;
     F32 mAckCreationTime; // first ack creation time
 
+    // Ordered, resends walk these in packet id order
     typedef std::map<TPACKETID, LLReliablePacket *> reliable_map;
     typedef reliable_map::iterator                  reliable_iter;
 
@@ -312,27 +315,15 @@ public:
     void            dumpResends();
 
     typedef std::map<LLHost, LLCircuitData*> circuit_data_map;
-
-    /**
-     * @brief This method gets an iterator range starting after key in
-     * the circuit data map.
-     *
-     * @param key The the host before first.
-     * @param first[out] The first matching value after key. This
-     * value will equal end if there are no entries.
-     * @param end[out] The end of the iteration sequence.
-     */
-    void getCircuitRange(
-        const LLHost& key,
-        circuit_data_map::iterator& first,
-        circuit_data_map::iterator& end);
+    typedef LLFlatHashMap<LLHost, LLCircuitData*, LLHostHash> circuit_hash_map;
 
     // Lists that optimize how many circuits we need to traverse a frame
     // HACK - this should become protected eventually, but stupid !@$@# message system/circuit classes are jumbling things up.
     circuit_data_map mUnackedCircuitMap; // Map of circuits with unacked data
     circuit_data_map mSendAckMap; // Map of circuits which need to send acks
 protected:
-    circuit_data_map mCircuitData;
+    // Every circuit, looked up by findCircuit() for each packet
+    circuit_hash_map mCircuitData;
 
     typedef std::set<LLCircuitData *, LLCircuitData::less> ping_set_t; // Circuits sorted by next ping time
 
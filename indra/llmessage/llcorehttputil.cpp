@@ -118,9 +118,12 @@ bool responseToLLSD(HttpResponse * response, bool log, LLSD & out_llsd)
         return false;
     }
 
-    LLCore::BufferArrayStream bas(body);
+    // One copy into contiguous memory lets the buffer parser scan the
+    // whole body instead of reading it a character at a time.
+    std::vector<char> content(body->size());
+    body->read(0, &content[0], content.size());
     LLSD body_llsd;
-    S32 parse_status(LLSDSerialize::fromXML(body_llsd, bas, log));
+    S32 parse_status(LLSDSerialize::fromXML(body_llsd, &content[0], content.size(), log));
     if (LLSDParser::PARSE_FAILURE == parse_status){
         return false;
     }
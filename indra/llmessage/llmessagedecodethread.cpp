@@ -0,0 +1,177 @@
+/**
+ * @file llmessagedecodethread.cpp
+ * @brief Receives and decodes template messages off the main thread.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmessagedecodethread.h"
+
+#include "llmessagetemplate.h"
+#include "lltemplatemessagereader.h"
+#include "message.h"
+
+// Decoded packets the main thread may fall behind by before this thread
+// stops receiving; the socket buffer takes up the slack after that.
+const size_t MAX_DECODED_PACKETS = 4096;
+
+// How long the thread sleeps on an idle socket before checking whether it
+// should quit
+const S32 IDLE_WAIT_MS = 10;
+
+LLMessageDecodeThread::Packet::Packet() :
+    mStatus(PACKET_DECODED),
+    mTrueSize(0),
+    mSize(0),
+    mCompressedSize(0),
+    mFlags(0),
+    mPacketID(0),
+    mTemplate(NULL),
+    mData(NULL),
+    mRanOffEnd(false),
+    mZeroCodeOverflow(false)
+{
+}
+
+LLMessageDecodeThread::Packet::~Packet()
+{
+    delete mData;
+}
+
+LLMessageDecodeThread::LLMessageDecodeThread(S32 socket, const message_template_number_map_t& message_numbers, BOOL use_batching) :
+    LLThread("MessageDecode"),
+    mSocket(socket),
+    mMessageNumbers(message_numbers),
+    mDecodedPackets(MAX_DECODED_PACKETS)
+{
+    // nothing is ever sent through this ring, so no flushSends() is needed
+    mPacketRing.setUseBatching(use_batching);
+}
+
+LLMessageDecodeThread::~LLMessageDecodeThread()
+{
+    shutdown();
+
+    Packet* packet;
+    while (mDecodedPackets.tryPop(packet))
+    {
+        delete packet;
+    }
+}
+
+LLMessageDecodeThread::Packet* LLMessageDecodeThread::popPacket()
+{
+    Packet* packet = NULL;
+    mDecodedPackets.tryPop(packet);
+    return packet;
+}
+
+void LLMessageDecodeThread::run()
+{
+    while (!isQuitting())
+    {
+        S32 size = mPacketRing.receivePacket(mSocket, (char *)mReceiveBuffer);
+        if (!size)
+        {
+            wait_for_packet(mSocket, IDLE_WAIT_MS);
+            continue;
+        }
+
+        Packet* packet = decodePacket(size);
+        if (!packet)
+        {
+            continue;
+        }
+        while (!mDecodedPackets.tryPush(packet))
+        {
+            // The main thread is behind. Wait for it rather than drop
+            // packets it would have to get resent.
+            if (isQuitting())
+            {
+                delete packet;
+                return;
+            }
+            ms_sleep(1);
+        }
+    }
+}
+
+// Mirrors the first half of LLMessageSystem::receiveMessage(), up to the
+// point where the circuit is needed.
+LLMessageDecodeThread::Packet* LLMessageDecodeThread::decodePacket(S32 size)
+{
+    Packet* packet = new Packet;
+    packet->mSender = mPacketRing.getLastSender();
+    packet->mReceivingIF = mPacketRing.getLastReceivingInterface();
+    packet->mTrueSize = size;
+    if (size < (S32)LL_MINIMUM_VALID_PACKET_SIZE)
+    {
+        packet->mStatus = PACKET_TOO_SHORT;
+        return packet;
+    }
+
+    U8* buffer = mReceiveBuffer;
+    if (buffer[0] & LL_ACK_FLAG)
+    {
+        S32 acks = buffer[--size];
+        if (size < ((S32)(acks * sizeof(TPACKETID) + LL_MINIMUM_VALID_PACKET_SIZE)))
+        {
+            // mal-formed packet. ignore it and continue with
+            // the next one
+            LL_WARNS("Messaging") << "Malformed packet received. Packet size "
+                << size << " with invalid no. of acks " << acks
+                << LL_ENDL;
+            delete packet;
+            return NULL;
+        }
+
+        packet->mAcks.resize(acks);
+        for (S32 i = 0; i < acks; ++i)
+        {
+            U32 mem_id = 0;
+            size -= sizeof(TPACKETID);
+            memcpy(&mem_id, &buffer[size], sizeof(TPACKETID)); /* Flawfinder: ignore*/
+            packet->mAcks[i] = ntohl(mem_id);
+        }
+    }
+
+    if (buffer[0] & LL_ZERO_CODE_FLAG)
+    {
+        packet->mCompressedSize = size;
+        size = LLMessageSystem::zeroCodeExpand(buffer, size, mExpandBuffer, packet->mZeroCodeOverflow);
+        buffer = mExpandBuffer;
+    }
+    packet->mSize = size;
+    packet->mFlags = buffer[0];
+    packet->mPacketID = ntohl(*((U32*)(&buffer[1])));
+
+    if (!LLTemplateMessageReader::decodeTemplate(mMessageNumbers, buffer, size, &packet->mTemplate))
+    {
+        packet->mStatus = PACKET_UNKNOWN_MESSAGE;
+        return packet;
+    }
+    packet->mData = LLTemplateMessageReader::decodeBlocks(packet->mTemplate, buffer, size,
+                                                          packet->mSender, packet->mRanOffEnd);
+    return packet;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file llmessagedecodethread.h
+ * @brief Receives and decodes template messages off the main thread.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESSAGEDECODETHREAD_H
+#define LL_LLMESSAGEDECODETHREAD_H
+
+#include <vector>
+
+#include "llhost.h"
+#include "llmessagenumbertable.h"
+#include "llpacketring.h"
+#include "llthread.h"
+#include "lockfreequeue.h"
+#include "net.h"
+
+class LLMessageTemplate;
+class LLMsgData;
+
+/**
+ * Owns the receiving end of the message system socket. Each datagram is
+ * taken apart here: appended acks are split off, zero coding is undone and
+ * the template message is decoded into its blocks. The result goes to the
+ * main thread, which only has the circuit bookkeeping and the handler
+ * dispatch left to do.
+ *
+ * Circuits are deliberately not touched on this thread, since the send
+ * path updates them from the main thread at any time.
+ */
+class LLMessageDecodeThread : public LLThread
+{
+public:
+    typedef LLMessageNumberTable message_template_number_map_t;
+
+    enum EPacketStatus
+    {
+        PACKET_DECODED,
+        PACKET_TOO_SHORT,
+        PACKET_UNKNOWN_MESSAGE
+    };
+
+    // A received packet. Never changed once it has been queued.
+    struct Packet
+    {
+        Packet();
+        ~Packet();
+
+        EPacketStatus mStatus;
+        LLHost mSender;
+        LLHost mReceivingIF;
+        // As received, appended acks included
+        S32 mTrueSize;
+        // Message size with acks stripped and zero coding undone
+        S32 mSize;
+        // Size before zero code expansion, 0 when not zero coded
+        S32 mCompressedSize;
+        U8 mFlags;
+        TPACKETID mPacketID;
+        std::vector<TPACKETID> mAcks;
+        LLMessageTemplate* mTemplate;
+        // Decoded blocks, NULL if they could not be decoded
+        LLMsgData* mData;
+        bool mRanOffEnd;
+        bool mZeroCodeOverflow;
+    };
+
+    // The templates must all be registered before the thread starts.
+    // use_batching is as LLPacketRing::setUseBatching() takes it.
+    LLMessageDecodeThread(S32 socket, const message_template_number_map_t& message_numbers, BOOL use_batching);
+    virtual ~LLMessageDecodeThread();
+
+    // Main thread: the oldest decoded packet, to be deleted by the caller,
+    // or NULL if none is waiting
+    Packet* popPacket();
+
+protected:
+    void run() override;
+
+private:
+    // NULL for packets the main thread has no use for
+    Packet* decodePacket(S32 size);
+
+    S32 mSocket;
+    const message_template_number_map_t& mMessageNumbers;
+    // Only ever used for receiving, from this thread
+    LLPacketRing mPacketRing;
+    LL::LockFreeQueue<Packet*> mDecodedPackets;
+
+    U8 mReceiveBuffer[NET_BUFFER_SIZE];
+    U8 mExpandBuffer[NET_BUFFER_SIZE];
+};
+
+#endif // LL_LLMESSAGEDECODETHREAD_H
@@ -0,0 +1,154 @@
+/**
+ * @file llmessagenumbertable.h
+ * @brief Direct indexed lookup of message templates by message number.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESSAGENUMBERTABLE_H
+#define LL_LLMESSAGENUMBERTABLE_H
+
+#include <algorithm>
+#include <vector>
+
+class LLMessageTemplate;
+
+/**
+ * Message numbers come in four ranges, matching how they are encoded on
+ * the wire:
+ *   High      1 - 254                    one byte
+ *   Medium    0xFF01 - 0xFFFE            0xFF, one byte
+ *   Low       0xFFFF0001 - 0xFFFFFEFF    0xFF 0xFF, two bytes
+ *   Fixed     0xFFFFFF00 - 0xFFFFFFFF    sent as low
+ * Each range gets its own array indexed by the encoded bytes, so finding
+ * the template for a received packet is one or two array reads. The low
+ * array only grows as far as the highest low number registered.
+ *
+ * Templates are owned by the caller.
+ */
+class LLMessageNumberTable
+{
+public:
+    typedef std::vector<LLMessageTemplate*>::const_iterator const_iterator;
+
+    LLMessageNumberTable()
+    {
+        clear();
+    }
+
+    /// NULL if no template has the number
+    LLMessageTemplate* get(U32 number) const
+    {
+        if (number < 0x100)
+        {
+            return mHigh[number];
+        }
+        if ((number & 0xFFFFFF00) == 0xFF00)
+        {
+            return mMedium[number & 0xFF];
+        }
+        if ((number & 0xFFFF0000) == 0xFFFF0000)
+        {
+            U32 id = number & 0xFFFF;
+            if (id >= 0xFF00)
+            {
+                return mFixed[id & 0xFF];
+            }
+            return id < mLow.size() ? mLow[id] : NULL;
+        }
+        return NULL;
+    }
+
+    LLMessageTemplate* operator[](U32 number) const
+    {
+        return get(number);
+    }
+
+    /// False if the number is not in any of the ranges
+    bool set(U32 number, LLMessageTemplate* templatep)
+    {
+        LLMessageTemplate** slot = NULL;
+        if (number < 0x100)
+        {
+            slot = &mHigh[number];
+        }
+        else if ((number & 0xFFFFFF00) == 0xFF00)
+        {
+            slot = &mMedium[number & 0xFF];
+        }
+        else if ((number & 0xFFFF0000) == 0xFFFF0000)
+        {
+            U32 id = number & 0xFFFF;
+            if (id >= 0xFF00)
+            {
+                slot = &mFixed[id & 0xFF];
+            }
+            else
+            {
+                if (id >= mLow.size())
+                {
+                    mLow.resize(id + 1, NULL);
+                }
+                slot = &mLow[id];
+            }
+        }
+        if (!slot)
+        {
+            return false;
+        }
+
+        if (*slot)
+        {
+            mTemplates.erase(std::find(mTemplates.begin(), mTemplates.end(), *slot));
+        }
+        *slot = templatep;
+        if (templatep)
+        {
+            mTemplates.push_back(templatep);
+        }
+        return true;
+    }
+
+    /// Every registered template, in registration order
+    const_iterator begin() const    { return mTemplates.begin(); }
+    const_iterator end() const      { return mTemplates.end(); }
+    size_t size() const             { return mTemplates.size(); }
+    bool empty() const              { return mTemplates.empty(); }
+
+    void clear()
+    {
+        std::fill(mHigh, mHigh + 256, (LLMessageTemplate*)NULL);
+        std::fill(mMedium, mMedium + 256, (LLMessageTemplate*)NULL);
+        std::fill(mFixed, mFixed + 256, (LLMessageTemplate*)NULL);
+        mLow.clear();
+        mTemplates.clear();
+    }
+
+private:
+    LLMessageTemplate* mHigh[256];
+    LLMessageTemplate* mMedium[256];
+    LLMessageTemplate* mFixed[256];
+    std::vector<LLMessageTemplate*> mLow;
+    std::vector<LLMessageTemplate*> mTemplates;
+};
+
+#endif // LL_LLMESSAGENUMBERTABLE_H
@@ -34,8 +34,34 @@
 
 ///////////////////////////////////////////////////////////
 
-LLPacketBuffer::LLPacketBuffer(const LLHost &host, const char *datap, const S32 size) : mHost(host)
+LLPacketBuffer::LLPacketBuffer(const LLHost &host, const char *datap, const S32 size)
 {
+    init(host, datap, size);
+}
+
+LLPacketBuffer::LLPacketBuffer (S32 hSocket)
+{
+    init(hSocket);
+}
+
+///////////////////////////////////////////////////////////
+
+LLPacketBuffer::~LLPacketBuffer ()
+{
+}
+
+///////////////////////////////////////////////////////////
+
+void LLPacketBuffer::init (S32 hSocket)
+{
+    mSize = receive_packet(hSocket, mData);
+    mHost = ::get_sender();
+    mReceivingIF = ::get_receiving_interface();
+}
+
+void LLPacketBuffer::init(const LLHost &host, const char *datap, const S32 size)
+{
+    mHost = host;
     mSize = 0;
     mData[0] = '!';
 
@@ -51,26 +77,22 @@ LLPacketBuffer::LLPacketBuffer(const LLHost &host, const char *datap, const S32
             mSize = size;
         }
     }
-    
-}
-
-LLPacketBuffer::LLPacketBuffer (S32 hSocket)
-{
-    init(hSocket);
 }
 
-///////////////////////////////////////////////////////////
-
-LLPacketBuffer::~LLPacketBuffer ()
+void LLPacketBuffer::toNetPacket(LLNetPacket& packet)
 {
+    packet.mData = mData;
+    packet.mSize = mSize;
+    packet.mAddress = mHost.getAddress();
+    packet.mPort = mHost.getPort();
+    packet.mReceivingIFAddress = mReceivingIF.getAddress();
 }
 
-///////////////////////////////////////////////////////////
-
-void LLPacketBuffer::init (S32 hSocket)
+void LLPacketBuffer::fromNetPacket(const LLNetPacket& packet)
 {
-    mSize = receive_packet(hSocket, mData);
-    mHost = ::get_sender();
-    mReceivingIF = ::get_receiving_interface();
+    llassert(packet.mData == mData);
+    mSize = packet.mSize;
+    mHost = LLHost(packet.mAddress, packet.mPort);
+    mReceivingIF = LLHost(packet.mReceivingIFAddress, INVALID_PORT);
 }
 
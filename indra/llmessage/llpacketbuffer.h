@@ -43,6 +43,11 @@ public:
     LLHost      getHost() const                 { return mHost; }
     LLHost      getReceivingInterface() const   { return mReceivingIF; }
     void init(S32 hSocket);
+    void init(const LLHost &host, const char *datap, const S32 size);
+
+    // Point a batched receive or send at this buffer, see receive_packets()
+    void toNetPacket(LLNetPacket& packet);
+    void fromNetPacket(const LLNetPacket& packet);
 
 protected:
     char    mData[NET_BUFFER_SIZE];        // packet data       /* Flawfinder : ignore */
@@ -43,6 +43,11 @@
 #include "message.h"
 #include "u64.h"
 
+// Packets received or sent per batch
+const S32 PACKET_BATCH_SIZE = 32;
+// Recycled packet buffers kept around, at NET_BUFFER_SIZE bytes each
+const size_t MAX_FREE_PACKETS = 256;
+
 ///////////////////////////////////////////////////////////
 LLPacketRing::LLPacketRing () :
     mUseInThrottle(FALSE),
@@ -55,7 +60,11 @@ LLPacketRing::LLPacketRing () :
     mInBufferLength(0),
     mOutBufferLength(0),
     mDropPercentage(0.0f),
-    mPacketsToDrop(0x0)
+    mPacketsToDrop(0x0),
+    mUseBatching(FALSE),
+    mReceiveBatchCount(0),
+    mReceiveBatchPos(0),
+    mSendBatchSocket(-1)
 {
 }
 
@@ -83,6 +92,39 @@ void LLPacketRing::cleanup ()
         delete packetp;
         mSendQueue.pop();
     }
+
+    for_each(mReceiveBatch.begin(), mReceiveBatch.end(), DeletePointer());
+    mReceiveBatch.clear();
+    mReceiveBatchCount = 0;
+    mReceiveBatchPos = 0;
+    for_each(mSendBatch.begin(), mSendBatch.end(), DeletePointer());
+    mSendBatch.clear();
+    for_each(mFreePackets.begin(), mFreePackets.end(), DeletePointer());
+    mFreePackets.clear();
+}
+
+///////////////////////////////////////////////////////////
+LLPacketBuffer* LLPacketRing::allocPacket()
+{
+    if (mFreePackets.empty())
+    {
+        return new LLPacketBuffer(LLHost(), NULL, 0);
+    }
+    LLPacketBuffer *packetp = mFreePackets.back();
+    mFreePackets.pop_back();
+    return packetp;
+}
+
+void LLPacketRing::freePacket(LLPacketBuffer *packetp)
+{
+    if (mFreePackets.size() < MAX_FREE_PACKETS)
+    {
+        mFreePackets.push_back(packetp);
+    }
+    else
+    {
+        delete packetp;
+    }
 }
 
 ///////////////////////////////////////////////////////////
@@ -116,6 +158,15 @@ void LLPacketRing::setOutBandwidth(const F32 bps)
 {
     mOutThrottle.setRate(bps);
 }
+
+void LLPacketRing::setUseBatching(const BOOL use_batching)
+{
+    if (!use_batching)
+    {
+        flushSends();
+    }
+    mUseBatching = use_batching;
+}
 ///////////////////////////////////////////////////////////
 S32 LLPacketRing::receiveFromRing (S32 socket, char *datap)
 {
@@ -144,7 +195,7 @@ S32 LLPacketRing::receiveFromRing (S32 socket, char *datap)
     // need to set sender IP/port!!
     mLastSender = packetp->getHost();
     mLastReceivingIF = packetp->getReceivingInterface();
-    delete packetp;
+    freePacket(packetp);
 
     this->mInBufferLength -= packet_size;
 
@@ -166,8 +217,8 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
         // push any current net packet (if any) onto delay ring
         while (!done)
         {
-            LLPacketBuffer *packetp;
-            packetp = new LLPacketBuffer(socket);
+            LLPacketBuffer *packetp = allocPacket();
+            packetp->init(socket);
 
             if (packetp->getSize())
             {
@@ -181,7 +232,7 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 
                 if (mPacketsToDrop)
                 {
-                    delete packetp;
+                    freePacket(packetp);
                     packetp = NULL;
                     packet_size = 0;
                     mPacketsToDrop--;
@@ -196,7 +247,7 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
                 {
                     // Toss it.
                     LL_WARNS() << "Throwing away packet, overflowing buffer" << LL_ENDL;
-                    delete packetp;
+                    freePacket(packetp);
                     packetp = NULL;
                 }
                 else if (packetp->getSize())
@@ -206,7 +257,7 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
                 }
                 else
                 {
-                    delete packetp;
+                    freePacket(packetp);
                     packetp = NULL;
                     done = true;
                 }
@@ -243,15 +294,19 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
             {
                 packet_size = 0;
             }
+            mLastReceivingIF = ::get_receiving_interface();
+        }
+        else if (mUseBatching)
+        {
+            packet_size = receiveFromBatch(socket, datap);
         }
         else
         {
             packet_size = receive_packet(socket, datap);
             mLastSender = ::get_sender();
+            mLastReceivingIF = ::get_receiving_interface();
         }
 
-        mLastReceivingIF = ::get_receiving_interface();
-
         if (packet_size)  // did we actually get a packet?
         {
             if (mDropPercentage && (ll_frand(100.f) < mDropPercentage))
@@ -270,11 +325,91 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
     return packet_size;
 }
 
+///////////////////////////////////////////////////////////
+S32 LLPacketRing::receiveFromBatch(S32 socket, char *datap)
+{
+    if (mReceiveBatchPos >= mReceiveBatchCount)
+    {
+        // Batch used up, receive the next one into the same buffers
+        if (mReceiveBatch.empty())
+        {
+            for (S32 i = 0; i < PACKET_BATCH_SIZE; i++)
+            {
+                mReceiveBatch.push_back(allocPacket());
+            }
+        }
+        mNetPackets.resize(PACKET_BATCH_SIZE);
+        for (S32 i = 0; i < PACKET_BATCH_SIZE; i++)
+        {
+            mReceiveBatch[i]->toNetPacket(mNetPackets[i]);
+        }
+        mReceiveBatchPos = 0;
+        mReceiveBatchCount = receive_packets(socket, &mNetPackets[0], PACKET_BATCH_SIZE);
+        for (S32 i = 0; i < mReceiveBatchCount; i++)
+        {
+            mReceiveBatch[i]->fromNetPacket(mNetPackets[i]);
+        }
+        if (!mReceiveBatchCount)
+        {
+            return 0;
+        }
+    }
+
+    LLPacketBuffer *packetp = mReceiveBatch[mReceiveBatchPos++];
+    memcpy(datap, packetp->getData(), packetp->getSize()); /*Flawfinder: ignore*/
+    mLastSender = packetp->getHost();
+    mLastReceivingIF = packetp->getReceivingInterface();
+    return packetp->getSize();
+}
+
+///////////////////////////////////////////////////////////
+void LLPacketRing::flushSends()
+{
+    if (mSendBatch.empty())
+    {
+        return;
+    }
+
+    S32 count = (S32)mSendBatch.size();
+    mNetPackets.resize(count);
+    for (S32 i = 0; i < count; i++)
+    {
+        mSendBatch[i]->toNetPacket(mNetPackets[i]);
+    }
+    S32 sent = send_packets(mSendBatchSocket, &mNetPackets[0], count);
+    if (sent < count)
+    {
+        LL_DEBUGS("Messaging") << "Sent " << sent << " of " << count << " batched packets" << LL_ENDL;
+    }
+
+    for (S32 i = 0; i < count; i++)
+    {
+        freePacket(mSendBatch[i]);
+    }
+    mSendBatch.clear();
+}
+
 BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host)
 {
     BOOL status = TRUE;
     if (!mUseOutThrottle)
     {
+        if (mUseBatching && !LLProxy::isSOCKSProxyEnabled())
+        {
+            if (h_socket != mSendBatchSocket)
+            {
+                flushSends();
+                mSendBatchSocket = h_socket;
+            }
+            LLPacketBuffer *packetp = allocPacket();
+            packetp->init(host, send_buffer, buf_size);
+            mSendBatch.push_back(packetp);
+            if ((S32)mSendBatch.size() >= PACKET_BATCH_SIZE)
+            {
+                flushSends();
+            }
+            return TRUE;
+        }
         return sendPacketImpl(h_socket, send_buffer, buf_size, host );
     }
     else
@@ -298,7 +433,7 @@ BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, LL
 
                 status = sendPacketImpl(h_socket, packetp->getData(), packet_size, packetp->getHost());
                 
-                delete packetp;
+                freePacket(packetp);
                 // Update the throttle
                 mOutThrottle.throttleOverflow(packet_size * 8.f);
             }
@@ -334,7 +469,8 @@ BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, LL
                 LL_INFOS() << "Outbound packet queue " << mOutBufferLength << " bytes" << LL_ENDL;
                 queue_timer.reset();
             }
-            packetp = new LLPacketBuffer(host, send_buffer, buf_size);
+            packetp = allocPacket();
+            packetp->init(host, send_buffer, buf_size);
 
             mOutBufferLength += packetp->getSize();
             mSendQueue.push(packetp);
@@ -29,6 +29,7 @@
 #define LL_LLPACKETRING_H
 
 #include <queue>
+#include <vector>
 
 #include "llhost.h"
 #include "llpacketbuffer.h"
@@ -55,6 +56,12 @@ public:
 
     BOOL sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host);
 
+    // Receive and send several packets per system call. Outgoing packets
+    // are held until flushSends() or until a batch is full, so a send
+    // reports success before the packet is handed to the socket.
+    void setUseBatching(const BOOL use_batching);
+    void flushSends();
+
     inline LLHost getLastSender();
     inline LLHost getLastReceivingInterface();
 
@@ -83,8 +90,25 @@ protected:
     LLHost mLastSender;
     LLHost mLastReceivingIF;
 
+    BOOL mUseBatching;
+    // Filled by the last batched receive, handed out from mReceiveBatchPos
+    std::vector<LLPacketBuffer *> mReceiveBatch;
+    S32 mReceiveBatchCount;
+    S32 mReceiveBatchPos;
+    // Waiting for flushSends()
+    std::vector<LLPacketBuffer *> mSendBatch;
+    int mSendBatchSocket;
+    std::vector<LLNetPacket> mNetPackets;
+
+    // Recycled packet buffers
+    std::vector<LLPacketBuffer *> mFreePackets;
+
 private:
     BOOL sendPacketImpl(int h_socket, const char * send_buffer, S32 buf_size, LLHost host);
+    S32  receiveFromBatch(S32 socket, char *datap);
+
+    LLPacketBuffer* allocPacket();
+    void freePacket(LLPacketBuffer *packetp);
 };
 
 
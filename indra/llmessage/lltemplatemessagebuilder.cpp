@@ -68,16 +68,17 @@ void LLTemplateMessageBuilder::newMessage(const char *name)
     mCurrentSMessageData = NULL;
 
     char* namep = (char*)name; 
-    if (mMessageTemplates.count(namep) > 0)
+    LLMessageTemplate* templatep = mMessageTemplates.get(name);
+    if (templatep)
     {
-        mCurrentSMessageTemplate = mMessageTemplates.find(name)->second;
+        mCurrentSMessageTemplate = templatep;
         mCurrentSMessageData = new LLMsgData(namep);
         mCurrentSMessageName = namep;
         mCurrentSDataBlock = NULL;
         mCurrentSBlockName = NULL;
 
         // add at one of each block
-        const LLMessageTemplate* msg_template = mMessageTemplates.find(name)->second;
+        const LLMessageTemplate* msg_template = templatep;
 
         if (msg_template->getDeprecation() != MD_NOTDEPRECATED)
         {
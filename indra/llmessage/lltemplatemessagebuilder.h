@@ -27,8 +27,7 @@
 #ifndef LL_LLTEMPLATEMESSAGEBUILDER_H
 #define LL_LLTEMPLATEMESSAGEBUILDER_H
 
-#include <map>
-
+#include "llflathashmap.h"
 #include "llmessagebuilder.h"
 #include "llmsgvariabletype.h"
 
@@ -41,7 +40,7 @@ class LLTemplateMessageBuilder : public LLMessageBuilder
 {
 public:
     
-    typedef std::map<const char* , LLMessageTemplate*> message_template_name_map_t;
+    typedef LLFlatHashMap<const char*, LLMessageTemplate*> message_template_name_map_t;
 
     LLTemplateMessageBuilder(const message_template_name_map_t&);
     virtual ~LLTemplateMessageBuilder();
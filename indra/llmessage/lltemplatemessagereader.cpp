@@ -452,7 +452,9 @@ S32 LLTemplateMessageReader::getMessageSize() const
 }
 
 // Returns template for the message contained in buffer
-BOOL LLTemplateMessageReader::decodeTemplate(  
+//static
+BOOL LLTemplateMessageReader::decodeTemplate(
+        const message_template_number_map_t& message_numbers,
         const U8* buffer, S32 buffer_size,  // inputs
         LLMessageTemplate** msg_template ) // outputs
 {
@@ -501,7 +503,7 @@ BOOL LLTemplateMessageReader::decodeTemplate(
         return(FALSE);
     }
 
-    LLMessageTemplate* temp = get_ptr_in_map(mMessageNumbers,num);
+    LLMessageTemplate* temp = message_numbers.get(num);
     if (temp)
     {
         *msg_template = temp;
@@ -518,16 +520,22 @@ BOOL LLTemplateMessageReader::decodeTemplate(
     return(TRUE);
 }
 
-void LLTemplateMessageReader::logRanOffEndOfPacket( const LLHost& host, const S32 where, const S32 wanted )
+//static
+void LLTemplateMessageReader::warnRanOffEndOfPacket(const LLMessageTemplate* msg_template, const LLHost& host,
+                                                    const S32 where, const S32 wanted, const S32 size)
 {
     // we've run off the end of the packet!
-    LL_WARNS() << "Ran off end of packet " << mCurrentRMessageTemplate->mName
+    LL_WARNS() << "Ran off end of packet " << msg_template->mName
 //          << " with id " << mCurrentRecvPacketID 
             << " from " << host
             << " trying to read " << wanted
             << " bytes at position " << where
-            << " going past packet end at " << mReceiveSize
+            << " going past packet end at " << size
             << LL_ENDL;
+}
+
+void LLTemplateMessageReader::logRanOffEndOfPacket( const LLHost& host )
+{
     if(gMessageSystem->mVerboseLog)
     {
         LL_INFOS() << "MSG: -> " << host << "\tREAD PAST END:\t"
@@ -549,18 +557,60 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
     llassert( !mCurrentRMessageData );
     delete mCurrentRMessageData; // just to make sure
 
+    bool ran_off_end = false;
+    mCurrentRMessageData = decodeBlocks(mCurrentRMessageTemplate, buffer, mReceiveSize, sender, ran_off_end);
+    if (ran_off_end)
+    {
+        logRanOffEndOfPacket(sender);
+    }
+    if (!mCurrentRMessageData)
+    {
+        return FALSE;
+    }
+
+    dispatchMessage(sender);
+    return TRUE;
+}
+
+BOOL LLTemplateMessageReader::readDecodedMessage(LLMsgData* msg_data, bool ran_off_end, const LLHost& sender)
+{
+    LL_RECORD_BLOCK_TIME(FTM_PROCESS_MESSAGES);
+
+    llassert( mCurrentRMessageTemplate);
+    delete mCurrentRMessageData;
+    mCurrentRMessageData = msg_data;
+    if (ran_off_end)
+    {
+        logRanOffEndOfPacket(sender);
+    }
+    if (!mCurrentRMessageData)
+    {
+        return FALSE;
+    }
+
+    dispatchMessage(sender);
+    return TRUE;
+}
+
+// Builds the blocks of a message without touching any reader or message
+// system state, so the message decode thread can call it too.
+//static
+LLMsgData* LLTemplateMessageReader::decodeBlocks(const LLMessageTemplate* msg_template,
+                                                 const U8* buffer, S32 buffer_size,
+                                                 const LLHost& sender, bool& ran_off_end)
+{
     // The offset tells us how may bytes to skip after the end of the
     // message name.
     U8 offset = buffer[PHL_OFFSET];
-    S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(mCurrentRMessageTemplate->mFrequency) + offset;
+    S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(msg_template->mFrequency) + offset;
 
     // create base working data set
-    mCurrentRMessageData = new LLMsgData(mCurrentRMessageTemplate->mName);
+    LLMsgData* msg_data = new LLMsgData(msg_template->mName);
     
     // loop through the template building the data structure as we go
     LLMessageTemplate::message_block_map_t::const_iterator iter;
-    for(iter = mCurrentRMessageTemplate->mMemberBlocks.begin();
-        iter != mCurrentRMessageTemplate->mMemberBlocks.end();
+    for(iter = msg_template->mMemberBlocks.begin();
+        iter != msg_template->mMemberBlocks.end();
         ++iter)
     {
         LLMessageBlock* mbci = *iter;
@@ -583,7 +633,7 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
         {
             // need to read the number from the message
             // repeat number is a single byte
-            if (decode_pos >= mReceiveSize)
+            if (decode_pos >= buffer_size)
             {
                 // commented out - hetgrid says that missing variable blocks
                 // at end of message are legal
@@ -601,7 +651,8 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
         else
         {
             LL_ERRS() << "Unknown block type" << LL_ENDL;
-            return FALSE;
+            delete msg_data;
+            return NULL;
         }
 
         LLMsgBlkData* cur_data_block = NULL;
@@ -622,7 +673,7 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
             }
 
             // add the block to the message
-            mCurrentRMessageData->addBlock(cur_data_block);
+            msg_data->addBlock(cur_data_block);
 
             // now read the variables
             for (LLMessageBlock::message_variable_map_t::const_iterator iter = 
@@ -644,9 +695,10 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
                     U16 tsizeh = 0;
                     U32 tsize = 0;
 
-                    if ((decode_pos + data_size) > mReceiveSize)
+                    if ((decode_pos + data_size) > buffer_size)
                     {
-                        logRanOffEndOfPacket(sender, decode_pos, data_size);
+                        warnRanOffEndOfPacket(msg_template, sender, decode_pos, data_size, buffer_size);
+                        ran_off_end = true;
 
                         // default to 0 length variable blocks
                         tsize = 0;
@@ -680,9 +732,10 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
                 {
                     // fixed!
                     // so, copy data pointer and set data size to fixed size
-                    if ((decode_pos + mvci.getSize()) > mReceiveSize)
+                    if ((decode_pos + mvci.getSize()) > buffer_size)
                     {
-                        logRanOffEndOfPacket(sender, decode_pos, mvci.getSize());
+                        warnRanOffEndOfPacket(msg_template, sender, decode_pos, mvci.getSize(), buffer_size);
+                        ran_off_end = true;
 
                         // default to 0s.
                         U32 size = mvci.getSize();
@@ -703,13 +756,18 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
         }
     }
 
-    if (mCurrentRMessageData->mMemberBlocks.empty()
-        && !mCurrentRMessageTemplate->mMemberBlocks.empty())
+    if (msg_data->mMemberBlocks.empty()
+        && !msg_template->mMemberBlocks.empty())
     {
-        LL_DEBUGS() << "Empty message '" << mCurrentRMessageTemplate->mName << "' (no blocks)" << LL_ENDL;
-        return FALSE;
+        LL_DEBUGS() << "Empty message '" << msg_template->mName << "' (no blocks)" << LL_ENDL;
+        delete msg_data;
+        return NULL;
     }
+    return msg_data;
+}
 
+void LLTemplateMessageReader::dispatchMessage(const LLHost& sender)
+{
     {
         static LLTimer decode_timer;
 
@@ -756,7 +814,6 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
             }
         }
     }
-    return TRUE;
 }
 
 BOOL LLTemplateMessageReader::validateMessage(const U8* buffer, 
@@ -765,14 +822,27 @@ BOOL LLTemplateMessageReader::validateMessage(const U8* buffer,
                                               bool trusted)
 {
     mReceiveSize = buffer_size;
-    BOOL valid = decodeTemplate(buffer, buffer_size, &mCurrentRMessageTemplate );
-    if(valid)
-    {
-        mCurrentRMessageTemplate->mReceiveCount++;
-        //LL_DEBUGS() << "MessageRecvd:"
-        //                       << mCurrentRMessageTemplate->mName 
-        //                       << " from " << sender << LL_ENDL;
-    }
+    BOOL valid = decodeTemplate(mMessageNumbers, buffer, buffer_size, &mCurrentRMessageTemplate );
+    return valid && validateTemplate(sender, trusted);
+}
+
+BOOL LLTemplateMessageReader::validateDecodedMessage(LLMessageTemplate* msg_template,
+                                                     S32 message_size,
+                                                     const LLHost& sender,
+                                                     bool trusted)
+{
+    mReceiveSize = message_size;
+    mCurrentRMessageTemplate = msg_template;
+    return validateTemplate(sender, trusted);
+}
+
+BOOL LLTemplateMessageReader::validateTemplate(const LLHost& sender, bool trusted)
+{
+    BOOL valid = TRUE;
+    mCurrentRMessageTemplate->mReceiveCount++;
+    //LL_DEBUGS() << "MessageRecvd:"
+    //                       << mCurrentRMessageTemplate->mName 
+    //                       << " from " << sender << LL_ENDL;
 
     if (valid && isBanned(trusted))
     {
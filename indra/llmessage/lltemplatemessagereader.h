@@ -28,8 +28,7 @@
 #define LL_LLTEMPLATEMESSAGEREADER_H
 
 #include "llmessagereader.h"
-
-#include <map>
+#include "llmessagenumbertable.h"
 
 class LLMessageTemplate;
 class LLMsgData;
@@ -38,7 +37,7 @@ class LLTemplateMessageReader : public LLMessageReader
 {
 public:
 
-    typedef std::map<U32, LLMessageTemplate*> message_template_number_map_t;
+    typedef LLMessageNumberTable message_template_number_map_t;
 
     LLTemplateMessageReader(message_template_number_map_t&);
     virtual ~LLTemplateMessageReader();
@@ -102,6 +101,21 @@ public:
                          const LLHost& sender, bool trusted = false);
     BOOL readMessage(const U8* buffer, const LLHost& sender);
 
+    // Same as above for a message decoded by LLMessageDecodeThread.
+    // readDecodedMessage() takes ownership of msg_data, which is NULL if
+    // the blocks could not be decoded.
+    BOOL validateDecodedMessage(LLMessageTemplate* msg_template, S32 message_size,
+                                const LLHost& sender, bool trusted = false);
+    BOOL readDecodedMessage(LLMsgData* msg_data, bool ran_off_end, const LLHost& sender);
+
+    // Thread safe, as long as no templates are added meanwhile
+    static BOOL decodeTemplate(const message_template_number_map_t& message_numbers,
+                               const U8* buffer, S32 buffer_size,  // inputs
+                               LLMessageTemplate** msg_template ); // outputs
+    static LLMsgData* decodeBlocks(const LLMessageTemplate* msg_template,
+                                   const U8* buffer, S32 buffer_size,
+                                   const LLHost& sender, bool& ran_off_end);
+
     bool isTrusted() const;
     bool isBanned(bool trusted_source) const;
     bool isUdpBanned() const;
@@ -111,12 +125,13 @@ private:
     void getData(const char *blockname, const char *varname, void *datap, 
                  S32 size = 0, S32 blocknum = 0, S32 max_size = S32_MAX);
 
-    BOOL decodeTemplate(const U8* buffer, S32 buffer_size,  // inputs
-                        LLMessageTemplate** msg_template ); // outputs
-
-    void logRanOffEndOfPacket( const LLHost& host, const S32 where, const S32 wanted );
+    static void warnRanOffEndOfPacket(const LLMessageTemplate* msg_template, const LLHost& host,
+                                      const S32 where, const S32 wanted, const S32 size);
+    void logRanOffEndOfPacket( const LLHost& host );
 
     BOOL decodeData(const U8* buffer, const LLHost& sender );
+    BOOL validateTemplate(const LLHost& sender, bool trusted);
+    void dispatchMessage(const LLHost& sender);
 
     S32 mReceiveSize;
     LLMessageTemplate* mCurrentRMessageTemplate;
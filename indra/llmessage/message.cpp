@@ -55,6 +55,7 @@
 #include "llmd5.h"
 #include "llmessagebuilder.h"
 #include "llmessageconfig.h"
+#include "llmessagedecodethread.h"
 #include "lltemplatemessagedispatcher.h"
 #include "llpumpio.h"
 #include "lltemplatemessagebuilder.h"
@@ -191,6 +192,8 @@ void LLMessageSystem::init()
 
     mMessageBuilder = NULL;
     LockMessageReader(mMessageReader, NULL);
+
+    mDecodeThread = NULL;
 }
 
 // Read file and build message templates
@@ -318,12 +321,17 @@ void LLMessageSystem::loadTemplateFile(const std::string& filename, bool failure
 
 LLMessageSystem::~LLMessageSystem()
 {
+    // the decode thread uses the templates and the socket
+    delete mDecodeThread;
+    mDecodeThread = NULL;
+
     mMessageTemplates.clear(); // don't delete templates.
-    for_each(mMessageNumbers.begin(), mMessageNumbers.end(), DeletePairedPointer());
+    for_each(mMessageNumbers.begin(), mMessageNumbers.end(), DeletePointer());
     mMessageNumbers.clear();
     
     if (!mbError)
     {
+        mPacketRing.flushSends();
         end_net(mSocket);
     }
     mSocket = 0;
@@ -496,6 +504,30 @@ BOOL LLMessageSystem::checkMessages(LockMessageChecker&, S64 frame_count )
         mMessageCountTime = getMessageTimeSeconds();
     }
 
+    valid_packet = mDecodeThread ? receiveDecodedMessage() : receiveMessage();
+
+    F64Seconds mt_sec = getMessageTimeSeconds();
+    // Check to see if we need to print debug info
+    if ((mt_sec - mCircuitPrintTime) > mCircuitPrintFreq)
+    {
+        dumpCircuitInfo();
+        mCircuitPrintTime = mt_sec;
+    }
+
+    if( !valid_packet )
+    {
+        clearReceiveState();
+    }
+
+    return valid_packet;
+}
+
+// Receives and handles packets until a valid one was handled or there are
+// no more. Returns TRUE if a valid packet was handled.
+BOOL LLMessageSystem::receiveMessage()
+{
+    BOOL    valid_packet = FALSE;
+
     // loop until either no packets or a valid packet
     // i.e., burn through packets from unregistered circuits
     S32 receive_size = 0;
@@ -617,20 +649,7 @@ BOOL LLMessageSystem::checkMessages(LockMessageChecker&, S64 frame_count )
                         cdp->collectRAck(mCurrentRecvPacketID);
                     }
                                  
-                    LL_DEBUGS("Messaging") << "Discarding duplicate resend from " << host << LL_ENDL;
-                    if(mVerboseLog)
-                    {
-                        std::ostringstream str;
-                        str << "MSG: <- " << host;
-                        std::string tbuf;
-                        tbuf = llformat( "\t%6d\t%6d\t%6d ", receive_size, (mIncomingCompressedSize ? mIncomingCompressedSize : receive_size), mCurrentRecvPacketID);
-                        str << tbuf << "(unknown)"
-                            << (recv_reliable ? " reliable" : "")
-                            << " resent "
-                            << ((acks > 0) ? "acks" : "")
-                            << " DISCARD DUPLICATE";
-                        LL_INFOS("Messaging") << str.str() << LL_ENDL;
-                    }
+                    logDuplicateResend(host, receive_size, recv_reliable, (BOOL)(acks>0));
                     mPacketsIn++;
                     valid_packet = FALSE;
                     continue;
@@ -651,31 +670,7 @@ BOOL LLMessageSystem::checkMessages(LockMessageChecker&, S64 frame_count )
                 clearReceiveState();
             }
 
-            // UseCircuitCode is allowed in even from an invalid circuit, so that
-            // we can toss circuits around.
-            if(
-                valid_packet &&
-                !cdp && 
-                (mTemplateMessageReader->getMessageName() !=
-                 _PREHASH_UseCircuitCode))
-            {
-                logMsgFromInvalidCircuit( host, recv_reliable );
-                clearReceiveState();
-                valid_packet = FALSE;
-            }
-
-            if(
-                valid_packet &&
-                cdp &&
-                !cdp->getTrusted() && 
-                mTemplateMessageReader->isTrusted())
-            {
-                logTrustedMsgFromUntrustedCircuit( host );
-                clearReceiveState();
-
-                sendDenyTrustedCircuit(host);
-                valid_packet = FALSE;
-            }
+            valid_packet = checkMessageCircuit(cdp, host, valid_packet, recv_reliable);
 
             if( valid_packet )
             {
@@ -683,58 +678,227 @@ BOOL LLMessageSystem::checkMessages(LockMessageChecker&, S64 frame_count )
                 valid_packet = mTemplateMessageReader->readMessage(buffer, host);
             }
 
-            // It's possible that the circuit went away, because ANY message can disable the circuit
-            // (for example, UseCircuit, CloseCircuit, DisableSimulator).  Find it again.
-            cdp = mCircuitInfo.findCircuit(host);
+            finishReceivedPacket(host, valid_packet, recv_reliable);
+        }
+    } while (!valid_packet && receive_size > 0);
 
-            if (valid_packet)
-            {
-                mPacketsIn++;
-                mBytesIn += mTrueReceiveSize;
-                
-                // ACK here for valid packets that we've seen
-                // for the first time.
-                if (cdp && recv_reliable)
-                {
-                    // Add to the recently received list for duplicate suppression
-                    cdp->mRecentlyReceivedReliablePackets[mCurrentRecvPacketID] = getMessageTimeUsecs();
+    return valid_packet;
+}
 
-                    // Put it onto the list of packets to be acked
-                    cdp->collectRAck(mCurrentRecvPacketID);
-                    mReliablePacketsIn++;
-                }
+// Same as receiveMessage(), for packets LLMessageDecodeThread has already
+// taken apart.
+BOOL LLMessageSystem::receiveDecodedMessage()
+{
+    BOOL    valid_packet = FALSE;
+
+    while (!valid_packet)
+    {
+        std::unique_ptr<LLMessageDecodeThread::Packet> packet(mDecodeThread->popPacket());
+        if (!packet)
+        {
+            break;
+        }
+        clearReceiveState();
+
+        mTrueReceiveSize = packet->mTrueSize;
+        mLastSender = packet->mSender;
+        mLastReceivingIF = packet->mReceivingIF;
+
+        if (packet->mStatus == LLMessageDecodeThread::PACKET_TOO_SHORT)
+        {
+            LL_WARNS("Messaging") << "Invalid (too short) packet discarded " << packet->mTrueSize << LL_ENDL;
+            callExceptionFunc(MX_PACKET_TOO_SHORT);
+            continue;
+        }
+
+        // the accounting zeroCodeExpand() does for receiveMessage()
+        if (packet->mCompressedSize)
+        {
+            mTotalBytesIn += packet->mCompressedSize;
+            mCompressedPacketsIn++;
+            mCompressedBytesIn += packet->mCompressedSize;
+            mUncompressedBytesIn += packet->mSize;
+        }
+        else
+        {
+            mTotalBytesIn += packet->mSize;
+        }
+        if (packet->mZeroCodeOverflow)
+        {
+            callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
+        }
+
+        mIncomingCompressedSize = packet->mCompressedSize;
+        mCurrentRecvPacketID = packet->mPacketID;
+        LLHost host = getSender();
+
+        const bool resetPacketId = true;
+        LLCircuitData* cdp = findCircuit(host, resetPacketId);
+
+        if (cdp && !packet->mAcks.empty())
+        {
+            for (TPACKETID packet_id : packet->mAcks)
+            {
+                cdp->ackReliablePacket(packet_id);
             }
-            else
+            if (!cdp->getUnackedPacketCount())
             {
-                if (mbProtected  && (!cdp))
-                {
-                    LL_WARNS("Messaging") << "Invalid Packet from invalid circuit " << host << LL_ENDL;
-                    mOffCircuitPackets++;
-                }
-                else
-                {
-                    mInvalidOnCircuitPackets++;
-                }
+                // Remove this circuit from the list of circuits with unacked packets
+                mCircuitInfo.mUnackedCircuitMap.erase(cdp->mHost);
             }
         }
-    } while (!valid_packet && receive_size > 0);
 
-    F64Seconds mt_sec = getMessageTimeSeconds();
-    // Check to see if we need to print debug info
-    if ((mt_sec - mCircuitPrintTime) > mCircuitPrintFreq)
-    {
-        dumpCircuitInfo();
-        mCircuitPrintTime = mt_sec;
+        BOOL recv_reliable = (packet->mFlags & LL_RELIABLE_FLAG) ? TRUE : FALSE;
+        BOOL recv_resent = (packet->mFlags & LL_RESENT_FLAG) ? TRUE : FALSE;
+        BOOL recv_acks = packet->mAcks.empty() ? FALSE : TRUE;
+        if (recv_resent && cdp && cdp->isDuplicateResend(mCurrentRecvPacketID))
+        {
+            // We need to ACK here to suppress
+            // further resends of packets we've
+            // already seen.
+            if (recv_reliable)
+            {
+                cdp->collectRAck(mCurrentRecvPacketID);
+            }
+            logDuplicateResend(host, packet->mSize, recv_reliable, recv_acks);
+            mPacketsIn++;
+            continue;
+        }
+
+        bool trusted = cdp && cdp->getTrusted();
+        valid_packet = packet->mStatus == LLMessageDecodeThread::PACKET_DECODED
+            && mTemplateMessageReader->validateDecodedMessage(packet->mTemplate, packet->mSize, host, trusted);
+        if (!valid_packet)
+        {
+            clearReceiveState();
+        }
+
+        valid_packet = checkMessageCircuit(cdp, host, valid_packet, recv_reliable);
+
+        if (valid_packet)
+        {
+            logValidMsg(cdp, host, recv_reliable, recv_resent, recv_acks);
+            LLMsgData* msg_data = packet->mData;
+            packet->mData = NULL;
+            valid_packet = mTemplateMessageReader->readDecodedMessage(msg_data, packet->mRanOffEnd, host);
+        }
+
+        finishReceivedPacket(host, valid_packet, recv_reliable);
     }
 
-    if( !valid_packet )
+    return valid_packet;
+}
+
+// Turns away a message its circuit may not send. Returns FALSE if it was
+// already invalid or has been turned away.
+BOOL LLMessageSystem::checkMessageCircuit(LLCircuitData* cdp, const LLHost& host, BOOL valid_packet, BOOL recv_reliable)
+{
+    // UseCircuitCode is allowed in even from an invalid circuit, so that
+    // we can toss circuits around.
+    if(
+        valid_packet &&
+        !cdp && 
+        (mTemplateMessageReader->getMessageName() !=
+         _PREHASH_UseCircuitCode))
     {
+        logMsgFromInvalidCircuit( host, recv_reliable );
         clearReceiveState();
+        valid_packet = FALSE;
     }
 
+    if(
+        valid_packet &&
+        cdp &&
+        !cdp->getTrusted() && 
+        mTemplateMessageReader->isTrusted())
+    {
+        logTrustedMsgFromUntrustedCircuit( host );
+        clearReceiveState();
+
+        sendDenyTrustedCircuit(host);
+        valid_packet = FALSE;
+    }
     return valid_packet;
 }
 
+// Packet statistics and acks once a packet has been handled
+void LLMessageSystem::finishReceivedPacket(const LLHost& host, BOOL valid_packet, BOOL recv_reliable)
+{
+    // It's possible that the circuit went away, because ANY message can disable the circuit
+    // (for example, UseCircuit, CloseCircuit, DisableSimulator).  Find it again.
+    LLCircuitData* cdp = mCircuitInfo.findCircuit(host);
+
+    if (valid_packet)
+    {
+        mPacketsIn++;
+        mBytesIn += mTrueReceiveSize;
+        
+        // ACK here for valid packets that we've seen
+        // for the first time.
+        if (cdp && recv_reliable)
+        {
+            // Add to the recently received list for duplicate suppression
+            cdp->mRecentlyReceivedReliablePackets[mCurrentRecvPacketID] = getMessageTimeUsecs();
+
+            // Put it onto the list of packets to be acked
+            cdp->collectRAck(mCurrentRecvPacketID);
+            mReliablePacketsIn++;
+        }
+    }
+    else
+    {
+        if (mbProtected  && (!cdp))
+        {
+            LL_WARNS("Messaging") << "Invalid Packet from invalid circuit " << host << LL_ENDL;
+            mOffCircuitPackets++;
+        }
+        else
+        {
+            mInvalidOnCircuitPackets++;
+        }
+    }
+}
+
+void LLMessageSystem::logDuplicateResend(const LLHost& host, S32 receive_size, BOOL recv_reliable, BOOL recv_acks)
+{
+    LL_DEBUGS("Messaging") << "Discarding duplicate resend from " << host << LL_ENDL;
+    if(mVerboseLog)
+    {
+        std::ostringstream str;
+        str << "MSG: <- " << host;
+        std::string tbuf;
+        tbuf = llformat( "\t%6d\t%6d\t%6d ", receive_size, (mIncomingCompressedSize ? mIncomingCompressedSize : receive_size), mCurrentRecvPacketID);
+        str << tbuf << "(unknown)"
+            << (recv_reliable ? " reliable" : "")
+            << " resent "
+            << (recv_acks ? "acks" : "")
+            << " DISCARD DUPLICATE";
+        LL_INFOS("Messaging") << str.str() << LL_ENDL;
+    }
+}
+
+void LLMessageSystem::setUseDecodeThread(bool use_thread, BOOL use_batching)
+{
+    if (use_thread == (mDecodeThread != NULL) || mbError)
+    {
+        return;
+    }
+
+    if (use_thread)
+    {
+        LL_INFOS("Messaging") << "Receiving and decoding messages on a separate thread" << LL_ENDL;
+        mDecodeThread = new LLMessageDecodeThread(mSocket, mMessageNumbers, use_batching);
+        mDecodeThread->start();
+    }
+    else
+    {
+        // Packets decoded but not handled yet are dropped, which
+        // reliable delivery recovers from.
+        delete mDecodeThread;
+        mDecodeThread = NULL;
+    }
+}
+
 S32 LLMessageSystem::getReceiveBytes() const
 {
     if (getReceiveCompressedSize())
@@ -816,6 +980,9 @@ void LLMessageSystem::processAcks(LockMessageChecker&, F32 collect_time)
         mResendDumpTime = mt_sec;
         mCircuitInfo.dumpResends();
     }
+
+    // hand this frame's batched packets to the socket
+    mPacketRing.flushSends();
 }
 
 void LLMessageSystem::copyMessageReceivedToSend()
@@ -2367,7 +2534,9 @@ void process_deny_trusted_circuit(LLMessageSystem *msg, void **)
 
 void dump_prehash_files()
 {
-    U32 i;
+    size_t i;
+    std::vector<const char*> strings;
+    LLMessageStringTable::getInstance()->getStrings(strings);
     std::string filename("../../indra/llmessage/message_prehash.h");
     LLFILE* fp = LLFile::fopen(filename, "w");  /* Flawfinder: ignore */
     if (fp)
@@ -2389,11 +2558,11 @@ void dump_prehash_files()
             " */\n",
             gMessageSystem->mMessageFileVersionNumber);
         fprintf(fp, "\n\nextern F32 const gPrehashVersionNumber;\n\n");
-        for (i = 0; i < MESSAGE_NUMBER_OF_HASH_BUCKETS; i++)
+        for (i = 0; i < strings.size(); i++)
         {
-            if (!LLMessageStringTable::getInstance()->mEmpty[i] && LLMessageStringTable::getInstance()->mString[i][0] != '.')
+            if (strings[i][0] != '.')
             {
-                fprintf(fp, "extern char const* const _PREHASH_%s;\n", LLMessageStringTable::getInstance()->mString[i]);
+                fprintf(fp, "extern char const* const _PREHASH_%s;\n", strings[i]);
             }
         }
         fprintf(fp, "\n\n#endif\n");
@@ -2419,11 +2588,11 @@ void dump_prehash_files()
         fprintf(fp, "#include \"linden_common.h\"\n");
         fprintf(fp, "#include \"message.h\"\n\n");
         fprintf(fp, "\n\nF32 const gPrehashVersionNumber = %.3ff;\n\n", gMessageSystem->mMessageFileVersionNumber);
-        for (i = 0; i < MESSAGE_NUMBER_OF_HASH_BUCKETS; i++)
+        for (i = 0; i < strings.size(); i++)
         {
-            if (!LLMessageStringTable::getInstance()->mEmpty[i] && LLMessageStringTable::getInstance()->mString[i][0] != '.')
+            if (strings[i][0] != '.')
             {
-                fprintf(fp, "char const* const _PREHASH_%s = LLMessageStringTable::getInstance()->getString(\"%s\");\n", LLMessageStringTable::getInstance()->mString[i], LLMessageStringTable::getInstance()->mString[i]);
+                fprintf(fp, "char const* const _PREHASH_%s = LLMessageStringTable::getInstance()->getString(\"%s\");\n", strings[i], strings[i]);
             }
         }
         fclose(fp);
@@ -2681,7 +2850,7 @@ void LLMessageSystem::dumpReceiveCounts()
     S32 i;
     for (i = 0; i < mNumMessageCounts; i++)
     {
-        mt = get_ptr_in_map(mMessageNumbers,mMessageCountList[i].mMessageNum);
+        mt = mMessageNumbers.get(mMessageCountList[i].mMessageNum);
         if (mt)
         {
             mt->mReceiveCount++;
@@ -2835,13 +3004,28 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
     S32 in_size = *data_size;
     mCompressedPacketsIn++;
     mCompressedBytesIn += *data_size;
-    
-    *data[0] &= (~LL_ZERO_CODE_FLAG);
 
-    S32 count = (*data_size);  
+    bool overflowed = false;
+    *data_size = zeroCodeExpand(*data, *data_size, mEncodedRecvBuffer, overflowed);
+    *data = mEncodedRecvBuffer;
+    if (overflowed)
+    {
+        callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
+    }
+    mUncompressedBytesIn += *data_size;
+
+    return(in_size);
+}
+
+//static
+S32 LLMessageSystem::zeroCodeExpand(U8* data, S32 data_size, U8* out_buffer, bool& overflowed)
+{
+    data[0] &= (~LL_ZERO_CODE_FLAG);
+
+    S32 count = data_size;
     
-    U8 *inptr = (U8 *)*data;
-    U8 *outptr = (U8 *)mEncodedRecvBuffer;
+    U8 *inptr = data;
+    U8 *outptr = out_buffer;
 
 // skip the packet id field
 
@@ -2858,11 +3042,11 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
     while (count--)
     {
-        if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-1]))
+        if (outptr > (&out_buffer[MAX_BUFFER_SIZE-1]))
         {
             LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 1" << LL_ENDL;
-            callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-            outptr = mEncodedRecvBuffer;                    
+            overflowed = true;
+            outptr = out_buffer;
             break;
         }
         if (!((*outptr++ = *inptr++)))
@@ -2870,11 +3054,11 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
             while (((count--)) && (!(*inptr)))
             {
                 *outptr++ = *inptr++;
-                if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-256]))
+                if (outptr > (&out_buffer[MAX_BUFFER_SIZE-256]))
                 {
                     LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 2" << LL_ENDL;
-                    callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-                    outptr = mEncodedRecvBuffer;
+                    overflowed = true;
+                    outptr = out_buffer;
                     count = -1;
                     break;
                 }
@@ -2889,11 +3073,11 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
             else
             {
-                if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-(*inptr)]))
+                if (outptr > (&out_buffer[MAX_BUFFER_SIZE-(*inptr)]))
                 {
                     LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 3" << LL_ENDL;
-                    callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-                    outptr = mEncodedRecvBuffer;                    
+                    overflowed = true;
+                    outptr = out_buffer;
                 }
                 memset(outptr,0,(*inptr) - 1);
                 outptr += ((*inptr) - 1);
@@ -2901,12 +3085,8 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
             }
         }       
     }
-    
-    *data = mEncodedRecvBuffer;
-    *data_size = (S32)(outptr - mEncodedRecvBuffer);
-    mUncompressedBytesIn += *data_size;
 
-    return(in_size);
+    return (S32)(outptr - out_buffer);
 }
 
 
@@ -2918,13 +3098,13 @@ void LLMessageSystem::addTemplate(LLMessageTemplate *templatep)
             << LL_ENDL;
     }
     mMessageTemplates[templatep->mName] = templatep;
-    mMessageNumbers[templatep->mMessageNumber] = templatep;
+    mMessageNumbers.set(templatep->mMessageNumber, templatep);
 }
 
 
 void LLMessageSystem::setHandlerFuncFast(const char *name, void (*handler_func)(LLMessageSystem *msgsystem, void **user_data), void **user_data)
 {
-    LLMessageTemplate* msgtemplate = get_ptr_in_map(mMessageTemplates, name);
+    LLMessageTemplate* msgtemplate = mMessageTemplates.get(name);
     if (msgtemplate)
     {
         msgtemplate->setHandlerFunc(handler_func, user_data);
@@ -42,6 +42,7 @@
 #include "llerror.h"
 #include "net.h"
 #include "llstringtable.h"
+#include "llflathashmap.h"
 #include "llcircuit.h"
 #include "lltimer.h"
 #include "llpacketring.h"
@@ -53,6 +54,7 @@
 #include "llstl.h"
 #include "llmsgvariabletype.h"
 #include "llmessagesenderinterface.h"
+#include "llmessagenumbertable.h"
 
 #include "llstoredmessage.h"
 #include "boost/function.hpp"
@@ -71,11 +73,14 @@ class LLMessageStringTable : public LLSingleton<LLMessageStringTable>
     ~LLMessageStringTable();
 
 public:
+    // Safe on any thread, lock free once the name is known
     char *getString(const char *str);
 
-    U32  mUsed;
-    BOOL mEmpty[MESSAGE_NUMBER_OF_HASH_BUCKETS];
-    char mString[MESSAGE_NUMBER_OF_HASH_BUCKETS][MESSAGE_MAX_STRINGS_LENGTH];   /* Flawfinder: ignore */
+    // Every name interned so far, sorted
+    void getStrings(std::vector<const char*>& strings) const;
+
+private:
+    LLInternTable<> mTable;
 };
 
 
@@ -160,6 +165,7 @@ class LLQuaternion;
 class LLSD;
 class LLUUID;
 class LLMessageSystem;
+class LLMessageDecodeThread;
 class LLPumpIO;
 
 // message system exceptional condition handlers.
@@ -300,8 +306,8 @@ class LLMessageSystem : public LLMessageSenderInterface
 
     F32                         mMessageFileVersionNumber;
 
-    typedef std::map<const char *, LLMessageTemplate*> message_template_name_map_t;
-    typedef std::map<U32, LLMessageTemplate*> message_template_number_map_t;
+    typedef LLFlatHashMap<const char*, LLMessageTemplate*> message_template_name_map_t;
+    typedef LLMessageNumberTable message_template_number_map_t;
 
 private:
     message_template_name_map_t     mMessageTemplates;
@@ -537,6 +543,9 @@ public:
 
     S32     zeroCode(U8 **data, S32 *data_size);
     S32     zeroCodeExpand(U8 **data, S32 *data_size);
+    // Expands data_size bytes of zero coded data into out_buffer, which
+    // must hold MAX_BUFFER_SIZE bytes, and returns the expanded size.
+    static S32 zeroCodeExpand(U8* data, S32 data_size, U8* out_buffer, bool& overflowed);
     S32     zeroCodeAdjustCurrentSendTotal();
 
     // Uses ping-based retry
@@ -815,6 +824,12 @@ public:
     // Check UDP messages and pump http_pump to receive HTTP messages.
     bool checkAllMessages(LockMessageChecker&, S64 frame_count, LLPumpIO* http_pump);
 
+    // Receive and decode UDP messages on LLMessageDecodeThread, leaving
+    // only the circuit bookkeeping and the handlers to checkMessages().
+    // use_batching is for the thread's packet ring, see
+    // LLPacketRing::setUseBatching().
+    void setUseDecodeThread(bool use_thread, BOOL use_batching);
+
     // Moved to allow access from LLTemplateMessageDispatcher
     void clearReceiveState();
 
@@ -845,6 +860,12 @@ private:
     void        logTrustedMsgFromUntrustedCircuit( const LLHost& sender );
     void        logValidMsg(LLCircuitData *cdp, const LLHost& sender, BOOL recv_reliable, BOOL recv_resent, BOOL recv_acks );
     void        logRanOffEndOfPacket( const LLHost& sender );
+    void        logDuplicateResend(const LLHost& sender, S32 receive_size, BOOL recv_reliable, BOOL recv_acks);
+
+    BOOL        receiveMessage();
+    BOOL        receiveDecodedMessage();
+    BOOL        checkMessageCircuit(LLCircuitData* cdp, const LLHost& sender, BOOL valid_packet, BOOL recv_reliable);
+    void        finishReceivedPacket(const LLHost& sender, BOOL valid_packet, BOOL recv_reliable);
 
     class LLMessageCountInfo
     {
@@ -856,6 +877,9 @@ private:
 
     LLMessagePollInfo                       *mPollInfop;
 
+    // NULL unless setUseDecodeThread() turned it on
+    LLMessageDecodeThread                   *mDecodeThread;
+
     U8  mEncodedRecvBuffer[MAX_BUFFER_SIZE];
     U8  mTrueReceiveBuffer[MAX_BUFFER_SIZE];
     S32 mTrueReceiveSize;
@@ -29,27 +29,19 @@
 #include "llerror.h"
 #include "message.h"
 
-inline U32  message_hash_my_string(const char *str)
+#include <algorithm>
+
+namespace
 {
-    U32 retval = 0;
-    while (*str++)
+    bool less_string(const char* lhs, const char* rhs)
     {
-        retval += *str;
-        retval <<= 1;
+        return strcmp(lhs, rhs) < 0;
     }
-    return (retval % MESSAGE_NUMBER_OF_HASH_BUCKETS);
 }
 
-
-
 LLMessageStringTable::LLMessageStringTable()
-:   mUsed(0)
+:   mTable(MESSAGE_NUMBER_OF_HASH_BUCKETS)
 {
-    for (U32 i = 0; i < MESSAGE_NUMBER_OF_HASH_BUCKETS; i++)
-    {
-        mEmpty[i] = TRUE;
-        mString[i][0] = 0;
-    }
 }
 
 
@@ -59,33 +51,17 @@ LLMessageStringTable::~LLMessageStringTable()
 
 char* LLMessageStringTable::getString(const char *str)
 {
-    U32 hash_value = message_hash_my_string(str);
-    while (!mEmpty[hash_value])
-    {
-        if (!strncmp(str, mString[hash_value], MESSAGE_MAX_STRINGS_LENGTH))
-        {
-            return mString[hash_value];
-        }
-        else
-        {
-            hash_value++;
-            hash_value %= MESSAGE_NUMBER_OF_HASH_BUCKETS;
-        }
-    }
-    // not found, so add!
-    strncpy(mString[hash_value], str, MESSAGE_MAX_STRINGS_LENGTH);  /* Flawfinder: ignore */
-    mString[hash_value][MESSAGE_MAX_STRINGS_LENGTH - 1] = 0;
-    mEmpty[hash_value] = FALSE;
-    mUsed++;
-    if (mUsed >= MESSAGE_NUMBER_OF_HASH_BUCKETS - 1)
-    {
-        U32 i;
-        LL_INFOS() << "Dumping string table before crashing on HashTable full!" << LL_ENDL;
-        for (i = 0; i < MESSAGE_NUMBER_OF_HASH_BUCKETS; i++)
-        {
-            LL_INFOS() << "Entry #" << i << ": " << mString[i] << LL_ENDL;
-        }
-    }
-    return mString[hash_value];
+    // names are cut to MESSAGE_MAX_STRINGS_LENGTH, terminator included
+    size_t length = strnlen(str, MESSAGE_MAX_STRINGS_LENGTH - 1);    /* Flawfinder: ignore */
+    return const_cast<char*>(mTable.insert(str, length)->getString());
 }
 
+void LLMessageStringTable::getStrings(std::vector<const char*>& strings) const
+{
+    strings.reserve(strings.size() + mTable.size());
+    mTable.forEach([&strings](const LLInternTable<>::Entry& entry)
+    {
+        strings.push_back(entry.getString());
+    });
+    std::sort(strings.begin(), strings.end(), less_string);
+}
@@ -35,6 +35,7 @@
 #include "llwin32headerslean.h"
 #else
     #include <sys/types.h>
+    #include <sys/select.h>
     #include <sys/socket.h>
     #include <netinet/in.h>
     #include <arpa/inet.h>
@@ -661,6 +662,156 @@ BOOL send_packet(int hSocket, const char * sendBuffer, int size, U32 recipient,
     return success;
 }
 
+#if LL_LINUX
+S32 receive_packets(int hSocket, LLNetPacket* packets, S32 count)
+{
+    struct mmsghdr msgs[NET_MAX_PACKET_BATCH];
+    struct iovec iovs[NET_MAX_PACKET_BATCH];
+    struct sockaddr_in from[NET_MAX_PACKET_BATCH];
+    char cmsgs[NET_MAX_PACKET_BATCH][CMSG_SPACE(sizeof(struct in_pktinfo))];
+
+    count = llmin(count, NET_MAX_PACKET_BATCH);
+    memset(msgs, 0, count * sizeof(struct mmsghdr));
+    for (S32 i = 0; i < count; i++)
+    {
+        iovs[i].iov_base = packets[i].mData;
+        iovs[i].iov_len = NET_BUFFER_SIZE;
+        msgs[i].msg_hdr.msg_name = &from[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_control = cmsgs[i];
+        msgs[i].msg_hdr.msg_controllen = sizeof(cmsgs[i]);
+    }
+
+    // the socket is non-blocking, so this returns whatever is queued
+    int received = recvmmsg(hSocket, msgs, count, 0, NULL);
+    if (received <= 0)
+    {
+        return 0;
+    }
+
+    for (S32 i = 0; i < received; i++)
+    {
+        LLNetPacket& packet = packets[i];
+        packet.mSize = msgs[i].msg_len;
+        packet.mAddress = from[i].sin_addr.s_addr;
+        packet.mPort = ntohs(from[i].sin_port);
+        packet.mReceivingIFAddress = INVALID_HOST_IP_ADDRESS;
+        for (struct cmsghdr* cmsgptr = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsgptr))
+        {
+            if (cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO)
+            {
+                // see recvfrom_destip()
+                in_pktinfo* pktinfo = (in_pktinfo*)CMSG_DATA(cmsgptr);
+                packet.mReceivingIFAddress = pktinfo->ipi_spec_dst.s_addr;
+            }
+        }
+    }
+
+    // keep get_sender() and get_receiving_interface() meaningful
+    stSrcAddr = from[received - 1];
+    gsnReceivingIFAddr = packets[received - 1].mReceivingIFAddress;
+
+    return received;
+}
+
+S32 send_packets(int hSocket, const LLNetPacket* packets, S32 count)
+{
+    struct mmsghdr msgs[NET_MAX_PACKET_BATCH];
+    struct iovec iovs[NET_MAX_PACKET_BATCH];
+    struct sockaddr_in to[NET_MAX_PACKET_BATCH];
+
+    S32 sent = 0;
+    S32 done = 0;
+    while (done < count)
+    {
+        S32 batch = llmin(count - done, NET_MAX_PACKET_BATCH);
+        memset(msgs, 0, batch * sizeof(struct mmsghdr));
+        for (S32 i = 0; i < batch; i++)
+        {
+            const LLNetPacket& packet = packets[done + i];
+            memset(&to[i], 0, sizeof(struct sockaddr_in));
+            to[i].sin_family = AF_INET;
+            to[i].sin_addr.s_addr = packet.mAddress;
+            to[i].sin_port = htons(packet.mPort);
+            iovs[i].iov_base = packet.mData;
+            iovs[i].iov_len = packet.mSize;
+            msgs[i].msg_hdr.msg_name = &to[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int ret = sendmmsg(hSocket, msgs, batch, 0);
+        if (ret > 0)
+        {
+            sent += ret;
+            done += ret;
+        }
+        else
+        {
+            // the first packet failed, let send_packet() retry and report it
+            const LLNetPacket& packet = packets[done];
+            if (send_packet(hSocket, packet.mData, packet.mSize, packet.mAddress, packet.mPort))
+            {
+                sent++;
+            }
+            done++;
+        }
+    }
+    return sent;
+}
+#endif // LL_LINUX
+
 #endif
 
+#if !LL_LINUX
+S32 receive_packets(int hSocket, LLNetPacket* packets, S32 count)
+{
+    S32 received = 0;
+    while (received < count)
+    {
+        LLNetPacket& packet = packets[received];
+        packet.mSize = receive_packet(hSocket, packet.mData);
+        if (packet.mSize <= 0)
+        {
+            break;
+        }
+        packet.mAddress = get_sender_ip();
+        packet.mPort = get_sender_port();
+        packet.mReceivingIFAddress = get_receiving_interface_ip();
+        received++;
+    }
+    return received;
+}
+
+S32 send_packets(int hSocket, const LLNetPacket* packets, S32 count)
+{
+    S32 sent = 0;
+    for (S32 i = 0; i < count; i++)
+    {
+        if (send_packet(hSocket, packets[i].mData, packets[i].mSize, packets[i].mAddress, packets[i].mPort))
+        {
+            sent++;
+        }
+    }
+    return sent;
+}
+#endif // !LL_LINUX
+
+BOOL wait_for_packet(int hSocket, S32 timeout_ms)
+{
+    fd_set read_set;
+    FD_ZERO(&read_set);
+    FD_SET(hSocket, &read_set);
+
+    struct timeval timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+
+    // The first argument is ignored on Windows
+    return select(hSocket + 1, &read_set, NULL, NULL, &timeout) > 0;
+}
+
 //EOF
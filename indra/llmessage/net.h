@@ -45,6 +45,29 @@ S32     receive_packet(int hSocket, char * receiveBuffer);
 
 BOOL    send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort);   // Returns TRUE on success.
 
+// One packet of a batched receive or send
+struct LLNetPacket
+{
+    char*   mData;          // NET_BUFFER_SIZE bytes to receive into
+    S32     mSize;
+    U32     mAddress;       // sender of a received packet, recipient of a sent one
+    U32     mPort;
+    U32     mReceivingIFAddress;
+};
+
+// Most packets handed over per system call
+const S32 NET_MAX_PACKET_BATCH = 64;
+
+// Batched versions of the above, using recvmmsg()/sendmmsg() where available
+// and one call per packet elsewhere. Return the number of packets received
+// or successfully sent.
+S32     receive_packets(int hSocket, LLNetPacket* packets, S32 count);
+S32     send_packets(int hSocket, const LLNetPacket* packets, S32 count);
+
+// Blocks until a packet can be received or timeout_ms has passed. Returns
+// TRUE if a packet is waiting.
+BOOL    wait_for_packet(int hSocket, S32 timeout_ms);
+
 //void  get_sender(char * tmp);
 LLHost  get_sender();
 U32     get_sender_port();
@@ -0,0 +1,296 @@
+/**
+ * @file llavatarnamecachefile_test.cpp
+ * @brief LLAvatarNameCacheFile test cases.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../llavatarnamecachefile.h"
+
+#include "llfile.h"
+#include "../test/lltut.h"
+
+// the names are plain data, no need to link the whole of llmessage
+#include "../llavatarname.cpp"
+
+#include <map>
+
+namespace tut
+{
+    struct LLAvatarNameCacheFileFixture
+    {
+        typedef std::map<LLUUID, LLAvatarName> names_t;
+
+        std::string mFilename;
+        names_t mNames;
+
+        LLAvatarNameCacheFileFixture()
+        {
+            mFilename = std::string(LLFile::tmpdir()) + "llavatarnamecachefile_test.bin";
+            LLFile::remove(mFilename, ENOENT);
+        }
+
+        ~LLAvatarNameCacheFileFixture()
+        {
+            LLFile::remove(mFilename, ENOENT);
+        }
+
+        LLAvatarName makeName(S32 n)
+        {
+            LLAvatarName av_name;
+            av_name.mUsername = llformat("resident%d", n);
+            // some names with no display name, some multi-byte
+            av_name.mDisplayName = (n % 3) ? llformat("Jos\xc3\xa9 %d", n) : std::string();
+            av_name.mLegacyFirstName = av_name.mUsername;
+            av_name.mLegacyLastName = "Resident";
+            av_name.mIsDisplayNameDefault = (n % 2) != 0;
+            av_name.mExpires = 1600000000.0 + n;
+            av_name.mNextUpdate = 1600000000.5 + n;
+            return av_name;
+        }
+
+        void makeNames(S32 count)
+        {
+            mNames.clear();
+            for (S32 n = 0; n < count; ++n)
+            {
+                mNames[LLUUID::generateNewID()] = makeName(n);
+            }
+        }
+
+        bool save()
+        {
+            LLAvatarNameCacheFile::names_vec_t names;
+            for (names_t::const_iterator it = mNames.begin(); it != mNames.end(); ++it)
+            {
+                names.push_back(std::make_pair(it->first, &it->second));
+            }
+            return LLAvatarNameCacheFile::save(mFilename, names);
+        }
+
+        void ensureSameName(const std::string& msg, const LLAvatarName& found, const LLAvatarName& expected)
+        {
+            ensure_equals(msg + " username", found.mUsername, expected.mUsername);
+            ensure_equals(msg + " display name", found.mDisplayName, expected.mDisplayName);
+            ensure_equals(msg + " first name", found.mLegacyFirstName, expected.mLegacyFirstName);
+            ensure_equals(msg + " last name", found.mLegacyLastName, expected.mLegacyLastName);
+            ensure_equals(msg + " default", found.mIsDisplayNameDefault, expected.mIsDisplayNameDefault);
+            ensure_equals(msg + " expires", found.mExpires, expected.mExpires);
+            ensure_equals(msg + " next update", found.mNextUpdate, expected.mNextUpdate);
+            ensure(msg + " not temporary", !found.mIsTemporaryName);
+        }
+
+        void ensureAllFound(const LLAvatarNameCacheFile& file)
+        {
+            ensure_equals("record count", file.getRecordCount(), (S32)mNames.size());
+            for (names_t::const_iterator it = mNames.begin(); it != mNames.end(); ++it)
+            {
+                LLAvatarName av_name;
+                ensure("find " + it->first.asString(), file.find(it->first, av_name));
+                ensureSameName(it->second.mUsername, av_name, it->second);
+            }
+        }
+
+        void writeFile(const std::vector<char>& data)
+        {
+            LLFILE* file = LLFile::fopen(mFilename, "wb");
+            ensure("test file created", file != NULL);
+            if (!data.empty())
+            {
+                fwrite(&data[0], 1, data.size(), file);
+            }
+            fclose(file);
+        }
+
+        std::vector<char> readFile()
+        {
+            std::vector<char> data;
+            LLFILE* file = LLFile::fopen(mFilename, "rb");
+            ensure("test file opened", file != NULL);
+            char buffer[4096];
+            size_t read;
+            while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+            {
+                data.insert(data.end(), buffer, buffer + read);
+            }
+            fclose(file);
+            return data;
+        }
+    };
+    typedef test_group<LLAvatarNameCacheFileFixture> LLAvatarNameCacheFile_factory;
+    typedef LLAvatarNameCacheFile_factory::object LLAvatarNameCacheFile_t;
+    LLAvatarNameCacheFile_factory tf("LLAvatarNameCacheFile");
+
+    template<> template<>
+    void LLAvatarNameCacheFile_t::test<1>()
+    {
+        set_test_name("round trip");
+        makeNames(10);
+        ensure("saved", save());
+
+        LLAvatarNameCacheFile file;
+        ensure("not open yet", !file.isOpen());
+        ensure("opened", file.open(mFilename));
+        ensure("open", file.isOpen());
+        ensureAllFound(file);
+
+        LLAvatarName av_name;
+        ensure("unknown agent", !file.find(LLUUID::generateNewID(), av_name));
+        ensure("null agent", !file.find(LLUUID::null, av_name));
+
+        // every record once, in any order
+        names_t unpacked;
+        for (S32 i = 0; i < file.getRecordCount(); ++i)
+        {
+            LLUUID agent_id;
+            ensure("unpack", file.unpack(i, agent_id, av_name));
+            ensure("unpacked once", unpacked.insert(std::make_pair(agent_id, av_name)).second);
+            ensure("unpacked known agent", mNames.count(agent_id) == 1);
+            ensureSameName("unpacked", av_name, mNames[agent_id]);
+        }
+
+        file.close();
+        ensure("closed", !file.isOpen());
+        ensure("closed lookup", !file.find(mNames.begin()->first, av_name));
+    }
+
+    template<> template<>
+    void LLAvatarNameCacheFile_t::test<2>()
+    {
+        set_test_name("empty and large caches");
+        LLAvatarNameCacheFile file;
+        ensure("empty saved", save());
+        ensure("empty opened", file.open(mFilename));
+        ensure_equals("empty count", file.getRecordCount(), 0);
+        LLAvatarName av_name;
+        ensure("empty lookup", !file.find(LLUUID::generateNewID(), av_name));
+        file.close();
+
+        makeNames(5000);
+        ensure("large saved", save());
+        ensure("large opened", file.open(mFilename));
+        ensureAllFound(file);
+        for (S32 i = 0; i < 1000; ++i)
+        {
+            ensure("large unknown agent", !file.find(LLUUID::generateNewID(), av_name));
+        }
+        file.close();
+
+        // replacing an existing cache
+        makeNames(3);
+        ensure("replaced", save());
+        ensure("replaced opened", file.open(mFilename));
+        ensureAllFound(file);
+    }
+
+    template<> template<>
+    void LLAvatarNameCacheFile_t::test<3>()
+    {
+        set_test_name("duplicate agents");
+        LLUUID agent_id = LLUUID::generateNewID();
+        LLAvatarName first = makeName(1);
+        LLAvatarName second = makeName(2);
+        LLAvatarNameCacheFile::names_vec_t names;
+        names.push_back(std::make_pair(agent_id, &first));
+        names.push_back(std::make_pair(agent_id, &second));
+        ensure("saved", LLAvatarNameCacheFile::save(mFilename, names));
+
+        LLAvatarNameCacheFile file;
+        ensure("opened", file.open(mFilename));
+        ensure_equals("one record", file.getRecordCount(), 1);
+        LLAvatarName av_name;
+        ensure("found", file.find(agent_id, av_name));
+        ensureSameName("first one kept", av_name, first);
+    }
+
+    template<> template<>
+    void LLAvatarNameCacheFile_t::test<4>()
+    {
+        set_test_name("damaged files");
+        LLAvatarNameCacheFile file;
+        ensure("missing file", !file.open(mFilename));
+        ensure("missing file not open", !file.isOpen());
+
+        writeFile(std::vector<char>());
+        ensure("empty file", !file.open(mFilename));
+
+        writeFile(std::vector<char>(100, 'x'));
+        ensure("not a cache", !file.open(mFilename));
+
+        makeNames(50);
+        ensure("saved", save());
+        const std::vector<char> data = readFile();
+
+        // cut anywhere before the end of the string pool
+        for (size_t size = 0; size < data.size(); size += 97)
+        {
+            writeFile(std::vector<char>(data.begin(), data.begin() + size));
+            ensure(llformat("truncated to %d", (S32)size), !file.open(mFilename));
+        }
+
+        // other format version
+        std::vector<char> changed = data;
+        changed[4] ^= 0x40;
+        writeFile(changed);
+        ensure("other version", !file.open(mFilename));
+
+        // slot count no longer a power of two
+        changed = data;
+        changed[12] ^= 0x01;
+        writeFile(changed);
+        ensure("bad slot count", !file.open(mFilename));
+
+        // record count larger than the file
+        changed = data;
+        changed[10] = 0x7f;
+        writeFile(changed);
+        ensure("bad record count", !file.open(mFilename));
+
+        // garbage in the records must not read outside the mapping
+        changed = data;
+        for (size_t i = 40; i < changed.size(); i += 7)
+        {
+            changed[i] = (char)0xff;
+        }
+        writeFile(changed);
+        if (file.open(mFilename))
+        {
+            LLAvatarName av_name;
+            for (names_t::const_iterator it = mNames.begin(); it != mNames.end(); ++it)
+            {
+                file.find(it->first, av_name);
+            }
+            for (S32 i = 0; i < file.getRecordCount(); ++i)
+            {
+                LLUUID agent_id;
+                file.unpack(i, agent_id, av_name);
+            }
+            file.close();
+        }
+
+        // and the untouched file still reads
+        writeFile(data);
+        ensure("intact", file.open(mFilename));
+        ensureAllFound(file);
+    }
+}
@@ -0,0 +1,268 @@
+/**
+ * @file llmessagenumbertable_test.cpp
+ * @brief LLMessageNumberTable test cases, and a benchmark of the per packet
+ *        template, circuit and packet id lookups against std::map.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llmessagenumbertable.h"
+#include "../llmessagetemplate.h"
+#include "../llmessagetemplateparser.h"
+
+#include "llflathashmap.h"
+#include "llhost.h"
+#include "lltimer.h"
+#include "../test/lltut.h"
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace tut
+{
+    // Lookups per benchmark run
+    const S32 BENCH_LOOKUPS = 1000000;
+    // Circuits a busy viewer has open: the region and its neighbours
+    const S32 BENCH_CIRCUITS = 9;
+    // Reliable packet ids kept for duplicate suppression between pings
+    const S32 BENCH_RECENT_PACKETS = 256;
+
+    struct LLMessageNumberTableFixture
+    {
+        std::vector<LLMessageTemplate*> mTemplates;
+        std::string mPath;
+
+        LLMessageNumberTableFixture()
+        {
+            // tests run from the build tree, find the template next to the source
+            std::string here(__FILE__);
+            mPath = here.substr(0, here.find_last_of("/\\") + 1) +
+                "../../../scripts/messages/message_template.msg";
+
+            std::ifstream file(mPath.c_str());
+            if (!file)
+            {
+                return;
+            }
+            std::ostringstream body;
+            body << file.rdbuf();
+            LLTemplateTokenizer tokens(body.str());
+            LLTemplateParser parsed(tokens);
+            mTemplates.assign(parsed.getMessagesBegin(), parsed.getMessagesEnd());
+        }
+
+        ~LLMessageNumberTableFixture()
+        {
+            for_each(mTemplates.begin(), mTemplates.end(), DeletePointer());
+        }
+
+        void requireTemplates()
+        {
+            if (mTemplates.empty())
+            {
+                skip("no message template at " + mPath);
+            }
+        }
+
+        // Message numbers in the order a stream of packets would have them.
+        // High frequency messages are the bulk of the traffic.
+        std::vector<U32> trafficNumbers()
+        {
+            std::vector<U32> high, other;
+            for (size_t i = 0; i < mTemplates.size(); ++i)
+            {
+                U32 number = mTemplates[i]->mMessageNumber;
+                (number < 0x100 ? high : other).push_back(number);
+            }
+            std::vector<U32> numbers;
+            numbers.reserve(4096);
+            for (S32 i = 0; i < 4096; ++i)
+            {
+                if (i % 8 && !high.empty())
+                {
+                    numbers.push_back(high[(i * 7) % high.size()]);
+                }
+                else
+                {
+                    numbers.push_back(other[(i * 13) % other.size()]);
+                }
+            }
+            return numbers;
+        }
+
+        static void report(const char* what, F64 map_seconds, F64 hash_seconds)
+        {
+            std::cout << "\n" << what << ": std::map " << (map_seconds * 1.e9 / BENCH_LOOKUPS)
+                      << " ns, flat " << (hash_seconds * 1.e9 / BENCH_LOOKUPS) << " ns per lookup";
+        }
+    };
+    typedef test_group<LLMessageNumberTableFixture> LLMessageNumberTable_factory;
+    typedef LLMessageNumberTable_factory::object LLMessageNumberTable_t;
+    LLMessageNumberTable_factory tf("LLMessageNumberTable");
+
+    template<> template<>
+    void LLMessageNumberTable_t::test<1>()
+    {
+        set_test_name("ranges");
+        LLMessageTemplate high("TestHigh", 1, MFT_HIGH);
+        LLMessageTemplate medium("TestMedium", 0xFF05, MFT_MEDIUM);
+        LLMessageTemplate low("TestLow", 0xFFFF0105, MFT_LOW);
+        LLMessageTemplate fixed("TestFixed", 0xFFFFFFFB, MFT_LOW);
+
+        LLMessageNumberTable table;
+        ensure("high", table.set(1, &high));
+        ensure("medium", table.set(0xFF05, &medium));
+        ensure("low", table.set(0xFFFF0105, &low));
+        ensure("fixed", table.set(0xFFFFFFFB, &fixed));
+        ensure("not a message number", !table.set(0x12345678, &high));
+        ensure_equals("size", table.size(), 4U);
+
+        ensure("get high", table.get(1) == &high);
+        ensure("get medium", table.get(0xFF05) == &medium);
+        ensure("get low", table.get(0xFFFF0105) == &low);
+        ensure("get fixed", table.get(0xFFFFFFFB) == &fixed);
+        ensure("unset high", table.get(2) == NULL);
+        ensure("unset medium", table.get(0xFF06) == NULL);
+        ensure("low past the end", table.get(0xFFFF0200) == NULL);
+        ensure("unset fixed", table.get(0xFFFFFFFA) == NULL);
+        ensure("outside the ranges", table.get(0x12345678) == NULL);
+
+        // replacing a template keeps the iteration list in step
+        table.set(1, &medium);
+        ensure_equals("size after replace", table.size(), 4U);
+        ensure("replaced", table.get(1) == &medium);
+        table.clear();
+        ensure("cleared", table.empty() && table.get(0xFF05) == NULL);
+    }
+
+    template<> template<>
+    void LLMessageNumberTable_t::test<2>()
+    {
+        set_test_name("every template in message_template.msg");
+        requireTemplates();
+        LLMessageNumberTable table;
+        for (size_t i = 0; i < mTemplates.size(); ++i)
+        {
+            ensure("valid number", table.set(mTemplates[i]->mMessageNumber, mTemplates[i]));
+        }
+        ensure_equals("all registered", table.size(), mTemplates.size());
+        for (size_t i = 0; i < mTemplates.size(); ++i)
+        {
+            ensure_equals(mTemplates[i]->mName, table.get(mTemplates[i]->mMessageNumber), mTemplates[i]);
+        }
+    }
+
+    template<> template<>
+    void LLMessageNumberTable_t::test<3>()
+    {
+        set_test_name("per packet lookup benchmark");
+        requireTemplates();
+
+        // template by message number, for every message received
+        std::map<U32, LLMessageTemplate*> number_map;
+        LLMessageNumberTable number_table;
+        for (size_t i = 0; i < mTemplates.size(); ++i)
+        {
+            number_map[mTemplates[i]->mMessageNumber] = mTemplates[i];
+            number_table.set(mTemplates[i]->mMessageNumber, mTemplates[i]);
+        }
+        std::vector<U32> numbers = trafficNumbers();
+        size_t found = 0;
+        LLTimer timer;
+        for (S32 i = 0; i < BENCH_LOOKUPS; ++i)
+        {
+            found += get_ptr_in_map(number_map, numbers[i & 4095]) != NULL;
+        }
+        F64 map_seconds = timer.getElapsedTimeF64();
+        timer.reset();
+        for (S32 i = 0; i < BENCH_LOOKUPS; ++i)
+        {
+            found += number_table.get(numbers[i & 4095]) != NULL;
+        }
+        F64 table_seconds = timer.getElapsedTimeF64();
+        ensure_equals("all found", found, (size_t)BENCH_LOOKUPS * 2);
+        report("Template by number", map_seconds, table_seconds);
+
+        // circuit by host, for every message sent or received
+        std::map<LLHost, S32> host_map;
+        LLFlatHashMap<LLHost, S32, LLHostHash> host_table;
+        std::vector<LLHost> hosts;
+        for (S32 i = 0; i < BENCH_CIRCUITS; ++i)
+        {
+            LLHost host(0x0A000010 + i * 3, 12035 + i);
+            hosts.push_back(host);
+            host_map[host] = i;
+            host_table[host] = i;
+        }
+        S32 sum = 0;
+        timer.reset();
+        for (S32 i = 0; i < BENCH_LOOKUPS; ++i)
+        {
+            sum += host_map.find(hosts[(i * 5) % BENCH_CIRCUITS])->second;
+        }
+        map_seconds = timer.getElapsedTimeF64();
+        timer.reset();
+        for (S32 i = 0; i < BENCH_LOOKUPS; ++i)
+        {
+            sum -= host_table.find(hosts[(i * 5) % BENCH_CIRCUITS])->second;
+        }
+        table_seconds = timer.getElapsedTimeF64();
+        ensure_equals("same circuits", sum, 0);
+        report("Circuit by host", map_seconds, table_seconds);
+
+        // duplicate check and insert of each reliable packet id, with the
+        // oldest id dropped as the window moves on
+        std::map<TPACKETID, U64> id_map;
+        LLFlatHashMap<TPACKETID, U64> id_table;
+        size_t duplicates = 0;
+        timer.reset();
+        for (S32 i = 0; i < BENCH_LOOKUPS; ++i)
+        {
+            duplicates += id_map.find(i) != id_map.end();
+            id_map[i] = i;
+            if (i >= BENCH_RECENT_PACKETS)
+            {
+                id_map.erase(i - BENCH_RECENT_PACKETS);
+            }
+        }
+        map_seconds = timer.getElapsedTimeF64();
+        timer.reset();
+        for (S32 i = 0; i < BENCH_LOOKUPS; ++i)
+        {
+            duplicates += id_table.find(i) != id_table.end();
+            id_table[i] = i;
+            if (i >= BENCH_RECENT_PACKETS)
+            {
+                id_table.erase(i - BENCH_RECENT_PACKETS);
+            }
+        }
+        table_seconds = timer.getElapsedTimeF64();
+        ensure_equals("no duplicates", duplicates, 0U);
+        ensure_equals("same window", id_table.size(), id_map.size());
+        report("Reliable packet id", map_seconds, table_seconds);
+        std::cout << std::endl;
+    }
+}
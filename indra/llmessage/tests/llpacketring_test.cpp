@@ -0,0 +1,165 @@
+/**
+ * @file llpacketring_test.cpp
+ * @brief LLPacketRing test cases, including a loopback throughput benchmark.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llpacketring.h"
+#include "../net.h"
+
+#include "lltimer.h"
+#include "../test/lltut.h"
+
+#include <iostream>
+
+namespace tut
+{
+    const S32 TEST_PACKET_SIZE = 200;
+
+    struct LLPacketRingFixture
+    {
+        S32 mSendSocket;
+        S32 mReceiveSocket;
+        LLHost mReceiveHost;
+        LLHost mSendHost;
+
+        LLPacketRingFixture() :
+            mSendSocket(-1),
+            mReceiveSocket(-1)
+        {
+            int send_port = NET_USE_OS_ASSIGNED_PORT;
+            int receive_port = NET_USE_OS_ASSIGNED_PORT;
+            start_net(mSendSocket, send_port);
+            start_net(mReceiveSocket, receive_port);
+            mSendHost = LLHost("127.0.0.1", send_port);
+            mReceiveHost = LLHost("127.0.0.1", receive_port);
+        }
+
+        ~LLPacketRingFixture()
+        {
+            end_net(mSendSocket);
+            end_net(mReceiveSocket);
+        }
+
+        void fillPacket(char* buffer, S32 index)
+        {
+            for (S32 i = 0; i < TEST_PACKET_SIZE; ++i)
+            {
+                buffer[i] = (char)(index + i);
+            }
+        }
+
+        // Receive everything waiting, returns the number of packets
+        S32 drain(LLPacketRing& ring)
+        {
+            char buffer[NET_BUFFER_SIZE];
+            S32 count = 0;
+            while (ring.receivePacket(mReceiveSocket, buffer))
+            {
+                ++count;
+            }
+            return count;
+        }
+
+        // Send packets in bursts the size of a busy frame and receive them,
+        // returns packets per second
+        F64 measure(BOOL use_batching, S32 total)
+        {
+            const S32 burst = 64;
+            LLPacketRing sender;
+            LLPacketRing receiver;
+            sender.setUseBatching(use_batching);
+            receiver.setUseBatching(use_batching);
+
+            char buffer[NET_BUFFER_SIZE];
+            fillPacket(buffer, 0);
+            S32 received = 0;
+            LLTimer timer;
+            for (S32 sent = 0; sent < total; sent += burst)
+            {
+                for (S32 i = 0; i < burst; ++i)
+                {
+                    sender.sendPacket(mSendSocket, buffer, TEST_PACKET_SIZE, mReceiveHost);
+                }
+                sender.flushSends();
+                received += drain(receiver);
+            }
+            F64 seconds = timer.getElapsedTimeF64();
+            ensure("packets received", received > 0);
+            return received / llmax(seconds, 0.000001);
+        }
+    };
+    typedef test_group<LLPacketRingFixture> LLPacketRing_factory;
+    typedef LLPacketRing_factory::object LLPacketRing_t;
+    LLPacketRing_factory tf("LLPacketRing");
+
+    template<> template<>
+    void LLPacketRing_t::test<1>()
+    {
+        set_test_name("batched packets arrive intact");
+        const S32 count = 100;
+        LLPacketRing sender;
+        LLPacketRing receiver;
+        sender.setUseBatching(TRUE);
+        receiver.setUseBatching(TRUE);
+
+        char buffer[NET_BUFFER_SIZE];
+        for (S32 i = 0; i < count; ++i)
+        {
+            fillPacket(buffer, i);
+            ensure("send", sender.sendPacket(mSendSocket, buffer, TEST_PACKET_SIZE, mReceiveHost));
+        }
+        sender.flushSends();
+
+        char expected[NET_BUFFER_SIZE];
+        for (S32 i = 0; i < count; ++i)
+        {
+            S32 size = receiver.receivePacket(mReceiveSocket, buffer);
+            ensure_equals("packet size", size, TEST_PACKET_SIZE);
+            fillPacket(expected, i);
+            ensure("packet contents", memcmp(buffer, expected, TEST_PACKET_SIZE) == 0);
+            ensure_equals("sender port", receiver.getLastSender().getPort(), mSendHost.getPort());
+        }
+        ensure_equals("nothing left", receiver.receivePacket(mReceiveSocket, buffer), 0);
+
+        // turning batching off hands over whatever is still held
+        fillPacket(buffer, count);
+        sender.sendPacket(mSendSocket, buffer, TEST_PACKET_SIZE, mReceiveHost);
+        sender.setUseBatching(FALSE);
+        receiver.setUseBatching(FALSE);
+        ensure_equals("flushed on disable", receiver.receivePacket(mReceiveSocket, buffer), TEST_PACKET_SIZE);
+    }
+
+    template<> template<>
+    void LLPacketRing_t::test<2>()
+    {
+        set_test_name("loopback throughput");
+        const S32 total = 20000;
+        F64 single = measure(FALSE, total);
+        F64 batched = measure(TRUE, total);
+        std::cout << "\nLLPacketRing loopback: " << (S64)single << " packets/s one at a time, "
+                  << (S64)batched << " packets/s batched" << std::endl;
+    }
+}
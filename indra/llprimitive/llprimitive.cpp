@@ -1368,9 +1368,6 @@ BOOL LLPrimitive::packTEMessage(LLDataPacker &dp) const
 S32 LLPrimitive::parseTEMessage(LLMessageSystem* mesgsys, char const* block_name, const S32 block_num, LLTEContents& tec)
 {
     S32 retval = 0;
-    // temp buffer for material ID processing
-    // data will end up in tec.material_id[]    
-    material_id_type material_data[LLTEContents::MAX_TES];
 
     if (block_num < 0)
     {
@@ -1395,13 +1392,22 @@ S32 LLPrimitive::parseTEMessage(LLMessageSystem* mesgsys, char const* block_name
     // if block_num < 0 ask for block 0
     mesgsys->getBinaryDataFast(block_name, _PREHASH_TextureEntry, tec.packed_buffer, 0, std::max(block_num, 0), LLTEContents::MAX_TE_BUFFER - 1);
 
+    tec.face_count = llmin((U32)getNumTEs(),(U32)LLTEContents::MAX_TES);
+    return parseTEContents(tec);
+}
+
+// static
+S32 LLPrimitive::parseTEContents(LLTEContents& tec)
+{
+    // temp buffer for material ID processing
+    // data will end up in tec.material_id[]    
+    material_id_type material_data[LLTEContents::MAX_TES];
+
     // The last field is not zero terminated.  
     // Rather than special case the upack functions.  Just make it 0x00 terminated.
     tec.packed_buffer[tec.size] = 0x00;
     ++tec.size;
 
-    tec.face_count = llmin((U32)getNumTEs(),(U32)LLTEContents::MAX_TES);
-
     U8 *cur_ptr = tec.packed_buffer;
     LL_DEBUGS("TEXTUREENTRY") << "Texture Entry with buffere sized: " << tec.size << LL_ENDL;
     U8 *buffer_end = tec.packed_buffer + tec.size;
@@ -1431,8 +1437,7 @@ S32 LLPrimitive::parseTEMessage(LLMessageSystem* mesgsys, char const* block_name
         tec.material_ids[i].set(&(material_data[i]));
     }
     
-    retval = 1;
-    return retval;
+    return 1;
     }
     
 S32 LLPrimitive::applyParsedTEMessage(LLTEContents& tec)
@@ -429,6 +429,9 @@ public:
     S32 unpackTEMessage(LLMessageSystem* mesgsys, char const* block_name, const S32 block_num); // Variable num of blocks
     BOOL unpackTEMessage(LLDataPacker &dp);
     S32 parseTEMessage(LLMessageSystem* mesgsys, char const* block_name, const S32 block_num, LLTEContents& tec);
+    // Unpacks tec.packed_buffer (tec.size bytes) for tec.face_count faces.
+    // Touches no object state, so it is safe to call from any thread.
+    static S32 parseTEContents(LLTEContents& tec);
     S32 applyParsedTEMessage(LLTEContents& tec);
     
 #ifdef CHECK_FOR_FINITE
@@ -1691,19 +1691,22 @@ void LLRender::flush()
                 mBuffer->getColorStrider(mColorsp, 0, count);
             }
 
-            mBuffer->flush();
-            mBuffer->setBuffer(immediate_mask);
-
-            // <FS:Ansariel> Remove QUADS rendering mode
-            //if (mMode == LLRender::QUADS && sGLCoreProfile)
-            //{
-            //  mBuffer->drawArrays(LLRender::TRIANGLES, 0, count);
-            //  mQuadCycle = 1;
-            //}
-            //else
-            // </FS:Ansariel>
+            if (!mBuffer->drawArraysStream(mMode, count, immediate_mask))
             {
-                mBuffer->drawArrays(mMode, 0, count);
+                mBuffer->flush();
+                mBuffer->setBuffer(immediate_mask);
+
+                // <FS:Ansariel> Remove QUADS rendering mode
+                //if (mMode == LLRender::QUADS && sGLCoreProfile)
+                //{
+                //  mBuffer->drawArrays(LLRender::TRIANGLES, 0, count);
+                //  mQuadCycle = 1;
+                //}
+                //else
+                // </FS:Ansariel>
+                {
+                    mBuffer->drawArrays(mMode, 0, count);
+                }
             }
         }
         else
@@ -0,0 +1,92 @@
+/**
+ * @file llringallocator.cpp
+ * @brief Suballocation of a ring buffer whose ranges are freed in order.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llringallocator.h"
+
+LLRingAllocator::LLRingAllocator(U32 size, U32 alignment)
+:   mAlignment(alignment),
+    mSize(size & ~(alignment - 1)),
+    mHead(0),
+    mUsed(0),
+    mOpenBytes(0)
+{
+    llassert(alignment && !(alignment & (alignment - 1)));
+}
+
+S32 LLRingAllocator::allocate(U32 size)
+{
+    size = (size + mAlignment - 1) & ~(mAlignment - 1);
+    if (!size || size > mSize)
+    {
+        return -1;
+    }
+
+    if (!mUsed)
+    { //nothing in use, start over without skipping anything
+        mHead = 0;
+    }
+
+    // The bytes in use run up to mHead, wrapping around: whatever is left
+    // before the end is skipped when the allocation does not fit there
+    U32 skipped = mHead + size > mSize ? mSize - mHead : 0;
+    if (mUsed + skipped + size > mSize)
+    {
+        return -1;
+    }
+
+    U32 offset = skipped ? 0 : mHead;
+    mHead = offset + size;
+    if (mHead == mSize)
+    {
+        mHead = 0;
+    }
+    mUsed += skipped + size;
+    mOpenBytes += skipped + size;
+    return (S32)offset;
+}
+
+bool LLRingAllocator::closeRegion()
+{
+    if (!mOpenBytes)
+    {
+        return false;
+    }
+    mRegions.push_back(mOpenBytes);
+    mOpenBytes = 0;
+    return true;
+}
+
+void LLRingAllocator::releaseRegion()
+{
+    llassert(!mRegions.empty());
+    if (!mRegions.empty())
+    {
+        mUsed -= mRegions.front();
+        mRegions.pop_front();
+    }
+}
@@ -0,0 +1,77 @@
+/**
+ * @file llringallocator.h
+ * @brief Suballocation of a ring buffer whose ranges are freed in order.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLRINGALLOCATOR_H
+#define LL_LLRINGALLOCATOR_H
+
+#include <deque>
+
+/**
+ * Offsets into a buffer of fixed size, handed out one after the other and
+ * wrapping around at the end. Nothing is freed one allocation at a time:
+ * the allocations made since the last closeRegion() form a region, which
+ * the owner keeps until whatever reads it is done (for a GL buffer, until
+ * a fence placed after the draws signals), then gives back with
+ * releaseRegion(), oldest first.
+ *
+ * Only the bookkeeping lives here, no memory and no GL, so the owner
+ * decides what the offsets point into.
+ */
+class LLRingAllocator
+{
+public:
+    // size is rounded down to a multiple of alignment, a power of two
+    LLRingAllocator(U32 size, U32 alignment = 16);
+
+    // Offset of size bytes, aligned, or -1 if the regions still in use
+    // leave no room for them
+    S32 allocate(U32 size);
+
+    // Ends the open region. false if nothing was allocated since the last
+    // call, in which case there is no new region to release later.
+    bool closeRegion();
+
+    // Frees the oldest closed region
+    void releaseRegion();
+
+    U32 getSize() const         { return mSize; }
+    // bytes in use, including those skipped to wrap around
+    U32 getUsed() const         { return mUsed; }
+    U32 getOpenBytes() const    { return mOpenBytes; }
+    S32 getRegionCount() const  { return (S32)mRegions.size(); }
+
+private:
+    // size of each closed region, oldest first
+    std::deque<U32> mRegions;
+    const U32 mAlignment;
+    const U32 mSize;
+    // the next allocation starts here, if it fits before the end
+    U32 mHead;
+    U32 mUsed;
+    U32 mOpenBytes;
+};
+
+#endif // LL_LLRINGALLOCATOR_H
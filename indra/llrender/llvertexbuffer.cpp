@@ -79,6 +79,11 @@ U32 vbo_block_index(U32 size)
 
 const U32 LL_VBO_POOL_SEED_COUNT = vbo_block_index(LL_VBO_POOL_MAX_SEED_SIZE);
 
+// Room for a few frames of UI and debug geometry
+const U32 LL_STREAM_BUFFER_SIZE = 4*1024*1024;
+// Draws are fenced off once this share of the stream buffer waits on them
+const U32 LL_STREAM_BUFFER_FENCE_DIVISOR = 16;
+
 
 //============================================================================
 
@@ -94,6 +99,8 @@ U32 LLVBOPool::sIndexBytesPooled = 0;
 U32 LLVBOPool::sNameIdx = 0;
 U32 LLVBOPool::sNamePool[1024];
 
+U32 LLStreamBuffer::sMissCount = 0;
+
 std::list<U32> LLVertexBuffer::sAvailableVAOName;
 U32 LLVertexBuffer::sCurVAOName = 1;
 
@@ -104,8 +111,10 @@ U32 LLVertexBuffer::sBindCount = 0;
 U32 LLVertexBuffer::sSetCount = 0;
 S32 LLVertexBuffer::sCount = 0;
 S32 LLVertexBuffer::sGLCount = 0;
-S32 LLVertexBuffer::sMappedCount = 0;
+std::atomic<S32> LLVertexBuffer::sMappedCount(0);
 bool LLVertexBuffer::sDisableVBOMapping = false;
+bool LLVertexBuffer::sUseStreamBuffer = true;
+LLStreamBuffer* LLVertexBuffer::sStreamBuffer = NULL;
 bool LLVertexBuffer::sEnableVBOs = true;
 U32 LLVertexBuffer::sGLRenderBuffer = 0;
 U32 LLVertexBuffer::sGLRenderArray = 0;
@@ -341,6 +350,153 @@ void LLVBOPool::cleanup()
     std::fill(mMissCount.begin(), mMissCount.end(), 0);
 }
 
+//============================================================================
+
+LLStreamBuffer::LLStreamBuffer(U32 size)
+:   mAllocator(size),
+    mGLName(0),
+    mMappedOffset(0),
+    mMappedSize(0),
+    mUseFences(gGLManager.mHasSync && gGLManager.mHasMapBufferRange)
+{
+    glGenBuffersARB(1, &mGLName);
+    bind();
+    glBufferDataARB(GL_ARRAY_BUFFER_ARB, mAllocator.getSize(), NULL, GL_STREAM_DRAW_ARB);
+    LLVertexBuffer::sAllocatedBytes += mAllocator.getSize();
+}
+
+LLStreamBuffer::~LLStreamBuffer()
+{
+    for (LLGLSyncFence* fence : mFences)
+    {
+        delete fence;
+    }
+
+    if (gGLManager.mInited)
+    {
+        if (LLVertexBuffer::sGLRenderBuffer == mGLName)
+        {
+            LLVertexBuffer::unbind();
+        }
+        glDeleteBuffersARB(1, &mGLName);
+    }
+    LLVertexBuffer::sAllocatedBytes -= mAllocator.getSize();
+}
+
+void LLStreamBuffer::bind()
+{
+    if (LLVertexBuffer::sGLRenderBuffer != mGLName || !LLVertexBuffer::sVBOActive)
+    {
+        glBindBufferARB(GL_ARRAY_BUFFER_ARB, mGLName);
+        LLVertexBuffer::sGLRenderBuffer = mGLName;
+        LLVertexBuffer::sBindCount++;
+        LLVertexBuffer::sVBOActive = true;
+    }
+}
+
+U8* LLStreamBuffer::map(U32 size, U32& offset)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VERTEX;
+    S32 allocated = mAllocator.allocate(size);
+    if (allocated < 0)
+    { //the draws since the last fence were issued already, they can be fenced off too
+        closeRegion();
+        reclaim();
+        allocated = mAllocator.allocate(size);
+        if (allocated < 0)
+        {
+            sMissCount++;
+            return NULL;
+        }
+    }
+
+    bind();
+    offset = mMappedOffset = (U32)allocated;
+    mMappedSize = size;
+
+    U8* data = NULL;
+#ifdef GL_ARB_map_buffer_range
+    if (mUseFences)
+    { //the fences keep the GPU off this range, no need for the driver to sync
+        data = (U8*) glMapBufferRange(GL_ARRAY_BUFFER_ARB, offset, size,
+            GL_MAP_WRITE_BIT |
+            GL_MAP_INVALIDATE_RANGE_BIT |
+            GL_MAP_UNSYNCHRONIZED_BIT);
+        if (!data)
+        {
+            LL_WARNS() << "Unable to map the stream buffer, using glBufferSubData" << LL_ENDL;
+            mUseFences = false;
+            // from now on regions are freed as soon as they close
+            while (!mFences.empty())
+            {
+                mFences.front()->wait();
+                delete mFences.front();
+                mFences.pop_front();
+                mAllocator.releaseRegion();
+            }
+        }
+    }
+#endif
+    if (!data)
+    {
+        if (mScratch.size() < size)
+        {
+            mScratch.resize(size);
+        }
+        data = mScratch.data();
+    }
+    return data;
+}
+
+void LLStreamBuffer::unmap()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VERTEX;
+    if (mUseFences)
+    {
+        glUnmapBufferARB(GL_ARRAY_BUFFER_ARB);
+    }
+    else
+    {
+        glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, mMappedOffset, mMappedSize, mScratch.data());
+    }
+    stop_glerror();
+}
+
+void LLStreamBuffer::placeFence()
+{
+    if (mAllocator.getOpenBytes() >= mAllocator.getSize() / LL_STREAM_BUFFER_FENCE_DIVISOR)
+    {
+        closeRegion();
+    }
+}
+
+void LLStreamBuffer::closeRegion()
+{
+    if (mAllocator.closeRegion())
+    {
+        if (mUseFences)
+        {
+            LLGLSyncFence* fence = new LLGLSyncFence();
+            fence->placeFence();
+            mFences.push_back(fence);
+        }
+        else
+        { //glBufferSubData waits for the draws reading the range itself
+            mAllocator.releaseRegion();
+        }
+    }
+}
+
+void LLStreamBuffer::reclaim()
+{
+    while (!mFences.empty() && mFences.front()->isCompleted())
+    {
+        delete mFences.front();
+        mFences.pop_front();
+        mAllocator.releaseRegion();
+    }
+}
+
 
 //NOTE: each component must be AT LEAST 4 bytes in size to avoid a performance penalty on AMD hardware
 const S32 LLVertexBuffer::sTypeSize[LLVertexBuffer::TYPE_MAX] =
@@ -738,6 +894,78 @@ void LLVertexBuffer::drawArrays(U32 mode, U32 first, U32 count) const
     placeFence();
 }
 
+bool LLVertexBuffer::drawArraysStream(U32 mode, U32 count, U32 data_mask)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VERTEX;
+    // only client copies, in a VBO or client arrays alone, drawn without a
+    // VAO; texture indexes come with the vertex positions
+    if (!sUseStreamBuffer || !sEnableVBOs || mMappable || mGLArray || sGLRenderArray
+        || !mMappedData || !count || count > (U32)mNumVerts
+        || (data_mask & ~mTypeMask) || (data_mask & MAP_TEXTURE_INDEX))
+    {
+        return false;
+    }
+
+    if (!sStreamBuffer)
+    {
+        sStreamBuffer = new LLStreamBuffer(LL_STREAM_BUFFER_SIZE);
+    }
+
+    // each attribute array after the other, as the buffer lays them out
+    S32 stream_offsets[TYPE_MAX];
+    memset(stream_offsets, 0, sizeof(stream_offsets));
+    U32 size = calcOffsets(data_mask, stream_offsets, count);
+
+    U32 offset = 0;
+    U8* dst = sStreamBuffer->map(size, offset);
+    if (!dst)
+    {
+        return false;
+    }
+    for (S32 i = 0; i < TYPE_TEXTURE_INDEX; ++i)
+    {
+        if (data_mask & (1 << i))
+        {
+            memcpy(dst + stream_offsets[i], mMappedData + mOffsets[i], sTypeSize[i]*count);
+        }
+    }
+    sStreamBuffer->unmap();
+
+    // the client copy went to the stream buffer, not to this VBO
+    if (mVertexLocked)
+    {
+        mMappedVertexRegions.clear();
+        mVertexLocked = false;
+        sMappedCount--;
+    }
+
+    // setupVertexBufferFast() points the attributes at mAlignedOffset +
+    // mOffsets[] in the bound buffer, client arrays or not, aim it at the
+    // copy for the draw
+    S32 offsets[TYPE_MAX];
+    memcpy(offsets, mOffsets, sizeof(offsets));
+    ptrdiff_t aligned_offset = mAlignedOffset;
+    memcpy(mOffsets, stream_offsets, sizeof(mOffsets));
+    mAlignedOffset = offset;
+    setupClientArrays(data_mask);
+    setupVertexBufferFast(data_mask);
+    sSetCount++;
+    memcpy(mOffsets, offsets, sizeof(mOffsets));
+    mAlignedOffset = aligned_offset;
+
+    gGL.syncMatrices();
+    LLGLSLShader::startProfile();
+    {
+        LL_PROFILER_GPU_ZONEC("gl.DrawArrays", 0xFF4040)
+            glDrawArrays(sGLMode[mode], 0, count);
+    }
+    LLGLSLShader::stopProfile(count, mode);
+    stop_glerror();
+
+    sStreamBuffer->placeFence();
+    return true;
+}
+
 //static
 void LLVertexBuffer::initClass(bool use_vbo, bool no_vbo_mapping)
 {
@@ -779,6 +1007,9 @@ void LLVertexBuffer::unbind()
 void LLVertexBuffer::cleanupClass()
 {
     unbind();
+
+    delete sStreamBuffer;
+    sStreamBuffer = NULL;
     
     sStreamIBOPool.cleanup();
     sDynamicIBOPool.cleanup();
@@ -1428,7 +1659,10 @@ bool expand_region(LLVertexBuffer::MappedRegion& region, S32 index, S32 count)
 U8* LLVertexBuffer::mapVertexBuffer(S32 type, S32 index, S32 count, bool map_range)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_VERTEX;
-    bindGLBuffer(true);
+    if (mMappable)
+    { //the client copy needs no binding until unmapBuffer()
+        bindGLBuffer(true);
+    }
     if (mFinal)
     {
         LL_ERRS() << "LLVertexBuffer::mapVeretxBuffer() called on a finalized buffer." << LL_ENDL;
@@ -1479,7 +1713,6 @@ U8* LLVertexBuffer::mapVertexBuffer(S32 type, S32 index, S32 count, bool map_ran
         {
             mVertexLocked = true;
             sMappedCount++;
-            stop_glerror(); 
 
             if(!mMappable)
             {
@@ -1487,6 +1720,7 @@ U8* LLVertexBuffer::mapVertexBuffer(S32 type, S32 index, S32 count, bool map_ran
             }
             else
             {
+                stop_glerror();
                 U8* src = NULL;
                 waitFence();
                 if (gGLManager.mHasMapBufferRange)
@@ -1605,7 +1839,10 @@ U8* LLVertexBuffer::mapVertexBuffer(S32 type, S32 index, S32 count, bool map_ran
 U8* LLVertexBuffer::mapIndexBuffer(S32 index, S32 count, bool map_range)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_VERTEX;
-    bindGLIndices(true);
+    if (mMappable)
+    {
+        bindGLIndices(true);
+    }
     if (mFinal)
     {
         LL_ERRS() << "LLVertexBuffer::mapIndexBuffer() called on a finalized buffer." << LL_ENDL;
@@ -1653,10 +1890,10 @@ U8* LLVertexBuffer::mapIndexBuffer(S32 index, S32 count, bool map_range)
         {
             mIndexLocked = true;
             sMappedCount++;
-            stop_glerror(); 
 
-            if (gDebugGL && useVBOs())
+            if (gDebugGL && useVBOs() && mMappable)
             {
+                stop_glerror();
                 GLint elem = 0;
                 glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING_ARB, &elem);
 
@@ -35,6 +35,9 @@
 #include "llstrider.h"
 #include "llrender.h"
 #include "lltrace.h"
+#include "llringallocator.h"
+#include <atomic>
+#include <deque>
 #include <set>
 #include <vector>
 #include <list>
@@ -94,6 +97,47 @@ public:
     static U32 sNameIdx;
 };
 
+//============================================================================
+// one large buffer that vertex data drawn only once is copied to, instead of
+// each draw uploading to its own VBO. Writes go to parts of the buffer the
+// GPU is done with: the draws are fenced off as data accumulates, and parts
+// are reused once their fence signals. Without sync objects or
+// glMapBufferRange, it falls back to glBufferSubData, which the driver
+// orders with the draws itself.
+class LLStreamBuffer
+{
+public:
+    LLStreamBuffer(U32 size);
+    ~LLStreamBuffer();
+
+    U32 getGLName() const { return mGLName; }
+
+    // Binds the buffer and returns where to write size bytes, at offset in
+    // the buffer, or NULL if the GPU may still be reading all the room left.
+    // Call unmap() once written, before drawing.
+    U8* map(U32 size, U32& offset);
+    void unmap();
+
+    // Call after the draws reading what was written
+    void placeFence();
+
+    static U32 sMissCount;
+
+private:
+    void bind();
+    void closeRegion();
+    // frees the regions whose fence signaled
+    void reclaim();
+
+    LLRingAllocator mAllocator;
+    std::deque<LLGLSyncFence*> mFences;
+    std::vector<U8> mScratch;
+    U32 mGLName;
+    U32 mMappedOffset;
+    U32 mMappedSize;
+    bool mUseFences;
+};
+
 
 //============================================================================
 // base class 
@@ -288,9 +332,18 @@ public:
     S32 getOffset(S32 type) const           { return mOffsets[type]; }
     S32 getUsage() const                    { return mUsage; }
     bool isWriteable() const                { return (mMappable || mUsage == GL_STREAM_DRAW_ARB) ? true : false; }
+    // true if mapping writes to a client side copy uploaded by flush(): no GL
+    // call until then, so such a buffer may be filled on another thread
+    bool hasClientCopy() const              { return !mMappable; }
 
     void draw(U32 mode, U32 count, U32 indices_offset) const;
     void drawArrays(U32 mode, U32 offset, U32 count) const;
+    // drawArrays(mode, 0, count) with the client copy of the first count
+    // vertices copied to sStreamBuffer rather than uploaded to this buffer,
+    // for data that is drawn once. A buffer without a VBO (usage 0) is drawn
+    // from sStreamBuffer too. Returns false, having done nothing, if the
+    // stream buffer can't be used: flush() and draw as usual then.
+    bool drawArraysStream(U32 mode, U32 count, U32 data_mask);
     void drawRange(U32 mode, U32 start, U32 end, U32 count, U32 indices_offset) const;
 
     //implementation for inner loops that does no safety checking
@@ -347,11 +400,13 @@ private:
 public:
     static S32 sCount;
     static S32 sGLCount;
-    static S32 sMappedCount;
+    static std::atomic<S32> sMappedCount; // buffers with a client copy may be mapped off the main thread
     static bool sMapped;
     typedef std::list<LLVertexBuffer*> buffer_list_t;
         
     static bool sDisableVBOMapping; //disable glMapBufferARB
+    static bool sUseStreamBuffer;
+    static LLStreamBuffer* sStreamBuffer; //created on first use by drawArraysStream()
     static bool sEnableVBOs;
     static const S32 sTypeSize[TYPE_MAX];
     static const U32 sGLMode[LLRender::NUM_MODES];
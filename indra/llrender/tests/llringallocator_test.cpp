@@ -0,0 +1,171 @@
+/**
+ * @file   llringallocator_test.cpp
+ * @brief  Test for LLRingAllocator, the bookkeeping of the stream buffer
+ *         LLVertexBuffer draws immediate mode vertices from.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Copyright (c) 2022, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "../llringallocator.h"
+// STL headers
+#include <deque>
+#include <vector>
+// std headers
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+
+namespace
+{
+    // Deterministic, so that every run makes the same allocations
+    U32 sSeed = 1;
+    U32 rand_below(U32 limit)
+    {
+        sSeed = sSeed * 1664525 + 1013904223;
+        return (sSeed >> 8) % limit;
+    }
+
+    struct Range
+    {
+        U32 mBegin;
+        U32 mEnd;
+    };
+    typedef std::vector<Range> region_t;
+}
+
+namespace tut
+{
+    struct llringallocator_data
+    {
+    };
+    typedef test_group<llringallocator_data> llringallocator_group;
+    typedef llringallocator_group::object object;
+    llringallocator_group llringallocatorgrp("llringallocator");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("allocate until full");
+        LLRingAllocator ring(1000, 16);
+        ensure_equals("size rounded down", ring.getSize(), 992U);
+        ensure_equals("nothing to allocate", ring.allocate(0), -1);
+        ensure_equals("too big", ring.allocate(993), -1);
+
+        ensure_equals("first", ring.allocate(10), 0);
+        ensure_equals("aligned", ring.allocate(16), 16);
+        ensure_equals("after", ring.allocate(1), 32);
+        ensure_equals("used", ring.getUsed(), 48U);
+        ensure_equals("open", ring.getOpenBytes(), 48U);
+
+        ensure_equals("rest", ring.allocate(992 - 48), 48);
+        ensure_equals("full", ring.allocate(1), -1);
+        ensure_equals("no regions yet", ring.getRegionCount(), 0);
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("regions and wrapping around");
+        LLRingAllocator ring(256, 16);
+        ensure("nothing to close", !ring.closeRegion());
+
+        ensure_equals("first region", ring.allocate(100), 0);
+        ensure("first closed", ring.closeRegion());
+        ensure_equals("second region", ring.allocate(100), 112);
+        ensure("second closed", ring.closeRegion());
+        ensure_equals("regions", ring.getRegionCount(), 2);
+        ensure_equals("open", ring.getOpenBytes(), 0U);
+
+        // 32 bytes left at the end, not enough: the start is still in use
+        ensure_equals("no room", ring.allocate(64), -1);
+
+        ring.releaseRegion();
+        ensure_equals("released", ring.getUsed(), 112U);
+        // skips the end of the buffer
+        ensure_equals("wrapped", ring.allocate(64), 0);
+        ensure_equals("skipped bytes in use", ring.getUsed(), 112U + 32U + 64U);
+        ensure_equals("up to the second region", ring.allocate(48), 64);
+        ensure_equals("full", ring.allocate(16), -1);
+        ensure("third closed", ring.closeRegion());
+
+        ring.releaseRegion();
+        ring.releaseRegion();
+        ensure_equals("all released", ring.getUsed(), 0U);
+        ensure_equals("no regions", ring.getRegionCount(), 0);
+        // empty, so the whole buffer is available again
+        ensure_equals("whole buffer", ring.allocate(256), 0);
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("allocations never overlap what is in use");
+        const U32 SIZE = 4096;
+        LLRingAllocator ring(SIZE, 16);
+        // ranges of each closed region, oldest first, then the open one
+        std::deque<region_t> regions;
+        region_t open;
+        U32 allocated = 0;
+
+        for (S32 step = 0; step < 20000; ++step)
+        {
+            U32 action = rand_below(10);
+            if (action < 7)
+            {
+                U32 size = 1 + rand_below(700);
+                S32 offset = ring.allocate(size);
+                if (offset < 0)
+                {
+                    // only acceptable if there really is no room
+                    ensure("full ring has something in use", ring.getUsed() > 0);
+                    continue;
+                }
+                ensure_equals("aligned", offset % 16, 0);
+                Range range = { (U32)offset, (U32)offset + size };
+                ensure("within the buffer", range.mEnd <= SIZE);
+                for (const region_t& region : regions)
+                {
+                    for (const Range& used : region)
+                    {
+                        ensure("no overlap with closed regions", range.mEnd <= used.mBegin || range.mBegin >= used.mEnd);
+                    }
+                }
+                for (const Range& used : open)
+                {
+                    ensure("no overlap with the open region", range.mEnd <= used.mBegin || range.mBegin >= used.mEnd);
+                }
+                open.push_back(range);
+                ++allocated;
+            }
+            else if (action < 8)
+            {
+                ensure_equals("close", ring.closeRegion(), !open.empty());
+                if (!open.empty())
+                {
+                    regions.push_back(open);
+                    open.clear();
+                }
+            }
+            else if (!regions.empty())
+            {
+                ring.releaseRegion();
+                regions.pop_front();
+            }
+            ensure_equals("region count", ring.getRegionCount(), (S32)regions.size());
+            ensure("used within size", ring.getUsed() <= SIZE);
+        }
+        ensure("allocations were made", allocated > 1000);
+
+        ring.closeRegion();
+        while (ring.getRegionCount())
+        {
+            ring.releaseRegion();
+        }
+        ensure_equals("all released", ring.getUsed(), 0U);
+    }
+} // namespace tut
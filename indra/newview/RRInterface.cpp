@@ -892,20 +892,11 @@ BOOL RRInterface::isAllowed (LLUUID object_uuid, std::string action, BOOL log_it
     if (debug) {
         LL_INFOS() << object_uuid.asString() << "      " << action << LL_ENDL;
     }
-    RRMAP::iterator it = mSpecialObjectBehaviours.find (object_uuid.asString());
-    while (it != mSpecialObjectBehaviours.end() &&
-            it != mSpecialObjectBehaviours.upper_bound(object_uuid.asString()))
-    {
+    if (mRestrictionIndex.objectHas (object_uuid.asString(), action)) {
         if (debug) {
-            LL_INFOS() << "  checking " << it->second << LL_ENDL;
-        }
-        if (it->second == action) {
-            if (debug) {
-                LL_INFOS() << "  => forbidden. " << LL_ENDL;
-            }
-            return FALSE;
+            LL_INFOS() << "  => forbidden. " << LL_ENDL;
         }
-        it++;
+        return FALSE;
     }
     if (debug) {
         LL_INFOS() << "  => allowed. " << LL_ENDL;
@@ -915,35 +906,16 @@ BOOL RRInterface::isAllowed (LLUUID object_uuid, std::string action, BOOL log_it
 
 BOOL RRInterface::contains (std::string action)
 {
-    RRMAP::iterator it = mSpecialObjectBehaviours.begin ();
     LLStringUtil::toLower(action);
-//  LL_INFOS() << "looking for " << action << LL_ENDL;
-    while (it != mSpecialObjectBehaviours.end()) {
-        if (it->second == action) {
-//          LL_INFOS() << "found " << it->second << LL_ENDL;
-            return TRUE;
-        }
-        it++;
-    }
-    return FALSE;
+    return mRestrictionIndex.contains (action);
 }
 
 BOOL RRInterface::containsSubstr (std::string action)
 {
-    RRMAP::iterator it = mSpecialObjectBehaviours.begin ();
     LLStringUtil::toLower(action);
-//  LL_INFOS() << "looking for " << action << LL_ENDL;
-    while (it != mSpecialObjectBehaviours.end()) {
-      // KKA-829 by matching anywhere in the string this would return a false positive for 'shownames' in 'notify:100;shownames'
-      // The function is now redefined to require the match to begin at index 0 which matches its usage
-        //if (it->second.find (action) != -1) {
-        if ( ! it->second.find (action)) {
-//          LL_INFOS() << "found " << it->second << LL_ENDL;
-            return TRUE;
-        }
-        it++;
-    }
-    return FALSE;
+    // KKA-829 by matching anywhere in the string this would return a false positive for 'shownames' in 'notify:100;shownames'
+    // The function is now redefined to require the match to begin at index 0 which matches its usage
+    return mRestrictionIndex.containsPrefix (action);
 }
 
 std::string RRInterface::get(LLUUID object_uuid, std::string action, std::string dflt /*= ""*/)
@@ -1092,7 +1064,6 @@ BOOL RRInterface::containsWithoutException (std::string action, std::string exce
     
     LLStringUtil::toLower(action);
     std::string action_sec = action + "_sec";
-    LLUUID uuid;
     
     // 1. If except is empty, behave like contains(), but looking for both action and action_sec
     if (except == "") {
@@ -1102,27 +1073,9 @@ BOOL RRInterface::containsWithoutException (std::string action, std::string exce
     // 2. For each action_sec, if we don't find an exception tied to the same object, return TRUE
     // if @permissive is set, then even action needs the exception to be tied to the same object, not just action_sec
     // (@permissive restrains the scope of all the exceptions to their own objects)
-    RRMAP::iterator it = mSpecialObjectBehaviours.begin ();
-    while (it != mSpecialObjectBehaviours.end()) {
-        if (it->second == action_sec 
-        || (it->second == action && mContainsPermissive)) {
-            uuid.set (it->first);
-            if (isAllowed (uuid, action+":"+except, FALSE) && isAllowed (uuid, action_sec+":"+except, FALSE)) { // we use isAllowed because we need to check the object, but it really means "does not contain"
-                return TRUE;
-            }
-        }
-        it++;
-    }
-    
     // 3. If we didn't return yet, but the map contains action, just look for except_uuid without regard to its object, if none is found return TRUE
-    if (contains (action)) {
-        if (!contains (action+":"+except) && !contains (action_sec+":"+except)) {
-            return TRUE;
-        }
-    }
-    
     // 4. Finally return FALSE if we didn't find anything
-    return FALSE;
+    return mRestrictionIndex.containsWithoutException (action, except, mContainsPermissive);
 }
 
 bool RRInterface::isFolderLocked(LLInventoryCategory* cat)
@@ -1272,6 +1225,18 @@ FolderLock RRInterface::isFolderLockedWithoutExceptionAux (LLInventoryCategory*
     return FolderLock_unlocked; // this should never happen since list_of_commands is supposed to contain at least one "{attach|detach}[all]this" restriction
 }
 
+void RRInterface::insertBehaviour (const std::string& object_uuid, const std::string& behav)
+{
+    mSpecialObjectBehaviours.insert(std::pair<std::string, std::string>(object_uuid, behav));
+    mRestrictionIndex.add(object_uuid, behav);
+}
+
+void RRInterface::eraseBehaviour (RRMAP::iterator it)
+{
+    mRestrictionIndex.remove(it->first, it->second);
+    mSpecialObjectBehaviours.erase(it);
+}
+
 BOOL RRInterface::add (LLUUID object_uuid, std::string action, std::string option)
 {
     if (sRestrainedLoveLogging || sRestrainedLoveCommandLogging) {
@@ -1326,7 +1291,7 @@ BOOL RRInterface::add (LLUUID object_uuid, std::string action, std::string optio
         }
 
         // Insert the new behav
-        mSpecialObjectBehaviours.insert(std::pair<std::string, std::string>(object_uuid.asString(), action));
+        insertBehaviour(object_uuid.asString(), action);
         refreshCachedVariable(action);
 
         // Actions to do AFTER inserting the new behav
@@ -1444,7 +1409,7 @@ BOOL RRInterface::remove (LLUUID object_uuid, std::string action, std::string op
             LL_INFOS() << "  checking " << it->second << LL_ENDL;
         }
         if (it->second == action) {
-            mSpecialObjectBehaviours.erase(it);
+            eraseBehaviour(it);
             if (sRestrainedLoveLogging) {
                 LL_INFOS() << "  => removed. " << LL_ENDL;
             }
@@ -1513,7 +1478,7 @@ BOOL RRInterface::remove (LLUUID object_uuid, std::string action, std::string op
 
                     // Remove this setsphere_xxx command.
                     std::string tmp = it->second;
-                    mSpecialObjectBehaviours.erase(it);
+                    eraseBehaviour(it);
                     if (sRestrainedLoveLogging) {
                         LL_INFOS() << "removing outstanding setsphere param: " << tmp << LL_ENDL;
                     }
@@ -1567,7 +1532,7 @@ BOOL RRInterface::clear (LLUUID object_uuid, std::string command)
                 LL_INFOS() << it->second << " => removed. " << LL_ENDL;
             }
             std::string tmp = it->second;
-            mSpecialObjectBehaviours.erase(it);
+            eraseBehaviour(it);
             refreshCachedVariable(tmp);
             it = mSpecialObjectBehaviours.begin ();
             // KKA-915 fire off RLVa style callback too
@@ -1614,7 +1579,7 @@ void RRInterface::replace (LLUUID what, LLUUID by)
         uuid.set (it->first);
         if (uuid == what) {
             // found the UUID to replace => add a copy of the command with the new UUID
-            mSpecialObjectBehaviours.insert(std::pair<std::string, std::string>(by.asString(), it->second));
+            insertBehaviour(by.asString(), it->second);
             //and feed it into the RLV status/worn floaters
             std::string notify = it->second + "=n";
             KokuaRLVFloaterSupport::commandNotify(by,notify);               
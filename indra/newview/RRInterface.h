@@ -84,6 +84,7 @@
 #include "llwearable.h"
 #include "llwearabletype.h"
 #include "rlveffects.h"
+#include "RRRestrictionIndex.h"
 
 #include "v3dmath.h"
 
@@ -370,6 +371,7 @@ public:
     std::deque<std::string> mAllowedSetDebug;
 
     // These should be private but we may want to browse them from the outside world, so let's keep them public
+    // Only insert into or erase from mSpecialObjectBehaviours with insertBehaviour() and eraseBehaviour(), which keep mRestrictionIndex in step
     RRMAP mSpecialObjectBehaviours;
     std::deque<Command> mRetainedCommands; // list of commands to execute later
     std::deque<std::string> mReceivedInventoryObjects; // list of inventory objects (items or folders) received during this session
@@ -417,6 +419,9 @@ private:
     std::string mLastLoadedPreset; // contains the name of the latest loaded Windlight preset
     int mLaunchTimestamp; // timestamp of the beginning of this session
     BOOL reallyHandleCommand (LLUUID uuid, std::string command);    // CA: the public handleCommand is now a veneer so that we can do debug output cleanly for all callers, not just chat handling
+    void insertBehaviour (const std::string& object_uuid, const std::string& behav);
+    void eraseBehaviour (RRMAP::iterator it);
+    RRRestrictionIndex mRestrictionIndex; // answers contains(), isAllowed() and the like without scanning mSpecialObjectBehaviours
 };
 
 
@@ -0,0 +1,232 @@
+/**
+ * @file RRRestrictionIndex.cpp
+ * @brief Index of the active RLV restrictions, kept alongside the
+ * restriction map so the common checks do not scan it.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "RRRestrictionIndex.h"
+
+#include "llstring.h"
+
+RRRestrictionIndex::RRRestrictionIndex() :
+    mSize(0)
+{
+}
+
+void RRRestrictionIndex::add(const std::string& object, const std::string& behaviour)
+{
+    id_t object_id = findObject(object);
+    if (object_id == NO_ID)
+    {
+        if (mFreeObjects.empty())
+        {
+            object_id = (id_t)mObjects.size();
+            mObjects.push_back(Object());
+        }
+        else
+        {
+            object_id = mFreeObjects.back();
+            mFreeObjects.pop_back();
+        }
+        mObjects[object_id].mKey = object;
+        mObjects[object_id].mCount = 0;
+        mObjectIds[object] = object_id;
+    }
+
+    id_t behaviour_id = findBehaviour(behaviour);
+    if (behaviour_id == NO_ID)
+    {
+        if (mFreeBehaviours.empty())
+        {
+            behaviour_id = (id_t)mBehaviours.size();
+            mBehaviours.push_back(Behaviour());
+        }
+        else
+        {
+            behaviour_id = mFreeBehaviours.back();
+            mFreeBehaviours.pop_back();
+        }
+        mBehaviours[behaviour_id].mName = behaviour;
+        mBehaviours[behaviour_id].mCount = 0;
+        mBehaviourIds[behaviour] = behaviour_id;
+        mSortedBehaviours.insert(behaviour);
+    }
+
+    Behaviour& behav = mBehaviours[behaviour_id];
+    size_t word = object_id / 64;
+    if (word >= behav.mHolders.size())
+    {
+        behav.mHolders.resize(word + 1, 0);
+    }
+    behav.mHolders[word] |= (U64)1 << (object_id % 64);
+    ++behav.mCount;
+    ++mObjects[object_id].mCount;
+    ++mEntries[pairKey(object_id, behaviour_id)];
+    ++mSize;
+}
+
+bool RRRestrictionIndex::remove(const std::string& object, const std::string& behaviour)
+{
+    id_t object_id = findObject(object);
+    id_t behaviour_id = findBehaviour(behaviour);
+    if (object_id == NO_ID || behaviour_id == NO_ID)
+    {
+        return false;
+    }
+    LLFlatHashMap<U64, U32>::iterator entry = mEntries.find(pairKey(object_id, behaviour_id));
+    if (entry == mEntries.end())
+    {
+        return false;
+    }
+
+    Behaviour& behav = mBehaviours[behaviour_id];
+    if (--entry->second == 0)
+    {
+        mEntries.erase(entry->first);
+        behav.mHolders[object_id / 64] &= ~((U64)1 << (object_id % 64));
+    }
+    if (--behav.mCount == 0)
+    {
+        mSortedBehaviours.erase(behav.mName);
+        mBehaviourIds.erase(behav.mName);
+        behav.mName.clear();
+        mFreeBehaviours.push_back(behaviour_id);
+    }
+    Object& obj = mObjects[object_id];
+    if (--obj.mCount == 0)
+    {
+        mObjectIds.erase(obj.mKey);
+        obj.mKey.clear();
+        mFreeObjects.push_back(object_id);
+    }
+    --mSize;
+    return true;
+}
+
+void RRRestrictionIndex::clear()
+{
+    mBehaviourIds.clear();
+    mObjectIds.clear();
+    mBehaviours.clear();
+    mObjects.clear();
+    mFreeBehaviours.clear();
+    mFreeObjects.clear();
+    mEntries.clear();
+    mSortedBehaviours.clear();
+    mSize = 0;
+}
+
+bool RRRestrictionIndex::contains(const std::string& behaviour) const
+{
+    return findBehaviour(behaviour) != NO_ID;
+}
+
+bool RRRestrictionIndex::containsPrefix(const std::string& prefix) const
+{
+    std::set<std::string>::const_iterator it = mSortedBehaviours.lower_bound(prefix);
+    return it != mSortedBehaviours.end() && it->compare(0, prefix.size(), prefix) == 0;
+}
+
+bool RRRestrictionIndex::objectHas(const std::string& object, const std::string& behaviour) const
+{
+    id_t behaviour_id = findBehaviour(behaviour);
+    return behaviour_id != NO_ID && holds(findObject(object), behaviour_id);
+}
+
+bool RRRestrictionIndex::containsWithoutException(const std::string& action, const std::string& except, bool permissive) const
+{
+    std::string action_sec = action + "_sec";
+    id_t action_id = findBehaviour(action);
+    id_t action_sec_id = findBehaviour(action_sec);
+    if (action_id == NO_ID && action_sec_id == NO_ID)
+    {
+        return false;
+    }
+    id_t except_id = findBehaviour(action + ":" + except);
+    id_t except_sec_id = findBehaviour(action_sec + ":" + except);
+
+    // An object holding the secure version (or any version under
+    // @permissive) is only lifted by exceptions from that same object
+    if (holderWithoutException(action_sec_id, except_id, except_sec_id) ||
+        (permissive && holderWithoutException(action_id, except_id, except_sec_id)))
+    {
+        return true;
+    }
+    if (action_id == NO_ID)
+    {
+        return false;
+    }
+
+    // Otherwise an exception from any object lifts the plain version. This
+    // check has always lowercased the exception, as contains() does.
+    std::string except_lower = except;
+    LLStringUtil::toLower(except_lower);
+    return !contains(action + ":" + except_lower) && !contains(action_sec + ":" + except_lower);
+}
+
+RRRestrictionIndex::id_t RRRestrictionIndex::findBehaviour(const std::string& behaviour) const
+{
+    LLFlatHashMap<std::string, id_t>::const_iterator it = mBehaviourIds.find(behaviour);
+    return it != mBehaviourIds.end() ? it->second : NO_ID;
+}
+
+RRRestrictionIndex::id_t RRRestrictionIndex::findObject(const std::string& object) const
+{
+    LLFlatHashMap<std::string, id_t>::const_iterator it = mObjectIds.find(object);
+    return it != mObjectIds.end() ? it->second : NO_ID;
+}
+
+bool RRRestrictionIndex::holds(id_t object, id_t behaviour) const
+{
+    if (object == NO_ID || behaviour == NO_ID)
+    {
+        return false;
+    }
+    const std::vector<U64>& holders = mBehaviours[behaviour].mHolders;
+    size_t word = object / 64;
+    return word < holders.size() && (holders[word] & ((U64)1 << (object % 64)));
+}
+
+bool RRRestrictionIndex::holderWithoutException(id_t behaviour, id_t except, id_t except_sec) const
+{
+    if (behaviour == NO_ID)
+    {
+        return false;
+    }
+    const std::vector<U64>& holders = mBehaviours[behaviour].mHolders;
+    for (size_t word = 0; word < holders.size(); ++word)
+    {
+        U64 bits = holders[word];
+        for (id_t object = (id_t)(word * 64); bits; bits >>= 1, ++object)
+        {
+            if ((bits & 1) && !holds(object, except) && !holds(object, except_sec))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,108 @@
+/**
+ * @file RRRestrictionIndex.h
+ * @brief Index of the active RLV restrictions, kept alongside the
+ * restriction map so the common checks do not scan it.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_RRRESTRICTIONINDEX_H
+#define LL_RRRESTRICTIONINDEX_H
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "llflathashmap.h"
+
+// Mirrors the (object, behaviour) entries of RRInterface::mSpecialObjectBehaviours.
+// Behaviours ("sendim", "sendim:<uuid>", "notify:2222;tp"...) and objects
+// are interned into small ids, recycled when their last entry goes. Each
+// behaviour keeps a bitset of the objects holding it, so "is it active",
+// "does this object hold it" and the exception checks are hash lookups and
+// bit tests instead of string compares over every entry.
+//
+// The map may hold the same entry more than once (replace() does not check
+// for duplicates), so entries are counted and the index only forgets one
+// when its count drops to zero.
+class RRRestrictionIndex
+{
+public:
+    RRRestrictionIndex();
+
+    void add(const std::string& object, const std::string& behaviour);
+    // Removes one occurrence, false if there was none
+    bool remove(const std::string& object, const std::string& behaviour);
+    void clear();
+
+    // Number of entries, counting duplicates
+    size_t size() const { return mSize; }
+
+    // Some object holds behaviour
+    bool contains(const std::string& behaviour) const;
+    // Some behaviour starts with prefix
+    bool containsPrefix(const std::string& prefix) const;
+    // object holds behaviour
+    bool objectHas(const std::string& object, const std::string& behaviour) const;
+    // See RRInterface::containsWithoutException(), except must not be empty
+    bool containsWithoutException(const std::string& action, const std::string& except, bool permissive) const;
+
+private:
+    typedef U32 id_t;
+    static const id_t NO_ID = (id_t)-1;
+
+    struct Behaviour
+    {
+        std::string mName;
+        U32 mCount;
+        // bit per object id
+        std::vector<U64> mHolders;
+    };
+
+    struct Object
+    {
+        std::string mKey;
+        U32 mCount;
+    };
+
+    id_t findBehaviour(const std::string& behaviour) const;
+    id_t findObject(const std::string& object) const;
+    bool holds(id_t object, id_t behaviour) const;
+    // True if some holder of behaviour has neither exception
+    bool holderWithoutException(id_t behaviour, id_t except, id_t except_sec) const;
+
+    static U64 pairKey(id_t object, id_t behaviour) { return ((U64)object << 32) | behaviour; }
+
+    LLFlatHashMap<std::string, id_t> mBehaviourIds;
+    LLFlatHashMap<std::string, id_t> mObjectIds;
+    std::vector<Behaviour> mBehaviours;
+    std::vector<Object> mObjects;
+    std::vector<id_t> mFreeBehaviours;
+    std::vector<id_t> mFreeObjects;
+    // occurrences of each (object, behaviour) entry
+    LLFlatHashMap<U64, U32> mEntries;
+    // active behaviours in order, for prefix queries
+    std::set<std::string> mSortedBehaviours;
+    size_t mSize;
+};
+
+#endif
@@ -82,6 +82,9 @@ const F32 MIN_DISTANCE_MOVED = 1.0f;
 // timeout to resend object properties request again
 const F32 REQUEST_TIMEOUT = 30.0f;
 
+// max number of rows built into the result list per frame
+const S32 MAX_ROWS_PER_UPDATE = 250;
+
 
 class FSAreaSearch::FSParcelChangeObserver : public LLParcelObserver
 {
@@ -103,6 +106,11 @@ private:
 FSAreaSearch::FSAreaSearch(const LLSD& key) :  
     LLFloater(key),
     mActive(false),
+    mRefresh(false),
+    mRequested(0),
+    mSearchableObjects(0),
+    mLastRegion(NULL),
+    mTextSearch(false),
     mFilterForSale(false),
     mFilterForSaleMin(0),
     mFilterForSaleMax(999999),
@@ -143,6 +151,9 @@ FSAreaSearch::FSAreaSearch(const LLSD& key) :
   
     // Register an idle update callback
     gIdleCallbacks.addFunction(idle, this);
+
+    mObjectAddedConnection = gObjectList.setObjectAddedCallback(boost::bind(&FSAreaSearch::onObjectAdded, this, _1));
+    mObjectRemovedConnection = gObjectList.setObjectRemovedCallback(boost::bind(&FSAreaSearch::onObjectRemoved, this, _1));
     
     mParcelChangedObserver = new FSParcelChangeObserver(this);
     LLViewerParcelMgr::getInstance()->addObserver(mParcelChangedObserver);
@@ -155,6 +166,9 @@ FSAreaSearch::~FSAreaSearch()
         LL_WARNS("FSAreaSearch") << "FSAreaSearch::~FSAreaSearch() failed to delete callback" << LL_ENDL;
     }
 
+    mObjectAddedConnection.disconnect();
+    mObjectRemovedConnection.disconnect();
+
     if (mParcelChangedObserver)
     {
         LLViewerParcelMgr::getInstance()->removeObserver(mParcelChangedObserver);
@@ -220,6 +234,7 @@ void FSAreaSearch::idle(void* user_data)
     FSAreaSearch* self = (FSAreaSearch*)user_data;
     self->findObjects();
     self->processRequestQueue();
+    self->addPendingRows();
 }
 
 // static
@@ -284,7 +299,7 @@ void FSAreaSearch::checkRegion()
             }
             mLastRegion = region;
             mRequested = 0;
-            mObjectDetails.clear();
+            clearObjectDetails();
             mRegionRequests.clear();
             mLastPropertiesReceivedTimer.start();
             mPanelList->getResultList()->deleteAllItems();
@@ -302,30 +317,95 @@ void FSAreaSearch::refreshList(bool cache_clear)
     if (cache_clear)
     {
         mRequested = 0;
-        mObjectDetails.clear();
+        clearObjectDetails();
         mRegionRequests.clear();
         mLastPropertiesReceivedTimer.start();
+        mRefresh = true;
     }
     else
     {
-        for (std::map<LLUUID, FSObjectProperties>::iterator object_it = mObjectDetails.begin();
+        for (object_details_map_t::iterator object_it = mObjectDetails.begin();
         object_it != mObjectDetails.end();
         ++object_it)
         {
              object_it->second.listed = false;
         }
+        mPendingRows.clear();
     }
     mPanelList->getResultList()->deleteAllItems();
     mPanelList->setCounterText();
     mPanelList->setAgentLastPosition(gAgent.getPositionGlobal());
-    mNamesRequested.clear();
-    mRefresh = true;
+
+    // A new search only needs the objects we already know about to be matched
+    // again, the object list is walked when the cache was cleared.
+    LLViewerRegion* our_region = gAgent.getRegion();
+    if (!mRefresh && our_region)
+    {
+        matchUnlisted(our_region);
+        updateCounterText();
+    }
     findObjects();
 }
 
+void FSAreaSearch::clearObjectDetails()
+{
+    mObjectDetails.clear();
+    mIndex.clear();
+    mTextMatches.clear();
+    mNameWaiters.clear();
+    mCreatedObjects.clear();
+    mExcludedObjects.clear();
+    mPendingRows.clear();
+    mSearchableObjects = 0;
+}
+
+void FSAreaSearch::onObjectAdded(LLViewerObject* objectp)
+{
+    // Registered on the next update, once the object is linked and placed.
+    if (mActive)
+    {
+        mCreatedObjects.push_back(objectp->getID());
+    }
+}
+
+void FSAreaSearch::onObjectRemoved(LLViewerObject* objectp)
+{
+    if (!mActive)
+    {
+        return;
+    }
+
+    mExcludedObjects.erase(objectp->getID());
+    object_details_map_t::iterator object_it = mObjectDetails.find(objectp->getID());
+    if (object_it == mObjectDetails.end())
+    {
+        return;
+    }
+
+    // The row itself goes in updateScrollList(), the details are kept in case
+    // the object comes back into view.
+    FSObjectProperties& details = object_it->second;
+    if (details.searchable)
+    {
+        details.searchable = false;
+        mSearchableObjects--;
+    }
+
+    // requests for non-existent objects will never arrive
+    if (details.request == FSObjectProperties::NEED || details.request == FSObjectProperties::SENT)
+    {
+        details.request = FSObjectProperties::FAILED;
+        if (mRequested > 0)
+        {
+            mRequested--;
+        }
+    }
+}
+
 void FSAreaSearch::findObjects()
 {
-    // Only loop through the gObjectList every so often. There is a performance hit if done too often.
+    // Only loop through the gObjectList when asked to, there is a performance hit if done too often.
+    // Objects created since are reported by gObjectList and picked up every so often.
     if (!(mActive && ((mRefresh && mLastUpdateTimer.getElapsedTimeF32() > MIN_REFRESH_INTERVAL) || mLastUpdateTimer.getElapsedTimeF32() > REFRESH_INTERVAL)))
     {
         return;
@@ -344,90 +424,173 @@ void FSAreaSearch::findObjects()
     // Pause processing of requestqueue until done adding new requests.
     mRequestQueuePause = true;
     checkRegion();
-    mRefresh = false;
-    mSearchableObjects = 0;
-    S32 object_count = gObjectList.getNumObjects();
 
-    for (S32 i = 0; i < object_count; i++)
+    if (mRefresh)
     {
-        LLViewerObject *objectp = gObjectList.getObject(i);
-        if (!(objectp && isSearchableObject(objectp, our_region)))
+        mRefresh = false;
+        mCreatedObjects.clear();
+        mExcludedObjects.clear();
+        mSearchableObjects = 0;
+        for (object_details_map_t::iterator object_it = mObjectDetails.begin();
+            object_it != mObjectDetails.end();
+            ++object_it)
         {
-            continue;
+            object_it->second.searchable = false;
         }
 
-        LLUUID object_id = objectp->getID();
+        S32 object_count = gObjectList.getNumObjects();
+        for (S32 i = 0; i < object_count; i++)
+        {
+            LLViewerObject *objectp = gObjectList.getObject(i);
+            if (objectp && !objectp->isDead())
+            {
+                registerObject(objectp, our_region);
+            }
+        }
+    }
+    else
+    {
+        for (uuid_vec_t::const_iterator id_it = mCreatedObjects.begin(); id_it != mCreatedObjects.end(); ++id_it)
+        {
+            LLViewerObject* objectp = gObjectList.findObject(*id_it);
+            if (objectp && !objectp->isDead())
+            {
+                registerObject(objectp, our_region);
+            }
+        }
+        mCreatedObjects.clear();
 
-        if (object_id.isNull())
+        // Objects stop being excluded as their flags, links and regions change.
+        recheckExcluded(our_region);
+
+        // Filters such as distance and parcel change as objects and the agent move.
+        matchUnlisted(our_region);
+    }
+
+    mPanelList->updateScrollList();
+
+    updateCounterText();
+    mLastUpdateTimer.start(); // start also reset elapsed time to zero
+    mRequestQueuePause = false;
+}
+
+void FSAreaSearch::registerObject(LLViewerObject* objectp, LLViewerRegion* our_region)
+{
+    LLUUID object_id = objectp->getID();
+
+    if (!isSearchableObject(objectp, our_region))
+    {
+        // land and avatars never become searchable
+        if (!objectp->isAvatar() && objectp->getPCode() != LLViewerObject::LL_VO_SURFACE_PATCH)
         {
-            LL_WARNS("FSAreaSearch") << "WTF?! Selectable object with id of NULL!!" << LL_ENDL;
-            continue;
+            mExcludedObjects.insert(object_id);
         }
+        return;
+    }
+    mExcludedObjects.erase(object_id);
+
+    if (object_id.isNull())
+    {
+        LL_WARNS("FSAreaSearch") << "WTF?! Selectable object with id of NULL!!" << LL_ENDL;
+        return;
+    }
 
+    bool known = mObjectDetails.count(object_id) != 0;
+    FSObjectProperties& details = mObjectDetails[object_id];
+    if (!details.searchable)
+    {
+        details.searchable = true;
         mSearchableObjects++;
-        
-        if (mObjectDetails.count(object_id) == 0)
+    }
+
+    if (!known)
+    {
+        details.id = object_id;
+        details.local_id = objectp->getLocalID();
+        details.region_handle = objectp->getRegion()->getHandle();
+        mRequestNeedsSent = true;
+        mRequested++;
+    }
+    else
+    {
+        if (details.request == FSObjectProperties::FINISHED)
+        {
+            matchObject(details, objectp);
+        }
+
+        if (details.request == FSObjectProperties::FAILED)
         {
-            FSObjectProperties& details = mObjectDetails[object_id];
-            details.id = object_id;
+            // object came back into view
+            details.request = FSObjectProperties::NEED;
             details.local_id = objectp->getLocalID();
             details.region_handle = objectp->getRegion()->getHandle();
             mRequestNeedsSent = true;
             mRequested++;
         }
-        else
-        {
-            FSObjectProperties& details = mObjectDetails[object_id];
-            if (details.request == FSObjectProperties::FINISHED)
-            {
-                matchObject(details, objectp);
-            }
+    }
+}
 
-            if (details.request == FSObjectProperties::FAILED)
+void FSAreaSearch::matchUnlisted(LLViewerRegion* our_region)
+{
+    // With search text only its matches can make it to the list.
+    uuid_vec_t candidates;
+    if (mTextSearch)
+    {
+        candidates.assign(mTextMatches.begin(), mTextMatches.end());
+    }
+    else
+    {
+        candidates.reserve(mObjectDetails.size());
+        for (object_details_map_t::iterator object_it = mObjectDetails.begin();
+            object_it != mObjectDetails.end();
+            ++object_it)
+        {
+            if (object_it->second.searchable && !object_it->second.listed)
             {
-                // object came back into view
-                details.request = FSObjectProperties::NEED;
-                details.local_id = objectp->getLocalID();
-                details.region_handle = objectp->getRegion()->getHandle();
-                mRequestNeedsSent = true;
-                mRequested++;
+                candidates.push_back(object_it->first);
             }
         }
     }
 
-    mPanelList->updateScrollList();
-
-    S32 request_count = 0;
-    // requests for non-existent objects will never arrive, check and update the queue.
-    for (std::map<LLUUID, FSObjectProperties>::iterator object_it = mObjectDetails.begin();
-        object_it != mObjectDetails.end();
-        ++object_it)
+    for (uuid_vec_t::const_iterator id_it = candidates.begin(); id_it != candidates.end(); ++id_it)
     {
-        if (object_it->second.request == FSObjectProperties::NEED || object_it->second.request == FSObjectProperties::SENT)
+        object_details_map_t::iterator object_it = mObjectDetails.find(*id_it);
+        if (object_it == mObjectDetails.end())
         {
-            LLUUID id = object_it->second.id;
-            LLViewerObject* objectp = gObjectList.findObject(id);
-            if (!objectp)
-            {
-                object_it->second.request = FSObjectProperties::FAILED;
-                mRequested--;
-            }
-            else
-            {
-                request_count++;
-            }
+            continue;
+        }
+        FSObjectProperties& details = object_it->second;
+        if (details.listed || !details.searchable || details.request != FSObjectProperties::FINISHED)
+        {
+            continue;
+        }
+        LLViewerObject* objectp = gObjectList.findObject(*id_it);
+        if (objectp && isSearchableObject(objectp, our_region))
+        {
+            matchObject(details, objectp);
         }
     }
-    
-    if (mRequested != request_count)
+}
+
+void FSAreaSearch::recheckExcluded(LLViewerRegion* our_region)
+{
+    for (uuid_set_t::iterator id_it = mExcludedObjects.begin(); id_it != mExcludedObjects.end(); )
     {
-        LL_DEBUGS("FSAreaSearch") << "Requested mismatch: " << request_count << " actual vs. " << mRequested << LL_ENDL;
-        mRequested = request_count;
+        LLViewerObject* objectp = gObjectList.findObject(*id_it);
+        if (!objectp || objectp->isDead())
+        {
+            id_it = mExcludedObjects.erase(id_it);
+        }
+        else if (isSearchableObject(objectp, our_region))
+        {
+            id_it = mExcludedObjects.erase(id_it);
+            registerObject(objectp, our_region);
+        }
+        else
+        {
+            ++id_it;
+        }
     }
-
-    updateCounterText();
-    mLastUpdateTimer.start(); // start also reset elapsed time to zero
-    mRequestQueuePause = false;
 }
 
 bool FSAreaSearch::isSearchableObject(LLViewerObject* objectp, LLViewerRegion* our_region)
@@ -502,7 +665,7 @@ void FSAreaSearch::processRequestQueue()
         LL_DEBUGS("FSAreaSearch") << "Timeout reached, resending requests."<< LL_ENDL;
         S32 request_count = 0;
         S32 failed_count = 0;
-        for (std::map<LLUUID, FSObjectProperties>::iterator object_it = mObjectDetails.begin();
+        for (object_details_map_t::iterator object_it = mObjectDetails.begin();
               object_it != mObjectDetails.end();
               ++object_it)
         {
@@ -554,7 +717,7 @@ void FSAreaSearch::processRequestQueue()
         std::vector<U32> request_list;
         bool need_continue = false;
     
-        for (std::map<LLUUID, FSObjectProperties>::iterator object_it = mObjectDetails.begin();
+        for (object_details_map_t::iterator object_it = mObjectDetails.begin();
             object_it != mObjectDetails.end();
             ++object_it)
         {
@@ -725,6 +888,11 @@ void FSAreaSearch::processObjectProperties(LLMessageSystem* msg)
 
             // Sets the group owned BOOL and real owner id, group or owner depending if object is group owned.
             details.permissions.getOwnership(details.ownership_id, details.group_owned);
+
+            mIndex.setField(object_id, FSAreaSearchIndex::FIELD_NAME, details.name);
+            mIndex.setField(object_id, FSAreaSearchIndex::FIELD_DESCRIPTION, details.description);
+            resolveNames(details);
+            updateTextMatch(object_id);
             
             LL_DEBUGS("FSAreaSearch_spammy") << "Got properties for object: " << object_id << LL_ENDL;
 
@@ -878,99 +1046,59 @@ void FSAreaSearch::matchObject(FSObjectProperties& details, LLViewerObject* obje
     // Find text
     //-----------------------------------------------------------------------
 
-    LLUUID object_id = details.id;
-    std::string creator_name;
-    std::string owner_name;
-    std::string last_owner_name;
-    std::string group_name;
-    std::string object_name = details.name;
-    std::string object_description = details.description;
+    if (mTextSearch && mTextMatches.find(details.id) == mTextMatches.end())
+    {
+        return;
+    }
 
-    details.name_requested = false;
-    getNameFromUUID(details.ownership_id, owner_name, details.group_owned, details.name_requested);
-    getNameFromUUID(details.creator_id, creator_name, false, details.name_requested);
-    getNameFromUUID(details.last_owner_id, last_owner_name, false, details.name_requested);
-    getNameFromUUID(details.group_id, group_name, true, details.name_requested);
+    //-----------------------------------------------------------------------
+    // Object passed all above tests, queue it for the List tab.
+    //-----------------------------------------------------------------------
+    
+    details.listed = true;
+    mPendingRows.push_back(details.id);
+}
 
-    if (mRegexSearch)
+void FSAreaSearch::addPendingRows()
+{
+    if (!mActive || mPendingRows.empty())
     {
-        try
-        {
-            if (!mSearchName.empty() && !boost::regex_match(object_name, mRegexSearchName))
-            {
-                return;
-            }
-            if (!mSearchDescription.empty() && !boost::regex_match(object_description, mRegexSearchDescription))
-            {
-                return;
-            }
-            if (!mSearchOwner.empty() && !boost::regex_match(owner_name, mRegexSearchOwner))
-            {
-                return;
-            }
-            if (!mSearchGroup.empty() && !boost::regex_match(group_name, mRegexSearchGroup))
-            {
-                return;
-            }
-            if (!mSearchCreator.empty() && !boost::regex_match(creator_name, mRegexSearchCreator))
-            {
-                return;
-            }
-            if (!mSearchLastOwner.empty() && !boost::regex_match(last_owner_name, mRegexSearchLastOwner))
-            {
-                return;
-            }
-        }
+        return;
+    }
 
-        // Should not end up here due to error checking in Find class. However, some complex regexes may
-        // cause excessive resources and boost will throw an execption.
-        // Due to the possiablitey of hitting this block a 1000 times per second, only logonce it.
-        catch(boost::regex_error& e)
-        {
-            LL_WARNS_ONCE("FSAreaSearch") << "boost::regex_error error in regex: "<< e.what() << LL_ENDL;
-        }
-        catch(const std::exception& e)
+    // Rows are built a batch per frame, so a search matching a whole sim does not stall the viewer.
+    S32 added = 0;
+    while (!mPendingRows.empty() && added < MAX_ROWS_PER_UPDATE)
+    {
+        LLUUID object_id = mPendingRows.front();
+        mPendingRows.pop_front();
+
+        object_details_map_t::iterator object_it = mObjectDetails.find(object_id);
+        if (object_it == mObjectDetails.end() || !object_it->second.listed)
         {
-            LL_WARNS_ONCE("FSAreaSearch") << "std::exception error in regex: "<< e.what() << LL_ENDL;
+            continue;
         }
-        catch (...)
+        LLViewerObject* objectp = gObjectList.findObject(object_id);
+        if (!objectp || objectp->isDead())
         {
-            LL_WARNS_ONCE("FSAreaSearch") << "Unknown error in regex" << LL_ENDL;
+            object_it->second.listed = false;
+            continue;
         }
+        addRow(object_it->second, objectp);
+        added++;
     }
-    else
+
+    if (added > 0)
     {
-        if (!mSearchName.empty() && boost::ifind_first(object_name, mSearchName).empty())
-        {
-            return;
-        }
-        if (!mSearchDescription.empty() && boost::ifind_first(object_description, mSearchDescription).empty())
-        {
-            return;
-        }
-        if (!mSearchOwner.empty() && boost::ifind_first(owner_name, mSearchOwner).empty())
-        {
-            return;
-        }
-        if (!mSearchGroup.empty() && boost::ifind_first(group_name, mSearchGroup).empty())
-        {
-            return;
-        }
-        if (!mSearchCreator.empty() && boost::ifind_first(creator_name, mSearchCreator).empty())
-        {
-            return;
-        }
-        if (!mSearchLastOwner.empty() && boost::ifind_first(last_owner_name, mSearchLastOwner).empty())
-        {
-            return;
-        }
+        mPanelList->getResultList()->refreshLineHeight();
+        updateCounterText();
     }
+}
 
-    //-----------------------------------------------------------------------
-    // Object passed all above tests, add it to the List tab.
-    //-----------------------------------------------------------------------
-    
-    details.listed = true;
+void FSAreaSearch::addRow(const FSObjectProperties& details, LLViewerObject* objectp)
+{
+    const LLUUID& object_id = details.id;
+    const std::string& owner_name = mIndex.getField(object_id, FSAreaSearchIndex::FIELD_OWNER);
 
     LLScrollListCell::Params cell_params;
     cell_params.font = LLFontGL::getFontSansSerif();
@@ -1030,15 +1158,15 @@ void FSAreaSearch::matchObject(FSObjectProperties& details, LLViewerObject* obje
     row_params.columns.add(cell_params);
 
     cell_params.column = "group";
-    cell_params.value = group_name;
+    cell_params.value = mIndex.getField(object_id, FSAreaSearchIndex::FIELD_GROUP);
     row_params.columns.add(cell_params);
 
     cell_params.column = "creator";
-    cell_params.value = creator_name;
+    cell_params.value = mIndex.getField(object_id, FSAreaSearchIndex::FIELD_CREATOR);
     row_params.columns.add(cell_params);
 
     cell_params.column = "last_owner";
-    cell_params.value = last_owner_name;
+    cell_params.value = mIndex.getField(object_id, FSAreaSearchIndex::FIELD_LAST_OWNER);
     row_params.columns.add(cell_params);
     
     LLScrollListItem* list_row = mPanelList->getResultList()->addRow(row_params);
@@ -1062,8 +1190,6 @@ void FSAreaSearch::matchObject(FSObjectProperties& details, LLViewerObject* obje
             list_cell->setFontStyle(font_style);
         }
     }
-
-    mPanelList->getResultList()->refreshLineHeight();
 }
 
 // <FS:Cron> Allows the object costs to be updated on-the-fly so as to bypass the problem with the data being stale when first accessed.
@@ -1093,36 +1219,89 @@ void FSAreaSearch::updateObjectCosts(const LLUUID& object_id, F32 object_cost, F
     
 }
 
-void FSAreaSearch::getNameFromUUID(LLUUID& id, std::string& name, BOOL group, bool& name_requested)
+void FSAreaSearch::resolveNames(FSObjectProperties& details)
 {
+    details.name_requested = false;
+    resolveName(details, details.ownership_id, details.group_owned, FSAreaSearchIndex::FIELD_OWNER);
+    resolveName(details, details.creator_id, false, FSAreaSearchIndex::FIELD_CREATOR);
+    resolveName(details, details.last_owner_id, false, FSAreaSearchIndex::FIELD_LAST_OWNER);
+    resolveName(details, details.group_id, true, FSAreaSearchIndex::FIELD_GROUP);
+}
+
+void FSAreaSearch::resolveName(FSObjectProperties& details, const LLUUID& id, BOOL group, FSAreaSearchIndex::EField field)
+{
+    std::string name;
     BOOL is_group;
     
-    if(!gCacheName->getIfThere(id, name, is_group))
+    if (gCacheName->getIfThere(id, name, is_group))
     {
-        if(std::find(mNamesRequested.begin(), mNamesRequested.end(), id) == mNamesRequested.end())
+        mIndex.setField(details.id, field, name);
+        return;
+    }
+
+    details.name_requested = true;
+    typedef std::multimap<LLUUID, LLUUID>::iterator waiter_it_t;
+    std::pair<waiter_it_t, waiter_it_t> waiters = mNameWaiters.equal_range(id);
+    if (waiters.first == waiters.second)
+    {
+        gCacheName->get(id, group, boost::bind(&FSAreaSearch::callbackLoadFullName, this, _1, _2));
+    }
+    for (waiter_it_t waiter_it = waiters.first; waiter_it != waiters.second; ++waiter_it)
+    {
+        if (waiter_it->second == details.id)
         {
-            mNamesRequested.push_back(id);
-            gCacheName->get(id, group, boost::bind(&FSAreaSearch::callbackLoadFullName, this, _1, _2));
+            return;
         }
-        name_requested = true;
     }
+    mNameWaiters.insert(std::make_pair(id, details.id));
 }
 
 void FSAreaSearch::callbackLoadFullName(const LLUUID& id, const std::string& full_name)
 {
     LLViewerRegion* our_region = gAgent.getRegion();
-    
-    for (std::map<LLUUID, FSObjectProperties>::iterator object_it = mObjectDetails.begin();
-        object_it != mObjectDetails.end();
-        ++object_it)
+
+    // Only the objects waiting for this name need to be looked at again.
+    typedef std::multimap<LLUUID, LLUUID>::iterator waiter_it_t;
+    std::pair<waiter_it_t, waiter_it_t> waiters = mNameWaiters.equal_range(id);
+    uuid_vec_t object_ids;
+    for (waiter_it_t waiter_it = waiters.first; waiter_it != waiters.second; ++waiter_it)
+    {
+        object_ids.push_back(waiter_it->second);
+    }
+    mNameWaiters.erase(waiters.first, waiters.second);
+
+    for (uuid_vec_t::const_iterator id_it = object_ids.begin(); id_it != object_ids.end(); ++id_it)
     {
-        if (object_it->second.name_requested && !object_it->second.listed)
+        object_details_map_t::iterator object_it = mObjectDetails.find(*id_it);
+        if (object_it == mObjectDetails.end())
         {
-            LLUUID object_id = object_it->second.id;
-            LLViewerObject* objectp = gObjectList.findObject(object_id);
+            continue;
+        }
+        FSObjectProperties& details = object_it->second;
+        if (id == details.ownership_id)
+        {
+            mIndex.setField(details.id, FSAreaSearchIndex::FIELD_OWNER, full_name);
+        }
+        if (id == details.creator_id)
+        {
+            mIndex.setField(details.id, FSAreaSearchIndex::FIELD_CREATOR, full_name);
+        }
+        if (id == details.last_owner_id)
+        {
+            mIndex.setField(details.id, FSAreaSearchIndex::FIELD_LAST_OWNER, full_name);
+        }
+        if (id == details.group_id)
+        {
+            mIndex.setField(details.id, FSAreaSearchIndex::FIELD_GROUP, full_name);
+        }
+        updateTextMatch(details.id);
+
+        if (our_region && !details.listed)
+        {
+            LLViewerObject* objectp = gObjectList.findObject(details.id);
             if (objectp && isSearchableObject(objectp, our_region))
             {
-                matchObject(object_it->second, objectp);
+                matchObject(details, objectp);
             }
         }
     }
@@ -1130,6 +1309,120 @@ void FSAreaSearch::callbackLoadFullName(const LLUUID& id, const std::string& ful
     mPanelList->updateName(id, full_name);
 }
 
+void FSAreaSearch::updateTextMatches()
+{
+    mTextMatches.clear();
+    mTextSearch = !(mSearchName.empty() && mSearchDescription.empty() && mSearchOwner.empty() &&
+                    mSearchGroup.empty() && mSearchCreator.empty() && mSearchLastOwner.empty());
+    if (!mTextSearch)
+    {
+        return;
+    }
+
+    // A substring search only has to check the objects the index finds for one of the fields,
+    // a regex has to be tried on every object.
+    uuid_vec_t candidates;
+    if (mRegexSearch)
+    {
+        mIndex.getAll(candidates);
+    }
+    else if (!mSearchName.empty())
+    {
+        mIndex.find(FSAreaSearchIndex::FIELD_NAME, mSearchName, candidates);
+    }
+    else if (!mSearchDescription.empty())
+    {
+        mIndex.find(FSAreaSearchIndex::FIELD_DESCRIPTION, mSearchDescription, candidates);
+    }
+    else if (!mSearchOwner.empty())
+    {
+        mIndex.find(FSAreaSearchIndex::FIELD_OWNER, mSearchOwner, candidates);
+    }
+    else if (!mSearchGroup.empty())
+    {
+        mIndex.find(FSAreaSearchIndex::FIELD_GROUP, mSearchGroup, candidates);
+    }
+    else if (!mSearchCreator.empty())
+    {
+        mIndex.find(FSAreaSearchIndex::FIELD_CREATOR, mSearchCreator, candidates);
+    }
+    else
+    {
+        mIndex.find(FSAreaSearchIndex::FIELD_LAST_OWNER, mSearchLastOwner, candidates);
+    }
+
+    for (uuid_vec_t::const_iterator id_it = candidates.begin(); id_it != candidates.end(); ++id_it)
+    {
+        if (matchText(*id_it))
+        {
+            mTextMatches.insert(*id_it);
+        }
+    }
+}
+
+void FSAreaSearch::updateTextMatch(const LLUUID& id)
+{
+    if (!mTextSearch)
+    {
+        return;
+    }
+
+    if (matchText(id))
+    {
+        mTextMatches.insert(id);
+    }
+    else
+    {
+        mTextMatches.erase(id);
+    }
+}
+
+bool FSAreaSearch::matchText(const LLUUID& id)
+{
+    return matchField(id, FSAreaSearchIndex::FIELD_NAME, mSearchName, mRegexSearchName) &&
+           matchField(id, FSAreaSearchIndex::FIELD_DESCRIPTION, mSearchDescription, mRegexSearchDescription) &&
+           matchField(id, FSAreaSearchIndex::FIELD_OWNER, mSearchOwner, mRegexSearchOwner) &&
+           matchField(id, FSAreaSearchIndex::FIELD_GROUP, mSearchGroup, mRegexSearchGroup) &&
+           matchField(id, FSAreaSearchIndex::FIELD_CREATOR, mSearchCreator, mRegexSearchCreator) &&
+           matchField(id, FSAreaSearchIndex::FIELD_LAST_OWNER, mSearchLastOwner, mRegexSearchLastOwner);
+}
+
+bool FSAreaSearch::matchField(const LLUUID& id, FSAreaSearchIndex::EField field, const std::string& search, const boost::regex& regex)
+{
+    if (search.empty())
+    {
+        return true;
+    }
+
+    if (!mRegexSearch)
+    {
+        return mIndex.contains(id, field, search);
+    }
+
+    try
+    {
+        return boost::regex_match(mIndex.getField(id, field), regex);
+    }
+
+    // Should not end up here due to error checking in Find class. However, some complex regexes may
+    // cause excessive resources and boost will throw an execption.
+    // Due to the possiablitey of hitting this block a 1000 times per second, only logonce it.
+    catch(boost::regex_error& e)
+    {
+        LL_WARNS_ONCE("FSAreaSearch") << "boost::regex_error error in regex: "<< e.what() << LL_ENDL;
+    }
+    catch(const std::exception& e)
+    {
+        LL_WARNS_ONCE("FSAreaSearch") << "std::exception error in regex: "<< e.what() << LL_ENDL;
+    }
+    catch (...)
+    {
+        LL_WARNS_ONCE("FSAreaSearch") << "Unknown error in regex" << LL_ENDL;
+    }
+    // as before, an object is not filtered out by a regex that fails
+    return true;
+}
+
 void FSAreaSearch::updateCounterText()
 {
     LLStringUtil::format_map_t args;
@@ -1223,6 +1516,8 @@ void FSAreaSearch::onCommitLine()
             }
         }
     }
+
+    updateTextMatches();
 }
 
 bool FSAreaSearch::regexTest(std::string text)
@@ -1274,6 +1569,7 @@ void FSAreaSearch::clearSearchText()
     mSearchGroup.erase();
     mSearchCreator.erase();
     mSearchLastOwner.erase();
+    updateTextMatches();
 }
 
 void FSAreaSearch::onButtonClickedSearch()
@@ -1294,6 +1590,10 @@ void FSAreaSearch::onCommitCheckboxRegex()
     {
         onCommitLine();
     }
+    else
+    {
+        updateTextMatches();
+    }
 }
 
 
@@ -35,7 +35,10 @@
 #include "llpermissions.h"
 #include "llviewerobject.h"
 #include <boost/regex.hpp>
+#include <boost/unordered_map.hpp>
+#include <deque>
 #include "llscrolllistcolumn.h"
+#include "fsareasearchindex.h"
 
 class LLTextBox;
 class LLViewerRegion;
@@ -57,6 +60,7 @@ struct FSObjectProperties
 {
     LLUUID id;
     bool listed;
+    bool searchable;
     std::string name;
     std::string description;
     std::string touch_name;
@@ -92,6 +96,7 @@ struct FSObjectProperties
     FSObjectProperties() :
         request(NEED),
         listed(false),
+        searchable(false),
         name_requested(false)
     {
     }
@@ -125,7 +130,8 @@ public:
     void onCommitCheckboxRegex();
     bool isSearchableObject (LLViewerObject* objectp, LLViewerRegion* our_region);
     
-    std::map<LLUUID, FSObjectProperties> mObjectDetails;
+    typedef boost::unordered_map<LLUUID, FSObjectProperties> object_details_map_t;
+    object_details_map_t mObjectDetails;
 
     FSPanelAreaSearchAdvanced* getPanelAdvanced() { return mPanelAdvanced; }
     FSPanelAreaSearchList* getPanelList() { return mPanelList; }
@@ -141,11 +147,13 @@ public:
     void setRegexSearch(bool b) { mRegexSearch = b; }
     void setBeacons(bool b) { mBeacons = b; }
     
-    void setExcludeAttachment(bool b) { mExcludeAttachment = b; }
-    void setExcludetemporary(bool b) { mExcludeTemporary = b; }
-    void setExcludePhysics(bool b) { mExcludePhysics = b; }
+    // Excluded objects are never registered, so changing what is excluded
+    // needs a walk of the object list
+    void setExcludeAttachment(bool b) { mRefresh |= (mExcludeAttachment != b); mExcludeAttachment = b; }
+    void setExcludetemporary(bool b) { mRefresh |= (mExcludeTemporary != b); mExcludeTemporary = b; }
+    void setExcludePhysics(bool b) { mRefresh |= (mExcludePhysics != b); mExcludePhysics = b; }
     void setExcludeChildPrims(bool b) { mExcludeChildPrims = b; }
-    void setExcludeNeighborRegions(bool b) { mExcludeNeighborRegions = b; }
+    void setExcludeNeighborRegions(bool b) { mRefresh |= (mExcludeNeighborRegions != b); mExcludeNeighborRegions = b; }
     
     void setFilterForSaleMin(S32 s) { mFilterForSaleMin = s; }
     void setFilterForSaleMax(S32 s) { mFilterForSaleMax = s; }
@@ -168,7 +176,23 @@ public:
 private:
     void requestObjectProperties(const std::vector< U32 >& request_list, bool select, LLViewerRegion* regionp);
     void matchObject(FSObjectProperties& details, LLViewerObject* objectp);
-    void getNameFromUUID(LLUUID& id, std::string& name, BOOL group, bool& name_requested);
+    void addRow(const FSObjectProperties& details, LLViewerObject* objectp);
+    void addPendingRows();
+    void resolveNames(FSObjectProperties& details);
+    void resolveName(FSObjectProperties& details, const LLUUID& id, BOOL group, FSAreaSearchIndex::EField field);
+
+    // Text search, answered from mIndex
+    void updateTextMatches();
+    void updateTextMatch(const LLUUID& id);
+    bool matchText(const LLUUID& id);
+    bool matchField(const LLUUID& id, FSAreaSearchIndex::EField field, const std::string& search, const boost::regex& regex);
+
+    void onObjectAdded(LLViewerObject* objectp);
+    void onObjectRemoved(LLViewerObject* objectp);
+    void registerObject(LLViewerObject* objectp, LLViewerRegion* our_region);
+    void matchUnlisted(LLViewerRegion* our_region);
+    void recheckExcluded(LLViewerRegion* our_region);
+    void clearObjectDetails();
 
     void updateCounterText();
     bool regexTest(std::string text);
@@ -201,7 +225,22 @@ private:
     LLFrameTimer mLastUpdateTimer;
     LLFrameTimer mLastPropertiesReceivedTimer;
 
-    uuid_vec_t mNamesRequested;
+    // Searchable text of every object in mObjectDetails
+    FSAreaSearchIndex mIndex;
+    // Objects matching the search text, if there is any
+    bool mTextSearch;
+    uuid_set_t mTextMatches;
+    // Objects waiting for each name being looked up
+    std::multimap<LLUUID, LLUUID> mNameWaiters;
+    // Objects created since the last update
+    uuid_vec_t mCreatedObjects;
+    // Objects left out by the excludes, checked again every update
+    uuid_set_t mExcludedObjects;
+    // Matched objects whose rows have not been built yet
+    std::deque<LLUUID> mPendingRows;
+
+    boost::signals2::connection mObjectAddedConnection;
+    boost::signals2::connection mObjectRemovedConnection;
 
     LLViewerRegion* mLastRegion;
     
@@ -0,0 +1,225 @@
+/**
+ * @file fsareasearchindex.cpp
+ * @brief Text of the searchable fields of the objects known to area search,
+ * indexed so that a change of search text does not rescan every object.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "fsareasearchindex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <boost/algorithm/string/find.hpp> //for boost::ifind_first
+
+namespace
+{
+    const std::string EMPTY_FIELD;
+}
+
+void FSAreaSearchIndex::setField(const LLUUID& id, EField field, const std::string& text)
+{
+    U32 slot;
+    LLFlatHashMap<LLUUID, U32>::iterator it = mSlots.find(id);
+    if (it != mSlots.end())
+    {
+        slot = it->second;
+        if (mEntries[slot].mFields[field] == text)
+        {
+            return;
+        }
+        removePostings(slot, field);
+    }
+    else
+    {
+        if (mFreeSlots.empty())
+        {
+            slot = (U32)mEntries.size();
+            mEntries.push_back(Entry());
+        }
+        else
+        {
+            slot = mFreeSlots.back();
+            mFreeSlots.pop_back();
+        }
+        mEntries[slot].mID = id;
+        mSlots[id] = slot;
+    }
+    mEntries[slot].mFields[field] = text;
+    addPostings(slot, field);
+}
+
+const std::string& FSAreaSearchIndex::getField(const LLUUID& id, EField field) const
+{
+    LLFlatHashMap<LLUUID, U32>::const_iterator it = mSlots.find(id);
+    return it != mSlots.end() ? mEntries[it->second].mFields[field] : EMPTY_FIELD;
+}
+
+void FSAreaSearchIndex::remove(const LLUUID& id)
+{
+    LLFlatHashMap<LLUUID, U32>::iterator it = mSlots.find(id);
+    if (it == mSlots.end())
+    {
+        return;
+    }
+    U32 slot = it->second;
+    mSlots.erase(id);
+    Entry& entry = mEntries[slot];
+    for (S32 field = 0; field < FIELD_COUNT; ++field)
+    {
+        removePostings(slot, (EField)field);
+        entry.mFields[field].clear();
+    }
+    entry.mID.setNull();
+    mFreeSlots.push_back(slot);
+}
+
+void FSAreaSearchIndex::clear()
+{
+    mSlots.clear();
+    mEntries.clear();
+    mFreeSlots.clear();
+    for (S32 field = 0; field < FIELD_COUNT; ++field)
+    {
+        mPostings[field].clear();
+    }
+}
+
+void FSAreaSearchIndex::find(EField field, const std::string& text, uuid_vec_t& ids) const
+{
+    std::vector<U32> trigrams;
+    getTrigrams(text, trigrams);
+    if (trigrams.empty())
+    {
+        // too short to have a trigram, check everything
+        for (LLFlatHashMap<LLUUID, U32>::const_iterator it = mSlots.begin(); it != mSlots.end(); ++it)
+        {
+            if (containsIgnoreCase(mEntries[it->second].mFields[field], text))
+            {
+                ids.push_back(it->first);
+            }
+        }
+        return;
+    }
+
+    const std::vector<U32>* rarest = NULL;
+    for (size_t i = 0; i < trigrams.size(); ++i)
+    {
+        postings_t::const_iterator it = mPostings[field].find(trigrams[i]);
+        if (it == mPostings[field].end())
+        {
+            return;
+        }
+        if (!rarest || it->second.size() < rarest->size())
+        {
+            rarest = &it->second;
+        }
+    }
+    for (size_t i = 0; i < rarest->size(); ++i)
+    {
+        const Entry& entry = mEntries[(*rarest)[i]];
+        if (containsIgnoreCase(entry.mFields[field], text))
+        {
+            ids.push_back(entry.mID);
+        }
+    }
+}
+
+void FSAreaSearchIndex::getAll(uuid_vec_t& ids) const
+{
+    ids.reserve(ids.size() + mSlots.size());
+    for (LLFlatHashMap<LLUUID, U32>::const_iterator it = mSlots.begin(); it != mSlots.end(); ++it)
+    {
+        ids.push_back(it->first);
+    }
+}
+
+bool FSAreaSearchIndex::contains(const LLUUID& id, EField field, const std::string& text) const
+{
+    return containsIgnoreCase(getField(id, field), text);
+}
+
+// static
+void FSAreaSearchIndex::getTrigrams(const std::string& text, std::vector<U32>& trigrams)
+{
+    trigrams.clear();
+    if (text.size() < 3)
+    {
+        return;
+    }
+    trigrams.reserve(text.size() - 2);
+    for (size_t i = 0; i + 3 <= text.size(); ++i)
+    {
+        U32 trigram = 0;
+        for (size_t j = i; j < i + 3; ++j)
+        {
+            trigram = (trigram << 8) | (U8)std::tolower((U8)text[j]);
+        }
+        trigrams.push_back(trigram);
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+// static
+bool FSAreaSearchIndex::containsIgnoreCase(const std::string& text, const std::string& sub)
+{
+    // same test the search has always made
+    return sub.empty() || !boost::ifind_first(text, sub).empty();
+}
+
+void FSAreaSearchIndex::addPostings(U32 slot, EField field)
+{
+    std::vector<U32> trigrams;
+    getTrigrams(mEntries[slot].mFields[field], trigrams);
+    for (size_t i = 0; i < trigrams.size(); ++i)
+    {
+        mPostings[field][trigrams[i]].push_back(slot);
+    }
+}
+
+void FSAreaSearchIndex::removePostings(U32 slot, EField field)
+{
+    std::vector<U32> trigrams;
+    getTrigrams(mEntries[slot].mFields[field], trigrams);
+    for (size_t i = 0; i < trigrams.size(); ++i)
+    {
+        postings_t::iterator it = mPostings[field].find(trigrams[i]);
+        if (it == mPostings[field].end())
+        {
+            continue;
+        }
+        std::vector<U32>& slots = it->second;
+        std::vector<U32>::iterator found = std::find(slots.begin(), slots.end(), slot);
+        if (found != slots.end())
+        {
+            *found = slots.back();
+            slots.pop_back();
+        }
+        if (slots.empty())
+        {
+            mPostings[field].erase(trigrams[i]);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+/**
+ * @file fsareasearchindex.h
+ * @brief Text of the searchable fields of the objects known to area search,
+ * indexed so that a change of search text does not rescan every object.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef FS_AREASEARCHINDEX_H
+#define FS_AREASEARCHINDEX_H
+
+#include <string>
+#include <vector>
+
+#include "llflathashmap.h"
+#include "lluuid.h"
+
+// Each field keeps a posting list per trigram (three lowercased bytes) of
+// its text. A case insensitive substring search of three bytes or more
+// only has to verify the objects listed under the query's rarest trigram;
+// shorter queries check the stored text of every object, which is still
+// far cheaper than going back to the objects and the name cache.
+class FSAreaSearchIndex
+{
+public:
+    typedef enum e_field
+    {
+        FIELD_NAME,
+        FIELD_DESCRIPTION,
+        FIELD_OWNER,
+        FIELD_GROUP,
+        FIELD_CREATOR,
+        FIELD_LAST_OWNER,
+        FIELD_COUNT
+    } EField;
+
+    void setField(const LLUUID& id, EField field, const std::string& text);
+    // Empty if the object or the field is not known yet
+    const std::string& getField(const LLUUID& id, EField field) const;
+    void remove(const LLUUID& id);
+    void clear();
+    size_t size() const { return mSlots.size(); }
+
+    // Appends every object whose field contains text, ignoring case
+    void find(EField field, const std::string& text, uuid_vec_t& ids) const;
+    // Appends every object
+    void getAll(uuid_vec_t& ids) const;
+    // The field of id contains text, ignoring case
+    bool contains(const LLUUID& id, EField field, const std::string& text) const;
+
+private:
+    struct Entry
+    {
+        LLUUID mID;
+        std::string mFields[FIELD_COUNT];
+    };
+    typedef LLFlatHashMap<U32, std::vector<U32> > postings_t;
+
+    // Distinct trigrams of text, lowercased
+    static void getTrigrams(const std::string& text, std::vector<U32>& trigrams);
+    static bool containsIgnoreCase(const std::string& text, const std::string& sub);
+
+    void addPostings(U32 slot, EField field);
+    void removePostings(U32 slot, EField field);
+
+    LLFlatHashMap<LLUUID, U32> mSlots;
+    std::vector<Entry> mEntries;
+    std::vector<U32> mFreeSlots;
+    postings_t mPostings[FIELD_COUNT];
+};
+
+#endif // FS_AREASEARCHINDEX_H
@@ -31,6 +31,7 @@
 #include "llappviewer.h"
 #include "llviewercontrol.h"
 #include "llexception.h"
+#include "llworkerthread.h"
 #include "stringize.h"
 
 #include <openssl/x509_vfy.h>
@@ -50,6 +51,7 @@
 
 const F64 LLAppCoreHttp::MAX_THREAD_WAIT_TIME(10.0);
 const long LLAppCoreHttp::PIPELINING_DEPTH(5L);
+const long LLAppCoreHttp::HTTP2_STREAMS(16L);
 
 //  Default and dynamic values for classes
 static const struct
@@ -122,7 +124,8 @@ static void ssl_verification_changed();
 LLAppCoreHttp::HttpClass::HttpClass()
     : mPolicy(LLCore::HttpRequest::DEFAULT_POLICY_ID),
       mConnLimit(0U),
-      mPipelined(false)
+      mPipelined(false),
+      mMultiplexed(false)
 {}
 
 
@@ -131,7 +134,8 @@ LLAppCoreHttp::LLAppCoreHttp()
       mStopHandle(LLCORE_HTTP_HANDLE_INVALID),
       mStopRequested(0.0),
       mStopped(false),
-      mPipelined(true)
+      mPipelined(true),
+      mMultiplexed(false)
 {}
 
 
@@ -257,6 +261,28 @@ void LLAppCoreHttp::init()
         }
     }
 
+    // Texture fetches only use the low bits of the priority (see
+    // LLTextureFetchWorker), spread the HTTP/2 stream weights over those
+    if (mHttpClasses[AP_TEXTURE].mPolicy != mHttpClasses[AP_DEFAULT].mPolicy)
+    {
+        status = LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_HTTP2_PRIORITY_MAX,
+                                                            mHttpClasses[AP_TEXTURE].mPolicy,
+                                                            long(LLWorkerThread::PRIORITY_LOWBITS), NULL);
+        if (! status)
+        {
+            LL_WARNS("Init") << "Unable to set texture fetch priority range.  Reason:  " << status.toString()
+                             << LL_ENDL;
+        }
+    }
+
+    // Global multiplexing setting, needed by the initial settings below
+    static const std::string http_multiplexing("HttpMultiplexing");
+    if (gSavedSettings.controlExists(http_multiplexing))
+    {
+        mMultiplexed = gSavedSettings.getBOOL(http_multiplexing);
+        LL_INFOS("Init") << "HTTP/2 multiplexing " << (mMultiplexed ? "enabled" : "disabled") << "!" << LL_ENDL;
+    }
+
     // Need a request object to handle dynamic options before setting them
     mRequest = new LLCore::HttpRequest;
 
@@ -448,6 +474,36 @@ void LLAppCoreHttp::refreshSettings(bool initial)
                     mHttpClasses[app_policy].mPipelined = to_pipeline;
                 }
             }
+
+            // HTTP/2 multiplexing goes to the same classes as pipelining:
+            // the CDN-served ones.  The per-host limit is left at the
+            // concurrency setting so servers that stay on HTTP/1.1 are
+            // served as before.
+            const bool to_multiplex(mMultiplexed && init_data[i].mPipelined);
+            if (to_multiplex != mHttpClasses[app_policy].mMultiplexed)
+            {
+                LLCore::HttpHandle handle;
+                const long new_streams(to_multiplex ? HTTP2_STREAMS : 0);
+
+                handle = mRequest->setPolicyOption(LLCore::HttpRequest::PO_HTTP2_STREAMS,
+                                                   mHttpClasses[app_policy].mPolicy,
+                                                   new_streams,
+                                                   LLCore::HttpHandler::ptr_t());
+                if (LLCORE_HTTP_HANDLE_INVALID == handle)
+                {
+                    status = mRequest->getStatus();
+                    LL_WARNS("Init") << "Unable to set " << init_data[i].mUsage
+                                     << " multiplexing.  Reason:  " << status.toString()
+                                     << LL_ENDL;
+                }
+                else
+                {
+                    LL_DEBUGS("Init") << "Changed " << init_data[i].mUsage
+                                      << " multiplexing.  New value:  " << new_streams
+                                      << LL_ENDL;
+                    mHttpClasses[app_policy].mMultiplexed = to_multiplex;
+                }
+            }
         }
         
         // Get target connection concurrency value
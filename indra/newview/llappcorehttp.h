@@ -42,6 +42,7 @@ class LLAppCoreHttp : public LLCore::HttpHandler
 {
 public:
     static const long           PIPELINING_DEPTH;
+    static const long           HTTP2_STREAMS;
 
     typedef LLCore::HttpRequest::policy_t policy_t;
 
@@ -228,6 +229,12 @@ public:
             return mHttpClasses[policy].mPipelined;
         }
 
+    // Return whether a policy multiplexes requests over HTTP/2.
+    bool isMultiplexed(EAppPolicy policy) const
+        {
+            return mHttpClasses[policy].mMultiplexed;
+        }
+
     // Apply initial or new settings from the environment.
     void refreshSettings(bool initial);
     
@@ -246,6 +253,7 @@ private:
         policy_t                    mPolicy;            // Policy class id for the class
         U32                         mConnLimit;
         bool                        mPipelined;
+        bool                        mMultiplexed;
         boost::signals2::connection mSettingsSignal;    // Signal to global setting that affect this class (if any)
     };
         
@@ -256,6 +264,7 @@ private:
     HttpClass                   mHttpClasses[AP_COUNT];
     bool                        mPipelined;             // Global setting
     boost::signals2::connection mPipelinedSignal;       // Signal for 'HttpPipelining' setting
+    bool                        mMultiplexed;           // Global 'HttpMultiplexing' setting
     boost::signals2::connection mSSLNoVerifySignal;     // Signal for 'NoVerifySSLCert' setting
 
     static LLCore::HttpStatus   sslVerify(const std::string &uri, const LLCore::HttpHandler::ptr_t &handler, void *appdata);
@@ -101,6 +101,7 @@
 #include "llprogressview.h"
 #include "llvocache.h"
 #include "lldiskcache.h"
+#include "llpackedassetstore.h"
 #include "llvopartgroup.h"
 // [SL:KB] - Patch: Appearance-Misc | Checked: 2013-02-12 (Catznip-3.4)
 #include "llappearancemgr.h"
@@ -2072,6 +2073,7 @@ bool LLAppViewer::cleanup()
         LL_INFOS() << "HUD Objects cleaned up" << LL_ENDL;
     }
 
+    LLKeyframeDataCache::closeFile();
     LLKeyframeDataCache::clear();
     
     // End TransferManager before deleting systems it depends on (Audio, AssetStorage)
@@ -2502,7 +2504,8 @@ void LLAppViewer::initGeneralThread()
         << poolSize << " threads" << LL_ENDL;
     // We don't want anyone, especially the main thread, to have to block
     // due to this ThreadPool being full.
-    mGeneralThreadPool = new LL::ThreadPool("General", poolSize, 1024 * 1024);
+    mGeneralThreadPool = new LL::ThreadPool("General", poolSize, 1024 * 1024,
+                                            gSavedSettings.getBOOL("ThreadPoolLockFree"));
     mGeneralThreadPool->start();
 }
 
@@ -4714,7 +4717,7 @@ U32 LLAppViewer::getObjectCacheVersion()
 {
     // Viewer object cache version, change if object update
     // format changes. JC
-    const U32 INDRA_OBJECT_CACHE_VERSION = 15;
+    const U32 INDRA_OBJECT_CACHE_VERSION = 16;
 
     return INDRA_OBJECT_CACHE_VERSION;
 }
@@ -4724,6 +4727,7 @@ bool LLAppViewer::initCache()
     mPurgeCache = false;
     BOOL read_only = mSecondInstance ? TRUE : FALSE;
     LLAppViewer::getTextureCache()->setReadOnly(read_only) ;
+    LLAppViewer::getTextureCache()->setUseMappedFiles(gSavedSettings.getBOOL("TextureCacheMapFiles"));
     LLVOCache::initParamSingleton(read_only);
 
     // initialize the new disk cache using saved settings
@@ -4742,6 +4746,12 @@ bool LLAppViewer::initCache()
     const uintmax_t disk_cache_size = uintmax_t(cache_total_size * disk_cache_percent / 100);
     const bool enable_cache_debug_info = gSavedSettings.getBOOL("EnableDiskCacheDebugInfo");
 
+    // Small assets can optionally be packed into a few segment files rather than
+    // stored one per file. The packed store takes its share out of the disk cache
+    // budget. A second instance leaves it alone since the segments are not shared.
+    const bool pack_small_assets = !read_only && gSavedSettings.getBOOL("DiskCachePackSmallAssets");
+    const uintmax_t packed_store_size = pack_small_assets ? disk_cache_size / 5 : 0;
+
     bool texture_cache_mismatch = false;
     bool remove_vfs_files = false;
     if (gSavedSettings.getS32("LocalCacheVersion") != LLAppViewer::getTextureCacheVersion()) 
@@ -4806,7 +4816,11 @@ bool LLAppViewer::initCache()
     }
     
     const std::string cache_dir = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, cache_dir_name);
-    LLDiskCache::initParamSingleton(cache_dir, disk_cache_size, enable_cache_debug_info);
+    LLDiskCache::initParamSingleton(cache_dir, disk_cache_size - packed_store_size, enable_cache_debug_info);
+    if (pack_small_assets)
+    {
+        LLPackedAssetStore::initParamSingleton(gDirUtilp->add(cache_dir, "packed"), packed_store_size);
+    }
 
     if (!read_only)
     {
@@ -4859,6 +4873,11 @@ bool LLAppViewer::initCache()
 
     LLVOCache::getInstance()->initCache(LL_PATH_CACHE, gSavedSettings.getU32("CacheNumberOfRegionsForObjects"), getObjectCacheVersion());
 
+    if (!read_only && gSavedSettings.getBOOL("AnimationUseDecodedCache"))
+    {
+        LLKeyframeDataCache::openFile(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "animations.bin"));
+    }
+
     return true;
 }
 
@@ -5054,16 +5073,22 @@ void LLAppViewer::loadNameCache()
 {
     // display names cache
     std::string filename =
-        gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "avatar_name_cache.xml");
+        gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "avatar_name_cache.bin");
     LL_INFOS("AvNameCache") << filename << LL_ENDL;
-    llifstream name_cache_stream(filename.c_str());
-    if(name_cache_stream.is_open())
+    if (!LLAvatarNameCache::getInstance()->loadCacheFile(filename))
     {
-        if ( ! LLAvatarNameCache::getInstance()->importFile(name_cache_stream))
+        // names saved by older versions, the binary file replaces it at exit
+        std::string xml_filename =
+            gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "avatar_name_cache.xml");
+        llifstream name_cache_stream(xml_filename.c_str());
+        if(name_cache_stream.is_open())
         {
-            LL_WARNS("AppInit") << "removing invalid '" << filename << "'" << LL_ENDL;
+            if ( ! LLAvatarNameCache::getInstance()->importFile(name_cache_stream))
+            {
+                LL_WARNS("AppInit") << "removing invalid '" << xml_filename << "'" << LL_ENDL;
+            }
             name_cache_stream.close();
-            LLFile::remove(filename);
+            LLFile::remove(xml_filename);
         }
     }
 
@@ -5082,12 +5107,8 @@ void LLAppViewer::saveNameCache()
 {
     // display names cache
     std::string filename =
-        gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "avatar_name_cache.xml");
-    llofstream name_cache_stream(filename.c_str());
-    if(name_cache_stream.is_open())
-    {
-        LLAvatarNameCache::getInstance()->exportFile(name_cache_stream);
-    }
+        gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "avatar_name_cache.bin");
+    LLAvatarNameCache::getInstance()->saveCacheFile(filename);
     
     // real names cache
     if (gCacheName)
@@ -5976,6 +5997,11 @@ void LLAppViewer::disconnectViewer()
     LLDestroyClassList::instance().fireCallbacks();
 
     cleanup_xfer_manager();
+    if (gMessageSystem)
+    {
+        // nothing flushes batched sends once disconnected
+        gMessageSystem->mPacketRing.setUseBatching(FALSE);
+    }
     gDisconnected = TRUE;
 
     // Pass the connection state to LLUrlEntryParcel not to attempt
@@ -41,6 +41,7 @@
 #include "llinventorypanel.h"
 #include "llinventorybridge.h"
 #include "llinventoryfunctions.h"
+#include "llinventorycache.h"
 #include "llinventoryobserver.h"
 #include "llinventorypanel.h"
 #include "llfloaterpreviewtrash.h"
@@ -93,6 +94,8 @@ BOOL LLInventoryModel::sFirstTimeInViewer2 = TRUE;
 //BOOL decompress_file(const char* src_filename, const char* dst_filename);
 static const char PRODUCTION_CACHE_FORMAT_STRING[] = "%s.inv.llsd";
 static const char GRID_CACHE_FORMAT_STRING[] = "%s.%s.inv.llsd";
+static const char PRODUCTION_BINARY_CACHE_FORMAT_STRING[] = "%s.inv.cache";
+static const char GRID_BINARY_CACHE_FORMAT_STRING[] = "%s.%s.inv.cache";
 static const char * const LOG_INV("Inventory");
 
 struct InventoryIDPtrLess
@@ -2056,8 +2059,9 @@ bool LLInventoryModel::fetchDescendentsOf(const LLUUID& folder_id) const
     return cat->fetch();
 }
 
-//static
-std::string LLInventoryModel::getInvCacheAddres(const LLUUID& owner_id)
+static std::string get_inv_cache_filename(const LLUUID& owner_id,
+                                          const char* production_format,
+                                          const char* grid_format)
 {
     std::string inventory_addr;
     std::string owner_id_str;
@@ -2065,7 +2069,7 @@ std::string LLInventoryModel::getInvCacheAddres(const LLUUID& owner_id)
     std::string path(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, owner_id_str));
     if (LLGridManager::getInstance()->isInProductionGrid())
     {
-        inventory_addr = llformat(PRODUCTION_CACHE_FORMAT_STRING, path.c_str());
+        inventory_addr = llformat(production_format, path.c_str());
     }
     else
     {
@@ -2074,11 +2078,23 @@ std::string LLInventoryModel::getInvCacheAddres(const LLUUID& owner_id)
         // if your viewer uses grid names from an untrusted source.
         const std::string& grid_id_str = LLGridManager::getInstance()->getGridId();
         const std::string& grid_id_lower = utf8str_tolower(grid_id_str);
-        inventory_addr = llformat(GRID_CACHE_FORMAT_STRING, path.c_str(), grid_id_lower.c_str());
+        inventory_addr = llformat(grid_format, path.c_str(), grid_id_lower.c_str());
     }
     return inventory_addr;
 }
 
+//static
+std::string LLInventoryModel::getInvCacheAddres(const LLUUID& owner_id)
+{
+    return get_inv_cache_filename(owner_id, PRODUCTION_CACHE_FORMAT_STRING, GRID_CACHE_FORMAT_STRING);
+}
+
+//static
+std::string LLInventoryModel::getInvBinaryCacheAddres(const LLUUID& owner_id)
+{
+    return get_inv_cache_filename(owner_id, PRODUCTION_BINARY_CACHE_FORMAT_STRING, GRID_BINARY_CACHE_FORMAT_STRING);
+}
+
 void LLInventoryModel::cache(
     const LLUUID& parent_folder_id,
     const LLUUID& agent_id)
@@ -2100,9 +2116,23 @@ void LLInventoryModel::cache(
         INCLUDE_TRASH,
         can_cache);
     std::string inventory_filename = getInvCacheAddres(agent_id);
-    saveToFile(inventory_filename, categories, items);
     std::string gzip_filename(inventory_filename);
     gzip_filename.append(".gz");
+    std::string binary_filename = getInvBinaryCacheAddres(agent_id);
+    if (gSavedSettings.getBOOL("InventoryBinaryCache"))
+    {
+        if (saveToCacheFile(binary_filename, categories, items))
+        {
+            // The binary cache is read first but don't leave an outdated
+            // copy around to be picked up should it go missing
+            LLFile::remove(gzip_filename, ENOENT);
+        }
+        return;
+    }
+    // Likewise the other way around
+    LLFile::remove(binary_filename, ENOENT);
+
+    saveToFile(inventory_filename, categories, items);
     if(gzip_file(inventory_filename, gzip_filename))
     {
         LL_DEBUGS(LOG_INV) << "Successfully compressed " << inventory_filename << LL_ENDL;
@@ -2421,8 +2451,20 @@ bool LLInventoryModel::loadSkeleton(
         const S32 NO_VERSION = LLViewerInventoryCategory::VERSION_UNKNOWN;
         std::string gzip_filename(inventory_filename);
         gzip_filename.append(".gz");
-        LLFILE* fp = LLFile::fopen(gzip_filename, "rb");
         bool remove_inventory_file = false;
+        bool is_cache_obsolete = false;
+        bool loaded = false;
+        if (gSavedSettings.getBOOL("InventoryBinaryCache"))
+        {
+            std::map<LLUUID, S32> current_versions;
+            for (cat_set_t::iterator it = temp_cats.begin(); it != temp_cats.end(); ++it)
+            {
+                current_versions[(*it)->getUUID()] = (*it)->getVersion();
+            }
+            loaded = loadFromCacheFile(getInvBinaryCacheAddres(owner_id), current_versions,
+                                       categories, items, categories_to_update);
+        }
+        LLFILE* fp = loaded ? NULL : LLFile::fopen(gzip_filename, "rb");
         if(fp)
         {
             fclose(fp);
@@ -2439,8 +2481,8 @@ bool LLInventoryModel::loadSkeleton(
                 LL_INFOS(LOG_INV) << "Unable to gunzip " << gzip_filename << LL_ENDL;
             }
         }
-        bool is_cache_obsolete = false;
-        if (loadFromFile(inventory_filename, categories, items, categories_to_update, is_cache_obsolete))
+        if (loaded
+            || loadFromFile(inventory_filename, categories, items, categories_to_update, is_cache_obsolete))
         {
             // We were able to find a cache of files. So, use what we
             // found to generate a set of categories we should add. We
@@ -3203,6 +3245,140 @@ bool LLInventoryModel::saveToFile(const std::string& filename,
     return true;
 }
 
+// static
+bool LLInventoryModel::loadFromCacheFile(const std::string& filename,
+                                         const std::map<LLUUID, S32>& current_versions,
+                                         LLInventoryModel::cat_array_t& categories,
+                                         LLInventoryModel::item_array_t& items,
+                                         LLInventoryModel::changed_items_t& cats_to_update)
+{
+    if(filename.empty())
+    {
+        LL_ERRS(LOG_INV) << "filename is Null!" << LL_ENDL;
+        return false;
+    }
+    LL_INFOS(LOG_INV) << "loading inventory from: (" << filename << ")" << LL_ENDL;
+
+    LLInventoryCacheFile cache;
+    if (!cache.open(filename, sCurrentInvCacheVersion))
+    {
+        LL_INFOS(LOG_INV) << "unable to load inventory from: " << filename << LL_ENDL;
+        return false;
+    }
+
+    S32 skipped_count = 0;
+    for (S32 i = 0; i < cache.getFolderCount(); ++i)
+    {
+        LLPointer<LLViewerInventoryCategory> inv_cat = new LLViewerInventoryCategory(LLUUID::null);
+        S32 version = LLViewerInventoryCategory::VERSION_UNKNOWN;
+        if (!cache.unpackFolder(i, inv_cat, inv_cat->mOwnerID, version))
+        {
+            break;
+        }
+        inv_cat->setVersion(version);
+        categories.push_back(inv_cat);
+
+        // Don't bother with the items of folders that are out of date or
+        // gone, their contents are going to be fetched again
+        std::map<LLUUID, S32>::const_iterator current = current_versions.find(inv_cat->getUUID());
+        S32 item_count = cache.getItemCount(i);
+        if (current == current_versions.end() || current->second != version)
+        {
+            skipped_count += item_count;
+            continue;
+        }
+
+        for (S32 j = 0; j < item_count; ++j)
+        {
+            LLPointer<LLViewerInventoryItem> inv_item = new LLViewerInventoryItem;
+            if (!cache.unpackItem(i, j, inv_item))
+            {
+                LL_WARNS(LOG_INV) << "Damaged item in inventory cache folder " << inv_cat->getUUID() << LL_ENDL;
+                cats_to_update.insert(inv_cat->getUUID());
+                break;
+            }
+            if(inv_item->getUUID().isNull())
+            {
+                LL_WARNS(LOG_INV) << "Ignoring inventory with null item id: "
+                    << inv_item->getName() << LL_ENDL;
+            }
+            else if (inv_item->getType() == LLAssetType::AT_UNKNOWN)
+            {
+                cats_to_update.insert(inv_item->getParentUUID());
+            }
+            else
+            {
+                items.push_back(inv_item);
+            }
+        }
+    }
+
+    if (categories.size() != (size_t)cache.getFolderCount())
+    {
+        LL_WARNS(LOG_INV) << "Damaged folder in inventory cache " << filename << LL_ENDL;
+        categories.clear();
+        items.clear();
+        cats_to_update.clear();
+        return false;
+    }
+
+    LL_INFOS(LOG_INV) << "Read " << categories.size() << " categories and " << items.size()
+                      << " items from cache, skipped " << skipped_count << " items in outdated categories" << LL_ENDL;
+    return true;
+}
+
+// static
+bool LLInventoryModel::saveToCacheFile(const std::string& filename,
+                                       const cat_array_t& categories,
+                                       const item_array_t& items)
+{
+    if (filename.empty())
+    {
+        LL_ERRS(LOG_INV) << "Filename is Null!" << LL_ENDL;
+        return false;
+    }
+
+    LL_INFOS(LOG_INV) << "saving inventory to: (" << filename << ")" << LL_ENDL;
+
+    // Same selection as saveToFile(): items of folders with an unknown
+    // version would be ignored when loading anyway
+    LLInventoryCacheFile::folder_contents_vec_t folders;
+    folders.reserve(categories.size());
+    std::map<LLUUID, size_t> folder_index;
+    for (const LLPointer<LLViewerInventoryCategory>& cat : categories)
+    {
+        if (cat->getVersion() != LLViewerInventoryCategory::VERSION_UNKNOWN)
+        {
+            folder_index[cat->getUUID()] = folders.size();
+            folders.push_back(LLInventoryCacheFile::folder_contents_t());
+            LLInventoryCacheFile::folder_contents_t& folder = folders.back();
+            folder.mCategory = cat;
+            folder.mOwnerID = cat->getOwnerID();
+            folder.mVersion = cat->getVersion();
+        }
+    }
+
+    S32 it_count = 0;
+    for (const LLPointer<LLViewerInventoryItem>& item : items)
+    {
+        std::map<LLUUID, size_t>::const_iterator it = folder_index.find(item->getParentUUID());
+        if (it != folder_index.end())
+        {
+            folders[it->second].mItems.push_back(item);
+            ++it_count;
+        }
+    }
+
+    if (!LLInventoryCacheFile::save(filename, sCurrentInvCacheVersion, folders))
+    {
+        LL_WARNS(LOG_INV) << "Failed to save inventory to: " << filename << LL_ENDL;
+        return false;
+    }
+
+    LL_INFOS(LOG_INV) << "Inventory saved: " << folders.size() << " categories, " << it_count << " items." << LL_ENDL;
+    return true;
+}
+
 // message handling functionality
 // static
 void LLInventoryModel::registerCallbacks(LLMessageSystem* msg)
@@ -204,6 +204,7 @@ public:
     void createCommonSystemCategories();
 
     static std::string getInvCacheAddres(const LLUUID& owner_id);
+    static std::string getInvBinaryCacheAddres(const LLUUID& owner_id);
 
     // Call on logout to save a terse representation.
     void cache(const LLUUID& parent_folder_id, const LLUUID& agent_id);
@@ -700,6 +701,17 @@ protected:
     static bool saveToFile(const std::string& filename,
                            const cat_array_t& categories,
                            const item_array_t& items); 
+    // Binary cache, see llinventorycache.h. Every cached folder is loaded
+    // but only the items of folders whose version matches the one in
+    // current_versions, the others are going to be fetched again anyway.
+    static bool loadFromCacheFile(const std::string& filename,
+                                  const std::map<LLUUID, S32>& current_versions,
+                                  cat_array_t& categories,
+                                  item_array_t& items,
+                                  changed_items_t& cats_to_update);
+    static bool saveToCacheFile(const std::string& filename,
+                                const cat_array_t& categories,
+                                const item_array_t& items);
 
     //--------------------------------------------------------------------
     // Message handling functionality
@@ -0,0 +1,273 @@
+/**
+ * @file llmeshheadercache.cpp
+ * @brief Persistent cache of decoded mesh headers and skin info.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llmeshheadercache.h"
+
+#include "llmodel.h"
+#include "llsd.h"
+
+namespace
+{
+    // "LLMH" - the start of the file
+    const U32 CACHE_MAGIC = 0x484d4c4c;
+    // Bump when the layout of the records below changes
+    const U32 CACHE_FORMAT_VERSION = 1;
+
+    // Past this size the file is rewritten with only the meshes in use
+    const size_t MAX_CACHE_BYTES = 32 * 1024 * 1024;
+
+    // Header blocks the mesh repository looks at, in record order
+    const char* const HEADER_BLOCKS[] =
+    {
+        "lowest_lod",
+        "low_lod",
+        "medium_lod",
+        "high_lod",
+        "skin",
+        "physics_convex",
+        "physics_mesh"
+    };
+    const U32 HEADER_BLOCK_COUNT = LL_ARRAY_SIZE(HEADER_BLOCKS);
+
+    // Sanity limits for damaged skin records
+    const U32 MAX_SKIN_JOINTS = 1024;
+    const U32 MAX_JOINT_NAME = 256;
+
+    template <typename T>
+    void append_value(std::vector<U8>& buffer, const T& value)
+    {
+        const U8* bytes = reinterpret_cast<const U8*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    void append_matrices(std::vector<U8>& buffer, const LLMeshSkinInfo::matrix_list_t& matrices)
+    {
+        for (const LLMatrix4a& mat : matrices)
+        {
+            const U8* bytes = reinterpret_cast<const U8*>(mat.getF32ptr());
+            buffer.insert(buffer.end(), bytes, bytes + 16 * sizeof(F32));
+        }
+    }
+
+    bool read_matrices(const U8*& data, const U8* end, U32 count, LLMeshSkinInfo::matrix_list_t& matrices)
+    {
+        if ((size_t)(end - data) < (size_t)count * 16 * sizeof(F32))
+        {
+            return false;
+        }
+        matrices.resize(count);
+        for (U32 i = 0; i < count; ++i)
+        {
+            F32 values[16];
+            memcpy(values, data, sizeof(values));
+            matrices[i].loadu(values);
+            data += sizeof(values);
+        }
+        return true;
+    }
+}
+
+struct LLMeshHeaderCache::header_record_t
+{
+    // null when the header names no creator
+    LLUUID mCreatorID;
+    U32 mHeaderSize;
+    // -1 when the header has no version
+    S32 mVersion;
+    // bit i set when HEADER_BLOCKS[i] is in the header
+    U32 mBlockMask;
+    S32 mOffset[HEADER_BLOCK_COUNT];
+    S32 mSize[HEADER_BLOCK_COUNT];
+};
+
+// followed by the inverse bind matrices, the alternate bind matrices and
+// then each joint name as a U32 length and its characters
+struct LLMeshHeaderCache::skin_record_t
+{
+    U32 mJointCount;
+    U32 mAltCount;
+    F32 mPelvisOffset;
+    U32 mLockScaleIfJointPosition;
+    F32 mBindShapeMatrix[16];
+};
+
+LLMeshHeaderCache::LLMeshHeaderCache() :
+    mFile(CACHE_MAGIC, CACHE_FORMAT_VERSION, MAX_CACHE_BYTES)
+{
+}
+
+bool LLMeshHeaderCache::getHeader(const LLUUID& mesh_id, LLSD& header, U32& header_size)
+{
+    return mFile.read(mesh_id, RECORD_HEADER, [&](const U8* data, U32 size)
+        {
+            return unpackHeader(data, size, header, header_size);
+        });
+}
+
+void LLMeshHeaderCache::putHeader(const LLUUID& mesh_id, const LLSD& header, U32 header_size)
+{
+    header_record_t record;
+    memset(&record, 0, sizeof(record));
+    record.mHeaderSize = header_size;
+    record.mVersion = header.has("version") ? header["version"].asInteger() : -1;
+    if (header.has("creator") && header["creator"].isUUID())
+    {
+        record.mCreatorID = header["creator"].asUUID();
+    }
+    for (U32 i = 0; i < HEADER_BLOCK_COUNT; ++i)
+    {
+        if (header.has(HEADER_BLOCKS[i]))
+        {
+            const LLSD& block = header[HEADER_BLOCKS[i]];
+            record.mBlockMask |= 1 << i;
+            record.mOffset[i] = block["offset"].asInteger();
+            record.mSize[i] = block["size"].asInteger();
+        }
+    }
+
+    std::vector<U8> payload;
+    append_value(payload, record);
+    mFile.write(mesh_id, RECORD_HEADER, payload);
+}
+
+//static
+bool LLMeshHeaderCache::unpackHeader(const U8* data, U32 size, LLSD& header, U32& header_size)
+{
+    if (size < sizeof(header_record_t))
+    {
+        return false;
+    }
+    header_record_t record;
+    memcpy(&record, data, sizeof(record));
+
+    header = LLSD::emptyMap();
+    if (record.mVersion >= 0)
+    {
+        header["version"] = record.mVersion;
+    }
+    if (record.mCreatorID.notNull())
+    {
+        header["creator"] = record.mCreatorID;
+    }
+    for (U32 i = 0; i < HEADER_BLOCK_COUNT; ++i)
+    {
+        if (record.mBlockMask & (1 << i))
+        {
+            LLSD& block = header[HEADER_BLOCKS[i]];
+            block["offset"] = record.mOffset[i];
+            block["size"] = record.mSize[i];
+        }
+    }
+    header_size = record.mHeaderSize;
+    return true;
+}
+
+bool LLMeshHeaderCache::getSkinInfo(const LLUUID& mesh_id, LLMeshSkinInfo& info)
+{
+    return mFile.read(mesh_id, RECORD_SKIN, [&](const U8* data, U32 size)
+        {
+            return unpackSkinInfo(data, size, info);
+        });
+}
+
+void LLMeshHeaderCache::putSkinInfo(const LLUUID& mesh_id, const LLMeshSkinInfo& info)
+{
+    skin_record_t record;
+    memset(&record, 0, sizeof(record));
+    record.mJointCount = (U32)info.mJointNames.size();
+    record.mAltCount = (U32)info.mAlternateBindMatrix.size();
+    record.mPelvisOffset = info.mPelvisOffset;
+    record.mLockScaleIfJointPosition = info.mLockScaleIfJointPosition ? 1 : 0;
+    memcpy(record.mBindShapeMatrix, info.mBindShapeMatrix.getF32ptr(), sizeof(record.mBindShapeMatrix));
+    if (record.mJointCount > MAX_SKIN_JOINTS
+        || record.mAltCount > MAX_SKIN_JOINTS
+        || info.mInvBindMatrix.size() != record.mJointCount)
+    {
+        return;
+    }
+
+    std::vector<U8> payload;
+    append_value(payload, record);
+    append_matrices(payload, info.mInvBindMatrix);
+    append_matrices(payload, info.mAlternateBindMatrix);
+    for (const std::string& name : info.mJointNames)
+    {
+        U32 length = (U32)llmin(name.size(), (size_t)MAX_JOINT_NAME);
+        append_value(payload, length);
+        payload.insert(payload.end(), name.begin(), name.begin() + length);
+    }
+    mFile.write(mesh_id, RECORD_SKIN, payload);
+}
+
+//static
+bool LLMeshHeaderCache::unpackSkinInfo(const U8* data, U32 size, LLMeshSkinInfo& info)
+{
+    const U8* end = data + size;
+    if (size < sizeof(skin_record_t))
+    {
+        return false;
+    }
+    skin_record_t record;
+    memcpy(&record, data, sizeof(record));
+    data += sizeof(record);
+    if (record.mJointCount > MAX_SKIN_JOINTS || record.mAltCount > MAX_SKIN_JOINTS)
+    {
+        return false;
+    }
+
+    if (!read_matrices(data, end, record.mJointCount, info.mInvBindMatrix)
+        || !read_matrices(data, end, record.mAltCount, info.mAlternateBindMatrix))
+    {
+        return false;
+    }
+
+    info.mJointNames.resize(record.mJointCount);
+    for (U32 i = 0; i < record.mJointCount; ++i)
+    {
+        U32 length;
+        if ((size_t)(end - data) < sizeof(length))
+        {
+            return false;
+        }
+        memcpy(&length, data, sizeof(length));
+        data += sizeof(length);
+        if (length > MAX_JOINT_NAME || (size_t)(end - data) < length)
+        {
+            return false;
+        }
+        info.mJointNames[i].assign((const char*)data, length);
+        data += length;
+    }
+    info.mJointNums.assign(record.mJointCount, -1);
+
+    info.mBindShapeMatrix.loadu(record.mBindShapeMatrix);
+    info.mPelvisOffset = record.mPelvisOffset;
+    info.mLockScaleIfJointPosition = record.mLockScaleIfJointPosition != 0;
+    info.updateHash();
+    return true;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file llmeshheadercache.h
+ * @brief Persistent cache of decoded mesh headers and skin info.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESHHEADERCACHE_H
+#define LL_LLMESHHEADERCACHE_H
+
+#include "llrecordcachefile.h"
+
+class LLMeshSkinInfo;
+class LLSD;
+
+/**
+ * Side cache of what the mesh repository decodes out of mesh assets: the
+ * parts of the header it uses and the skin info. Both are stored as fixed
+ * width binary records keyed by mesh ID, so a mesh seen in an earlier
+ * session needs neither an LLSD parse of its header nor a decompression
+ * and parse of its skin block.
+ *
+ * All methods are thread safe.
+ */
+class LLMeshHeaderCache
+{
+public:
+    LLMeshHeaderCache();
+
+    /**
+     * Map and index the cache file. A missing, damaged or outdated file is
+     * discarded and the cache starts out empty.
+     */
+    void open(const std::string& filename) { mFile.open(filename); }
+
+    /**
+     * Write out the records added since open() and unmap the file.
+     */
+    void close() { mFile.close(); }
+
+    /**
+     * Rebuild the header LLSD and header size of a mesh. Returns false if
+     * the mesh is not cached.
+     */
+    bool getHeader(const LLUUID& mesh_id, LLSD& header, U32& header_size);
+    void putHeader(const LLUUID& mesh_id, const LLSD& header, U32 header_size);
+
+    /**
+     * Fill in a default constructed skin info. Returns false if the mesh
+     * is not cached.
+     */
+    bool getSkinInfo(const LLUUID& mesh_id, LLMeshSkinInfo& info);
+    void putSkinInfo(const LLUUID& mesh_id, const LLMeshSkinInfo& info);
+
+private:
+    struct header_record_t;
+    struct skin_record_t;
+
+    enum
+    {
+        RECORD_HEADER = 1,
+        RECORD_SKIN = 2
+    };
+
+    static bool unpackHeader(const U8* data, U32 size, LLSD& header, U32& header_size);
+    static bool unpackSkinInfo(const U8* data, U32 size, LLMeshSkinInfo& info);
+
+private:
+    LLRecordCacheFile mFile;
+};
+
+#endif // LL_LLMESHHEADERCACHE_H
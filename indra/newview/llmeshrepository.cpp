@@ -846,10 +846,17 @@ LLMeshRepoThread::LLMeshRepoThread()
     mHttpLargeOptions = LLCore::HttpOptions::ptr_t(new LLCore::HttpOptions);
     mHttpLargeOptions->setTransferTimeout(LARGE_MESH_XFER_TIMEOUT);
     mHttpLargeOptions->setUseRetryAfter(gSavedSettings.getBOOL("MeshUseHttpRetryAfter"));
+    mHttpOptions->setBodyAllocator(ll_aligned_malloc_16, ll_aligned_free_16);
+    mHttpLargeOptions->setBodyAllocator(ll_aligned_malloc_16, ll_aligned_free_16);
     mHttpHeaders = LLCore::HttpHeaders::ptr_t(new LLCore::HttpHeaders);
     mHttpHeaders->append(HTTP_OUT_HEADER_ACCEPT, HTTP_CONTENT_VND_LL_MESH);
     mHttpPolicyClass = app_core_http.getPolicy(LLAppCoreHttp::AP_MESH2);
     mHttpLargePolicyClass = app_core_http.getPolicy(LLAppCoreHttp::AP_LARGE_MESH);
+
+    if (gSavedSettings.getBOOL("MeshUseHeaderCache"))
+    {
+        mHeaderCache.open(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "meshheaders.bin"));
+    }
 }
 
 
@@ -862,6 +869,7 @@ LLMeshRepoThread::~LLMeshRepoThread()
 
     mHttpRequestSet.clear();
     mHttpHeaders.reset();
+    mHeaderCache.close();
 
     while (!mDecompositionQ.empty())
     {
@@ -1342,6 +1350,16 @@ bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id)
 
         if (version <= MAX_MESH_VERSION && offset >= 0 && size > 0)
         {
+            //check for skin info decoded in an earlier session
+            LLMeshSkinInfo cached_info;
+            if (mHeaderCache.getSkinInfo(mesh_id, cached_info))
+            {
+                cached_info.mMeshID = mesh_id;
+                LLMutexLock lock(mMutex);
+                mSkinInfoQ.push_back(cached_info);
+                return true;
+            }
+
             //check cache for mesh skin info
             LLFileSystem file(mesh_id, LLAssetType::AT_MESH);
             if (file.getSize() >= offset+size)
@@ -1647,6 +1665,16 @@ bool LLMeshRepoThread::fetchMeshHeader(const LLVolumeParams& mesh_params, bool c
 
         if (size > 0)
         {
+            // The asset is cached, use its header from an earlier session
+            // if there is one
+            LLSD header;
+            U32 header_size = 0;
+            if (mHeaderCache.getHeader(mesh_params.getSculptID(), header, header_size))
+            {
+                storeHeader(mesh_params, header, header_size);
+                return true;
+            }
+
             // *NOTE:  if the header size is ever more than 4KB, this will break
             U8 buffer[MESH_HEADER_SIZE];
             S32 bytes = llmin(size, MESH_HEADER_SIZE);
@@ -1880,33 +1908,40 @@ EMeshProcessingResult LLMeshRepoThread::headerReceived(const LLVolumeParams& mes
         header["404"] = 1;
     }
 
+    if (header_size > 0 && !header.has("404"))
     {
-        
-        {
-            LLMutexLock lock(mHeaderMutex);
-            mMeshHeaderSize[mesh_id] = header_size;
-            mMeshHeader[mesh_id] = header;
-            LLMeshRepository::sCacheBytesHeaders += header_size;
-        }
+        mHeaderCache.putHeader(mesh_id, header, header_size);
+    }
 
-        
-        LLMutexLock lock(mMutex); // make sure only one thread access mPendingLOD at the same time.
+    storeHeader(mesh_params, header, header_size);
+
+    return MESH_OK;
+}
 
-        //check for pending requests
-        pending_lod_map::iterator iter = mPendingLOD.find(mesh_params);
-        if (iter != mPendingLOD.end())
+void LLMeshRepoThread::storeHeader(const LLVolumeParams& mesh_params, const LLSD& header, U32 header_size)
+{
+    const LLUUID mesh_id = mesh_params.getSculptID();
+    {
+        LLMutexLock lock(mHeaderMutex);
+        mMeshHeaderSize[mesh_id] = header_size;
+        mMeshHeader[mesh_id] = header;
+        LLMeshRepository::sCacheBytesHeaders += header_size;
+    }
+
+    LLMutexLock lock(mMutex); // make sure only one thread access mPendingLOD at the same time.
+
+    //check for pending requests
+    pending_lod_map::iterator iter = mPendingLOD.find(mesh_params);
+    if (iter != mPendingLOD.end())
+    {
+        for (U32 i = 0; i < iter->second.size(); ++i)
         {
-            for (U32 i = 0; i < iter->second.size(); ++i)
-            {
-                LODRequest req(mesh_params, iter->second[i]);
-                mLODReqQ.push(req);
-                LLMeshRepository::sLODProcessing++;
-            }
-            mPendingLOD.erase(iter);
+            LODRequest req(mesh_params, iter->second[i]);
+            mLODReqQ.push(req);
+            LLMeshRepository::sLODProcessing++;
         }
+        mPendingLOD.erase(iter);
     }
-
-    return MESH_OK;
 }
 
 EMeshProcessingResult LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size)
@@ -1982,6 +2017,7 @@ bool LLMeshRepoThread::skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 dat
     {
         LLMeshSkinInfo info(skin);
         info.mMeshID = mesh_id;
+        mHeaderCache.putSkinInfo(mesh_id, info);
 
         // LL_DEBUGS(LOG_MESH) << "info pelvis offset" << info.mPelvisOffset << LL_ENDL;
         {
@@ -3114,15 +3150,25 @@ void LLMeshHandlerBase::onCompleted(LLCore::HttpHandle handle, LLCore::HttpRespo
                 goto common_exit;
             }
             
-            // *TODO: Try to get rid of data copying and add interfaces
-            // that support BufferArray directly.  Introduce a two-phase
-            // handler, optional first that takes a body, fallback second
-            // that requires a temporary allocation and data copy.
+            // Bodies starting where we asked normally arrive in a buffer
+            // of their own (see setBodyAllocator()) which is taken over
+            // as is.  Anything else needs a temporary allocation and copy.
             body_offset = mOffset - offset;
-            data = new(std::nothrow) U8[data_size - body_offset];
+            if (! body_offset)
+            {
+                size_t detached_size(0);
+                data = (U8 *) body->detachBuffer(&detached_size);
+            }
+            if (! data)
+            {
+                data = (U8 *) ll_aligned_malloc_16(data_size - body_offset);
+                if (data)
+                {
+                    body->read(body_offset, (char *) data, data_size - body_offset);
+                }
+            }
             if (data)
             {
-                body->read(body_offset, (char *) data, data_size - body_offset);
                 LLMeshRepository::sBytesReceived += data_size;
             }
             else
@@ -3134,7 +3180,7 @@ void LLMeshHandlerBase::onCompleted(LLCore::HttpHandle handle, LLCore::HttpRespo
 
         processData(body, body_offset, data, data_size - body_offset);
 
-        delete [] data;
+        ll_aligned_free_16(data);
     }
 
     // Release handler
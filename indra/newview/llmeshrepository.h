@@ -34,6 +34,7 @@
 #include "llviewertexture.h"
 #include "llvolume.h"
 #include "lldeadmantimer.h"
+#include "llmeshheadercache.h"
 #include "httpcommon.h"
 #include "httprequest.h"
 #include "httpoptions.h"
@@ -328,6 +329,8 @@ public:
     typedef std::set<LLCore::HttpHandler::ptr_t> http_request_set;
     http_request_set                    mHttpRequestSet;            // Outstanding HTTP requests
 
+    LLMeshHeaderCache                   mHeaderCache;               // Decoded headers and skin info from earlier sessions
+
     std::string mGetMeshCapability;
 
     LLMeshRepoThread();
@@ -341,6 +344,7 @@ public:
     bool fetchMeshHeader(const LLVolumeParams& mesh_params, bool can_retry = true);
     bool fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod, bool can_retry = true);
     EMeshProcessingResult headerReceived(const LLVolumeParams& mesh_params, U8* data, S32 data_size);
+    void storeHeader(const LLVolumeParams& mesh_params, const LLSD& header, U32 header_size);
     EMeshProcessingResult lodReceived(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size);
     bool skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
     bool decompositionReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
@@ -0,0 +1,474 @@
+/**
+ * @file llobjectupdatedecoder.cpp
+ * @brief Unpacks the per object payloads of ObjectUpdate messages on worker
+ * threads, ahead of the main thread applying them.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llobjectupdatedecoder.h"
+
+#include "lldatapacker.h"
+#include "llpartdata.h"
+#include "llviewercontrol.h"
+#include "llvolumemessage.h"
+#include "message.h"
+#include "object_flags.h"
+#include "workqueue.h"
+
+// Blocks unpacked per thread, at the least
+const S32 MIN_BLOCKS_PER_HELPER = 2;
+const S32 MAX_HELPERS = 3;
+// Largest Data payload processObjectUpdate() copies out of a message
+const S32 MAX_COMPRESSED_DATA = 2048;
+
+namespace
+{
+    // Longest of the fields read by read_copy()
+    const S32 MAX_COPIED_FIELD = 256;
+
+    S32 bytes_left(const LLDataPackerBinaryBuffer& dp)
+    {
+        return dp.getBufferSize() - dp.getCurrentSize();
+    }
+
+    // The data packer reads strings up to their terminator
+    bool unpack_string(LLDataPackerBinaryBuffer& dp, std::string& value, const char* name)
+    {
+        S32 left = bytes_left(dp);
+        return left > 0 && memchr(dp.getBuffer() + dp.getCurrentSize(), 0, left) && dp.unpackString(value, name);
+    }
+
+    // Runs read on a copy of what is left of dp, as the fields it reads do
+    // not check the length. Moves dp past what read took, returns false if
+    // that was more than there is.
+    template<typename T>
+    bool read_copy(LLDataPackerBinaryBuffer& dp, T read)
+    {
+        U8 field[MAX_COPIED_FIELD];
+        memset(field, 0, sizeof(field));
+        S32 left = llmin(bytes_left(dp), MAX_COPIED_FIELD);
+        memcpy(field, dp.getBuffer() + dp.getCurrentSize(), left);
+        LLDataPackerBinaryBuffer field_dp(field, sizeof(field));
+        read(field_dp);
+        if (field_dp.getCurrentSize() > left)
+        {
+            return false;
+        }
+        dp.shift(dp.getCurrentSize() + field_dp.getCurrentSize());
+        return true;
+    }
+}
+
+LLCompressedObjectFields::LLCompressedObjectFields()
+{
+    clear();
+}
+
+LLCompressedObjectFields::~LLCompressedObjectFields()
+{
+    clear();
+}
+
+void LLCompressedObjectFields::clear()
+{
+    mCRC = 0;
+    mMaterial = 0;
+    mClickAction = 0;
+    mScale.clearVec();
+    mPos.clearVec();
+    mRot.clearVec();
+    mSpecialCode = 0;
+    mOwnerID.setNull();
+    mAngularVelocity.clearVec();
+    mParentID = 0;
+    mTreeData = 0;
+    mScratchPadSize = 0;
+    mScratchPad.clear();
+    mText.clear();
+    mTextColor.setToBlack();
+    mMediaURL.clear();
+    mLegacyParticlesStart = 0;
+    for (LLViewerObject::network_data_list_t::iterator it = mExtraParams.begin(); it != mExtraParams.end(); ++it)
+    {
+        delete it->second;
+    }
+    mExtraParams.clear();
+    mSoundID.setNull();
+    mSoundGain = 0.f;
+    mSoundFlags = 0;
+    mSoundRadius = 0.f;
+    mNameValues.clear();
+    mStart = 0;
+    mEnd = 0;
+}
+
+bool LLCompressedObjectFields::unpack(LLDataPackerBinaryBuffer& dp)
+{
+    clear();
+    mStart = dp.getCurrentSize();
+    bool valid = unpackFields(dp);
+    mEnd = dp.getCurrentSize();
+    return valid;
+}
+
+bool LLCompressedObjectFields::unpackFields(LLDataPackerBinaryBuffer& dp)
+{
+    const S32 FIXED_SIZE = 4 + 1 + 1 + 3 * 12 + 4 + UUID_BYTES;
+    if (bytes_left(dp) < FIXED_SIZE)
+    {
+        return false;
+    }
+    dp.unpackU32(mCRC, "CRC");
+    dp.unpackU8(mMaterial, "Material");
+    dp.unpackU8(mClickAction, "ClickAction");
+    dp.unpackVector3(mScale, "Scale");
+    dp.unpackVector3(mPos, "Pos");
+    dp.unpackVector3(mRot, "Rot");
+    dp.unpackU32(mSpecialCode, "SpecialCode");
+    dp.unpackUUID(mOwnerID, "Owner");
+
+    if (mSpecialCode & 0x80)
+    {
+        if (bytes_left(dp) < 12)
+        {
+            return false;
+        }
+        dp.unpackVector3(mAngularVelocity, "Omega");
+    }
+
+    if (mSpecialCode & 0x20)
+    {
+        if (bytes_left(dp) < 4)
+        {
+            return false;
+        }
+        dp.unpackU32(mParentID, "ParentID");
+    }
+
+    if (mSpecialCode & 0x2)
+    {
+        if (bytes_left(dp) < 1)
+        {
+            return false;
+        }
+        dp.unpackU8(mTreeData, "TreeData");
+    }
+    else if (mSpecialCode & 0x1)
+    {
+        S32 sp_size = 0;
+        if (bytes_left(dp) < 8)
+        {
+            return false;
+        }
+        dp.unpackU32(mScratchPadSize, "ScratchPadSize");
+        dp.unpackS32(sp_size, "PartData");
+        if (sp_size < 0 || sp_size > bytes_left(dp))
+        {
+            return false;
+        }
+        mScratchPad.resize(sp_size);
+        if (sp_size > 0)
+        {
+            dp.unpackBinaryDataFixed(&mScratchPad[0], sp_size, "PartData");
+        }
+    }
+
+    if (mSpecialCode & 0x4)
+    {
+        if (!unpack_string(dp, mText, "Text") || bytes_left(dp) < 4)
+        {
+            return false;
+        }
+        dp.unpackBinaryDataFixed(mTextColor.mV, 4, "Color");
+    }
+
+    if ((mSpecialCode & 0x200) && !unpack_string(dp, mMediaURL, "MediaURL"))
+    {
+        return false;
+    }
+
+    if (mSpecialCode & 0x8)
+    {
+        mLegacyParticlesStart = dp.getCurrentSize();
+        LLPartSysData part_sys_data;
+        if (!read_copy(dp, [&part_sys_data](LLDataPacker& field_dp) { part_sys_data.unpackLegacy(field_dp); }))
+        {
+            return false;
+        }
+    }
+
+    S32 params_size = 0;
+    if (!LLViewerObject::decodeExtraParams(dp.getBuffer() + dp.getCurrentSize(), bytes_left(dp), mExtraParams, &params_size))
+    {
+        return false;
+    }
+    dp.shift(dp.getCurrentSize() + params_size);
+
+    if (mSpecialCode & 0x10)
+    {
+        if (bytes_left(dp) < UUID_BYTES + 4 + 1 + 4)
+        {
+            return false;
+        }
+        dp.unpackUUID(mSoundID, "SoundUUID");
+        dp.unpackF32(mSoundGain, "SoundGain");
+        dp.unpackU8(mSoundFlags, "SoundFlags");
+        dp.unpackF32(mSoundRadius, "SoundRadius");
+    }
+
+    if ((mSpecialCode & 0x100) && !unpack_string(dp, mNameValues, "NV"))
+    {
+        return false;
+    }
+
+    return true;
+}
+
+LLCompressedVolumeFields::LLCompressedVolumeFields()
+{
+    clear();
+}
+
+void LLCompressedVolumeFields::clear()
+{
+    mVolumeParamsValid = false;
+    mVolumeParams = LLVolumeParams();
+    mTEResult = 0;
+    mTE.size = 0;
+    mTE.face_count = 0;
+    mStart = 0;
+    mEnd = 0;
+}
+
+bool LLCompressedVolumeFields::unpack(LLDataPackerBinaryBuffer& dp)
+{
+    clear();
+    mStart = dp.getCurrentSize();
+    bool valid = unpackFields(dp);
+    mEnd = dp.getCurrentSize();
+    return valid;
+}
+
+bool LLCompressedVolumeFields::unpackFields(LLDataPackerBinaryBuffer& dp)
+{
+    if (!read_copy(dp, [this](LLDataPacker& field_dp)
+            { mVolumeParamsValid = LLVolumeMessage::unpackVolumeParams(&mVolumeParams, field_dp); }))
+    {
+        return false;
+    }
+
+    // as LLPrimitive::unpackTEMessage(LLDataPacker&) reads it
+    S32 te_size = 0;
+    if (bytes_left(dp) < 4)
+    {
+        return false;
+    }
+    dp.unpackS32(te_size, "TextureEntry");
+    if (te_size < 0 || te_size > bytes_left(dp))
+    {
+        LL_WARNS() << "Bad texture entry block!  Abort!" << LL_ENDL;
+        mTEResult = TEM_INVALID;
+    }
+    else if (te_size > 0)
+    {
+        S32 kept_size = te_size;
+        if (kept_size >= (S32)LLTEContents::MAX_TE_BUFFER)
+        {
+            LL_WARNS("TEXTUREENTRY") << "Excessive buffer size detected in Texture Entry! Truncating." << LL_ENDL;
+            kept_size = LLTEContents::MAX_TE_BUFFER - 1;
+        }
+        memcpy(mTE.packed_buffer, dp.getBuffer() + dp.getCurrentSize(), kept_size);
+        dp.shift(dp.getCurrentSize() + te_size);
+        mTE.size = kept_size;
+        // The object may not know its face count yet: unpack all of them,
+        // the first getNumTEs() come out the same either way.
+        mTE.face_count = LLTEContents::MAX_TES;
+        mTEResult = LLPrimitive::parseTEContents(mTE);
+    }
+
+    return true;
+}
+
+LLDecodedObjectUpdate::LLDecodedObjectUpdate()
+{
+    clear();
+}
+
+LLDecodedObjectUpdate::~LLDecodedObjectUpdate()
+{
+    clear();
+}
+
+void LLDecodedObjectUpdate::clear()
+{
+    mLocalID = 0;
+    mTEResult = 0;
+    mTE.size = 0;
+    mTE.face_count = 0;
+    mExtraParamsValid = false;
+    for (LLViewerObject::network_data_list_t::iterator it = mExtraParams.begin(); it != mExtraParams.end(); ++it)
+    {
+        delete it->second;
+    }
+    mExtraParams.clear();
+    mExtraParamsData.clear();
+    mData.clear();
+    mUpdateFlags = 0;
+    mFieldsValid = false;
+    mFields.clear();
+    mVolumeFieldsValid = false;
+    mVolumeFields.clear();
+}
+
+LLObjectUpdateDecoder::LLObjectUpdateDecoder() :
+    mNumBlocks(0),
+    mUpdateType(OUT_UNKNOWN)
+{
+}
+
+void LLObjectUpdateDecoder::decode(LLMessageSystem* msg, S32 num_blocks, EObjectUpdateType update_type)
+{
+    static LLCachedControl<bool> threaded_decode(gSavedSettings, "ObjectUpdateThreadedDecode", true);
+
+    reset();
+    while ((S32)mBlocks.size() < num_blocks)
+    {
+        mBlocks.emplace_back(new LLDecodedObjectUpdate);
+    }
+
+    for (S32 i = 0; i < num_blocks; ++i)
+    {
+        LLDecodedObjectUpdate& block = *mBlocks[i];
+        if (update_type == OUT_FULL_COMPRESSED)
+        {
+            msg->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, block.mUpdateFlags, i);
+            S32 data_size = msg->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
+            // the others go to the object cache, see processObjectUpdate()
+            if ((block.mUpdateFlags & FLAGS_TEMPORARY_ON_REZ) && data_size > 0 && data_size <= MAX_COMPRESSED_DATA)
+            {
+                block.mData.resize(data_size);
+                msg->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, &block.mData[0], data_size, i);
+            }
+            continue;
+        }
+
+        msg->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, block.mLocalID, i);
+
+        // same truncation as LLPrimitive::parseTEMessage()
+        S32 te_size = msg->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_TextureEntry);
+        if (te_size > 0)
+        {
+            if (te_size >= (S32)LLTEContents::MAX_TE_BUFFER)
+            {
+                LL_WARNS("TEXTUREENTRY") << "Excessive buffer size detected in Texture Entry! Truncating." << LL_ENDL;
+                te_size = LLTEContents::MAX_TE_BUFFER - 1;
+            }
+            msg->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_TextureEntry, block.mTE.packed_buffer, 0, i, LLTEContents::MAX_TE_BUFFER - 1);
+            block.mTE.size = te_size;
+        }
+
+        S32 params_size = msg->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_ExtraParams);
+        if (params_size > 0)
+        {
+            block.mExtraParamsData.resize(params_size);
+            msg->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_ExtraParams, &block.mExtraParamsData[0], params_size, i);
+        }
+    }
+    mNumBlocks = num_blocks;
+    mUpdateType = update_type;
+
+    LL::parallelFor(num_blocks, threaded_decode ? llmin(num_blocks / MIN_BLOCKS_PER_HELPER - 1, MAX_HELPERS) : 0,
+        [this, update_type](S32 i)
+        {
+            if (update_type == OUT_FULL_COMPRESSED)
+            {
+                decodeCompressedBlock(*mBlocks[i]);
+            }
+            else
+            {
+                decodeBlock(*mBlocks[i]);
+            }
+        });
+}
+
+void LLObjectUpdateDecoder::reset()
+{
+    for (S32 i = 0; i < mNumBlocks; ++i)
+    {
+        mBlocks[i]->clear();
+    }
+    mNumBlocks = 0;
+    mUpdateType = OUT_UNKNOWN;
+}
+
+LLDecodedObjectUpdate* LLObjectUpdateDecoder::getBlock(S32 block_num, U32 local_id, EObjectUpdateType update_type) const
+{
+    if (update_type != mUpdateType || block_num < 0 || block_num >= mNumBlocks || mBlocks[block_num]->mLocalID != local_id)
+    {
+        return NULL;
+    }
+    return mBlocks[block_num].get();
+}
+
+// static
+void LLObjectUpdateDecoder::decodeBlock(LLDecodedObjectUpdate& block)
+{
+    if (block.mTE.size > 0)
+    {
+        // The object may not know its face count yet: unpack all of them,
+        // the first getNumTEs() come out the same either way.
+        block.mTE.face_count = LLTEContents::MAX_TES;
+        block.mTEResult = LLPrimitive::parseTEContents(block.mTE);
+    }
+
+    block.mExtraParamsValid = block.mExtraParamsData.empty() ||
+        LLViewerObject::decodeExtraParams(&block.mExtraParamsData[0], (S32)block.mExtraParamsData.size(), block.mExtraParams);
+}
+
+// static
+void LLObjectUpdateDecoder::decodeCompressedBlock(LLDecodedObjectUpdate& block)
+{
+    if (block.mData.empty())
+    {
+        return;
+    }
+
+    LLDataPackerBinaryBuffer dp(&block.mData[0], (S32)block.mData.size());
+    LLUUID id;
+    U8 pcode = 0;
+    if (bytes_left(dp) < UUID_BYTES + 4 + 1)
+    {
+        return;
+    }
+    dp.unpackUUID(id, "ID");
+    dp.unpackU32(block.mLocalID, "LocalID");
+    dp.unpackU8(pcode, "PCode");
+
+    block.mFieldsValid = block.mFields.unpack(dp);
+    if (block.mFieldsValid && pcode == LL_PCODE_VOLUME)
+    {
+        block.mVolumeFieldsValid = block.mVolumeFields.unpack(dp);
+    }
+}
@@ -0,0 +1,190 @@
+/**
+ * @file llobjectupdatedecoder.h
+ * @brief Unpacks the per object payloads of ObjectUpdate messages on worker
+ * threads, ahead of the main thread applying them.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLOBJECTUPDATEDECODER_H
+#define LL_LLOBJECTUPDATEDECODER_H
+
+#include <memory>
+#include <vector>
+
+#include "llprimitive.h"
+#include "llviewerobject.h"
+#include "v4coloru.h"
+
+class LLDataPackerBinaryBuffer;
+class LLMessageSystem;
+
+// What LLViewerObject::processUpdateMessage() reads from compressed object
+// data, OUT_FULL_COMPRESSED or OUT_FULL_CACHED, after the ID, LocalID and
+// PCode. Offsets are from the start of the data.
+struct LLCompressedObjectFields
+{
+    LLCompressedObjectFields();
+    ~LLCompressedObjectFields();
+
+    void clear();
+
+    // Reads the fields from where dp is, leaving it at mEnd. Returns false
+    // at the first field that does not fit, the ones after it are left
+    // cleared and mEnd is where it stopped. Safe to call from any thread.
+    bool unpack(LLDataPackerBinaryBuffer& dp);
+
+    U32 mCRC;
+    U8 mMaterial;
+    U8 mClickAction;
+    LLVector3 mScale;
+    LLVector3 mPos;
+    LLVector3 mRot;
+    // the pass flags, telling which of the fields below are there
+    U32 mSpecialCode;
+    LLUUID mOwnerID;
+    LLVector3 mAngularVelocity;     // 0x80
+    U32 mParentID;                  // 0x20
+    U8 mTreeData;                   // 0x2
+    U32 mScratchPadSize;            // 0x1
+    std::vector<U8> mScratchPad;
+    std::string mText;              // 0x4
+    LLColor4U mTextColor;
+    std::string mMediaURL;          // 0x200
+    // 0x8, where LLPartSysData::unpackLegacy() is to read them
+    S32 mLegacyParticlesStart;
+    // new parameter blocks, owned here
+    LLViewerObject::network_data_list_t mExtraParams;
+    LLUUID mSoundID;                // 0x10
+    F32 mSoundGain;
+    U8 mSoundFlags;
+    F32 mSoundRadius;
+    std::string mNameValues;        // 0x100
+
+    S32 mStart;
+    S32 mEnd;
+
+private:
+    bool unpackFields(LLDataPackerBinaryBuffer& dp);
+
+    LLCompressedObjectFields(const LLCompressedObjectFields&);
+    LLCompressedObjectFields& operator=(const LLCompressedObjectFields&);
+};
+
+// What LLVOVolume::processUpdateMessage() goes on to read from compressed
+// object data, up to the texture animation.
+struct LLCompressedVolumeFields
+{
+    LLCompressedVolumeFields();
+
+    void clear();
+
+    // Same as LLCompressedObjectFields::unpack(), for the fields after those
+    bool unpack(LLDataPackerBinaryBuffer& dp);
+
+    bool mVolumeParamsValid;
+    LLVolumeParams mVolumeParams;
+    // TextureEntry unpacked for LLTEContents::MAX_TES faces. mTEResult is
+    // what LLPrimitive::unpackTEMessage() would have returned.
+    S32 mTEResult;
+    LLTEContents mTE;
+
+    S32 mStart;
+    S32 mEnd;
+
+private:
+    bool unpackFields(LLDataPackerBinaryBuffer& dp);
+};
+
+// One ObjectData block of an ObjectUpdate message, with the payloads that
+// are expensive to unpack already turned into plain data.
+struct LLDecodedObjectUpdate
+{
+    LLDecodedObjectUpdate();
+    ~LLDecodedObjectUpdate();
+
+    void clear();
+
+    U32 mLocalID;
+
+    // OUT_FULL
+
+    // TextureEntry unpacked for LLTEContents::MAX_TES faces. mTEResult is
+    // what LLPrimitive::parseTEMessage() would have returned.
+    S32 mTEResult;
+    LLTEContents mTE;
+
+    // ExtraParams as new parameter blocks, owned here. Invalid when the
+    // block was malformed, in which case the object unpacks it itself.
+    bool mExtraParamsValid;
+    LLViewerObject::network_data_list_t mExtraParams;
+
+    // Raw payloads, copied out of the message by the main thread
+    std::vector<U8> mExtraParamsData;
+
+    // OUT_FULL_COMPRESSED, for blocks with FLAGS_TEMPORARY_ON_REZ only: the
+    // others go to the object cache as they are.
+
+    // Data payload, copied out of the message by the main thread
+    std::vector<U8> mData;
+    U32 mUpdateFlags;
+    // Read by the same code as the objects would, valid when all of it fit
+    bool mFieldsValid;
+    LLCompressedObjectFields mFields;
+    // for LL_PCODE_VOLUME only
+    bool mVolumeFieldsValid;
+    LLCompressedVolumeFields mVolumeFields;
+};
+
+// Phase one of processing a full ObjectUpdate, OUT_FULL or
+// OUT_FULL_COMPRESSED: the main thread copies the payloads of every block
+// out of the message, then they are unpacked and validated, spread over the
+// General thread pool with the main thread taking its share. Phase two is
+// the main thread applying the results to objects, block by block, while
+// the message is still current, so updates keep their order relative to
+// every other message.
+class LLObjectUpdateDecoder
+{
+public:
+    LLObjectUpdateDecoder();
+
+    // Main thread. Returns once every block is decoded.
+    void decode(LLMessageSystem* msg, S32 num_blocks, EObjectUpdateType update_type);
+
+    // Drop the decoded blocks once the message has been applied
+    void reset();
+
+    // The decoded block, or NULL if block_num does not belong to the
+    // object with local_id in the message being applied, or that message
+    // is not of update_type
+    LLDecodedObjectUpdate* getBlock(S32 block_num, U32 local_id, EObjectUpdateType update_type) const;
+
+private:
+    static void decodeBlock(LLDecodedObjectUpdate& block);
+    static void decodeCompressedBlock(LLDecodedObjectUpdate& block);
+
+    std::vector<std::unique_ptr<LLDecodedObjectUpdate> > mBlocks;
+    S32 mNumBlocks;
+    EObjectUpdateType mUpdateType;
+};
+
+#endif // LL_LLOBJECTUPDATEDECODER_H
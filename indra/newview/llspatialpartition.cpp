@@ -53,6 +53,7 @@
 #include "llvolumemgr.h"
 #include "llviewershadermgr.h"
 #include "llcontrolavatar.h"
+#include "workqueue.h"
 //MK
 #include "llagent.h"
 //mk
@@ -963,6 +964,7 @@ void LLSpatialPartition::shift(const LLVector4a &offset)
 { //shift octree node bounding boxes by offset
     LLSpatialShift shifter(offset);
     shifter.traverse(mOctree);
+    mPrecull.invalidateBounds();
 }
 
 class LLOctreeCull : public LLViewerOctreeCull
@@ -1410,6 +1412,34 @@ S32 LLSpatialPartition::cull(LLCamera &camera, bool do_occlusion)
 #if LL_OCTREE_PARANOIA_CHECK
     ((LLSpatialGroup*)mOctree->getListener(0))->checkStates();
 #endif
+    if (mPrecull.isReady(camera))
+    {
+        // the frustum checks are done, see precull()
+        switch (mPrecull.getFrustumCheck())
+        {
+        case LLViewerOctreePrecull::FRUSTUM:
+        {
+            LLOctreeCullShadow culler(&camera);
+            culler.replay(mPrecull);
+            break;
+        }
+        case LLViewerOctreePrecull::FRUSTUM_NO_FAR_CLIP:
+        {
+            LLOctreeCullNoFarClip culler(&camera);
+            culler.replay(mPrecull);
+            break;
+        }
+        default:
+        {
+            LLOctreeCull culler(&camera);
+            culler.replay(mPrecull);
+            break;
+        }
+        }
+        mPrecull.clear();
+        return 0;
+    }
+
     LLSpatialGroup* group = (LLSpatialGroup*) mOctree->getListener(0);
     group->rebound();
 
@@ -1436,6 +1466,41 @@ S32 LLSpatialPartition::cull(LLCamera &camera, bool do_occlusion)
     return 0;
 }
 
+// The frustum check cull() does, by the culler it picks
+LLViewerOctreePrecull::eFrustumCheck LLSpatialPartition::getFrustumCheck() const
+{
+    if (LLPipeline::sShadowRender)
+    {
+        return LLViewerOctreePrecull::FRUSTUM;
+    }
+    else if (mInfiniteFarClip || !LLPipeline::sUseFarClip)
+    {
+        return LLViewerOctreePrecull::FRUSTUM_NO_FAR_CLIP;
+    }
+    return LLViewerOctreePrecull::FRUSTUM_NO_FAR_CLIP_SPHERE;
+}
+
+// Partitions checked per thread, at the least
+const S32 MIN_PARTITIONS_PER_HELPER = 4;
+const S32 MAX_PRECULL_HELPERS = 3;
+
+//static
+void LLSpatialPartition::precull(const std::vector<LLSpatialPartition*>& partitions, LLCamera& camera)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_SPATIAL;
+    for (LLSpatialPartition* part : partitions)
+    {
+        // what cull(camera) would do before traversing
+        LLSpatialGroup* group = (LLSpatialGroup*) part->mOctree->getListener(0);
+        group->rebound();
+        part->mPrecull.setup(camera, part->getFrustumCheck());
+    }
+
+    const S32 count = (S32)partitions.size();
+    LL::parallelFor(count, llmin(count / MIN_PARTITIONS_PER_HELPER - 1, MAX_PRECULL_HELPERS),
+        [&partitions](S32 i) { partitions[i]->runPrecull(); });
+}
+
 void pushVerts(LLDrawInfo* params, U32 mask)
 {
     LLRenderPass::applyModelMatrix(*params);
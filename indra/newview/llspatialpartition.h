@@ -403,6 +403,12 @@ public:
     BOOL visibleObjectsInFrustum(LLCamera& camera);
     /*virtual*/ S32 cull(LLCamera &camera, bool do_occlusion=false); // Cull on arbitrary frustum
     S32 cull(LLCamera &camera, std::vector<LLDrawable *>* results, BOOL for_select); // Cull on arbitrary frustum
+
+    // Do the frustum checks of the next cull(camera) of each partition ahead
+    // of time, spread over the General thread pool. Main thread.
+    static void precull(const std::vector<LLSpatialPartition*>& partitions, LLCamera& camera);
+    // The frustum checks of one partition, any thread
+    void runPrecull() { mPrecull.run(mOctree); }
     
     BOOL isVisible(const LLVector3& v);
     bool isHUDPartition() ;
@@ -431,6 +437,11 @@ public:
     BOOL mDepthMask; //if TRUE, objects in this partition will be written to depth during alpha rendering
 
     static BOOL sTeleportRequested; //started to issue a teleport request
+
+private:
+    LLViewerOctreePrecull::eFrustumCheck getFrustumCheck() const;
+
+    LLViewerOctreePrecull mPrecull;
 };
 
 // class for creating bridges between spatial partitions
@@ -652,6 +663,14 @@ class LLVolumeGeometryManager: public LLGeometryManager
     virtual void rebuildMesh(LLSpatialGroup* group);
     virtual void getGeometry(LLSpatialGroup* group);
     virtual void addGeometryCount(LLSpatialGroup* group, U32& vertex_count, U32& index_count);
+    // rebuildMesh() of each group, with the faces of vertex buffers that
+    // have a client copy written on the general work queue
+    static void rebuildMeshes(const LLSpatialGroup::sg_vector_t& groups);
+    // Between these, rebuildGeom() leaves the faces of vertex buffers that
+    // have a client copy to endFaceWrites(), which writes them on the general
+    // work queue and uploads the buffers
+    static void beginFaceWrites();
+    static void endFaceWrites();
     U32 genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace** faces, U32 face_count, BOOL distance_sort = FALSE, BOOL batch_textures = FALSE, BOOL rigged = FALSE);
     void registerFace(LLSpatialGroup* group, LLFace* facep, U32 type);
 
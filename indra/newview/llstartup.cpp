@@ -855,6 +855,14 @@ bool idle_startup()
                 msg->mPacketRing.setUseOutThrottle(TRUE);
                 msg->mPacketRing.setOutBandwidth(outBandwidth);
             }
+
+            // The decode thread receives through a packet ring of its own,
+            // without the debug inbound throttle and packet dropping
+            if (inBandwidth == 0.f && dropPercent == 0.f)
+            {
+                msg->setUseDecodeThread(gSavedSettings.getBOOL("DecodeMessagesOnThread"),
+                                        gSavedSettings.getBOOL("BatchNetworkPackets"));
+            }
         }
 
         LL_INFOS("AppInit") << "Message System Initialized." << LL_ENDL;
@@ -2726,6 +2734,9 @@ bool idle_startup()
         LLStartUp::setStartupState( STATE_STARTED );
         display_startup();
 
+        // From here on idleNetwork() runs every frame and flushes batched sends
+        gMessageSystem->mPacketRing.setUseBatching(gSavedSettings.getBOOL("BatchNetworkPackets"));
+
         // Unmute audio if desired and setup volumes.
         // This is a not-uncommon crash site, so surround it with
         // LL_INFOS() output to aid diagnosis.
@@ -837,6 +837,7 @@ LLTextureCache::LLTextureCache(bool threaded)
       mFastCacheMutex(),
       mHeaderAPRFile(NULL),
       mReadOnly(TRUE), //do not allow to change the texture cache until setReadOnly() is called.
+      mUseMappedFiles(false),
       mTexturesSizeTotal(0),
       mDoPurge(FALSE),
       mFastCachep(NULL),
@@ -850,6 +851,8 @@ LLTextureCache::~LLTextureCache()
 {
     clearDeleteList() ;
     writeUpdatedEntries() ;
+    mHeaderMap.close();
+    mFastCacheMap.close();
     delete mFastCachep;
     delete mFastCachePoolp;
     delete mHeaderAPRFilePoolp;
@@ -1111,6 +1114,41 @@ LLAPRFile* LLTextureCache::openHeaderEntriesFile(bool readonly, S32 offset)
     return mHeaderAPRFile;
 }
 
+//the header entries are read and written in place through the mapping.
+//falls back to the APR file I/O if the file can not be mapped.
+void LLTextureCache::mapHeaderEntriesFile()
+{
+    if (!mUseMappedFiles || mReadOnly || mHeaderMap.isMapped())
+    {
+        return;
+    }
+
+    size_t size = sizeof(EntriesInfo) + (size_t)sCacheMaxEntries * sizeof(Entry);
+    if (!mHeaderMap.open(mHeaderEntriesFileName, size))
+    {
+        LL_WARNS("TextureCache") << "Failed to map " << mHeaderEntriesFileName << ", using file I/O" << LL_ENDL;
+    }
+}
+
+//returns NULL if the header entries file is not mapped or idx is out of it.
+//the entry is only valid under mHeaderMutex. Reading it without the lock
+//would need more than a seqlock around the copy: the index comes from
+//mHeaderIDMap, and looking a texture up also takes it out of mLRU, which
+//are std containers changed under that lock. A slot is reused for another
+//texture as soon as removeCachedTexture() frees it, so an unlocked copy,
+//even an untorn one, could be of some other texture's entry. With the file
+//mapped the lock is held for a map lookup and a 28 byte copy, not for the
+//file I/O it used to be held across.
+LLTextureCache::Entry* LLTextureCache::getMappedEntry(S32 idx)
+{
+    size_t offset = sizeof(EntriesInfo) + (size_t)idx * sizeof(Entry);
+    if (!mHeaderMap.isMapped() || idx < 0 || offset + sizeof(Entry) > mHeaderMap.getSize())
+    {
+        return NULL;
+    }
+    return (Entry*)(mHeaderMap.getData() + offset);
+}
+
 void LLTextureCache::closeHeaderEntriesFile()
 {
     if(!mHeaderAPRFile)
@@ -1252,6 +1290,18 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 //mHeaderMutex is locked before calling this.
 void LLTextureCache::writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header)
 {   
+    Entry* mapped_entry = getMappedEntry(idx);
+    if (mapped_entry)
+    {
+        if (write_header)
+        {
+            memcpy(mHeaderMap.getData(), &mHeaderEntriesInfo, sizeof(EntriesInfo));
+        }
+        memcpy(mapped_entry, &entry, sizeof(Entry));
+        mUpdatedEntryMap.erase(idx) ;
+        return;
+    }
+
     LLAPRFile* aprfile ;
     S32 bytes_written ;
     S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
@@ -1285,9 +1335,16 @@ void LLTextureCache::writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool
     mUpdatedEntryMap.erase(idx) ;
 }
 
-//mHeaderMutex is locked before calling this.
+//mHeaderMutex is locked before calling this, see getMappedEntry().
 void LLTextureCache::readEntryFromHeaderImmediately(S32& idx, Entry& entry)
 {
+    Entry* mapped_entry = getMappedEntry(idx);
+    if (mapped_entry)
+    {
+        memcpy(&entry, mapped_entry, sizeof(Entry));
+        return;
+    }
+
     S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
     LLAPRFile* aprfile = openHeaderEntriesFile(true, offset);
     S32 bytes_read = aprfile->read((void*)&entry, (S32)sizeof(Entry));
@@ -1316,7 +1373,16 @@ void LLTextureCache::updateEntryTimeStamp(S32 idx, Entry& entry)
         if (!mReadOnly)
         {
             entry.mTime = time(NULL);           
-            mUpdatedEntryMap[idx] = entry ;
+            Entry* mapped_entry = getMappedEntry(idx);
+            if (mapped_entry)
+            {
+                // no need to delay, this is a memory write
+                memcpy(mapped_entry, &entry, sizeof(Entry));
+            }
+            else
+            {
+                mUpdatedEntryMap[idx] = entry ;
+            }
         }
     }
 }
@@ -1457,7 +1523,17 @@ void LLTextureCache::writeUpdatedEntries()
         updatedHeaderEntriesFile() ;
         closeHeaderEntriesFile();
     }
+    if (mHeaderMap.isMapped())
+    {
+        mHeaderMap.flush();
+    }
     unlockHeaders() ;
+
+    LLMutexLock lock(&mFastCacheMutex);
+    if (mFastCacheMap.isMapped())
+    {
+        mFastCacheMap.flush();
+    }
 }
 
 //mHeaderMutex is locked and mHeaderAPRFile is created before calling this.
@@ -1599,6 +1675,7 @@ void LLTextureCache::readHeaderCache()
             }
         }
     }
+    mapHeaderEntriesFile();
     mHeaderMutex.unlock();
 }
 
@@ -1629,6 +1706,16 @@ void LLTextureCache::clearCorruptedCache()
 
 void LLTextureCache::purgeAllTextures(bool purge_directories)
 {
+    // the mapped files are about to be deleted
+    bool remap_header = mHeaderMap.isMapped();
+    bool remap_fast_cache = false;
+    mHeaderMap.close();
+    {
+        LLMutexLock lock(&mFastCacheMutex);
+        remap_fast_cache = mFastCacheMap.isMapped();
+        mFastCacheMap.close();
+    }
+
     if (!mReadOnly)
     {
         const char* subdirs = "0123456789abcdef";
@@ -1664,6 +1751,16 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
     setEntriesHeader();
     writeEntriesHeader();
 
+    if (remap_header && !purge_directories)
+    {
+        mapHeaderEntriesFile();
+    }
+    if (remap_fast_cache && !purge_directories)
+    {
+        LLMutexLock lock(&mFastCacheMutex);
+        mapFastCache();
+    }
+
     LL_INFOS() << "The entire texture cache is cleared." << LL_ENDL ;
 }
 
@@ -2048,6 +2145,29 @@ LLPointer<LLImageRaw> LLTextureCache::readFromFastCache(const LLUUID& id, S32& d
     {
         LLMutexLock lock(&mFastCacheMutex);
 
+        if (mFastCacheMap.isMapped())
+        {
+            if (offset + TEXTURE_FAST_CACHE_ENTRY_SIZE > mFastCacheMap.getSize())
+            {
+                return NULL;
+            }
+            const U8* src = mFastCacheMap.getData() + offset;
+            memcpy(head, src, TEXTURE_FAST_CACHE_ENTRY_OVERHEAD);
+
+            S32 image_size = head[0] * head[1] * head[2];
+            if(image_size <= 0
+               || image_size > TEXTURE_FAST_CACHE_DATA_SIZE
+               || head[3] < 0) //invalid
+            {
+                return NULL;
+            }
+            discardlevel = head[3];
+
+            data = (U8*)ll_aligned_malloc_16(image_size);
+            memcpy(data, src + TEXTURE_FAST_CACHE_ENTRY_OVERHEAD, image_size);
+            return new LLImageRaw(data, head[0], head[1], head[2], true);
+        }
+
         openFastCache();
 
         mFastCachep->seek(APR_SET, offset);     
@@ -2145,6 +2265,15 @@ bool LLTextureCache::writeToFastCache(LLUUID image_id, S32 id, LLPointer<LLImage
     {
         LLMutexLock lock(&mFastCacheMutex);
 
+        if (mFastCacheMap.isMapped())
+        {
+            if ((size_t)offset + TEXTURE_FAST_CACHE_ENTRY_SIZE <= mFastCacheMap.getSize())
+            {
+                memcpy(mFastCacheMap.getData() + offset, mFastCachePadBuffer, TEXTURE_FAST_CACHE_ENTRY_SIZE);
+            }
+            return true;
+        }
+
         openFastCache();
 
         mFastCachep->seek(APR_SET, offset); 
@@ -2162,7 +2291,7 @@ bool LLTextureCache::writeToFastCache(LLUUID image_id, S32 id, LLPointer<LLImage
 
 void LLTextureCache::openFastCache(bool first_time)
 {
-    if(!mFastCachep)
+    if(!mFastCachep && !mFastCacheMap.isMapped())
     {
         if(first_time)
         {
@@ -2170,6 +2299,11 @@ void LLTextureCache::openFastCache(bool first_time)
             {
                 mFastCachePadBuffer = (U8*)ll_aligned_malloc_16(TEXTURE_FAST_CACHE_ENTRY_SIZE);
             }
+            mapFastCache();
+            if (mFastCacheMap.isMapped())
+            {
+                return;
+            }
             mFastCachePoolp = new LLVolatileAPRPool(); // is_local= true by default, so not thread safe by default
             if (LLAPRFile::isExist(mFastCacheFileName, mFastCachePoolp))
             {
@@ -2209,6 +2343,22 @@ void LLTextureCache::closeFastCache(bool forced)
     return;
 }
     
+//the fast cache entries are read and written in place through the mapping.
+//falls back to the APR file I/O if the file can not be mapped.
+void LLTextureCache::mapFastCache()
+{
+    if (!mUseMappedFiles || mReadOnly || mFastCacheMap.isMapped())
+    {
+        return;
+    }
+
+    size_t size = (size_t)sCacheMaxEntries * TEXTURE_FAST_CACHE_ENTRY_SIZE;
+    if (!mFastCacheMap.open(mFastCacheFileName, size))
+    {
+        LL_WARNS("TextureCache") << "Failed to map " << mFastCacheFileName << ", using file I/O" << LL_ENDL;
+    }
+}
+
 bool LLTextureCache::writeComplete(handle_t handle, bool abort)
 {
     lockWorkers();
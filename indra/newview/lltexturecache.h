@@ -28,6 +28,7 @@
 #define LL_LLTEXTURECACHE_H
 
 #include "lldir.h"
+#include "llmappedfile.h"
 #include "llstl.h"
 #include "llstring.h"
 #include "lluuid.h"
@@ -117,6 +118,9 @@ public:
     
     void purgeCache(ELLPath location, bool remove_dir = true);
     void setReadOnly(BOOL read_only) ;
+    // Access the header entries and fast cache files through memory mappings
+    // rather than per call file I/O. Must be called before initCache().
+    void setUseMappedFiles(bool use_mapped_files) { mUseMappedFiles = use_mapped_files; }
     S64 initCache(ELLPath location, S64 maxsize, BOOL texture_cache_mismatch);
 
     handle_t readFromCache(const std::string& local_filename, const LLUUID& id, U32 priority, S32 offset, S32 size,
@@ -183,11 +187,14 @@ private:
     S32 setHeaderCacheEntry(const LLUUID& id, Entry& entry, S32 imagesize, S32 datasize);
     void writeUpdatedEntries() ;
     void updatedHeaderEntriesFile() ;
+    void mapHeaderEntriesFile();
+    Entry* getMappedEntry(S32 idx);
     void lockHeaders() { mHeaderMutex.lock(); }
     void unlockHeaders() { mHeaderMutex.unlock(); }
     
     void openFastCache(bool first_time = false);
     void closeFastCache(bool forced = false);
+    void mapFastCache();
     bool writeToFastCache(LLUUID image_id, S32 cache_id, LLPointer<LLImageRaw> raw, S32 discardlevel);  
 
 private:
@@ -215,6 +222,7 @@ private:
     responder_list_t mCompletedList;
     
     BOOL mReadOnly;
+    bool mUseMappedFiles;
     
     // HEADERS (Include first mip)
     std::string mHeaderEntriesFileName;
@@ -225,10 +233,12 @@ private:
     std::set<LLUUID> mLRU;
     typedef std::map<LLUUID, S32> id_map_t;
     id_map_t mHeaderIDMap;
+    LLMappedFile mHeaderMap; // header entries file, when mUseMappedFiles, under mHeaderMutex
 
     LLAPRFile*   mFastCachep;
     LLFrameTimer mFastCacheTimer;
     U8*          mFastCachePadBuffer;
+    LLMappedFile mFastCacheMap; // under mFastCacheMutex, when mUseMappedFiles
 
     // BODIES (TEXTURES minus headers)
     std::string mTexturesDirName;
@@ -1806,7 +1806,20 @@ bool LLTextureFetchWorker::doWork(S32 param)
                 mRequestedOffset += src_offset;
             }
 
-            U8 * buffer = (U8 *)ll_aligned_malloc_16(total_size);
+            // A first fetch usually arrives in an aligned buffer of its
+            // own (see setBodyAllocator()), which becomes the image
+            // data as it is.  Otherwise copy out of the body.
+            U8 * buffer(NULL);
+            if (! cur_size && ! src_offset)
+            {
+                size_t detached_size(0);
+                buffer = (U8 *) mHttpBufferArray->detachBuffer(&detached_size);
+            }
+            const bool detached(buffer != NULL);
+            if (! detached)
+            {
+                buffer = (U8 *)ll_aligned_malloc_16(total_size);
+            }
             if (!buffer)
             {
                 // abort. If we have no space for packet, we have not enough space to decode image
@@ -1841,7 +1854,10 @@ bool LLTextureFetchWorker::doWork(S32 param)
                 // Copy previously collected data into buffer
                 memcpy(buffer, mFormattedImage->getData(), cur_size);
             }
-            mHttpBufferArray->read(src_offset, (char *) buffer + cur_size, append_size);
+            if (! detached)
+            {
+                mHttpBufferArray->read(src_offset, (char *) buffer + cur_size, append_size);
+            }
 
             // NOTE: setData releases current data and owns new data (buffer)
             mFormattedImage->setData(buffer, total_size);
@@ -2633,6 +2649,8 @@ LLTextureFetch::LLTextureFetch(LLTextureCache* cache, LLImageDecodeThread* image
     mHttpOptions = LLCore::HttpOptions::ptr_t(new LLCore::HttpOptions);
     mHttpOptionsWithHeaders = LLCore::HttpOptions::ptr_t(new LLCore::HttpOptions);
     mHttpOptionsWithHeaders->setWantHeaders(true);
+    mHttpOptions->setBodyAllocator(ll_aligned_malloc_16, ll_aligned_free_16);
+    mHttpOptionsWithHeaders->setBodyAllocator(ll_aligned_malloc_16, ll_aligned_free_16);
     mHttpHeaders = LLCore::HttpHeaders::ptr_t(new LLCore::HttpHeaders);
     mHttpHeaders->append(HTTP_OUT_HEADER_ACCEPT, HTTP_CONTENT_IMAGE_X_J2C);
     mHttpPolicyClass = app_core_http.getPolicy(LLAppCoreHttp::AP_TEXTURE);
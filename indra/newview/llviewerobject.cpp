@@ -104,6 +104,7 @@
 #include "llmediaentry.h"
 #include "llfloaterperms.h"
 #include "llvocache.h"
+#include "llobjectupdatedecoder.h"
 #include "llcleanup.h"
 #include "llcallstack.h"
 #include "llmeshrepository.h"
@@ -1555,8 +1556,17 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
                 }
 
                 // Unpack extra parameters
+                LLDecodedObjectUpdate* decoded = gObjectList.getDecodedUpdate(block_num, getLocalID(), OUT_FULL);
                 S32 size = mesgsys->getSizeFast(_PREHASH_ObjectData, block_num, _PREHASH_ExtraParams);
-                if (size > 0)
+                if (decoded && decoded->mExtraParamsValid)
+                {
+                    for (network_data_list_t::const_iterator it = decoded->mExtraParams.begin();
+                         it != decoded->mExtraParams.end(); ++it)
+                    {
+                        applyParameterEntry(it->first, *it->second);
+                    }
+                }
+                else if (size > 0)
                 {
                     U8 *buffer = new U8[size];
                     mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_ExtraParams, buffer, size, block_num);
@@ -1824,10 +1834,27 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
                 {
                     gFloaterTools->dirty();
                 }
-    
-                dp->unpackU32(crc, "CRC");
+
+                // The fields are read in one go, see LLCompressedObjectFields,
+                // by a worker thread already if LLObjectUpdateDecoder got to
+                // them.
+                LLDataPackerBinaryBuffer* data_dp = static_cast<LLDataPackerBinaryBuffer*>(dp);
+                LLDecodedObjectUpdate* decoded = update_type == OUT_FULL_COMPRESSED ?
+                    gObjectList.getDecodedUpdate(block_num, getLocalID(), update_type) : NULL;
+                LLCompressedObjectFields unpacked_fields;
+                const LLCompressedObjectFields* fields = &unpacked_fields;
+                if (decoded && decoded->mFieldsValid && data_dp->getCurrentSize() == decoded->mFields.mStart)
+                {
+                    fields = &decoded->mFields;
+                }
+                else
+                {
+                    unpacked_fields.unpack(*data_dp);
+                }
+
+                crc = fields->mCRC;
                 mTotalCRC = crc;
-                dp->unpackU8(material, "Material");
+                material = fields->mMaterial;
                 U8 old_material = getMaterial();
                 if (old_material != material)
                 {
@@ -1837,52 +1864,42 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
                         gPipeline.markMoved(mDrawable, FALSE); // undamped
                     }
                 }
-                dp->unpackU8(click_action, "ClickAction");
+                click_action = fields->mClickAction;
                 setClickAction(click_action);
-                dp->unpackVector3(new_scale, "Scale");
-                dp->unpackVector3(new_pos_parent, "Pos");
-                LLVector3 vec;
-                dp->unpackVector3(vec, "Rot");
-                new_rot.unpackFromVector3(vec);
+                new_scale = fields->mScale;
+                new_pos_parent = fields->mPos;
+                new_rot.unpackFromVector3(fields->mRot);
                 setAcceleration(LLVector3::zero);
 
-                U32 value;
-                dp->unpackU32(value, "SpecialCode");
+                U32 value = fields->mSpecialCode;
                 dp->setPassFlags(value);
-                dp->unpackUUID(owner_id, "Owner");
+                owner_id = fields->mOwnerID;
 
                 mOwnerID = owner_id;
 
                 if (value & 0x80)
                 {
-                    dp->unpackVector3(new_angv, "Omega");
+                    new_angv = fields->mAngularVelocity;
                     setAngularVelocity(new_angv);
                 }
 
-                if (value & 0x20)
-                {
-                    dp->unpackU32(parent_id, "ParentID");
-                }
-                else
-                {
-                    parent_id = 0;
-                }
+                parent_id = fields->mParentID;
 
-                S32 sp_size;
-                U32 size;
                 if (value & 0x2)
                 {
-                    sp_size = 1;
                     delete [] mData;
                     mData = new U8[1];
-                    dp->unpackU8(((U8*)mData)[0], "TreeData");
+                    ((U8*)mData)[0] = fields->mTreeData;
                 }
                 else if (value & 0x1)
                 {
-                    dp->unpackU32(size, "ScratchPadSize");
+                    U32 size = llmax(fields->mScratchPadSize, (U32)fields->mScratchPad.size());
                     delete [] mData;
                     mData = new U8[size];
-                    dp->unpackBinaryData((U8 *)mData, sp_size, "PartData");
+                    if (!fields->mScratchPad.empty())
+                    {
+                        memcpy(mData, &fields->mScratchPad[0], fields->mScratchPad.size());
+                    }
                 }
                 else
                 {
@@ -1897,10 +1914,8 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 
                 if (value & 0x4)
                 {
-                    std::string temp_string;
-                    dp->unpackString(temp_string, "Text");
-                    LLColor4U coloru;
-                    dp->unpackBinaryDataFixed(coloru.mV, 4, "Color");
+                    std::string temp_string = fields->mText;
+                    LLColor4U coloru = fields->mTextColor;
                     coloru.mV[3] = 255 - coloru.mV[3];
                     mText->setColor(LLColor4(coloru));
                     mText->setString(temp_string);
@@ -1926,11 +1941,7 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
                     mHudText.clear();
                 }
 
-                std::string media_url;
-                if (value & 0x200)
-                {
-                    dp->unpackString(media_url, "MediaURL");
-                }
+                std::string media_url = fields->mMediaURL;
                 retval |= checkMediaURL(media_url);
 
                 //
@@ -1938,6 +1949,7 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
                 //
                 if (value & 0x8)
                 {
+                    data_dp->shift(fields->mLegacyParticlesStart);
                     unpackParticleSource(*dp, owner_id, true);
                 }
                 else if (!(value & 0x400))
@@ -1953,18 +1965,10 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
                 }
 
                 // Unpack extra params
-                U8 num_parameters;
-                dp->unpackU8(num_parameters, "num_params");
-                U8 param_block[MAX_OBJECT_PARAMS_SIZE];
-                for (U8 param=0; param<num_parameters; ++param)
+                for (network_data_list_t::const_iterator it = fields->mExtraParams.begin();
+                     it != fields->mExtraParams.end(); ++it)
                 {
-                    U16 param_type;
-                    S32 param_size;
-                    dp->unpackU16(param_type, "param_type");
-                    dp->unpackBinaryData(param_block, param_size, "param_data");
-                    //LL_INFOS() << "Param type: " << param_type << ", Size: " << param_size << LL_ENDL;
-                    LLDataPackerBinaryBuffer dp2(param_block, param_size);
-                    unpackParameterEntry(param_type, &dp2);
+                    applyParameterEntry(it->first, *it->second);
                 }
 
                 for (iter = mExtraParameterList.begin(); iter != mExtraParameterList.end(); ++iter)
@@ -1978,20 +1982,20 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 
                 if (value & 0x10)
                 {
-                    dp->unpackUUID(sound_uuid, "SoundUUID");
-                    dp->unpackF32(gain, "SoundGain");
-                    dp->unpackU8(sound_flags, "SoundFlags");
-                    dp->unpackF32(cutoff, "SoundRadius");
+                    sound_uuid = fields->mSoundID;
+                    gain = fields->mSoundGain;
+                    sound_flags = fields->mSoundFlags;
+                    cutoff = fields->mSoundRadius;
                 }
 
                 if (value & 0x100)
                 {
-                    std::string name_value_list;
-                    dp->unpackString(name_value_list, "NV");
-
-                    setNameValueList(name_value_list);
+                    setNameValueList(fields->mNameValues);
                 }
 
+                // where a subclass goes on reading
+                data_dp->shift(fields->mEnd);
+
                 mTotalCRC = crc;
                 mSoundCutOffRadius = cutoff;
 
@@ -6012,7 +6016,94 @@ bool LLViewerObject::unpackParameterEntry(U16 param_type, LLDataPacker *dp)
     }
 }
 
-LLViewerObject::ExtraParameter* LLViewerObject::createNewParameterEntry(U16 param_type)
+S32 LLViewerObject::unpackTEBlock(LLMessageSystem* mesgsys, S32 block_num)
+{
+    LLDecodedObjectUpdate* decoded = gObjectList.getDecodedUpdate(block_num, getLocalID(), OUT_FULL);
+    if (!decoded)
+    {
+        return unpackTEMessage(mesgsys, _PREHASH_ObjectData, block_num);
+    }
+    return applyDecodedTE(decoded->mTEResult, decoded->mTE);
+}
+
+S32 LLViewerObject::applyDecodedTE(S32 result, LLTEContents& tec)
+{
+    if (!result || result == TEM_INVALID)
+    {
+        return result;
+    }
+    // decoded for every face, only apply the ones this object has
+    tec.face_count = llmin((U32)getNumTEs(), (U32)LLTEContents::MAX_TES);
+    return applyParsedTEMessage(tec);
+}
+
+bool LLViewerObject::applyParameterEntry(U16 param_type, const LLNetworkData& data)
+{
+    ExtraParameter* param = getExtraParameterEntryCreate(param_type);
+    if (param)
+    {
+        param->data->copy(data);
+        param->in_use = TRUE;
+        parameterChanged(param_type, param->data, TRUE, false);
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+// static
+bool LLViewerObject::decodeExtraParams(const U8* data, S32 size, network_data_list_t& params, S32* used_size)
+{
+    LLDataPackerBinaryBuffer dp(const_cast<U8*>(data), size);
+
+    U8 num_parameters;
+    bool valid = dp.unpackU8(num_parameters, "num_params");
+    U8 param_block[MAX_OBJECT_PARAMS_SIZE];
+    for (U8 param=0; valid && param<num_parameters; ++param)
+    {
+        U16 param_type;
+        S32 param_size;
+        valid = dp.unpackU16(param_type, "param_type") &&
+                dp.unpackS32(param_size, "param_size") &&
+                param_size >= 0 && param_size <= MAX_OBJECT_PARAMS_SIZE &&
+                dp.unpackBinaryDataFixed(param_block, param_size, "param_data");
+        if (!valid)
+        {
+            break;
+        }
+
+        if (LLNetworkData::PARAMS_MESH == param_type)
+        {
+            param_type = LLNetworkData::PARAMS_SCULPT;
+        }
+        LLNetworkData* block = createNetworkData(param_type);
+        if (block)
+        {
+            LLDataPackerBinaryBuffer dp2(param_block, param_size);
+            block->unpack(dp2);
+            params.push_back(std::make_pair(param_type, block));
+        }
+    }
+
+    if (!valid)
+    {
+        for (network_data_list_t::iterator it = params.begin(); it != params.end(); ++it)
+        {
+            delete it->second;
+        }
+        params.clear();
+    }
+    else if (used_size)
+    {
+        *used_size = dp.getCurrentSize();
+    }
+    return valid;
+}
+
+// static
+LLNetworkData* LLViewerObject::createNetworkData(U16 param_type)
 {
     LLNetworkData* new_block = NULL;
     switch (param_type)
@@ -6048,7 +6139,12 @@ LLViewerObject::ExtraParameter* LLViewerObject::createNewParameterEntry(U16 para
           break;
       }
     };
+    return new_block;
+}
 
+LLViewerObject::ExtraParameter* LLViewerObject::createNewParameterEntry(U16 param_type)
+{
+    LLNetworkData* new_block = createNetworkData(param_type);
     if (new_block)
     {
         ExtraParameter* new_entry = new ExtraParameter;
@@ -169,6 +169,13 @@ public:
                                         const EObjectUpdateType update_type,
                                         LLDataPacker *dp);
 
+    // TextureEntry of an ObjectData block, taken from the decoded update
+    // when the block was unpacked ahead by LLObjectUpdateDecoder
+    S32 unpackTEBlock(LLMessageSystem* mesgsys, S32 block_num);
+    // Applies a TextureEntry unpacked for LLTEContents::MAX_TES faces ahead,
+    // returns what unpackTEMessage() would have
+    S32 applyDecodedTE(S32 result, LLTEContents& tec);
+
 
     virtual BOOL    isActive() const; // Whether this object needs to do an idleUpdate.
     BOOL            onActiveList() const                {return mOnActiveList;}
@@ -598,6 +605,14 @@ public:
     void updateAvatarMeshVisibility(const LLUUID& id, const LLUUID& old_id);
     void refreshBakeTexture();
 public:
+    typedef std::vector<std::pair<U16, LLNetworkData*> > network_data_list_t;
+
+    // Unpacks an ExtraParams block into new parameter blocks, owned by the
+    // caller, without touching any object. False if the block is malformed.
+    // used_size, if given, is set to how much of data the block took up.
+    // Safe to call from any thread.
+    static bool decodeExtraParams(const U8* data, S32 size, network_data_list_t& params, S32* used_size = NULL);
+
     static void unpackVector3(LLDataPackerBinaryBuffer* dp, LLVector3& value, std::string name);
     static void unpackUUID(LLDataPackerBinaryBuffer* dp, LLUUID& value, std::string name);
     static void unpackU32(LLDataPackerBinaryBuffer* dp, U32& value, std::string name);
@@ -615,10 +630,12 @@ public:
     std::vector<LLVector3> mUnselectedChildrenPositions ;
 
 private:
+    static LLNetworkData* createNetworkData(U16 param_type);
     ExtraParameter* createNewParameterEntry(U16 param_type);
     ExtraParameter* getExtraParameterEntry(U16 param_type) const;
     ExtraParameter* getExtraParameterEntryCreate(U16 param_type);
     bool unpackParameterEntry(U16 param_type, LLDataPacker *dp);
+    bool applyParameterEntry(U16 param_type, const LLNetworkData& data);
 
     // This function checks to see if the given media URL has changed its version
     // and the update wasn't due to this agent's last action.
@@ -277,6 +277,7 @@ void LLViewerObjectList::processUpdateCore(LLViewerObject* objectp,
     if (just_created) 
     {
         gPipeline.addObject(objectp);
+        mObjectAddedSignal(objectp);
     }
 
     // Also sets the approx. pixel area
@@ -524,9 +525,21 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
     LLDataPackerBinaryBuffer compressed_dp(compressed_dpbuffer, 2048);
     LLViewerStatsRecorder& recorder = LLViewerStatsRecorder::instance();
 
+    // Full updates come in two phases: the texture entries, extra
+    // parameters and, for compressed ones, volume parameters of every block
+    // are unpacked first, partly on worker threads, then the loop below
+    // applies them object by object.
+    F64Seconds decode_share(0.0);
+    if (((!compressed && update_type == OUT_FULL) || (compressed && update_type == OUT_FULL_COMPRESSED)) && num_objects > 0)
+    {
+        LLTimer decode_timer;
+        mUpdateDecoder.decode(mesgsys, num_objects, update_type);
+        decode_share = F64Seconds(decode_timer.getElapsedTimeF64() / num_objects);
+    }
+
     for (i = 0; i < num_objects; i++)
     {
-        // timer is unused?
+        // main thread time spent on this update, for the stats
         LLTimer update_timer;
         BOOL justCreated = FALSE;
         S32 msg_size = 0;
@@ -773,8 +786,10 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
         }
         recorder.objectUpdateEvent(local_id, update_type, objectp, msg_size);
         objectp->setLastUpdateType(update_type);        
+        record(LLStatViewer::OBJECT_UPDATE_TIME, F64Seconds(update_timer.getElapsedTimeF64()) + decode_share);
     }
 
+    mUpdateDecoder.reset();
     recorder.log(0.2f);
 
     LLVOAvatar::cullAvatarsByPixelArea();
@@ -1039,6 +1054,9 @@ void LLViewerObjectList::update(LLAgent &agent)
         }
     }
 
+    // joints of the avatars updated above, all together
+    LLVOAvatar::updateJointHierarchies();
+
 
 
     fetchObjectCosts();
@@ -1422,6 +1440,7 @@ void LLViewerObjectList::cleanupReferences(LLViewerObject *objectp)
     if(new_dead_object)
     {
         mNumDeadObjects++;
+        mObjectRemovedSignal(objectp);
     }
 }
 
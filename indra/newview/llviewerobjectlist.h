@@ -36,6 +36,7 @@
 
 // project includes
 #include "llviewerobject.h"
+#include "llobjectupdatedecoder.h"
 #include "lleventcoro.h"
 #include "llcoros.h"
 
@@ -88,6 +89,12 @@ public:
     void processObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type, bool compressed=false);
     void processCompressedObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type);
     void processCachedObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type);
+    // Unpacked payloads of block_num while processObjectUpdate() applies a
+    // full update of update_type, NULL otherwise
+    LLDecodedObjectUpdate* getDecodedUpdate(S32 block_num, U32 local_id, EObjectUpdateType update_type) const
+    {
+        return mUpdateDecoder.getBlock(block_num, local_id, update_type);
+    }
     void updateApparentAngles(LLAgent &agent);
     void update(LLAgent &agent);
 
@@ -149,6 +156,12 @@ public:
     new_object_signal_t mNewObjectSignal;
     // </FS:CR>
 
+    // Objects entering the list, once their first update has been applied,
+    // and leaving it as they are marked dead
+    typedef boost::signals2::signal<void (LLViewerObject* object)> object_signal_t;
+    boost::signals2::connection setObjectAddedCallback(const object_signal_t::slot_type& cb)    { return mObjectAddedSignal.connect(cb); }
+    boost::signals2::connection setObjectRemovedCallback(const object_signal_t::slot_type& cb)  { return mObjectRemovedSignal.connect(cb); }
+
     ////////////////////////////////////////////
     //
     // Only accessed by markDead in LLViewerObject
@@ -236,6 +249,11 @@ protected:
 
     std::set<LLViewerObject *> mSelectPickList;
 
+    LLObjectUpdateDecoder mUpdateDecoder;
+
+    object_signal_t mObjectAddedSignal;
+    object_signal_t mObjectRemovedSignal;
+
     friend class LLViewerObject;
 
 private:
@@ -603,6 +603,7 @@ void LLViewerOctreeGroup::rebound()
     }
     
     clearState(DIRTY);
+    setState(BOUNDS_CHANGED);
 
     return;
 }
@@ -1344,6 +1345,309 @@ BOOL LLViewerOctreePartition::isOcclusionEnabled()
 }
 
 
+//-----------------------------------------------------------------------------------
+//class LLViewerOctreeBoundsArrays definitions
+//-----------------------------------------------------------------------------------
+
+LLViewerOctreeBoundsArrays::LLViewerOctreeBoundsArrays()
+    : mValid(false)
+{
+}
+
+void LLViewerOctreeBoundsArrays::sync(const OctreeNode* root)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_SPATIAL;
+    LLViewerOctreeGroup* group = (LLViewerOctreeGroup*) root->getListener(0);
+    if (!mValid || mGroups.empty() || mGroups[0] != group || !update(0))
+    {
+        rebuild(root);
+    }
+}
+
+void LLViewerOctreeBoundsArrays::clear()
+{
+    mGroups.clear();
+    mCenters.clear();
+    mRadii.clear();
+    mMin.clear();
+    mMax.clear();
+    mObjectCenters.clear();
+    mObjectRadii.clear();
+    mObjectMin.clear();
+    mObjectMax.clear();
+    mFirstChild.clear();
+    mChildCount.clear();
+    mFlags.clear();
+    mValid = false;
+}
+
+void LLViewerOctreeBoundsArrays::rebuild(const OctreeNode* root)
+{
+    clear();
+    mGroups.push_back((LLViewerOctreeGroup*) root->getListener(0));
+    // mGroups is the queue of the breadth first walk
+    for (size_t i = 0; i < mGroups.size(); i++)
+    {
+        const OctreeNode* node = mGroups[i]->mOctreeNode;
+        const U32 child_count = node->getChildCount();
+        mFirstChild.push_back((S32)mGroups.size());
+        mChildCount.push_back((U8)child_count);
+        for (U32 j = 0; j < child_count; j++)
+        {
+            mGroups.push_back((LLViewerOctreeGroup*) node->getChild(j)->getListener(0));
+        }
+    }
+
+    const size_t count = mGroups.size();
+    mCenters.resize(count);
+    mRadii.resize(count);
+    mMin.resize(count);
+    mMax.resize(count);
+    mObjectCenters.resize(count);
+    mObjectRadii.resize(count);
+    mObjectMin.resize(count);
+    mObjectMax.resize(count);
+    mFlags.resize(count);
+    for (S32 i = 0; i < (S32)count; i++)
+    {
+        copyGroup(i);
+    }
+    mValid = true;
+}
+
+// rebound() marks every group it changes, and it only ever changes a group
+// along with all its parents, so whatever changed is found below the changed
+// groups from the root down.
+bool LLViewerOctreeBoundsArrays::update(S32 index)
+{
+    LLViewerOctreeGroup* group = mGroups[index];
+    if (!group->hasState(LLViewerOctreeGroup::BOUNDS_CHANGED))
+    {
+        return true;
+    }
+
+    const OctreeNode* node = group->mOctreeNode;
+    const S32 first = mFirstChild[index];
+    const U32 child_count = node->getChildCount();
+    if (child_count != mChildCount[index])
+    {
+        return false;
+    }
+    for (U32 i = 0; i < child_count; i++)
+    {
+        if (node->getChild(i)->getListener(0) != mGroups[first + i])
+        {
+            return false;
+        }
+    }
+
+    copyGroup(index);
+    for (U32 i = 0; i < child_count; i++)
+    {
+        // rebound() of the parent sets or clears SKIP_FRUSTUM_CHECK of the
+        // children, changed or not
+        const LLViewerOctreeGroup* child = mGroups[first + i];
+        mFlags[first + i] = (mFlags[first + i] & ~SKIP_FRUSTUM_CHECK)
+            | (child->hasState(LLViewerOctreeGroup::SKIP_FRUSTUM_CHECK) ? SKIP_FRUSTUM_CHECK : 0);
+        if (!update(first + i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void LLViewerOctreeBoundsArrays::copyGroup(S32 index)
+{
+    LLViewerOctreeGroup* group = mGroups[index];
+    mCenters[index] = group->mBounds[0];
+    mRadii[index] = group->mBounds[1];
+    mMin[index] = group->mExtents[0];
+    mMax[index] = group->mExtents[1];
+    mObjectCenters[index] = group->mObjectBounds[0];
+    mObjectRadii[index] = group->mObjectBounds[1];
+    mObjectMin[index] = group->mObjectExtents[0];
+    mObjectMax[index] = group->mObjectExtents[1];
+    mFlags[index] = (group->hasState(LLViewerOctreeGroup::SKIP_FRUSTUM_CHECK) ? SKIP_FRUSTUM_CHECK : 0)
+        | (group->getElementCount() ? HAS_ELEMENTS : 0);
+    group->clearState(LLViewerOctreeGroup::BOUNDS_CHANGED);
+}
+
+//-----------------------------------------------------------------------------------
+//class LLViewerOctreePrecull definitions
+//-----------------------------------------------------------------------------------
+
+LLViewerOctreePrecull::LLViewerOctreePrecull()
+    : mCamera(NULL),
+    mSphereRadius(0.f),
+    mCheck(FRUSTUM),
+    mReady(false)
+{
+}
+
+void LLViewerOctreePrecull::setup(const LLCamera& camera, eFrustumCheck check)
+{
+    camera.getFrustumPlanes4(mPlanes, check != FRUSTUM);
+    mCamera = &camera;
+    mOrigin = camera.getOrigin();
+    mSphereRadius = camera.mFrustumCornerDist;
+    mCheck = check;
+    mReady = false;
+    mEntries.clear();
+}
+
+void LLViewerOctreePrecull::run(const OctreeNode* root)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_SPATIAL;
+    mEntries.clear();
+    mBounds.sync(root);
+
+    const S32 count = mBounds.getCount();
+    // only ever read after being written, parents first
+    mRes.resize(count);
+    mCrossed.resize(count);
+    mSphereCrossed.resize(count);
+    mSphereCrossed[0] = 0;
+
+    S32 res;
+    mPlanes.AABBInFrustum(&mBounds.mCenters[0], &mBounds.mRadii[0], 1, &res, &mCrossed[0]);
+    if (res && mCheck == FRUSTUM_NO_FAR_CLIP_SPHERE)
+    {
+        S32 sphere_res = checkSphere(mBounds.mMin[0], mBounds.mMax[0]);
+        mSphereCrossed[0] = (sphere_res == 1);
+        res = llmin(res, sphere_res);
+    }
+    mRes[0] = (S8)res;
+
+    // breadth first, the groups found in the frustum being the queue
+    mQueue.clear();
+    if (res)
+    {
+        mQueue.push_back(0);
+    }
+    for (size_t q = 0; q < mQueue.size(); q++)
+    {
+        checkChildren(mQueue[q]);
+    }
+
+    addEntries(0);
+    mReady = true;
+}
+
+void LLViewerOctreePrecull::clear()
+{
+    mEntries.clear();
+    mReady = false;
+}
+
+// The children of the group at index, 4 at a time, against the frustum
+// planes and the sphere the group crosses: it is inside everything else, and
+// so are they.
+void LLViewerOctreePrecull::checkChildren(S32 index)
+{
+    const S32 first = mBounds.mFirstChild[index];
+    const S32 end = first + mBounds.mChildCount[index];
+    if (mRes[index] == 2)
+    {
+        // fully in, so is everything below
+        for (S32 i = first; i < end; i++)
+        {
+            mRes[i] = 2;
+            mCrossed[i] = 0;
+            mSphereCrossed[i] = 0;
+            mQueue.push_back(i);
+        }
+        return;
+    }
+
+    const U32 crossed = mCrossed[index];
+    const bool sphere_crossed = mSphereCrossed[index] != 0;
+    for (S32 batch = first; batch < end; batch += 4)
+    {
+        const S32 batch_count = llmin(end - batch, 4);
+        S32 results[4];
+        mPlanes.AABBInFrustum(&mBounds.mCenters[batch], &mBounds.mRadii[batch], batch_count, results, &mCrossed[batch], crossed);
+        for (S32 j = 0; j < batch_count; j++)
+        {
+            const S32 i = batch + j;
+            mSphereCrossed[i] = 0;
+            if (mBounds.mFlags[i] & LLViewerOctreeBoundsArrays::SKIP_FRUSTUM_CHECK)
+            {
+                // same bounds as the parent
+                results[j] = 1;
+                mCrossed[i] = crossed;
+                mSphereCrossed[i] = sphere_crossed;
+            }
+            else if (results[j] && sphere_crossed)
+            {
+                S32 sphere_res = checkSphere(mBounds.mMin[i], mBounds.mMax[i]);
+                mSphereCrossed[i] = (sphere_res == 1);
+                results[j] = llmin(results[j], sphere_res);
+            }
+            mRes[i] = (S8)results[j];
+            if (results[j])
+            {
+                mQueue.push_back(i);
+            }
+        }
+    }
+}
+
+// The entries of the group at index and everything below it, in the order
+// LLViewerOctreeCull::traverse() visits them
+void LLViewerOctreePrecull::addEntries(S32 index)
+{
+    const S32 entry_index = (S32)mEntries.size();
+    Entry entry = { mBounds.mGroups[index], entry_index + 1, mRes[index], false };
+    mEntries.push_back(entry);
+    if (!entry.mRes)
+    {
+        // the traversal checks occlusion on this group and stops there
+        return;
+    }
+    mEntries[entry_index].mObjects = checkObjects(index);
+
+    const S32 first = mBounds.mFirstChild[index];
+    const S32 end = first + mBounds.mChildCount[index];
+    for (S32 i = first; i < end; i++)
+    {
+        addEntries(i);
+    }
+    mEntries[entry_index].mEnd = (S32)mEntries.size();
+}
+
+// AABBSphereIntersect() of the extents and the sphere through the far
+// corners of the frustum, as LLOctreeCull checks them
+S32 LLViewerOctreePrecull::checkSphere(const LLVector4a& min, const LLVector4a& max) const
+{
+    return AABBSphereIntersect(min, max, mOrigin, mSphereRadius);
+}
+
+// Same as LLViewerOctreeCull::checkObjects() with mRes of the group
+bool LLViewerOctreePrecull::checkObjects(S32 index) const
+{
+    if (!(mBounds.mFlags[index] & LLViewerOctreeBoundsArrays::HAS_ELEMENTS)) //no elements
+    {
+        return false;
+    }
+    else if (!mBounds.mChildCount[index]) //leaf state, already checked tightest bounding box
+    {
+        return true;
+    }
+    else if (mRes[index] == 1)
+    {
+        S32 objects_res;
+        mPlanes.AABBInFrustum(&mBounds.mObjectCenters[index], &mBounds.mObjectRadii[index], 1, &objects_res);
+        if (objects_res && mCheck == FRUSTUM_NO_FAR_CLIP_SPHERE)
+        {
+            objects_res = llmin(objects_res, checkSphere(mBounds.mObjectMin[index], mBounds.mObjectMax[index]));
+        }
+        return objects_res != 0;
+    }
+
+    return true;
+}
+
 //-----------------------------------------------------------------------------------
 //class LLViewerOctreeCull definitions
 //-----------------------------------------------------------------------------------
@@ -1382,6 +1686,31 @@ void LLViewerOctreeCull::traverse(const OctreeNode* n)
     }
 }
     
+void LLViewerOctreeCull::replay(const LLViewerOctreePrecull& precull)
+{
+    const LLViewerOctreePrecull::entry_list_t& entries = precull.getEntries();
+    const S32 count = (S32)entries.size();
+    for (S32 i = 0; i < count; )
+    {
+        const LLViewerOctreePrecull::Entry& entry = entries[i];
+        if (earlyFail(entry.mGroup) || !entry.mRes)
+        {
+            // skip the whole subtree
+            i = entry.mEnd;
+            continue;
+        }
+
+        mRes = entry.mRes;
+        preprocess(entry.mGroup);
+        if (entry.mObjects)
+        {
+            processGroup(entry.mGroup);
+        }
+        i++;
+    }
+    mRes = 0;
+}
+
 //------------------------------------------
 //agent space group culling
 S32 LLViewerOctreeCull::AABBInFrustumNoFarClipGroupBounds(const LLViewerOctreeGroup* group)
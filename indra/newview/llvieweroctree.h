@@ -183,6 +183,7 @@ class LLViewerOctreeGroup
 {
     LL_ALIGN_NEW
     friend class LLViewerOctreeCull;
+    friend class LLViewerOctreeBoundsArrays;
 protected:
     virtual ~LLViewerOctreeGroup();
 
@@ -194,7 +195,8 @@ public:
         OBJECT_DIRTY       = 0x00000002,
         SKIP_FRUSTUM_CHECK = 0x00000004,
         DEAD               = 0x00000008,
-        INVALID_STATE      = 0x00000010,
+        BOUNDS_CHANGED     = 0x00000010, // rebound() since LLViewerOctreeBoundsArrays::sync()
+        INVALID_STATE      = 0x00000020,
     };
 
 public:
@@ -365,6 +367,123 @@ public:
     U32              mLODPeriod;    //number of frames between LOD updates for a given spatial group (staggered by mLODSeed)
 };
 
+// The bounds of the groups of an octree copied into contiguous arrays, one
+// element per group, breadth first: the children of a group are next to
+// each other, after their parent. Culling walks these instead of chasing
+// the octree nodes and groups all over the heap.
+class LLViewerOctreeBoundsArrays
+{
+public:
+    enum
+    {
+        SKIP_FRUSTUM_CHECK = 0x01, // LLViewerOctreeGroup::SKIP_FRUSTUM_CHECK
+        HAS_ELEMENTS       = 0x02
+    };
+
+    LLViewerOctreeBoundsArrays();
+
+    // Bring the arrays up to date with the octree at root, after rebound()
+    // on it. Only the groups rebound() changed since the last sync() are
+    // copied again, and the arrays are rebuilt when the octree below them
+    // was split, collapsed or rebalanced. Any thread, as long as nothing
+    // else uses the octree meanwhile.
+    void sync(const OctreeNode* root);
+    // Copy everything again on the next sync(), for bounds moved by other
+    // means than rebound() (region shift)
+    void invalidate() { mValid = false; }
+    void clear();
+
+    S32 getCount() const { return (S32)mGroups.size(); }
+
+    std::vector<LLViewerOctreeGroup*> mGroups;
+    std::vector<LLVector4a> mCenters;           // LLViewerOctreeGroup::getBounds()
+    std::vector<LLVector4a> mRadii;
+    std::vector<LLVector4a> mMin;               // LLViewerOctreeGroup::getExtents()
+    std::vector<LLVector4a> mMax;
+    std::vector<LLVector4a> mObjectCenters;     // LLViewerOctreeGroup::getObjectBounds()
+    std::vector<LLVector4a> mObjectRadii;
+    std::vector<LLVector4a> mObjectMin;         // LLViewerOctreeGroup::getObjectExtents()
+    std::vector<LLVector4a> mObjectMax;
+    std::vector<S32>        mFirstChild;
+    std::vector<U8>         mChildCount;
+    std::vector<U8>         mFlags;
+
+private:
+    void rebuild(const OctreeNode* root);
+    // false when the children of the group at index changed
+    bool update(S32 index);
+    void copyGroup(S32 index);
+
+private:
+    bool mValid;
+};
+
+// The frustum checks of an LLViewerOctreeCull traversal, done ahead of it
+// so that the octrees of all partitions can be checked at once on worker
+// threads. run() works on the LLViewerOctreeBoundsArrays of the octree, one
+// level of it after the other, 4 groups at a time. Any thread may call it as
+// long as the octree is left alone meanwhile. The groups it reaches, in
+// traversal order, are then handed to LLViewerOctreeCull::replay() on the
+// main thread, which does the occlusion checks and everything else that
+// needs GL or the pipeline.
+class LLViewerOctreePrecull
+{
+public:
+    enum eFrustumCheck
+    {
+        FRUSTUM_NO_FAR_CLIP,        // frustum without its far plane
+        FRUSTUM_NO_FAR_CLIP_SPHERE, // same, and within the frustum corner distance
+        FRUSTUM                     // whole frustum
+    };
+
+    struct Entry
+    {
+        LLViewerOctreeGroup* mGroup;
+        S32  mEnd;      // index past the last entry below this group
+        S32  mRes;      // frustum check: 0 outside, 1 partly in, 2 fully in
+        bool mObjects;  // what LLViewerOctreeCull::checkObjects() returns
+    };
+    typedef std::vector<Entry> entry_list_t;
+
+    LLViewerOctreePrecull();
+
+    // Main thread, with the camera planes the traversal would use
+    void setup(const LLCamera& camera, eFrustumCheck check);
+    // Any thread
+    void run(const OctreeNode* root);
+    // True between run() and clear() for the given camera
+    bool isReady(const LLCamera& camera) const { return mReady && mCamera == &camera; }
+    void clear();
+    // The bounds of the octree moved without rebound()
+    void invalidateBounds() { mBounds.invalidate(); }
+
+    eFrustumCheck getFrustumCheck() const { return mCheck; }
+    const entry_list_t& getEntries() const { return mEntries; }
+
+private:
+    void checkChildren(S32 index);
+    void addEntries(S32 index);
+    S32  checkSphere(const LLVector4a& min, const LLVector4a& max) const;
+    bool checkObjects(S32 index) const;
+
+private:
+    LLFrustumPlanes4 mPlanes;
+    const LLCamera*  mCamera;
+    LLVector3        mOrigin;
+    F32              mSphereRadius;
+    eFrustumCheck    mCheck;
+    bool             mReady;
+    entry_list_t     mEntries;
+
+    LLViewerOctreeBoundsArrays mBounds;
+    // per group of mBounds: result of the frustum check, planes its bounds
+    // cross, whether its extents cross the sphere
+    std::vector<S8>  mRes;
+    std::vector<U32> mCrossed;
+    std::vector<U8>  mSphereCrossed;
+    std::vector<S32> mQueue;
+};
+
 class LLViewerOctreeCull : public OctreeTraveler
 {
 public:
@@ -373,6 +492,10 @@ public:
     
     virtual void traverse(const OctreeNode* n);
 
+    // Same as traverse() on the octree precull was run on, with the frustum
+    // checks already done
+    void replay(const LLViewerOctreePrecull& precull);
+
 protected:
     virtual bool earlyFail(LLViewerOctreeGroup* group); 
     
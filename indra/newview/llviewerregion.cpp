@@ -84,6 +84,7 @@
 #include "llsettingsdaycycle.h"
 
 #include <boost/regex.hpp>
+#include <unordered_map>
 
 #ifdef LL_WINDOWS
     #pragma warning(disable:4355)
@@ -104,6 +105,7 @@ BOOL LLViewerRegion::sVOCacheCullingEnabled = FALSE;
 S32  LLViewerRegion::sLastCameraUpdated = 0;
 S32  LLViewerRegion::sNewObjectCreationThrottle = -1;
 LLViewerRegion::vocache_entry_map_t LLViewerRegion::sRegionCacheCleanup;
+U32 LLViewerRegion::sCacheLoadCount = 0;
 
 typedef std::map<std::string, std::string> CapabilityMap;
 
@@ -208,6 +210,16 @@ public:
     LLVLComposition *mCompositionp;     // Composition layer for the surface
 
     LLVOCacheEntry::vocache_entry_map_t   mCacheMap; //all cached entries
+
+    // Cache probes received while the cache file is still loading, answered
+    // as the entries come in.
+    struct CacheProbe
+    {
+        U32 mCRC;
+        U32 mFlags;
+    };
+    typedef std::unordered_map<U32, CacheProbe> cache_probe_map_t;
+    cache_probe_map_t                     mPendingCacheProbes;
     LLVOCacheEntry::vocache_entry_set_t   mActiveSet; //all active entries;
     LLVOCacheEntry::vocache_entry_set_t   mWaitingSet; //entries waiting for LLDrawable to be generated.    
     std::set< LLPointer<LLViewerOctreeGroup> >      mVisibleGroups; //visible groupa
@@ -633,6 +645,8 @@ LLViewerRegion::LLViewerRegion(const U64 &handle,
     mViewerAssetUrl(""),
     mCacheLoaded(FALSE),
     mCacheDirty(FALSE),
+    mCacheLoading(false),
+    mCacheLoadID(0),
     mReleaseNotesRequested(FALSE),
     mCapabilitiesState(CAPABILITIES_STATE_INIT),
     mSimulatorFeaturesReceived(false),
@@ -785,14 +799,65 @@ void LLViewerRegion::loadObjectCache()
 
     if(LLVOCache::instanceExists())
     {
-        LLVOCache::getInstance()->readFromCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap) ;
-        if (mImpl->mCacheMap.empty())
+        // The entries arrive over the next frames, a block of the cache file
+        // at a time. This region may be gone or reloading by then.
+        const U64 handle = mHandle;
+        const U32 load_id = ++sCacheLoadCount;
+        mCacheLoadID = load_id;
+        mCacheLoading = true;
+        LLVOCache::getInstance()->readFromCache(mHandle, mImpl->mCacheID,
+            [handle, load_id](LLVOCacheEntry::vocache_entry_map_t& entries, bool done)
+            {
+                LLViewerRegion* regionp = LLWorld::getInstance()->getRegionFromHandle(handle);
+                if (regionp && regionp->mCacheLoadID == load_id)
+                {
+                    regionp->addCachedEntries(entries, done);
+                }
+            });
+    }
+}
+
+void LLViewerRegion::addCachedEntries(LLVOCacheEntry::vocache_entry_map_t& entries, bool done)
+{
+    for (LLVOCacheEntry::vocache_entry_map_t::iterator iter = entries.begin(); iter != entries.end(); ++iter)
+    {
+        // An update received during the load is newer than the cached copy
+        if (!mImpl->mCacheMap.insert(*iter).second)
         {
-            mCacheDirty = TRUE;
+            continue;
+        }
+
+        LLViewerRegionImpl::cache_probe_map_t::iterator probe = mImpl->mPendingCacheProbes.find(iter->first);
+        if (probe != mImpl->mPendingCacheProbes.end())
+        {
+            LLViewerRegionImpl::CacheProbe pending = probe->second;
+            mImpl->mPendingCacheProbes.erase(probe);
+
+            U8 cache_miss_type = CACHE_MISS_TYPE_NONE;
+            probeCache(iter->first, pending.mCRC, pending.mFlags, cache_miss_type);
         }
     }
-}
 
+    if (!done)
+    {
+        return;
+    }
+
+    mCacheLoading = false;
+    if (mImpl->mCacheMap.empty())
+    {
+        mCacheDirty = TRUE;
+    }
+
+    // Whatever is still waiting is not in the cache
+    LLViewerRegionImpl::cache_probe_map_t pending_probes;
+    pending_probes.swap(mImpl->mPendingCacheProbes);
+    for (LLViewerRegionImpl::cache_probe_map_t::iterator iter = pending_probes.begin(); iter != pending_probes.end(); ++iter)
+    {
+        U8 cache_miss_type = CACHE_MISS_TYPE_NONE;
+        probeCache(iter->first, iter->second.mCRC, iter->second.mFlags, cache_miss_type);
+    }
+}
 
 void LLViewerRegion::saveObjectCache()
 {
@@ -801,6 +866,16 @@ void LLViewerRegion::saveObjectCache()
         return;
     }
 
+    if (mCacheLoading)
+    {
+        // Writing now would drop the entries not read yet. Keep the file
+        // as it is and ignore the rest of the load.
+        mCacheLoading = false;
+        mCacheLoadID = 0;
+        mCacheDirty = FALSE;
+        mImpl->mPendingCacheProbes.clear();
+    }
+
     if (mImpl->mCacheMap.empty())
     {
         return;
@@ -1150,6 +1225,7 @@ void LLViewerRegion::killCacheEntry(LLVOCacheEntry* entry, bool for_rendering)
 //physically delete the cache entry 
 void LLViewerRegion::killCacheEntry(U32 local_id) 
 {
+    mImpl->mPendingCacheProbes.erase(local_id);
     killCacheEntry(getCacheEntry(local_id));
 }
 
@@ -2742,6 +2818,15 @@ bool LLViewerRegion::probeCache(U32 local_id, U32 crc, U32 flags, U8 &cache_miss
             cache_miss_type = CACHE_MISS_TYPE_CRC;
         }
     }
+    else if (mCacheLoading)
+    {
+        // The entry may still be on its way from the cache file
+        LLViewerRegionImpl::CacheProbe& probe = mImpl->mPendingCacheProbes[local_id];
+        probe.mCRC = crc;
+        probe.mFlags = flags;
+        cache_miss_type = CACHE_MISS_TYPE_NONE;
+        return true;
+    }
     else
     {
         // LL_INFOS() << "Cache miss for " << local_id << LL_ENDL;
@@ -3004,8 +3089,8 @@ void LLViewerRegion::unpackRegionHandshake()
     // off disk.
     loadObjectCache();
 
-    // After loading cache, signal that simulator can start
-    // sending data.
+    // Signal that simulator can start sending data. The cache may still be
+    // loading, probes for entries not read yet wait for them.
     // TODO: Send all upstream viewer->sim handshake info here.
     requestObjects(msg->getSender());
 
@@ -3029,7 +3114,7 @@ void LLViewerRegion::requestObjects(LLHost host)
     {
         flags |= 0x00000001; //set the bit 0 to be 1 to ask sim to send all cacheable objects.      
     }
-    if(mImpl->mCacheMap.empty())
+    if(mImpl->mCacheMap.empty() && !mCacheLoading)
     {
         flags |= 0x00000002; //set the bit 1 to be 1 to tell sim the cache file is empty, no need to send cache probes.
     }
@@ -107,6 +107,7 @@ public:
     // Call this after you have the region name and handle.
     void loadObjectCache();
     void saveObjectCache();
+    bool isCacheLoading() const { return mCacheLoading; }
     void requestObjects(LLHost host);
 
     void sendMessage(); // Send the current message to this region's simulator
@@ -535,6 +536,8 @@ private:
     // a structure of size 2^14 = 16,000
     BOOL                                    mCacheLoaded;
     BOOL                                    mCacheDirty;
+    bool                                    mCacheLoading; // cache file entries are still coming in
+    U32                                     mCacheLoadID;  // tells the current load from stale ones
     BOOL    mAlive;                 // can become false if circuit disconnects
     BOOL    mSimulatorFeaturesReceived;
     BOOL    mReleaseNotesRequested;
@@ -576,6 +579,9 @@ private:
 
     typedef std::map<U32, LLPointer<LLVOCacheEntry> >      vocache_entry_map_t;
     static vocache_entry_map_t sRegionCacheCleanup;
+    static U32 sCacheLoadCount;
+
+    void addCachedEntries(vocache_entry_map_t& entries, bool done); //entries read from the cache file
 
     // the materials capability throttle
     LLFrameTimer mMaterialsCapThrottleTimer;
@@ -207,6 +207,8 @@ LLTrace::EventStatHandle<F64Seconds >   AVATAR_EDIT_TIME("avataredittime", "Seco
 
 LLTrace::EventStatHandle<LLUnit<F32, LLUnits::Percent> > OBJECT_CACHE_HIT_RATE("object_cache_hits");
 
+LLTrace::EventStatHandle<F64Milliseconds >  OBJECT_UPDATE_TIME("object_update_time", "Main thread time spent applying each object update");
+
 LLTrace::EventStatHandle<F64Seconds >   TEXTURE_FETCH_TIME("texture_fetch_time");
 }
 
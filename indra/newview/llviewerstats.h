@@ -243,6 +243,8 @@ extern LLTrace::EventStatHandle<F64Seconds >    AVATAR_EDIT_TIME,
 
 extern LLTrace::EventStatHandle<LLUnit<F32, LLUnits::Percent> > OBJECT_CACHE_HIT_RATE;
 
+extern LLTrace::EventStatHandle<F64Milliseconds >   OBJECT_UPDATE_TIME;
+
 }
 
 class LLViewerStats : public LLSingleton<LLViewerStats>
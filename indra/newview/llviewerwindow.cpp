@@ -704,7 +704,7 @@ public:
             addText(xpos, ypos, llformat("%d Vertex Buffers", LLVertexBuffer::sGLCount));
             ypos += y_inc;
 
-            addText(xpos, ypos, llformat("%d Mapped Buffers", LLVertexBuffer::sMappedCount));
+            addText(xpos, ypos, llformat("%d Mapped Buffers", LLVertexBuffer::sMappedCount.load()));
             ypos += y_inc;
 
             addText(xpos, ypos, llformat("%d Vertex Buffer Binds", LLVertexBuffer::sBindCount));
@@ -643,6 +643,7 @@ bool LLVOAvatar::sLimitNonImpostors = false; // True unless RenderAvatarMaxNonIm
 F32 LLVOAvatar::sRenderDistance = 256.f;
 S32 LLVOAvatar::sNumVisibleAvatars = 0;
 S32 LLVOAvatar::sNumLODChangesThisFrame = 0;
+std::vector<LLPointer<LLVOAvatar> > LLVOAvatar::sPendingJointUpdates;
 
 const LLUUID LLVOAvatar::sStepSoundOnLand("e8af4a28-aa83-4310-a7c4-c047e15ea0df");
 const LLUUID LLVOAvatar::sStepSounds[LL_MCODE_END] =
@@ -692,6 +693,7 @@ LLVOAvatar::LLVOAvatar(const LLUUID& id,
     mReportedVisualComplexity(VISUAL_COMPLEXITY_UNKNOWN),
     mTurning(FALSE),
     mLastSkeletonSerialNum( 0 ),
+    mJointUpdatePending(false),
     mIsSitting(FALSE),
     mTimeVisible(),
     mTyping(FALSE),
@@ -1225,6 +1227,7 @@ void LLVOAvatar::initClass()
 
 void LLVOAvatar::cleanupClass()
 {
+    sPendingJointUpdates.clear();
 }
 
 // virtual
@@ -5156,7 +5159,21 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
     updateFootstepSounds();
 
     // Update child joints as needed.
-    mRoot->updateWorldMatrixChildren();
+    static LLCachedControl<bool> threaded_joint_update(gSavedSettings, "AvatarThreadedJointUpdate", true);
+    if (threaded_joint_update)
+    {
+        // Until then, whatever reads the joints brings them up to date
+        // itself, as when they are touched after this
+        if (!mJointUpdatePending)
+        {
+            mJointUpdatePending = true;
+            sPendingJointUpdates.push_back(this);
+        }
+    }
+    else
+    {
+        mRoot->updateWorldMatrixChildren();
+    }
 
     if (visible)
     {
@@ -5167,6 +5184,39 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
     return visible;
 }
 
+//-----------------------------------------------------------------------------
+// updateJointHierarchies()
+//-----------------------------------------------------------------------------
+//static
+void LLVOAvatar::updateJointHierarchies()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    if (sPendingJointUpdates.empty())
+    {
+        return;
+    }
+
+    std::vector<LLJointHierarchy*> hierarchies;
+    hierarchies.reserve(sPendingJointUpdates.size());
+    for (LLVOAvatar* avatar : sPendingJointUpdates)
+    {
+        avatar->mJointUpdatePending = false;
+        if (avatar->isDead() || !avatar->mRoot)
+        {
+            continue;
+        }
+        LLJointHierarchy& hierarchy = avatar->mJointHierarchy;
+        if (hierarchy.isStale() || hierarchy.getRoot() != avatar->mRoot)
+        {
+            hierarchy.build(avatar->mRoot);
+        }
+        hierarchies.push_back(&hierarchy);
+    }
+
+    LLJointHierarchy::updateAll(hierarchies);
+    sPendingJointUpdates.clear();
+}
+
 //-----------------------------------------------------------------------------
 // updateHeadOffset()
 //-----------------------------------------------------------------------------
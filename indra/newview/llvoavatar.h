@@ -40,6 +40,7 @@
 #include "lldrawpoolalpha.h"
 #include "llviewerobject.h"
 #include "llcharacter.h"
+#include "lljointhierarchy.h"
 #include "llcontrol.h"
 #include "llviewerjointmesh.h"
 #include "llviewerjointattachment.h"
@@ -429,6 +430,15 @@ public:
 
     S32                 mLastSkeletonSerialNum;
 
+    // Updates the joints of all the avatars whose updateCharacter() left it
+    // for later, several at a time
+    static void         updateJointHierarchies();
+
+private:
+    LLJointHierarchy    mJointHierarchy;
+    bool                mJointUpdatePending;
+    static std::vector<LLPointer<LLVOAvatar> > sPendingJointUpdates;
+
 
 /**                    Skeleton
  **                                                                            **
@@ -35,6 +35,14 @@
 #include "pipeline.h"
 #include "llagentcamera.h"
 #include "llmemory.h"
+#include "llapp.h"
+#include "llfile.h"
+#include "workqueue.h"
+#ifdef LL_USESYSTEMLIBS
+#include <zlib.h>
+#else
+#include "zlib-ng/zlib.h"
+#endif
 
 //static variables
 U32 LLVOCacheEntry::sMinFrameRange = 0;
@@ -99,71 +107,6 @@ LLVOCacheEntry::LLVOCacheEntry()
     mDP.assignBuffer(mBuffer, 0);
 }
 
-LLVOCacheEntry::LLVOCacheEntry(LLAPRFile* apr_file)
-:   LLViewerOctreeEntryData(LLViewerOctreeEntry::LLVOCACHEENTRY), 
-    mBuffer(NULL),
-    mUpdateFlags(-1),
-    mState(INACTIVE),
-    mSceneContrib(0.f),
-    mValid(FALSE),
-    mParentID(0),
-    mBSphereRadius(-1.0f)
-{
-    S32 size = -1;
-    BOOL success;
-    static U8 data_buffer[ENTRY_HEADER_SIZE];
-
-    mDP.assignBuffer(mBuffer, 0);
-
-    success = check_read(apr_file, (void *)data_buffer, ENTRY_HEADER_SIZE);
-    if (success)
-    {
-        memcpy(&mLocalID, data_buffer, sizeof(U32));
-        memcpy(&mCRC, data_buffer + sizeof(U32), sizeof(U32));
-        memcpy(&mHitCount, data_buffer + (2 * sizeof(U32)), sizeof(S32));
-        memcpy(&mDupeCount, data_buffer + (3 * sizeof(U32)), sizeof(S32));
-        memcpy(&mCRCChangeCount, data_buffer + (4 * sizeof(U32)), sizeof(S32));
-        memcpy(&size, data_buffer + (5 * sizeof(U32)), sizeof(S32));
-
-        // Corruption in the cache entries
-        if ((size > MAX_ENTRY_BODY_SIZE) || (size < 1))
-        {
-            // We've got a bogus size, skip reading it.
-            // We won't bother seeking, because the rest of this file
-            // is likely bogus, and will be tossed anyway.
-            LL_WARNS() << "Bogus cache entry, size " << size << ", aborting!" << LL_ENDL;
-            success = FALSE;
-        }
-    }
-    if(success && size > 0)
-    {
-        mBuffer = new U8[size];
-        success = check_read(apr_file, mBuffer, size);
-
-        if(success)
-        {
-            mDP.assignBuffer(mBuffer, size);
-        }
-        else
-        {
-            delete[] mBuffer ;
-            mBuffer = NULL ;
-        }
-    }
-
-    if(!success)
-    {
-        mLocalID = 0;
-        mCRC = 0;
-        mHitCount = 0;
-        mDupeCount = 0;
-        mCRCChangeCount = 0;
-        mBuffer = NULL;
-        mEntry = NULL;
-        mState = INACTIVE;
-    }
-}
-
 LLVOCacheEntry::~LLVOCacheEntry()
 {
     mDP.freeBuffer();
@@ -365,6 +308,45 @@ S32 LLVOCacheEntry::writeToBuffer(U8 *data_buffer) const
     return ENTRY_HEADER_SIZE + size;
 }
 
+S32 LLVOCacheEntry::readFromBuffer(const U8 *data_buffer, S32 buffer_size)
+{
+    S32 size = -1;
+
+    mDP.freeBuffer();
+    mBuffer = NULL;
+    mValid = FALSE;
+
+    if (buffer_size < ENTRY_HEADER_SIZE)
+    {
+        return 0;
+    }
+
+    memcpy(&mLocalID, data_buffer, sizeof(U32));
+    memcpy(&mCRC, data_buffer + sizeof(U32), sizeof(U32));
+    memcpy(&mHitCount, data_buffer + (2 * sizeof(U32)), sizeof(S32));
+    memcpy(&mDupeCount, data_buffer + (3 * sizeof(U32)), sizeof(S32));
+    memcpy(&mCRCChangeCount, data_buffer + (4 * sizeof(U32)), sizeof(S32));
+    memcpy(&size, data_buffer + (5 * sizeof(U32)), sizeof(S32));
+
+    // Corruption in the cache entries
+    if (!mLocalID || (size > MAX_ENTRY_BODY_SIZE) || (size < 1) || (size > buffer_size - ENTRY_HEADER_SIZE))
+    {
+        LL_WARNS() << "Bogus cache entry, size " << size << ", aborting!" << LL_ENDL;
+        mLocalID = 0;
+        mCRC = 0;
+        mHitCount = 0;
+        mDupeCount = 0;
+        mCRCChangeCount = 0;
+        return 0;
+    }
+
+    mBuffer = new U8[size];
+    memcpy(mBuffer, data_buffer + ENTRY_HEADER_SIZE, size);
+    mDP.assignBuffer(mBuffer, size);
+
+    return ENTRY_HEADER_SIZE + size;
+}
+
 //static 
 void LLVOCacheEntry::updateDebugSettings()
 {
@@ -1043,6 +1025,217 @@ const U32 INVALID_TIME = 0 ;
 const char* object_cache_dirname = "objectcache";
 const char* header_filename = "object.cache";
 
+// A region cache file holds the region ID and the number of entries followed
+// by blocks of whole entries. Each block is deflated on its own, so that the
+// entries of a block can be handed over to the main thread while the rest of
+// the file is still being read.
+const S32 BLOCK_RAW_SIZE = 64 * 1024;
+const S32 MAX_BLOCK_RAW_SIZE = BLOCK_RAW_SIZE + ENTRY_HEADER_SIZE + MAX_ENTRY_BODY_SIZE;
+const S32 BLOCK_HEADER_SIZE = 3 * sizeof(U32); // raw size, compressed size, number of entries
+
+struct LLVOCacheBlock
+{
+    LLVOCacheBlock() : mNumEntries(0) {}
+
+    std::vector<U8> mData;
+    S32             mNumEntries;
+};
+typedef std::vector<LLVOCacheBlock> vocache_block_vec_t;
+
+// Serialize entries into blocks, on the main thread since the entries are
+// owned by it. Returns the number of entries or -1 on failure.
+static S32 pack_cache_entries(const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, bool removal_enabled,
+                              vocache_block_vec_t& blocks)
+{
+    S32 num_entries = 0;
+    S32 size_in_block = 0;
+    for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); iter != cache_entry_map.end(); ++iter)
+    {
+        if (removal_enabled && !iter->second->isValid())
+        {
+            continue;
+        }
+
+        if (blocks.empty() || size_in_block >= BLOCK_RAW_SIZE)
+        {
+            if (!blocks.empty())
+            {
+                blocks.back().mData.resize(size_in_block);
+            }
+            blocks.push_back(LLVOCacheBlock());
+            blocks.back().mData.resize(MAX_BLOCK_RAW_SIZE);
+            size_in_block = 0;
+        }
+
+        LLVOCacheBlock& block = blocks.back();
+        S32 size = iter->second->writeToBuffer(&block.mData[size_in_block]);
+        if (size <= ENTRY_HEADER_SIZE) // body is minimum of 1
+        {
+            return -1;
+        }
+        size_in_block += size;
+        block.mNumEntries++;
+        num_entries++;
+    }
+
+    if (!blocks.empty())
+    {
+        blocks.back().mData.resize(size_in_block);
+    }
+    return num_entries;
+}
+
+// Compress and write a region cache file. Safe to call from any thread.
+static bool write_region_file(const std::string& filename, const LLUUID& id, S32 num_entries,
+                              const vocache_block_vec_t& blocks)
+{
+    LLFILE* fp = LLFile::fopen(filename, "wb");
+    if (!fp)
+    {
+        return false;
+    }
+
+    bool success = (fwrite(id.mData, 1, UUID_BYTES, fp) == UUID_BYTES)
+                   && (fwrite(&num_entries, sizeof(S32), 1, fp) == 1);
+
+    std::vector<U8> compressed;
+    for (vocache_block_vec_t::const_iterator iter = blocks.begin(); success && iter != blocks.end(); ++iter)
+    {
+        const LLVOCacheBlock& block = *iter;
+        uLongf compressed_size = compressBound((uLong)block.mData.size());
+        compressed.resize(compressed_size);
+        success = compress2(compressed.data(), &compressed_size, block.mData.data(), (uLong)block.mData.size(), Z_BEST_SPEED) == Z_OK;
+        if (success)
+        {
+            U32 block_header[3] = { (U32)block.mData.size(), (U32)compressed_size, (U32)block.mNumEntries };
+            success = (fwrite(block_header, 1, BLOCK_HEADER_SIZE, fp) == BLOCK_HEADER_SIZE)
+                      && (fwrite(compressed.data(), 1, compressed_size, fp) == compressed_size);
+        }
+    }
+
+    success = (LLFile::close(fp) == 0) && success;
+    if (!success)
+    {
+        LL_WARNS() << "Failed to write object cache file " << filename << LL_ENDL;
+        LLFile::remove(filename, ENOENT);
+    }
+    return success;
+}
+
+// Read a region cache file, passing the entries of each block to deliver as
+// soon as the block is decoded. Safe to call from any thread.
+static bool read_region_file(const std::string& filename, const LLUUID& id,
+                             const std::function<void(LLVOCacheEntry::vocache_entry_map_t&)>& deliver)
+{
+    LLFILE* fp = LLFile::fopen(filename, "rb");
+    if (!fp)
+    {
+        LL_WARNS() << "Failed to open object cache file " << filename << LL_ENDL;
+        return false;
+    }
+
+    LLUUID cache_id;
+    S32 num_entries = 0;
+    bool success = (fread(cache_id.mData, 1, UUID_BYTES, fp) == UUID_BYTES)
+                   && (fread(&num_entries, sizeof(S32), 1, fp) == 1);
+    if (success && cache_id != id)
+    {
+        LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
+        LLFile::close(fp);
+        return false;
+    }
+
+    const uLong max_compressed_size = compressBound(MAX_BLOCK_RAW_SIZE);
+    std::vector<U8> compressed;
+    std::vector<U8> raw;
+    S32 num_read = 0;
+    while (success && num_read < num_entries)
+    {
+        U32 block_header[3];
+        success = fread(block_header, 1, BLOCK_HEADER_SIZE, fp) == BLOCK_HEADER_SIZE;
+        if (!success)
+        {
+            break;
+        }
+
+        const U32 raw_size = block_header[0];
+        const U32 compressed_size = block_header[1];
+        const S32 block_entries = (S32)block_header[2];
+        if (raw_size <= (U32)ENTRY_HEADER_SIZE || raw_size > (U32)MAX_BLOCK_RAW_SIZE
+            || !compressed_size || compressed_size > max_compressed_size
+            || block_entries < 1 || block_entries > num_entries - num_read)
+        {
+            success = false;
+            break;
+        }
+
+        compressed.resize(compressed_size);
+        raw.resize(raw_size);
+        uLongf unpacked_size = raw_size;
+        success = (fread(compressed.data(), 1, compressed_size, fp) == compressed_size)
+                  && (uncompress(raw.data(), &unpacked_size, compressed.data(), compressed_size) == Z_OK)
+                  && (unpacked_size == raw_size);
+
+        LLVOCacheEntry::vocache_entry_map_t entries;
+        S32 offset = 0;
+        for (S32 i = 0; success && i < block_entries; i++)
+        {
+            LLPointer<LLVOCacheEntry> entry = new LLVOCacheEntry();
+            S32 size = entry->readFromBuffer(raw.data() + offset, (S32)raw_size - offset);
+            if (!size)
+            {
+                success = false;
+                break;
+            }
+            offset += size;
+            entries[entry->getLocalID()] = entry;
+        }
+        num_read += block_entries;
+
+        if (!entries.empty())
+        {
+            deliver(entries);
+        }
+    }
+    LLFile::close(fp);
+
+    if (!success)
+    {
+        LL_WARNS() << "Aborting cache file load for " << filename << ", cache file corruption!" << LL_ENDL;
+    }
+    return success;
+}
+
+// Run work on the "General" thread pool and then done on the main thread
+// with its result, or both right away when the pool cannot take it.
+static void run_cache_file_job(const std::function<bool()>& work, const std::function<void(bool)>& done)
+{
+    static LLCachedControl<bool> threaded_io(gSavedSettings, "ObjectCacheThreadedIO", true);
+
+    // During shutdown the pool may stop before the work ran
+    if (threaded_io && !LLApp::isExiting())
+    {
+        LL::WorkQueue::ptr_t main_queue = LL::WorkQueue::getInstance("mainloop");
+        LL::WorkQueue::ptr_t general_queue = LL::WorkQueue::getInstance("General");
+        if (main_queue && general_queue)
+        {
+            try
+            {
+                if (main_queue->postTo(general_queue, std::function<bool()>(work), std::function<void(bool)>(done)))
+                {
+                    return;
+                }
+            }
+            catch (const LL::WorkQueue::Closed&)
+            {
+            }
+        }
+    }
+
+    done(work());
+}
+
+
 
 LLVOCache::LLVOCache(bool read_only) :
     mInitialized(false),
@@ -1387,11 +1580,13 @@ BOOL LLVOCache::updateEntry(const HeaderEntryInfo* entry)
     return check_write(&apr_file, (void*)entry, sizeof(HeaderEntryInfo)) ;
 }
 
-void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) 
+void LLVOCache::readFromCache(U64 handle, const LLUUID& id, const read_callback_t& callback) 
 {
+    LLVOCacheEntry::vocache_entry_map_t no_entries;
     if(!mEnabled)
     {
         LL_WARNS() << "Not reading cache for handle " << handle << "): Cache is currently disabled." << LL_ENDL;
+        callback(no_entries, true);
         return ;
     }
     llassert_always(mInitialized);
@@ -1400,58 +1595,84 @@ void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::voca
     if(iter == mHandleEntryMap.end()) //no cache
     {
         LL_WARNS() << "No handle map entry for " << handle << LL_ENDL;
+        callback(no_entries, true);
         return ;
     }
 
-    bool success = true ;
-    {
-        std::string filename;
-        LLUUID cache_id;
-        getObjectCacheFilename(handle, filename);
-        LLAPRFile apr_file(filename, APR_READ|APR_BINARY, mLocalAPRFilePoolp);
-    
-        success = check_read(&apr_file, cache_id.mData, UUID_BYTES);
-    
-        if(success)
-        {       
-            if(cache_id != id)
-            {
-                LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
-                success = false ;
-            }
+    std::string filename;
+    getObjectCacheFilename(handle, filename);
 
-            if(success)
+    queueFileJob(handle, [handle, id, filename, callback]()
+    {
+        LL::WorkQueue::weak_t main_queue = LL::WorkQueue::getInstance("mainloop");
+        run_cache_file_job(
+            [id, filename, callback, main_queue]()
             {
-                S32 num_entries;  // if removal was enabled during write num_entries might be wrong
-                success = check_read(&apr_file, &num_entries, sizeof(S32)) ;
-    
-                if(success)
-                {
-                    for (S32 i = 0; i < num_entries && apr_file.eof() != APR_EOF; i++)
+                bool delivered = false;
+                bool success = read_region_file(filename, id,
+                    [&delivered, &callback, &main_queue](LLVOCacheEntry::vocache_entry_map_t& entries)
                     {
-                        LLPointer<LLVOCacheEntry> entry = new LLVOCacheEntry(&apr_file);
-                        if (!entry->getLocalID())
+                        delivered = true;
+                        if (on_main_thread())
                         {
-                            LL_WARNS() << "Aborting cache file load for " << filename << ", cache file corruption!" << LL_ENDL;
-                            success = false ;
-                            break ;
+                            callback(entries, false);
+                            return;
                         }
-                        cache_entry_map[entry->getLocalID()] = entry;
+                        // The entries are only touched by the main thread from here on
+                        std::shared_ptr<LLVOCacheEntry::vocache_entry_map_t> batch =
+                            std::make_shared<LLVOCacheEntry::vocache_entry_map_t>();
+                        batch->swap(entries);
+                        LL::WorkQueue::postMaybe(main_queue, [callback, batch]() { callback(*batch, false); });
+                    });
+                // Keep a damaged file if some of it could be used
+                return success || delivered;
+            },
+            [handle, callback](bool usable)
+            {
+                if (LLVOCache::instanceExists())
+                {
+                    LLVOCache* cache = LLVOCache::getInstance();
+                    if (!usable)
+                    {
+                        cache->removeEntry(handle);
                     }
+                    cache->fileJobDone(handle);
                 }
-            }
-        }       
+                LLVOCacheEntry::vocache_entry_map_t no_entries;
+                callback(no_entries, true);
+            });
+    });
+}
+
+void LLVOCache::queueFileJob(U64 handle, const file_job_t& job)
+{
+    std::deque<file_job_t>& jobs = mFileJobs[handle];
+    jobs.push_back(job);
+    if (jobs.size() == 1)
+    {
+        // Copy, a job that completes right away pops itself
+        file_job_t start = job;
+        start();
     }
-    
-    if(!success)
+}
+
+void LLVOCache::fileJobDone(U64 handle)
+{
+    file_job_map_t::iterator iter = mFileJobs.find(handle);
+    if (iter == mFileJobs.end())
     {
-        if(cache_entry_map.empty())
-        {
-            removeEntry(iter->second) ;
-        }
+        return;
     }
 
-    return ;
+    iter->second.pop_front();
+    if (iter->second.empty())
+    {
+        mFileJobs.erase(iter);
+        return;
+    }
+
+    file_job_t next = iter->second.front();
+    next();
 }
     
 void LLVOCache::purgeEntries(U32 size)
@@ -1524,74 +1745,39 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
         return ; //nothing changed, no need to update.
     }
 
-    //write to cache file
-    bool success = true ;
+    // Serialize the entries here since they belong to the main thread, then
+    // leave compressing and writing the file to the thread pool.
+    std::shared_ptr<vocache_block_vec_t> blocks = std::make_shared<vocache_block_vec_t>();
+    S32 num_entries = pack_cache_entries(cache_entry_map, removal_enabled, *blocks);
+    if (num_entries < 0)
     {
-        std::string filename;
-        getObjectCacheFilename(handle, filename);
-        // <FS> Fix bogus cache entry size warning
-        //LLAPRFile apr_file(filename, APR_CREATE|APR_WRITE|APR_BINARY|APR_TRUNCATE, mLocalAPRFilePoolp);
-        LLAPRFile apr_file(filename, APR_FOPEN_CREATE|APR_FOPEN_WRITE|APR_FOPEN_BINARY|APR_FOPEN_TRUNCATE, mLocalAPRFilePoolp);
-    
-        success = check_write(&apr_file, (void*)id.mData, UUID_BYTES);
-    
-        if(success)
-        {
-            S32 num_entries = cache_entry_map.size(); // if removal is enabled num_entries might be wrong
-            success = check_write(&apr_file, &num_entries, sizeof(S32));
-            if (success)
-            {
-                const S32 buffer_size = 32768; //should be large enough for couple MAX_ENTRY_BODY_SIZE
-                U8 data_buffer[buffer_size]; // generaly entries are fairly small, so collect them and drop onto disk in one go
-                S32 size_in_buffer = 0;
+        removeEntry(entry) ;
+        return ;
+    }
+
+    std::string filename;
+    getObjectCacheFilename(handle, filename);
 
-                // This can have a lot of entries, so might be better to dump them into buffer first and write in one go.
-                for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); success && iter != cache_entry_map.end(); ++iter)
+    queueFileJob(handle, [handle, id, filename, num_entries, blocks]()
+    {
+        run_cache_file_job(
+            [id, filename, num_entries, blocks]()
+            {
+                return write_region_file(filename, id, num_entries, *blocks);
+            },
+            [handle](bool success)
+            {
+                if (LLVOCache::instanceExists())
                 {
-                    if (!removal_enabled || iter->second->isValid())
+                    LLVOCache* cache = LLVOCache::getInstance();
+                    if (!success)
                     {
-                        S32 size = iter->second->writeToBuffer(data_buffer + size_in_buffer);
-
-                        if (size > ENTRY_HEADER_SIZE) // body is minimum of 1
-                        {
-                            size_in_buffer += size;
-                        }
-                        else
-                        {
-                            success = false;
-                            break;
-                        }
-
-                        // Make sure we have space in buffer for next element
-                        if (buffer_size - size_in_buffer < MAX_ENTRY_BODY_SIZE + ENTRY_HEADER_SIZE)
-                        {
-                            success = check_write(&apr_file, (void*)data_buffer, size_in_buffer);
-                            size_in_buffer = 0;
-                            if (!success)
-                            {
-                                break;
-                            }
-                        }
+                        cache->removeEntry(handle);
                     }
+                    cache->fileJobDone(handle);
                 }
-
-                if (success && size_in_buffer > 0)
-                {
-                    // final write
-                    success = check_write(&apr_file, (void*)data_buffer, size_in_buffer);
-                    size_in_buffer = 0;
-                }
-                
-                //paranoia
-                apr_file.flush();
-            }
-        }
-    }
-
-    if(!success)
-    {
-        removeEntry(entry) ;
-    }
+            });
+    });
 
     return ;
 }
@@ -33,6 +33,9 @@
 #include "llvieweroctree.h"
 #include "llapr.h"
 
+#include <deque>
+#include <functional>
+
 //---------------------------------------------------------------------------
 // Cache entries
 class LLCamera;
@@ -83,7 +86,6 @@ protected:
     ~LLVOCacheEntry();
 public:
     LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-    LLVOCacheEntry(LLAPRFile* apr_file);
     LLVOCacheEntry();   
 
     void updateEntry(U32 crc, LLDataPackerBinaryBuffer &dp);
@@ -107,6 +109,9 @@ public:
 
     void dump() const;
     S32 writeToBuffer(U8 *data_buffer) const;
+    // Read an entry written by writeToBuffer(), returns the number of bytes
+    // used or 0 if the data is damaged. The entry is left invalid.
+    S32 readFromBuffer(const U8 *data_buffer, S32 buffer_size);
     LLDataPackerBinaryBuffer *getDP();
 // [SL:KB] - Patch: World-Derender | Checked: 2014-08-10 (Catznip-3.7)
     const U8* getDPBuffer() const;
@@ -228,7 +233,8 @@ private:
 };
 
 //
-//Note: LLVOCache is not thread-safe
+//Note: LLVOCache is not thread-safe. Region cache files are read and written
+//on the "General" thread pool but all the bookkeeping stays on the main thread.
 //
 class LLVOCache : public LLParamSingleton<LLVOCache>
 {
@@ -272,7 +278,12 @@ public:
     void initCache(ELLPath location, U32 size, U32 cache_version);
     void removeCache(ELLPath location, bool started = false) ;
 
-    void readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) ;
+    // Called on the main thread with the entries of a region cache file, one
+    // block of the file at a time. The last call has done set and happens
+    // even when the region has no usable cache file.
+    typedef std::function<void(LLVOCacheEntry::vocache_entry_map_t& entries, bool done)> read_callback_t;
+
+    void readFromCache(U64 handle, const LLUUID& id, const read_callback_t& callback) ;
     void writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache, bool removal_enabled);
     void removeEntry(U64 handle) ;
 
@@ -291,6 +302,13 @@ private:
     void removeEntry(HeaderEntryInfo* entry) ;
     void purgeEntries(U32 size);
     BOOL updateEntry(const HeaderEntryInfo* entry);
+
+    // Reads and writes of one region file run one after the other, in the
+    // order they were requested. A job starts its I/O and calls
+    // fileJobDone() once it is over.
+    typedef std::function<void()> file_job_t;
+    void queueFileJob(U64 handle, const file_job_t& job);
+    void fileJobDone(U64 handle);
     
 private:
     bool                 mEnabled;
@@ -304,6 +322,9 @@ private:
     LLVolatileAPRPool*   mLocalAPRFilePoolp ;   
     header_entry_queue_t mHeaderEntryQueue;
     handle_entry_map_t   mHandleEntryMap;   
+
+    typedef std::map<U64, std::deque<file_job_t> > file_job_map_t;
+    file_job_map_t       mFileJobs; // the front job of each region is running
 };
 
 #endif
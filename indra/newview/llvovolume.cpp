@@ -30,6 +30,7 @@
 
 #include "llvovolume.h"
 
+#include <algorithm>
 #include <sstream>
 
 #include "llviewercontrol.h"
@@ -88,6 +89,7 @@
 #include "llcallstack.h"
 #include "llsculptidsize.h"
 #include "llavatarappearancedefines.h"
+#include "workqueue.h"
 
 //MK
 #include "llagent.h"
@@ -459,7 +461,7 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
         // Unpack texture entry data
         //
 
-        S32 result = unpackTEMessage(mesgsys, _PREHASH_ObjectData, (S32) block_num);
+        S32 result = unpackTEBlock(mesgsys, (S32) block_num);
         //<FS:Beq> Improved bad object handling courtesy of Drake.
         if (TEM_INVALID == result)
         {
@@ -497,8 +499,26 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
     {
         if (update_type != OUT_TERSE_IMPROVED)
         {
-            LLVolumeParams volume_params;
-            BOOL res = LLVolumeMessage::unpackVolumeParams(&volume_params, *dp);
+            // Read in one go, see LLCompressedVolumeFields, by a worker
+            // thread already if LLObjectUpdateDecoder got to them
+            LLDataPackerBinaryBuffer* data_dp = static_cast<LLDataPackerBinaryBuffer*>(dp);
+            LLDecodedObjectUpdate* decoded = update_type == OUT_FULL_COMPRESSED ?
+                gObjectList.getDecodedUpdate(block_num, getLocalID(), update_type) : NULL;
+            LLCompressedVolumeFields* fields;
+            std::unique_ptr<LLCompressedVolumeFields> unpacked_fields;
+            if (decoded && decoded->mVolumeFieldsValid && data_dp->getCurrentSize() == decoded->mVolumeFields.mStart)
+            {
+                fields = &decoded->mVolumeFields;
+            }
+            else
+            {
+                unpacked_fields.reset(new LLCompressedVolumeFields);
+                unpacked_fields->unpack(*data_dp);
+                fields = unpacked_fields.get();
+            }
+
+            LLVolumeParams volume_params = fields->mVolumeParams;
+            BOOL res = fields->mVolumeParamsValid;
             if (!res)
             {
                 //<FS:Beq> Improved bad object handling courtesy of Drake.
@@ -537,7 +557,7 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
             {
                 markForUpdate(TRUE);
             }
-            S32 res2 = unpackTEMessage(*dp);
+            S32 res2 = applyDecodedTE(fields->mTEResult, fields->mTE);
             if (TEM_INVALID == res2)
             {
                 // There's something bogus in the data that we're unpacking.
@@ -6312,6 +6332,138 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
 
 }
 
+namespace
+{
+    // Don't bother the general queue for fewer faces than this per thread
+    const S32 MIN_FACES_PER_HELPER = 64;
+    const S32 MAX_MESH_HELPERS = 4;
+
+    void flush_face_buffers(LLSpatialGroup* group)
+    {
+        for (LLSpatialGroup::element_iter drawable_iter = group->getDataBegin(); drawable_iter != group->getDataEnd(); ++drawable_iter)
+        {
+            LLDrawable* drawablep = (LLDrawable*)(*drawable_iter)->getDrawable();
+            if(!drawablep)
+            {
+                continue;
+            }
+            for (S32 i = 0; i < drawablep->getNumFaces(); ++i)
+            {
+                LLFace* face = drawablep->getFace(i);
+                if (face)
+                {
+                    LLVertexBuffer* buff = face->getVertexBuffer();
+                    if (buff && buff->isLocked())
+                    {
+                        buff->flush();
+                    }
+                }
+            }
+        }
+    }
+
+    struct MeshFace
+    {
+        LLFace* mFace;
+        LLVolume* mVolume;
+        LLVOVolume* mObject;
+        LLSpatialGroup* mGroup;
+        // all of the face, not only what its drawable's flags say
+        bool mForceRebuild;
+    };
+
+    // faces rebuildGeom() left for endFaceWrites()
+    bool sQueueFaceWrites = false;
+    std::vector<MeshFace> sQueuedFaces;
+
+    // getGeometryVolume() generates missing tangents, and the volume may be
+    // shared with other objects, so that is done before the face is queued
+    void gen_shared_tangents(LLFace* face, LLVolume* volume, LLVertexBuffer* buff)
+    {
+        const S32 te = face->getTEOffset();
+        const LLTextureEntry* tep = face->getTextureEntry();
+        if (te < volume->getNumVolumeFaces()
+            && (buff->hasDataType(LLVertexBuffer::TYPE_TANGENT)
+                || (tep && (tep->getBumpmap() || tep->getTexGen() != LLTextureEntry::TEX_GEN_DEFAULT))))
+        {
+            volume->genTangents(te);
+        }
+    }
+
+    // Writes the face to the client copy of its vertex buffer, false if
+    // the buffer is too small for it
+    bool write_mesh_face(const MeshFace& mesh_face)
+    {
+        LLFace* face = mesh_face.mFace;
+        return face->getGeometryVolume(*mesh_face.mVolume, face->getTEOffset(),
+            mesh_face.mObject->getRelativeXform(), mesh_face.mObject->getRelativeXformInvTrans(), face->getGeomIndex(),
+            mesh_face.mForceRebuild);
+    }
+
+    // Writes the faces, those of each vertex buffer on a single thread, and
+    // uploads the buffers
+    void write_mesh_faces(std::vector<MeshFace>& faces)
+    {
+        // sorted by buffer so that each buffer is only ever mapped and written
+        // by one thread
+        std::stable_sort(faces.begin(), faces.end(),
+            [](const MeshFace& lhs, const MeshFace& rhs) { return lhs.mFace->getVertexBuffer() < rhs.mFace->getVertexBuffer(); });
+        std::vector<S32> buffer_start;
+        for (S32 i = 0; i < (S32)faces.size(); ++i)
+        {
+            if (!i || faces[i].mFace->getVertexBuffer() != faces[i - 1].mFace->getVertexBuffer())
+            {
+                buffer_start.push_back(i);
+            }
+        }
+        const S32 buffer_count = (S32)buffer_start.size();
+        buffer_start.push_back((S32)faces.size());
+        std::vector<U8> failed(faces.size(), 0);
+
+        {
+            LL_PROFILE_ZONE_NAMED("write_mesh_faces - write");
+            LL::parallelFor(buffer_count, llmin((S32)faces.size() / MIN_FACES_PER_HELPER - 1, MAX_MESH_HELPERS),
+                [&faces, &buffer_start, &failed](S32 i)
+                {
+                    for (S32 j = buffer_start[i]; j < buffer_start[i + 1]; ++j)
+                    {
+                        failed[j] = !write_mesh_face(faces[j]);
+                    }
+                });
+        }
+
+        for (size_t i = 0; i < faces.size(); ++i)
+        {
+            if (!failed[i])
+            {
+                continue;
+            }
+            if (faces[i].mForceRebuild)
+            { //the group was just rebuilt for this buffer
+                LL_WARNS() << "Failed to get geometry for face!" << LL_ENDL;
+            }
+            else
+            { //something's gone wrong with the vertex buffer accounting, rebuild this group
+                faces[i].mGroup->dirtyGeom();
+                gPipeline.markRebuild(faces[i].mGroup, TRUE);
+            }
+        }
+
+        {
+            LL_PROFILE_ZONE_NAMED("write_mesh_faces - flush");
+            // uploads the client copies the faces were written to
+            for (S32 i = 0; i < buffer_count; ++i)
+            {
+                LLVertexBuffer* buff = faces[buffer_start[i]].mFace->getVertexBuffer();
+                if (buff->isLocked())
+                {
+                    buff->flush();
+                }
+            }
+        }
+    }
+}
+
 void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
@@ -6416,31 +6568,169 @@ void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
             if(num_mapped_vertex_buffer != LLVertexBuffer::sMappedCount)
             {
                 LL_WARNS() << "Not all mapped vertex buffers are unmapped!" << LL_ENDL ;
-                for (LLSpatialGroup::element_iter drawable_iter = group->getDataBegin(); drawable_iter != group->getDataEnd(); ++drawable_iter)
+                flush_face_buffers(group);
+            }
+
+            group->clearState(LLSpatialGroup::MESH_DIRTY | LLSpatialGroup::NEW_DRAWINFO);
+        }
+    } 
+}
+
+//static
+void LLVolumeGeometryManager::rebuildMeshes(const LLSpatialGroup::sg_vector_t& groups)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+    static LLCachedControl<bool> use_transform_feedback(gSavedSettings, "RenderUseTransformFeedback", false);
+    if (use_transform_feedback)
+    { //feedback writes buffers with GL calls
+        for (LLSpatialGroup* group : groups)
+        {
+            group->rebuildMesh();
+        }
+        return;
+    }
+
+    S32 num_mapped_vertex_buffer = LLVertexBuffer::sMappedCount;
+
+    std::vector<MeshFace> faces;
+    std::vector<LLSpatialGroup*> rebuilt_groups;
+    std::vector<LLDrawable*> rebuilt_drawables;
+    std::vector<LLVertexBuffer*> locked_buffers;
+
+    for (LLSpatialGroup* group : groups)
+    {
+        if (group->isDead() || !group->hasState(LLSpatialGroup::MESH_DIRTY) || group->hasState(LLSpatialGroup::GEOM_DIRTY))
+        {
+            continue;
+        }
+        if (!dynamic_cast<LLVolumeGeometryManager*>(group->getSpatialPartition()))
+        {
+            group->rebuildMesh();
+            continue;
+        }
+
+        group->mBuilt = 1.f;
+        rebuilt_groups.push_back(group);
+        // any later copy of the group in the list is already handled here
+        group->clearState(LLSpatialGroup::MESH_DIRTY | LLSpatialGroup::NEW_DRAWINFO);
+
+        for (LLSpatialGroup::element_iter drawable_iter = group->getDataBegin(); drawable_iter != group->getDataEnd(); ++drawable_iter)
+        {
+            LLDrawable* drawablep = (LLDrawable*)(*drawable_iter)->getDrawable();
+
+            if (!drawablep || drawablep->isDead() || !drawablep->isState(LLDrawable::REBUILD_ALL))
+            {
+                continue;
+            }
+
+            LLVOVolume* vobj = drawablep->getVOVolume();
+            if (!vobj || vobj->isNoLOD())
+            {
+                continue;
+            }
+
+            vobj->preRebuild();
+
+            // the relative transform of animated children only holds while
+            // they are written here
+            bool animated_child = drawablep->isState(LLDrawable::ANIMATED_CHILD);
+            if (animated_child)
+            {
+                vobj->updateRelativeXform(true);
+            }
+
+            LLVolume* volume = vobj->getVolume();
+            for (S32 i = 0; volume && i < drawablep->getNumFaces(); ++i)
+            {
+                LLFace* face = drawablep->getFace(i);
+                LLVertexBuffer* buff = face ? face->getVertexBuffer() : NULL;
+                if (!buff)
                 {
-                    LLDrawable* drawablep = (LLDrawable*)(*drawable_iter)->getDrawable();
-                    if(!drawablep)
-                    {
-                        continue;
+                    continue;
+                }
+
+                if (animated_child || !buff->hasClientCopy())
+                {
+                    if (!face->getGeometryVolume(*volume, face->getTEOffset(),
+                        vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), face->getGeomIndex()))
+                    { //something's gone wrong with the vertex buffer accounting, rebuild this group
+                        group->dirtyGeom();
+                        gPipeline.markRebuild(group, TRUE);
                     }
-                    for (S32 i = 0; i < drawablep->getNumFaces(); ++i)
+                    if (buff->isLocked())
                     {
-                        LLFace* face = drawablep->getFace(i);
-                        if (face)
-                        {
-                            LLVertexBuffer* buff = face->getVertexBuffer();
-                            if (buff && buff->isLocked())
-                            {
-                                buff->flush();
-                            }
-                        }
+                        locked_buffers.push_back(buff);
                     }
+                    continue;
                 }
+
+                gen_shared_tangents(face, volume, buff);
+                MeshFace mesh_face = { face, volume, vobj, group, false };
+                faces.push_back(mesh_face);
             }
 
-            group->clearState(LLSpatialGroup::MESH_DIRTY | LLSpatialGroup::NEW_DRAWINFO);
+            if (animated_child)
+            {
+                vobj->updateRelativeXform();
+            }
+
+            // the flags tell getGeometryVolume() what to rebuild
+            rebuilt_drawables.push_back(drawablep);
         }
-    } 
+    }
+
+    write_mesh_faces(faces);
+
+    for (LLDrawable* drawablep : rebuilt_drawables)
+    {
+        drawablep->clearState(LLDrawable::REBUILD_ALL);
+    }
+
+    {
+        LL_PROFILE_ZONE_NAMED("rebuildMeshes - flush");
+        for (LLVertexBuffer* buff : locked_buffers)
+        {
+            if (buff->isLocked())
+            {
+                buff->flush();
+            }
+        }
+        // don't forget alpha
+        for (LLSpatialGroup* group : rebuilt_groups)
+        {
+            if (group->mVertexBuffer.notNull() && group->mVertexBuffer->isLocked())
+            {
+                group->mVertexBuffer->flush();
+            }
+        }
+    }
+
+    //if not all buffers are unmapped
+    if (num_mapped_vertex_buffer != LLVertexBuffer::sMappedCount)
+    {
+        LL_WARNS() << "Not all mapped vertex buffers are unmapped!" << LL_ENDL;
+        for (LLSpatialGroup* group : rebuilt_groups)
+        {
+            flush_face_buffers(group);
+        }
+    }
+}
+
+//static
+void LLVolumeGeometryManager::beginFaceWrites()
+{
+    llassert(sQueuedFaces.empty());
+    sQueueFaceWrites = true;
+}
+
+//static
+void LLVolumeGeometryManager::endFaceWrites()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+    sQueueFaceWrites = false;
+    std::vector<MeshFace> faces;
+    faces.swap(sQueuedFaces);
+    write_mesh_faces(faces);
 }
 
 struct CompareBatchBreaker
@@ -6777,6 +7067,8 @@ U32 LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace
 
         U32 indices_index = 0;
         U16 index_offset = 0;
+        // endFaceWrites() flushes the buffer then
+        bool queued = false;
 
         while (face_iter < i)
         {
@@ -6809,22 +7101,35 @@ U32 LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace
                     LLVOVolume* vobj = drawablep->getVOVolume();
                     LLVolume* volume = vobj->getVolume();
 
-                    if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
+                    // the client copy can be written off the main thread, unless
+                    // feedback writes it or the transform only holds right now
+                    if (sQueueFaceWrites && !use_transform_feedback && buffer->hasClientCopy()
+                        && !drawablep->isState(LLDrawable::ANIMATED_CHILD))
                     {
-                        vobj->updateRelativeXform(true);
+                        gen_shared_tangents(facep, volume, buffer);
+                        MeshFace mesh_face = { facep, volume, vobj, group, true };
+                        sQueuedFaces.push_back(mesh_face);
+                        queued = true;
                     }
+                    else
+                    {
+                        if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
+                        {
+                            vobj->updateRelativeXform(true);
+                        }
 
-                    U32 te_idx = facep->getTEOffset();
+                        U32 te_idx = facep->getTEOffset();
 
-                    if (!facep->getGeometryVolume(*volume, te_idx, 
-                        vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), index_offset,true))
-                    {
-                        LL_WARNS() << "Failed to get geometry for face!" << LL_ENDL;
-                    }
+                        if (!facep->getGeometryVolume(*volume, te_idx, 
+                            vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), index_offset,true))
+                        {
+                            LL_WARNS() << "Failed to get geometry for face!" << LL_ENDL;
+                        }
 
-                    if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
-                    {
-                        vobj->updateRelativeXform(false);
+                        if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
+                        {
+                            vobj->updateRelativeXform(false);
+                        }
                     }
                 }
             }
@@ -7121,7 +7426,7 @@ U32 LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace
             ++face_iter;
         }
 
-        if (buffer)
+        if (buffer && !queued)
         {
             buffer->flush();
         }
@@ -452,6 +452,7 @@ void LLPipeline::init()
     LLVertexBuffer::sUseStreamDraw = gSavedSettings.getBOOL("RenderUseStreamVBO");
     LLVertexBuffer::sUseVAO = gSavedSettings.getBOOL("RenderUseVAO");
     LLVertexBuffer::sPreferStreamDraw = gSavedSettings.getBOOL("RenderPreferStreamDraw");
+    LLVertexBuffer::sUseStreamBuffer = gSavedSettings.getBOOL("RenderStreamBuffer");
     sRenderAttachedLights = gSavedSettings.getBOOL("RenderAttachedLights");
     sRenderAttachedParticles = gSavedSettings.getBOOL("RenderAttachedParticles");
 
@@ -2392,6 +2393,26 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, LLPlane* pla
 
     sCull->clear();
 
+    static LLCachedControl<bool> parallel_cull(gSavedSettings, "RenderParallelCull", true);
+    if (parallel_cull)
+    {
+        // frustum check every partition at once, part->cull(camera) below
+        // then only has what needs the main thread left to do
+        std::vector<LLSpatialPartition*> partitions;
+        for (LLViewerRegion* region : LLWorld::getInstance()->getRegionList())
+        {
+            for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
+            {
+                LLSpatialPartition* part = region->getSpatialPartition(i);
+                if (part && hasRenderType(part->mDrawableType))
+                {
+                    partitions.push_back(part);
+                }
+            }
+        }
+        LLSpatialPartition::precull(partitions, camera);
+    }
+
     bool to_texture = LLPipeline::sUseOcclusion > 1 && gPipeline.shadersLoaded();
 
     if (to_texture)
@@ -2872,6 +2893,12 @@ void LLPipeline::rebuildPriorityGroups()
 
     gMeshRepo.notifyLoadedMeshes();
 
+    static LLCachedControl<bool> threaded_mesh_rebuild(gSavedSettings, "RenderThreadedMeshRebuild", true);
+    if (threaded_mesh_rebuild)
+    {
+        LLVolumeGeometryManager::beginFaceWrites();
+    }
+
     mGroupQ1Locked = true;
     // Iterate through all drawables on the priority build queue,
     for (LLSpatialGroup::sg_vector_t::iterator iter = mGroupQ1.begin();
@@ -2882,6 +2909,11 @@ void LLPipeline::rebuildPriorityGroups()
         group->clearState(LLSpatialGroup::IN_BUILD_Q1);
     }
 
+    if (threaded_mesh_rebuild)
+    {
+        LLVolumeGeometryManager::endFaceWrites();
+    }
+
     mGroupSaveQ1 = mGroupQ1;
     mGroupQ1.clear();
     mGroupQ1Locked = false;
@@ -2908,6 +2940,12 @@ void LLPipeline::rebuildGroups()
     LLSpatialGroup::sg_vector_t::iterator iter;
     LLSpatialGroup::sg_vector_t::iterator last_iter = mGroupQ2.begin();
 
+    static LLCachedControl<bool> threaded_mesh_rebuild(gSavedSettings, "RenderThreadedMeshRebuild", true);
+    if (threaded_mesh_rebuild)
+    {
+        LLVolumeGeometryManager::beginFaceWrites();
+    }
+
     for (iter = mGroupQ2.begin();
          iter != mGroupQ2.end() && count <= min_count; ++iter)
     {
@@ -2927,6 +2965,11 @@ void LLPipeline::rebuildGroups()
         group->clearState(LLSpatialGroup::IN_BUILD_Q2);
     }   
 
+    if (threaded_mesh_rebuild)
+    {
+        LLVolumeGeometryManager::endFaceWrites();
+    }
+
     mGroupQ2.erase(mGroupQ2.begin(), ++last_iter);
 
     mGroupQ2Locked = false;
@@ -3918,9 +3961,17 @@ void LLPipeline::postSort(LLCamera& camera)
     }*/
 
     //pack vertex buffers for groups that chose to delay their updates
-    for (LLSpatialGroup::sg_vector_t::iterator iter = mMeshDirtyGroup.begin(); iter != mMeshDirtyGroup.end(); ++iter)
+    static LLCachedControl<bool> threaded_mesh_rebuild(gSavedSettings, "RenderThreadedMeshRebuild", true);
+    if (threaded_mesh_rebuild)
+    {
+        LLVolumeGeometryManager::rebuildMeshes(mMeshDirtyGroup);
+    }
+    else
     {
-        (*iter)->rebuildMesh();
+        for (LLSpatialGroup::sg_vector_t::iterator iter = mMeshDirtyGroup.begin(); iter != mMeshDirtyGroup.end(); ++iter)
+        {
+            (*iter)->rebuildMesh();
+        }
     }
 
     /*if (use_transform_feedback)
@@ -7388,6 +7439,7 @@ void LLPipeline::doResetVertexBuffers(bool forced)
     LLVertexBuffer::sUseStreamDraw = gSavedSettings.getBOOL("RenderUseStreamVBO");
     LLVertexBuffer::sUseVAO = gSavedSettings.getBOOL("RenderUseVAO");
     LLVertexBuffer::sPreferStreamDraw = gSavedSettings.getBOOL("RenderPreferStreamDraw");
+    LLVertexBuffer::sUseStreamBuffer = gSavedSettings.getBOOL("RenderStreamBuffer");
     LLVertexBuffer::sEnableVBOs = gSavedSettings.getBOOL("RenderVBOEnable");
     LLVertexBuffer::sDisableVBOMapping = LLVertexBuffer::sEnableVBOs && gSavedSettings.getBOOL("RenderVBOMappingDisable") ;
     sBakeSunlight = gSavedSettings.getBOOL("RenderBakeSunlight");
@@ -0,0 +1,362 @@
+/**
+ * @file RRRestrictionIndex_test.cpp
+ * @brief RRRestrictionIndex test cases, checking every decision against
+ *        the linear scans of the restriction map it replaces.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../test/lltut.h"
+
+#include "../RRRestrictionIndex.h"
+
+#include "llstring.h"
+
+#include <cstdlib>
+#include <map>
+
+namespace
+{
+    typedef std::multimap<std::string, std::string> RRMAP;
+
+    // The checks as RRInterface made them before the index, scanning the
+    // whole map each time
+    struct ReferenceEngine
+    {
+        RRMAP mMap;
+
+        bool isAllowed(const std::string& object, const std::string& action)
+        {
+            RRMAP::iterator it = mMap.find(object);
+            while (it != mMap.end() && it != mMap.upper_bound(object))
+            {
+                if (it->second == action)
+                {
+                    return false;
+                }
+                it++;
+            }
+            return true;
+        }
+
+        bool contains(std::string action)
+        {
+            LLStringUtil::toLower(action);
+            for (RRMAP::iterator it = mMap.begin(); it != mMap.end(); ++it)
+            {
+                if (it->second == action)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool containsSubstr(std::string action)
+        {
+            LLStringUtil::toLower(action);
+            for (RRMAP::iterator it = mMap.begin(); it != mMap.end(); ++it)
+            {
+                if (!it->second.find(action))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool containsWithoutException(std::string action, std::string except, bool permissive)
+        {
+            LLStringUtil::toLower(action);
+            std::string action_sec = action + "_sec";
+            if (except == "")
+            {
+                return contains(action) || contains(action_sec);
+            }
+            for (RRMAP::iterator it = mMap.begin(); it != mMap.end(); ++it)
+            {
+                if (it->second == action_sec || (it->second == action && permissive))
+                {
+                    if (isAllowed(it->first, action + ":" + except) && isAllowed(it->first, action_sec + ":" + except))
+                    {
+                        return true;
+                    }
+                }
+            }
+            if (contains(action))
+            {
+                if (!contains(action + ":" + except) && !contains(action_sec + ":" + except))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    // Keeps the map and the index in step the way RRInterface does
+    struct Engines
+    {
+        ReferenceEngine mReference;
+        RRRestrictionIndex mIndex;
+
+        void insert(const std::string& object, const std::string& behav)
+        {
+            mReference.mMap.insert(std::make_pair(object, behav));
+            mIndex.add(object, behav);
+        }
+
+        void erase(RRMAP::iterator it)
+        {
+            mIndex.remove(it->first, it->second);
+            mReference.mMap.erase(it);
+        }
+
+        // RRInterface::add()
+        void add(const std::string& object, const std::string& behav)
+        {
+            if (mReference.isAllowed(object, behav))
+            {
+                insert(object, behav);
+            }
+        }
+
+        // RRInterface::remove()
+        void remove(const std::string& object, const std::string& behav)
+        {
+            RRMAP::iterator it = mReference.mMap.find(object);
+            while (it != mReference.mMap.end() && it != mReference.mMap.upper_bound(object))
+            {
+                if (it->second == behav)
+                {
+                    erase(it);
+                    return;
+                }
+                it++;
+            }
+        }
+
+        // RRInterface::clear()
+        void clear(const std::string& object, const std::string& command)
+        {
+            RRMAP::iterator it = mReference.mMap.begin();
+            while (it != mReference.mMap.end())
+            {
+                if (it->first == object && (command == "" || it->second.find(command) != std::string::npos))
+                {
+                    erase(it);
+                    it = mReference.mMap.begin();
+                }
+                else
+                {
+                    it++;
+                }
+            }
+        }
+
+        // RRInterface::replace(), which does not check for duplicates
+        void replace(const std::string& what, const std::string& by)
+        {
+            for (RRMAP::iterator it = mReference.mMap.begin(); it != mReference.mMap.end(); ++it)
+            {
+                if (it->first == what)
+                {
+                    insert(by, it->second);
+                }
+            }
+            clear(what, "");
+        }
+    };
+
+    const char* OBJECTS[] =
+    {
+        "00000000-0000-0000-0000-000000000000",
+        "11111111-1111-1111-1111-111111111111",
+        "22222222-2222-2222-2222-222222222222",
+        "33333333-3333-3333-3333-333333333333",
+        "44444444-4444-4444-4444-444444444444",
+    };
+    const S32 NUM_OBJECTS = sizeof(OBJECTS) / sizeof(OBJECTS[0]);
+
+    const char* ACTIONS[] = { "sendim", "recvim", "edit", "tplure", "detach", "showinv" };
+    const S32 NUM_ACTIONS = sizeof(ACTIONS) / sizeof(ACTIONS[0]);
+
+    const char* EXCEPTIONS[] =
+    {
+        "aaaaaaaa-aaaa-aaaa-aaaa-aaaaaaaaaaaa",
+        "bbbbbbbb-bbbb-bbbb-bbbb-bbbbbbbbbbbb",
+        "Group Name",
+    };
+    const S32 NUM_EXCEPTIONS = sizeof(EXCEPTIONS) / sizeof(EXCEPTIONS[0]);
+
+    // A restriction, its secure version or an exception to either
+    std::string randomBehaviour()
+    {
+        std::string behav = ACTIONS[rand() % NUM_ACTIONS];
+        switch (rand() % 5)
+        {
+        case 0:
+            return behav;
+        case 1:
+            return behav + "_sec";
+        case 2:
+            return behav + ":" + EXCEPTIONS[rand() % NUM_EXCEPTIONS];
+        case 3:
+            return behav + "_sec:" + EXCEPTIONS[rand() % NUM_EXCEPTIONS];
+        default:
+            return rand() % 2 ? "permissive" : "notify:2222;" + behav;
+        }
+    }
+}
+
+namespace tut
+{
+    struct RRRestrictionIndexFixture
+    {
+        Engines mEngines;
+
+        // Every query the viewer makes, compared between both engines
+        void compare(const std::string& when)
+        {
+            ReferenceEngine& ref = mEngines.mReference;
+            RRRestrictionIndex& index = mEngines.mIndex;
+            ensure_equals(when + " size", index.size(), ref.mMap.size());
+            bool permissive = ref.contains("permissive");
+            for (S32 a = 0; a < NUM_ACTIONS; ++a)
+            {
+                std::string action = ACTIONS[a];
+                ensure_equals(when + " contains " + action, index.contains(action), ref.contains(action));
+                ensure_equals(when + " prefix " + action, index.containsPrefix(action), ref.containsSubstr(action));
+                ensure_equals(when + " prefix " + action + ":", index.containsPrefix(action + ":"), ref.containsSubstr(action + ":"));
+                ensure_equals(when + " without exception " + action,
+                              index.contains(action) || index.contains(action + "_sec"),
+                              ref.containsWithoutException(action, "", permissive));
+                for (S32 e = 0; e < NUM_EXCEPTIONS; ++e)
+                {
+                    std::string except = EXCEPTIONS[e];
+                    ensure_equals(when + " without exception " + action + " " + except,
+                                  index.containsWithoutException(action, except, permissive),
+                                  ref.containsWithoutException(action, except, permissive));
+                    for (S32 o = 0; o < NUM_OBJECTS; ++o)
+                    {
+                        std::string behav = action + ":" + except;
+                        ensure_equals(when + " allowed " + behav, !index.objectHas(OBJECTS[o], behav), ref.isAllowed(OBJECTS[o], behav));
+                    }
+                }
+                for (S32 o = 0; o < NUM_OBJECTS; ++o)
+                {
+                    ensure_equals(when + " allowed " + action, !index.objectHas(OBJECTS[o], action), ref.isAllowed(OBJECTS[o], action));
+                    ensure_equals(when + " allowed " + action + "_sec", !index.objectHas(OBJECTS[o], action + "_sec"),
+                                  ref.isAllowed(OBJECTS[o], action + "_sec"));
+                }
+            }
+            ensure_equals(when + " prefix notify", index.containsPrefix("notify"), ref.containsSubstr("notify"));
+            ensure_equals(when + " prefix everything", index.containsPrefix(""), ref.containsSubstr(""));
+        }
+    };
+    typedef test_group<RRRestrictionIndexFixture> RRRestrictionIndex_factory;
+    typedef RRRestrictionIndex_factory::object RRRestrictionIndex_t;
+    RRRestrictionIndex_factory tf("RRRestrictionIndex");
+
+    template<> template<>
+    void RRRestrictionIndex_t::test<1>()
+    {
+        set_test_name("exceptions");
+        const std::string holder = OBJECTS[1];
+        const std::string other = OBJECTS[2];
+        const std::string friend_id = EXCEPTIONS[0];
+        RRRestrictionIndex& index = mEngines.mIndex;
+
+        mEngines.add(holder, "sendim");
+        ensure("restricted", index.containsWithoutException("sendim", friend_id, false));
+        mEngines.add(other, "sendim:" + friend_id);
+        ensure("exception from any object", !index.containsWithoutException("sendim", friend_id, false));
+        ensure("permissive needs the same object", index.containsWithoutException("sendim", friend_id, true));
+        mEngines.add(holder, "sendim_sec");
+        ensure("secure needs the same object", index.containsWithoutException("sendim", friend_id, false));
+        mEngines.add(holder, "sendim:" + friend_id);
+        ensure("same object exception", !index.containsWithoutException("sendim", friend_id, true));
+        ensure("other exceptions do not count", index.containsWithoutException("sendim", EXCEPTIONS[1], false));
+        compare("exceptions");
+
+        mEngines.clear(holder, "");
+        mEngines.clear(other, "");
+        ensure("cleared", index.size() == 0 && !index.containsPrefix(""));
+    }
+
+    template<> template<>
+    void RRRestrictionIndex_t::test<2>()
+    {
+        set_test_name("duplicates from replace");
+        const std::string what = OBJECTS[1];
+        const std::string by = OBJECTS[2];
+        RRRestrictionIndex& index = mEngines.mIndex;
+
+        mEngines.add(what, "detach");
+        mEngines.add(by, "detach");
+        mEngines.replace(what, by);
+        ensure_equals("duplicate kept", index.size(), 2U);
+        mEngines.remove(by, "detach");
+        ensure("one left", index.objectHas(by, "detach") && index.contains("detach"));
+        ensure("old object gone", !index.objectHas(what, "detach"));
+        mEngines.remove(by, "detach");
+        ensure("none left", !index.contains("detach") && index.size() == 0);
+        compare("replace");
+    }
+
+    template<> template<>
+    void RRRestrictionIndex_t::test<3>()
+    {
+        set_test_name("random commands match the linear scans");
+        srand(2022);
+        for (S32 i = 0; i < 4000; ++i)
+        {
+            S32 object_num = rand() % NUM_OBJECTS;
+            std::string object = OBJECTS[object_num];
+            S32 command = rand() % 20;
+            if (command < 11)
+            {
+                mEngines.add(object, randomBehaviour());
+            }
+            else if (command < 18)
+            {
+                mEngines.remove(object, randomBehaviour());
+            }
+            else if (command < 19)
+            {
+                // @clear with and without a filter
+                mEngines.clear(object, rand() % 2 ? "" : ACTIONS[rand() % NUM_ACTIONS]);
+            }
+            else
+            {
+                // never onto itself, the copies would be found again
+                mEngines.replace(object, OBJECTS[(object_num + 1 + rand() % (NUM_OBJECTS - 1)) % NUM_OBJECTS]);
+            }
+            if (i % 50 == 0)
+            {
+                compare(llformat("step %d", i));
+            }
+        }
+        compare("end");
+    }
+}
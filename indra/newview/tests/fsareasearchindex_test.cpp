@@ -0,0 +1,196 @@
+/**
+ * @file fsareasearchindex_test.cpp
+ * @brief FSAreaSearchIndex test cases, checking every search against a
+ *        case insensitive scan of the stored text.
+ *
+ * $LicenseInfo:firstyear=2022&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2022, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../test/lltut.h"
+
+#include "../fsareasearchindex.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <boost/algorithm/string/find.hpp>
+
+namespace
+{
+    typedef std::map<LLUUID, std::string> texts_t;
+
+    const char* WORDS[] = { "Chair", "chair", "Sofa", "TABLE", "Lamp", "door", "Résumé", "abc", "ab", "x" };
+    const S32 NUM_WORDS = sizeof(WORDS) / sizeof(WORDS[0]);
+
+    const char* QUERIES[] = { "", "a", "ch", "CHA", "chair", "air ", "sofa table", "lamp", "zzz", "Résumé", "RÉS", "b", "abc" };
+    const S32 NUM_QUERIES = sizeof(QUERIES) / sizeof(QUERIES[0]);
+
+    std::string randomText()
+    {
+        std::string text;
+        S32 words = rand() % 4;
+        for (S32 i = 0; i < words; ++i)
+        {
+            if (i)
+            {
+                text += " ";
+            }
+            text += WORDS[rand() % NUM_WORDS];
+        }
+        return text;
+    }
+
+    uuid_vec_t sorted(uuid_vec_t ids)
+    {
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+}
+
+namespace tut
+{
+    struct FSAreaSearchIndexFixture
+    {
+        FSAreaSearchIndex mIndex;
+        // what the index should hold, per field
+        texts_t mTexts[FSAreaSearchIndex::FIELD_COUNT];
+
+        void set(const LLUUID& id, FSAreaSearchIndex::EField field, const std::string& text)
+        {
+            mIndex.setField(id, field, text);
+            mTexts[field][id] = text;
+            for (S32 other = 0; other < FSAreaSearchIndex::FIELD_COUNT; ++other)
+            {
+                // known objects have every field, empty until set
+                mTexts[other].insert(std::make_pair(id, std::string()));
+            }
+        }
+
+        void remove(const LLUUID& id)
+        {
+            mIndex.remove(id);
+            for (S32 field = 0; field < FSAreaSearchIndex::FIELD_COUNT; ++field)
+            {
+                mTexts[field].erase(id);
+            }
+        }
+
+        void compare(const std::string& when)
+        {
+            ensure_equals(when + " size", mIndex.size(), mTexts[0].size());
+            for (S32 field = 0; field < FSAreaSearchIndex::FIELD_COUNT; ++field)
+            {
+                const texts_t& texts = mTexts[field];
+                for (S32 q = 0; q < NUM_QUERIES; ++q)
+                {
+                    std::string query = QUERIES[q];
+                    uuid_vec_t expected;
+                    for (texts_t::const_iterator it = texts.begin(); it != texts.end(); ++it)
+                    {
+                        bool found = query.empty() || !boost::ifind_first(it->second, query).empty();
+                        if (found)
+                        {
+                            expected.push_back(it->first);
+                        }
+                        ensure_equals(when + " contains " + query, mIndex.contains(it->first, (FSAreaSearchIndex::EField)field, query), found);
+                        ensure_equals(when + " field", mIndex.getField(it->first, (FSAreaSearchIndex::EField)field), it->second);
+                    }
+                    uuid_vec_t found;
+                    mIndex.find((FSAreaSearchIndex::EField)field, query, found);
+                    ensure("find " + query + " " + when, sorted(found) == expected);
+                }
+            }
+        }
+    };
+    typedef test_group<FSAreaSearchIndexFixture> FSAreaSearchIndex_factory;
+    typedef FSAreaSearchIndex_factory::object FSAreaSearchIndex_t;
+    FSAreaSearchIndex_factory tf("FSAreaSearchIndex");
+
+    template<> template<>
+    void FSAreaSearchIndex_t::test<1>()
+    {
+        set_test_name("fields");
+        LLUUID chair, sofa;
+        chair.generate();
+        sofa.generate();
+
+        set(chair, FSAreaSearchIndex::FIELD_NAME, "Office Chair");
+        set(chair, FSAreaSearchIndex::FIELD_OWNER, "Resident Name");
+        set(sofa, FSAreaSearchIndex::FIELD_NAME, "Sofa");
+        set(sofa, FSAreaSearchIndex::FIELD_DESCRIPTION, "comfy chair");
+        compare("set");
+
+        uuid_vec_t found;
+        mIndex.find(FSAreaSearchIndex::FIELD_NAME, "CHAIR", found);
+        ensure("name only", found.size() == 1 && found[0] == chair);
+        ensure("unknown object", mIndex.getField(LLUUID::generateNewID(), FSAreaSearchIndex::FIELD_NAME).empty());
+
+        set(chair, FSAreaSearchIndex::FIELD_NAME, "Stool");
+        found.clear();
+        mIndex.find(FSAreaSearchIndex::FIELD_NAME, "chair", found);
+        ensure("renamed", found.empty());
+        compare("renamed");
+
+        remove(sofa);
+        found.clear();
+        mIndex.find(FSAreaSearchIndex::FIELD_DESCRIPTION, "comfy", found);
+        ensure("removed", found.empty());
+        compare("removed");
+
+        mIndex.clear();
+        for (S32 field = 0; field < FSAreaSearchIndex::FIELD_COUNT; ++field)
+        {
+            mTexts[field].clear();
+        }
+        compare("cleared");
+    }
+
+    template<> template<>
+    void FSAreaSearchIndex_t::test<2>()
+    {
+        set_test_name("random updates match a scan");
+        srand(2022);
+        uuid_vec_t ids;
+        for (S32 i = 0; i < 40; ++i)
+        {
+            ids.push_back(LLUUID::generateNewID());
+        }
+        for (S32 i = 0; i < 3000; ++i)
+        {
+            const LLUUID& id = ids[rand() % ids.size()];
+            if (rand() % 8)
+            {
+                set(id, (FSAreaSearchIndex::EField)(rand() % FSAreaSearchIndex::FIELD_COUNT), randomText());
+            }
+            else
+            {
+                remove(id);
+            }
+            if (i % 100 == 0)
+            {
+                compare(llformat("step %d", i));
+            }
+        }
+        compare("end");
+    }
+}
@@ -103,7 +103,7 @@ namespace tut
             LLTemplateMessageBuilder* builder,
             U8 offset = 0)
         {
-            numberMap[1] = &messageTemplate;
+            numberMap.set(1, &messageTemplate);
             const U32 bufferSize = 1024;
             U8 buffer[bufferSize];
             // zero out the packet ID field
@@ -885,7 +885,7 @@ namespace tut
         messageTemplate.addBlock(createBlock(const_cast<char*>(_PREHASH_Test1), MVT_U32, 4, MBT_SINGLE));
 
         // read message value and default value
-        numberMap[1] = &messageTemplate;
+        numberMap.set(1, &messageTemplate);
         LLTemplateMessageReader* reader = 
             new LLTemplateMessageReader(numberMap);
         reader->validateMessage(buffer, builtSize, LLHost());
@@ -918,7 +918,7 @@ namespace tut
         messageTemplate.addBlock(createBlock(const_cast<char*>(_PREHASH_Test1), MVT_U32, 4));
 
         // read message value and check block repeat count
-        numberMap[1] = &messageTemplate;
+        numberMap.set(1, &messageTemplate);
         LLTemplateMessageReader* reader = 
             new LLTemplateMessageReader(numberMap);
         reader->validateMessage(buffer, builtSize, LLHost());
@@ -952,7 +952,7 @@ namespace tut
                                              MBT_SINGLE));
 
         // read message value and default string
-        numberMap[1] = &messageTemplate;
+        numberMap.set(1, &messageTemplate);
         LLTemplateMessageReader* reader = 
             new LLTemplateMessageReader(numberMap);
         reader->validateMessage(buffer, builtSize, LLHost());